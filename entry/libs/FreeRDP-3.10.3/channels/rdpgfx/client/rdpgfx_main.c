@@ -770,6 +770,28 @@ fail:
 	return error;
 }
 
+/**
+ * Save the cache slots of an open channel, e.g. before the client is suspended and the
+ * connection may be lost without the channel being closed
+ *
+ * @return 0 on success, otherwise a Win32 error code
+ */
+static UINT rdpgfx_save_persistent_cache_now(RdpgfxClientContext* context)
+{
+	if (!context)
+		return ERROR_BAD_ARGUMENTS;
+
+	RDPGFX_PLUGIN* gfx = (RDPGFX_PLUGIN*)context->handle;
+
+	if (!gfx || !gfx->rdpcontext)
+		return ERROR_BAD_CONFIGURATION;
+
+	EnterCriticalSection(&context->mux);
+	const UINT error = rdpgfx_save_persistent_cache(gfx);
+	LeaveCriticalSection(&context->mux);
+	return error;
+}
+
 /**
  * Function description
  *
@@ -1229,6 +1251,17 @@ static UINT rdpgfx_recv_end_frame_pdu(GENERIC_CHANNEL_CALLBACK* callback, wStrea
 	{
 		ack.queueDepth = QUEUE_DEPTH_UNAVAILABLE;
 
+		if (context && context->FrameQueueDepth)
+		{
+			const UINT64 frameTime = end - gfx->StartDecodingTime;
+			ack.queueDepth =
+			    context->FrameQueueDepth(context, pdu.frameId, (UINT32)MIN(frameTime, UINT32_MAX));
+
+			/* Reserved for suspending the acknowledgements */
+			if (ack.queueDepth == SUSPEND_FRAME_ACKNOWLEDGEMENT)
+				ack.queueDepth = QUEUE_DEPTH_UNAVAILABLE;
+		}
+
 		if ((error = rdpgfx_send_frame_acknowledge_pdu(context, &ack)))
 			WLog_Print(gfx->log, WLOG_ERROR,
 			           "rdpgfx_send_frame_acknowledge_pdu failed with error %" PRIu32 "", error);
@@ -2391,6 +2424,7 @@ static UINT init_plugin_cb(GENERIC_DYNVC_PLUGIN* base, rdpContext* rcontext, rdp
 	context->FrameAcknowledge = rdpgfx_send_frame_acknowledge_pdu;
 	context->CacheImportOffer = rdpgfx_send_cache_import_offer_pdu;
 	context->QoeFrameAcknowledge = rdpgfx_send_qoe_frame_acknowledge_pdu;
+	context->SavePersistentCache = rdpgfx_save_persistent_cache_now;
 
 	gfx->base.iface.pInterface = (void*)context;
 	gfx->context = context;
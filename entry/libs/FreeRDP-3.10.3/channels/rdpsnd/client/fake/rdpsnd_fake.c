@@ -27,24 +27,44 @@
 #include <winpr/crt.h>
 #include <winpr/stream.h>
 #include <winpr/cmdline.h>
+#include <winpr/sysinfo.h>
 
 #include <freerdp/types.h>
 #include <freerdp/settings.h>
 
 #include "rdpsnd_main.h"
+#include "rdpsnd_jitter.h"
 
 typedef struct
 {
 	rdpsndDevicePlugin device;
+
+	/* Simulated real time sink, used to measure the playout latency */
+	RDPSND_JITTER_SINK sink;
 } rdpsndFakePlugin;
 
 static BOOL rdpsnd_fake_open(rdpsndDevicePlugin* device, const AUDIO_FORMAT* format, UINT32 latency)
 {
+	rdpsndFakePlugin* fake = (rdpsndFakePlugin*)device;
+
+	WINPR_ASSERT(fake);
+	rdpsnd_jitter_sink_reset(&fake->sink);
 	return TRUE;
 }
 
 static void rdpsnd_fake_close(rdpsndDevicePlugin* device)
 {
+	rdpsndFakePlugin* fake = (rdpsndFakePlugin*)device;
+
+	if (!fake || (fake->sink.blocks == 0))
+		return;
+
+	const RDPSND_JITTER_SINK* sink = &fake->sink;
+	WLog_INFO(TAG,
+	          "fake playout: %" PRIu64 " blocks, %" PRIu64 " ms played, %" PRIu64
+	          " underruns, latency avg %" PRIu64 " ms max %" PRIu32 " ms",
+	          sink->blocks, sink->playedMs, sink->underruns, sink->sumQueuedMs / sink->blocks,
+	          sink->maxQueuedMs);
 }
 
 static BOOL rdpsnd_fake_set_volume(rdpsndDevicePlugin* device, UINT32 value)
@@ -67,9 +87,20 @@ static BOOL rdpsnd_fake_format_supported(rdpsndDevicePlugin* device, const AUDIO
 	return TRUE;
 }
 
-static UINT rdpsnd_fake_play(rdpsndDevicePlugin* device, const BYTE* data, size_t size)
+static UINT rdpsnd_fake_play(rdpsndDevicePlugin* device, const AUDIO_FORMAT* format,
+                             const BYTE* data, size_t size)
 {
-	return CHANNEL_RC_OK;
+	rdpsndFakePlugin* fake = (rdpsndFakePlugin*)device;
+	UINT32 duration = 0;
+
+	WINPR_ASSERT(fake);
+	WINPR_ASSERT(format);
+
+	/* Compressed formats are consumed instantly, we can not tell their length */
+	if ((format->wFormatTag == WAVE_FORMAT_PCM) && (format->wBitsPerSample > 0))
+		duration = audio_format_compute_time_length(format, size);
+
+	return rdpsnd_jitter_sink_play(&fake->sink, GetTickCount64(), duration);
 }
 
 /**
@@ -123,7 +154,7 @@ FREERDP_ENTRY_POINT(UINT VCAPITYPE fake_freerdp_rdpsnd_client_subsystem_entry(
 	fake->device.Open = rdpsnd_fake_open;
 	fake->device.FormatSupported = rdpsnd_fake_format_supported;
 	fake->device.SetVolume = rdpsnd_fake_set_volume;
-	fake->device.Play = rdpsnd_fake_play;
+	fake->device.PlayEx = rdpsnd_fake_play;
 	fake->device.Close = rdpsnd_fake_close;
 	fake->device.Free = rdpsnd_fake_free;
 	args = pEntryPoints->args;
@@ -49,6 +49,7 @@
 #include <freerdp/client/channels.h>
 
 #include "rdpsnd_common.h"
+#include "rdpsnd_jitter.h"
 #include "rdpsnd_main.h"
 
 struct rdpsnd_plugin
@@ -92,8 +93,7 @@ struct rdpsnd_plugin
 	BOOL isOpen;
 	AUDIO_FORMAT* fixed_format;
 
-	UINT32 startPlayTime;
-	size_t totalPlaySize;
+	RDPSND_JITTER_BUFFER* jitter;
 
 	char* subsystem;
 	char* device_name;
@@ -435,8 +435,8 @@ static BOOL rdpsnd_ensure_device_is_open(rdpsndPlugin* rdpsnd, UINT16 wFormatNo,
 
 		rdpsnd->isOpen = TRUE;
 		rdpsnd->wCurrentFormatNo = wFormatNo;
-		rdpsnd->startPlayTime = 0;
-		rdpsnd->totalPlaySize = 0;
+		rdpsnd_jitter_set_target(rdpsnd->jitter, rdpsnd->latency);
+		rdpsnd_jitter_reset(rdpsnd->jitter);
 	}
 
 	return rdpsnd_apply_volume(rdpsnd);
@@ -508,92 +508,95 @@ static UINT rdpsnd_send_wave_confirm_pdu(rdpsndPlugin* rdpsnd, UINT16 wTimeStamp
 	return rdpsnd_virtual_channel_write(rdpsnd, pdu);
 }
 
-static BOOL rdpsnd_detect_overrun(rdpsndPlugin* rdpsnd, const AUDIO_FORMAT* format, size_t size)
+static UINT rdpsnd_device_play(rdpsndPlugin* rdpsnd, const AUDIO_FORMAT* format,
+                               const BYTE* data, size_t size)
 {
-	UINT32 bpf = 0;
-	UINT32 now = 0;
-	UINT32 duration = 0;
-	UINT32 totalDuration = 0;
-	UINT32 remainingDuration = 0;
-	UINT32 maxDuration = 0;
-
-	if (!rdpsnd || !format)
-		return FALSE;
+	if (rdpsnd->device->PlayEx)
+		return rdpsnd->device->PlayEx(rdpsnd->device, format, data, size);
+	return IFCALLRESULT(0, rdpsnd->device->Play, rdpsnd->device, data, size);
+}
 
-	/* Older windows RDP servers do not limit the send buffer, which can
-	 * cause quite a large amount of sound data buffered client side.
-	 * If e.g. sound is paused server side the client will keep playing
-	 * for a long time instead of pausing playback.
-	 *
-	 * To avoid this we check:
-	 *
-	 * 1. Is the sound sample received from a known format these servers
-	 *    support
-	 * 2. If it is calculate the size of the client side sound buffer
-	 * 3. If the buffer is too large silently drop the sample which will
-	 *    trigger a retransmit later on.
-	 *
-	 * This check must only be applied to these known formats, because
-	 * with newer and other formats the sample size can not be calculated
-	 * without decompressing the sample first.
-	 */
-	switch (format->wFormatTag)
-	{
-		case WAVE_FORMAT_PCM:
-		case WAVE_FORMAT_DVI_ADPCM:
-		case WAVE_FORMAT_ADPCM:
-		case WAVE_FORMAT_ALAW:
-		case WAVE_FORMAT_MULAW:
-			break;
-		case WAVE_FORMAT_MSG723:
-		case WAVE_FORMAT_GSM610:
-		case WAVE_FORMAT_AAC_MS:
-		default:
-			return FALSE;
-	}
+/**
+ * Hand a wave block to the device through the jitter buffer.
+ *
+ * Older windows RDP servers do not limit the send buffer and mobile links
+ * deliver audio in bursts after a stall, both of which build up a large
+ * amount of sound buffered client side. To keep the playout latency close
+ * to the (jitter adapted) target, silent blocks are dropped and PCM blocks
+ * are shortened while we are behind. Blocks are only dropped outright if
+ * we are far behind. Under the target, silence is played first so late
+ * blocks do not run the device dry.
+ *
+ * @param pcm the format of @data, @format for blocks the device plays as is
+ * @param scratch writable buffer to shorten @data in, may be @data itself
+ *
+ * @return the time in ms until the block has been played out
+ */
+static UINT32 rdpsnd_play_scheduled(rdpsndPlugin* rdpsnd, const AUDIO_FORMAT* format,
+                                    const AUDIO_FORMAT* pcm, const BYTE* data, size_t size,
+                                    wStream* scratch)
+{
+	const UINT64 now = GetTickCount64();
+	UINT32 duration = rdpsnd_jitter_duration(pcm, size);
+	UINT32 adjust = 0;
+	UINT32 latency = 0;
 
-	audio_format_print(WLog_Get(TAG), WLOG_DEBUG, format);
-	bpf = format->nChannels * format->wBitsPerSample * format->nSamplesPerSec / 8;
-	if (bpf == 0)
-		return FALSE;
+	/* The duration of compressed formats can not be calculated without decoding */
+	if (duration == 0)
+		return rdpsnd_device_play(rdpsnd, format, data, size);
 
-	duration = (UINT32)(1000 * size / bpf);
-	totalDuration = (UINT32)(1000 * rdpsnd->totalPlaySize / bpf);
-	now = GetTickCountPrecise();
-	if (rdpsnd->startPlayTime == 0)
-	{
-		rdpsnd->startPlayTime = now;
-		rdpsnd->totalPlaySize = size;
-		return FALSE;
-	}
-	else if (now - rdpsnd->startPlayTime > totalDuration + 10)
-	{
-		/* Buffer underrun */
-		WLog_Print(rdpsnd->log, WLOG_DEBUG, "%s Buffer underrun by %u ms",
-		           rdpsnd_is_dyn_str(rdpsnd->dynamic),
-		           (UINT)(now - rdpsnd->startPlayTime - totalDuration));
-		rdpsnd->startPlayTime = now;
-		rdpsnd->totalPlaySize = size;
-		return FALSE;
-	}
-	else
+	const BOOL silent = rdpsnd_jitter_is_silent(pcm, data, size);
+	const BOOL canStretch = rdpsnd_jitter_can_shorten(pcm);
+
+	switch (rdpsnd_jitter_schedule(rdpsnd->jitter, now, duration, silent, canStretch, &adjust))
 	{
-		/* Calculate remaining duration to be played */
-		remainingDuration = totalDuration - (now - rdpsnd->startPlayTime);
+		case RDPSND_JITTER_DROP:
+			WLog_Print(rdpsnd->log, WLOG_DEBUG, "%s Buffer overrun, dropping %" PRIu32 " ms%s",
+			           rdpsnd_is_dyn_str(rdpsnd->dynamic), duration, silent ? " of silence" : "");
+			return rdpsnd_jitter_commit(rdpsnd->jitter, now, 0);
+
+		case RDPSND_JITTER_STRETCH:
+			if (data != Stream_Buffer(scratch))
+			{
+				Stream_SetPosition(scratch, 0);
+				if (!Stream_EnsureRemainingCapacity(scratch, size))
+					break;
+				Stream_Write(scratch, data, size);
+			}
 
-		/* Maximum allow duration calculation */
-		maxDuration = duration * 2 + rdpsnd->latency;
+			size = rdpsnd_jitter_shorten(pcm, Stream_Buffer(scratch), size, adjust);
+			data = Stream_Buffer(scratch);
+			duration = rdpsnd_jitter_duration(pcm, size);
+			WLog_Print(rdpsnd->log, WLOG_TRACE, "%s Buffer overrun, shortened block by %" PRIu32
+			           " ms", rdpsnd_is_dyn_str(rdpsnd->dynamic), adjust);
+			break;
 
-		if (remainingDuration + duration > maxDuration)
+		case RDPSND_JITTER_PAD:
 		{
-			WLog_Print(rdpsnd->log, WLOG_DEBUG, "%s Buffer overrun pending %u ms dropping %u ms",
-			           rdpsnd_is_dyn_str(rdpsnd->dynamic), remainingDuration, duration);
-			return TRUE;
+			wStream* silence = StreamPool_Take(rdpsnd->pool, 4096);
+			if (!silence)
+				break;
+
+			const size_t padSize = rdpsnd_jitter_silence(pcm, silence, adjust);
+			if (padSize > 0)
+			{
+				WLog_Print(rdpsnd->log, WLOG_TRACE, "%s Buffer underrun, %" PRIu32
+				           " ms of silence first", rdpsnd_is_dyn_str(rdpsnd->dynamic), adjust);
+				latency = rdpsnd_device_play(rdpsnd, format, Stream_Buffer(silence), padSize);
+				rdpsnd_jitter_commit(rdpsnd->jitter, now, rdpsnd_jitter_duration(pcm, padSize));
+			}
+			Stream_Release(silence);
+			break;
 		}
 
-		rdpsnd->totalPlaySize += size;
-		return FALSE;
+		case RDPSND_JITTER_PLAY:
+		default:
+			break;
 	}
+
+	latency = MAX(latency, rdpsnd_device_play(rdpsnd, format, data, size));
+	const UINT32 playout = rdpsnd_jitter_commit(rdpsnd->jitter, now, duration);
+	return MAX(latency, playout);
 }
 
 static UINT rdpsnd_treat_wave(rdpsndPlugin* rdpsnd, wStream* s, size_t size)
@@ -626,28 +629,28 @@ static UINT rdpsnd_treat_wave(rdpsndPlugin* rdpsnd, wStream* s, size_t size)
 	           "%s Wave: cBlockNo: %" PRIu8 " wTimeStamp: %" PRIu16 ", size: %" PRIdz,
 	           rdpsnd_is_dyn_str(rdpsnd->dynamic), rdpsnd->cBlockNo, rdpsnd->wTimeStamp, size);
 
-	if (rdpsnd->device && rdpsnd->attached && !rdpsnd_detect_overrun(rdpsnd, format, size))
+	rdpsnd_jitter_arrival(rdpsnd->jitter, rdpsnd->wTimeStamp, rdpsnd->wArrivalTime);
+
+	if (rdpsnd->device && rdpsnd->attached)
 	{
 		UINT status = CHANNEL_RC_OK;
 		wStream* pcmData = StreamPool_Take(rdpsnd->pool, 4096);
 
+		if (!pcmData)
+			return CHANNEL_RC_NO_MEMORY;
+
 		if (rdpsnd->device->FormatSupported(rdpsnd->device, format))
-		{
-			if (rdpsnd->device->PlayEx)
-				latency = rdpsnd->device->PlayEx(rdpsnd->device, format, data, size);
-			else
-				latency = IFCALLRESULT(0, rdpsnd->device->Play, rdpsnd->device, data, size);
-		}
+			latency = rdpsnd_play_scheduled(rdpsnd, format, format, data, size, pcmData);
 		else if (freerdp_dsp_decode(rdpsnd->dsp_context, format, data, size, pcmData))
 		{
-			Stream_SealLength(pcmData);
+			AUDIO_FORMAT pcm = *format;
 
-			if (rdpsnd->device->PlayEx)
-				latency = rdpsnd->device->PlayEx(rdpsnd->device, format, Stream_Buffer(pcmData),
-				                                 Stream_Length(pcmData));
-			else
-				latency = IFCALLRESULT(0, rdpsnd->device->Play, rdpsnd->device,
-				                       Stream_Buffer(pcmData), Stream_Length(pcmData));
+			/* The DSP decoders produce 16 bit PCM with the source layout */
+			pcm.wFormatTag = WAVE_FORMAT_PCM;
+			pcm.wBitsPerSample = 16;
+			Stream_SealLength(pcmData);
+			latency = rdpsnd_play_scheduled(rdpsnd, format, &pcm, Stream_Buffer(pcmData),
+			                                Stream_Length(pcmData), pcmData);
 		}
 		else
 			status = ERROR_INTERNAL_ERROR;
@@ -658,6 +661,11 @@ static UINT rdpsnd_treat_wave(rdpsndPlugin* rdpsnd, wStream* s, size_t size)
 			return status;
 	}
 
+	/*
+	 * The confirmed timestamp is the moment the block has actually been
+	 * played out: queueing time in the channel plus what is still ahead of
+	 * it in the device.
+	 */
 	end = GetTickCount64();
 	diffMS = end - rdpsnd->wArrivalTime + latency;
 	ts = (rdpsnd->wTimeStamp + diffMS) % UINT16_MAX;
@@ -726,8 +734,20 @@ static void rdpsnd_recv_close_pdu(rdpsndPlugin* rdpsnd)
 {
 	if (rdpsnd->isOpen)
 	{
+		RDPSND_JITTER_STATS stats = { 0 };
+
 		WLog_Print(rdpsnd->log, WLOG_DEBUG, "%s Closing device",
 		           rdpsnd_is_dyn_str(rdpsnd->dynamic));
+
+		if (rdpsnd_jitter_get_stats(rdpsnd->jitter, GetTickCount64(), &stats))
+			WLog_Print(rdpsnd->log, WLOG_DEBUG,
+			           "%s Jitter buffer: %" PRIu64 " blocks, %" PRIu64 " dropped (%" PRIu64
+			           " ms), %" PRIu64 " shortened (%" PRIu64 " ms), %" PRIu64
+			           " underruns, jitter %" PRIu32 " ms, target %" PRIu32
+			           " ms, max buffered %" PRIu32 " ms",
+			           rdpsnd_is_dyn_str(rdpsnd->dynamic), stats.blocks, stats.dropped,
+			           stats.droppedMs, stats.stretched, stats.trimmedMs, stats.underruns,
+			           stats.jitterMs, stats.targetMs, stats.maxBufferedMs);
 	}
 	else
 		WLog_Print(rdpsnd->log, WLOG_DEBUG, "%s Device already closed",
@@ -1358,8 +1378,10 @@ static void free_internals(rdpsndPlugin* rdpsnd)
 
 	freerdp_dsp_context_free(rdpsnd->dsp_context);
 	StreamPool_Free(rdpsnd->pool);
+	rdpsnd_jitter_free(rdpsnd->jitter);
 	rdpsnd->pool = NULL;
 	rdpsnd->dsp_context = NULL;
+	rdpsnd->jitter = NULL;
 }
 
 static BOOL allocate_internals(rdpsndPlugin* rdpsnd)
@@ -1379,6 +1401,13 @@ static BOOL allocate_internals(rdpsndPlugin* rdpsnd)
 		if (!rdpsnd->dsp_context)
 			return FALSE;
 	}
+
+	if (!rdpsnd->jitter)
+	{
+		rdpsnd->jitter = rdpsnd_jitter_new(rdpsnd->latency);
+		if (!rdpsnd->jitter)
+			return FALSE;
+	}
 	rdpsnd->references++;
 
 	return TRUE;
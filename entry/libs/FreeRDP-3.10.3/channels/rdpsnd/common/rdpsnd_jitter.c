@@ -0,0 +1,387 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Audio Output Virtual Channel - Adaptive jitter buffer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *	 http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/crt.h>
+#include <winpr/assert.h>
+
+#include "rdpsnd_jitter.h"
+
+/* Blocks with a peak below this (16 bit scale) are treated as silence */
+#define RDPSND_JITTER_SILENCE_PEAK 64
+/* Never shorten a block by more than this percentage */
+#define RDPSND_JITTER_MAX_STRETCH 25
+/* Length of the cross-fade around a cut */
+#define RDPSND_JITTER_FADE_MS 4
+/* Gaps in playout shorter than this are not counted as underruns */
+#define RDPSND_JITTER_UNDERRUN_SLACK_MS 10
+/* Ahead of a silent block, never pad more than this many times its length */
+#define RDPSND_JITTER_MAX_PAD_BLOCKS 2
+
+struct rdpsnd_jitter_buffer
+{
+	UINT32 baseTarget;
+
+	/* RFC 3550 interarrival jitter estimate, scaled by 16 */
+	BOOL havePrevious;
+	UINT16 prevTimeStamp;
+	UINT64 prevArrival;
+	UINT32 jitter16;
+
+	/* local time at which everything handed to the device has been played */
+	UINT64 playoutEnd;
+	BOOL playing;
+
+	RDPSND_JITTER_STATS stats;
+};
+
+RDPSND_JITTER_BUFFER* rdpsnd_jitter_new(UINT32 targetMs)
+{
+	RDPSND_JITTER_BUFFER* jb = calloc(1, sizeof(RDPSND_JITTER_BUFFER));
+	if (!jb)
+		return NULL;
+
+	rdpsnd_jitter_set_target(jb, targetMs);
+	return jb;
+}
+
+void rdpsnd_jitter_free(RDPSND_JITTER_BUFFER* jb)
+{
+	free(jb);
+}
+
+void rdpsnd_jitter_reset(RDPSND_JITTER_BUFFER* jb)
+{
+	if (!jb)
+		return;
+
+	const UINT32 target = jb->baseTarget;
+	const UINT32 jitter16 = jb->jitter16;
+	const RDPSND_JITTER_STATS stats = jb->stats;
+	memset(jb, 0, sizeof(RDPSND_JITTER_BUFFER));
+
+	/* The network does not change with the audio format, keep what we learned. */
+	jb->baseTarget = target;
+	jb->jitter16 = jitter16;
+	jb->stats = stats;
+}
+
+void rdpsnd_jitter_set_target(RDPSND_JITTER_BUFFER* jb, UINT32 targetMs)
+{
+	WINPR_ASSERT(jb);
+
+	if (targetMs == 0)
+		targetMs = RDPSND_JITTER_DEFAULT_TARGET_MS;
+	jb->baseTarget = MIN(targetMs, RDPSND_JITTER_MAX_TARGET_MS);
+}
+
+UINT32 rdpsnd_jitter_target(const RDPSND_JITTER_BUFFER* jb)
+{
+	WINPR_ASSERT(jb);
+
+	/* Keep enough audio queued to ride out twice the mean deviation */
+	const UINT64 target = 1ull * jb->baseTarget + 2ull * (jb->jitter16 >> 4);
+	return (UINT32)MIN(target, RDPSND_JITTER_MAX_TARGET_MS);
+}
+
+void rdpsnd_jitter_arrival(RDPSND_JITTER_BUFFER* jb, UINT16 wTimeStamp, UINT64 arrivalMs)
+{
+	if (!jb)
+		return;
+
+	if (jb->havePrevious)
+	{
+		const INT64 sent = (INT16)(UINT16)(wTimeStamp - jb->prevTimeStamp);
+		const INT64 received = (INT64)(arrivalMs - jb->prevArrival);
+		INT64 d = received - sent;
+
+		if (d < 0)
+			d = -d;
+
+		/* Clamp outliers (server pauses) so a single event can not dominate */
+		d = MIN(d, RDPSND_JITTER_MAX_TARGET_MS);
+
+		/* J += (|D| - J) / 16, in 1/16 ms units */
+		const INT64 j = jb->jitter16;
+		jb->jitter16 = (UINT32)(j + d - ((j + 8) >> 4));
+	}
+
+	jb->havePrevious = TRUE;
+	jb->prevTimeStamp = wTimeStamp;
+	jb->prevArrival = arrivalMs;
+}
+
+static UINT32 rdpsnd_jitter_buffered(RDPSND_JITTER_BUFFER* jb, UINT64 nowMs)
+{
+	if (jb->playoutEnd <= nowMs)
+		return 0;
+
+	const UINT64 buffered = jb->playoutEnd - nowMs;
+	return (UINT32)MIN(buffered, UINT32_MAX);
+}
+
+RDPSND_JITTER_ACTION rdpsnd_jitter_schedule(RDPSND_JITTER_BUFFER* jb, UINT64 nowMs,
+                                            UINT32 durationMs, BOOL silent, BOOL canStretch,
+                                            UINT32* adjustMs)
+{
+	WINPR_ASSERT(jb);
+	WINPR_ASSERT(adjustMs);
+
+	*adjustMs = 0;
+	const UINT32 buffered = rdpsnd_jitter_buffered(jb, nowMs);
+	const UINT32 target = rdpsnd_jitter_target(jb);
+
+	if (!jb->playing || (buffered <= target))
+	{
+		/*
+		 * Under the target, build up the playout delay with silence. When the
+		 * sink ran dry there is a gap anyway, so the whole delay goes in front
+		 * of the block. Otherwise only silent blocks are made longer, which is
+		 * inaudible.
+		 */
+		if (!canStretch || (buffered + durationMs >= target))
+			return RDPSND_JITTER_PLAY;
+
+		UINT32 pad = target - buffered - durationMs;
+		if (buffered > 0)
+		{
+			if (!silent)
+				return RDPSND_JITTER_PLAY;
+			pad = MIN(pad, durationMs * RDPSND_JITTER_MAX_PAD_BLOCKS);
+		}
+
+		*adjustMs = pad;
+		jb->stats.padded++;
+		jb->stats.paddedMs += pad;
+		return RDPSND_JITTER_PAD;
+	}
+
+	const UINT32 excess = buffered - target;
+
+	/*
+	 * Dropping silence is inaudible, always prefer that. When far behind
+	 * time stretching would take too long to catch up.
+	 */
+	if (silent || (buffered > 2 * target + durationMs) || (!canStretch && (excess > target)))
+	{
+		jb->stats.dropped++;
+		jb->stats.droppedMs += durationMs;
+		return RDPSND_JITTER_DROP;
+	}
+
+	if (!canStretch)
+		return RDPSND_JITTER_PLAY;
+
+	*adjustMs = MIN(excess, durationMs * RDPSND_JITTER_MAX_STRETCH / 100);
+	if (*adjustMs == 0)
+		return RDPSND_JITTER_PLAY;
+
+	jb->stats.stretched++;
+	jb->stats.trimmedMs += *adjustMs;
+	return RDPSND_JITTER_STRETCH;
+}
+
+UINT32 rdpsnd_jitter_commit(RDPSND_JITTER_BUFFER* jb, UINT64 nowMs, UINT32 durationMs)
+{
+	WINPR_ASSERT(jb);
+
+	if (durationMs == 0)
+		return rdpsnd_jitter_buffered(jb, nowMs);
+
+	if (jb->playoutEnd < nowMs)
+	{
+		if (jb->playing && (nowMs - jb->playoutEnd > RDPSND_JITTER_UNDERRUN_SLACK_MS))
+			jb->stats.underruns++;
+		jb->playoutEnd = nowMs;
+	}
+
+	jb->playing = TRUE;
+	jb->playoutEnd += durationMs;
+	jb->stats.blocks++;
+
+	const UINT32 buffered = rdpsnd_jitter_buffered(jb, nowMs);
+	jb->stats.maxBufferedMs = MAX(jb->stats.maxBufferedMs, buffered);
+	return buffered;
+}
+
+BOOL rdpsnd_jitter_get_stats(const RDPSND_JITTER_BUFFER* jb, UINT64 nowMs,
+                             RDPSND_JITTER_STATS* stats)
+{
+	if (!jb || !stats)
+		return FALSE;
+
+	*stats = jb->stats;
+	stats->jitterMs = jb->jitter16 >> 4;
+	stats->targetMs = rdpsnd_jitter_target(jb);
+	stats->bufferedMs = (jb->playoutEnd > nowMs) ? (UINT32)(jb->playoutEnd - nowMs) : 0;
+	return TRUE;
+}
+
+UINT32 rdpsnd_jitter_duration(const AUDIO_FORMAT* format, size_t size)
+{
+	if (!format)
+		return 0;
+
+	/* Only formats with a fixed bit rate, see rdpsnd_treat_wave */
+	switch (format->wFormatTag)
+	{
+		case WAVE_FORMAT_PCM:
+		case WAVE_FORMAT_DVI_ADPCM:
+		case WAVE_FORMAT_ADPCM:
+		case WAVE_FORMAT_ALAW:
+		case WAVE_FORMAT_MULAW:
+			break;
+		default:
+			return 0;
+	}
+
+	const UINT64 bps = 1ull * format->nChannels * format->wBitsPerSample * format->nSamplesPerSec;
+	if (bps == 0)
+		return 0;
+
+	const UINT64 duration = 8000ull * size / bps;
+	return (UINT32)MIN(duration, UINT32_MAX);
+}
+
+BOOL rdpsnd_jitter_can_shorten(const AUDIO_FORMAT* format)
+{
+	if (!format)
+		return FALSE;
+
+	return (format->wFormatTag == WAVE_FORMAT_PCM) && (format->wBitsPerSample == 16) &&
+	       (format->nChannels > 0) && (format->nSamplesPerSec > 0);
+}
+
+BOOL rdpsnd_jitter_is_silent(const AUDIO_FORMAT* format, const BYTE* data, size_t size)
+{
+	if (!format || !data || (format->wFormatTag != WAVE_FORMAT_PCM))
+		return FALSE;
+
+	switch (format->wBitsPerSample)
+	{
+		case 8:
+			for (size_t x = 0; x < size; x++)
+			{
+				const INT32 v = (INT32)data[x] - 128;
+				if ((v > 1) || (v < -1))
+					return FALSE;
+			}
+			return TRUE;
+		case 16:
+		{
+			const size_t count = size / sizeof(INT16);
+			for (size_t x = 0; x < count; x++)
+			{
+				INT16 v = 0;
+				memcpy(&v, &data[x * sizeof(INT16)], sizeof(INT16));
+				if ((v > RDPSND_JITTER_SILENCE_PEAK) || (v < -RDPSND_JITTER_SILENCE_PEAK))
+					return FALSE;
+			}
+			return TRUE;
+		}
+		default:
+			return FALSE;
+	}
+}
+
+size_t rdpsnd_jitter_shorten(const AUDIO_FORMAT* format, BYTE* data, size_t size,
+                             UINT32 removeMs)
+{
+	if (!rdpsnd_jitter_can_shorten(format) || !data)
+		return size;
+
+	const size_t channels = format->nChannels;
+	const size_t frameSize = channels * sizeof(INT16);
+	const size_t frames = size / frameSize;
+	size_t remove = 1ull * format->nSamplesPerSec * removeMs / 1000;
+	size_t fade = 1ull * format->nSamplesPerSec * RDPSND_JITTER_FADE_MS / 1000;
+
+	remove = MIN(remove, frames * RDPSND_JITTER_MAX_STRETCH / 100);
+	if (remove == 0)
+		return size;
+
+	fade = MIN(fade, frames - remove);
+	if (fade == 0)
+		return size;
+
+	/*
+	 * Cut @remove frames out of the middle of the block. The @fade frames
+	 * before the cut are blended with the @fade frames after it so there is
+	 * no discontinuity in the waveform.
+	 */
+	const size_t start = (frames - remove - fade) / 2;
+	INT16* samples = (INT16*)data;
+
+	for (size_t x = 0; x < fade; x++)
+	{
+		const INT32 w = (INT32)((x * 256) / fade);
+		INT16* dst = &samples[(start + x) * channels];
+		const INT16* src = &samples[(start + x + remove) * channels];
+
+		for (size_t c = 0; c < channels; c++)
+			dst[c] = (INT16)((dst[c] * (256 - w) + src[c] * w) / 256);
+	}
+
+	const size_t tail = start + fade;
+	MoveMemory(&data[tail * frameSize], &data[(tail + remove) * frameSize],
+	           (frames - tail - remove) * frameSize);
+	return (frames - remove) * frameSize;
+}
+
+size_t rdpsnd_jitter_silence(const AUDIO_FORMAT* format, wStream* s, UINT32 durationMs)
+{
+	if (!rdpsnd_jitter_can_shorten(format) || !s)
+		return 0;
+
+	const size_t frameSize = 1ull * format->nChannels * sizeof(INT16);
+	const size_t size = frameSize * format->nSamplesPerSec * durationMs / 1000;
+
+	Stream_SetPosition(s, 0);
+	if (!Stream_EnsureRemainingCapacity(s, size))
+		return 0;
+
+	Stream_Zero(s, size);
+	Stream_SealLength(s);
+	return size;
+}
+
+void rdpsnd_jitter_sink_reset(RDPSND_JITTER_SINK* sink)
+{
+	WINPR_ASSERT(sink);
+	ZeroMemory(sink, sizeof(RDPSND_JITTER_SINK));
+}
+
+UINT32 rdpsnd_jitter_sink_play(RDPSND_JITTER_SINK* sink, UINT64 nowMs, UINT32 durationMs)
+{
+	WINPR_ASSERT(sink);
+
+	if (sink->playoutEnd < nowMs)
+	{
+		/* Gaps of a few ms are scheduling noise of the caller, not audible */
+		if ((sink->blocks > 0) && (nowMs - sink->playoutEnd > RDPSND_JITTER_UNDERRUN_SLACK_MS))
+			sink->underruns++;
+		sink->playoutEnd = nowMs;
+	}
+
+	sink->playoutEnd += durationMs;
+	sink->playedMs += durationMs;
+	sink->blocks++;
+
+	const UINT32 queued = (UINT32)MIN(sink->playoutEnd - nowMs, UINT32_MAX);
+	sink->sumQueuedMs += queued;
+	sink->maxQueuedMs = MAX(sink->maxQueuedMs, queued);
+	return queued;
+}
@@ -0,0 +1,149 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Audio Output Virtual Channel - Adaptive jitter buffer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *	 http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_CHANNEL_RDPSND_COMMON_JITTER_H
+#define FREERDP_CHANNEL_RDPSND_COMMON_JITTER_H
+
+#include <winpr/wtypes.h>
+#include <winpr/stream.h>
+
+#include <freerdp/codec/audio.h>
+
+/** Playout latency the buffer aims for when the channel was not given one */
+#define RDPSND_JITTER_DEFAULT_TARGET_MS 120
+/** Upper bound for the adaptive target, whatever the measured jitter */
+#define RDPSND_JITTER_MAX_TARGET_MS 800
+
+typedef enum
+{
+	RDPSND_JITTER_PLAY,    /** play the block as is */
+	RDPSND_JITTER_STRETCH, /** shorten the block before playing it */
+	RDPSND_JITTER_DROP,    /** skip the block entirely */
+	RDPSND_JITTER_PAD      /** play silence before the block to build up the playout delay */
+} RDPSND_JITTER_ACTION;
+
+typedef struct
+{
+	UINT64 blocks;
+	UINT64 dropped;
+	UINT64 stretched;
+	UINT64 padded;
+	UINT64 underruns;
+	UINT64 droppedMs;
+	UINT64 trimmedMs;
+	UINT64 paddedMs;
+	UINT32 jitterMs;
+	UINT32 targetMs;
+	UINT32 bufferedMs;
+	UINT32 maxBufferedMs;
+} RDPSND_JITTER_STATS;
+
+/** Model of a real time audio sink, used by the fake backend and the tests */
+typedef struct
+{
+	UINT64 playoutEnd;
+	UINT64 blocks;
+	UINT64 playedMs;
+	UINT64 underruns;
+	UINT64 sumQueuedMs;
+	UINT32 maxQueuedMs;
+} RDPSND_JITTER_SINK;
+
+typedef struct rdpsnd_jitter_buffer RDPSND_JITTER_BUFFER;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	void rdpsnd_jitter_free(RDPSND_JITTER_BUFFER* jb);
+
+	WINPR_ATTR_MALLOC(rdpsnd_jitter_free, 1)
+	RDPSND_JITTER_BUFFER* rdpsnd_jitter_new(UINT32 targetMs);
+
+	void rdpsnd_jitter_reset(RDPSND_JITTER_BUFFER* jb);
+	void rdpsnd_jitter_set_target(RDPSND_JITTER_BUFFER* jb, UINT32 targetMs);
+
+	/**
+	 * Feed the arrival of a wave block into the jitter estimator.
+	 *
+	 * @param wTimeStamp the server timestamp of the block (ms, wrapping)
+	 * @param arrivalMs the local time the block was received
+	 */
+	void rdpsnd_jitter_arrival(RDPSND_JITTER_BUFFER* jb, UINT16 wTimeStamp, UINT64 arrivalMs);
+
+	/**
+	 * Decide what to do with a block of @durationMs that is about to be queued.
+	 *
+	 * Over the target the block is dropped or shortened, under it silence is
+	 * played first when playout starts, after an underrun or before a silent block.
+	 *
+	 * @param silent the block contains no audible signal
+	 * @param canStretch the block can be shortened with rdpsnd_jitter_shorten and
+	 *                   silence for it made with rdpsnd_jitter_silence
+	 * @param adjustMs receives the duration to remove for RDPSND_JITTER_STRETCH or
+	 *                 the silence to play first for RDPSND_JITTER_PAD
+	 */
+	RDPSND_JITTER_ACTION rdpsnd_jitter_schedule(RDPSND_JITTER_BUFFER* jb, UINT64 nowMs,
+	                                            UINT32 durationMs, BOOL silent, BOOL canStretch,
+	                                            UINT32* adjustMs);
+
+	/**
+	 * Account a block of @durationMs handed to the device (0 for dropped blocks).
+	 *
+	 * @return the time in ms until the block has been played out
+	 */
+	UINT32 rdpsnd_jitter_commit(RDPSND_JITTER_BUFFER* jb, UINT64 nowMs, UINT32 durationMs);
+
+	UINT32 rdpsnd_jitter_target(const RDPSND_JITTER_BUFFER* jb);
+	BOOL rdpsnd_jitter_get_stats(const RDPSND_JITTER_BUFFER* jb, UINT64 nowMs,
+	                             RDPSND_JITTER_STATS* stats);
+
+	/** @return the duration of @size bytes in @format in ms, 0 if it can not be computed */
+	UINT32 rdpsnd_jitter_duration(const AUDIO_FORMAT* format, size_t size);
+	BOOL rdpsnd_jitter_is_silent(const AUDIO_FORMAT* format, const BYTE* data, size_t size);
+	BOOL rdpsnd_jitter_can_shorten(const AUDIO_FORMAT* format);
+
+	/**
+	 * Remove @removeMs from a PCM block in place, cross-fading around the cut.
+	 *
+	 * @return the new size of the block in bytes
+	 */
+	size_t rdpsnd_jitter_shorten(const AUDIO_FORMAT* format, BYTE* data, size_t size,
+	                             UINT32 removeMs);
+
+	/**
+	 * Write @durationMs of silence in @format to @s.
+	 *
+	 * @return the number of bytes written, 0 on failure
+	 */
+	size_t rdpsnd_jitter_silence(const AUDIO_FORMAT* format, wStream* s, UINT32 durationMs);
+
+	void rdpsnd_jitter_sink_reset(RDPSND_JITTER_SINK* sink);
+
+	/**
+	 * Queue @durationMs on the simulated sink, which plays in real time.
+	 *
+	 * @return the time in ms until everything queued has been played out
+	 */
+	UINT32 rdpsnd_jitter_sink_play(RDPSND_JITTER_SINK* sink, UINT64 nowMs, UINT32 durationMs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FREERDP_CHANNEL_RDPSND_COMMON_JITTER_H */
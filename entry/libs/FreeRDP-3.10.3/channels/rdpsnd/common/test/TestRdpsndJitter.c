@@ -0,0 +1,271 @@
+#include <stdio.h>
+
+#include <winpr/crt.h>
+
+#include "../rdpsnd_jitter.h"
+
+#define BLOCK_MS 20
+#define TRACE_MS 10000
+
+typedef struct
+{
+	UINT32 maxLatency;
+	UINT32 endLatency;
+	UINT64 sumLatency;
+	UINT64 blocks;
+	RDPSND_JITTER_STATS stats;
+} TRACE_RESULT;
+
+static UINT32 prand(UINT32* state)
+{
+	*state = *state * 1103515245u + 12345u;
+	return (*state >> 16) & 0x7FFF;
+}
+
+/*
+ * Synthetic Wi-Fi to cellular handover: 20 ms blocks with up to 30 ms
+ * arrival jitter, interrupted by a 900 ms stall after which the backlog
+ * arrives as one burst. Every fourth block is silence.
+ */
+static UINT64 trace_arrival(UINT32 block, UINT32* seed, UINT64* last)
+{
+	const UINT64 sent = 1ull * block * BLOCK_MS;
+	UINT64 arrival = 1000 + sent + 40 + prand(seed) % 30;
+
+	if ((sent >= 3000) && (sent < 3900))
+		arrival = 1000 + 3900 + 40;
+
+	arrival = MAX(arrival, *last);
+	*last = arrival;
+	return arrival;
+}
+
+static BOOL run_trace(BOOL adaptive, TRACE_RESULT* result)
+{
+	UINT32 seed = 42;
+	UINT64 last = 0;
+	RDPSND_JITTER_BUFFER* jb = rdpsnd_jitter_new(100);
+
+	if (!jb)
+		return FALSE;
+
+	ZeroMemory(result, sizeof(TRACE_RESULT));
+
+	for (UINT32 block = 0; block < TRACE_MS / BLOCK_MS; block++)
+	{
+		const UINT64 now = trace_arrival(block, &seed, &last);
+		const BOOL silent = (block % 4) == 3;
+		RDPSND_JITTER_ACTION action = RDPSND_JITTER_PLAY;
+		UINT32 duration = BLOCK_MS;
+		UINT32 adjust = 0;
+
+		rdpsnd_jitter_arrival(jb, (UINT16)(block * BLOCK_MS), now);
+
+		if (adaptive)
+			action = rdpsnd_jitter_schedule(jb, now, duration, silent, TRUE, &adjust);
+
+		if (action == RDPSND_JITTER_DROP)
+			duration = 0;
+		else if (action == RDPSND_JITTER_STRETCH)
+			duration -= adjust;
+		else if (action == RDPSND_JITTER_PAD)
+			rdpsnd_jitter_commit(jb, now, adjust);
+
+		const UINT32 latency = rdpsnd_jitter_commit(jb, now, duration);
+		result->maxLatency = MAX(result->maxLatency, latency);
+		result->sumLatency += latency;
+		result->endLatency = latency;
+		result->blocks++;
+	}
+
+	rdpsnd_jitter_get_stats(jb, last, &result->stats);
+	rdpsnd_jitter_free(jb);
+	return TRUE;
+}
+
+static BOOL test_trace(void)
+{
+	TRACE_RESULT fixed = { 0 };
+	TRACE_RESULT adaptive = { 0 };
+
+	if (!run_trace(FALSE, &fixed) || !run_trace(TRUE, &adaptive))
+		return FALSE;
+
+	printf("fixed:    avg %" PRIu64 " ms, max %" PRIu32 " ms, end %" PRIu32 " ms\n",
+	       fixed.sumLatency / fixed.blocks, fixed.maxLatency, fixed.endLatency);
+	printf("adaptive: avg %" PRIu64 " ms, max %" PRIu32 " ms, end %" PRIu32 " ms, jitter %" PRIu32
+	       " ms, target %" PRIu32 " ms, dropped %" PRIu64 " (%" PRIu64 " ms), shortened %" PRIu64
+	       " (%" PRIu64 " ms), underruns %" PRIu64 "\n",
+	       adaptive.sumLatency / adaptive.blocks, adaptive.maxLatency, adaptive.endLatency,
+	       adaptive.stats.jitterMs, adaptive.stats.targetMs, adaptive.stats.dropped,
+	       adaptive.stats.droppedMs, adaptive.stats.stretched, adaptive.stats.trimmedMs,
+	       adaptive.stats.underruns);
+
+	/* Without the jitter buffer the burst stays queued for the rest of the session */
+	if (fixed.endLatency < 500)
+		return FALSE;
+
+	/* With it, we are back at the target shortly after the burst */
+	if (adaptive.endLatency > adaptive.stats.targetMs + BLOCK_MS)
+		return FALSE;
+
+	/* The target grows with the jitter of the burst, but the peak must still be cut */
+	if (adaptive.maxLatency > fixed.maxLatency / 2)
+		return FALSE;
+
+	return (adaptive.stats.dropped > 0) && (adaptive.stats.stretched > 0);
+}
+
+/*
+ * 20 ms blocks delivered with up to 60 ms of random delay. The server clock
+ * runs 5% slow against the sink, so a queue that is not topped up drains.
+ */
+static BOOL run_sink(BOOL adaptive, RDPSND_JITTER_SINK* sink, UINT32* targetMs)
+{
+	UINT32 seed = 7;
+	UINT64 last = 0;
+	RDPSND_JITTER_BUFFER* jb = rdpsnd_jitter_new(60);
+
+	if (!jb)
+		return FALSE;
+
+	rdpsnd_jitter_sink_reset(sink);
+
+	for (UINT32 block = 0; block < TRACE_MS / BLOCK_MS; block++)
+	{
+		const UINT64 sent = 1ull * block * BLOCK_MS * 21 / 20;
+		const UINT64 now = MAX(1000 + sent + prand(&seed) % 60, last);
+		const BOOL silent = (block % 4) == 3;
+		RDPSND_JITTER_ACTION action = RDPSND_JITTER_PLAY;
+		UINT32 duration = BLOCK_MS;
+		UINT32 adjust = 0;
+
+		last = now;
+		rdpsnd_jitter_arrival(jb, (UINT16)sent, now);
+
+		if (adaptive)
+			action = rdpsnd_jitter_schedule(jb, now, duration, silent, TRUE, &adjust);
+
+		switch (action)
+		{
+			case RDPSND_JITTER_DROP:
+				duration = 0;
+				break;
+			case RDPSND_JITTER_STRETCH:
+				duration -= adjust;
+				break;
+			case RDPSND_JITTER_PAD:
+				rdpsnd_jitter_sink_play(sink, now, adjust);
+				rdpsnd_jitter_commit(jb, now, adjust);
+				break;
+			default:
+				break;
+		}
+
+		if (duration > 0)
+			rdpsnd_jitter_sink_play(sink, now, duration);
+		rdpsnd_jitter_commit(jb, now, duration);
+	}
+
+	*targetMs = rdpsnd_jitter_target(jb);
+	rdpsnd_jitter_free(jb);
+	return TRUE;
+}
+
+static BOOL test_sink(void)
+{
+	RDPSND_JITTER_SINK fixed = { 0 };
+	RDPSND_JITTER_SINK adaptive = { 0 };
+	UINT32 fixedTarget = 0;
+	UINT32 target = 0;
+
+	if (!run_sink(FALSE, &fixed, &fixedTarget) || !run_sink(TRUE, &adaptive, &target))
+		return FALSE;
+
+	const UINT64 fixedDepth = fixed.sumQueuedMs / fixed.blocks;
+	const UINT64 depth = adaptive.sumQueuedMs / adaptive.blocks;
+	printf("sink fixed:    depth avg %" PRIu64 " ms, max %" PRIu32 " ms, underruns %" PRIu64 "\n",
+	       fixedDepth, fixed.maxQueuedMs, fixed.underruns);
+	printf("sink adaptive: depth avg %" PRIu64 " ms, max %" PRIu32 " ms, underruns %" PRIu64
+	       ", target %" PRIu32 " ms\n",
+	       depth, adaptive.maxQueuedMs, adaptive.underruns, target);
+
+	/* Played as it arrives, the sink keeps running dry */
+	if (fixed.underruns < 10)
+		return FALSE;
+
+	/* The silence played first builds up a playout delay that rides out the jitter */
+	if (adaptive.underruns * 10 > fixed.underruns)
+		return FALSE;
+
+	/* The delay is built up to the target, but not far beyond it */
+	if ((depth <= fixedDepth) || (depth + BLOCK_MS < target / 2) || (depth > target + BLOCK_MS))
+		return FALSE;
+
+	return adaptive.maxQueuedMs <= 2 * target + BLOCK_MS;
+}
+
+static BOOL test_shorten(void)
+{
+	const AUDIO_FORMAT format = { WAVE_FORMAT_PCM, 2, 44100, 44100 * 4, 4, 16, 0, NULL };
+	const size_t frames = 882; /* 20 ms */
+	INT16 samples[882 * 2] = { 0 };
+
+	for (size_t x = 0; x < frames; x++)
+	{
+		samples[2 * x] = 1000;
+		samples[2 * x + 1] = -1000;
+	}
+
+	if (rdpsnd_jitter_duration(&format, sizeof(samples)) != 20)
+		return FALSE;
+
+	if (rdpsnd_jitter_is_silent(&format, (BYTE*)samples, sizeof(samples)))
+		return FALSE;
+
+	const size_t size = rdpsnd_jitter_shorten(&format, (BYTE*)samples, sizeof(samples), 5);
+	if (size != (frames - 220) * 4)
+		return FALSE;
+
+	/* A constant signal must stay constant across the cross-fade */
+	for (size_t x = 0; x < size / 4; x++)
+	{
+		if ((samples[2 * x] != 1000) || (samples[2 * x + 1] != -1000))
+			return FALSE;
+	}
+
+	/* Never more than a quarter of the block */
+	if (rdpsnd_jitter_shorten(&format, (BYTE*)samples, size, 1000) != size - (size / 4 / 4) * 4)
+		return FALSE;
+
+	ZeroMemory(samples, sizeof(samples));
+	if (!rdpsnd_jitter_is_silent(&format, (BYTE*)samples, sizeof(samples)))
+		return FALSE;
+
+	wStream* s = Stream_New(NULL, 16);
+	if (!s)
+		return FALSE;
+
+	const size_t silence = rdpsnd_jitter_silence(&format, s, 20);
+	const BOOL rc = (silence == sizeof(samples)) && (rdpsnd_jitter_duration(&format, silence) == 20) &&
+	                rdpsnd_jitter_is_silent(&format, Stream_Buffer(s), silence);
+	Stream_Free(s, TRUE);
+	return rc;
+}
+
+int TestRdpsndJitter(int argc, char* argv[])
+{
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!test_shorten())
+		return -1;
+
+	if (!test_trace())
+		return -2;
+
+	if (!test_sink())
+		return -3;
+
+	return 0;
+}
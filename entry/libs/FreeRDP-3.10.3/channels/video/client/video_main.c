@@ -74,6 +74,7 @@ typedef struct
 	UINT64 startTimeStamp;
 	UINT64 publishOffset;
 	H264_CONTEXT* h264;
+	YUV_CONTEXT* yuv;
 	wStream* currentSample;
 	UINT64 lastPublishTime, nextPublishTime;
 	volatile LONG refCounter;
@@ -86,8 +87,10 @@ typedef struct
 	UINT64 hnsDuration;
 	MAPPED_GEOMETRY* geometry;
 	UINT32 w, h;
-	UINT32 scanline;
-	BYTE* surfaceData;
+	UINT32 yuvHeight;
+	UINT32 iStride[3];
+	const BYTE* pYUVData[3];
+	BYTE* yuvData; /* I420 planes, converted to RGB only if the frame is shown */
 	PresentationContext* presentation;
 } VideoFrame;
 
@@ -211,6 +214,17 @@ static PresentationContext* PresentationContext_new(VideoClientContext* video, B
 	if (!h264_context_reset(ret->h264, width, height))
 		goto fail;
 
+	/* scheduled frames are converted in video_timer, the h264 context converts only the
+	 * frames shown right away */
+	ret->yuv = yuv_context_new(FALSE, 0);
+	if (!ret->yuv)
+	{
+		WLog_ERR(TAG, "unable to create a yuv context");
+		goto fail;
+	}
+	if (!yuv_context_reset(ret->yuv, width, height))
+		goto fail;
+
 	ret->currentSample = Stream_New(NULL, 4096);
 	if (!ret->currentSample)
 	{
@@ -259,6 +273,7 @@ static void PresentationContext_unref(PresentationContext** ppresentation)
 	}
 
 	h264_context_free(presentation->h264);
+	yuv_context_free(presentation->yuv);
 	Stream_Free(presentation->currentSample, TRUE);
 	presentation->video->deleteSurface(presentation->video, presentation->surface);
 	free(presentation);
@@ -279,14 +294,15 @@ static void VideoFrame_free(VideoFrame** pframe)
 	WINPR_ASSERT(frame->presentation);
 	WINPR_ASSERT(frame->presentation->video);
 	WINPR_ASSERT(frame->presentation->video->priv);
-	BufferPool_Return(frame->presentation->video->priv->surfacePool, frame->surfaceData);
+	BufferPool_Return(frame->presentation->video->priv->surfacePool, frame->yuvData);
 	PresentationContext_unref(&frame->presentation);
 	free(frame);
 	*pframe = NULL;
 }
 
 static VideoFrame* VideoFrame_new(VideoClientContextPriv* priv, PresentationContext* presentation,
-                                  MAPPED_GEOMETRY* geom)
+                                  MAPPED_GEOMETRY* geom, const BYTE* pYUVData[3],
+                                  const UINT32 iStride[3], UINT32 yuvHeight)
 {
 	VideoFrame* frame = NULL;
 	const VideoSurface* surface = NULL;
@@ -294,6 +310,8 @@ static VideoFrame* VideoFrame_new(VideoClientContextPriv* priv, PresentationCont
 	WINPR_ASSERT(priv);
 	WINPR_ASSERT(presentation);
 	WINPR_ASSERT(geom);
+	WINPR_ASSERT(pYUVData);
+	WINPR_ASSERT(iStride);
 
 	surface = presentation->surface;
 	WINPR_ASSERT(surface);
@@ -308,12 +326,33 @@ static VideoFrame* VideoFrame_new(VideoClientContextPriv* priv, PresentationCont
 	frame->geometry = geom;
 	frame->w = surface->alignedWidth;
 	frame->h = surface->alignedHeight;
-	frame->scanline = surface->scanline;
 
-	frame->surfaceData = BufferPool_Take(priv->surfacePool, 1ll * frame->scanline * frame->h);
-	if (!frame->surfaceData)
+	/* copy the decoder planes, the decoder reuses them for the next sample */
+	frame->yuvHeight = MIN(yuvHeight, frame->h);
+	const UINT32 widths[3] = { MIN(frame->w, iStride[0]), MIN((frame->w + 1) / 2, iStride[1]),
+		                       MIN((frame->w + 1) / 2, iStride[2]) };
+	const UINT32 heights[3] = { frame->yuvHeight, (frame->yuvHeight + 1) / 2,
+		                        (frame->yuvHeight + 1) / 2 };
+	size_t size = 0;
+	for (size_t x = 0; x < 3; x++)
+	{
+		frame->iStride[x] = widths[x];
+		size += 1ull * widths[x] * heights[x];
+	}
+
+	frame->yuvData = BufferPool_Take(priv->surfacePool, (SSIZE_T)size);
+	if (!frame->yuvData)
 		goto fail;
 
+	BYTE* plane = frame->yuvData;
+	for (size_t x = 0; x < 3; x++)
+	{
+		for (UINT32 y = 0; y < heights[x]; y++)
+			memcpy(&plane[1ull * y * widths[x]], &pYUVData[x][1ull * y * iStride[x]], widths[x]);
+		frame->pYUVData[x] = plane;
+		plane += 1ull * widths[x] * heights[x];
+	}
+
 	frame->presentation = presentation;
 	if (!PresentationContext_ref(frame->presentation))
 		goto fail;
@@ -676,6 +715,7 @@ static UINT video_control_send_client_notification(VideoClientContext* context,
 static void video_timer(VideoClientContext* video, UINT64 now)
 {
 	PresentationContext* presentation = NULL;
+	VideoSurface* surface = NULL;
 	VideoClientContextPriv* priv = NULL;
 	VideoFrame* peekFrame = NULL;
 	VideoFrame* frame = NULL;
@@ -710,13 +750,21 @@ static void video_timer(VideoClientContext* video, UINT64 now)
 		goto treat_feedback;
 
 	presentation = frame->presentation;
+	surface = presentation->surface;
 
-	priv->publishedFrames++;
-	memcpy(presentation->surface->data, frame->surfaceData, 1ull * frame->scanline * frame->h);
+	/* only the frame actually shown is converted, straight into the surface */
+	const RECTANGLE_16 rect = { 0, 0, frame->w, frame->h };
+	if (yuv420_context_decode(presentation->yuv, frame->pYUVData, frame->iStride,
+	                          frame->yuvHeight, surface->format, surface->data, surface->scanline,
+	                          &rect, 1))
+	{
+		priv->publishedFrames++;
 
-	WINPR_ASSERT(video->showSurface);
-	video->showSurface(video, presentation->surface, presentation->ScaledWidth,
-	                   presentation->ScaledHeight);
+		WINPR_ASSERT(video->showSurface);
+		video->showSurface(video, surface, presentation->ScaledWidth, presentation->ScaledHeight);
+	}
+	else
+		WLog_ERR(TAG, "unable to convert frame @%" PRIu64, frame->publishTime);
 
 	VideoFrame_free(&frame);
 
@@ -903,23 +951,24 @@ static UINT video_VideoData(VideoClientContext* context, const TSMM_VIDEO_DATA*
 				return CHANNEL_RC_OK;
 
 			BOOL enqueueResult = 0;
-			VideoFrame* frame = VideoFrame_new(priv, presentation, geom);
+			const BYTE* pYUVData[3] = { 0 };
+			UINT32 iStride[3] = { 0 };
+			UINT32 yuvHeight = 0;
+
+			/* keep the frame in YUV, video_timer converts it if it is not dropped */
+			status = avc420_decompress_yuv(h264, Stream_Pointer(presentation->currentSample),
+			                               (UINT32)len, pYUVData, iStride, &yuvHeight);
+			if (status <= 0)
+				return CHANNEL_RC_OK;
+
+			VideoFrame* frame =
+			    VideoFrame_new(priv, presentation, geom, pYUVData, iStride, yuvHeight);
 			if (!frame)
 			{
 				WLog_ERR(TAG, "unable to create frame");
 				return CHANNEL_RC_NO_MEMORY;
 			}
 
-			status =
-			    avc420_decompress(h264, Stream_Pointer(presentation->currentSample), (UINT32)len,
-			                      frame->surfaceData, surface->format, surface->scanline,
-			                      surface->alignedWidth, surface->alignedHeight, &rect, 1);
-			if (status < 0)
-			{
-				VideoFrame_free(&frame);
-				return CHANNEL_RC_OK;
-			}
-
 			EnterCriticalSection(&priv->framesLock);
 			enqueueResult = Queue_Enqueue(priv->frames, frame);
 			LeaveCriticalSection(&priv->framesLock);
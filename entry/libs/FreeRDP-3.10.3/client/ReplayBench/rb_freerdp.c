@@ -0,0 +1,532 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Stream dump replay benchmark
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#if defined(__GLIBC_PREREQ)
+#if __GLIBC_PREREQ(2, 33)
+#define RB_HAVE_MALLINFO2
+#endif
+#endif
+#endif
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+#include <winpr/crt.h>
+#include <winpr/assert.h>
+#include <winpr/synch.h>
+#include <winpr/sysinfo.h>
+#include <winpr/path.h>
+
+#include <freerdp/freerdp.h>
+#include <freerdp/constants.h>
+#include <freerdp/gdi/gdi.h>
+#include <freerdp/gdi/gfx.h>
+#include <freerdp/streamdump.h>
+#include <freerdp/utils/gfx.h>
+#include <freerdp/client/cmdline.h>
+#include <freerdp/client/channels.h>
+#include <freerdp/channels/channels.h>
+#include <freerdp/log.h>
+
+#include "rb_freerdp.h"
+
+#define TAG CLIENT_TAG("replay-bench")
+
+/* Sample the heap every this many frames, mallinfo2 walks all arenas */
+#define RB_HEAP_SAMPLE_INTERVAL 64
+
+static size_t rb_heap_in_use(void)
+{
+#if defined(RB_HAVE_MALLINFO2)
+	const struct mallinfo2 mi = mallinfo2();
+	return mi.uordblks + mi.hblkhd;
+#else
+	return 0;
+#endif
+}
+
+static size_t g_HeapPeak = 0;
+
+static void rb_sample_heap(const rbContext* rb)
+{
+	WINPR_ASSERT(rb);
+
+	if (((rb->paints + rb->gfxFrames) % RB_HEAP_SAMPLE_INTERVAL) != 0)
+		return;
+
+	const size_t used = rb_heap_in_use();
+	if (used > g_HeapPeak)
+		g_HeapPeak = used;
+}
+
+static rbCodecStats* rb_codec_stats(rbContext* rb, const char* name)
+{
+	WINPR_ASSERT(rb);
+	WINPR_ASSERT(name);
+
+	for (size_t x = 0; x < rb->codecCount; x++)
+	{
+		if (strcmp(rb->codecs[x].name, name) == 0)
+			return &rb->codecs[x];
+	}
+
+	if (rb->codecCount >= ARRAYSIZE(rb->codecs))
+		return NULL;
+
+	rbCodecStats* stats = &rb->codecs[rb->codecCount++];
+	stats->name = name;
+	return stats;
+}
+
+static void rb_codec_account(rbContext* rb, const char* name, size_t bytes, UINT64 ns)
+{
+	rbCodecStats* stats = rb_codec_stats(rb, name);
+	if (!stats)
+		return;
+
+	stats->count++;
+	stats->bytes += bytes;
+	stats->totalNs += ns;
+	if (ns > stats->maxNs)
+		stats->maxNs = ns;
+}
+
+static const char* rb_surface_bits_codec(UINT16 codecID)
+{
+	switch (codecID)
+	{
+		case RDP_CODEC_ID_REMOTEFX:
+		case RDP_CODEC_ID_IMAGE_REMOTEFX:
+			return "RemoteFX (surface bits)";
+		case RDP_CODEC_ID_NSCODEC:
+			return "NSCodec (surface bits)";
+		case RDP_CODEC_ID_NONE:
+			return "uncompressed (surface bits)";
+		default:
+			return "unknown (surface bits)";
+	}
+}
+
+static const char* rb_bitmap_codec(const BITMAP_DATA* bitmap)
+{
+	WINPR_ASSERT(bitmap);
+
+	if (!bitmap->compressed)
+		return "uncompressed (bitmap)";
+	if (bitmap->bitsPerPixel == 32)
+		return "planar (bitmap)";
+	return "interleaved (bitmap)";
+}
+
+static BOOL rb_surface_bits(rdpContext* context, const SURFACE_BITS_COMMAND* cmd)
+{
+	rbContext* rb = (rbContext*)context;
+
+	WINPR_ASSERT(rb);
+	WINPR_ASSERT(cmd);
+
+	const UINT64 start = winpr_GetTickCount64NS();
+	const BOOL rc = IFCALLRESULT(TRUE, rb->SurfaceBits, context, cmd);
+	rb_codec_account(rb, rb_surface_bits_codec(cmd->bmp.codecID), cmd->bmp.bitmapDataLength,
+	                 winpr_GetTickCount64NS() - start);
+	return rc;
+}
+
+static BOOL rb_bitmap_update(rdpContext* context, const BITMAP_UPDATE* bitmap)
+{
+	rbContext* rb = (rbContext*)context;
+
+	WINPR_ASSERT(rb);
+	WINPR_ASSERT(bitmap);
+
+	const UINT64 start = winpr_GetTickCount64NS();
+	const BOOL rc = IFCALLRESULT(TRUE, rb->BitmapUpdate, context, bitmap);
+	const UINT64 ns = winpr_GetTickCount64NS() - start;
+
+	/* An update carries many rectangles, attribute the time by their share of the data */
+	size_t total = 0;
+	for (UINT32 x = 0; x < bitmap->number; x++)
+		total += bitmap->rectangles[x].bitmapLength;
+
+	for (UINT32 x = 0; x < bitmap->number; x++)
+	{
+		const BITMAP_DATA* data = &bitmap->rectangles[x];
+		const UINT64 share =
+		    (total > 0) ? (ns * data->bitmapLength / total) : (ns / bitmap->number);
+		rb_codec_account(rb, rb_bitmap_codec(data), data->bitmapLength, share);
+	}
+	return rc;
+}
+
+static UINT rb_gfx_surface_command(RdpgfxClientContext* context,
+                                   const RDPGFX_SURFACE_COMMAND* cmd)
+{
+	WINPR_ASSERT(context);
+	WINPR_ASSERT(cmd);
+
+	rdpGdi* gdi = (rdpGdi*)context->custom;
+	WINPR_ASSERT(gdi);
+
+	rbContext* rb = (rbContext*)gdi->context;
+	WINPR_ASSERT(rb);
+
+	const UINT64 start = winpr_GetTickCount64NS();
+	const UINT rc = IFCALLRESULT(CHANNEL_RC_OK, rb->SurfaceCommand, context, cmd);
+	rb_codec_account(rb, rdpgfx_get_codec_id_string((UINT16)cmd->codecId), cmd->length,
+	                 winpr_GetTickCount64NS() - start);
+	return rc;
+}
+
+static UINT rb_gfx_end_frame(RdpgfxClientContext* context, const RDPGFX_END_FRAME_PDU* endFrame)
+{
+	WINPR_ASSERT(context);
+
+	rdpGdi* gdi = (rdpGdi*)context->custom;
+	WINPR_ASSERT(gdi);
+
+	rbContext* rb = (rbContext*)gdi->context;
+	WINPR_ASSERT(rb);
+
+	const UINT64 start = winpr_GetTickCount64NS();
+	const UINT rc = IFCALLRESULT(CHANNEL_RC_OK, rb->EndFrame, context, endFrame);
+	rb_codec_account(rb, "composition (gfx end frame)", 0, winpr_GetTickCount64NS() - start);
+
+	rb->gfxFrames++;
+	rb_sample_heap(rb);
+	return rc;
+}
+
+static void rb_OnChannelConnectedEventHandler(void* context, const ChannelConnectedEventArgs* e)
+{
+	rbContext* rb = (rbContext*)context;
+
+	WINPR_ASSERT(rb);
+	WINPR_ASSERT(e);
+
+	freerdp_client_OnChannelConnectedEventHandler(&rb->common, e);
+
+	if (strcmp(e->name, RDPGFX_DVC_CHANNEL_NAME) == 0)
+	{
+		RdpgfxClientContext* gfx = (RdpgfxClientContext*)e->pInterface;
+		WINPR_ASSERT(gfx);
+
+		rb->SurfaceCommand = gfx->SurfaceCommand;
+		rb->EndFrame = gfx->EndFrame;
+		gfx->SurfaceCommand = rb_gfx_surface_command;
+		gfx->EndFrame = rb_gfx_end_frame;
+	}
+}
+
+static void rb_OnChannelDisconnectedEventHandler(void* context,
+                                                 const ChannelDisconnectedEventArgs* e)
+{
+	rbContext* rb = (rbContext*)context;
+
+	WINPR_ASSERT(rb);
+	WINPR_ASSERT(e);
+
+	if (strcmp(e->name, RDPGFX_DVC_CHANNEL_NAME) == 0)
+	{
+		RdpgfxClientContext* gfx = (RdpgfxClientContext*)e->pInterface;
+		WINPR_ASSERT(gfx);
+
+		gfx->SurfaceCommand = rb->SurfaceCommand;
+		gfx->EndFrame = rb->EndFrame;
+	}
+
+	freerdp_client_OnChannelDisconnectedEventHandler(&rb->common, e);
+}
+
+static BOOL rb_begin_paint(rdpContext* context)
+{
+	rdpGdi* gdi = NULL;
+
+	WINPR_ASSERT(context);
+
+	gdi = context->gdi;
+	WINPR_ASSERT(gdi);
+	WINPR_ASSERT(gdi->primary);
+	WINPR_ASSERT(gdi->primary->hdc);
+	WINPR_ASSERT(gdi->primary->hdc->hwnd);
+	WINPR_ASSERT(gdi->primary->hdc->hwnd->invalid);
+	gdi->primary->hdc->hwnd->invalid->null = TRUE;
+	return TRUE;
+}
+
+/* Null output: the frame is composed in the GDI buffer but never shown */
+static BOOL rb_end_paint(rdpContext* context)
+{
+	rbContext* rb = (rbContext*)context;
+
+	WINPR_ASSERT(rb);
+
+	rb->paints++;
+	rb_sample_heap(rb);
+	return TRUE;
+}
+
+static BOOL rb_desktop_resize(rdpContext* context)
+{
+	WINPR_ASSERT(context);
+
+	const rdpSettings* settings = context->settings;
+	WINPR_ASSERT(settings);
+
+	return gdi_resize(context->gdi, freerdp_settings_get_uint32(settings, FreeRDP_DesktopWidth),
+	                  freerdp_settings_get_uint32(settings, FreeRDP_DesktopHeight));
+}
+
+static BOOL rb_pre_connect(freerdp* instance)
+{
+	WINPR_ASSERT(instance);
+	WINPR_ASSERT(instance->context);
+
+	rdpSettings* settings = instance->context->settings;
+	WINPR_ASSERT(settings);
+
+	if (!freerdp_settings_set_uint32(settings, FreeRDP_OsMajorType, OSMAJORTYPE_UNIX))
+		return FALSE;
+	if (!freerdp_settings_set_uint32(settings, FreeRDP_OsMinorType, OSMINORTYPE_NATIVE_XSERVER))
+		return FALSE;
+
+	PubSub_SubscribeChannelConnected(instance->context->pubSub, rb_OnChannelConnectedEventHandler);
+	PubSub_SubscribeChannelDisconnected(instance->context->pubSub,
+	                                    rb_OnChannelDisconnectedEventHandler);
+	return TRUE;
+}
+
+static BOOL rb_post_connect(freerdp* instance)
+{
+	WINPR_ASSERT(instance);
+
+	if (!gdi_init(instance, PIXEL_FORMAT_BGRX32))
+		return FALSE;
+
+	rbContext* rb = (rbContext*)instance->context;
+	WINPR_ASSERT(rb);
+
+	rdpUpdate* update = rb->common.context.update;
+	WINPR_ASSERT(update);
+
+	/* Decoding is what we want to measure */
+	if (!freerdp_settings_set_bool(rb->common.context.settings, FreeRDP_DeactivateClientDecoding,
+	                               FALSE))
+		return FALSE;
+
+	rb->SurfaceBits = update->SurfaceBits;
+	rb->BitmapUpdate = update->BitmapUpdate;
+	update->SurfaceBits = rb_surface_bits;
+	update->BitmapUpdate = rb_bitmap_update;
+	update->BeginPaint = rb_begin_paint;
+	update->EndPaint = rb_end_paint;
+	update->DesktopResize = rb_desktop_resize;
+
+	rb->startNs = winpr_GetTickCount64NS();
+	return TRUE;
+}
+
+static void rb_post_disconnect(freerdp* instance)
+{
+	if (!instance || !instance->context)
+		return;
+
+	rbContext* rb = (rbContext*)instance->context;
+	rb->stopNs = winpr_GetTickCount64NS();
+
+	/* Surfaces and caches are still allocated here */
+	const size_t used = rb_heap_in_use();
+	if (used > g_HeapPeak)
+		g_HeapPeak = used;
+
+	PubSub_UnsubscribeChannelConnected(instance->context->pubSub,
+	                                   rb_OnChannelConnectedEventHandler);
+	PubSub_UnsubscribeChannelDisconnected(instance->context->pubSub,
+	                                      rb_OnChannelDisconnectedEventHandler);
+	gdi_free(instance);
+}
+
+static DWORD rb_client_thread_proc(freerdp* instance)
+{
+	DWORD result = 0;
+	HANDLE handles[MAXIMUM_WAIT_OBJECTS] = { 0 };
+
+	WINPR_ASSERT(instance);
+
+	if (!freerdp_connect(instance))
+	{
+		result = freerdp_get_last_error(instance->context);
+		WLog_ERR(TAG, "replay failed to connect 0x%08" PRIx32, result);
+		return result;
+	}
+
+	while (!freerdp_shall_disconnect_context(instance->context))
+	{
+		const DWORD nCount =
+		    freerdp_get_event_handles(instance->context, handles, ARRAYSIZE(handles));
+
+		if (nCount == 0)
+		{
+			WLog_ERR(TAG, "freerdp_get_event_handles failed");
+			break;
+		}
+
+		const DWORD status = WaitForMultipleObjects(nCount, handles, FALSE, 100);
+
+		if (status == WAIT_FAILED)
+		{
+			WLog_ERR(TAG, "WaitForMultipleObjects failed with %" PRIu32 "", status);
+			break;
+		}
+
+		/* The replay transport fails the read once the dump is exhausted */
+		if (!freerdp_check_event_handles(instance->context))
+			break;
+	}
+
+	freerdp_disconnect(instance);
+	return result;
+}
+
+static void rb_print_report(const rbContext* rb)
+{
+	WINPR_ASSERT(rb);
+
+	const UINT64 elapsedNs =
+	    ((rb->startNs > 0) && (rb->stopNs > rb->startNs)) ? rb->stopNs - rb->startNs : 0;
+	const double seconds = (double)elapsedNs / 1000000000.0;
+	const UINT64 frames = (rb->gfxFrames > 0) ? rb->gfxFrames : rb->paints;
+	const double fps = (seconds > 0.0) ? (double)frames / seconds : 0.0;
+
+	printf("replay: %.3f s, %" PRIu64 " frames, %.1f fps\n", seconds, frames, fps);
+	printf("%-32s %10s %14s %12s %10s %10s\n", "codec", "count", "bytes", "total ms", "avg us",
+	       "max us");
+
+	for (size_t x = 0; x < rb->codecCount; x++)
+	{
+		const rbCodecStats* stats = &rb->codecs[x];
+		const double avg =
+		    (stats->count > 0) ? (double)stats->totalNs / (double)stats->count / 1000.0 : 0.0;
+
+		printf("%-32s %10" PRIu64 " %14" PRIu64 " %12.3f %10.1f %10.1f\n", stats->name,
+		       stats->count, stats->bytes, (double)stats->totalNs / 1000000.0, avg,
+		       (double)stats->maxNs / 1000.0);
+	}
+
+#if defined(RB_HAVE_MALLINFO2)
+	printf("peak heap in use: %" PRIuz " KiB\n", g_HeapPeak / 1024);
+#endif
+
+#if !defined(_WIN32)
+	struct rusage usage = { 0 };
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+	{
+#if defined(__APPLE__)
+		const long maxrss = usage.ru_maxrss / 1024;
+#else
+		const long maxrss = usage.ru_maxrss;
+#endif
+		printf("peak RSS: %ld KiB\n", maxrss);
+	}
+#endif
+}
+
+static BOOL rb_client_new(freerdp* instance, rdpContext* context)
+{
+	if (!instance || !context)
+		return FALSE;
+
+	instance->PreConnect = rb_pre_connect;
+	instance->PostConnect = rb_post_connect;
+	instance->PostDisconnect = rb_post_disconnect;
+	return TRUE;
+}
+
+static int RdpClientEntry(RDP_CLIENT_ENTRY_POINTS* pEntryPoints)
+{
+	WINPR_ASSERT(pEntryPoints);
+
+	ZeroMemory(pEntryPoints, sizeof(RDP_CLIENT_ENTRY_POINTS));
+	pEntryPoints->Version = RDP_CLIENT_INTERFACE_VERSION;
+	pEntryPoints->Size = sizeof(RDP_CLIENT_ENTRY_POINTS_V1);
+	pEntryPoints->ContextSize = sizeof(rbContext);
+	pEntryPoints->ClientNew = rb_client_new;
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	int rc = -1;
+	RDP_CLIENT_ENTRY_POINTS clientEntryPoints = { 0 };
+
+	RdpClientEntry(&clientEntryPoints);
+	rdpContext* context = freerdp_client_context_new(&clientEntryPoints);
+
+	if (!context)
+		goto fail;
+
+	const int status =
+	    freerdp_client_settings_parse_command_line(context->settings, argc, argv, FALSE);
+	if (status)
+	{
+		rc = freerdp_client_settings_command_line_status_print(context->settings, status, argc,
+		                                                       argv);
+		goto fail;
+	}
+
+	const char* recording =
+	    freerdp_settings_get_string(context->settings, FreeRDP_TransportDumpFile);
+	if (!freerdp_settings_get_bool(context->settings, FreeRDP_TransportDumpReplay) || !recording)
+	{
+		WLog_ERR(TAG, "no recording given, use /dump:replay,file:<recording>");
+		goto fail;
+	}
+
+	if (!winpr_PathFileExists(recording))
+	{
+		WLog_ERR(TAG, "recording %s does not exist", recording);
+		goto fail;
+	}
+
+	/* Replay as fast as the client can decode, not at the recorded pace */
+	if (!freerdp_settings_set_bool(context->settings, FreeRDP_TransportDumpReplayNodelay, TRUE))
+		goto fail;
+
+	if (!stream_dump_register_handlers(context, CONNECTION_STATE_MCS_CREATE_REQUEST, FALSE))
+		goto fail;
+
+	if (freerdp_client_start(context) != 0)
+		goto fail;
+
+	rc = (int)rb_client_thread_proc(context->instance);
+
+	if (freerdp_client_stop(context) != 0)
+		rc = -1;
+
+	rb_print_report((rbContext*)context);
+
+fail:
+	freerdp_client_context_free(context);
+	return rc;
+}
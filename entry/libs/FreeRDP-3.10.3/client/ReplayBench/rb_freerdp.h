@@ -0,0 +1,54 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Stream dump replay benchmark
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_CLIENT_REPLAY_BENCH_H
+#define FREERDP_CLIENT_REPLAY_BENCH_H
+
+#include <freerdp/freerdp.h>
+#include <freerdp/client/rdpgfx.h>
+
+#define RB_MAX_CODECS 16
+
+typedef struct
+{
+	const char* name;
+	UINT64 count;
+	UINT64 bytes;
+	UINT64 totalNs;
+	UINT64 maxNs;
+} rbCodecStats;
+
+typedef struct
+{
+	rdpClientContext common;
+
+	/* Original callbacks, the benchmark wraps them to take the time */
+	pSurfaceBits SurfaceBits;
+	pBitmapUpdate BitmapUpdate;
+	pcRdpgfxSurfaceCommand SurfaceCommand;
+	pcRdpgfxEndFrame EndFrame;
+
+	UINT64 startNs;
+	UINT64 stopNs;
+	UINT64 paints;
+	UINT64 gfxFrames;
+
+	size_t codecCount;
+	rbCodecStats codecs[RB_MAX_CODECS];
+} rbContext;
+
+#endif /* FREERDP_CLIENT_REPLAY_BENCH_H */
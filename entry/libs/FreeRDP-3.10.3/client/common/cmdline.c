@@ -2146,6 +2146,24 @@ static int parse_tls_secrets_file(rdpSettings* settings, const char* Value)
 	return 0;
 }
 
+static int parse_tls_session_cache(rdpSettings* settings, const char* Value)
+{
+	if (!Value)
+		return COMMAND_LINE_ERROR_UNEXPECTED_VALUE;
+
+	if (option_equals(Value, "off"))
+	{
+		if (!freerdp_settings_set_bool(settings, FreeRDP_TlsSessionResumption, FALSE))
+			return COMMAND_LINE_ERROR;
+		return 0;
+	}
+
+	if (!freerdp_settings_set_bool(settings, FreeRDP_TlsSessionResumption, TRUE) ||
+	    !freerdp_settings_set_string(settings, FreeRDP_TlsSessionCacheFile, Value))
+		return COMMAND_LINE_ERROR_MEMORY;
+	return 0;
+}
+
 static int parse_tls_enforce(rdpSettings* settings, const char* Value)
 {
 	UINT16 version = TLS1_2_VERSION;
@@ -2196,6 +2214,8 @@ static int parse_tls_cipher_options(rdpSettings* settings, const COMMAND_LINE_AR
 			rc = parse_tls_secrets_file(settings, &arg->Value[13]);
 		else if (option_starts_with("enforce:", arg->Value))
 			rc = parse_tls_enforce(settings, &arg->Value[8]);
+		else if (option_starts_with("session-cache:", arg->Value))
+			rc = parse_tls_session_cache(settings, &arg->Value[14]);
 	}
 
 #if defined(WITH_FREERDP_DEPRECATED_COMMANDLINE)
@@ -3898,6 +3918,16 @@ static int parse_cache_options(rdpSettings* settings, const COMMAND_LINE_ARGUMEN
 			else if (!freerdp_settings_set_bool(settings, FreeRDP_BitmapCachePersistEnabled, TRUE))
 				rc = COMMAND_LINE_ERROR;
 		}
+		else if (option_starts_with("persist-max-size:", val))
+		{
+			ULONGLONG size = 0;
+
+			if (!value_to_uint(&val[17], &size, 0, UINT32_MAX))
+				rc = COMMAND_LINE_ERROR_UNEXPECTED_VALUE;
+			else if (!freerdp_settings_set_uint32(settings, FreeRDP_BitmapCachePersistMaxSize,
+			                                      (UINT32)size))
+				rc = COMMAND_LINE_ERROR;
+		}
 		else
 		{
 			const PARSE_ON_OFF_RESULT bval = parse_on_off_option(val);
@@ -86,7 +86,7 @@ static const COMMAND_LINE_ARGUMENT_A global_cmd_args[] = {
 	  NULL, "Print the build configuration" },
 	{ "cache", COMMAND_LINE_VALUE_REQUIRED,
 	  "[bitmap[:on|off],codec[:rfx|nsc],glyph[:on|off],offscreen[:on|off],persist,persist-file:<"
-	  "filename>]",
+	  "filename>,persist-max-size:<bytes>]",
 	  NULL, NULL, -1, NULL, "" },
 	{ "cert", COMMAND_LINE_VALUE_REQUIRED,
 	  "[deny,ignore,name:<name>,tofu,fingerprint:<hash>:<hash as hex>[,fingerprint:<hash>:<another "
@@ -465,13 +465,15 @@ static const COMMAND_LINE_ARGUMENT_A global_cmd_args[] = {
 	{ "timezone", COMMAND_LINE_VALUE_REQUIRED, "<windows timezone>", NULL, NULL, -1, NULL,
 	  "Use supplied windows timezone for connection (requires server support), see /list:timezones "
 	  "for allowed values" },
-	{ "tls", COMMAND_LINE_VALUE_REQUIRED, "[ciphers|seclevel|secrets-file|enforce]", NULL, NULL, -1,
-	  NULL,
+	{ "tls", COMMAND_LINE_VALUE_REQUIRED,
+	  "[ciphers|seclevel|secrets-file|session-cache|enforce]", NULL, NULL, -1, NULL,
 	  "TLS configuration options:"
 	  " * ciphers:[netmon|ma|<cipher names>]\n"
 	  " * seclevel:<level>, default: 1, range: [0-5] Override the default TLS security level, "
 	  "might be required for older target servers\n"
 	  " * secrets-file:<filename>\n"
+	  " * session-cache:[off|<filename>] TLS sessions are resumed on reconnect by default, "
+	  "disable that or keep the sessions in <filename> across client restarts\n"
 	  " * enforce[:[ssl3|1.0|1.1|1.2|1.3]] Force use of SSL/TLS version for a connection. Some "
 	  "servers have a buggy TLS "
 	  "version negotiation and might fail without this. Defaults to TLS 1.2 if no argument is "
@@ -66,6 +66,15 @@ option(WITH_SAMPLE "Build sample code" ON)
 option(WITH_CLIENT_COMMON "Build client common library" ON)
 cmake_dependent_option(WITH_CLIENT "Build client binaries" ON "WITH_CLIENT_COMMON" OFF)
 cmake_dependent_option(WITH_CLIENT_SDL "[experimental] Build SDL client " ON "WITH_CLIENT" OFF)
+cmake_dependent_option(
+  WITH_CLIENT_REPLAY_BENCH "Build freerdp-replay-bench, a headless stream dump replay benchmark" ON
+  "WITH_CLIENT;NOT WIN32" OFF
+)
+
+cmake_dependent_option(
+  WITH_PRIMITIVES_TOOLS "Build freerdp-primitives-tune, shows the tuned primitives table" ON "NOT IOS;NOT ANDROID"
+  OFF
+)
 
 option(WITH_SERVER "Build server binaries" ON)
 
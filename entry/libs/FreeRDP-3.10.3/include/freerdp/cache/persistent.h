@@ -84,6 +84,17 @@ extern "C"
 	FREERDP_API int persistent_cache_write_entry(rdpPersistentCache* persistent,
 	                                             const PERSISTENT_CACHE_ENTRY* entry);
 
+	/** \brief Read entry \b index of a cache opened for reading
+	 *
+	 *  \b entry->data is read only and stays valid until the next read or until the cache is
+	 *  closed.
+	 *
+	 *  \return \b 1 on success, a negative value if the entry does not exist or is damaged
+	 *  \since version 3.11.0
+	 */
+	FREERDP_API int persistent_cache_get_entry(rdpPersistentCache* persistent, size_t index,
+	                                           PERSISTENT_CACHE_ENTRY* entry);
+
 	FREERDP_API int persistent_cache_open(rdpPersistentCache* persistent, const char* filename,
 	                                      BOOL write, UINT32 version);
 	FREERDP_API int persistent_cache_close(rdpPersistentCache* persistent);
@@ -115,6 +115,10 @@ extern "C"
 	typedef UINT (*pcRdpgfxQoeFrameAcknowledge)(
 	    RdpgfxClientContext* context, const RDPGFX_QOE_FRAME_ACKNOWLEDGE_PDU* qoeFrameAcknowledge);
 
+	typedef UINT (*pcRdpgfxSavePersistentCache)(RdpgfxClientContext* context);
+	typedef UINT32 (*pcRdpgfxFrameQueueDepth)(RdpgfxClientContext* context, UINT32 frameId,
+	                                          UINT32 frameTime);
+
 	typedef UINT (*pcRdpgfxMapWindowForSurface)(RdpgfxClientContext* context, UINT16 surfaceID,
 	                                            UINT64 windowID);
 	typedef UINT (*pcRdpgfxUnmapWindowForSurface)(RdpgfxClientContext* context, UINT64 windowID);
@@ -175,6 +179,15 @@ extern "C"
 		CRITICAL_SECTION mux;
 		rdpCodecs* codecs;
 		PROFILER_DEFINE(SurfaceProfiler)
+
+		/* Writes the cache slots to FreeRDP_BitmapCachePersistFile while the channel is open,
+		 * a reconnect offers them in its cache import offer. Takes the lock. */
+		pcRdpgfxSavePersistentCache SavePersistentCache; /** @since version 3.11.0 */
+
+		/* Asked for the queueDepth of a frame acknowledge, frameTime is the time in ms from the
+		 * StartFrame to the end of the EndFrame of that frame. Returns QUEUE_DEPTH_UNAVAILABLE
+		 * to leave the pacing to the server. No locking required. */
+		pcRdpgfxFrameQueueDepth FrameQueueDepth; /** @since version 3.11.0 */
 	};
 
 	FREERDP_API void rdpgfx_client_context_free(RdpgfxClientContext* context);
@@ -21,6 +21,7 @@
 #define FREERDP_CODEC_H264_H
 
 #include <winpr/wlog.h>
+#include <winpr/pool.h>
 
 #include <freerdp/api.h>
 #include <freerdp/types.h>
@@ -69,6 +70,16 @@ extern "C"
 	                                         UINT32 value);
 	FREERDP_API UINT32 h264_context_get_option(H264_CONTEXT* h264, H264_CONTEXT_OPTION option);
 
+	/** @brief Run the color conversion of a context on a shared thread pool
+	 *
+	 *  @param h264 The h264 context
+	 *  @param pcbe The callback environment of the pool, \b NULL for the private pool
+	 *  @return \b TRUE for success, \b FALSE for an error
+	 *  @since version 3.11.0
+	 */
+	FREERDP_API BOOL h264_context_set_callback_environment(H264_CONTEXT* h264,
+	                                                       PTP_CALLBACK_ENVIRON pcbe);
+
 	FREERDP_API INT32 avc420_compress(H264_CONTEXT* h264, const BYTE* pSrcData, DWORD SrcFormat,
 	                                  UINT32 nSrcStep, UINT32 nSrcWidth, UINT32 nSrcHeight,
 	                                  const RECTANGLE_16* regionRect, BYTE** ppDstData,
@@ -104,6 +115,24 @@ extern "C"
 	                                    UINT32 nDstWidth, UINT32 nDstHeight,
 	                                    const RECTANGLE_16* regionRects, UINT32 numRegionRect);
 
+	/** @brief Decode an AVC420 sample without the color conversion
+	 *
+	 *  The planes belong to the decoder and are only valid until the next call with \b h264.
+	 *
+	 *  @param h264 The h264 decoder context
+	 *  @param pSrcData The AVC420 sample
+	 *  @param SrcSize The size of the sample in bytes
+	 *  @param pYUVData A pointer to hold the I420 planes of the decoded picture
+	 *  @param iStride A pointer to hold the byte length of a line in the planes
+	 *  @param pYUVHeight A pointer to hold the number of luma lines
+	 *  @return \b 1 for a new picture, \b 0 if the sample did not complete a picture, \b <0 for
+	 *  an error
+	 *  @since version 3.11.0
+	 */
+	FREERDP_API INT32 avc420_decompress_yuv(H264_CONTEXT* h264, const BYTE* pSrcData,
+	                                        UINT32 SrcSize, const BYTE* pYUVData[3],
+	                                        UINT32 iStride[3], UINT32* pYUVHeight);
+
 	FREERDP_API INT32 avc444_compress(H264_CONTEXT* h264, const BYTE* pSrcData, DWORD SrcFormat,
 	                                  UINT32 nSrcStep, UINT32 nSrcWidth, UINT32 nSrcHeight,
 	                                  BYTE version, const RECTANGLE_16* regionRect, BYTE* op,
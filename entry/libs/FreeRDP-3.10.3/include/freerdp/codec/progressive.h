@@ -61,6 +61,43 @@ extern "C"
 
 	FREERDP_API BOOL progressive_context_reset(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive);
 
+	/** Encode in progressive passes limited to a per frame budget
+	 *
+	 *  Changed tiles are sent as coarse first pass, budget left in a frame is spent on upgrade
+	 *  passes of static tiles until they reach full quality.
+	 *  @param progressive The progressive codec context, must be a compressor
+	 *  @param bytesPerFrame The budget of a \b progressive_compress call, \b 0 disables passes
+	 *
+	 *  @since version 3.11.0
+	 *  @return \b TRUE in case of success, \b FALSE for any error
+	 */
+	FREERDP_API BOOL
+	progressive_compress_set_bandwidth(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+	                                   UINT32 bytesPerFrame);
+
+	/** Check if tiles sent earlier are still below full quality
+	 *
+	 *  While this is \b TRUE a \b progressive_compress call with an empty region sends upgrades.
+	 *  @param progressive The progressive codec context
+	 *
+	 *  @since version 3.11.0
+	 *  @return \b TRUE if upgrade passes are pending
+	 */
+	FREERDP_API BOOL
+	progressive_compress_has_upgrades(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive);
+
+	/** Run the tile work of a context on a shared thread pool
+	 *  Forward wrapper for \link rfx_context_set_callback_environment
+	 *  @param progressive The progressive codec context
+	 *  @param pcbe The callback environment of the pool, \b NULL for the private pool
+	 *
+	 *  @since version 3.11.0
+	 *  @return \b TRUE in case of success, \b FALSE for any error
+	 */
+	FREERDP_API BOOL
+	progressive_context_set_callback_environment(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+	                                             PTP_CALLBACK_ENVIRON pcbe);
+
 	FREERDP_API void progressive_context_free(PROGRESSIVE_CONTEXT* progressive);
 
 	WINPR_ATTR_MALLOC(progressive_context_free, 1)
@@ -120,6 +120,21 @@ extern "C"
 	FREERDP_API BOOL region16_union_rect(REGION16* dst, const REGION16* src,
 	                                     const RECTANGLE_16* rect);
 
+	/** adds an array of rectangles in src and stores the resulting region in dst
+	 *
+	 * The rectangles are merged in a single sweep, which is much cheaper than calling
+	 * region16_union_rect() for each of them when accumulating many small (tile) rectangles.
+	 *
+	 * @param dst destination region, may be src
+	 * @param src source region
+	 * @param rects the rectangles to add, empty ones are ignored
+	 * @param count the number of rectangles in rects
+	 * @return if the operation was successful (false meaning out-of-memory)
+	 * @since version 3.11.0
+	 */
+	FREERDP_API BOOL region16_union_rects(REGION16* dst, const REGION16* src,
+	                                      const RECTANGLE_16* rects, UINT32 count);
+
 	/** returns if a rectangle intersects the region
 	 * @param src the region
 	 * @param arg2 the rectangle
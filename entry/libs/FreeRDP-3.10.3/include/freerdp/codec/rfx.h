@@ -28,6 +28,7 @@
 #include <freerdp/codec/region.h>
 
 #include <winpr/stream.h>
+#include <winpr/pool.h>
 
 #ifdef __cplusplus
 extern "C"
@@ -135,6 +136,31 @@ extern "C"
 	 */
 	FREERDP_API RLGR_MODE rfx_context_get_mode(RFX_CONTEXT* WINPR_RESTRICT context);
 
+	/** Select the RLGR entropy coder, the encoder for encoder contexts and the decoder otherwise
+	 *  @param context The RFX context
+	 *  @param enable \b TRUE for the word based implementation (default), \b FALSE for the bit by
+	 *  bit reference implementation. Both produce the same output.
+	 *
+	 *  @since version 3.11.0
+	 *
+	 *  @return \b TRUE in case of success, \b FALSE if \b context is \b NULL
+	 */
+	FREERDP_API BOOL rfx_context_set_fast_rlgr(RFX_CONTEXT* WINPR_RESTRICT context, BOOL enable);
+
+	/** Run the tile work of a context on a shared thread pool
+	 *
+	 *  Without a callback environment the context creates a private pool on first use.
+	 *  @param context The RFX context
+	 *  @param pcbe The callback environment of the pool, \b NULL for the private pool. It must
+	 *  outlive the context.
+	 *
+	 *  @since version 3.11.0
+	 *
+	 *  @return \b TRUE in case of success, \b FALSE if \b context is \b NULL
+	 */
+	FREERDP_API BOOL rfx_context_set_callback_environment(RFX_CONTEXT* WINPR_RESTRICT context,
+	                                                      PTP_CALLBACK_ENVIRON pcbe);
+
 	FREERDP_API void rfx_context_set_pixel_format(RFX_CONTEXT* WINPR_RESTRICT context,
 	                                              UINT32 pixel_format);
 
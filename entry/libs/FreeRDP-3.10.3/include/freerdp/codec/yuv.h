@@ -24,6 +24,8 @@
 #include <freerdp/types.h>
 #include <freerdp/constants.h>
 
+#include <winpr/pool.h>
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -58,6 +60,19 @@ extern "C"
 	FREERDP_API BOOL yuv_context_reset(YUV_CONTEXT* WINPR_RESTRICT context, UINT32 width,
 	                                   UINT32 height);
 
+	/** Run the conversion work of a context on a shared thread pool
+	 *
+	 *  Without a callback environment the context creates a private pool on first use.
+	 *  @param context The YUV context
+	 *  @param pcbe The callback environment of the pool, \b NULL for the private pool. It must
+	 *  outlive the context.
+	 *
+	 *  @since version 3.11.0
+	 *  @return \b TRUE in case of success, \b FALSE if \b context is \b NULL
+	 */
+	FREERDP_API BOOL yuv_context_set_callback_environment(YUV_CONTEXT* WINPR_RESTRICT context,
+	                                                      PTP_CALLBACK_ENVIRON pcbe);
+
 	FREERDP_API void yuv_context_free(YUV_CONTEXT* context);
 
 	WINPR_ATTR_MALLOC(yuv_context_free, 1)
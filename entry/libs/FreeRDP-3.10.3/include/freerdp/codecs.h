@@ -63,6 +63,8 @@ extern "C"
 		PROGRESSIVE_CONTEXT* progressive;
 		BITMAP_PLANAR_CONTEXT* planar;
 		BITMAP_INTERLEAVED_CONTEXT* interleaved;
+
+		PTP_CALLBACK_ENVIRON CallbackEnvironment; /** @since version 3.11.0 */
 	};
 	typedef struct rdp_codecs rdpCodecs;
 
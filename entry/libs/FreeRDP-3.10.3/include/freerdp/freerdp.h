@@ -731,6 +731,57 @@ owned by rdpRdp */
 	 */
 	FREERDP_API BOOL freerdp_is_active_state(const rdpContext* context);
 
+	/** \brief Time spent in the phases of the last client connection sequence, in nanoseconds.
+	 *
+	 *  Phases that were not part of the connection (e.g. NLA with RDP security) are \b 0
+	 */
+	typedef struct
+	{
+		UINT64 tcpNs;
+		UINT64 tlsNs;
+		UINT64 nlaNs;
+		UINT64 licensingNs;
+		UINT64 capabilitiesNs;
+		UINT64 totalNs;
+		BOOL tlsResumed; /** The TLS handshake resumed a cached session */
+	} rdpConnectTimings;
+
+	/** \brief returns the connect time breakdown of the last connection of the context.
+	 *
+	 *  \param context A pointer to the context to query
+	 *  \param timings A pointer to the structure receiving the timings
+	 *
+	 *  \return \b TRUE if the last connection reached the active state, \b FALSE otherwise
+	 *  \since version 3.10.3
+	 */
+	FREERDP_API BOOL freerdp_get_connect_timings(const rdpContext* context,
+	                                             rdpConnectTimings* timings);
+
+	/** \brief Reuse of the persistent bitmap cache file by bitmap cache v2 orders */
+	typedef struct
+	{
+		UINT32 loadedEntries;  /** Entries of the file advertised to the server */
+		UINT32 persistentHits; /** Cache slots filled from the file instead of the network */
+		UINT32 cacheOrders;    /** Bitmaps the server sent in cache orders */
+		UINT32 savedEntries;   /** Entries written by the last completed flush */
+		UINT64 savedBytes;     /** Size of the file written by the last completed flush */
+		BOOL flushPending;     /** The file is still being written in the background */
+	} rdpBitmapCacheStats;
+
+	/** \brief returns the persistent bitmap cache statistics of the last connection.
+	 *
+	 *  The file is written in the background when the bitmap cache is freed, the saved
+	 *  counters are updated once that is done.
+	 *
+	 *  \param context A pointer to the context to query
+	 *  \param stats A pointer to the structure receiving the statistics
+	 *
+	 *  \return \b TRUE on success, \b FALSE otherwise
+	 *  \since version 3.11.0
+	 */
+	FREERDP_API BOOL freerdp_get_bitmap_cache_stats(const rdpContext* context,
+	                                                rdpBitmapCacheStats* stats);
+
 	FREERDP_API BOOL freerdp_channels_from_mcs(rdpSettings* settings, const rdpContext* context);
 
 	FREERDP_API BOOL freerdp_is_valid_mcs_create_request(const BYTE* data, size_t size);
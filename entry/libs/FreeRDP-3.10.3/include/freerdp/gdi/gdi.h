@@ -446,12 +446,16 @@ extern "C"
 	} GDI_BRUSH;
 	typedef GDI_BRUSH* HGDI_BRUSH;
 
+	typedef struct S_GDI_INVALID_GRID GDI_INVALID_GRID;
+	typedef struct S_GDI_GLYPH_ATLAS GDI_GLYPH_ATLAS;
+
 	typedef struct
 	{
 		UINT32 count;
 		INT32 ninvalid;
 		HGDI_RGN invalid;
 		HGDI_RGN cinvalid;
+		GDI_INVALID_GRID* grid; /**< @since version 3.11.0, if set used instead of cinvalid */
 	} GDI_WND;
 	typedef GDI_WND* HGDI_WND;
 
@@ -521,6 +525,11 @@ extern "C"
 		GeometryClientContext* geometry;
 
 		wLog* log;
+
+		UINT32 invalidTileSize;         /**< @since version 3.11.0 */
+		UINT32 invalidFullFramePercent; /**< @since version 3.11.0 */
+		GDI_GLYPH_ATLAS* glyphs;        /**< @since version 3.11.0 */
+		RECTANGLE_16 viewport;          /**< @since version 3.11.0 */
 	};
 	typedef struct rdp_gdi rdpGdi;
 
@@ -541,6 +550,37 @@ extern "C"
 
 	FREERDP_API BOOL gdi_send_suppress_output(rdpGdi* gdi, BOOL suppress);
 
+	/** @brief Track the invalid area of the primary surface in a tile grid
+	 *
+	 *  Drawing marks tiles in \b GDI_WND::grid instead of appending to \b GDI_WND::cinvalid,
+	 *  read the merged rectangles with gdi_invalid_grid_rects() in EndPaint.
+	 *
+	 *  @param gdi The GDI to configure, the setting survives gdi_resize()
+	 *  @param tileSize The tile size in pixels, 0 to go back to the cinvalid list
+	 *  @param fullFramePercent Report the whole surface once this percentage of tiles is dirty,
+	 *  0 to always report the dirty tiles
+	 *
+	 *  @return \b TRUE for success, \b FALSE otherwise
+	 *  @since version 3.11.0
+	 */
+	FREERDP_API BOOL gdi_set_invalid_tiles(rdpGdi* gdi, UINT32 tileSize, UINT32 fullFramePercent);
+
+	/** @brief Limit graphics pipeline output to the visible part of the desktop
+	 *
+	 *  Surface updates out of view are not converted into the primary surface, uncompressed and
+	 *  planar commands are not even decoded. They are brought up to date once the area scrolls
+	 *  into the viewport or another command reads it, until then the primary surface is stale
+	 *  outside the viewport.
+	 *
+	 *  @param gdi The GDI to configure
+	 *  @param viewport The visible area in desktop coordinates with exclusive right and bottom,
+	 *  \b NULL or an empty rectangle makes the whole desktop visible
+	 *
+	 *  @return \b TRUE for success, \b FALSE otherwise
+	 *  @since version 3.11.0
+	 */
+	FREERDP_API BOOL gdi_set_viewport(rdpGdi* gdi, const RECTANGLE_16* viewport);
+
 #ifdef __cplusplus
 }
 #endif
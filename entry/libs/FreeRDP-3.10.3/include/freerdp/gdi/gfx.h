@@ -28,6 +28,11 @@ extern "C"
 {
 #endif
 
+	/** @brief Surface updates kept back while out of the client viewport
+	 *  @since version 3.11.0
+	 */
+	typedef struct gdi_gfx_deferred gdiGfxDeferred;
+
 	struct gdi_gfx_surface
 	{
 		UINT16 surfaceId;
@@ -49,6 +54,7 @@ extern "C"
 		UINT32 outputTargetHeight;
 		BOOL windowMapped;
 		BOOL handleInUpdateSurfaceArea;
+		gdiGfxDeferred* deferred; /**< @since version 3.11.0 */
 	};
 	typedef struct gdi_gfx_surface gdiGfxSurface;
 
@@ -57,6 +57,38 @@ extern "C"
 	FREERDP_API BOOL gdi_PtInRect(const HGDI_RECT rc, INT32 x, INT32 y);
 	FREERDP_API BOOL gdi_InvalidateRegion(HGDI_DC hdc, INT32 x, INT32 y, INT32 w, INT32 h);
 
+	/** @brief Allocate a grid tracking invalid tiles of a \b width x \b height surface
+	 *  @since version 3.11.0
+	 */
+	FREERDP_API GDI_INVALID_GRID* gdi_invalid_grid_new(UINT32 width, UINT32 height,
+	                                                   UINT32 tileSize);
+	FREERDP_API void gdi_invalid_grid_free(GDI_INVALID_GRID* grid);
+
+	/** @brief Report the whole surface once \b percent of the tiles are dirty, 0 disables
+	 *  @since version 3.11.0
+	 */
+	FREERDP_API void gdi_invalid_grid_set_full_frame(GDI_INVALID_GRID* grid, UINT32 percent);
+
+	/** @brief Mark the tiles touched by a rectangle, the rectangle is clipped to the surface
+	 *  @since version 3.11.0
+	 */
+	FREERDP_API BOOL gdi_invalid_grid_add(GDI_INVALID_GRID* grid, INT32 x, INT32 y, INT32 w,
+	                                      INT32 h);
+	FREERDP_API void gdi_invalid_grid_clear(GDI_INVALID_GRID* grid);
+	FREERDP_API BOOL gdi_invalid_grid_is_empty(const GDI_INVALID_GRID* grid);
+
+	/** @brief The dirty tiles merged into rectangles
+	 *
+	 *  Runs of tiles in a row are joined and identical runs of consecutive rows are stacked.
+	 *  The array is owned by the grid and valid until the next modification.
+	 *
+	 *  @param grid The grid to read
+	 *  @param count Receives the number of rectangles
+	 *  @return The rectangles, clipped to the surface
+	 *  @since version 3.11.0
+	 */
+	FREERDP_API const GDI_RGN* gdi_invalid_grid_rects(GDI_INVALID_GRID* grid, UINT32* count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -274,6 +274,29 @@ typedef enum
 	FREERDP_API BOOL primitives_init(primitives_t* p, primitive_hints hints);
 	FREERDP_API void primitives_uninit(void);
 
+	/** @brief Set the file the result of \b PRIMITIVES_AUTODETECT is cached in
+	 *
+	 *  The cache is keyed by CPU model and build, later runs on the same machine skip
+	 *  benchmarking. Must be called before the first \b primitives_get to take effect.
+	 *  The default is \b FREERDP_PRIMITIVES_PROFILE from the environment, without either
+	 *  nothing is cached.
+	 *
+	 *  @param path The profile file, \b NULL disables the cache
+	 *  @return \b TRUE for success, \b FALSE otherwise
+	 *  @since version 3.11.0
+	 */
+	FREERDP_API BOOL primitives_set_profile_path(const char* path);
+
+	/** @brief Benchmark every primitive of all available backends and combine the fastest
+	 *
+	 *  @param p The table to fill
+	 *  @param force Benchmark even if the profile holds a result for this CPU and build
+	 *  @param report Optional, receives a text table of the selection, free with \b free
+	 *  @return \b TRUE for success, \b FALSE otherwise
+	 *  @since version 3.11.0
+	 */
+	FREERDP_API BOOL primitives_autotune(primitives_t* p, BOOL force, char** report);
+
 #ifdef __cplusplus
 }
 #endif
@@ -174,6 +174,7 @@ extern "C"
 		freerdp_listener* listener;
 
 		size_t maxClientsConnected;
+		UINT32 progressiveBandwidth; /* bytes per progressive frame, 0 sends full quality tiles */
 	};
 
 	struct rdp_shadow_surface
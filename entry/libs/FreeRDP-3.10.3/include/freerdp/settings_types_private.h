@@ -80,9 +80,12 @@ struct rdp_settings
 		                                                         */
 	UINT64 padding0064[64 - 31];                                /* 31 */
 	/* resource management related options */
-	SETTINGS_DEPRECATED(ALIGN64 UINT32 ThreadingFlags); /* 64 */
+	SETTINGS_DEPRECATED(ALIGN64 UINT32 ThreadingFlags);         /* 64 */
+	SETTINGS_DEPRECATED(ALIGN64 void* CodecCallbackEnvironment); /** 65
+	                                                             * @since version 3.11.0
+	                                                             */
 
-	UINT64 padding0128[128 - 65]; /* 65 */
+	UINT64 padding0128[128 - 66]; /* 66 */
 
 	/**
 	 * GCC User Data Blocks
@@ -286,7 +289,9 @@ struct rdp_settings
 	SETTINGS_DEPRECATED(ALIGN64 BOOL AadSecurity);                  /* 1112 */
 	SETTINGS_DEPRECATED(ALIGN64 char* WinSCardModule);              /* 1113 */
 	SETTINGS_DEPRECATED(ALIGN64 BOOL RemoteCredentialGuard);        /* 1114 */
-	UINT64 padding1152[1152 - 1115];                                /* 1115 */
+	SETTINGS_DEPRECATED(ALIGN64 BOOL TlsSessionResumption);         /* 1115 */
+	SETTINGS_DEPRECATED(ALIGN64 char* TlsSessionCacheFile);         /* 1116 */
+	UINT64 padding1152[1152 - 1117];                                /* 1117 */
 
 	/* Connection Cookie */
 	SETTINGS_DEPRECATED(ALIGN64 BOOL MstscCookieMode);      /* 1152 */
@@ -579,7 +584,8 @@ struct rdp_settings
 	SETTINGS_DEPRECATED(ALIGN64 UINT32 BitmapCacheV2NumCells);                     /* 2501 */
 	SETTINGS_DEPRECATED(ALIGN64 BITMAP_CACHE_V2_CELL_INFO* BitmapCacheV2CellInfo); /* 2502 */
 	SETTINGS_DEPRECATED(ALIGN64 char* BitmapCachePersistFile);                     /* 2503 */
-	UINT64 padding2560[2560 - 2504];                                               /* 2504 */
+	SETTINGS_DEPRECATED(ALIGN64 UINT32 BitmapCachePersistMaxSize);                 /* 2504 */
+	UINT64 padding2560[2560 - 2505];                                               /* 2505 */
 
 	/* Pointer Capabilities */
 	SETTINGS_DEPRECATED(ALIGN64 UINT32 ColorPointerCacheSize); /* 2560 */
@@ -22,7 +22,9 @@
 #include <stdio.h>
 
 #include <winpr/crt.h>
+#include <winpr/file.h>
 #include <winpr/assert.h>
+#include <winpr/thread.h>
 
 #include <freerdp/freerdp.h>
 #include <freerdp/constants.h>
@@ -33,16 +35,56 @@
 
 #include "../gdi/gdi.h"
 #include "../core/graphics.h"
+#include "../core/rdp.h"
 
 #include "bitmap.h"
 #include "cache.h"
 
 #define TAG FREERDP_TAG("cache.bitmap")
 
+/* v2 entries keep the cell they were saved from in the otherwise unused upper flag bits */
+#define BITMAP_CACHE_PERSISTENT_FLAGS 0x00000011
+#define BITMAP_CACHE_PERSISTENT_CELL_SHIFT 8
+#define BITMAP_CACHE_PERSISTENT_DATA_SIZE 0x4000
+#define BITMAP_CACHE_PERSISTENT_ENTRY_SIZE \
+	(sizeof(PERSISTENT_CACHE_ENTRY_V2) + BITMAP_CACHE_PERSISTENT_DATA_SIZE)
+
+typedef struct
+{
+	UINT64 key64;
+	UINT32 width;
+	UINT32 height;
+	UINT32 cell;
+	UINT32 entry; /* file entry + 1 if the data is still in the old file */
+	UINT64 used;
+	rdpBitmap* bitmap;
+	BYTE* data;
+} BITMAP_PERSISTENT_ITEM;
+
+typedef struct
+{
+	char* filename;
+	rdpPersistentCache* source;
+	BITMAP_PERSISTENT_ITEM* items;
+	size_t count;
+	rdpRdp* rdp;
+} BITMAP_PERSISTENT_FLUSH;
+
+static rdpBitmap* bitmap_cache_lookup(rdpBitmapCache* bitmapCache, UINT32 id, UINT32 index,
+                                      BOOL load);
 static rdpBitmap* bitmap_cache_get(rdpBitmapCache* bitmapCache, UINT32 id, UINT32 index);
 static BOOL bitmap_cache_put(rdpBitmapCache* bitmapCache, UINT32 id, UINT32 index,
                              rdpBitmap* bitmap);
 
+static void bitmap_cache_count(rdpBitmapCache* bitmapCache, UINT32* counter)
+{
+	rdpRdp* rdp = bitmapCache->context->rdp;
+
+	EnterCriticalSection(&rdp->bitmapCacheStatsLock);
+	(*counter)++;
+	LeaveCriticalSection(&rdp->bitmapCacheStatsLock);
+}
+
 static BOOL update_gdi_memblt(rdpContext* context, MEMBLT_ORDER* memblt)
 {
 	rdpBitmap* bitmap = NULL;
@@ -125,7 +167,8 @@ static BOOL update_gdi_cache_bitmap(rdpContext* context, const CACHE_BITMAP_ORDE
 		return FALSE;
 	}
 
-	prevBitmap = bitmap_cache_get(cache->bitmap, cacheBitmap->cacheId, cacheBitmap->cacheIndex);
+	prevBitmap =
+	    bitmap_cache_lookup(cache->bitmap, cacheBitmap->cacheId, cacheBitmap->cacheIndex, FALSE);
 	Bitmap_Free(context, prevBitmap);
 	return bitmap_cache_put(cache->bitmap, cacheBitmap->cacheId, cacheBitmap->cacheIndex, bitmap);
 }
@@ -158,7 +201,8 @@ static BOOL update_gdi_cache_bitmap_v2(rdpContext* context, CACHE_BITMAP_V2_ORDE
 	                        cacheBitmapV2->compressed, RDP_CODEC_ID_NONE))
 		goto fail;
 
-	prevBitmap = bitmap_cache_get(cache->bitmap, cacheBitmapV2->cacheId, cacheBitmapV2->cacheIndex);
+	prevBitmap = bitmap_cache_lookup(cache->bitmap, cacheBitmapV2->cacheId,
+	                                 cacheBitmapV2->cacheIndex, FALSE);
 
 	if (!bitmap->New(context, bitmap))
 		goto fail;
@@ -202,7 +246,8 @@ static BOOL update_gdi_cache_bitmap_v3(rdpContext* context, CACHE_BITMAP_V3_ORDE
 	if (!bitmap->New(context, bitmap))
 		goto fail;
 
-	prevBitmap = bitmap_cache_get(cache->bitmap, cacheBitmapV3->cacheId, cacheBitmapV3->cacheIndex);
+	prevBitmap = bitmap_cache_lookup(cache->bitmap, cacheBitmapV3->cacheId,
+	                                 cacheBitmapV3->cacheIndex, FALSE);
 	Bitmap_Free(context, prevBitmap);
 	return bitmap_cache_put(cache->bitmap, cacheBitmapV3->cacheId, cacheBitmapV3->cacheIndex,
 	                        bitmap);
@@ -212,7 +257,58 @@ fail:
 	return FALSE;
 }
 
+/* Fills a slot advertised in the persistent key list from the file when it is first used */
+static rdpBitmap* bitmap_cache_load_persistent(rdpBitmapCache* bitmapCache, UINT32 id,
+                                               UINT32 index)
+{
+	PERSISTENT_CACHE_ENTRY entry = { 0 };
+	rdpContext* context = bitmapCache->context;
+	BITMAP_V2_SLOT* slot = &bitmapCache->slots[id][index];
+	const UINT32 fileEntry = slot->entry - 1;
+
+	/* a damaged entry is not tried again */
+	slot->entry = 0;
+
+	if (persistent_cache_get_entry(bitmapCache->persistent, fileEntry, &entry) < 1)
+	{
+		WLog_WARN(TAG, "persistent bitmap cache entry %" PRIu32 " is damaged", fileEntry);
+		return NULL;
+	}
+
+	rdpBitmap* bitmap = Bitmap_Alloc(context);
+
+	if (!bitmap)
+		return NULL;
+
+	Bitmap_SetDimensions(bitmap, entry.width, entry.height);
+	bitmap->key64 = entry.key64;
+	bitmap->format = context->gdi->dstFormat;
+	bitmap->length = entry.size;
+	bitmap->data = winpr_aligned_malloc(entry.size, 16);
+
+	if (!bitmap->data)
+		goto fail;
+
+	memcpy(bitmap->data, entry.data, entry.size);
+
+	if (!bitmap->New(context, bitmap))
+		goto fail;
+
+	bitmapCache->cells[id].entries[index] = bitmap;
+	bitmap_cache_count(bitmapCache, &bitmapCache->stats->persistentHits);
+	return bitmap;
+
+fail:
+	Bitmap_Free(context, bitmap);
+	return NULL;
+}
+
 rdpBitmap* bitmap_cache_get(rdpBitmapCache* bitmapCache, UINT32 id, UINT32 index)
+{
+	return bitmap_cache_lookup(bitmapCache, id, index, TRUE);
+}
+
+rdpBitmap* bitmap_cache_lookup(rdpBitmapCache* bitmapCache, UINT32 id, UINT32 index, BOOL load)
 {
 	rdpBitmap* bitmap = NULL;
 
@@ -233,12 +329,23 @@ rdpBitmap* bitmap_cache_get(rdpBitmapCache* bitmapCache, UINT32 id, UINT32 index
 	}
 
 	bitmap = bitmapCache->cells[id].entries[index];
+
+	if (load && bitmapCache->slots)
+	{
+		BITMAP_V2_SLOT* slot = &bitmapCache->slots[id][index];
+
+		if (!bitmap && slot->entry)
+			bitmap = bitmap_cache_load_persistent(bitmapCache, id, index);
+
+		slot->used = ++bitmapCache->useCount;
+	}
+
 	return bitmap;
 }
 
 BOOL bitmap_cache_put(rdpBitmapCache* bitmapCache, UINT32 id, UINT32 index, rdpBitmap* bitmap)
 {
-	if (id > bitmapCache->maxCells)
+	if (id >= bitmapCache->maxCells)
 	{
 		WLog_ERR(TAG, "put invalid bitmap cell id: %" PRIu32 "", id);
 		return FALSE;
@@ -255,6 +362,15 @@ BOOL bitmap_cache_put(rdpBitmapCache* bitmapCache, UINT32 id, UINT32 index, rdpB
 	}
 
 	bitmapCache->cells[id].entries[index] = bitmap;
+
+	if (bitmapCache->slots)
+	{
+		BITMAP_V2_SLOT* slot = &bitmapCache->slots[id][index];
+		slot->entry = 0;
+		slot->used = ++bitmapCache->useCount;
+	}
+
+	bitmap_cache_count(bitmapCache, &bitmapCache->stats->cacheOrders);
 	return TRUE;
 }
 
@@ -282,71 +398,425 @@ void bitmap_cache_register_callbacks(rdpUpdate* update)
 	}
 }
 
-static int bitmap_cache_save_persistent(rdpBitmapCache* bitmapCache)
+void bitmap_cache_persistent_keys_free(BITMAP_PERSISTENT_KEYS* keys)
 {
-	rdpContext* context = bitmapCache->context;
-	rdpSettings* settings = context->settings;
+	if (!keys)
+		return;
 
-	const UINT32 version = freerdp_settings_get_uint32(settings, FreeRDP_BitmapCacheVersion);
+	free(keys->keys);
+	free(keys->entries);
+	memset(keys, 0, sizeof(BITMAP_PERSISTENT_KEYS));
+}
+
+static UINT32 bitmap_cache_persistent_cell(const PERSISTENT_CACHE_ENTRY* entry, UINT32 cells)
+{
+	const UINT32 saved = (entry->flags >> BITMAP_CACHE_PERSISTENT_CELL_SHIFT) & 0xFF;
 
-	if (version != 2)
-		return 0; /* persistent bitmap cache already saved in egfx channel */
+	if ((saved > 0) && (saved <= cells))
+		return saved - 1;
+
+	/* files written elsewhere: cells 0 and 1 hold up to 256 and 1024 pixels, the others 4096 */
+	const UINT32 pixels = 1u * entry->width * entry->height;
+	UINT32 cell = 2;
+
+	if (pixels <= 256)
+		cell = 0;
+	else if (pixels <= 1024)
+		cell = 1;
+
+	return MIN(cell, cells - 1);
+}
+
+rdpPersistentCache* bitmap_cache_persistent_load(const rdpSettings* settings,
+                                                 BITMAP_PERSISTENT_KEYS* keys)
+{
+	UINT32 start[ARRAYSIZE(keys->count)] = { 0 };
+	UINT32* cells = NULL;
+
+	WINPR_ASSERT(settings);
+	WINPR_ASSERT(keys);
+	memset(keys, 0, sizeof(BITMAP_PERSISTENT_KEYS));
 
 	if (!freerdp_settings_get_bool(settings, FreeRDP_BitmapCachePersistEnabled))
-		return 0;
+		return NULL;
 
 	const char* BitmapCachePersistFile =
 	    freerdp_settings_get_string(settings, FreeRDP_BitmapCachePersistFile);
 	if (!BitmapCachePersistFile)
-		return 0;
+		return NULL;
+
+	const UINT32 numCells =
+	    MIN(freerdp_settings_get_uint32(settings, FreeRDP_BitmapCacheV2NumCells),
+	        ARRAYSIZE(keys->count));
+	if (numCells == 0)
+		return NULL;
 
 	rdpPersistentCache* persistent = persistent_cache_new();
 
 	if (!persistent)
-		return -1;
+		return NULL;
 
-	int status = persistent_cache_open(persistent, BitmapCachePersistFile, TRUE, version);
+	/* version 3 files belong to the graphics pipeline */
+	if ((persistent_cache_open(persistent, BitmapCachePersistFile, FALSE, 2) < 1) ||
+	    (persistent_cache_get_version(persistent) != 2))
+		goto fail;
 
-	if (status < 1)
-		goto end;
+	keys->keys = (UINT64*)calloc(BITMAP_CACHE_PERSISTENT_MAX_KEYS, sizeof(UINT64));
+	keys->entries = (UINT32*)calloc(BITMAP_CACHE_PERSISTENT_MAX_KEYS, sizeof(UINT32));
+	cells = (UINT32*)calloc(BITMAP_CACHE_PERSISTENT_MAX_KEYS, sizeof(UINT32));
 
-	if (bitmapCache->cells)
+	if (!keys->keys || !keys->entries || !cells)
+		goto fail;
+
+	/* the file is ordered by last use, the first entries that fit their cell win */
+	const int count = persistent_cache_get_count(persistent);
+	UINT32 total = 0;
+
+	for (int index = 0; (index < count) && (total < BITMAP_CACHE_PERSISTENT_MAX_KEYS); index++)
 	{
-		for (UINT32 i = 0; i < bitmapCache->maxCells; i++)
+		PERSISTENT_CACHE_ENTRY entry = { 0 };
+
+		if (persistent_cache_get_entry(persistent, (size_t)index, &entry) < 1)
+			continue;
+
+		if (!entry.key64 || !entry.width || !entry.height)
+			continue;
+
+		const UINT32 cell = bitmap_cache_persistent_cell(&entry, numCells);
+		const BITMAP_CACHE_V2_CELL_INFO* info =
+		    freerdp_settings_get_pointer_array(settings, FreeRDP_BitmapCacheV2CellInfo, cell);
+
+		if (!info || (keys->count[cell] >= MIN(info->numEntries, UINT16_MAX)))
+			continue;
+
+		keys->keys[total] = entry.key64;
+		keys->entries[total] = (UINT32)index;
+		cells[total] = cell;
+		keys->count[cell]++;
+		total++;
+	}
+
+	for (size_t cell = 1; cell < ARRAYSIZE(start); cell++)
+		start[cell] = start[cell - 1] + keys->count[cell - 1];
+
+	{
+		UINT64* sortedKeys = (UINT64*)calloc(BITMAP_CACHE_PERSISTENT_MAX_KEYS, sizeof(UINT64));
+		UINT32* sortedEntries = (UINT32*)calloc(BITMAP_CACHE_PERSISTENT_MAX_KEYS, sizeof(UINT32));
+
+		if (!sortedKeys || !sortedEntries)
 		{
-			BITMAP_V2_CELL* cell = &bitmapCache->cells[i];
-			for (UINT32 j = 0; j < cell->number + 1 && cell->entries; j++)
-			{
-				PERSISTENT_CACHE_ENTRY cacheEntry;
-				rdpBitmap* bitmap = cell->entries[j];
+			free(sortedKeys);
+			free(sortedEntries);
+			goto fail;
+		}
 
-				if (!bitmap || !bitmap->key64)
-					continue;
+		for (UINT32 x = 0; x < total; x++)
+		{
+			const UINT32 pos = start[cells[x]]++;
+			sortedKeys[pos] = keys->keys[x];
+			sortedEntries[pos] = keys->entries[x];
+		}
+
+		free(keys->keys);
+		free(keys->entries);
+		keys->keys = sortedKeys;
+		keys->entries = sortedEntries;
+	}
+
+	keys->total = total;
+	free(cells);
+	return persistent;
+
+fail:
+	free(cells);
+	bitmap_cache_persistent_keys_free(keys);
+	persistent_cache_free(persistent);
+	return NULL;
+}
+
+static BOOL bitmap_cache_persistent_init(rdpBitmapCache* bitmapCache)
+{
+	BITMAP_PERSISTENT_KEYS keys = { 0 };
+	rdpContext* context = bitmapCache->context;
+	rdpSettings* settings = context->settings;
+	rdpRdp* rdp = context->rdp;
+
+	WINPR_ASSERT(rdp);
+	EnterCriticalSection(&rdp->bitmapCacheStatsLock);
+	bitmapCache->stats = &rdp->bitmapCacheStats;
+	bitmapCache->stats->loadedEntries = 0;
+	bitmapCache->stats->persistentHits = 0;
+	bitmapCache->stats->cacheOrders = 0;
+	LeaveCriticalSection(&rdp->bitmapCacheStatsLock);
+
+	if (!freerdp_settings_get_bool(settings, FreeRDP_BitmapCachePersistEnabled) ||
+	    !freerdp_settings_get_string(settings, FreeRDP_BitmapCachePersistFile))
+		return TRUE;
+
+	/* entries are stored in the 32 bpp format of the gdi */
+	if (!context->gdi || (FreeRDPGetBytesPerPixel(context->gdi->dstFormat) != 4))
+		return TRUE;
+
+	bitmapCache->slots = (BITMAP_V2_SLOT**)calloc(bitmapCache->maxCells, sizeof(BITMAP_V2_SLOT*));
 
-				cacheEntry.key64 = bitmap->key64;
-				cacheEntry.width = bitmap->width;
-				cacheEntry.height = bitmap->height;
-				const UINT64 size = 4ULL * bitmap->width * bitmap->height;
-				if (size > UINT32_MAX)
+	if (!bitmapCache->slots)
+		return FALSE;
+
+	for (UINT32 i = 0; i < bitmapCache->maxCells; i++)
+	{
+		bitmapCache->slots[i] =
+		    (BITMAP_V2_SLOT*)calloc(bitmapCache->cells[i].number + 1ull, sizeof(BITMAP_V2_SLOT));
+
+		if (!bitmapCache->slots[i])
+			return FALSE;
+	}
+
+	rdp_wait_bitmap_cache_flush(rdp);
+	bitmapCache->persistent = bitmap_cache_persistent_load(settings, &keys);
+
+	UINT32 pos = 0;
+	for (UINT32 i = 0; i < ARRAYSIZE(keys.count); i++)
+	{
+		for (UINT32 j = 0; j < keys.count[i]; j++, pos++)
+		{
+			if ((i < bitmapCache->maxCells) && (j < bitmapCache->cells[i].number))
+				bitmapCache->slots[i][j].entry = keys.entries[pos] + 1;
+		}
+	}
+
+	EnterCriticalSection(&rdp->bitmapCacheStatsLock);
+	bitmapCache->stats->loadedEntries = keys.total;
+	LeaveCriticalSection(&rdp->bitmapCacheStatsLock);
+	WLog_DBG(TAG, "persistent bitmap cache: %" PRIu32 " entries advertised", keys.total);
+	bitmap_cache_persistent_keys_free(&keys);
+	return TRUE;
+}
+
+static int bitmap_cache_persistent_compare(const void* pa, const void* pb)
+{
+	const BITMAP_PERSISTENT_ITEM* a = pa;
+	const BITMAP_PERSISTENT_ITEM* b = pb;
+
+	if (a->used != b->used)
+		return (a->used > b->used) ? -1 : 1;
+
+	/* unused entries of the old file keep their order */
+	if (a->entry != b->entry)
+		return (a->entry < b->entry) ? -1 : 1;
+
+	return 0;
+}
+
+static void bitmap_cache_persistent_flush_free(BITMAP_PERSISTENT_FLUSH* flush)
+{
+	if (!flush)
+		return;
+
+	if (flush->items)
+	{
+		for (size_t x = 0; x < flush->count; x++)
+			winpr_aligned_free(flush->items[x].data);
+	}
+
+	persistent_cache_free(flush->source);
+	free(flush->items);
+	free(flush->filename);
+	free(flush);
+}
+
+static DWORD WINAPI bitmap_cache_persistent_flush_thread(LPVOID arg)
+{
+	char tmp[MAX_PATH] = { 0 };
+	BOOL rc = FALSE;
+	UINT32 saved = 0;
+	BITMAP_PERSISTENT_FLUSH* flush = arg;
+	rdpPersistentCache* persistent = NULL;
+
+	WINPR_ASSERT(flush);
+
+	if (_snprintf(tmp, sizeof(tmp), "%s.tmp", flush->filename) >= (int)sizeof(tmp))
+		goto out;
+
+	persistent = persistent_cache_new();
+
+	if (!persistent || (persistent_cache_open(persistent, tmp, TRUE, 2) < 1))
+	{
+		WLog_WARN(TAG, "failed to write persistent bitmap cache %s", tmp);
+		goto out;
+	}
+
+	rc = TRUE;
+	for (size_t x = 0; x < flush->count; x++)
+	{
+		const BITMAP_PERSISTENT_ITEM* item = &flush->items[x];
+		PERSISTENT_CACHE_ENTRY entry = { 0 };
+
+		if (item->data)
+		{
+			entry.key64 = item->key64;
+			entry.width = (UINT16)item->width;
+			entry.height = (UINT16)item->height;
+			entry.size = 4u * item->width * item->height;
+			entry.data = item->data;
+		}
+		else if (!flush->source ||
+		         (persistent_cache_get_entry(flush->source, item->entry - 1, &entry) < 1))
+			continue;
+
+		entry.flags = BITMAP_CACHE_PERSISTENT_FLAGS |
+		              ((item->cell + 1) << BITMAP_CACHE_PERSISTENT_CELL_SHIFT);
+
+		if (persistent_cache_write_entry(persistent, &entry) < 1)
+		{
+			rc = FALSE;
+			break;
+		}
+
+		saved++;
+	}
+
+	persistent_cache_free(persistent);
+	persistent = NULL;
+
+	/* the old file is still mapped by the source */
+	persistent_cache_free(flush->source);
+	flush->source = NULL;
+
+	if (!rc || !MoveFileExA(tmp, flush->filename, MOVEFILE_REPLACE_EXISTING))
+	{
+		WLog_WARN(TAG, "failed to update persistent bitmap cache %s", flush->filename);
+		(void)DeleteFileA(tmp);
+		saved = 0;
+	}
+
+	WLog_DBG(TAG, "persistent bitmap cache: %" PRIu32 " entries saved", saved);
+
+out:
+	EnterCriticalSection(&flush->rdp->bitmapCacheStatsLock);
+	flush->rdp->bitmapCacheStats.savedEntries = saved;
+	flush->rdp->bitmapCacheStats.savedBytes = 1ull * saved * BITMAP_CACHE_PERSISTENT_ENTRY_SIZE;
+	flush->rdp->bitmapCacheStats.flushPending = FALSE;
+	LeaveCriticalSection(&flush->rdp->bitmapCacheStatsLock);
+
+	persistent_cache_free(persistent);
+	bitmap_cache_persistent_flush_free(flush);
+	return 0;
+}
+
+/* Snapshot the cache before it is freed and write the file in the background, most recently
+ * used entries first and no more than the server accepts in a key list or the budget allows */
+static void bitmap_cache_persistent_flush(rdpBitmapCache* bitmapCache)
+{
+	rdpContext* context = bitmapCache->context;
+	rdpSettings* settings = context->settings;
+	rdpRdp* rdp = context->rdp;
+	BITMAP_PERSISTENT_FLUSH* flush = NULL;
+	size_t total = 0;
+
+	if (!bitmapCache->slots || !bitmapCache->cells)
+		return;
+
+	if (freerdp_settings_get_uint32(settings, FreeRDP_BitmapCacheVersion) != 2)
+		return; /* persistent bitmap cache already saved in egfx channel */
+
+	/* nothing changed, this also keeps the file of graphics pipeline sessions */
+	if ((bitmapCache->stats->cacheOrders == 0) && (bitmapCache->stats->persistentHits == 0))
+		return;
+
+	flush = (BITMAP_PERSISTENT_FLUSH*)calloc(1, sizeof(BITMAP_PERSISTENT_FLUSH));
+
+	if (!flush)
+		return;
+
+	flush->rdp = rdp;
+	flush->filename =
+	    _strdup(freerdp_settings_get_string(settings, FreeRDP_BitmapCachePersistFile));
+
+	for (UINT32 i = 0; i < bitmapCache->maxCells; i++)
+		total += bitmapCache->cells[i].number;
+
+	flush->items = (BITMAP_PERSISTENT_ITEM*)calloc(MAX(total, 1), sizeof(BITMAP_PERSISTENT_ITEM));
+
+	if (!flush->filename || !flush->items)
+		goto fail;
+
+	for (UINT32 i = 0; i < bitmapCache->maxCells; i++)
+	{
+		const BITMAP_V2_CELL* cell = &bitmapCache->cells[i];
+
+		/* the waiting list entry can not be advertised */
+		for (UINT32 j = 0; j < cell->number; j++)
+		{
+			const BITMAP_V2_SLOT* slot = &bitmapCache->slots[i][j];
+			rdpBitmap* bitmap = cell->entries[j];
+			BITMAP_PERSISTENT_ITEM* item = &flush->items[flush->count];
+
+			if (bitmap)
+			{
+				if (!bitmap->key64 || !bitmap->data ||
+				    (FreeRDPGetBytesPerPixel(bitmap->format) != 4) || (bitmap->width == 0) ||
+				    (bitmap->height == 0) ||
+				    (4ull * bitmap->width * bitmap->height > BITMAP_CACHE_PERSISTENT_DATA_SIZE))
 					continue;
-				cacheEntry.size = (UINT32)size;
-				cacheEntry.flags = 0;
-				cacheEntry.data = bitmap->data;
-
-				if (persistent_cache_write_entry(persistent, &cacheEntry) < 1)
-				{
-					status = -1;
-					goto end;
-				}
+
+				item->key64 = bitmap->key64;
+				item->width = bitmap->width;
+				item->height = bitmap->height;
+				item->bitmap = bitmap;
 			}
+			else if (!slot->entry)
+				continue;
+
+			item->cell = i;
+			item->entry = slot->entry;
+			item->used = slot->used;
+			flush->count++;
 		}
 	}
 
-	status = 1;
+	qsort(flush->items, flush->count, sizeof(BITMAP_PERSISTENT_ITEM),
+	      bitmap_cache_persistent_compare);
 
-end:
-	persistent_cache_free(persistent);
-	return status;
+	size_t limit = BITMAP_CACHE_PERSISTENT_MAX_KEYS;
+	const UINT32 budget = freerdp_settings_get_uint32(settings, FreeRDP_BitmapCachePersistMaxSize);
+
+	if (budget > 0)
+		limit = MIN(limit, budget / BITMAP_CACHE_PERSISTENT_ENTRY_SIZE);
+
+	flush->count = MIN(flush->count, limit);
+
+	/* the cache is about to be freed, take over the bitmap data instead of copying it */
+	for (size_t x = 0; x < flush->count; x++)
+	{
+		BITMAP_PERSISTENT_ITEM* item = &flush->items[x];
+
+		if (!item->bitmap)
+			continue;
+
+		item->data = item->bitmap->data;
+		item->bitmap->data = NULL;
+		item->bitmap = NULL;
+	}
+
+	flush->source = bitmapCache->persistent;
+	bitmapCache->persistent = NULL;
+
+	rdp_wait_bitmap_cache_flush(rdp);
+	EnterCriticalSection(&rdp->bitmapCacheStatsLock);
+	rdp->bitmapCacheStats.savedEntries = 0;
+	rdp->bitmapCacheStats.savedBytes = 0;
+	rdp->bitmapCacheStats.flushPending = TRUE;
+	LeaveCriticalSection(&rdp->bitmapCacheStatsLock);
+	rdp->bitmapCacheFlush =
+	    CreateThread(NULL, 0, bitmap_cache_persistent_flush_thread, flush, 0, NULL);
+
+	if (!rdp->bitmapCacheFlush)
+		bitmap_cache_persistent_flush_thread(flush);
+
+	return;
+
+fail:
+	bitmap_cache_persistent_flush_free(flush);
 }
 
 rdpBitmapCache* bitmap_cache_new(rdpContext* context)
@@ -387,6 +857,9 @@ rdpBitmapCache* bitmap_cache_new(rdpContext* context)
 		cell->number = nr;
 	}
 
+	if (!bitmap_cache_persistent_init(bitmapCache))
+		goto fail;
+
 	return bitmapCache;
 fail:
 	WINPR_PRAGMA_DIAG_PUSH
@@ -401,7 +874,7 @@ void bitmap_cache_free(rdpBitmapCache* bitmapCache)
 	if (!bitmapCache)
 		return;
 
-	bitmap_cache_save_persistent(bitmapCache);
+	bitmap_cache_persistent_flush(bitmapCache);
 
 	if (bitmapCache->cells)
 	{
@@ -425,6 +898,14 @@ void bitmap_cache_free(rdpBitmapCache* bitmapCache)
 		free(bitmapCache->cells);
 	}
 
+	if (bitmapCache->slots)
+	{
+		for (UINT32 i = 0; i < bitmapCache->maxCells; i++)
+			free(bitmapCache->slots[i]);
+
+		free((void*)bitmapCache->slots);
+	}
+
 	persistent_cache_free(bitmapCache->persistent);
 
 	free(bitmapCache);
@@ -21,16 +21,36 @@
 #define FREERDP_LIB_CACHE_BITMAP_H
 
 #include <freerdp/api.h>
+#include <freerdp/freerdp.h>
 #include <freerdp/update.h>
 
 #include <freerdp/cache/persistent.h>
 
+/* MS-RDPBCGR recommends sending no more than 169 entries at once, in practice sending more than
+ * 2042 entries in a single persistent key list PDU triggers an error */
+#define BITMAP_CACHE_PERSISTENT_MAX_KEYS 2042
+
 typedef struct
 {
 	UINT32 number;
 	rdpBitmap** entries;
 } BITMAP_V2_CELL;
 
+typedef struct
+{
+	UINT32 entry; /* persistent cache file entry + 1 while the slot was not loaded yet */
+	UINT64 used;  /* last use, the most recently used slots are saved first */
+} BITMAP_V2_SLOT;
+
+/* Keys of the persistent cache file advertised to the server, grouped by cell */
+typedef struct
+{
+	UINT32 count[5];
+	UINT32 total;
+	UINT64* keys;
+	UINT32* entries; /* file entry of every key */
+} BITMAP_PERSISTENT_KEYS;
+
 typedef struct
 {
 	pMemBlt MemBlt;               /* 0 */
@@ -48,6 +68,9 @@ typedef struct
 	/* internal */
 	rdpContext* context;
 	rdpPersistentCache* persistent;
+	BITMAP_V2_SLOT** slots; /* per cell, only allocated with a persistent cache file */
+	UINT64 useCount;
+	rdpBitmapCacheStats* stats;
 } rdpBitmapCache;
 
 #ifdef __cplusplus
@@ -57,6 +80,14 @@ extern "C"
 
 	FREERDP_LOCAL void bitmap_cache_register_callbacks(rdpUpdate* update);
 
+	FREERDP_LOCAL void bitmap_cache_persistent_keys_free(BITMAP_PERSISTENT_KEYS* keys);
+
+	/* Assigns the entries of the persistent cache file to cell slots, the key list sent to the
+	 * server and the bitmap cache must agree on that. Returns the opened file or NULL if there
+	 * are no keys. */
+	FREERDP_LOCAL rdpPersistentCache* bitmap_cache_persistent_load(const rdpSettings* settings,
+	                                                               BITMAP_PERSISTENT_KEYS* keys);
+
 	FREERDP_LOCAL void bitmap_cache_free(rdpBitmapCache* bitmap_cache);
 
 	WINPR_ATTR_MALLOC(bitmap_cache_free, 1)
@@ -28,6 +28,12 @@
 
 #include <freerdp/cache/persistent.h>
 
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
+#define PERSISTENT_CACHE_V2_DATA_SIZE 0x4000
+
 struct rdp_persistent_cache
 {
 	FILE* fp;
@@ -37,6 +43,13 @@ struct rdp_persistent_cache
 	char* filename;
 	BYTE* bmpData;
 	UINT32 bmpSize;
+
+	/* read mode: offset of every entry header, the next entry read and the file mapping */
+	INT64* offsets;
+	size_t offsetsSize;
+	size_t next;
+	INT64 fileSize;
+	BYTE* map;
 };
 
 static const char sig_str[] = "RDP8bmp";
@@ -53,7 +66,83 @@ int persistent_cache_get_count(rdpPersistentCache* persistent)
 	return persistent->count;
 }
 
-static int persistent_cache_read_entry_v2(rdpPersistentCache* persistent,
+static BOOL persistent_cache_read_at(rdpPersistentCache* persistent, INT64 offset, void* data,
+                                     size_t length)
+{
+	WINPR_ASSERT(persistent);
+
+	if ((offset < 0) || (offset > persistent->fileSize) ||
+	    (length > (UINT64)(persistent->fileSize - offset)))
+		return FALSE;
+
+	if (persistent->map)
+	{
+		memcpy(data, &persistent->map[offset], length);
+		return TRUE;
+	}
+
+	if (_fseeki64(persistent->fp, offset, SEEK_SET) != 0)
+		return FALSE;
+	return fread(data, length, 1, persistent->fp) == 1;
+}
+
+/* Points entry->data at \b size bytes of bitmap data at \b offset, inside the mapping if any */
+static BOOL persistent_cache_read_data(rdpPersistentCache* persistent, INT64 offset, UINT32 size,
+                                      PERSISTENT_CACHE_ENTRY* entry)
+{
+	WINPR_ASSERT(persistent);
+	WINPR_ASSERT(entry);
+
+	if ((offset < 0) || (offset > persistent->fileSize) ||
+	    (size > (UINT64)(persistent->fileSize - offset)))
+		return FALSE;
+
+	if (persistent->map)
+	{
+		entry->data = &persistent->map[offset];
+		return TRUE;
+	}
+
+	if (size > persistent->bmpSize)
+	{
+		BYTE* bmpData =
+		    (BYTE*)winpr_aligned_recalloc(persistent->bmpData, size, sizeof(BYTE), 32);
+
+		if (!bmpData)
+			return FALSE;
+
+		persistent->bmpData = bmpData;
+		persistent->bmpSize = size;
+	}
+
+	entry->data = persistent->bmpData;
+	return persistent_cache_read_at(persistent, offset, entry->data, size);
+}
+
+static BOOL persistent_cache_add_offset(rdpPersistentCache* persistent, INT64 offset)
+{
+	WINPR_ASSERT(persistent);
+
+	if (persistent->count >= INT32_MAX)
+		return FALSE;
+
+	if ((size_t)persistent->count >= persistent->offsetsSize)
+	{
+		const size_t size = MAX(64, persistent->offsetsSize * 2);
+		INT64* offsets = (INT64*)realloc(persistent->offsets, size * sizeof(INT64));
+
+		if (!offsets)
+			return FALSE;
+
+		persistent->offsets = offsets;
+		persistent->offsetsSize = size;
+	}
+
+	persistent->offsets[persistent->count++] = offset;
+	return TRUE;
+}
+
+static int persistent_cache_read_entry_v2(rdpPersistentCache* persistent, INT64 offset,
                                           PERSISTENT_CACHE_ENTRY* entry)
 {
 	PERSISTENT_CACHE_ENTRY_V2 entry2 = { 0 };
@@ -61,18 +150,20 @@ static int persistent_cache_read_entry_v2(rdpPersistentCache* persistent,
 	WINPR_ASSERT(persistent);
 	WINPR_ASSERT(entry);
 
-	if (fread((void*)&entry2, sizeof(entry2), 1, persistent->fp) != 1)
+	if (!persistent_cache_read_at(persistent, offset, &entry2, sizeof(entry2)))
+		return -1;
+
+	const UINT32 size = 4u * entry2.width * entry2.height;
+	if (size > PERSISTENT_CACHE_V2_DATA_SIZE)
 		return -1;
 
 	entry->key64 = entry2.key64;
 	entry->width = entry2.width;
 	entry->height = entry2.height;
-	entry->size = entry2.width * entry2.height * 4;
+	entry->size = size;
 	entry->flags = entry2.flags;
 
-	entry->data = persistent->bmpData;
-
-	if (fread((void*)entry->data, 0x4000, 1, persistent->fp) != 1)
+	if (!persistent_cache_read_data(persistent, offset + (INT64)sizeof(entry2), size, entry))
 		return -1;
 
 	return 1;
@@ -85,6 +176,11 @@ static int persistent_cache_write_entry_v2(rdpPersistentCache* persistent,
 
 	WINPR_ASSERT(persistent);
 	WINPR_ASSERT(entry);
+
+	/* entries have a fixed size, anything larger would shift all following entries */
+	if (entry->size > PERSISTENT_CACHE_V2_DATA_SIZE)
+		return -1;
+
 	entry2.key64 = entry->key64;
 	entry2.width = entry->width;
 	entry2.height = entry->height;
@@ -100,9 +196,9 @@ static int persistent_cache_write_entry_v2(rdpPersistentCache* persistent,
 	if (fwrite(entry->data, entry->size, 1, persistent->fp) != 1)
 		return -1;
 
-	if (0x4000 > entry->size)
+	if (PERSISTENT_CACHE_V2_DATA_SIZE > entry->size)
 	{
-		const size_t padding = 0x4000 - entry->size;
+		const size_t padding = PERSISTENT_CACHE_V2_DATA_SIZE - entry->size;
 
 		if (fwrite(persistent->bmpData, padding, 1, persistent->fp) != 1)
 			return -1;
@@ -115,24 +211,19 @@ static int persistent_cache_write_entry_v2(rdpPersistentCache* persistent,
 
 static int persistent_cache_read_v2(rdpPersistentCache* persistent)
 {
+	const INT64 stride = sizeof(PERSISTENT_CACHE_ENTRY_V2) + PERSISTENT_CACHE_V2_DATA_SIZE;
+
 	WINPR_ASSERT(persistent);
-	while (1)
+	for (INT64 offset = 0; offset + stride <= persistent->fileSize; offset += stride)
 	{
-		PERSISTENT_CACHE_ENTRY_V2 entry = { 0 };
-
-		if (fread((void*)&entry, sizeof(entry), 1, persistent->fp) != 1)
-			break;
-
-		if (fseek(persistent->fp, 0x4000, SEEK_CUR) != 0)
-			break;
-
-		persistent->count++;
+		if (!persistent_cache_add_offset(persistent, offset))
+			return -1;
 	}
 
 	return 1;
 }
 
-static int persistent_cache_read_entry_v3(rdpPersistentCache* persistent,
+static int persistent_cache_read_entry_v3(rdpPersistentCache* persistent, INT64 offset,
                                           PERSISTENT_CACHE_ENTRY* entry)
 {
 	PERSISTENT_CACHE_ENTRY_V3 entry3 = { 0 };
@@ -140,7 +231,7 @@ static int persistent_cache_read_entry_v3(rdpPersistentCache* persistent,
 	WINPR_ASSERT(persistent);
 	WINPR_ASSERT(entry);
 
-	if (fread(&entry3, sizeof(entry3), 1, persistent->fp) != 1)
+	if (!persistent_cache_read_at(persistent, offset, &entry3, sizeof(entry3)))
 		return -1;
 
 	entry->key64 = entry3.key64;
@@ -152,21 +243,8 @@ static int persistent_cache_read_entry_v3(rdpPersistentCache* persistent,
 	entry->size = (UINT32)size;
 	entry->flags = 0;
 
-	if (entry->size > persistent->bmpSize)
-	{
-		persistent->bmpSize = entry->size;
-		BYTE* bmpData = (BYTE*)winpr_aligned_recalloc(persistent->bmpData, persistent->bmpSize,
-		                                              sizeof(BYTE), 32);
-
-		if (!bmpData)
-			return -1;
-
-		persistent->bmpData = bmpData;
-	}
-
-	entry->data = persistent->bmpData;
-
-	if (fread((void*)entry->data, entry->size, 1, persistent->fp) != 1)
+	if (!persistent_cache_read_data(persistent, offset + (INT64)sizeof(entry3), entry->size,
+	                                entry))
 		return -1;
 
 	return 1;
@@ -198,35 +276,54 @@ static int persistent_cache_write_entry_v3(rdpPersistentCache* persistent,
 static int persistent_cache_read_v3(rdpPersistentCache* persistent)
 {
 	WINPR_ASSERT(persistent);
+	INT64 offset = sizeof(PERSISTENT_CACHE_HEADER_V3);
+
 	while (1)
 	{
 		PERSISTENT_CACHE_ENTRY_V3 entry = { 0 };
 
-		if (fread((void*)&entry, sizeof(entry), 1, persistent->fp) != 1)
+		if (!persistent_cache_read_at(persistent, offset, &entry, sizeof(entry)))
 			break;
 
-		if (_fseeki64(persistent->fp, (4LL * entry.width * entry.height), SEEK_CUR) != 0)
+		const INT64 next = offset + (INT64)sizeof(entry) + 4LL * entry.width * entry.height;
+		if (next > persistent->fileSize)
 			break;
 
-		persistent->count++;
+		if (!persistent_cache_add_offset(persistent, offset))
+			return -1;
+		offset = next;
 	}
 
 	return 1;
 }
 
-int persistent_cache_read_entry(rdpPersistentCache* persistent, PERSISTENT_CACHE_ENTRY* entry)
+int persistent_cache_get_entry(rdpPersistentCache* persistent, size_t index,
+                               PERSISTENT_CACHE_ENTRY* entry)
 {
 	WINPR_ASSERT(persistent);
 	WINPR_ASSERT(entry);
 
+	if (persistent->write || (index >= (size_t)persistent->count))
+		return -1;
+
+	const INT64 offset = persistent->offsets[index];
+
 	if (persistent->version == 3)
-		return persistent_cache_read_entry_v3(persistent, entry);
+		return persistent_cache_read_entry_v3(persistent, offset, entry);
 	else if (persistent->version == 2)
-		return persistent_cache_read_entry_v2(persistent, entry);
+		return persistent_cache_read_entry_v2(persistent, offset, entry);
 
 	return -1;
 }
 
+int persistent_cache_read_entry(rdpPersistentCache* persistent, PERSISTENT_CACHE_ENTRY* entry)
+{
+	WINPR_ASSERT(persistent);
+	WINPR_ASSERT(entry);
+
+	return persistent_cache_get_entry(persistent, persistent->next++, entry);
+}
+
 int persistent_cache_write_entry(rdpPersistentCache* persistent,
                                  const PERSISTENT_CACHE_ENTRY* entry)
 {
@@ -241,11 +338,37 @@ int persistent_cache_write_entry(rdpPersistentCache* persistent,
 	return -1;
 }
 
+static void persistent_cache_map(rdpPersistentCache* persistent)
+{
+	WINPR_ASSERT(persistent);
+
+#if !defined(_WIN32)
+	if ((persistent->fileSize <= 0) || ((UINT64)persistent->fileSize > SIZE_MAX))
+		return;
+
+	/* Entries are looked up at random while the session runs, let the page cache serve them */
+	void* map = mmap(NULL, (size_t)persistent->fileSize, PROT_READ, MAP_PRIVATE,
+	                 fileno(persistent->fp), 0);
+
+	if (map != MAP_FAILED)
+		persistent->map = (BYTE*)map;
+#endif
+}
+
+static void persistent_cache_unmap(rdpPersistentCache* persistent)
+{
+	WINPR_ASSERT(persistent);
+
+#if !defined(_WIN32)
+	if (persistent->map)
+		(void)munmap(persistent->map, (size_t)persistent->fileSize);
+#endif
+	persistent->map = NULL;
+}
+
 static int persistent_cache_open_read(rdpPersistentCache* persistent)
 {
 	BYTE sig[8] = { 0 };
-	int status = 1;
-	long offset = 0;
 
 	WINPR_ASSERT(persistent);
 	persistent->fp = winpr_fopen(persistent->filename, "rb");
@@ -261,27 +384,19 @@ static int persistent_cache_open_read(rdpPersistentCache* persistent)
 	else
 		persistent->version = 2;
 
-	(void)fseek(persistent->fp, 0, SEEK_SET);
+	if (_fseeki64(persistent->fp, 0, SEEK_END) != 0)
+		return -1;
 
-	if (persistent->version == 3)
-	{
-		PERSISTENT_CACHE_HEADER_V3 header;
+	persistent->fileSize = _ftelli64(persistent->fp);
+	if (persistent->fileSize < 0)
+		return -1;
 
-		if (fread(&header, sizeof(header), 1, persistent->fp) != 1)
-			return -1;
+	persistent_cache_map(persistent);
 
-		status = persistent_cache_read_v3(persistent);
-		offset = sizeof(header);
-	}
-	else
-	{
-		status = persistent_cache_read_v2(persistent);
-		offset = 0;
-	}
-
-	(void)fseek(persistent->fp, offset, SEEK_SET);
+	if (persistent->version == 3)
+		return persistent_cache_read_v3(persistent);
 
-	return status;
+	return persistent_cache_read_v2(persistent);
 }
 
 static int persistent_cache_open_write(rdpPersistentCache* persistent)
@@ -333,6 +448,8 @@ int persistent_cache_open(rdpPersistentCache* persistent, const char* filename,
 int persistent_cache_close(rdpPersistentCache* persistent)
 {
 	WINPR_ASSERT(persistent);
+	persistent_cache_unmap(persistent);
+
 	if (persistent->fp)
 	{
 		(void)fclose(persistent->fp);
@@ -349,8 +466,8 @@ rdpPersistentCache* persistent_cache_new(void)
 	if (!persistent)
 		return NULL;
 
-	persistent->bmpSize = 0x4000;
-	persistent->bmpData = calloc(1, persistent->bmpSize);
+	persistent->bmpSize = PERSISTENT_CACHE_V2_DATA_SIZE;
+	persistent->bmpData = winpr_aligned_calloc(persistent->bmpSize, sizeof(BYTE), 32);
 
 	if (!persistent->bmpData)
 	{
@@ -369,6 +486,7 @@ void persistent_cache_free(rdpPersistentCache* persistent)
 	persistent_cache_close(persistent);
 
 	free(persistent->filename);
+	free(persistent->offsets);
 
 	winpr_aligned_free(persistent->bmpData);
 
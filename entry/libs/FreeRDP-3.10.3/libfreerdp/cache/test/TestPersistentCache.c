@@ -0,0 +1,233 @@
+#include <winpr/crt.h>
+#include <winpr/file.h>
+#include <winpr/path.h>
+#include <winpr/crypto.h>
+
+#include <freerdp/cache/persistent.h>
+
+#define TEST_ENTRIES 37
+
+typedef struct
+{
+	UINT64 key64;
+	UINT16 width;
+	UINT16 height;
+	BYTE data[64 * 64 * 4];
+} test_entry;
+
+static char* test_path(const char* suffix)
+{
+	BYTE rnd[8] = { 0 };
+	char name[64] = { 0 };
+
+	winpr_RAND(rnd, sizeof(rnd));
+	(void)_snprintf(name, sizeof(name), "TestPersistentCache-%016" PRIx64 "%s",
+	                *(UINT64*)rnd, suffix);
+	return GetKnownSubPath(KNOWN_PATH_TEMP, name);
+}
+
+static void test_entries_init(test_entry* entries, size_t count)
+{
+	for (size_t x = 0; x < count; x++)
+	{
+		test_entry* entry = &entries[x];
+		UINT16 size[2] = { 0 };
+
+		winpr_RAND(size, sizeof(size));
+		entry->key64 = 0x1000 + x;
+		entry->width = 1 + size[0] % 64;
+		entry->height = 1 + size[1] % 64;
+		winpr_RAND(entry->data, 4ull * entry->width * entry->height);
+	}
+}
+
+static BOOL test_write(const char* file, UINT32 version, const test_entry* entries, size_t count)
+{
+	BOOL rc = FALSE;
+	rdpPersistentCache* persistent = persistent_cache_new();
+
+	if (!persistent || (persistent_cache_open(persistent, file, TRUE, version) < 1))
+		goto fail;
+
+	for (size_t x = 0; x < count; x++)
+	{
+		const test_entry* entry = &entries[x];
+		PERSISTENT_CACHE_ENTRY cacheEntry = { 0 };
+
+		cacheEntry.key64 = entry->key64;
+		cacheEntry.width = entry->width;
+		cacheEntry.height = entry->height;
+		cacheEntry.size = 4u * entry->width * entry->height;
+		cacheEntry.data = (BYTE*)entry->data;
+
+		if (persistent_cache_write_entry(persistent, &cacheEntry) < 1)
+			goto fail;
+	}
+
+	/* version 2 entries are fixed size, larger bitmaps must be refused */
+	if (version == 2)
+	{
+		BYTE big[65 * 64 * 4] = { 0 };
+		PERSISTENT_CACHE_ENTRY cacheEntry = { 0 };
+
+		cacheEntry.key64 = 1;
+		cacheEntry.width = 65;
+		cacheEntry.height = 64;
+		cacheEntry.size = sizeof(big);
+		cacheEntry.data = big;
+
+		if (persistent_cache_write_entry(persistent, &cacheEntry) >= 0)
+			goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	persistent_cache_free(persistent);
+	return rc;
+}
+
+static BOOL test_compare(const PERSISTENT_CACHE_ENTRY* cacheEntry, const test_entry* entry)
+{
+	if ((cacheEntry->key64 != entry->key64) || (cacheEntry->width != entry->width) ||
+	    (cacheEntry->height != entry->height) ||
+	    (cacheEntry->size != 4u * entry->width * entry->height))
+		return FALSE;
+
+	return memcmp(cacheEntry->data, entry->data, cacheEntry->size) == 0;
+}
+
+static BOOL test_read(const char* file, int version, const test_entry* entries, size_t count)
+{
+	BOOL rc = FALSE;
+	rdpPersistentCache* persistent = persistent_cache_new();
+
+	if (!persistent || (persistent_cache_open(persistent, file, FALSE, 0) < 1))
+		goto fail;
+
+	if ((persistent_cache_get_version(persistent) != version) ||
+	    (persistent_cache_get_count(persistent) != (int)count))
+	{
+		printf("v%d: version %d, %d entries\n", version, persistent_cache_get_version(persistent),
+		       persistent_cache_get_count(persistent));
+		goto fail;
+	}
+
+	/* sequential */
+	for (size_t x = 0; x < count; x++)
+	{
+		PERSISTENT_CACHE_ENTRY cacheEntry = { 0 };
+
+		if ((persistent_cache_read_entry(persistent, &cacheEntry) < 1) ||
+		    !test_compare(&cacheEntry, &entries[x]))
+		{
+			printf("v%d: entry %" PRIuz " differs\n", version, x);
+			goto fail;
+		}
+	}
+
+	/* random access, backwards */
+	for (size_t x = count; x > 0; x--)
+	{
+		PERSISTENT_CACHE_ENTRY cacheEntry = { 0 };
+
+		if ((persistent_cache_get_entry(persistent, x - 1, &cacheEntry) < 1) ||
+		    !test_compare(&cacheEntry, &entries[x - 1]))
+		{
+			printf("v%d: random entry %" PRIuz " differs\n", version, x - 1);
+			goto fail;
+		}
+	}
+
+	{
+		PERSISTENT_CACHE_ENTRY cacheEntry = { 0 };
+		if (persistent_cache_get_entry(persistent, count, &cacheEntry) >= 0)
+			goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	persistent_cache_free(persistent);
+	return rc;
+}
+
+/* A file cut in the middle of an entry must not expose the incomplete entry */
+static BOOL test_truncated(const char* file, int version, const test_entry* entries, size_t count)
+{
+	BOOL rc = FALSE;
+	BYTE* data = NULL;
+	FILE* fp = winpr_fopen(file, "rb");
+	char* cut = test_path(".cut");
+
+	if (!fp || !cut)
+		goto fail;
+
+	if (_fseeki64(fp, 0, SEEK_END) != 0)
+		goto fail;
+
+	const INT64 size = _ftelli64(fp);
+	if ((size < 16) || (_fseeki64(fp, 0, SEEK_SET) != 0))
+		goto fail;
+
+	data = malloc((size_t)size);
+	if (!data || (fread(data, (size_t)size - 10, 1, fp) != 1))
+		goto fail;
+
+	(void)fclose(fp);
+	fp = winpr_fopen(cut, "wb");
+	if (!fp || (fwrite(data, (size_t)size - 10, 1, fp) != 1))
+		goto fail;
+	(void)fclose(fp);
+	fp = NULL;
+
+	rc = test_read(cut, version, entries, count - 1);
+
+fail:
+	if (fp)
+		(void)fclose(fp);
+	if (cut)
+		(void)DeleteFileA(cut);
+	free(cut);
+	free(data);
+	return rc;
+}
+
+int TestPersistentCache(int argc, char* argv[])
+{
+	int rc = -1;
+	test_entry* entries = calloc(TEST_ENTRIES, sizeof(test_entry));
+	char* file = test_path(".bmc");
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!entries || !file)
+		goto fail;
+
+	test_entries_init(entries, TEST_ENTRIES);
+
+	for (int version = 2; version <= 3; version++)
+	{
+		if (!test_write(file, (UINT32)version, entries, TEST_ENTRIES))
+		{
+			printf("v%d: write failed\n", version);
+			goto fail;
+		}
+
+		if (!test_read(file, version, entries, TEST_ENTRIES))
+			goto fail;
+
+		if (!test_truncated(file, version, entries, TEST_ENTRIES))
+		{
+			printf("v%d: truncated file not handled\n", version);
+			goto fail;
+		}
+	}
+
+	rc = 0;
+fail:
+	if (file)
+		(void)DeleteFileA(file);
+	free(file);
+	free(entries);
+	return rc;
+}
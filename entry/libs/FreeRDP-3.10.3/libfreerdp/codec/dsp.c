@@ -31,6 +31,7 @@
 #include <freerdp/codec/dsp.h>
 
 #include "dsp.h"
+#include "dsp_resample.h"
 
 #if defined(WITH_FDK_AAC)
 #include "dsp_fdk_aac.h"
@@ -118,6 +119,8 @@ struct S_FREERDP_DSP_CONTEXT
 
 #if defined(WITH_SOXR)
 	soxr_t sox;
+#else
+	FREERDP_DSP_RESAMPLER* resampler;
 #endif
 };
 
@@ -145,6 +148,20 @@ static INT16 read_int16(const BYTE* WINPR_RESTRICT src)
 	return (INT16)(src[0] | (src[1] << 8));
 }
 
+static BOOL freerdp_dsp_encode_pcm8(const BYTE* WINPR_RESTRICT src, size_t size,
+                                    wStream* WINPR_RESTRICT out)
+{
+	const size_t samples = size / 2;
+
+	if (!Stream_EnsureRemainingCapacity(out, samples))
+		return FALSE;
+
+	for (size_t x = 0; x < samples; x++)
+		Stream_Write_UINT8(out, (BYTE)((read_int16(&src[2 * x]) >> 8) + 128));
+
+	return TRUE;
+}
+
 static BOOL freerdp_dsp_channel_mix(FREERDP_DSP_CONTEXT* WINPR_RESTRICT context,
                                     const BYTE* WINPR_RESTRICT src, size_t size,
                                     const AUDIO_FORMAT* WINPR_RESTRICT srcFormat,
@@ -156,73 +173,23 @@ static BOOL freerdp_dsp_channel_mix(FREERDP_DSP_CONTEXT* WINPR_RESTRICT context,
 	if (srcFormat->wFormatTag != WAVE_FORMAT_PCM)
 		return FALSE;
 
-	const UINT32 bpp = srcFormat->wBitsPerSample > 8 ? 2 : 1;
-	const size_t samples = size / bpp / srcFormat->nChannels;
+	const UINT32 bits = srcFormat->wBitsPerSample > 8 ? 16 : 8;
 
-	if (context->common.format.nChannels == srcFormat->nChannels)
+	if ((bits == 16) && (context->common.format.nChannels == srcFormat->nChannels))
 	{
 		*data = src;
 		*length = size;
 		return TRUE;
 	}
 
-	Stream_SetPosition(context->common.channelmix, 0);
-
-	/* Destination has more channels than source */
-	if (context->common.format.nChannels > srcFormat->nChannels)
-	{
-		switch (srcFormat->nChannels)
-		{
-			case 1:
-				if (!Stream_EnsureCapacity(context->common.channelmix, size * 2))
-					return FALSE;
-
-				for (size_t x = 0; x < samples; x++)
-				{
-					for (size_t y = 0; y < bpp; y++)
-						Stream_Write_UINT8(context->common.channelmix, src[x * bpp + y]);
-
-					for (size_t y = 0; y < bpp; y++)
-						Stream_Write_UINT8(context->common.channelmix, src[x * bpp + y]);
-				}
-
-				Stream_SealLength(context->common.channelmix);
-				*data = Stream_Buffer(context->common.channelmix);
-				*length = Stream_Length(context->common.channelmix);
-				return TRUE;
-
-			case 2:  /* We only support stereo, so we can not handle this case. */
-			default: /* Unsupported number of channels */
-				return FALSE;
-		}
-	}
-
-	/* Destination has less channels than source */
-	switch (srcFormat->nChannels)
-	{
-		case 2:
-			if (!Stream_EnsureCapacity(context->common.channelmix, size / 2))
-				return FALSE;
-
-			/* Simply drop second channel.
-			 * TODO: Calculate average */
-			for (size_t x = 0; x < samples; x++)
-			{
-				for (size_t y = 0; y < bpp; y++)
-					Stream_Write_UINT8(context->common.channelmix, src[2 * x * bpp + y]);
-			}
-
-			Stream_SealLength(context->common.channelmix);
-			*data = Stream_Buffer(context->common.channelmix);
-			*length = Stream_Length(context->common.channelmix);
-			return TRUE;
-
-		case 1:  /* Invalid, do we want to use a 0 channel sound? */
-		default: /* Unsupported number of channels */
-			return FALSE;
-	}
+	/* 8 bit input is widened here, the resampler and encoders work on 16 bit samples */
+	if (!freerdp_dsp_convert_pcm(src, size, bits, srcFormat->nChannels,
+	                             context->common.format.nChannels, context->common.channelmix))
+		return FALSE;
 
-	return FALSE;
+	*data = Stream_Buffer(context->common.channelmix);
+	*length = Stream_Length(context->common.channelmix);
+	return TRUE;
 }
 
 /**
@@ -292,8 +259,24 @@ static BOOL freerdp_dsp_resample(FREERDP_DSP_CONTEXT* WINPR_RESTRICT context,
 	*length = Stream_Length(context->common.resample);
 	return (error == 0) ? TRUE : FALSE;
 #else
-	WLog_ERR(TAG, "Missing resample support, recompile -DWITH_SOXR=ON or -DWITH_DSP_FFMPEG=ON");
-	return FALSE;
+	const UINT32 channels = srcFormat->nChannels;
+	if (!freerdp_dsp_resampler_matches(context->resampler, srcFormat->nSamplesPerSec,
+	                                   context->common.format.nSamplesPerSec, channels))
+	{
+		freerdp_dsp_resampler_free(context->resampler);
+		context->resampler = freerdp_dsp_resampler_new(
+		    srcFormat->nSamplesPerSec, context->common.format.nSamplesPerSec, channels);
+		if (!context->resampler)
+			return FALSE;
+	}
+
+	if (!freerdp_dsp_resampler_process(context->resampler, src, size / (2ull * channels),
+	                                   context->common.resample))
+		return FALSE;
+
+	*data = Stream_Buffer(context->common.resample);
+	*length = Stream_Length(context->common.resample);
+	return TRUE;
 #endif
 }
 
@@ -1231,6 +1214,8 @@ void freerdp_dsp_context_free(FREERDP_DSP_CONTEXT* context)
 #endif
 #if defined(WITH_SOXR)
 		soxr_delete(context->sox);
+#else
+	    freerdp_dsp_resampler_free(context->resampler);
 #endif
 	    free(context);
 
@@ -1268,6 +1253,7 @@ BOOL freerdp_dsp_encode(FREERDP_DSP_CONTEXT* WINPR_RESTRICT context,
 		return FALSE;
 
 	format.nChannels = context->common.format.nChannels;
+	format.wBitsPerSample = 16;
 
 	const BYTE* data = NULL;
 	if (!freerdp_dsp_resample(context, resampleData, resampleLength, &format, &data, &length))
@@ -1276,6 +1262,9 @@ BOOL freerdp_dsp_encode(FREERDP_DSP_CONTEXT* WINPR_RESTRICT context,
 	switch (context->common.format.wFormatTag)
 	{
 		case WAVE_FORMAT_PCM:
+			if (context->common.format.wBitsPerSample <= 8)
+				return freerdp_dsp_encode_pcm8(data, length, out);
+
 			if (!Stream_EnsureRemainingCapacity(out, length))
 				return FALSE;
 
@@ -1560,7 +1549,11 @@ BOOL freerdp_dsp_context_reset(FREERDP_DSP_CONTEXT* WINPR_RESTRICT context,
 	}
 
 #endif
-#if defined(WITH_SOXR)
+#if !defined(WITH_SOXR)
+	/* the source rate is only known once there are samples to encode */
+	freerdp_dsp_resampler_free(context->resampler);
+	context->resampler = NULL;
+#else
 	{
 		soxr_io_spec_t iospec = soxr_io_spec(SOXR_INT16, SOXR_INT16);
 		soxr_error_t error;
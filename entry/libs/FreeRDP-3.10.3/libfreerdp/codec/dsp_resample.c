@@ -0,0 +1,502 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Digital Sound Processing - built-in resampler and channel mixer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <math.h>
+#include <string.h>
+
+#include <winpr/crt.h>
+#include <winpr/assert.h>
+#include <winpr/synch.h>
+
+#include <freerdp/types.h>
+#include <freerdp/log.h>
+
+#include "dsp_resample.h"
+#include "sse/dsp_sse2.h"
+#include "neon/dsp_neon.h"
+
+#define TAG FREERDP_TAG("codec.dsp")
+
+/* Taps on each side of the filter center when upsampling, scaled by the ratio when
+ * downsampling so the transition band stays the same width at the destination rate. */
+#define DSP_RESAMPLE_HALF_TAPS 32
+#define DSP_RESAMPLE_MAX_TAPS 1024
+
+/* Rates whose reduced ratio needs more phases share a bank of this size and interpolate
+ * between neighbouring phases. */
+#define DSP_RESAMPLE_MAX_PHASES 512
+#define DSP_RESAMPLE_SHARED_PHASES 256
+
+/* Kaiser window with about 85 dB stop band attenuation, rounding the coefficients to
+ * DSP_RESAMPLE_COEFF_BITS bits puts the noise floor near 70 dB */
+#define DSP_RESAMPLE_KAISER_BETA 8.6
+
+/* -6 dB point relative to the lower of both Nyquist frequencies */
+#define DSP_RESAMPLE_CUTOFF 0.9
+
+#define DSP_MAX_CHANNELS 8
+
+#define DSP_PI 3.14159265358979323846
+
+struct S_FREERDP_DSP_RESAMPLER
+{
+	UINT32 srcRate;
+	UINT32 dstRate;
+	UINT32 channels;
+	const FREERDP_DSP_KERNELS* kernels;
+
+	UINT64 step;     /* source rate divided by the common divisor */
+	UINT64 interval; /* destination rate divided by the common divisor */
+	size_t taps;
+	size_t phases;
+	BOOL interpolate;
+	INT16* bank; /* phases (+ 1 if interpolating) rows of taps coefficients */
+
+	UINT64 frac; /* position between two source samples, in 1 / interval units */
+	size_t pos;  /* first history sample of the next output window */
+	size_t fill; /* history samples per channel */
+	size_t capacity;
+	INT16* history; /* capacity samples per channel, planar */
+};
+
+static INT32 dsp_dot_generic(const INT16* WINPR_RESTRICT samples,
+                             const INT16* WINPR_RESTRICT coeffs, size_t taps)
+{
+	INT32 sum = 0;
+
+	for (size_t x = 0; x < taps; x++)
+		sum += samples[x] * coeffs[x];
+	return sum;
+}
+
+static void dsp_mono_to_stereo_generic(const INT16* WINPR_RESTRICT src, INT16* WINPR_RESTRICT dst,
+                                       size_t frames)
+{
+	for (size_t x = 0; x < frames; x++)
+	{
+		dst[2 * x] = src[x];
+		dst[2 * x + 1] = src[x];
+	}
+}
+
+static void dsp_stereo_to_mono_generic(const INT16* WINPR_RESTRICT src, INT16* WINPR_RESTRICT dst,
+                                       size_t frames)
+{
+	for (size_t x = 0; x < frames; x++)
+		dst[x] = (INT16)((src[2 * x] + src[2 * x + 1]) >> 1);
+}
+
+static void dsp_u8_to_s16_generic(const BYTE* WINPR_RESTRICT src, INT16* WINPR_RESTRICT dst,
+                                  size_t samples)
+{
+	for (size_t x = 0; x < samples; x++)
+		dst[x] = (INT16)((src[x] ^ 0x80) << 8);
+}
+
+static INIT_ONCE dsp_kernels_once = INIT_ONCE_STATIC_INIT;
+static FREERDP_DSP_KERNELS dsp_kernels = { 0 };
+
+static BOOL CALLBACK dsp_kernels_init(PINIT_ONCE once, PVOID param, PVOID* context)
+{
+	WINPR_UNUSED(once);
+	WINPR_UNUSED(param);
+	WINPR_UNUSED(context);
+
+	dsp_kernels.dot = dsp_dot_generic;
+	dsp_kernels.mono_to_stereo = dsp_mono_to_stereo_generic;
+	dsp_kernels.stereo_to_mono = dsp_stereo_to_mono_generic;
+	dsp_kernels.u8_to_s16 = dsp_u8_to_s16_generic;
+
+	freerdp_dsp_init_sse2(&dsp_kernels);
+	freerdp_dsp_init_neon(&dsp_kernels);
+	return TRUE;
+}
+
+const FREERDP_DSP_KERNELS* freerdp_dsp_kernels(void)
+{
+	InitOnceExecuteOnce(&dsp_kernels_once, dsp_kernels_init, NULL, NULL);
+	return &dsp_kernels;
+}
+
+static UINT64 dsp_gcd(UINT64 a, UINT64 b)
+{
+	while (b)
+	{
+		const UINT64 t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/* Zeroth order modified Bessel function of the first kind */
+static double dsp_bessel_i0(double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+
+	for (size_t k = 1; k < 64; k++)
+	{
+		term *= (x / (2.0 * (double)k)) * (x / (2.0 * (double)k));
+		sum += term;
+		if (term < sum * 1e-12)
+			break;
+	}
+	return sum;
+}
+
+/* One row of the bank: the windowed sinc centered \b offset source samples past the center
+ * tap, normalized so the coefficients add up to exactly one. */
+static void dsp_resampler_design_phase(INT16* WINPR_RESTRICT row, size_t taps, double offset,
+                                       double cutoff)
+{
+	const double half = (double)taps / 2.0;
+	const double center = half - 1.0 + offset;
+	const double unit = (double)(1 << DSP_RESAMPLE_COEFF_BITS);
+	const double norm = dsp_bessel_i0(DSP_RESAMPLE_KAISER_BETA);
+	double values[DSP_RESAMPLE_MAX_TAPS] = { 0 };
+	double sum = 0.0;
+
+	for (size_t k = 0; k < taps; k++)
+	{
+		const double x = (double)k - center;
+		const double r = x / half;
+		double v = cutoff;
+
+		if (fabs(x) > 1e-9)
+			v = sin(DSP_PI * cutoff * x) / (DSP_PI * x);
+
+		if (fabs(r) >= 1.0)
+			v = 0.0;
+		else
+			v *= dsp_bessel_i0(DSP_RESAMPLE_KAISER_BETA * sqrt(1.0 - r * r)) / norm;
+
+		values[k] = v;
+		sum += v;
+	}
+
+	INT32 total = 0;
+	for (size_t k = 0; k < taps; k++)
+	{
+		row[k] = (INT16)lround(values[k] * unit / sum);
+		total += row[k];
+	}
+
+	/* the rounding error goes to the tap closest to the center */
+	const size_t peak = (offset < 0.5) ? (taps / 2 - 1) : (taps / 2);
+	row[peak] = (INT16)(row[peak] + (1 << DSP_RESAMPLE_COEFF_BITS) - total);
+}
+
+void freerdp_dsp_resampler_free(FREERDP_DSP_RESAMPLER* resampler)
+{
+	if (!resampler)
+		return;
+
+	winpr_aligned_free(resampler->bank);
+	free(resampler->history);
+	free(resampler);
+}
+
+FREERDP_DSP_RESAMPLER* freerdp_dsp_resampler_new(UINT32 srcRate, UINT32 dstRate, UINT32 channels)
+{
+	if ((srcRate == 0) || (dstRate == 0) || (channels == 0) || (channels > DSP_MAX_CHANNELS))
+	{
+		WLog_ERR(TAG, "unsupported conversion %" PRIu32 " -> %" PRIu32 " Hz, %" PRIu32 " channels",
+		         srcRate, dstRate, channels);
+		return NULL;
+	}
+
+	FREERDP_DSP_RESAMPLER* resampler = calloc(1, sizeof(FREERDP_DSP_RESAMPLER));
+	if (!resampler)
+		return NULL;
+
+	const UINT64 gcd = dsp_gcd(srcRate, dstRate);
+	resampler->srcRate = srcRate;
+	resampler->dstRate = dstRate;
+	resampler->channels = channels;
+	resampler->kernels = freerdp_dsp_kernels();
+	resampler->step = srcRate / gcd;
+	resampler->interval = dstRate / gcd;
+
+	/* downsampling moves the cutoff below the destination Nyquist frequency and widens the
+	 * filter by the same factor */
+	const double scale = (dstRate < srcRate) ? ((double)dstRate / (double)srcRate) : 1.0;
+	size_t taps = 2 * (size_t)ceil(DSP_RESAMPLE_HALF_TAPS / scale);
+	taps = (taps + DSP_RESAMPLE_TAP_ALIGN - 1) & ~((size_t)DSP_RESAMPLE_TAP_ALIGN - 1);
+	resampler->taps = MIN(taps, DSP_RESAMPLE_MAX_TAPS);
+
+	if (resampler->interval <= DSP_RESAMPLE_MAX_PHASES)
+		resampler->phases = resampler->interval;
+	else
+	{
+		resampler->phases = DSP_RESAMPLE_SHARED_PHASES;
+		resampler->interpolate = TRUE;
+	}
+
+	const size_t rows = resampler->phases + (resampler->interpolate ? 1 : 0);
+	resampler->bank = winpr_aligned_calloc(rows * resampler->taps, sizeof(INT16), 16);
+	if (!resampler->bank)
+		goto fail;
+
+	for (size_t p = 0; p < rows; p++)
+		dsp_resampler_design_phase(&resampler->bank[p * resampler->taps], resampler->taps,
+		                           (double)p / (double)resampler->phases,
+		                           DSP_RESAMPLE_CUTOFF * scale);
+
+	/* half a window of silence, the first output is centered on the first input sample */
+	resampler->fill = resampler->taps / 2 - 1;
+	resampler->capacity = resampler->taps * 4;
+	resampler->history = calloc(resampler->capacity * channels, sizeof(INT16));
+	if (!resampler->history)
+		goto fail;
+
+	WLog_DBG(TAG, "%" PRIu32 " -> %" PRIu32 " Hz: %" PRIuz " taps, %" PRIuz " phases%s", srcRate,
+	         dstRate, resampler->taps, resampler->phases,
+	         resampler->interpolate ? " (interpolated)" : "");
+	return resampler;
+
+fail:
+	freerdp_dsp_resampler_free(resampler);
+	return NULL;
+}
+
+BOOL freerdp_dsp_resampler_matches(const FREERDP_DSP_RESAMPLER* resampler, UINT32 srcRate,
+                                   UINT32 dstRate, UINT32 channels)
+{
+	if (!resampler)
+		return FALSE;
+
+	return (resampler->srcRate == srcRate) && (resampler->dstRate == dstRate) &&
+	       (resampler->channels == channels);
+}
+
+static BOOL dsp_resampler_append(FREERDP_DSP_RESAMPLER* WINPR_RESTRICT resampler,
+                                 const BYTE* WINPR_RESTRICT src, size_t frames)
+{
+	const size_t channels = resampler->channels;
+	const size_t required = resampler->fill + frames;
+
+	if (required > resampler->capacity)
+	{
+		size_t capacity = resampler->capacity;
+		while (capacity < required)
+			capacity *= 2;
+
+		INT16* history = calloc(capacity * channels, sizeof(INT16));
+		if (!history)
+			return FALSE;
+
+		for (size_t c = 0; c < channels; c++)
+			memcpy(&history[c * capacity], &resampler->history[c * resampler->capacity],
+			       resampler->fill * sizeof(INT16));
+
+		free(resampler->history);
+		resampler->history = history;
+		resampler->capacity = capacity;
+	}
+
+	for (size_t c = 0; c < channels; c++)
+	{
+		INT16* dst = &resampler->history[c * resampler->capacity + resampler->fill];
+		const BYTE* s = &src[2 * c];
+
+		for (size_t x = 0; x < frames; x++)
+		{
+			dst[x] = (INT16)(s[0] | (s[1] << 8));
+			s += 2 * channels;
+		}
+	}
+
+	resampler->fill = required;
+	return TRUE;
+}
+
+static INT16 dsp_resampler_clamp(INT64 acc)
+{
+	const INT64 v = (acc + (1 << (DSP_RESAMPLE_COEFF_BITS - 1))) >> DSP_RESAMPLE_COEFF_BITS;
+
+	if (v > INT16_MAX)
+		return INT16_MAX;
+	if (v < INT16_MIN)
+		return INT16_MIN;
+	return (INT16)v;
+}
+
+BOOL freerdp_dsp_resampler_process(FREERDP_DSP_RESAMPLER* WINPR_RESTRICT resampler,
+                                   const BYTE* WINPR_RESTRICT src, size_t frames,
+                                   wStream* WINPR_RESTRICT out)
+{
+	if (!resampler || (!src && (frames > 0)) || !out)
+		return FALSE;
+
+	const size_t channels = resampler->channels;
+	const size_t taps = resampler->taps;
+
+	if (!dsp_resampler_append(resampler, src, frames))
+		return FALSE;
+
+	/* an upper bound, the exact count depends on the phase the previous call stopped at */
+	const size_t available = resampler->fill - MIN(resampler->fill, resampler->pos);
+	const size_t count = (size_t)((1ull * available * resampler->interval) / resampler->step) + 2;
+
+	Stream_SetPosition(out, 0);
+	if (!Stream_EnsureCapacity(out, count * channels * sizeof(INT16)))
+		return FALSE;
+
+	INT16* dst = (INT16*)Stream_Buffer(out);
+	size_t written = 0;
+
+	while (resampler->pos + taps <= resampler->fill)
+	{
+		const INT16* history = &resampler->history[resampler->pos];
+
+		if (resampler->interpolate)
+		{
+			const UINT64 scaled = resampler->frac * resampler->phases;
+			const size_t phase = (size_t)(scaled / resampler->interval);
+			const INT64 weight = (INT64)(scaled % resampler->interval);
+			const INT64 interval = (INT64)resampler->interval;
+			const INT16* a = &resampler->bank[phase * taps];
+			const INT16* b = a + taps;
+
+			for (size_t c = 0; c < channels; c++)
+			{
+				const INT16* h = &history[c * resampler->capacity];
+				const INT64 va = resampler->kernels->dot(h, a, taps);
+				const INT64 vb = resampler->kernels->dot(h, b, taps);
+				*dst++ = dsp_resampler_clamp((va * (interval - weight) + vb * weight) / interval);
+			}
+		}
+		else
+		{
+			const INT16* coeffs = &resampler->bank[resampler->frac * taps];
+
+			for (size_t c = 0; c < channels; c++)
+				*dst++ = dsp_resampler_clamp(
+				    resampler->kernels->dot(&history[c * resampler->capacity], coeffs, taps));
+		}
+
+		written++;
+		resampler->frac += resampler->step;
+		resampler->pos += (size_t)(resampler->frac / resampler->interval);
+		resampler->frac %= resampler->interval;
+	}
+
+	WINPR_ASSERT(written <= count);
+
+	/* keep the samples later windows still need */
+	const size_t consumed = MIN(resampler->pos, resampler->fill);
+	if (consumed > 0)
+	{
+		for (size_t c = 0; c < channels; c++)
+		{
+			INT16* h = &resampler->history[c * resampler->capacity];
+			memmove(h, &h[consumed], (resampler->fill - consumed) * sizeof(INT16));
+		}
+		resampler->fill -= consumed;
+		resampler->pos -= consumed;
+	}
+
+	Stream_SetPosition(out, written * channels * sizeof(INT16));
+	Stream_SealLength(out);
+	return TRUE;
+}
+
+static void dsp_mix_generic(const INT16* WINPR_RESTRICT src, size_t srcChannels,
+                            INT16* WINPR_RESTRICT dst, size_t dstChannels, size_t frames)
+{
+	for (size_t x = 0; x < frames; x++)
+	{
+		const INT16* s = &src[x * srcChannels];
+		INT16* d = &dst[x * dstChannels];
+
+		if (srcChannels == 1)
+		{
+			for (size_t c = 0; c < dstChannels; c++)
+				d[c] = s[0];
+		}
+		else if (dstChannels == 1)
+		{
+			INT32 sum = 0;
+			for (size_t c = 0; c < srcChannels; c++)
+				sum += s[c];
+			d[0] = (INT16)(sum / (INT32)srcChannels);
+		}
+		else
+		{
+			for (size_t c = 0; c < dstChannels; c++)
+				d[c] = (c < srcChannels) ? s[c] : 0;
+		}
+	}
+}
+
+BOOL freerdp_dsp_convert_pcm(const BYTE* WINPR_RESTRICT src, size_t size, UINT32 srcBits,
+                             UINT32 srcChannels, UINT32 dstChannels, wStream* WINPR_RESTRICT out)
+{
+	if ((!src && (size > 0)) || !out)
+		return FALSE;
+
+	if ((srcChannels == 0) || (srcChannels > DSP_MAX_CHANNELS) || (dstChannels == 0) ||
+	    (dstChannels > DSP_MAX_CHANNELS) || ((srcBits != 8) && (srcBits != 16)))
+	{
+		WLog_ERR(TAG, "unsupported conversion of %" PRIu32 " bit, %" PRIu32 " -> %" PRIu32
+		              " channels",
+		         srcBits, srcChannels, dstChannels);
+		return FALSE;
+	}
+
+	const FREERDP_DSP_KERNELS* kernels = freerdp_dsp_kernels();
+	const size_t bytes = srcBits / 8;
+	const size_t frames = size / bytes / srcChannels;
+	const size_t dstSize = frames * dstChannels * sizeof(INT16);
+	const size_t srcSize = frames * srcChannels * sizeof(INT16);
+
+	/* 16 bit source samples go behind the destination so the kernels never work in place */
+	Stream_SetPosition(out, 0);
+	if (!Stream_EnsureCapacity(out, dstSize + srcSize))
+		return FALSE;
+
+	INT16* dst = (INT16*)Stream_Buffer(out);
+	const INT16* samples = (const INT16*)src;
+
+	if ((srcBits == 8) || (((uintptr_t)src & 1) != 0) || (srcChannels == dstChannels))
+	{
+		INT16* tmp = (srcChannels == dstChannels) ? dst : (INT16*)&Stream_Buffer(out)[dstSize];
+
+		if (srcBits == 8)
+			kernels->u8_to_s16(src, tmp, frames * srcChannels);
+		else
+			memcpy(tmp, src, srcSize);
+		samples = tmp;
+	}
+
+	if (srcChannels != dstChannels)
+	{
+		if ((srcChannels == 1) && (dstChannels == 2))
+			kernels->mono_to_stereo(samples, dst, frames);
+		else if ((srcChannels == 2) && (dstChannels == 1))
+			kernels->stereo_to_mono(samples, dst, frames);
+		else
+			dsp_mix_generic(samples, srcChannels, dst, dstChannels, frames);
+	}
+
+	Stream_SetPosition(out, dstSize);
+	Stream_SealLength(out);
+	return TRUE;
+}
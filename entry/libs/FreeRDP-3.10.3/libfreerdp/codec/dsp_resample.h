@@ -0,0 +1,85 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Digital Sound Processing - built-in resampler and channel mixer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_CODEC_DSP_RESAMPLE_H
+#define FREERDP_LIB_CODEC_DSP_RESAMPLE_H
+
+#include <winpr/wtypes.h>
+#include <winpr/stream.h>
+
+#include <freerdp/api.h>
+
+/** Fractional bits of the filter coefficients */
+#define DSP_RESAMPLE_COEFF_BITS 14
+
+/** Taps per filter phase are a multiple of this, the SIMD kernels rely on it */
+#define DSP_RESAMPLE_TAP_ALIGN 8
+
+typedef struct
+{
+	/** sum of \b taps products, \b taps is a multiple of DSP_RESAMPLE_TAP_ALIGN */
+	INT32 (*dot)(const INT16* WINPR_RESTRICT samples, const INT16* WINPR_RESTRICT coeffs,
+	             size_t taps);
+	/** duplicates every sample into a left and right one */
+	void (*mono_to_stereo)(const INT16* WINPR_RESTRICT src, INT16* WINPR_RESTRICT dst,
+	                       size_t frames);
+	/** averages left and right */
+	void (*stereo_to_mono)(const INT16* WINPR_RESTRICT src, INT16* WINPR_RESTRICT dst,
+	                       size_t frames);
+	/** unsigned 8 bit to signed 16 bit samples */
+	void (*u8_to_s16)(const BYTE* WINPR_RESTRICT src, INT16* WINPR_RESTRICT dst, size_t samples);
+} FREERDP_DSP_KERNELS;
+
+typedef struct S_FREERDP_DSP_RESAMPLER FREERDP_DSP_RESAMPLER;
+
+/** @brief The fastest kernels the CPU supports */
+FREERDP_LOCAL const FREERDP_DSP_KERNELS* freerdp_dsp_kernels(void);
+
+FREERDP_LOCAL void freerdp_dsp_resampler_free(FREERDP_DSP_RESAMPLER* resampler);
+
+/** @brief Polyphase resampler for interleaved 16 bit samples
+ *
+ *  The filter banks are computed once here. Rates with a small common divisor use an exact
+ *  bank, other ratios interpolate between the phases of a fixed size bank.
+ */
+WINPR_ATTR_MALLOC(freerdp_dsp_resampler_free, 1)
+FREERDP_LOCAL FREERDP_DSP_RESAMPLER* freerdp_dsp_resampler_new(UINT32 srcRate, UINT32 dstRate,
+                                                                UINT32 channels);
+
+/** @brief \b TRUE if \b resampler was created with these arguments */
+FREERDP_LOCAL BOOL freerdp_dsp_resampler_matches(const FREERDP_DSP_RESAMPLER* resampler,
+                                                 UINT32 srcRate, UINT32 dstRate, UINT32 channels);
+
+/** @brief Resample \b frames interleaved little endian 16 bit frames
+ *
+ *  The result replaces the content of \b out. The resampler keeps the filter history between
+ *  calls, splitting a stream into chunks of any size produces the same samples.
+ */
+FREERDP_LOCAL BOOL freerdp_dsp_resampler_process(FREERDP_DSP_RESAMPLER* WINPR_RESTRICT resampler,
+                                                 const BYTE* WINPR_RESTRICT src, size_t frames,
+                                                 wStream* WINPR_RESTRICT out);
+
+/** @brief Convert 8 or 16 bit PCM to 16 bit samples with \b dstChannels channels
+ *
+ *  Missing channels are copies of the mono source or silence, extra channels are averaged
+ *  into a mono destination and dropped otherwise. The result replaces the content of \b out.
+ */
+FREERDP_LOCAL BOOL freerdp_dsp_convert_pcm(const BYTE* WINPR_RESTRICT src, size_t size,
+                                           UINT32 srcBits, UINT32 srcChannels, UINT32 dstChannels,
+                                           wStream* WINPR_RESTRICT out);
+
+#endif /* FREERDP_LIB_CODEC_DSP_RESAMPLE_H */
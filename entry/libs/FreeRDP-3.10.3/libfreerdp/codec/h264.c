@@ -91,29 +91,47 @@ BOOL avc420_ensure_buffer(H264_CONTEXT* h264, UINT32 stride, UINT32 width, UINT3
 	return TRUE;
 }
 
-INT32 avc420_decompress(H264_CONTEXT* h264, const BYTE* pSrcData, UINT32 SrcSize, BYTE* pDstData,
-                        DWORD DstFormat, UINT32 nDstStep, UINT32 nDstWidth, UINT32 nDstHeight,
-                        const RECTANGLE_16* regionRects, UINT32 numRegionRects)
+INT32 avc420_decompress_yuv(H264_CONTEXT* h264, const BYTE* pSrcData, UINT32 SrcSize,
+                            const BYTE* pYUVData[3], UINT32 iStride[3], UINT32* pYUVHeight)
 {
 	int status = 0;
-	const BYTE* pYUVData[3];
 
-	if (!h264 || h264->Compressor)
+	if (!h264 || h264->Compressor || !pYUVData || !iStride || !pYUVHeight)
 		return -1001;
 
 	status = h264->subsystem->Decompress(h264, pSrcData, SrcSize);
 
+	if (status <= 0)
+		return status;
+
+	for (size_t x = 0; x < 3; x++)
+	{
+		pYUVData[x] = h264->pYUVData[x];
+		iStride[x] = h264->iStride[x];
+	}
+	*pYUVHeight = h264->height;
+	return 1;
+}
+
+INT32 avc420_decompress(H264_CONTEXT* h264, const BYTE* pSrcData, UINT32 SrcSize, BYTE* pDstData,
+                        DWORD DstFormat, UINT32 nDstStep, UINT32 nDstWidth, UINT32 nDstHeight,
+                        const RECTANGLE_16* regionRects, UINT32 numRegionRects)
+{
+	const BYTE* pYUVData[3] = { 0 };
+	UINT32 iStride[3] = { 0 };
+	UINT32 yuvHeight = 0;
+
+	const INT32 status = avc420_decompress_yuv(h264, pSrcData, SrcSize, pYUVData, iStride,
+	                                           &yuvHeight);
+
 	if (status == 0)
 		return 1;
 
 	if (status < 0)
 		return status;
 
-	pYUVData[0] = h264->pYUVData[0];
-	pYUVData[1] = h264->pYUVData[1];
-	pYUVData[2] = h264->pYUVData[2];
-	if (!yuv420_context_decode(h264->yuv, pYUVData, h264->iStride, h264->height, DstFormat,
-	                           pDstData, nDstStep, regionRects, numRegionRects))
+	if (!yuv420_context_decode(h264->yuv, pYUVData, iStride, yuvHeight, DstFormat, pDstData,
+	                           nDstStep, regionRects, numRegionRects))
 		return -1002;
 
 	return 1;
@@ -808,3 +826,11 @@ UINT32 h264_context_get_option(H264_CONTEXT* h264, H264_CONTEXT_OPTION option)
 			return 0;
 	}
 }
+
+BOOL h264_context_set_callback_environment(H264_CONTEXT* h264, PTP_CALLBACK_ENVIRON pcbe)
+{
+	if (!h264)
+		return FALSE;
+
+	return yuv_context_set_callback_environment(h264->yuv, pcbe);
+}
@@ -0,0 +1,115 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Digital Sound Processing - NEON Optimizations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/platform.h>
+#include <freerdp/config.h>
+
+#include "dsp_neon.h"
+
+#include "../../core/simd.h"
+
+#if defined(NEON_INTRINSICS_ENABLED)
+#include <arm_neon.h>
+
+#include <winpr/sysinfo.h>
+
+static INT32 dsp_dot_neon(const INT16* WINPR_RESTRICT samples, const INT16* WINPR_RESTRICT coeffs,
+                          size_t taps)
+{
+	int32x4_t acc0 = vdupq_n_s32(0);
+	int32x4_t acc1 = vdupq_n_s32(0);
+
+	for (size_t x = 0; x < taps; x += 8)
+	{
+		const int16x8_t s = vld1q_s16(&samples[x]);
+		const int16x8_t c = vld1q_s16(&coeffs[x]);
+		acc0 = vmlal_s16(acc0, vget_low_s16(s), vget_low_s16(c));
+		acc1 = vmlal_s16(acc1, vget_high_s16(s), vget_high_s16(c));
+	}
+
+	const int32x4_t acc = vaddq_s32(acc0, acc1);
+	const int32x2_t sum = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+	return vget_lane_s32(vpadd_s32(sum, sum), 0);
+}
+
+static void dsp_mono_to_stereo_neon(const INT16* WINPR_RESTRICT src, INT16* WINPR_RESTRICT dst,
+                                    size_t frames)
+{
+	size_t x = 0;
+
+	for (; x + 8 <= frames; x += 8)
+	{
+		const int16x8_t s = vld1q_s16(&src[x]);
+		const int16x8x2_t d = { { s, s } };
+		vst2q_s16(&dst[2 * x], d);
+	}
+
+	for (; x < frames; x++)
+	{
+		dst[2 * x] = src[x];
+		dst[2 * x + 1] = src[x];
+	}
+}
+
+static void dsp_stereo_to_mono_neon(const INT16* WINPR_RESTRICT src, INT16* WINPR_RESTRICT dst,
+                                    size_t frames)
+{
+	size_t x = 0;
+
+	/* halving add, (left + right) >> 1 without overflow */
+	for (; x + 8 <= frames; x += 8)
+	{
+		const int16x8x2_t s = vld2q_s16(&src[2 * x]);
+		vst1q_s16(&dst[x], vhaddq_s16(s.val[0], s.val[1]));
+	}
+
+	for (; x < frames; x++)
+		dst[x] = (INT16)((src[2 * x] + src[2 * x + 1]) >> 1);
+}
+
+static void dsp_u8_to_s16_neon(const BYTE* WINPR_RESTRICT src, INT16* WINPR_RESTRICT dst,
+                               size_t samples)
+{
+	const uint8x16_t bias = vdupq_n_u8(0x80);
+	size_t x = 0;
+
+	for (; x + 16 <= samples; x += 16)
+	{
+		const int8x16_t s = vreinterpretq_s8_u8(veorq_u8(vld1q_u8(&src[x]), bias));
+		vst1q_s16(&dst[x], vshll_n_s8(vget_low_s8(s), 8));
+		vst1q_s16(&dst[x + 8], vshll_n_s8(vget_high_s8(s), 8));
+	}
+
+	for (; x < samples; x++)
+		dst[x] = (INT16)((src[x] ^ 0x80) << 8);
+}
+#endif
+
+void freerdp_dsp_init_neon(FREERDP_DSP_KERNELS* kernels)
+{
+#if defined(NEON_INTRINSICS_ENABLED)
+	if (!IsProcessorFeaturePresent(PF_ARM_NEON_INSTRUCTIONS_AVAILABLE))
+		return;
+
+	kernels->dot = dsp_dot_neon;
+	kernels->mono_to_stereo = dsp_mono_to_stereo_neon;
+	kernels->stereo_to_mono = dsp_stereo_to_mono_neon;
+	kernels->u8_to_s16 = dsp_u8_to_s16_neon;
+#else
+	WINPR_UNUSED(kernels);
+#endif
+}
@@ -1,6 +1,6 @@
 /**
  * FreeRDP: A Remote Desktop Protocol Implementation
- * NSCodec Library - SSE2 Optimizations
+ * NSCodec Library - NEON Optimizations
  *
  * Copyright 2024 Armin Novak <anovak@thincast.com>
  * Copyright 2024 Thincast Technologies GmbH
@@ -24,12 +24,200 @@
 #include <freerdp/log.h>
 
 #include "../nsc_types.h"
+#include "../nsc_encode.h"
 #include "nsc_neon.h"
 
 #include "../../core/simd.h"
 
 #if defined(NEON_INTRINSICS_ENABLED)
-#define TAG FREERDP_TAG("codec.nsc.neon")
+#include <arm_neon.h>
+
+#include <winpr/crt.h>
+#include <freerdp/codec/color.h>
+
+static __inline void __attribute__((__gnu_inline__, __always_inline__, __artificial__))
+nsc_encode_pixel_neon(BYTE r, BYTE g, BYTE b, BYTE ccl, BYTE* WINPR_RESTRICT yplane,
+                      BYTE* WINPR_RESTRICT coplane, BYTE* WINPR_RESTRICT cgplane)
+{
+	const INT16 r_val = r;
+	const INT16 g_val = g;
+	const INT16 b_val = b;
+
+	*yplane = (BYTE)((r_val >> 2) + (g_val >> 1) + (b_val >> 2));
+	*coplane = (BYTE)((r_val - b_val) >> ccl);
+	*cgplane = (BYTE)((-(r_val >> 1) + g_val - (b_val >> 1)) >> ccl);
+}
+
+static BOOL nsc_encode_argb_to_aycocg_neon(NSC_CONTEXT* WINPR_RESTRICT context,
+                                           const BYTE* WINPR_RESTRICT data, UINT32 scanline,
+                                           size_t rPos, size_t bPos, BOOL alpha)
+{
+	const UINT32 tempWidth = ROUND_UP_TO(context->width, 8);
+	const size_t rw = (context->ChromaSubsamplingLevel ? tempWidth : context->width);
+	const BYTE ccl = (BYTE)context->ColorLossLevel;
+	const int16x8_t shift = vdupq_n_s16(-(INT16)ccl);
+	size_t y = 0;
+
+	if (context->priv->PlaneBuffersLength < rw * ROUND_UP_TO(context->height, 2))
+		return FALSE;
+
+	for (; y < context->height; y++)
+	{
+		const BYTE* src = data + (context->height - 1 - y) * scanline;
+		BYTE* yplane = context->priv->PlaneBuffers[0] + y * rw;
+		BYTE* coplane = context->priv->PlaneBuffers[1] + y * rw;
+		BYTE* cgplane = context->priv->PlaneBuffers[2] + y * rw;
+		BYTE* aplane = context->priv->PlaneBuffers[3] + y * context->width;
+		size_t x = 0;
+
+		for (; x + 8 <= context->width; x += 8)
+		{
+			const uint8x8x4_t px = vld4_u8(src);
+			const uint8x8_t r = px.val[rPos];
+			const uint8x8_t g = px.val[1];
+			const uint8x8_t b = px.val[bPos];
+
+			/* Y = (R >> 2) + (G >> 1) + (B >> 2) never exceeds 253 */
+			const uint8x8_t yv = vadd_u8(vadd_u8(vshr_n_u8(r, 2), vshr_n_u8(g, 1)), vshr_n_u8(b, 2));
+			vst1_u8(yplane, yv);
+
+			/* Co = (R - B) >> ccl, Cg = (G - (R >> 1) - (B >> 1)) >> ccl, with color loss */
+			const int16x8_t co = vreinterpretq_s16_u16(vsubl_u8(r, b));
+			const int16x8_t cg = vsubq_s16(
+			    vreinterpretq_s16_u16(vsubl_u8(g, vshr_n_u8(r, 1))),
+			    vreinterpretq_s16_u16(vmovl_u8(vshr_n_u8(b, 1))));
+			vst1_u8(coplane, vreinterpret_u8_s8(vmovn_s16(vshlq_s16(co, shift))));
+			vst1_u8(cgplane, vreinterpret_u8_s8(vmovn_s16(vshlq_s16(cg, shift))));
+
+			vst1_u8(aplane, alpha ? px.val[3] : vdup_n_u8(0xFF));
+
+			src += 32;
+			yplane += 8;
+			coplane += 8;
+			cgplane += 8;
+			aplane += 8;
+		}
+
+		for (; x < context->width; x++)
+		{
+			nsc_encode_pixel_neon(src[rPos], src[1], src[bPos], ccl, yplane++, coplane++,
+			                      cgplane++);
+			*aplane++ = alpha ? src[3] : 0xFF;
+			src += 4;
+		}
+
+		if (context->ChromaSubsamplingLevel && (x % 2) == 1)
+		{
+			*yplane = *(yplane - 1);
+			*coplane = *(coplane - 1);
+			*cgplane = *(cgplane - 1);
+		}
+	}
+
+	if (context->ChromaSubsamplingLevel && (y % 2) == 1)
+	{
+		BYTE* yplane = context->priv->PlaneBuffers[0] + y * rw;
+		BYTE* coplane = context->priv->PlaneBuffers[1] + y * rw;
+		BYTE* cgplane = context->priv->PlaneBuffers[2] + y * rw;
+		CopyMemory(yplane, yplane - rw, rw);
+		CopyMemory(coplane, coplane - rw, rw);
+		CopyMemory(cgplane, cgplane - rw, rw);
+	}
+
+	return TRUE;
+}
+
+static __inline void __attribute__((__gnu_inline__, __always_inline__, __artificial__))
+nsc_encode_subsample_plane_neon(BYTE* WINPR_RESTRICT dst, const INT8* WINPR_RESTRICT src0,
+                                const INT8* WINPR_RESTRICT src1, size_t width)
+{
+	size_t x = 0;
+
+	/* Sum 2x2 blocks of signed chroma, 16 source columns per iteration */
+	for (; x + 8 <= width; x += 8)
+	{
+		int16x8_t sum = vpaddlq_s8(vld1q_s8(src0));
+		sum = vpadalq_s8(sum, vld1q_s8(src1));
+		vst1_u8(dst, vreinterpret_u8_s8(vmovn_s16(vshrq_n_s16(sum, 2))));
+		dst += 8;
+		src0 += 16;
+		src1 += 16;
+	}
+
+	for (; x < width; x++)
+	{
+		*dst++ = (BYTE)(((INT16)src0[0] + (INT16)src0[1] + (INT16)src1[0] + (INT16)src1[1]) >> 2);
+		src0 += 2;
+		src1 += 2;
+	}
+}
+
+static BOOL nsc_encode_subsampling_neon(NSC_CONTEXT* WINPR_RESTRICT context)
+{
+	const UINT32 tempWidth = ROUND_UP_TO(context->width, 8);
+	const UINT32 tempHeight = ROUND_UP_TO(context->height, 2);
+
+	if (tempHeight == 0)
+		return FALSE;
+
+	if (tempWidth > context->priv->PlaneBuffersLength / tempHeight)
+		return FALSE;
+
+	for (size_t y = 0; y < tempHeight >> 1; y++)
+	{
+		for (size_t p = 1; p < 3; p++)
+		{
+			BYTE* dst = context->priv->PlaneBuffers[p] + y * (tempWidth >> 1);
+			const INT8* src0 = (const INT8*)context->priv->PlaneBuffers[p] + (y << 1) * tempWidth;
+			const INT8* src1 = src0 + tempWidth;
+			nsc_encode_subsample_plane_neon(dst, src0, src1, tempWidth >> 1);
+		}
+	}
+
+	return TRUE;
+}
+
+static BOOL nsc_encode_neon(NSC_CONTEXT* WINPR_RESTRICT context, const BYTE* WINPR_RESTRICT data,
+                            UINT32 scanline)
+{
+	size_t rPos = 0;
+	size_t bPos = 0;
+	BOOL alpha = FALSE;
+
+	if (!context || !data || (scanline == 0))
+		return FALSE;
+
+	switch (context->format)
+	{
+		case PIXEL_FORMAT_BGRX32:
+		case PIXEL_FORMAT_BGRA32:
+			rPos = 2;
+			bPos = 0;
+			alpha = (context->format == PIXEL_FORMAT_BGRA32);
+			break;
+
+		case PIXEL_FORMAT_RGBX32:
+		case PIXEL_FORMAT_RGBA32:
+			rPos = 0;
+			bPos = 2;
+			alpha = (context->format == PIXEL_FORMAT_RGBA32);
+			break;
+
+		default:
+			return nsc_encode(context, data, scanline);
+	}
+
+	if (!nsc_encode_argb_to_aycocg_neon(context, data, scanline, rPos, bPos, alpha))
+		return FALSE;
+
+	if (context->ChromaSubsamplingLevel)
+	{
+		if (!nsc_encode_subsampling_neon(context))
+			return FALSE;
+	}
+
+	return TRUE;
+}
 #endif
 
 void nsc_init_neon(NSC_CONTEXT* context)
@@ -38,6 +226,9 @@ void nsc_init_neon(NSC_CONTEXT* context)
 	if (!IsProcessorFeaturePresent(PF_ARM_NEON_INSTRUCTIONS_AVAILABLE))
 		return;
 
-	WLog_WARN(TAG, "TODO: Implement neon optimized version of this function");
+	PROFILER_RENAME(context->priv->prof_nsc_encode, "nsc_encode_neon")
+	context->encode = nsc_encode_neon;
+#else
+	WINPR_UNUSED(context);
 #endif
 }
@@ -521,6 +521,138 @@ static void rfx_dwt_2d_extrapolate_decode_neon(INT16* buffer, INT16* temp)
 	rfx_dwt_2d_decode_extrapolate_block_neon(&buffer[3007], temp, 2);
 	rfx_dwt_2d_decode_extrapolate_block_neon(&buffer[0], temp, 1);
 }
+
+static __inline void __attribute__((__gnu_inline__, __always_inline__, __artificial__))
+rfx_quantization_encode_block_NEON(INT16* WINPR_RESTRICT buffer, const size_t buffer_size,
+                                   const UINT32 factor)
+{
+	if (factor == 0)
+		return;
+
+	/* The rounding shift computes (val + (1 << (factor - 1))) >> factor without overflow */
+	const int16x8_t shift = vdupq_n_s16(-(INT16)factor);
+
+	for (size_t x = 0; x < buffer_size; x += 8)
+	{
+		const int16x8_t val = vld1q_s16(&buffer[x]);
+		vst1q_s16(&buffer[x], vrshlq_s16(val, shift));
+	}
+}
+
+static void rfx_quantization_encode_NEON(INT16* WINPR_RESTRICT buffer,
+                                         const UINT32* WINPR_RESTRICT quantization_values)
+{
+	WINPR_ASSERT(buffer);
+	WINPR_ASSERT(quantization_values);
+
+	rfx_quantization_encode_block_NEON(buffer, 1024, quantization_values[8] - 6);        /* HL1 */
+	rfx_quantization_encode_block_NEON(buffer + 1024, 1024, quantization_values[7] - 6); /* LH1 */
+	rfx_quantization_encode_block_NEON(buffer + 2048, 1024, quantization_values[9] - 6); /* HH1 */
+	rfx_quantization_encode_block_NEON(buffer + 3072, 256, quantization_values[5] - 6);  /* HL2 */
+	rfx_quantization_encode_block_NEON(buffer + 3328, 256, quantization_values[4] - 6);  /* LH2 */
+	rfx_quantization_encode_block_NEON(buffer + 3584, 256, quantization_values[6] - 6);  /* HH2 */
+	rfx_quantization_encode_block_NEON(buffer + 3840, 64, quantization_values[2] - 6);   /* HL3 */
+	rfx_quantization_encode_block_NEON(buffer + 3904, 64, quantization_values[1] - 6);   /* LH3 */
+	rfx_quantization_encode_block_NEON(buffer + 3968, 64, quantization_values[3] - 6);   /* HH3 */
+	rfx_quantization_encode_block_NEON(buffer + 4032, 64, quantization_values[0] - 6);   /* LL3 */
+	rfx_quantization_encode_block_NEON(buffer, 4096, 5);
+}
+
+/* The halving add and subtract keep the intermediate sums of the generic version exact */
+static __inline void __attribute__((__gnu_inline__, __always_inline__, __artificial__))
+rfx_dwt_2d_encode_block_vert_NEON(const INT16* WINPR_RESTRICT src, INT16* WINPR_RESTRICT l,
+                                  INT16* WINPR_RESTRICT h, size_t subband_width)
+{
+	const size_t total_width = subband_width << 1;
+
+	for (size_t n = 0; n < subband_width; n++)
+	{
+		for (size_t x = 0; x < total_width; x += 8)
+		{
+			const int16x8_t src_2n = vld1q_s16(src);
+			const int16x8_t src_2n_1 = vld1q_s16(src + total_width);
+			const int16x8_t src_2n_2 =
+			    (n < subband_width - 1) ? vld1q_s16(src + 2ULL * total_width) : src_2n;
+
+			/* h[n] = (src[2n + 1] - ((src[2n] + src[2n + 2]) >> 1)) >> 1 */
+			const int16x8_t h_n = vhsubq_s16(src_2n_1, vhaddq_s16(src_2n, src_2n_2));
+			vst1q_s16(h, h_n);
+
+			/* l[n] = src[2n] + ((h[n - 1] + h[n]) >> 1) */
+			const int16x8_t h_n_m = (n == 0) ? h_n : vld1q_s16(h - total_width);
+			vst1q_s16(l, vaddq_s16(src_2n, vhaddq_s16(h_n_m, h_n)));
+
+			src += 8;
+			l += 8;
+			h += 8;
+		}
+
+		src += total_width;
+	}
+}
+
+static __inline void __attribute__((__gnu_inline__, __always_inline__, __artificial__))
+rfx_dwt_2d_encode_block_horiz_NEON(const INT16* WINPR_RESTRICT src, INT16* WINPR_RESTRICT l,
+                                   INT16* WINPR_RESTRICT h, size_t subband_width)
+{
+	for (size_t y = 0; y < subband_width; y++)
+	{
+		int16x8_t h_prev = vdupq_n_s16(0);
+
+		for (size_t n = 0; n < subband_width; n += 8)
+		{
+			/* even samples src[2n] in val[0], odd samples src[2n + 1] in val[1] */
+			const int16x8x2_t s = vld2q_s16(src);
+			const INT16 next = (n < subband_width - 8) ? src[16] : src[14];
+			const int16x8_t src_2n_2 = vextq_s16(s.val[0], vdupq_n_s16(next), 1);
+
+			/* h[n] = (src[2n + 1] - ((src[2n] + src[2n + 2]) >> 1)) >> 1 */
+			const int16x8_t h_n = vhsubq_s16(s.val[1], vhaddq_s16(s.val[0], src_2n_2));
+			vst1q_s16(h, h_n);
+
+			/* l[n] = src[2n] + ((h[n - 1] + h[n]) >> 1), h[-1] = h[0] */
+			if (n == 0)
+				h_prev = vdupq_n_s16(vgetq_lane_s16(h_n, 0));
+
+			const int16x8_t h_n_m = vextq_s16(h_prev, h_n, 7);
+			vst1q_s16(l, vaddq_s16(s.val[0], vhaddq_s16(h_n_m, h_n)));
+			h_prev = h_n;
+
+			src += 16;
+			l += 8;
+			h += 8;
+		}
+	}
+}
+
+static __inline void __attribute__((__gnu_inline__, __always_inline__, __artificial__))
+rfx_dwt_2d_encode_block_NEON(INT16* WINPR_RESTRICT buffer, INT16* WINPR_RESTRICT dwt,
+                             size_t subband_width)
+{
+	/* DWT in vertical direction, results in 2 sub-bands in L, H order in tmp buffer dwt. */
+	INT16* l_src = dwt;
+	INT16* h_src = dwt + 2ULL * subband_width * subband_width;
+	rfx_dwt_2d_encode_block_vert_NEON(buffer, l_src, h_src, subband_width);
+
+	/* DWT in horizontal direction, results in 4 sub-bands in HL(0), LH(1), HH(2), LL(3) order,
+	 * stored in original buffer. */
+	INT16* ll = buffer + 3ULL * subband_width * subband_width;
+	INT16* hl = buffer;
+	INT16* lh = buffer + 1ULL * subband_width * subband_width;
+	INT16* hh = buffer + 2ULL * subband_width * subband_width;
+	rfx_dwt_2d_encode_block_horiz_NEON(l_src, ll, hl, subband_width);
+	rfx_dwt_2d_encode_block_horiz_NEON(h_src, lh, hh, subband_width);
+}
+
+static void rfx_dwt_2d_encode_NEON(INT16* WINPR_RESTRICT buffer, INT16* WINPR_RESTRICT dwt_buffer)
+{
+	WINPR_ASSERT(buffer);
+	WINPR_ASSERT(dwt_buffer);
+
+	rfx_dwt_2d_encode_block_NEON(&buffer[0], dwt_buffer, 32);
+	rfx_dwt_2d_encode_block_NEON(&buffer[3072], dwt_buffer, 16);
+	rfx_dwt_2d_encode_block_NEON(&buffer[3840], dwt_buffer, 8);
+}
 #endif // NEON_INTRINSICS_ENABLED
 
 void rfx_init_neon(RFX_CONTEXT* context)
@@ -533,8 +665,13 @@ void rfx_init_neon(RFX_CONTEXT* context)
 		PROFILER_RENAME(context->priv->prof_rfx_quantization_decode,
 		                "rfx_quantization_decode_NEON");
 		PROFILER_RENAME(context->priv->prof_rfx_dwt_2d_decode, "rfx_dwt_2d_decode_NEON");
+		PROFILER_RENAME(context->priv->prof_rfx_quantization_encode,
+		                "rfx_quantization_encode_NEON");
+		PROFILER_RENAME(context->priv->prof_rfx_dwt_2d_encode, "rfx_dwt_2d_encode_NEON");
 		context->quantization_decode = rfx_quantization_decode_NEON;
 		context->dwt_2d_decode = rfx_dwt_2d_decode_NEON;
+		context->quantization_encode = rfx_quantization_encode_NEON;
+		context->dwt_2d_encode = rfx_dwt_2d_encode_NEON;
 		context->dwt_2d_extrapolate_decode = rfx_dwt_2d_extrapolate_decode_neon;
 	}
 #else
@@ -39,6 +39,7 @@
 #include "rfx_constants.h"
 #include "rfx_types.h"
 #include "progressive.h"
+#include "progressive_encode.h"
 
 #define TAG FREERDP_TAG("codec.progressive")
 
@@ -1058,6 +1059,20 @@ fail:
 	return rc;
 }
 
+static INLINE UINT32 progressive_rfx_clz(UINT32 x)
+{
+	if (!x)
+		return 32;
+#if defined(__GNUC__) || defined(__clang__)
+	return (UINT32)__builtin_clz(x);
+#else
+	UINT32 n = 0;
+	for (; !(x & 0x80000000); x <<= 1)
+		n++;
+	return n;
+#endif
+}
+
 static INLINE INT16 progressive_rfx_srl_read(RFX_PROGRESSIVE_UPGRADE_STATE* WINPR_RESTRICT state,
                                              UINT32 numBits)
 {
@@ -1130,15 +1145,20 @@ static INLINE INT16 progressive_rfx_srl_read(RFX_PROGRESSIVE_UPGRADE_STATE* WINP
 	UINT32 mag = 1;
 	const UINT32 max = (1 << numBits) - 1;
 
+	/* (mag - 1) '0' bits, terminated by a '1' bit unless mag reaches max */
 	while (mag < max)
 	{
-		const UINT32 bit = (bs->accumulator & 0x80000000) ? 1 : 0;
-		BitStream_Shift(bs, 1);
+		const UINT32 zeros = MIN(progressive_rfx_clz(bs->accumulator), 31);
+		const UINT32 count = MIN(zeros, max - mag);
 
-		if (bit)
+		if (!count)
+		{
+			BitStream_Shift(bs, 1);
 			break;
+		}
 
-		mag++;
+		BitStream_Shift(bs, count);
+		mag += count;
 	}
 
 	if (mag > INT16_MAX)
@@ -1781,16 +1801,15 @@ static INLINE SSIZE_T progressive_process_tiles(
 		{
 			progressive->work_objects[idx] =
 			    CreateThreadpoolWork(progressive_process_tiles_tile_work_callback, (void*)param,
-			                         &progressive->rfx_context->priv->ThreadPoolEnv);
+			                         rfx_get_callback_environment(progressive->rfx_context));
 			if (!progressive->work_objects[idx])
 			{
 				WLog_Print(progressive->log, WLOG_ERROR,
 				           "Failed to create ThreadpoolWork for tile %" PRIu32, idx);
 				status = -1;
-				break;
+				goto fail;
 			}
 
-			SubmitThreadpoolWork(progressive->work_objects[idx]);
 			close_cnt = idx + 1;
 		}
 		else
@@ -1808,6 +1827,8 @@ static INLINE SSIZE_T progressive_process_tiles(
 
 	if (progressive->rfx_context->priv->UseThreads)
 	{
+		winpr_SubmitThreadpoolWorkBatch(progressive->work_objects, close_cnt);
+
 		for (UINT32 idx = 0; idx < close_cnt; idx++)
 		{
 			WaitForThreadpoolWorkCallbacks(progressive->work_objects[idx], FALSE);
@@ -1818,7 +1839,15 @@ static INLINE SSIZE_T progressive_process_tiles(
 fail:
 
 	if (status < 0)
+	{
+		/* Work objects are only submitted once all of them were created, none of these ran */
+		if (progressive->rfx_context->priv->UseThreads)
+		{
+			for (UINT32 idx = 0; idx < close_cnt; idx++)
+				CloseThreadpoolWork(progressive->work_objects[idx]);
+		}
 		return -1;
+	}
 
 	return (SSIZE_T)(end - start);
 }
@@ -2317,18 +2346,30 @@ static INLINE BOOL update_tiles(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
 {
 	BOOL rc = TRUE;
 	REGION16 clippingRects = { 0 };
+	RECTANGLE_16* rects = NULL;
+	size_t nbRects = 0;
+	size_t maxRects = region->numRects;
 	region16_init(&clippingRects);
 
+	rects = calloc(maxRects + 1ull, sizeof(RECTANGLE_16));
+	if (!rects)
+		return FALSE;
+
 	for (UINT32 i = 0; i < region->numRects; i++)
 	{
-		RECTANGLE_16 clippingRect = { 0 };
+		RECTANGLE_16* clippingRect = &rects[i];
 		const RFX_RECT* rect = &(region->rects[i]);
 
-		clippingRect.left = (UINT16)nXDst + rect->x;
-		clippingRect.top = (UINT16)nYDst + rect->y;
-		clippingRect.right = clippingRect.left + rect->width;
-		clippingRect.bottom = clippingRect.top + rect->height;
-		region16_union_rect(&clippingRects, &clippingRects, &clippingRect);
+		clippingRect->left = (UINT16)nXDst + rect->x;
+		clippingRect->top = (UINT16)nYDst + rect->y;
+		clippingRect->right = clippingRect->left + rect->width;
+		clippingRect->bottom = clippingRect->top + rect->height;
+	}
+
+	if (!region16_union_rects(&clippingRects, &clippingRects, rects, region->numRects))
+	{
+		rc = FALSE;
+		goto fail;
 	}
 
 	for (UINT32 i = 0; i < surface->numUpdatedTiles; i++)
@@ -2374,15 +2415,31 @@ static INLINE BOOL update_tiles(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
 			if (!rc)
 				break;
 
-			if (invalidRegion)
-				region16_union_rect(invalidRegion, invalidRegion, rect);
+			/* collect the updated areas, they are added to invalidRegion in one go */
+			if (nbRects >= maxRects)
+			{
+				maxRects = MAX(64, maxRects * 2);
+				RECTANGLE_16* tmp = realloc(rects, maxRects * sizeof(RECTANGLE_16));
+				if (!tmp)
+				{
+					region16_uninit(&updateRegion);
+					rc = FALSE;
+					goto fail;
+				}
+				rects = tmp;
+			}
+			rects[nbRects++] = *rect;
 		}
 
 		region16_uninit(&updateRegion);
 		tile->dirty = FALSE;
 	}
 
+	if (rc && invalidRegion)
+		rc = region16_union_rects(invalidRegion, invalidRegion, rects, (UINT32)nbRects);
+
 fail:
+	free(rects);
 	region16_uninit(&clippingRects);
 	return rc;
 }
@@ -2518,7 +2575,9 @@ int progressive_compress(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
 	else
 		numRects = region16_n_rects(invalidRegion);
 
-	if (numRects == 0)
+	/* Upgrade passes of static tiles are sent even without changes */
+	const BOOL passes = progressive->encoder && (progressive->bandwidth > 0);
+	if ((numRects == 0) && (!passes || !progressive_encoder_pending(progressive->encoder)))
 		return 0;
 
 	if (!Stream_EnsureCapacity(progressive->rects, numRects * sizeof(RFX_RECT)))
@@ -2571,6 +2630,16 @@ int progressive_compress(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
 	progressive->rfx_context->width = Width;
 	progressive->rfx_context->height = Height;
 	rfx_context_set_pixel_format(progressive->rfx_context, SrcFormat);
+
+	if (passes)
+	{
+		const int status = progressive_encoder_write_message(progressive, s, pSrcData, Width,
+		                                                     Height, ScanLine, rects, numRects);
+		if (status <= 0)
+			return status;
+		goto out;
+	}
+
 	message = rfx_encode_message(progressive->rfx_context, rects, numRects, pSrcData, Width, Height,
 	                             ScanLine);
 	if (!message)
@@ -2584,6 +2653,7 @@ int progressive_compress(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
 	if (!rc)
 		goto fail;
 
+out:;
 	const size_t pos = Stream_GetPosition(s);
 	WINPR_ASSERT(pos <= UINT32_MAX);
 	*pDstSize = (UINT32)pos;
@@ -2598,9 +2668,49 @@ BOOL progressive_context_reset(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive)
 	if (!progressive)
 		return FALSE;
 
+	progressive_encoder_reset(progressive->encoder);
+	return TRUE;
+}
+
+BOOL progressive_context_set_callback_environment(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+                                                  PTP_CALLBACK_ENVIRON pcbe)
+{
+	if (!progressive)
+		return FALSE;
+
+	return rfx_context_set_callback_environment(progressive->rfx_context, pcbe);
+}
+
+BOOL progressive_compress_set_bandwidth(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+                                        UINT32 bytesPerFrame)
+{
+	if (!progressive || !progressive->Compressor)
+		return FALSE;
+
+	if (bytesPerFrame == 0)
+	{
+		progressive_encoder_free(progressive->encoder);
+		progressive->encoder = NULL;
+	}
+	else if (!progressive->encoder)
+	{
+		progressive->encoder = progressive_encoder_new();
+		if (!progressive->encoder)
+			return FALSE;
+	}
+
+	progressive->bandwidth = bytesPerFrame;
 	return TRUE;
 }
 
+BOOL progressive_compress_has_upgrades(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive)
+{
+	if (!progressive || (progressive->bandwidth == 0))
+		return FALSE;
+
+	return progressive_encoder_pending(progressive->encoder);
+}
+
 PROGRESSIVE_CONTEXT* progressive_context_new(BOOL Compressor)
 {
 	return progressive_context_new_ex(Compressor, 0);
@@ -2656,6 +2766,7 @@ void progressive_context_free(PROGRESSIVE_CONTEXT* progressive)
 
 	Stream_Free(progressive->buffer, TRUE);
 	Stream_Free(progressive->rects, TRUE);
+	progressive_encoder_free(progressive->encoder);
 	rfx_context_free(progressive->rfx_context);
 
 	BufferPool_Free(progressive->bufferPool);
@@ -142,6 +142,7 @@ typedef struct
 
 typedef struct S_PROGRESSIVE_CONTEXT PROGRESSIVE_CONTEXT;
 typedef struct S_PROGRESSIVE_BLOCK_REGION PROGRESSIVE_BLOCK_REGION;
+typedef struct S_PROGRESSIVE_ENCODER PROGRESSIVE_ENCODER;
 
 typedef struct
 {
@@ -230,6 +231,9 @@ struct S_PROGRESSIVE_CONTEXT
 	RFX_CONTEXT* rfx_context;
 	PROGRESSIVE_TILE_PROCESS_WORK_PARAM params[0x10000];
 	PTP_WORK work_objects[0x10000];
+
+	UINT32 bandwidth; /* bytes per frame, 0 sends every tile at full quality */
+	PROGRESSIVE_ENCODER* encoder;
 };
 
 #endif /* INTERNAL_CODEC_PROGRESSIVE_H */
@@ -0,0 +1,945 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Progressive Codec Bitmap Compression - first and upgrade passes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <stdlib.h>
+
+#include <winpr/assert.h>
+#include <winpr/crt.h>
+#include <winpr/pool.h>
+
+#include <freerdp/log.h>
+#include <freerdp/codec/color.h>
+
+#include "rfx_bitstream.h"
+#include "rfx_constants.h"
+#include "rfx_differential.h"
+#include "rfx_dwt.h"
+#include "rfx_encode.h"
+#include "rfx_types.h"
+#include "progressive_encode.h"
+
+#define TAG FREERDP_TAG("codec.progressive")
+
+#define PROGRESSIVE_RLGR_SIZE 4096
+#define PROGRESSIVE_SRL_SIZE 0x2000
+#define PROGRESSIVE_RAW_SIZE 0x800
+#define PROGRESSIVE_FIRST_HEADER_LENGTH 23
+#define PROGRESSIVE_UPGRADE_HEADER_LENGTH 26
+
+typedef struct
+{
+	BOOL valid;
+	BYTE quality;  /* index of the last pass sent, ARRAYSIZE(progressive_encoder_levels) is full */
+	UINT32 frame;  /* frame the tile was last sent in */
+	INT16* coeffs; /* Y, Cb and Cr coefficients quantized for full quality */
+} PROGRESSIVE_ENCODER_TILE;
+
+typedef struct
+{
+	PROGRESSIVE_CONTEXT* progressive;
+	PROGRESSIVE_ENCODER_TILE* tile;
+	UINT32 index;
+	const BYTE* data;
+	UINT32 width;
+	UINT32 height;
+	UINT32 scanline;
+	BYTE* dst;
+	UINT16 len[3];
+	BOOL success;
+} PROGRESSIVE_ENCODER_WORK_PARAM;
+
+typedef struct
+{
+	UINT16 offset;
+	UINT16 length;
+} PROGRESSIVE_ENCODER_BAND;
+
+typedef struct
+{
+	UINT32 kp;
+	UINT32 run;
+} PROGRESSIVE_ENCODER_SRL_STATE;
+
+struct S_PROGRESSIVE_ENCODER
+{
+	UINT32 width;
+	UINT32 height;
+	UINT32 gridWidth;
+	UINT32 gridHeight;
+	UINT32 gridSize;
+	PROGRESSIVE_ENCODER_TILE* tiles;
+	UINT32 frameIdx;
+	UINT32 cursor;
+
+	UINT32* dirty;
+	PROGRESSIVE_ENCODER_WORK_PARAM* params;
+	PTP_WORK* work;
+	BYTE* first;
+	size_t firstSize;
+
+	BYTE* upgrade;
+	RFX_RECT* rects;
+	size_t rectsSize;
+	wStream* tilesStream;
+};
+
+/* RFX_COMPONENT_CODEC_QUANT order: LL3, HL3, LH3, HH3, HL2, LH2, HH2, HL1, LH1, HH1 */
+static const RFX_COMPONENT_CODEC_QUANT progressive_encoder_quant = { 6, 6, 6, 6, 7, 7, 8, 8, 8, 9 };
+static const RFX_COMPONENT_CODEC_QUANT progressive_encoder_quant_full = { 0 };
+
+/**
+ * Progressive quantization of the passes before the final one, which uses quality 0xFF
+ * (all 0). Every level may only lower the values of the previous one, the difference is the
+ * number of bit planes an upgrade pass adds to a band.
+ */
+static const RFX_PROGRESSIVE_CODEC_QUANT progressive_encoder_levels[] = {
+	{ 25,
+	  { 2, 3, 3, 3, 4, 4, 4, 4, 4, 4 },
+	  { 2, 3, 3, 3, 4, 4, 4, 4, 4, 4 },
+	  { 2, 3, 3, 3, 4, 4, 4, 4, 4, 4 } },
+	{ 50,
+	  { 1, 2, 2, 2, 2, 2, 3, 3, 3, 3 },
+	  { 1, 2, 2, 2, 2, 2, 3, 3, 3, 3 },
+	  { 1, 2, 2, 2, 2, 2, 3, 3, 3, 3 } },
+	{ 75,
+	  { 0, 1, 1, 1, 1, 1, 1, 2, 2, 2 },
+	  { 0, 1, 1, 1, 1, 1, 1, 2, 2, 2 },
+	  { 0, 1, 1, 1, 1, 1, 1, 2, 2, 2 } }
+};
+
+#define PROGRESSIVE_ENCODER_LEVELS ARRAYSIZE(progressive_encoder_levels)
+
+/* Bands of the reduce extrapolate layout in the order upgrade passes code them, LL3 last */
+static const PROGRESSIVE_ENCODER_BAND progressive_encoder_bands[] = {
+	{ 0, 1023 },   /* HL1 */
+	{ 1023, 1023 }, /* LH1 */
+	{ 2046, 961 }, /* HH1 */
+	{ 3007, 272 }, /* HL2 */
+	{ 3279, 272 }, /* LH2 */
+	{ 3551, 256 }, /* HH2 */
+	{ 3807, 72 },  /* HL3 */
+	{ 3879, 72 },  /* LH3 */
+	{ 3951, 64 },  /* HH3 */
+	{ 4015, 81 }   /* LL3 */
+};
+
+#define PROGRESSIVE_ENCODER_BANDS ARRAYSIZE(progressive_encoder_bands)
+
+static void progressive_encoder_band_values(const RFX_COMPONENT_CODEC_QUANT* WINPR_RESTRICT q,
+                                            BYTE values[PROGRESSIVE_ENCODER_BANDS])
+{
+	values[0] = q->HL1;
+	values[1] = q->LH1;
+	values[2] = q->HH1;
+	values[3] = q->HL2;
+	values[4] = q->LH2;
+	values[5] = q->HH2;
+	values[6] = q->HL3;
+	values[7] = q->LH3;
+	values[8] = q->HH3;
+	values[9] = q->LL3;
+}
+
+static const RFX_COMPONENT_CODEC_QUANT* progressive_encoder_level(BYTE quality, size_t component)
+{
+	if (quality >= PROGRESSIVE_ENCODER_LEVELS)
+		return &progressive_encoder_quant_full;
+
+	const RFX_PROGRESSIVE_CODEC_QUANT* level = &progressive_encoder_levels[quality];
+	switch (component)
+	{
+		case 0:
+			return &level->yQuantValues;
+		case 1:
+			return &level->cbQuantValues;
+		default:
+			return &level->crQuantValues;
+	}
+}
+
+static BYTE progressive_encoder_quality(BYTE quality)
+{
+	return (quality >= PROGRESSIVE_ENCODER_LEVELS) ? 0xFF : quality;
+}
+
+/* Non LL bands are coded as sign and magnitude, so a coarse pass truncates the magnitude.
+ * LL3 upgrades add unsigned RAW bits, the coarse value is rounded down instead. */
+static INLINE INT16 progressive_encoder_coarse(INT16 value, UINT32 shift, BOOL ll)
+{
+	if (ll)
+		return (INT16)(value >> shift);
+
+	const INT32 mag = abs(value) >> shift;
+	return (INT16)((value < 0) ? -mag : mag);
+}
+
+static int progressive_encoder_first_component(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+                                               INT16* WINPR_RESTRICT buffer,
+                                               INT16* WINPR_RESTRICT temp,
+                                               INT16* WINPR_RESTRICT coeffs,
+                                               const RFX_COMPONENT_CODEC_QUANT* WINPR_RESTRICT prog,
+                                               BYTE* WINPR_RESTRICT dst)
+{
+	BYTE quant[PROGRESSIVE_ENCODER_BANDS] = { 0 };
+	BYTE shift[PROGRESSIVE_ENCODER_BANDS] = { 0 };
+
+	progressive_encoder_band_values(&progressive_encoder_quant, quant);
+	progressive_encoder_band_values(prog, shift);
+
+	rfx_dwt_2d_extrapolate_encode(buffer, temp);
+
+	for (size_t band = 0; band < PROGRESSIVE_ENCODER_BANDS; band++)
+	{
+		const PROGRESSIVE_ENCODER_BAND* b = &progressive_encoder_bands[band];
+		const BOOL ll = (band == PROGRESSIVE_ENCODER_BANDS - 1);
+
+		/* The coefficients are scaled by << 5 at RGB->YCbCr phase, -6 + 5 = -1 */
+		const UINT32 factor = quant[band] - 1;
+		const INT32 half = 1 << (factor - 1);
+
+		for (size_t x = b->offset; x < 1ull * b->offset + b->length; x++)
+		{
+			const INT32 value = buffer[x];
+			INT32 full = 0;
+
+			if (ll)
+				full = (value + half) >> factor;
+			else
+			{
+				const INT32 mag = (abs(value) + half) >> factor;
+				full = (value < 0) ? -mag : mag;
+			}
+
+			coeffs[x] = (INT16)full;
+			buffer[x] = progressive_encoder_coarse((INT16)full, shift[band], ll);
+		}
+	}
+
+	rfx_differential_encode(&buffer[4015], 81);
+	return progressive->rfx_context->rlgr_encode(RLGR1, buffer, 4096, dst, PROGRESSIVE_RLGR_SIZE);
+}
+
+static BOOL progressive_encoder_first_tile(PROGRESSIVE_ENCODER_WORK_PARAM* WINPR_RESTRICT param)
+{
+	BOOL rc = FALSE;
+	INT16* pSrcDst[3] = { 0 };
+	PROGRESSIVE_CONTEXT* progressive = param->progressive;
+	BYTE* pBuffer = BufferPool_Take(progressive->bufferPool, -1);
+	INT16* temp = BufferPool_Take(progressive->bufferPool, -1); /* DWT buffer */
+
+	if (!pBuffer || !temp)
+		goto fail;
+
+	pSrcDst[0] = (INT16*)((&pBuffer[((8192 + 32) * 0) + 16])); /* Y/R buffer */
+	pSrcDst[1] = (INT16*)((&pBuffer[((8192 + 32) * 1) + 16])); /* Cb/G buffer */
+	pSrcDst[2] = (INT16*)((&pBuffer[((8192 + 32) * 2) + 16])); /* Cr/B buffer */
+
+	rfx_encode_tile_ycbcr(progressive->rfx_context, param->data, param->width, param->height,
+	                      param->scanline, pSrcDst);
+
+	/* The RLGR encoder expects the output buffer to be initialized to zero */
+	ZeroMemory(param->dst, 3ull * PROGRESSIVE_RLGR_SIZE);
+
+	for (size_t c = 0; c < 3; c++)
+	{
+		const int len = progressive_encoder_first_component(
+		    progressive, pSrcDst[c], temp, &param->tile->coeffs[4096 * c],
+		    progressive_encoder_level(0, c), &param->dst[PROGRESSIVE_RLGR_SIZE * c]);
+		if ((len < 0) || (len > PROGRESSIVE_RLGR_SIZE))
+			goto fail;
+		param->len[c] = (UINT16)len;
+	}
+
+	rc = TRUE;
+fail:
+	if (pBuffer)
+		BufferPool_Return(progressive->bufferPool, pBuffer);
+	if (temp)
+		BufferPool_Return(progressive->bufferPool, temp);
+	return rc;
+}
+
+static void CALLBACK progressive_encoder_tile_work_callback(PTP_CALLBACK_INSTANCE instance,
+                                                            void* context, PTP_WORK work)
+{
+	PROGRESSIVE_ENCODER_WORK_PARAM* param = (PROGRESSIVE_ENCODER_WORK_PARAM*)context;
+
+	WINPR_UNUSED(instance);
+	WINPR_UNUSED(work);
+
+	param->success = progressive_encoder_first_tile(param);
+}
+
+/* The counterpart of progressive_rfx_srl_read */
+static INLINE void
+progressive_encoder_srl_write(PROGRESSIVE_ENCODER_SRL_STATE* WINPR_RESTRICT state,
+                              RFX_BITSTREAM* WINPR_RESTRICT srl, INT32 value, UINT32 numBits)
+{
+	const UINT32 k = state->kp / 8;
+
+	if (value == 0)
+	{
+		/* '0' bit, a run of (1 << k) zeros */
+		state->run++;
+		if (state->run == (1u << k))
+		{
+			rfx_bitstream_put_bits(srl, 0, 1);
+			state->kp = MIN(state->kp + 4, 80);
+			state->run = 0;
+		}
+		return;
+	}
+
+	/* '1' bit, the k bit zero run length, sign and the unary coded magnitude */
+	rfx_bitstream_put_bits(srl, 1, 1);
+	if (k)
+		rfx_bitstream_put_bits(srl, state->run, k);
+	state->run = 0;
+
+	rfx_bitstream_put_bits(srl, (value < 0) ? 1 : 0, 1);
+	state->kp = (state->kp < 6) ? 0 : state->kp - 6;
+
+	if (numBits == 1)
+		return;
+
+	const UINT32 mag = (UINT32)abs(value);
+	const UINT32 max = (1u << numBits) - 1;
+	UINT32 zeros = mag - 1;
+
+	while (zeros > 0)
+	{
+		const UINT32 count = MIN(zeros, 16);
+		rfx_bitstream_put_bits(srl, 0, count);
+		zeros -= count;
+	}
+
+	if (mag < max)
+		rfx_bitstream_put_bits(srl, 1, 1);
+}
+
+/* The counterpart of progressive_rfx_upgrade_component */
+static BOOL
+progressive_encoder_upgrade_component(const INT16* WINPR_RESTRICT coeffs,
+                                      const RFX_COMPONENT_CODEC_QUANT* WINPR_RESTRICT from,
+                                      const RFX_COMPONENT_CODEC_QUANT* WINPR_RESTRICT to,
+                                      BYTE* WINPR_RESTRICT srlData, UINT16* WINPR_RESTRICT srlLen,
+                                      BYTE* WINPR_RESTRICT rawData, UINT16* WINPR_RESTRICT rawLen)
+{
+	RFX_BITSTREAM srlStream = { 0 };
+	RFX_BITSTREAM rawStream = { 0 };
+	RFX_BITSTREAM* srl = &srlStream;
+	RFX_BITSTREAM* raw = &rawStream;
+	PROGRESSIVE_ENCODER_SRL_STATE state = { 8, 0 };
+	BYTE fromBits[PROGRESSIVE_ENCODER_BANDS] = { 0 };
+	BYTE toBits[PROGRESSIVE_ENCODER_BANDS] = { 0 };
+
+	progressive_encoder_band_values(from, fromBits);
+	progressive_encoder_band_values(to, toBits);
+
+	ZeroMemory(srlData, PROGRESSIVE_SRL_SIZE);
+	ZeroMemory(rawData, PROGRESSIVE_RAW_SIZE);
+	rfx_bitstream_attach(srl, srlData, PROGRESSIVE_SRL_SIZE);
+	rfx_bitstream_attach(raw, rawData, PROGRESSIVE_RAW_SIZE);
+
+	for (size_t band = 0; band < PROGRESSIVE_ENCODER_BANDS; band++)
+	{
+		const PROGRESSIVE_ENCODER_BAND* b = &progressive_encoder_bands[band];
+		const BOOL ll = (band == PROGRESSIVE_ENCODER_BANDS - 1);
+
+		/* A pending zero run ends the SRL data of the non LL bands */
+		if (ll && (state.run > 0))
+			rfx_bitstream_put_bits(srl, 0, 1);
+
+		if (fromBits[band] < toBits[band])
+			return FALSE;
+
+		const UINT32 numBits = fromBits[band] - toBits[band];
+		if (numBits == 0)
+			continue;
+
+		const UINT32 mask = (1u << numBits) - 1;
+		for (size_t x = b->offset; x < 1ull * b->offset + b->length; x++)
+		{
+			const INT32 value = coeffs[x];
+
+			if (ll)
+			{
+				rfx_bitstream_put_bits(raw, (UINT32)(value >> toBits[band]) & mask, numBits);
+				continue;
+			}
+
+			const UINT32 mag = (UINT32)abs(value);
+			if ((mag >> fromBits[band]) != 0)
+			{
+				/* significant since an earlier pass, the sign is known */
+				rfx_bitstream_put_bits(raw, (mag >> toBits[band]) & mask, numBits);
+			}
+			else
+			{
+				const INT32 v = (INT32)(mag >> toBits[band]);
+				progressive_encoder_srl_write(&state, srl, (value < 0) ? -v : v, numBits);
+			}
+		}
+	}
+
+	if (rfx_bitstream_eos(srl) || rfx_bitstream_eos(raw))
+		return FALSE;
+
+	*srlLen = (UINT16)rfx_bitstream_get_processed_bytes(srl);
+	*rawLen = (UINT16)rfx_bitstream_get_processed_bytes(raw);
+	return TRUE;
+}
+
+static void
+progressive_component_codec_quant_write(wStream* WINPR_RESTRICT s,
+                                        const RFX_COMPONENT_CODEC_QUANT* WINPR_RESTRICT q)
+{
+	Stream_Write_UINT8(s, (BYTE)(q->LL3 | (q->HL3 << 4))); /* LL3 (4-bit), HL3 (4-bit) */
+	Stream_Write_UINT8(s, (BYTE)(q->LH3 | (q->HH3 << 4))); /* LH3 (4-bit), HH3 (4-bit) */
+	Stream_Write_UINT8(s, (BYTE)(q->HL2 | (q->LH2 << 4))); /* HL2 (4-bit), LH2 (4-bit) */
+	Stream_Write_UINT8(s, (BYTE)(q->HH2 | (q->HL1 << 4))); /* HH2 (4-bit), HL1 (4-bit) */
+	Stream_Write_UINT8(s, (BYTE)(q->LH1 | (q->HH1 << 4))); /* LH1 (4-bit), HH1 (4-bit) */
+}
+
+static BOOL
+progressive_encoder_write_first(const PROGRESSIVE_ENCODER* WINPR_RESTRICT encoder,
+                                wStream* WINPR_RESTRICT s,
+                                const PROGRESSIVE_ENCODER_WORK_PARAM* WINPR_RESTRICT param)
+{
+	const UINT32 blockLen =
+	    PROGRESSIVE_FIRST_HEADER_LENGTH + param->len[0] + param->len[1] + param->len[2];
+
+	if (!Stream_EnsureRemainingCapacity(s, blockLen))
+		return FALSE;
+
+	Stream_Write_UINT16(s, PROGRESSIVE_WBT_TILE_FIRST);                 /* blockType (2 bytes) */
+	Stream_Write_UINT32(s, blockLen);                                   /* blockLen (4 bytes) */
+	Stream_Write_UINT8(s, 0);                                           /* quantIdxY (1 byte) */
+	Stream_Write_UINT8(s, 0);                                           /* quantIdxCb (1 byte) */
+	Stream_Write_UINT8(s, 0);                                           /* quantIdxCr (1 byte) */
+	Stream_Write_UINT16(s, (UINT16)(param->index % encoder->gridWidth)); /* xIdx (2 bytes) */
+	Stream_Write_UINT16(s, (UINT16)(param->index / encoder->gridWidth)); /* yIdx (2 bytes) */
+	Stream_Write_UINT8(s, 0);                                           /* flags (1 byte) */
+	Stream_Write_UINT8(s, progressive_encoder_quality(0));              /* quality (1 byte) */
+	Stream_Write_UINT16(s, param->len[0]);                              /* yLen (2 bytes) */
+	Stream_Write_UINT16(s, param->len[1]);                              /* cbLen (2 bytes) */
+	Stream_Write_UINT16(s, param->len[2]);                              /* crLen (2 bytes) */
+	Stream_Write_UINT16(s, 0);                                          /* tailLen (2 bytes) */
+
+	for (size_t c = 0; c < 3; c++)
+		Stream_Write(s, &param->dst[PROGRESSIVE_RLGR_SIZE * c], param->len[c]);
+	return TRUE;
+}
+
+/* Write the upgrade of a tile to the next quality level if it fits into budget */
+static BOOL progressive_encoder_write_upgrade(PROGRESSIVE_ENCODER* WINPR_RESTRICT encoder,
+                                              wStream* WINPR_RESTRICT s, UINT32 index,
+                                              size_t budget, size_t* WINPR_RESTRICT written)
+{
+	const PROGRESSIVE_ENCODER_TILE* tile = &encoder->tiles[index];
+	const size_t componentSize = PROGRESSIVE_SRL_SIZE + PROGRESSIVE_RAW_SIZE;
+	UINT16 srlLen[3] = { 0 };
+	UINT16 rawLen[3] = { 0 };
+
+	*written = 0;
+	if (budget < PROGRESSIVE_UPGRADE_HEADER_LENGTH)
+		return TRUE;
+
+	size_t blockLen = PROGRESSIVE_UPGRADE_HEADER_LENGTH;
+	for (size_t c = 0; c < 3; c++)
+	{
+		BYTE* srl = &encoder->upgrade[componentSize * c];
+		BYTE* raw = &srl[PROGRESSIVE_SRL_SIZE];
+
+		if (!progressive_encoder_upgrade_component(
+		        &tile->coeffs[4096 * c], progressive_encoder_level(tile->quality, c),
+		        progressive_encoder_level(tile->quality + 1, c), srl, &srlLen[c], raw, &rawLen[c]))
+		{
+			WLog_ERR(TAG, "upgrade pass of tile %" PRIu32 " exceeds the scratch buffer", index);
+			return FALSE;
+		}
+		blockLen += srlLen[c] + rawLen[c];
+	}
+
+	if (blockLen > budget)
+		return TRUE;
+
+	if (!Stream_EnsureRemainingCapacity(s, blockLen))
+		return FALSE;
+
+	const BYTE quality = progressive_encoder_quality(tile->quality + 1);
+	Stream_Write_UINT16(s, PROGRESSIVE_WBT_TILE_UPGRADE);            /* blockType (2 bytes) */
+	Stream_Write_UINT32(s, (UINT32)blockLen);                        /* blockLen (4 bytes) */
+	Stream_Write_UINT8(s, 0);                                        /* quantIdxY (1 byte) */
+	Stream_Write_UINT8(s, 0);                                        /* quantIdxCb (1 byte) */
+	Stream_Write_UINT8(s, 0);                                        /* quantIdxCr (1 byte) */
+	Stream_Write_UINT16(s, (UINT16)(index % encoder->gridWidth));    /* xIdx (2 bytes) */
+	Stream_Write_UINT16(s, (UINT16)(index / encoder->gridWidth));    /* yIdx (2 bytes) */
+	Stream_Write_UINT8(s, quality);                                  /* quality (1 byte) */
+	for (size_t c = 0; c < 3; c++)
+	{
+		Stream_Write_UINT16(s, srlLen[c]); /* ySrlLen, cbSrlLen, crSrlLen (2 bytes) */
+		Stream_Write_UINT16(s, rawLen[c]); /* yRawLen, cbRawLen, crRawLen (2 bytes) */
+	}
+
+	for (size_t c = 0; c < 3; c++)
+	{
+		const BYTE* srl = &encoder->upgrade[componentSize * c];
+		Stream_Write(s, srl, srlLen[c]);
+		Stream_Write(s, &srl[PROGRESSIVE_SRL_SIZE], rawLen[c]);
+	}
+
+	*written = blockLen;
+	return TRUE;
+}
+
+static void progressive_encoder_tile_rect(const PROGRESSIVE_ENCODER* WINPR_RESTRICT encoder,
+                                          UINT32 index, RFX_RECT* WINPR_RESTRICT rect)
+{
+	const UINT32 x = (index % encoder->gridWidth) * 64;
+	const UINT32 y = (index / encoder->gridWidth) * 64;
+
+	rect->x = (UINT16)x;
+	rect->y = (UINT16)y;
+	rect->width = (UINT16)MIN(64, encoder->width - x);
+	rect->height = (UINT16)MIN(64, encoder->height - y);
+}
+
+/**
+ * Spend budget on upgrade passes of tiles not invalidated in this frame. The coarsest tiles
+ * go first, tiles of the same quality are visited round robin so every static area improves.
+ */
+static BOOL progressive_encoder_schedule_upgrades(PROGRESSIVE_ENCODER* WINPR_RESTRICT encoder,
+                                                  wStream* WINPR_RESTRICT s, size_t budget,
+                                                  UINT32* WINPR_RESTRICT numTiles,
+                                                  UINT32* WINPR_RESTRICT numRects)
+{
+	for (BYTE quality = 0; quality < PROGRESSIVE_ENCODER_LEVELS; quality++)
+	{
+		const UINT32 start = encoder->cursor;
+		for (UINT32 n = 0; n < encoder->gridSize; n++)
+		{
+			const UINT32 index = (start + n) % encoder->gridSize;
+			PROGRESSIVE_ENCODER_TILE* tile = &encoder->tiles[index];
+
+			if (!tile->valid || (tile->quality != quality) || (tile->frame == encoder->frameIdx))
+				continue;
+
+			if ((*numTiles >= UINT16_MAX) || (*numRects >= UINT16_MAX))
+				return TRUE;
+
+			size_t written = 0;
+			if (!progressive_encoder_write_upgrade(encoder, s, index, budget, &written))
+				return FALSE;
+
+			if (written == 0)
+			{
+				encoder->cursor = index;
+				return TRUE;
+			}
+
+			/* The decoder processes the tiles of a region in parallel, one block per tile */
+			progressive_encoder_tile_rect(encoder, index, &encoder->rects[(*numRects)++]);
+			(*numTiles)++;
+			tile->quality++;
+			tile->frame = encoder->frameIdx;
+			budget -= written;
+			encoder->cursor = (index + 1) % encoder->gridSize;
+		}
+	}
+
+	return TRUE;
+}
+
+static BOOL progressive_encoder_write_region(PROGRESSIVE_ENCODER* WINPR_RESTRICT encoder,
+                                             wStream* WINPR_RESTRICT s, UINT32 numRects,
+                                             UINT32 numTiles)
+{
+	const size_t tilesDataSize = Stream_GetPosition(encoder->tilesStream);
+	const size_t blockLen =
+	    18ull + numRects * 8ull + 5ull + PROGRESSIVE_ENCODER_LEVELS * 16ull + tilesDataSize;
+
+	WINPR_ASSERT(numRects <= UINT16_MAX);
+	WINPR_ASSERT(numTiles <= UINT16_MAX);
+
+	if ((blockLen > UINT32_MAX) || !Stream_EnsureRemainingCapacity(s, blockLen))
+		return FALSE;
+
+	Stream_Write_UINT16(s, PROGRESSIVE_WBT_REGION);                /* blockType (2 bytes) */
+	Stream_Write_UINT32(s, (UINT32)blockLen);                      /* blockLen (4 bytes) */
+	Stream_Write_UINT8(s, 64);                                     /* tileSize (1 byte) */
+	Stream_Write_UINT16(s, (UINT16)numRects);                      /* numRects (2 bytes) */
+	Stream_Write_UINT8(s, 1);                                      /* numQuant (1 byte) */
+	Stream_Write_UINT8(s, (UINT8)PROGRESSIVE_ENCODER_LEVELS);      /* numProgQuant (1 byte) */
+	Stream_Write_UINT8(s, RFX_DWT_REDUCE_EXTRAPOLATE);             /* flags (1 byte) */
+	Stream_Write_UINT16(s, (UINT16)numTiles);                      /* numTiles (2 bytes) */
+	Stream_Write_UINT32(s, (UINT32)tilesDataSize);                 /* tilesDataSize (4 bytes) */
+
+	for (UINT32 i = 0; i < numRects; i++)
+	{
+		/* TS_RFX_RECT */
+		const RFX_RECT* r = &encoder->rects[i];
+		Stream_Write_UINT16(s, r->x);      /* x (2 bytes) */
+		Stream_Write_UINT16(s, r->y);      /* y (2 bytes) */
+		Stream_Write_UINT16(s, r->width);  /* width (2 bytes) */
+		Stream_Write_UINT16(s, r->height); /* height (2 bytes) */
+	}
+
+	progressive_component_codec_quant_write(s, &progressive_encoder_quant);
+
+	for (size_t i = 0; i < PROGRESSIVE_ENCODER_LEVELS; i++)
+	{
+		/* RFX_PROGRESSIVE_CODEC_QUANT */
+		const RFX_PROGRESSIVE_CODEC_QUANT* level = &progressive_encoder_levels[i];
+		Stream_Write_UINT8(s, level->quality); /* quality (1 byte) */
+		progressive_component_codec_quant_write(s, &level->yQuantValues);
+		progressive_component_codec_quant_write(s, &level->cbQuantValues);
+		progressive_component_codec_quant_write(s, &level->crQuantValues);
+	}
+
+	Stream_Write(s, Stream_Buffer(encoder->tilesStream), tilesDataSize);
+	return TRUE;
+}
+
+static BOOL progressive_encoder_write_frame(PROGRESSIVE_ENCODER* WINPR_RESTRICT encoder,
+                                            wStream* WINPR_RESTRICT s, UINT32 numRects,
+                                            UINT32 numTiles)
+{
+	if (!Stream_EnsureRemainingCapacity(s, 12 + 10 + 12))
+		return FALSE;
+
+	Stream_Write_UINT16(s, PROGRESSIVE_WBT_SYNC); /* blockType (2 bytes) */
+	Stream_Write_UINT32(s, 12);                   /* blockLen (4 bytes) */
+	Stream_Write_UINT32(s, 0xCACCACCA);           /* magic (4 bytes) */
+	Stream_Write_UINT16(s, 0x0100);               /* version (2 bytes) */
+
+	Stream_Write_UINT16(s, PROGRESSIVE_WBT_CONTEXT); /* blockType (2 bytes) */
+	Stream_Write_UINT32(s, 10);                      /* blockLen (4 bytes) */
+	Stream_Write_UINT8(s, 0);                        /* ctxId (1 byte) */
+	Stream_Write_UINT16(s, 64);                      /* tileSize (2 bytes) */
+	Stream_Write_UINT8(s, RFX_SUBBAND_DIFFING);      /* flags (1 byte) */
+
+	Stream_Write_UINT16(s, PROGRESSIVE_WBT_FRAME_BEGIN); /* blockType (2 bytes) */
+	Stream_Write_UINT32(s, 12);                          /* blockLen (4 bytes) */
+	Stream_Write_UINT32(s, encoder->frameIdx);           /* frameIndex (4 bytes) */
+	Stream_Write_UINT16(s, 1);                           /* regionCount (2 bytes) */
+
+	if (!progressive_encoder_write_region(encoder, s, numRects, numTiles))
+		return FALSE;
+
+	if (!Stream_EnsureRemainingCapacity(s, 6))
+		return FALSE;
+
+	Stream_Write_UINT16(s, PROGRESSIVE_WBT_FRAME_END); /* blockType (2 bytes) */
+	Stream_Write_UINT32(s, 6);                         /* blockLen (4 bytes) */
+	return TRUE;
+}
+
+static void progressive_encoder_free_tiles(PROGRESSIVE_ENCODER* WINPR_RESTRICT encoder)
+{
+	for (UINT32 i = 0; i < encoder->gridSize; i++)
+		winpr_aligned_free(encoder->tiles[i].coeffs);
+
+	free(encoder->tiles);
+	free(encoder->dirty);
+	free(encoder->params);
+	free(encoder->work);
+	free(encoder->rects);
+	encoder->tiles = NULL;
+	encoder->dirty = NULL;
+	encoder->params = NULL;
+	encoder->work = NULL;
+	encoder->rects = NULL;
+	encoder->rectsSize = 0;
+	encoder->gridSize = 0;
+}
+
+static BOOL progressive_encoder_resize(PROGRESSIVE_ENCODER* WINPR_RESTRICT encoder, UINT32 width,
+                                       UINT32 height)
+{
+	if (encoder->tiles && (encoder->width == width) && (encoder->height == height))
+		return TRUE;
+
+	progressive_encoder_free_tiles(encoder);
+
+	encoder->width = width;
+	encoder->height = height;
+	encoder->gridWidth = (width + 63) / 64;
+	encoder->gridHeight = (height + 63) / 64;
+	encoder->cursor = 0;
+
+	const size_t gridSize = 1ull * encoder->gridWidth * encoder->gridHeight;
+	if ((gridSize == 0) || (gridSize > UINT16_MAX))
+		return FALSE;
+
+	encoder->tiles = calloc(gridSize, sizeof(PROGRESSIVE_ENCODER_TILE));
+	encoder->dirty = calloc(gridSize, sizeof(UINT32));
+	encoder->params = calloc(gridSize, sizeof(PROGRESSIVE_ENCODER_WORK_PARAM));
+	encoder->work = calloc(gridSize, sizeof(PTP_WORK));
+	if (!encoder->tiles || !encoder->dirty || !encoder->params || !encoder->work)
+	{
+		progressive_encoder_free_tiles(encoder);
+		return FALSE;
+	}
+
+	encoder->gridSize = (UINT32)gridSize;
+	return TRUE;
+}
+
+static BOOL progressive_encoder_ensure_rects(PROGRESSIVE_ENCODER* WINPR_RESTRICT encoder,
+                                             size_t count)
+{
+	if (count <= encoder->rectsSize)
+		return TRUE;
+
+	RFX_RECT* tmp = realloc(encoder->rects, count * sizeof(RFX_RECT));
+	if (!tmp)
+		return FALSE;
+
+	encoder->rects = tmp;
+	encoder->rectsSize = count;
+	return TRUE;
+}
+
+static BOOL progressive_encoder_ensure_first(PROGRESSIVE_ENCODER* WINPR_RESTRICT encoder,
+                                             size_t count)
+{
+	const size_t size = count * 3ull * PROGRESSIVE_RLGR_SIZE;
+	if (size <= encoder->firstSize)
+		return TRUE;
+
+	BYTE* tmp = winpr_aligned_recalloc(encoder->first, count, 3ull * PROGRESSIVE_RLGR_SIZE, 32);
+	if (!tmp)
+		return FALSE;
+
+	encoder->first = tmp;
+	encoder->firstSize = size;
+	return TRUE;
+}
+
+int progressive_encoder_write_message(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+                                      wStream* WINPR_RESTRICT s,
+                                      const BYTE* WINPR_RESTRICT pSrcData, UINT32 Width,
+                                      UINT32 Height, UINT32 ScanLine,
+                                      const RFX_RECT* WINPR_RESTRICT rects, UINT32 numRects)
+{
+	int rc = -1;
+	UINT32 numDirty = 0;
+	UINT32 numTiles = 0;
+	UINT32 close_cnt = 0;
+
+	WINPR_ASSERT(progressive);
+	WINPR_ASSERT(s);
+	WINPR_ASSERT(pSrcData);
+	WINPR_ASSERT(rects || (numRects == 0));
+
+	PROGRESSIVE_ENCODER* encoder = progressive->encoder;
+	RFX_CONTEXT* rfx = progressive->rfx_context;
+	WINPR_ASSERT(encoder);
+	WINPR_ASSERT(rfx);
+
+	if (!progressive_encoder_resize(encoder, Width, Height))
+		return -1;
+
+	if (numRects > UINT16_MAX)
+		return -1;
+
+	const size_t bpp = FreeRDPGetBytesPerPixel(rfx->pixel_format);
+	encoder->frameIdx++;
+
+	for (UINT32 i = 0; i < numRects; i++)
+	{
+		const RFX_RECT* rect = &rects[i];
+		if ((rect->width == 0) || (rect->height == 0))
+			continue;
+
+		const UINT32 right = MIN(encoder->gridWidth, (rect->x + rect->width + 63u) / 64u);
+		const UINT32 bottom = MIN(encoder->gridHeight, (rect->y + rect->height + 63u) / 64u);
+
+		for (UINT32 y = rect->y / 64u; y < bottom; y++)
+		{
+			for (UINT32 x = rect->x / 64u; x < right; x++)
+			{
+				const UINT32 index = y * encoder->gridWidth + x;
+				PROGRESSIVE_ENCODER_TILE* tile = &encoder->tiles[index];
+
+				if (tile->frame == encoder->frameIdx)
+					continue;
+				tile->frame = encoder->frameIdx;
+				encoder->dirty[numDirty++] = index;
+			}
+		}
+	}
+
+	if (!progressive_encoder_ensure_first(encoder, numDirty) ||
+	    !progressive_encoder_ensure_rects(encoder, 1ull * numRects + encoder->gridSize))
+		goto fail;
+
+	for (UINT32 i = 0; i < numDirty; i++)
+	{
+		const UINT32 index = encoder->dirty[i];
+		const UINT32 x = (index % encoder->gridWidth) * 64;
+		const UINT32 y = (index / encoder->gridWidth) * 64;
+		PROGRESSIVE_ENCODER_TILE* tile = &encoder->tiles[index];
+		PROGRESSIVE_ENCODER_WORK_PARAM* param = &encoder->params[i];
+
+		if (!tile->coeffs)
+		{
+			tile->coeffs = winpr_aligned_calloc(3ull * 4096ull, sizeof(INT16), 32);
+			if (!tile->coeffs)
+				goto fail;
+		}
+
+		param->progressive = progressive;
+		param->tile = tile;
+		param->index = index;
+		param->data = &pSrcData[1ull * y * ScanLine + x * bpp];
+		param->width = MIN(64, Width - x);
+		param->height = MIN(64, Height - y);
+		param->scanline = ScanLine;
+		param->dst = &encoder->first[3ull * PROGRESSIVE_RLGR_SIZE * i];
+		param->success = FALSE;
+
+		if (rfx->priv->UseThreads)
+		{
+			encoder->work[i] =
+			    CreateThreadpoolWork(progressive_encoder_tile_work_callback, (void*)param,
+			                         rfx_get_callback_environment(rfx));
+			if (!encoder->work[i])
+			{
+				WLog_ERR(TAG, "Failed to create ThreadpoolWork for tile %" PRIu32, index);
+				goto fail;
+			}
+			close_cnt = i + 1;
+		}
+		else
+			progressive_encoder_tile_work_callback(0, param, 0);
+	}
+
+	if (rfx->priv->UseThreads)
+	{
+		winpr_SubmitThreadpoolWorkBatch(encoder->work, close_cnt);
+
+		for (UINT32 i = 0; i < close_cnt; i++)
+		{
+			WaitForThreadpoolWorkCallbacks(encoder->work[i], FALSE);
+			CloseThreadpoolWork(encoder->work[i]);
+		}
+		close_cnt = 0;
+	}
+
+	Stream_SetPosition(encoder->tilesStream, 0);
+	for (UINT32 i = 0; i < numRects; i++)
+		encoder->rects[i] = rects[i];
+
+	for (UINT32 i = 0; i < numDirty; i++)
+	{
+		const PROGRESSIVE_ENCODER_WORK_PARAM* param = &encoder->params[i];
+
+		if (!param->success)
+		{
+			WLog_ERR(TAG, "Failed to encode first pass of tile %" PRIu32, param->index);
+			goto fail;
+		}
+
+		if (!progressive_encoder_write_first(encoder, encoder->tilesStream, param))
+			goto fail;
+
+		param->tile->valid = TRUE;
+		param->tile->quality = 0;
+		numTiles++;
+	}
+
+	const size_t used = Stream_GetPosition(encoder->tilesStream);
+	const size_t budget = (progressive->bandwidth > used) ? progressive->bandwidth - used : 0;
+	if (!progressive_encoder_schedule_upgrades(encoder, encoder->tilesStream, budget, &numTiles,
+	                                           &numRects))
+		goto fail;
+
+	if (numTiles == 0)
+		return 0;
+
+	if (!progressive_encoder_write_frame(encoder, s, numRects, numTiles))
+		goto fail;
+
+	rc = (int)numTiles;
+fail:
+	/* Work objects are only submitted once all of them were created */
+	for (UINT32 i = 0; i < close_cnt; i++)
+		CloseThreadpoolWork(encoder->work[i]);
+
+	/* The client state is unknown after a failure, start over */
+	if (rc < 0)
+		progressive_encoder_reset(encoder);
+	return rc;
+}
+
+BOOL progressive_encoder_pending(const PROGRESSIVE_ENCODER* encoder)
+{
+	if (!encoder)
+		return FALSE;
+
+	for (UINT32 i = 0; i < encoder->gridSize; i++)
+	{
+		const PROGRESSIVE_ENCODER_TILE* tile = &encoder->tiles[i];
+		if (tile->valid && (tile->quality < PROGRESSIVE_ENCODER_LEVELS))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+void progressive_encoder_reset(PROGRESSIVE_ENCODER* encoder)
+{
+	if (!encoder)
+		return;
+
+	for (UINT32 i = 0; i < encoder->gridSize; i++)
+		encoder->tiles[i].valid = FALSE;
+	encoder->cursor = 0;
+}
+
+PROGRESSIVE_ENCODER* progressive_encoder_new(void)
+{
+	PROGRESSIVE_ENCODER* encoder = calloc(1, sizeof(PROGRESSIVE_ENCODER));
+	if (!encoder)
+		return NULL;
+
+	encoder->upgrade = winpr_aligned_calloc(3, PROGRESSIVE_SRL_SIZE + PROGRESSIVE_RAW_SIZE, 32);
+	encoder->tilesStream = Stream_New(NULL, 1024);
+	if (!encoder->upgrade || !encoder->tilesStream)
+	{
+		progressive_encoder_free(encoder);
+		return NULL;
+	}
+
+	return encoder;
+}
+
+void progressive_encoder_free(PROGRESSIVE_ENCODER* encoder)
+{
+	if (!encoder)
+		return;
+
+	progressive_encoder_free_tiles(encoder);
+	winpr_aligned_free(encoder->first);
+	winpr_aligned_free(encoder->upgrade);
+	Stream_Free(encoder->tilesStream, TRUE);
+	free(encoder);
+}
@@ -0,0 +1,53 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Progressive Codec Bitmap Compression - first and upgrade passes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_CODEC_PROGRESSIVE_ENCODE_H
+#define FREERDP_LIB_CODEC_PROGRESSIVE_ENCODE_H
+
+#include <winpr/wtypes.h>
+#include <winpr/stream.h>
+
+#include <freerdp/api.h>
+
+#include "progressive.h"
+
+FREERDP_LOCAL void progressive_encoder_free(PROGRESSIVE_ENCODER* encoder);
+
+WINPR_ATTR_MALLOC(progressive_encoder_free, 1)
+FREERDP_LOCAL PROGRESSIVE_ENCODER* progressive_encoder_new(void);
+
+/** @brief Forget the tile state, the next frame starts over with first passes */
+FREERDP_LOCAL void progressive_encoder_reset(PROGRESSIVE_ENCODER* encoder);
+
+/** @brief \b TRUE if a tile sent earlier is not at full quality yet */
+FREERDP_LOCAL BOOL progressive_encoder_pending(const PROGRESSIVE_ENCODER* encoder);
+
+/** @brief Write a progressive message with first and upgrade passes
+ *
+ *  Tiles touched by \b rects are sent as coarse first pass, the rest of the frame budget
+ *  \b progressive->bandwidth is spent on upgrade passes of tiles that did not change.
+ *
+ *  @return the number of tiles written, \b 0 if there was nothing to send, \b -1 on failure
+ */
+FREERDP_LOCAL int progressive_encoder_write_message(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+                                                    wStream* WINPR_RESTRICT s,
+                                                    const BYTE* WINPR_RESTRICT pSrcData,
+                                                    UINT32 Width, UINT32 Height, UINT32 ScanLine,
+                                                    const RFX_RECT* WINPR_RESTRICT rects,
+                                                    UINT32 numRects);
+
+#endif /* FREERDP_LIB_CODEC_PROGRESSIVE_ENCODE_H */
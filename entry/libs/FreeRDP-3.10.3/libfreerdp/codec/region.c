@@ -229,7 +229,8 @@ BOOL region16_copy(REGION16* dst, const REGION16* src)
 		if (!dst->data)
 			return FALSE;
 
-		CopyMemory(dst->data, src->data, src->data->size);
+		/* src may have spare capacity, only the used rectangles are copied */
+		CopyMemory(&dst->data[1], &src->data[1], src->data->nbRects * sizeof(RECTANGLE_16));
 	}
 
 	return TRUE;
@@ -470,24 +471,8 @@ static BOOL region16_simplify_bands(REGION16* region)
 		}
 	} while (TRUE);
 
-	if (finalNbRects != nbRects)
-	{
-		size_t allocSize = sizeof(REGION16_DATA) + (finalNbRects * sizeof(RECTANGLE_16));
-		REGION16_DATA* data = realloc(region->data, allocSize);
-		if (!data)
-			free(region->data);
-		region->data = data;
-
-		if (!region->data)
-		{
-			region->data = &empty_region;
-			return FALSE;
-		}
-
-		region->data->nbRects = finalNbRects;
-		region->data->size = allocSize;
-	}
-
+	/* the allocation is kept as spare capacity for the next union */
+	region->data->nbRects = finalNbRects;
 	return TRUE;
 }
 
@@ -687,6 +672,379 @@ BOOL region16_union_rect(REGION16* dst, const REGION16* src, const RECTANGLE_16*
 	return region16_simplify_bands(dst);
 }
 
+/** Grid used by the tile aligned fast path of region16_union_rects, the RemoteFX and
+ *  progressive tile size */
+#define REGION16_TILE_SIZE 64
+#define REGION16_TILE_MAX_CELLS (128 * 128)
+
+typedef struct
+{
+	RECTANGLE_16* rects;
+	size_t nbRects;
+	size_t capacity;
+	size_t bandStart; /* first rectangle of the last emitted band */
+	BOOL canMerge;    /* the last band may be extended by the next one */
+} REGION16_BUILDER;
+
+static BOOL region16_builder_reserve(REGION16_BUILDER* builder, size_t count)
+{
+	WINPR_ASSERT(builder);
+
+	if (builder->nbRects + count <= builder->capacity)
+		return TRUE;
+
+	size_t capacity = MAX(64, builder->capacity * 2);
+	while (capacity < builder->nbRects + count)
+		capacity *= 2;
+
+	RECTANGLE_16* rects = realloc(builder->rects, capacity * sizeof(RECTANGLE_16));
+	if (!rects)
+		return FALSE;
+
+	builder->rects = rects;
+	builder->capacity = capacity;
+	return TRUE;
+}
+
+/** appends a band, spans must be sorted and must not touch. If the band touches the previous
+ *  one and has the same spans the previous band is extended instead */
+static BOOL region16_builder_add_band(REGION16_BUILDER* builder, UINT16 top, UINT16 bottom,
+                                      const RECTANGLE_16* spans, size_t nbSpans)
+{
+	WINPR_ASSERT(builder);
+
+	if (nbSpans == 0)
+	{
+		builder->canMerge = FALSE;
+		return TRUE;
+	}
+
+	if (builder->canMerge && (builder->rects[builder->bandStart].bottom == top) &&
+	    (builder->nbRects - builder->bandStart == nbSpans))
+	{
+		RECTANGLE_16* band = &builder->rects[builder->bandStart];
+		BOOL match = TRUE;
+		for (size_t x = 0; match && (x < nbSpans); x++)
+			match = (band[x].left == spans[x].left) && (band[x].right == spans[x].right);
+
+		if (match)
+		{
+			for (size_t x = 0; x < nbSpans; x++)
+				band[x].bottom = bottom;
+			return TRUE;
+		}
+	}
+
+	if (!region16_builder_reserve(builder, nbSpans))
+		return FALSE;
+
+	builder->bandStart = builder->nbRects;
+	builder->canMerge = TRUE;
+	for (size_t x = 0; x < nbSpans; x++)
+	{
+		RECTANGLE_16* rect = &builder->rects[builder->nbRects++];
+		rect->left = spans[x].left;
+		rect->right = spans[x].right;
+		rect->top = top;
+		rect->bottom = bottom;
+	}
+
+	return TRUE;
+}
+
+/** stores the built rectangles in region, the existing allocation is reused if large enough */
+static BOOL region16_builder_commit(REGION16_BUILDER* builder, REGION16* region)
+{
+	WINPR_ASSERT(builder);
+	WINPR_ASSERT(region);
+	WINPR_ASSERT(region->data);
+
+	if (builder->nbRects == 0)
+	{
+		region16_clear(region);
+		return TRUE;
+	}
+
+	const size_t needed = sizeof(REGION16_DATA) + builder->nbRects * sizeof(RECTANGLE_16);
+	if ((region->data == &empty_region) || ((size_t)region->data->size < needed))
+	{
+		/* keep some headroom, regions tracking dirty areas grow and shrink every frame */
+		REGION16_DATA* data = allocateRegion((long)(builder->nbRects + builder->nbRects / 2));
+		if (!data)
+			return FALSE;
+
+		if ((region->data->size > 0) && (region->data != &empty_region))
+			free(region->data);
+		region->data = data;
+	}
+
+	region->data->nbRects = (long)builder->nbRects;
+	CopyMemory(&region->data[1], builder->rects, builder->nbRects * sizeof(RECTANGLE_16));
+
+	const RECTANGLE_16* rects = builder->rects;
+	RECTANGLE_16* extents = &region->extents;
+	extents->top = rects[0].top;
+	extents->bottom = rects[builder->nbRects - 1].bottom;
+	extents->left = rects[0].left;
+	extents->right = rects[0].right;
+	for (size_t x = 1; x < builder->nbRects; x++)
+	{
+		extents->left = MIN(extents->left, rects[x].left);
+		extents->right = MAX(extents->right, rects[x].right);
+	}
+
+	return TRUE;
+}
+
+static int region16_compare_top(const void* pva, const void* pvb)
+{
+	const RECTANGLE_16* a = pva;
+	const RECTANGLE_16* b = pvb;
+	return (int)a->top - (int)b->top;
+}
+
+static int region16_compare_left(const void* pva, const void* pvb)
+{
+	const RECTANGLE_16* a = pva;
+	const RECTANGLE_16* b = pvb;
+	return (int)a->left - (int)b->left;
+}
+
+static int region16_compare_y(const void* pva, const void* pvb)
+{
+	const UINT16* a = pva;
+	const UINT16* b = pvb;
+	return (int)*a - (int)*b;
+}
+
+/** Sweep from top to bottom over all distinct y coordinates, every band is the union of the
+ *  rectangles active between two consecutive coordinates */
+static BOOL region16_union_sweep(REGION16_BUILDER* builder, RECTANGLE_16* items, size_t count)
+{
+	BOOL rc = FALSE;
+	size_t nbY = 0;
+	size_t nbActive = 0;
+	size_t next = 0;
+	UINT16* ys = calloc(2 * count, sizeof(UINT16));
+	RECTANGLE_16* active = calloc(count, sizeof(RECTANGLE_16));
+	RECTANGLE_16* spans = calloc(count, sizeof(RECTANGLE_16));
+
+	if (!ys || !active || !spans)
+		goto fail;
+
+	qsort(items, count, sizeof(RECTANGLE_16), region16_compare_top);
+
+	for (size_t x = 0; x < count; x++)
+	{
+		ys[2 * x] = items[x].top;
+		ys[2 * x + 1] = items[x].bottom;
+	}
+	qsort(ys, 2 * count, sizeof(UINT16), region16_compare_y);
+	for (size_t x = 0; x < 2 * count; x++)
+	{
+		if ((nbY == 0) || (ys[nbY - 1] != ys[x]))
+			ys[nbY++] = ys[x];
+	}
+
+	for (size_t y = 0; y + 1 < nbY; y++)
+	{
+		const UINT16 top = ys[y];
+		const UINT16 bottom = ys[y + 1];
+
+		/* drop rectangles ending above this band, add the ones starting here */
+		size_t kept = 0;
+		for (size_t x = 0; x < nbActive; x++)
+		{
+			if (active[x].bottom > top)
+				active[kept++] = active[x];
+		}
+		nbActive = kept;
+
+		while ((next < count) && (items[next].top <= top))
+			active[nbActive++] = items[next++];
+
+		if (nbActive == 0)
+		{
+			builder->canMerge = FALSE;
+			continue;
+		}
+
+		CopyMemory(spans, active, nbActive * sizeof(RECTANGLE_16));
+		qsort(spans, nbActive, sizeof(RECTANGLE_16), region16_compare_left);
+
+		/* merge overlapping and touching spans */
+		size_t nbSpans = 0;
+		for (size_t x = 0; x < nbActive; x++)
+		{
+			if ((nbSpans > 0) && (spans[x].left <= spans[nbSpans - 1].right))
+				spans[nbSpans - 1].right = MAX(spans[nbSpans - 1].right, spans[x].right);
+			else
+				spans[nbSpans++] = spans[x];
+		}
+
+		if (!region16_builder_add_band(builder, top, bottom, spans, nbSpans))
+			goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	free(ys);
+	free(active);
+	free(spans);
+	return rc;
+}
+
+static BOOL region16_is_tile_aligned(const RECTANGLE_16* rect, const RECTANGLE_16* extents)
+{
+	/* tiles clipped by the surface edge end on the extents */
+	return ((rect->left % REGION16_TILE_SIZE) == 0) && ((rect->top % REGION16_TILE_SIZE) == 0) &&
+	       (((rect->right % REGION16_TILE_SIZE) == 0) || (rect->right == extents->right)) &&
+	       (((rect->bottom % REGION16_TILE_SIZE) == 0) || (rect->bottom == extents->bottom));
+}
+
+/** Fast path for rectangles on the tile grid: mark the covered cells in a bitmap and convert
+ *  the bitmap rows to bands. Returns FALSE with \b done unset if the input does not qualify */
+static BOOL region16_union_tiles(REGION16_BUILDER* builder, const RECTANGLE_16* items,
+                                 size_t count, const RECTANGLE_16* extents, BOOL* done)
+{
+	WINPR_ASSERT(done);
+	*done = FALSE;
+
+	for (size_t x = 0; x < count; x++)
+	{
+		if (!region16_is_tile_aligned(&items[x], extents))
+			return TRUE;
+	}
+
+	const size_t left = extents->left / REGION16_TILE_SIZE;
+	const size_t top = extents->top / REGION16_TILE_SIZE;
+	const size_t columns =
+	    (extents->right + REGION16_TILE_SIZE - 1ull) / REGION16_TILE_SIZE - left;
+	const size_t rows = (extents->bottom + REGION16_TILE_SIZE - 1ull) / REGION16_TILE_SIZE - top;
+	if (columns * rows > REGION16_TILE_MAX_CELLS)
+		return TRUE;
+
+	BOOL rc = FALSE;
+	BYTE* cells = calloc(columns * rows, sizeof(BYTE));
+	RECTANGLE_16* spans = calloc(columns / 2 + 1, sizeof(RECTANGLE_16));
+	if (!cells || !spans)
+		goto fail;
+
+	for (size_t x = 0; x < count; x++)
+	{
+		const RECTANGLE_16* rect = &items[x];
+		const size_t x1 = rect->left / REGION16_TILE_SIZE - left;
+		const size_t x2 = (rect->right + REGION16_TILE_SIZE - 1ull) / REGION16_TILE_SIZE - left;
+		const size_t y1 = rect->top / REGION16_TILE_SIZE - top;
+		const size_t y2 = (rect->bottom + REGION16_TILE_SIZE - 1ull) / REGION16_TILE_SIZE - top;
+
+		for (size_t y = y1; y < y2; y++)
+			memset(&cells[y * columns + x1], 1, x2 - x1);
+	}
+
+	for (size_t y = 0; y < rows; y++)
+	{
+		const BYTE* row = &cells[y * columns];
+		size_t nbSpans = 0;
+
+		for (size_t x = 0; x < columns;)
+		{
+			if (!row[x])
+			{
+				x++;
+				continue;
+			}
+
+			const size_t start = x;
+			while ((x < columns) && row[x])
+				x++;
+
+			spans[nbSpans].left = (UINT16)((left + start) * REGION16_TILE_SIZE);
+			spans[nbSpans].right =
+			    (UINT16)MIN((left + x) * REGION16_TILE_SIZE, (size_t)extents->right);
+			nbSpans++;
+		}
+
+		const UINT16 bandTop = (UINT16)((top + y) * REGION16_TILE_SIZE);
+		const UINT16 bandBottom =
+		    (UINT16)MIN((top + y + 1) * REGION16_TILE_SIZE, (size_t)extents->bottom);
+		if (!region16_builder_add_band(builder, bandTop, bandBottom, spans, nbSpans))
+			goto fail;
+	}
+
+	*done = TRUE;
+	rc = TRUE;
+fail:
+	free(cells);
+	free(spans);
+	return rc;
+}
+
+BOOL region16_union_rects(REGION16* dst, const REGION16* src, const RECTANGLE_16* rects,
+                          UINT32 count)
+{
+	BOOL rc = FALSE;
+	UINT32 nbSrc = 0;
+	size_t nbItems = 0;
+	REGION16_BUILDER builder = { 0 };
+	RECTANGLE_16 extents = { 0 };
+
+	WINPR_ASSERT(dst);
+	WINPR_ASSERT(src);
+	WINPR_ASSERT(rects || (count == 0));
+
+	const RECTANGLE_16* srcRects = region16_rects(src, &nbSrc);
+	RECTANGLE_16* items = calloc(1ull + nbSrc + count, sizeof(RECTANGLE_16));
+	if (!items)
+		return FALSE;
+
+	/* src may be dst, take a copy of everything before the result is written */
+	if (nbSrc > 0)
+	{
+		CopyMemory(items, srcRects, nbSrc * sizeof(RECTANGLE_16));
+		extents = src->extents;
+		nbItems = nbSrc;
+	}
+
+	for (UINT32 x = 0; x < count; x++)
+	{
+		const RECTANGLE_16* rect = &rects[x];
+		if (rectangle_is_empty(rect))
+			continue;
+
+		if (nbItems == 0)
+			extents = *rect;
+		else
+		{
+			extents.left = MIN(extents.left, rect->left);
+			extents.top = MIN(extents.top, rect->top);
+			extents.right = MAX(extents.right, rect->right);
+			extents.bottom = MAX(extents.bottom, rect->bottom);
+		}
+		items[nbItems++] = *rect;
+	}
+
+	if (nbItems == 0)
+	{
+		region16_clear(dst);
+		rc = TRUE;
+		goto fail;
+	}
+
+	BOOL done = FALSE;
+	if (!region16_union_tiles(&builder, items, nbItems, &extents, &done))
+		goto fail;
+
+	if (!done && !region16_union_sweep(&builder, items, nbItems))
+		goto fail;
+
+	rc = region16_builder_commit(&builder, dst);
+fail:
+	free(builder.rects);
+	free(items);
+	return rc;
+}
+
 BOOL region16_intersects_rect(const REGION16* src, const RECTANGLE_16* arg2)
 {
 	const RECTANGLE_16* rect = NULL;
@@ -303,20 +303,6 @@ RFX_CONTEXT* rfx_context_new_ex(BOOL encoder, UINT32 ThreadingFlags)
 		/* from multiple threads. This call will initialize all function pointers correctly     */
 		/* before any decoding threads are started */
 		primitives_get();
-		priv->ThreadPool = CreateThreadpool(NULL);
-
-		if (!priv->ThreadPool)
-			goto fail;
-
-		InitializeThreadpoolEnvironment(&priv->ThreadPoolEnv);
-		SetThreadpoolCallbackPool(&priv->ThreadPoolEnv, priv->ThreadPool);
-
-		if (priv->MinThreadCount)
-			if (!SetThreadpoolThreadMinimum(priv->ThreadPool, priv->MinThreadCount))
-				goto fail;
-
-		if (priv->MaxThreadCount)
-			SetThreadpoolThreadMaximum(priv->ThreadPool, priv->MaxThreadCount);
 	}
 
 	/* initialize the default pixel format */
@@ -329,8 +315,8 @@ RFX_CONTEXT* rfx_context_new_ex(BOOL encoder, UINT32 ThreadingFlags)
 	context->dwt_2d_decode = rfx_dwt_2d_decode;
 	context->dwt_2d_extrapolate_decode = rfx_dwt_2d_extrapolate_decode;
 	context->dwt_2d_encode = rfx_dwt_2d_encode;
-	context->rlgr_decode = rfx_rlgr_decode;
-	context->rlgr_encode = rfx_rlgr_encode;
+	context->rlgr_decode = rfx_rlgr_decode_fast;
+	context->rlgr_encode = rfx_rlgr_encode_fast;
 	rfx_init_sse2(context);
 	rfx_init_neon(context);
 	context->state = RFX_STATE_SEND_HEADERS;
@@ -370,8 +356,10 @@ void rfx_context_free(RFX_CONTEXT* context)
 		if (priv->UseThreads)
 		{
 			if (priv->ThreadPool)
+			{
 				CloseThreadpool(priv->ThreadPool);
-			DestroyThreadpoolEnvironment(&priv->ThreadPoolEnv);
+				DestroyThreadpoolEnvironment(&priv->ThreadPoolEnv);
+			}
 			winpr_aligned_free((void*)priv->workObjects);
 			winpr_aligned_free(priv->tileWorkParams);
 #ifdef WITH_PROFILER
@@ -1085,16 +1073,15 @@ static INLINE BOOL rfx_process_message_tileset(RFX_CONTEXT* WINPR_RESTRICT conte
 				params[i].context = context;
 				params[i].tile = message->tiles[i];
 
-				if (!(work_objects[i] =
-				          CreateThreadpoolWork(rfx_process_message_tile_work_callback,
-				                               (void*)&params[i], &context->priv->ThreadPoolEnv)))
+				if (!(work_objects[i] = CreateThreadpoolWork(
+				          rfx_process_message_tile_work_callback, (void*)&params[i],
+				          rfx_get_callback_environment(context))))
 				{
 					WLog_Print(context->priv->log, WLOG_ERROR, "CreateThreadpoolWork failed.");
 					rc = FALSE;
 					break;
 				}
 
-				SubmitThreadpoolWork(work_objects[i]);
 				close_cnt = i + 1;
 			}
 			else
@@ -1106,9 +1093,15 @@ static INLINE BOOL rfx_process_message_tileset(RFX_CONTEXT* WINPR_RESTRICT conte
 
 	if (context->priv->UseThreads)
 	{
+		/* Queue all tiles of the message at once instead of one lock round trip per tile.
+		 * If the message was broken nothing was submitted, the work objects are only closed. */
+		if (rc)
+			winpr_SubmitThreadpoolWorkBatch(work_objects, close_cnt);
+
 		for (size_t i = 0; i < close_cnt; i++)
 		{
-			WaitForThreadpoolWorkCallbacks(work_objects[i], FALSE);
+			if (rc)
+				WaitForThreadpoolWorkCallbacks(work_objects[i], FALSE);
 			CloseThreadpoolWork(work_objects[i]);
 		}
 	}
@@ -1813,9 +1806,9 @@ RFX_MESSAGE* rfx_encode_message(RFX_CONTEXT* WINPR_RESTRICT context,
 					workParam->context = context;
 					workParam->tile = tile;
 
-					if (!(*workObject = CreateThreadpoolWork(rfx_compose_message_tile_work_callback,
-					                                         (void*)workParam,
-					                                         &context->priv->ThreadPoolEnv)))
+					if (!(*workObject = CreateThreadpoolWork(
+					          rfx_compose_message_tile_work_callback, (void*)workParam,
+					          rfx_get_callback_environment(context))))
 					{
 						goto skip_encoding_loop;
 					}
@@ -2203,6 +2196,67 @@ BOOL rfx_context_set_mode(RFX_CONTEXT* WINPR_RESTRICT context, RLGR_MODE mode)
 	return TRUE;
 }
 
+BOOL rfx_context_set_fast_rlgr(RFX_CONTEXT* WINPR_RESTRICT context, BOOL enable)
+{
+	if (!context)
+		return FALSE;
+
+	if (context->encoder)
+		context->rlgr_encode = enable ? rfx_rlgr_encode_fast : rfx_rlgr_encode;
+	else
+		context->rlgr_decode = enable ? rfx_rlgr_decode_fast : rfx_rlgr_decode;
+	return TRUE;
+}
+
+BOOL rfx_context_set_callback_environment(RFX_CONTEXT* WINPR_RESTRICT context,
+                                          PTP_CALLBACK_ENVIRON pcbe)
+{
+	if (!context)
+		return FALSE;
+
+	WINPR_ASSERT(context->priv);
+	context->priv->CallbackEnvironment = pcbe;
+	return TRUE;
+}
+
+PTP_CALLBACK_ENVIRON rfx_get_callback_environment(RFX_CONTEXT* context)
+{
+	WINPR_ASSERT(context);
+	RFX_CONTEXT_PRIV* priv = context->priv;
+	WINPR_ASSERT(priv);
+
+	if (priv->CallbackEnvironment)
+		return priv->CallbackEnvironment;
+
+	if (priv->ThreadPool)
+		return &priv->ThreadPoolEnv;
+
+	PTP_POOL pool = CreateThreadpool(NULL);
+	if (!pool)
+		goto fail;
+
+	if (priv->MinThreadCount)
+	{
+		if (!SetThreadpoolThreadMinimum(pool, priv->MinThreadCount))
+		{
+			CloseThreadpool(pool);
+			goto fail;
+		}
+	}
+
+	if (priv->MaxThreadCount)
+		SetThreadpoolThreadMaximum(pool, priv->MaxThreadCount);
+
+	InitializeThreadpoolEnvironment(&priv->ThreadPoolEnv);
+	SetThreadpoolCallbackPool(&priv->ThreadPoolEnv, pool);
+	priv->ThreadPool = pool;
+	return &priv->ThreadPoolEnv;
+
+fail:
+	WLog_Print(priv->log, WLOG_WARN, "failed to create a thread pool, using the default one");
+	return NULL;
+}
+
 RLGR_MODE rfx_context_get_mode(RFX_CONTEXT* WINPR_RESTRICT context)
 {
 	WINPR_ASSERT(context);
@@ -208,3 +208,78 @@ void rfx_dwt_2d_encode(INT16* WINPR_RESTRICT buffer, INT16* WINPR_RESTRICT dwt_b
 	rfx_dwt_2d_encode_block(&buffer[3072], dwt_buffer, 16);
 	rfx_dwt_2d_encode_block(&buffer[3840], dwt_buffer, 8);
 }
+
+/* Forward lifting step of the reduce extrapolate DWT, the inverse of progressive_rfx_idwt_x/y.
+ * 64 samples result in 33 low and 31 high band coefficients, 33 in 17 and 16, 17 in 9 and 8. */
+static INLINE void rfx_dwt_extrapolate_encode_1d(const INT16* WINPR_RESTRICT src, size_t srcStep,
+                                                 INT16* WINPR_RESTRICT low, size_t lowStep,
+                                                 INT16* WINPR_RESTRICT high, size_t highStep,
+                                                 size_t count)
+{
+	const size_t nh = (count % 2) ? (count - 1) / 2 : (count / 2) - 1;
+
+	for (size_t n = 0; n < nh; n++)
+	{
+		const INT32 x0 = src[(2 * n) * srcStep];
+		const INT32 x1 = src[(2 * n + 1) * srcStep];
+		const INT32 x2 = src[(2 * n + 2) * srcStep];
+		high[n * highStep] = (INT16)((x1 - ((x0 + x2) >> 1)) >> 1);
+	}
+
+	low[0] = (INT16)(src[0] + high[0]);
+
+	for (size_t n = 1; n < nh; n++)
+	{
+		const INT32 h0 = high[(n - 1) * highStep];
+		const INT32 h1 = high[n * highStep];
+		low[n * lowStep] = (INT16)(src[(2 * n) * srcStep] + ((h0 + h1) >> 1));
+	}
+
+	const INT32 last = high[(nh - 1) * highStep];
+	const INT32 x0 = src[(2 * nh) * srcStep];
+
+	if (count % 2)
+		low[nh * lowStep] = (INT16)(x0 + last);
+	else
+	{
+		/* the last odd sample has no high band coefficient, it is extrapolated */
+		const INT32 x1 = src[(2 * nh + 1) * srcStep];
+		low[nh * lowStep] = (INT16)(x0 + (last >> 1));
+		low[(nh + 1) * lowStep] = (INT16)(2 * x1 - x0);
+	}
+}
+
+static void rfx_dwt_2d_extrapolate_encode_block(INT16* WINPR_RESTRICT buffer,
+                                                INT16* WINPR_RESTRICT dwt, size_t count)
+{
+	const size_t nh = (count % 2) ? (count - 1) / 2 : (count / 2) - 1;
+	const size_t nl = count - nh;
+	INT16* l = dwt;
+	INT16* h = &dwt[nl * count];
+
+	/* DWT in vertical direction, results in nl L rows and nh H rows in the tmp buffer dwt. */
+	for (size_t x = 0; x < count; x++)
+		rfx_dwt_extrapolate_encode_1d(&buffer[x], count, &l[x], count, &h[x], count, count);
+
+	/* DWT in horizontal direction, results in HL, LH, HH, LL order stored in buffer. */
+	INT16* hl = buffer;
+	INT16* lh = &hl[nl * nh];
+	INT16* hh = &lh[nh * nl];
+	INT16* ll = &hh[nh * nh];
+
+	for (size_t y = 0; y < nl; y++)
+		rfx_dwt_extrapolate_encode_1d(&l[y * count], 1, &ll[y * nl], 1, &hl[y * nh], 1, count);
+
+	for (size_t y = 0; y < nh; y++)
+		rfx_dwt_extrapolate_encode_1d(&h[y * count], 1, &lh[y * nl], 1, &hh[y * nh], 1, count);
+}
+
+void rfx_dwt_2d_extrapolate_encode(INT16* WINPR_RESTRICT buffer, INT16* WINPR_RESTRICT dwt_buffer)
+{
+	WINPR_ASSERT(buffer);
+	WINPR_ASSERT(dwt_buffer);
+
+	rfx_dwt_2d_extrapolate_encode_block(&buffer[0], dwt_buffer, 64);
+	rfx_dwt_2d_extrapolate_encode_block(&buffer[3007], dwt_buffer, 33);
+	rfx_dwt_2d_extrapolate_encode_block(&buffer[3807], dwt_buffer, 17);
+}
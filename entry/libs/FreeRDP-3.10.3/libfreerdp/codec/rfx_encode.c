@@ -232,6 +232,31 @@ static void rfx_encode_format_rgb(const BYTE* WINPR_RESTRICT rgb_data, int width
 
 /* rfx_encode_rgb_to_ycbcr code now resides in the primitives library. */
 
+void rfx_encode_tile_ycbcr(RFX_CONTEXT* WINPR_RESTRICT context, const BYTE* WINPR_RESTRICT data,
+                           UINT32 width, UINT32 height, UINT32 scanline,
+                           INT16* pSrcDst[3])
+{
+	union
+	{
+		const INT16** cpv;
+		INT16** pv;
+	} cnv;
+	primitives_t* prims = primitives_get();
+	static const prim_size_t roi_64x64 = { 64, 64 };
+
+	WINPR_ASSERT(context);
+	PROFILER_ENTER(context->priv->prof_rfx_encode_format_rgb)
+	rfx_encode_format_rgb(data, (int)width, (int)height, (int)scanline, context->pixel_format,
+	                      context->palette, pSrcDst[0], pSrcDst[1], pSrcDst[2]);
+	PROFILER_EXIT(context->priv->prof_rfx_encode_format_rgb)
+	PROFILER_ENTER(context->priv->prof_rfx_rgb_to_ycbcr)
+
+	cnv.pv = pSrcDst;
+	prims->RGBToYCbCr_16s16s_P3P3(cnv.cpv, 64 * sizeof(INT16), pSrcDst, 64 * sizeof(INT16),
+	                              &roi_64x64);
+	PROFILER_EXIT(context->priv->prof_rfx_rgb_to_ycbcr)
+}
+
 static void rfx_encode_component(RFX_CONTEXT* WINPR_RESTRICT context,
                                  const UINT32* WINPR_RESTRICT quantization_values,
                                  INT16* WINPR_RESTRICT data, BYTE* WINPR_RESTRICT buffer,
@@ -258,11 +283,6 @@ static void rfx_encode_component(RFX_CONTEXT* WINPR_RESTRICT context,
 
 void rfx_encode_rgb(RFX_CONTEXT* WINPR_RESTRICT context, RFX_TILE* WINPR_RESTRICT tile)
 {
-	union
-	{
-		const INT16** cpv;
-		INT16** pv;
-	} cnv;
 	BYTE* pBuffer = NULL;
 	INT16* pSrcDst[3];
 	int YLen = 0;
@@ -271,8 +291,6 @@ void rfx_encode_rgb(RFX_CONTEXT* WINPR_RESTRICT context, RFX_TILE* WINPR_RESTRIC
 	UINT32* YQuant = NULL;
 	UINT32* CbQuant = NULL;
 	UINT32* CrQuant = NULL;
-	primitives_t* prims = primitives_get();
-	static const prim_size_t roi_64x64 = { 64, 64 };
 
 	if (!(pBuffer = (BYTE*)BufferPool_Take(context->priv->BufferPool, -1)))
 		return;
@@ -285,17 +303,7 @@ void rfx_encode_rgb(RFX_CONTEXT* WINPR_RESTRICT context, RFX_TILE* WINPR_RESTRIC
 	pSrcDst[1] = (INT16*)((&pBuffer[((8192ULL + 32ULL) * 1ULL) + 16ULL])); /* cb_g_buffer */
 	pSrcDst[2] = (INT16*)((&pBuffer[((8192ULL + 32ULL) * 2ULL) + 16ULL])); /* cr_b_buffer */
 	PROFILER_ENTER(context->priv->prof_rfx_encode_rgb)
-	PROFILER_ENTER(context->priv->prof_rfx_encode_format_rgb)
-	rfx_encode_format_rgb(tile->data, tile->width, tile->height, tile->scanline,
-	                      context->pixel_format, context->palette, pSrcDst[0], pSrcDst[1],
-	                      pSrcDst[2]);
-	PROFILER_EXIT(context->priv->prof_rfx_encode_format_rgb)
-	PROFILER_ENTER(context->priv->prof_rfx_rgb_to_ycbcr)
-
-	cnv.pv = pSrcDst;
-	prims->RGBToYCbCr_16s16s_P3P3(cnv.cpv, 64 * sizeof(INT16), pSrcDst, 64 * sizeof(INT16),
-	                              &roi_64x64);
-	PROFILER_EXIT(context->priv->prof_rfx_rgb_to_ycbcr)
+	rfx_encode_tile_ycbcr(context, tile->data, tile->width, tile->height, tile->scanline, pSrcDst);
 	/**
 	 * We need to clear the buffers as the RLGR encoder expects it to be initialized to zero.
 	 * This allows simplifying and improving the performance of the encoding process.
@@ -26,4 +26,10 @@
 FREERDP_LOCAL void rfx_encode_rgb(RFX_CONTEXT* WINPR_RESTRICT context,
                                   RFX_TILE* WINPR_RESTRICT tile);
 
+/** @brief Convert a tile of at most 64x64 pixels to 64x64 YCbCr planes, the edges are repeated */
+FREERDP_LOCAL void rfx_encode_tile_ycbcr(RFX_CONTEXT* WINPR_RESTRICT context,
+                                         const BYTE* WINPR_RESTRICT data, UINT32 width,
+                                         UINT32 height, UINT32 scanline,
+                                         INT16* pSrcDst[3]);
+
 #endif /* FREERDP_LIB_CODEC_RFX_ENCODE_H */
@@ -37,6 +37,13 @@
 #include "rfx_bitstream.h"
 
 #include "rfx_rlgr.h"
+#include "../core/simd.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <emmintrin.h>
+#elif defined(NEON_INTRINSICS_ENABLED)
+#include <arm_neon.h>
+#endif
 
 /* Constants used in RLGR1/RLGR3 algorithm */
 #define KPMAX (80) /* max value for kp or krp */
@@ -769,3 +776,510 @@ int rfx_rlgr_encode(RLGR_MODE mode, const INT16* WINPR_RESTRICT data, UINT32 dat
 
 	return processed_size;
 }
+
+/* 64 bit accumulator, whole big endian words are written to the output */
+typedef struct
+{
+	UINT64 acc;
+	UINT32 pending; /* bits in acc not written yet, always < 32 between calls */
+	BYTE* dst;
+	size_t offset;
+	size_t size;
+} RFX_RLGR_WRITER;
+
+static INLINE void rfx_rlgr_writer_emit(RFX_RLGR_WRITER* WINPR_RESTRICT w, UINT32 word)
+{
+	if (w->offset + 4 <= w->size)
+	{
+		w->dst[w->offset] = (BYTE)(word >> 24);
+		w->dst[w->offset + 1] = (BYTE)(word >> 16);
+		w->dst[w->offset + 2] = (BYTE)(word >> 8);
+		w->dst[w->offset + 3] = (BYTE)word;
+	}
+	else
+	{
+		/* Like rfx_bitstream_put_bits the output is cut at the end of the buffer */
+		for (size_t x = 0; x < 4; x++)
+		{
+			if (w->offset + x < w->size)
+				w->dst[w->offset + x] = (BYTE)(word >> (24 - 8 * x));
+		}
+	}
+	w->offset += 4;
+}
+
+/* Append the \b nbits (at most 32) low bits of \b value */
+static INLINE void rfx_rlgr_writer_put(RFX_RLGR_WRITER* WINPR_RESTRICT w, UINT32 value,
+                                       UINT32 nbits)
+{
+	WINPR_ASSERT(nbits <= 32);
+
+	w->acc = (w->acc << nbits) | value;
+	w->pending += nbits;
+	if (w->pending >= 32)
+	{
+		w->pending -= 32;
+		rfx_rlgr_writer_emit(w, (UINT32)(w->acc >> w->pending));
+	}
+}
+
+static INLINE void rfx_rlgr_writer_ones(RFX_RLGR_WRITER* WINPR_RESTRICT w, UINT32 count)
+{
+	for (; count >= 32; count -= 32)
+		rfx_rlgr_writer_put(w, UINT32_MAX, 32);
+	if (count)
+		rfx_rlgr_writer_put(w, (1u << count) - 1u, count);
+}
+
+static INLINE size_t rfx_rlgr_writer_finish(RFX_RLGR_WRITER* WINPR_RESTRICT w)
+{
+	/* rfx_bitstream_flush pads with as many zero bits as the last byte already holds */
+	const UINT32 used = w->pending % 8;
+	if (used)
+		rfx_rlgr_writer_put(w, 0, used);
+
+	UINT32 bits = w->pending;
+	for (; bits >= 8; bits -= 8)
+	{
+		if (w->offset < w->size)
+			w->dst[w->offset] = (BYTE)(w->acc >> (bits - 8));
+		w->offset++;
+	}
+
+	if (bits)
+	{
+		if (w->offset < w->size)
+			w->dst[w->offset] = (BYTE)(w->acc << (8 - bits));
+		w->offset++;
+	}
+
+	w->pending = 0;
+	return MIN(w->offset, w->size);
+}
+
+/* GR code of \b val with the unary part, its terminating 0 and the remainder in one word */
+static INLINE void rfx_rlgr_writer_code_gr(RFX_RLGR_WRITER* WINPR_RESTRICT w, int* krp, UINT32 val)
+{
+	const UINT32 kr = (UINT32)(*krp >> LSGR);
+	const UINT32 vk = val >> kr;
+	const UINT32 remainder = val & ((1u << kr) - 1u);
+
+	if (vk + 1 + kr <= 32)
+	{
+		const UINT64 unary = ((1ull << vk) - 1ull) << 1;
+		rfx_rlgr_writer_put(w, (UINT32)((unary << kr) | remainder), vk + 1 + kr);
+	}
+	else
+	{
+		rfx_rlgr_writer_ones(w, vk);
+		rfx_rlgr_writer_put(w, remainder, kr + 1);
+	}
+
+	/* update krp, only if it is not equal to 1 */
+	if (vk == 0)
+		*krp = MAX(*krp - 2, 0);
+	else if (vk > 1)
+		*krp = MIN(*krp + (int)vk, KPMAX);
+}
+
+/* Number of zero coefficients at the start of \b data */
+static INLINE size_t rfx_rlgr_zero_run(const INT16* WINPR_RESTRICT data, size_t size)
+{
+	size_t x = 0;
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	const __m128i zero = _mm_setzero_si128();
+	for (; x + 8 <= size; x += 8)
+	{
+		const __m128i v = _mm_loadu_si128((const __m128i*)&data[x]);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi16(v, zero)) != 0xFFFF)
+			break;
+	}
+#elif defined(NEON_INTRINSICS_ENABLED)
+	for (; x + 8 <= size; x += 8)
+	{
+		const uint64x2_t v = vreinterpretq_u64_s16(vld1q_s16(&data[x]));
+		if ((vgetq_lane_u64(v, 0) | vgetq_lane_u64(v, 1)) != 0)
+			break;
+	}
+#else
+	for (; x + 4 <= size; x += 4)
+	{
+		UINT64 v = 0;
+		memcpy(&v, &data[x], sizeof(v));
+		if (v != 0)
+			break;
+	}
+#endif
+
+	while ((x < size) && (data[x] == 0))
+		x++;
+	return x;
+}
+
+/* Same bitstream as rfx_rlgr_encode, which stays as the reference implementation */
+int rfx_rlgr_encode_fast(RLGR_MODE mode, const INT16* WINPR_RESTRICT data, UINT32 data_size,
+                         BYTE* WINPR_RESTRICT buffer, UINT32 buffer_size)
+{
+	int k = 1;
+	int kp = 1 << LSGR;
+	int krp = 1 << LSGR;
+	size_t x = 0;
+	RFX_RLGR_WRITER writer = { 0 };
+	RFX_RLGR_WRITER* w = &writer;
+
+	w->dst = buffer;
+	w->size = buffer_size;
+
+	while (x < data_size)
+	{
+		if (k)
+		{
+			/* RUN-LENGTH MODE */
+			INT32 input = 0;
+			UINT32 numZeros = (UINT32)rfx_rlgr_zero_run(&data[x], data_size - x);
+
+			/* A run up to the end encodes its last zero as value */
+			if (x + numZeros >= data_size)
+			{
+				x = data_size;
+				numZeros--;
+			}
+			else
+			{
+				input = data[x + numZeros];
+				x += numZeros + 1;
+			}
+
+			UINT32 runmax = 1u << k;
+			while (numZeros >= runmax)
+			{
+				rfx_rlgr_writer_put(w, 0, 1); /* output a zero bit */
+				numZeros -= runmax;
+				UpdateParam(kp, UP_GR, k); /* update kp, k */
+				runmax = 1u << k;
+			}
+
+			/* a 1 to terminate the run, the remaining run length in k bits and the sign */
+			const UINT32 mag = (UINT32)(input < 0 ? -input : input);
+			const UINT32 sign = (input < 0 ? 1 : 0);
+			rfx_rlgr_writer_put(w, (1u << (k + 1)) | (numZeros << 1) | sign, (UINT32)k + 2);
+
+			rfx_rlgr_writer_code_gr(w, &krp, mag ? mag - 1 : 0);
+			UpdateParam(kp, -DN_GR, k);
+		}
+		else if (mode == RLGR1)
+		{
+			/* GOLOMB-RICE MODE, RLGR1 variant */
+			const INT32 input = data[x++];
+			const UINT32 twoMs = (UINT32)Get2MagSign(input);
+
+			rfx_rlgr_writer_code_gr(w, &krp, twoMs);
+			if (twoMs)
+			{
+				UpdateParam(kp, -DQ_GR, k);
+			}
+			else
+			{
+				UpdateParam(kp, UQ_GR, k);
+			}
+		}
+		else
+		{
+			/* GOLOMB-RICE MODE, RLGR3 variant */
+			const INT32 input1 = data[x++];
+			const INT32 input2 = (x < data_size) ? data[x++] : 0;
+			const UINT32 twoMs1 = (UINT32)Get2MagSign(input1);
+			const UINT32 twoMs2 = (UINT32)Get2MagSign(input2);
+			const UINT32 sum2Ms = twoMs1 + twoMs2;
+
+			rfx_rlgr_writer_code_gr(w, &krp, sum2Ms);
+
+			/* binary representation of twoMs1, OutputBits truncates the value to 16 bits */
+			const UINT32 nIdx = 32 - lzcnt_s(sum2Ms);
+			if (nIdx)
+				rfx_rlgr_writer_put(w, twoMs1 & 0xFFFF, nIdx);
+
+			if (twoMs1 && twoMs2)
+			{
+				UpdateParam(kp, -2 * DQ_GR, k);
+			}
+			else if (!twoMs1 && !twoMs2)
+			{
+				UpdateParam(kp, 2 * UQ_GR, k);
+			}
+		}
+	}
+
+	const size_t processed = rfx_rlgr_writer_finish(w);
+	WINPR_ASSERT(processed <= INT32_MAX);
+	return (int)processed;
+}
+
+/* 64 bit bit reservoir, bits past the end of the stream read as 0 like with wBitStream */
+typedef struct
+{
+	UINT64 acc;   /* next bits of the stream, most significant bit first */
+	UINT32 avail; /* valid bits in acc, always < 64 */
+	const BYTE* src;
+	const BYTE* end;
+} RFX_RLGR_READER;
+
+static INLINE UINT32 rfx_rlgr_clz64(UINT64 x)
+{
+	if (!x)
+		return 64;
+#if defined(__GNUC__) || defined(__clang__)
+	return (UINT32)__builtin_clzll(x);
+#else
+	const UINT32 hi = (UINT32)(x >> 32);
+	if (hi)
+		return lzcnt_s(hi);
+	return 32 + lzcnt_s((UINT32)x);
+#endif
+}
+
+static INLINE void rfx_rlgr_reader_refill(RFX_RLGR_READER* WINPR_RESTRICT r)
+{
+	if (r->end - r->src >= 8)
+	{
+		/* bits loaded past avail are the real next bits, reloading them later is harmless */
+		const UINT64 v = ((UINT64)r->src[0] << 56) | ((UINT64)r->src[1] << 48) |
+		                 ((UINT64)r->src[2] << 40) | ((UINT64)r->src[3] << 32) |
+		                 ((UINT64)r->src[4] << 24) | ((UINT64)r->src[5] << 16) |
+		                 ((UINT64)r->src[6] << 8) | (UINT64)r->src[7];
+		const UINT32 bytes = (63 - r->avail) >> 3;
+
+		r->acc |= v >> r->avail;
+		r->src += bytes;
+		r->avail += bytes * 8;
+	}
+	else
+	{
+		while ((r->avail <= 55) && (r->src < r->end))
+		{
+			r->acc |= (UINT64)*r->src++ << (56 - r->avail);
+			r->avail += 8;
+		}
+	}
+}
+
+static INLINE size_t rfx_rlgr_reader_remaining(const RFX_RLGR_READER* WINPR_RESTRICT r)
+{
+	return (size_t)(r->end - r->src) * 8 + r->avail;
+}
+
+static INLINE void rfx_rlgr_reader_skip(RFX_RLGR_READER* WINPR_RESTRICT r, UINT32 nbits)
+{
+	WINPR_ASSERT(nbits <= r->avail);
+	r->acc <<= nbits;
+	r->avail -= nbits;
+}
+
+/* Read \b nbits (at most 32), the caller checked there are enough bits left */
+static INLINE UINT32 rfx_rlgr_reader_get(RFX_RLGR_READER* WINPR_RESTRICT r, UINT32 nbits)
+{
+	if (!nbits)
+		return 0;
+
+	if (r->avail < nbits)
+		rfx_rlgr_reader_refill(r);
+
+	const UINT32 value = (UINT32)(r->acc >> (64 - nbits));
+	rfx_rlgr_reader_skip(r, nbits);
+	return value;
+}
+
+/* Count and skip the bits equal to \b bit up to the next different one, which is consumed too.
+ * Returns \b FALSE if the stream ends before that bit.
+ */
+static INLINE BOOL rfx_rlgr_reader_unary(RFX_RLGR_READER* WINPR_RESTRICT r, BOOL bit,
+                                         UINT32* WINPR_RESTRICT count)
+{
+	const UINT64 invert = bit ? UINT64_MAX : 0;
+	UINT32 n = 0;
+
+	for (;;)
+	{
+		if (r->avail < 32)
+			rfx_rlgr_reader_refill(r);
+		if (!r->avail)
+			break;
+
+		const UINT32 cnt = rfx_rlgr_clz64(r->acc ^ invert);
+		if (cnt < r->avail)
+		{
+			rfx_rlgr_reader_skip(r, cnt + 1);
+			*count = n + cnt;
+			return TRUE;
+		}
+
+		n += r->avail;
+		rfx_rlgr_reader_skip(r, r->avail);
+	}
+
+	*count = n;
+	return FALSE;
+}
+
+/* code = 2 * mag - sign */
+static INLINE INT16 rfx_rlgr_gr_mag(UINT32 val)
+{
+	if (val & 1)
+		return (INT16)(((INT16)((val + 1) >> 1)) * -1);
+	return (INT16)(val >> 1);
+}
+
+/* Read the GR coded value, the unary part, its terminating 0 and kr bits of remainder */
+static INLINE BOOL rfx_rlgr_reader_code_gr(RFX_RLGR_READER* WINPR_RESTRICT r, INT32* krp,
+                                           UINT32* kr, UINT16* code)
+{
+	UINT32 vk = 0;
+
+	if (!rfx_rlgr_reader_unary(r, TRUE, &vk))
+		return FALSE;
+
+	if (rfx_rlgr_reader_remaining(r) < *kr)
+		return FALSE;
+
+	*code = (UINT16)(rfx_rlgr_reader_get(r, *kr) | (vk << *kr));
+
+	if (!vk)
+	{
+		*krp = MAX(*krp - 2, 0);
+		*kr = (UINT32)*krp >> LSGR;
+	}
+	else if (vk != 1)
+	{
+		*krp = (INT32)MIN((UINT32)*krp + vk, KPMAX);
+		*kr = (UINT32)*krp >> LSGR;
+	}
+	return TRUE;
+}
+
+/* Same output as rfx_rlgr_decode, which stays as the reference implementation */
+int rfx_rlgr_decode_fast(RLGR_MODE mode, const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcSize,
+                         INT16* WINPR_RESTRICT pDstData, UINT32 rDstSize)
+{
+	UINT32 k = 1;
+	INT32 kp = 1 << LSGR;
+	UINT32 kr = 1;
+	INT32 krp = 1 << LSGR;
+	size_t offset = 0;
+	const size_t DstSize = rDstSize;
+	RFX_RLGR_READER reader = { 0 };
+	RFX_RLGR_READER* r = &reader;
+
+	InitOnceExecuteOnce(&rfx_rlgr_init_once, rfx_rlgr_init, NULL, NULL);
+
+	if ((mode != RLGR1) && (mode != RLGR3))
+		mode = RLGR1;
+
+	if (!pSrcData || !SrcSize)
+		return -1;
+
+	if (!pDstData || !DstSize)
+		return -1;
+
+	/* Zero runs only advance the output offset */
+	ZeroMemory(pDstData, DstSize * sizeof(INT16));
+
+	r->src = pSrcData;
+	r->end = &pSrcData[SrcSize];
+
+	while ((rfx_rlgr_reader_remaining(r) > 0) && (offset < DstSize))
+	{
+		UINT16 code = 0;
+
+		if (k)
+		{
+			/* Run-Length (RL) Mode */
+			UINT32 vk = 0;
+			size_t run = 0;
+
+			if (!rfx_rlgr_reader_unary(r, FALSE, &vk))
+				break;
+
+			/* every 0 adds (1 << k) to the run length, k stops growing at KPMAX */
+			for (; vk && (kp < KPMAX); vk--)
+			{
+				run += (size_t)1 << k;
+				kp = MIN(kp + UP_GR, KPMAX);
+				k = (UINT32)kp >> LSGR;
+			}
+			run += (size_t)vk << k;
+
+			/* next k bits contain run length remainder and the sign bit follows */
+			if (rfx_rlgr_reader_remaining(r) < k + 1)
+				break;
+
+			run += rfx_rlgr_reader_get(r, k);
+			const UINT32 sign = rfx_rlgr_reader_get(r, 1);
+
+			if (!rfx_rlgr_reader_code_gr(r, &krp, &kr, &code))
+				break;
+
+			kp = MAX(kp - DN_GR, 0);
+			k = (UINT32)kp >> LSGR;
+
+			offset += MIN(run, DstSize - offset);
+			if (offset < DstSize)
+			{
+				if (sign)
+					pDstData[offset++] = (INT16)(((INT16)(code + 1)) * -1);
+				else
+					pDstData[offset++] = (INT16)(code + 1);
+			}
+		}
+		else
+		{
+			/* Golomb-Rice (GR) Mode */
+			if (!rfx_rlgr_reader_code_gr(r, &krp, &kr, &code))
+				break;
+
+			if (mode == RLGR1)
+			{
+				if (!code)
+					kp = MIN(kp + UQ_GR, KPMAX);
+				else
+					kp = MAX(kp - DQ_GR, 0);
+				k = (UINT32)kp >> LSGR;
+
+				/* a 0 is already in the output */
+				if (code)
+					pDstData[offset] = rfx_rlgr_gr_mag(code);
+				offset++;
+			}
+			else
+			{
+				UINT32 nIdx = 0;
+				UINT32 val1 = 0;
+
+				/* like rfx_rlgr_decode the length of val1 is taken from the sign extended code,
+				 * 32 bits for codes >= 0x8000 which read as 0 without consuming any bits */
+				if (code)
+					nIdx = 32 - lzcnt_s((UINT32)(INT32)(INT16)code);
+
+				if (rfx_rlgr_reader_remaining(r) < nIdx)
+					break;
+
+				if (nIdx < 32)
+					val1 = rfx_rlgr_reader_get(r, nIdx);
+
+				const UINT32 val2 = code - val1;
+
+				if (val1 && val2)
+					kp = MAX(kp - 2 * DQ_GR, 0);
+				else if (!val1 && !val2)
+					kp = MIN(kp + 2 * UQ_GR, KPMAX);
+				k = (UINT32)kp >> LSGR;
+
+				pDstData[offset++] = rfx_rlgr_gr_mag(val1);
+				if (offset < DstSize)
+					pDstData[offset++] = rfx_rlgr_gr_mag(val2);
+			}
+		}
+	}
+
+	return 1;
+}
@@ -27,7 +27,22 @@ FREERDP_LOCAL int rfx_rlgr_encode(RLGR_MODE mode, const INT16* WINPR_RESTRICT da
                                   UINT32 data_size, BYTE* WINPR_RESTRICT buffer,
                                   UINT32 buffer_size);
 
+/** @brief Word based RLGR1/RLGR3 encoder, the output is identical to \b rfx_rlgr_encode
+ *
+ *  Unlike \b rfx_rlgr_encode the output buffer does not need to be initialized.
+ */
+FREERDP_LOCAL int rfx_rlgr_encode_fast(RLGR_MODE mode, const INT16* WINPR_RESTRICT data,
+                                       UINT32 data_size, BYTE* WINPR_RESTRICT buffer,
+                                       UINT32 buffer_size);
+
 FREERDP_LOCAL int rfx_rlgr_decode(RLGR_MODE mode, const BYTE* WINPR_RESTRICT pSrcData,
                                   UINT32 SrcSize, INT16* WINPR_RESTRICT pDstData, UINT32 rDstSize);
 
+/** @brief RLGR1/RLGR3 decoder with a 64 bit bit reservoir, the output is identical to
+ *  \b rfx_rlgr_decode
+ */
+FREERDP_LOCAL int rfx_rlgr_decode_fast(RLGR_MODE mode, const BYTE* WINPR_RESTRICT pSrcData,
+                                       UINT32 SrcSize, INT16* WINPR_RESTRICT pDstData,
+                                       UINT32 rDstSize);
+
 #endif /* FREERDP_LIB_CODEC_RFX_RLGR_H */
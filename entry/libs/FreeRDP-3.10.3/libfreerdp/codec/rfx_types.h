@@ -72,8 +72,10 @@ struct S_RFX_CONTEXT_PRIV
 	DWORD MinThreadCount;
 	DWORD MaxThreadCount;
 
+	/* created on first use unless the context runs on a shared pool */
 	PTP_POOL ThreadPool;
 	TP_CALLBACK_ENVIRON ThreadPoolEnv;
+	PTP_CALLBACK_ENVIRON CallbackEnvironment;
 
 	wBufferPool* BufferPool;
 
@@ -181,4 +183,7 @@ struct S_RFX_CONTEXT
 	RFX_CONTEXT_PRIV* priv;
 };
 
+/* The environment tile work of the context is submitted with, NULL for the default pool */
+FREERDP_LOCAL PTP_CALLBACK_ENVIRON rfx_get_callback_environment(RFX_CONTEXT* context);
+
 #endif /* FREERDP_LIB_CODEC_RFX_TYPES_H */
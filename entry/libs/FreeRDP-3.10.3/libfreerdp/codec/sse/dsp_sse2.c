@@ -0,0 +1,133 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Digital Sound Processing - SSE2 Optimizations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/platform.h>
+#include <freerdp/config.h>
+
+#include "dsp_sse2.h"
+
+#include "../../core/simd.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <emmintrin.h>
+
+#include <winpr/sysinfo.h>
+
+static INT32 dsp_dot_sse2(const INT16* WINPR_RESTRICT samples, const INT16* WINPR_RESTRICT coeffs,
+                          size_t taps)
+{
+	__m128i acc0 = _mm_setzero_si128();
+	__m128i acc1 = _mm_setzero_si128();
+	size_t x = 0;
+
+	/* the bank rows are 16 byte aligned, the history window is not */
+	for (; x + 16 <= taps; x += 16)
+	{
+		const __m128i s0 = _mm_loadu_si128((const __m128i*)&samples[x]);
+		const __m128i s1 = _mm_loadu_si128((const __m128i*)&samples[x + 8]);
+		const __m128i c0 = _mm_load_si128((const __m128i*)&coeffs[x]);
+		const __m128i c1 = _mm_load_si128((const __m128i*)&coeffs[x + 8]);
+		acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(s0, c0));
+		acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(s1, c1));
+	}
+
+	for (; x < taps; x += 8)
+	{
+		const __m128i s = _mm_loadu_si128((const __m128i*)&samples[x]);
+		const __m128i c = _mm_load_si128((const __m128i*)&coeffs[x]);
+		acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(s, c));
+	}
+
+	__m128i acc = _mm_add_epi32(acc0, acc1);
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(acc);
+}
+
+static void dsp_mono_to_stereo_sse2(const INT16* WINPR_RESTRICT src, INT16* WINPR_RESTRICT dst,
+                                    size_t frames)
+{
+	size_t x = 0;
+
+	for (; x + 8 <= frames; x += 8)
+	{
+		const __m128i s = _mm_loadu_si128((const __m128i*)&src[x]);
+		_mm_storeu_si128((__m128i*)&dst[2 * x], _mm_unpacklo_epi16(s, s));
+		_mm_storeu_si128((__m128i*)&dst[2 * x + 8], _mm_unpackhi_epi16(s, s));
+	}
+
+	for (; x < frames; x++)
+	{
+		dst[2 * x] = src[x];
+		dst[2 * x + 1] = src[x];
+	}
+}
+
+static void dsp_stereo_to_mono_sse2(const INT16* WINPR_RESTRICT src, INT16* WINPR_RESTRICT dst,
+                                    size_t frames)
+{
+	const __m128i ones = _mm_set1_epi16(1);
+	size_t x = 0;
+
+	/* left + right as 32 bit sums, halved and packed back without saturating */
+	for (; x + 8 <= frames; x += 8)
+	{
+		const __m128i s0 = _mm_loadu_si128((const __m128i*)&src[2 * x]);
+		const __m128i s1 = _mm_loadu_si128((const __m128i*)&src[2 * x + 8]);
+		const __m128i m0 = _mm_srai_epi32(_mm_madd_epi16(s0, ones), 1);
+		const __m128i m1 = _mm_srai_epi32(_mm_madd_epi16(s1, ones), 1);
+		_mm_storeu_si128((__m128i*)&dst[x], _mm_packs_epi32(m0, m1));
+	}
+
+	for (; x < frames; x++)
+		dst[x] = (INT16)((src[2 * x] + src[2 * x + 1]) >> 1);
+}
+
+static void dsp_u8_to_s16_sse2(const BYTE* WINPR_RESTRICT src, INT16* WINPR_RESTRICT dst,
+                               size_t samples)
+{
+	const __m128i bias = _mm_set1_epi8((char)0x80);
+	const __m128i zero = _mm_setzero_si128();
+	size_t x = 0;
+
+	/* flipping the top bit makes the samples signed, the low byte of each result is zero */
+	for (; x + 16 <= samples; x += 16)
+	{
+		const __m128i s = _mm_xor_si128(_mm_loadu_si128((const __m128i*)&src[x]), bias);
+		_mm_storeu_si128((__m128i*)&dst[x], _mm_unpacklo_epi8(zero, s));
+		_mm_storeu_si128((__m128i*)&dst[x + 8], _mm_unpackhi_epi8(zero, s));
+	}
+
+	for (; x < samples; x++)
+		dst[x] = (INT16)((src[x] ^ 0x80) << 8);
+}
+#endif
+
+void freerdp_dsp_init_sse2(FREERDP_DSP_KERNELS* kernels)
+{
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	if (!IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE))
+		return;
+
+	kernels->dot = dsp_dot_sse2;
+	kernels->mono_to_stereo = dsp_mono_to_stereo_sse2;
+	kernels->stereo_to_mono = dsp_stereo_to_mono_sse2;
+	kernels->u8_to_s16 = dsp_u8_to_s16_sse2;
+#else
+	WINPR_UNUSED(kernels);
+#endif
+}
@@ -0,0 +1,320 @@
+
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <winpr/crt.h>
+#include <winpr/crypto.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/freerdp.h>
+#include <freerdp/codec/dsp.h>
+
+#define TEST_PI 3.14159265358979323846
+
+static AUDIO_FORMAT test_pcm_format(UINT32 rate, UINT16 channels, UINT16 bits)
+{
+	AUDIO_FORMAT format = { 0 };
+	format.wFormatTag = WAVE_FORMAT_PCM;
+	format.nChannels = channels;
+	format.nSamplesPerSec = rate;
+	format.wBitsPerSample = bits;
+	format.nBlockAlign = (UINT16)(channels * bits / 8);
+	format.nAvgBytesPerSec = rate * format.nBlockAlign;
+	return format;
+}
+
+static BYTE* test_sine(UINT32 rate, UINT16 channels, double frequency, size_t frames)
+{
+	BYTE* data = calloc(frames, 2ull * channels);
+	if (!data)
+		return NULL;
+
+	for (size_t x = 0; x < frames; x++)
+	{
+		const double v = 16384.0 * sin(2.0 * TEST_PI * frequency * (double)x / rate);
+		const INT16 s = (INT16)lround(v);
+
+		for (size_t c = 0; c < channels; c++)
+		{
+			data[(x * channels + c) * 2] = (BYTE)(s & 0xFF);
+			data[(x * channels + c) * 2 + 1] = (BYTE)((s >> 8) & 0xFF);
+		}
+	}
+	return data;
+}
+
+static INT16 test_sample(const BYTE* data, size_t index)
+{
+	return (INT16)(data[2 * index] | (data[2 * index + 1] << 8));
+}
+
+/* Feed \b frames frames in chunks of \b chunk frames (random sizes if 0) */
+static wStream* test_encode(const AUDIO_FORMAT* src, const AUDIO_FORMAT* dst, const BYTE* data,
+                            size_t frames, size_t chunk)
+{
+	wStream* out = Stream_New(NULL, 1024);
+	FREERDP_DSP_CONTEXT* context = freerdp_dsp_context_new(TRUE);
+	if (!out || !context || !freerdp_dsp_context_reset(context, dst, 0))
+		goto fail;
+
+	for (size_t x = 0; x < frames;)
+	{
+		size_t count = chunk;
+		if (count == 0)
+		{
+			UINT16 r = 0;
+			winpr_RAND(&r, sizeof(r));
+			count = 1 + r % 1500;
+		}
+		count = MIN(count, frames - x);
+
+		if (!freerdp_dsp_encode(context, src, &data[x * src->nBlockAlign],
+		                        count * src->nBlockAlign, out))
+		{
+			(void)fprintf(stderr, "freerdp_dsp_encode %" PRIu32 " -> %" PRIu32 " failed\n",
+			              src->nSamplesPerSec, dst->nSamplesPerSec);
+			goto fail;
+		}
+		x += count;
+	}
+
+	freerdp_dsp_context_free(context);
+	Stream_SealLength(out);
+	return out;
+
+fail:
+	freerdp_dsp_context_free(context);
+	Stream_Free(out, TRUE);
+	return NULL;
+}
+
+/* Signal to noise ratio of channel \b channel against the ideal tone at the destination rate,
+ * skipping the first and last filter lengths */
+static double test_snr(wStream* s, const AUDIO_FORMAT* dst, double frequency, size_t channel)
+{
+	const BYTE* data = Stream_Buffer(s);
+	const size_t frames = Stream_Length(s) / dst->nBlockAlign;
+	double signal = 0.0;
+	double noise = 0.0;
+
+	for (size_t x = 512; x + 512 < frames; x++)
+	{
+		const double t = (double)x / dst->nSamplesPerSec;
+		const double ref = 16384.0 * sin(2.0 * TEST_PI * frequency * t);
+		const double v = test_sample(data, x * dst->nChannels + channel);
+		signal += ref * ref;
+		noise += (v - ref) * (v - ref);
+	}
+
+	if (noise <= 0.0)
+		return 200.0;
+	return 10.0 * log10(signal / noise);
+}
+
+static BOOL test_tone(UINT32 srcRate, UINT16 srcChannels, UINT32 dstRate, UINT16 dstChannels,
+                      double frequency, double minSnr)
+{
+	BOOL rc = FALSE;
+	const size_t frames = srcRate / 2;
+	const AUDIO_FORMAT src = test_pcm_format(srcRate, srcChannels, 16);
+	const AUDIO_FORMAT dst = test_pcm_format(dstRate, dstChannels, 16);
+	BYTE* data = test_sine(srcRate, srcChannels, frequency, frames);
+	wStream* out = data ? test_encode(&src, &dst, data, frames, srcRate / 100) : NULL;
+	if (!out)
+		goto fail;
+
+	for (size_t c = 0; c < dstChannels; c++)
+	{
+		const double snr = test_snr(out, &dst, frequency, c);
+		(void)fprintf(stdout,
+		              "%" PRIu32 "/%" PRIu16 " -> %" PRIu32 "/%" PRIu16
+		              " %.0f Hz channel %" PRIuz ": %.1f dB\n",
+		              srcRate, srcChannels, dstRate, dstChannels, frequency, c, snr);
+		if (snr < minSnr)
+			goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	Stream_Free(out, TRUE);
+	free(data);
+	return rc;
+}
+
+/* A tone above the destination Nyquist frequency must not alias back */
+static BOOL test_alias(UINT32 srcRate, UINT32 dstRate, double frequency, double minAttenuation)
+{
+	BOOL rc = FALSE;
+	const size_t frames = srcRate / 2;
+	const AUDIO_FORMAT src = test_pcm_format(srcRate, 1, 16);
+	const AUDIO_FORMAT dst = test_pcm_format(dstRate, 1, 16);
+	BYTE* data = test_sine(srcRate, 1, frequency, frames);
+	wStream* out = data ? test_encode(&src, &dst, data, frames, 480) : NULL;
+	if (!out)
+		goto fail;
+
+	const size_t count = Stream_Length(out) / 2;
+	double power = 0.0;
+	for (size_t x = 512; x + 512 < count; x++)
+	{
+		const double v = test_sample(Stream_Buffer(out), x);
+		power += v * v;
+	}
+	power /= (double)(count - 1024);
+
+	/* the input power of a sine with amplitude 16384 */
+	const double attenuation = 10.0 * log10((16384.0 * 16384.0 / 2.0) / MAX(power, 1e-3));
+	(void)fprintf(stdout, "%" PRIu32 " -> %" PRIu32 " %.0f Hz: %.1f dB attenuation\n", srcRate,
+	              dstRate, frequency, attenuation);
+	rc = attenuation >= minAttenuation;
+
+fail:
+	Stream_Free(out, TRUE);
+	free(data);
+	return rc;
+}
+
+/* The chunking of the input must not change the output */
+static BOOL test_streaming(UINT32 srcRate, UINT32 dstRate)
+{
+	BOOL rc = FALSE;
+	const size_t frames = srcRate;
+	const AUDIO_FORMAT src = test_pcm_format(srcRate, 2, 16);
+	const AUDIO_FORMAT dst = test_pcm_format(dstRate, 2, 16);
+	BYTE* data = calloc(frames, src.nBlockAlign);
+	wStream* whole = NULL;
+	wStream* chunked = NULL;
+
+	if (!data)
+		goto fail;
+
+	winpr_RAND(data, frames * src.nBlockAlign);
+	whole = test_encode(&src, &dst, data, frames, frames);
+	chunked = test_encode(&src, &dst, data, frames, 0);
+	if (!whole || !chunked)
+		goto fail;
+
+	if ((Stream_Length(whole) != Stream_Length(chunked)) ||
+	    (memcmp(Stream_Buffer(whole), Stream_Buffer(chunked), Stream_Length(whole)) != 0))
+	{
+		(void)fprintf(stderr, "%" PRIu32 " -> %" PRIu32 ": chunked output differs\n", srcRate,
+		              dstRate);
+		goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	Stream_Free(whole, TRUE);
+	Stream_Free(chunked, TRUE);
+	free(data);
+	return rc;
+}
+
+/* 8 bit stereo to 16 bit mono, no resampling involved */
+static BOOL test_mix(void)
+{
+	BOOL rc = FALSE;
+	const size_t frames = 1001;
+	const AUDIO_FORMAT src = test_pcm_format(22050, 2, 8);
+	const AUDIO_FORMAT dst = test_pcm_format(22050, 1, 16);
+	BYTE* data = calloc(frames, src.nBlockAlign);
+	wStream* out = NULL;
+
+	if (!data)
+		goto fail;
+
+	winpr_RAND(data, frames * src.nBlockAlign);
+	out = test_encode(&src, &dst, data, frames, 100);
+	if (!out || (Stream_Length(out) != frames * dst.nBlockAlign))
+		goto fail;
+
+	for (size_t x = 0; x < frames; x++)
+	{
+		const INT32 left = (data[2 * x] - 128) * 256;
+		const INT32 right = (data[2 * x + 1] - 128) * 256;
+		const INT16 expect = (INT16)((left + right) >> 1);
+
+		if (test_sample(Stream_Buffer(out), x) != expect)
+		{
+			(void)fprintf(stderr, "mixed sample %" PRIuz " is %" PRId16 ", expected %" PRId16 "\n",
+			              x, test_sample(Stream_Buffer(out), x), expect);
+			goto fail;
+		}
+	}
+
+	rc = TRUE;
+fail:
+	Stream_Free(out, TRUE);
+	free(data);
+	return rc;
+}
+
+static BOOL test_throughput(UINT32 srcRate, UINT32 dstRate)
+{
+	BOOL rc = FALSE;
+	const size_t frames = 10ull * srcRate;
+	const AUDIO_FORMAT src = test_pcm_format(srcRate, 2, 16);
+	const AUDIO_FORMAT dst = test_pcm_format(dstRate, 2, 16);
+	BYTE* data = test_sine(srcRate, 2, 440.0, frames);
+	wStream* out = NULL;
+
+	if (!data)
+		goto fail;
+
+	const UINT64 start = winpr_GetTickCount64NS();
+	out = test_encode(&src, &dst, data, frames, srcRate / 50);
+	const UINT64 end = winpr_GetTickCount64NS();
+	if (!out)
+		goto fail;
+
+	const double seconds = (double)(end - start) / 1000000000.0;
+	(void)fprintf(stdout, "%" PRIu32 " -> %" PRIu32 " stereo: %.1f x realtime\n", srcRate,
+	              dstRate, 10.0 / MAX(seconds, 1e-9));
+	rc = TRUE;
+
+fail:
+	Stream_Free(out, TRUE);
+	free(data);
+	return rc;
+}
+
+int TestFreeRDPCodecDsp(int argc, char* argv[])
+{
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!test_mix())
+		return -1;
+
+	if (!test_tone(44100, 1, 48000, 2, 1000.0, 65.0))
+		return -1;
+	if (!test_tone(48000, 2, 44100, 2, 5000.0, 65.0))
+		return -1;
+	if (!test_tone(8000, 1, 44100, 1, 440.0, 65.0))
+		return -1;
+	if (!test_tone(48000, 2, 16000, 1, 3000.0, 65.0))
+		return -1;
+	/* no small common divisor, interpolates between the phases */
+	if (!test_tone(44100, 1, 47999, 1, 1000.0, 60.0))
+		return -1;
+
+	if (!test_alias(48000, 16000, 12000.0, 65.0))
+		return -1;
+	if (!test_alias(44100, 22050, 15000.0, 65.0))
+		return -1;
+
+	if (!test_streaming(44100, 48000))
+		return -1;
+	if (!test_streaming(48000, 8000))
+		return -1;
+	if (!test_streaming(22050, 47999))
+		return -1;
+
+	if (!test_throughput(48000, 44100))
+		return -1;
+	if (!test_throughput(44100, 16000))
+		return -1;
+
+	return 0;
+}
@@ -1120,6 +1120,133 @@ fail:
 	return res;
 }
 
+static BOOL test_compare_image(const wImage* image, const BYTE* resultData, UINT32 ColorFormat)
+{
+	for (size_t y = 0; y < image->height; y++)
+	{
+		const BYTE* orig = &image->data[y * image->scanline];
+		const BYTE* dec = &resultData[y * image->scanline];
+		for (size_t x = 0; x < image->width; x++)
+		{
+			const DWORD a = FreeRDPReadColor(&orig[x * 4], ColorFormat);
+			const DWORD b = FreeRDPReadColor(&dec[x * 4], ColorFormat);
+			if (!colordiff(ColorFormat, a, b))
+			{
+				printf("xxxxxxx [%" PRIuz ":%" PRIuz "] [%s] %08" PRIX32 " != %08" PRIX32 "\n", x,
+				       y, FreeRDPGetColorFormatName(ColorFormat), a, b);
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
+/* Coarse first passes followed by upgrade passes under a bandwidth limit, the decoder
+ * upgrade path must end up at the same result as a full quality encode */
+static BOOL test_encode_decode_passes(const char* path)
+{
+	BOOL res = FALSE;
+	int rc = 0;
+	BYTE* resultData = NULL;
+	BYTE* dstData = NULL;
+	UINT32 dstSize = 0;
+	UINT32 frames = 0;
+	const UINT32 ColorFormat = PIXEL_FORMAT_BGRX32;
+	const RECTANGLE_16 changed = { 70, 40, 170, 90 };
+	REGION16 invalidRegion = { 0 };
+	REGION16 updateRegion = { 0 };
+	wImage* image = winpr_image_new();
+	char* name = GetCombinedPath(path, "progressive.bmp");
+	PROGRESSIVE_CONTEXT* progressiveEnc = progressive_context_new(TRUE);
+	PROGRESSIVE_CONTEXT* progressiveDec = progressive_context_new(FALSE);
+
+	region16_init(&invalidRegion);
+	region16_init(&updateRegion);
+	if (!image || !name || !progressiveEnc || !progressiveDec)
+		goto fail;
+
+	if (!progressive_compress_set_bandwidth(progressiveEnc, 16 * 1024) ||
+	    progressive_compress_set_bandwidth(progressiveDec, 16 * 1024))
+		goto fail;
+
+	rc = winpr_image_read(image, name);
+	if (rc <= 0)
+		goto fail;
+
+	resultData = calloc(image->scanline, image->height);
+	if (!resultData)
+		goto fail;
+
+	rc = progressive_create_surface_context(progressiveDec, 0, image->width, image->height);
+	if (rc <= 0)
+		goto fail;
+
+	const UINT32 size = image->scanline * image->height;
+	rc = progressive_compress(progressiveEnc, image->data, size, ColorFormat, image->width,
+	                          image->height, image->scanline, NULL, &dstData, &dstSize);
+	if (rc <= 0)
+		goto fail;
+
+	do
+	{
+		rc = progressive_decompress(progressiveDec, dstData, dstSize, resultData, ColorFormat,
+		                            image->scanline, 0, 0, &updateRegion, 0, frames);
+		if (rc < 0)
+			goto fail;
+
+		/* Change part of the image while upgrades are still pending */
+		if (++frames == 2)
+		{
+			for (UINT16 y = changed.top; y < changed.bottom; y++)
+				memset(&image->data[1ull * y * image->scanline + changed.left * 4ull],
+				       0x40 + y, (changed.right - changed.left) * 4ull);
+			if (!region16_union_rect(&invalidRegion, &invalidRegion, &changed))
+				goto fail;
+		}
+		else
+			region16_clear(&invalidRegion);
+
+		if (!progressive_compress_has_upgrades(progressiveEnc) &&
+		    region16_is_empty(&invalidRegion))
+			break;
+
+		rc = progressive_compress(progressiveEnc, image->data, size, ColorFormat, image->width,
+		                          image->height, image->scanline, &invalidRegion, &dstData,
+		                          &dstSize);
+		if ((rc <= 0) || (dstSize > 20 * 1024))
+		{
+			printf("upgrade frame %" PRIu32 " failed with %d, %" PRIu32 " bytes\n", frames, rc,
+			       dstSize);
+			goto fail;
+		}
+	} while (frames < 1000);
+
+	/* The bandwidth must spread the passes over several frames */
+	if ((frames < 4) || progressive_compress_has_upgrades(progressiveEnc))
+	{
+		printf("unexpected number of frames %" PRIu32 "\n", frames);
+		goto fail;
+	}
+
+	/* Nothing changed and everything is at full quality */
+	region16_clear(&invalidRegion);
+	rc = progressive_compress(progressiveEnc, image->data, size, ColorFormat, image->width,
+	                          image->height, image->scanline, &invalidRegion, &dstData, &dstSize);
+	if (rc != 0)
+		goto fail;
+
+	res = test_compare_image(image, resultData, ColorFormat);
+fail:
+	region16_uninit(&invalidRegion);
+	region16_uninit(&updateRegion);
+	progressive_context_free(progressiveEnc);
+	progressive_context_free(progressiveDec);
+	winpr_image_free(image, TRUE);
+	free(resultData);
+	free(name);
+	return res;
+}
+
 static BOOL read_cmd(FILE* fp, RDPGFX_SURFACE_COMMAND* cmd, UINT32* frameId)
 {
 	WINPR_ASSERT(fp);
@@ -1502,6 +1629,8 @@ int TestFreeRDPCodecProgressive(int argc, char* argv[])
 		    */
 		if (!test_encode_decode(ms_sample_path))
 			goto fail;
+		if (!test_encode_decode_passes(ms_sample_path))
+			goto fail;
 		rc = 0;
 	}
 
@@ -1,5 +1,6 @@
 #include <winpr/crt.h>
 #include <winpr/print.h>
+#include <winpr/sysinfo.h>
 
 #include <freerdp/freerdp.h>
 #include <freerdp/codec/rfx.h>
@@ -842,6 +843,177 @@ static BOOL fuzzyCompareImage(const UINT32* crefImage, const BYTE* img, size_t n
 	return TRUE;
 }
 
+#define BENCH_WIDTH 1024
+#define BENCH_HEIGHT 768
+#define BENCH_FRAMES 8
+
+/* Flat areas, gradients and noise, so both run-length and Golomb-Rice mode are used */
+static void test_fill_bench_image(BYTE* data, size_t stride)
+{
+	UINT32 seed = 0x12345678;
+
+	for (size_t y = 0; y < BENCH_HEIGHT; y++)
+	{
+		UINT32* line = (UINT32*)&data[y * stride];
+		for (size_t x = 0; x < BENCH_WIDTH; x++)
+		{
+			seed = seed * 1103515245u + 12345u;
+			if ((x / 128 + y / 128) % 3 == 0)
+				line[x] = 0x00336699;
+			else if ((x / 128 + y / 128) % 3 == 1)
+				line[x] = (UINT32)(((x & 0xFF) << 16) | ((y & 0xFF) << 8) | ((x + y) & 0xFF));
+			else
+				line[x] = (seed >> 8) & 0x00FFFFFF;
+		}
+	}
+}
+
+static BOOL test_encode_frame(RFX_CONTEXT* context, wStream* s, const BYTE* data, size_t stride,
+                              UINT64* duration)
+{
+	const RFX_RECT rect = { 0, 0, BENCH_WIDTH, BENCH_HEIGHT };
+
+	Stream_SetPosition(s, 0);
+	const UINT64 start = winpr_GetTickCount64NS();
+	const BOOL rc = rfx_compose_message(context, s, &rect, 1, data, BENCH_WIDTH, BENCH_HEIGHT,
+	                                    (UINT32)stride);
+	*duration += winpr_GetTickCount64NS() - start;
+	return rc;
+}
+
+/* The word based RLGR encoder must produce the reference bitstream, print the throughput */
+static BOOL test_rlgr_encoders(RLGR_MODE mode)
+{
+	BOOL rc = FALSE;
+	UINT64 reference = 0;
+	UINT64 fast = 0;
+	const size_t stride = FORMAT_SIZE * BENCH_WIDTH;
+	BYTE* data = calloc(BENCH_HEIGHT, stride);
+	wStream* sref = Stream_New(NULL, 1024);
+	wStream* sfast = Stream_New(NULL, 1024);
+	RFX_CONTEXT* ctxref = rfx_context_new(TRUE);
+	RFX_CONTEXT* ctxfast = rfx_context_new(TRUE);
+
+	if (!data || !sref || !sfast || !ctxref || !ctxfast)
+		goto fail;
+
+	test_fill_bench_image(data, stride);
+
+	if (!rfx_context_reset(ctxref, BENCH_WIDTH, BENCH_HEIGHT) ||
+	    !rfx_context_reset(ctxfast, BENCH_WIDTH, BENCH_HEIGHT))
+		goto fail;
+
+	rfx_context_set_pixel_format(ctxref, FORMAT);
+	rfx_context_set_pixel_format(ctxfast, FORMAT);
+	if (!rfx_context_set_mode(ctxref, mode) || !rfx_context_set_mode(ctxfast, mode) ||
+	    !rfx_context_set_fast_rlgr(ctxref, FALSE) || !rfx_context_set_fast_rlgr(ctxfast, TRUE))
+		goto fail;
+
+	for (size_t x = 0; x < BENCH_FRAMES; x++)
+	{
+		if (!test_encode_frame(ctxref, sref, data, stride, &reference) ||
+		    !test_encode_frame(ctxfast, sfast, data, stride, &fast))
+			goto fail;
+
+		const size_t len = Stream_GetPosition(sref);
+		if ((len != Stream_GetPosition(sfast)) ||
+		    (memcmp(Stream_Buffer(sref), Stream_Buffer(sfast), len) != 0))
+		{
+			printf("RLGR%d: frame %" PRIuz " differs from the reference encoder\n",
+			       (mode == RLGR1) ? 1 : 3, x);
+			goto fail;
+		}
+	}
+
+	const double pixels = 1.0 * BENCH_WIDTH * BENCH_HEIGHT * BENCH_FRAMES;
+	printf("RLGR%d %dx%d frames: %.1f Mpixel/s reference, %.1f Mpixel/s fast\n",
+	       (mode == RLGR1) ? 1 : 3, BENCH_WIDTH, BENCH_HEIGHT, pixels * 1000.0 / (double)reference,
+	       pixels * 1000.0 / (double)fast);
+	rc = TRUE;
+fail:
+	rfx_context_free(ctxref);
+	rfx_context_free(ctxfast);
+	Stream_Free(sref, TRUE);
+	Stream_Free(sfast, TRUE);
+	free(data);
+	return rc;
+}
+
+static BOOL test_decode_frame(RFX_CONTEXT* context, wStream* s, BYTE* dst, size_t stride,
+                              UINT64* duration)
+{
+	REGION16 region = { 0 };
+
+	region16_init(&region);
+	const UINT64 start = winpr_GetTickCount64NS();
+	const BOOL rc = rfx_process_message(context, Stream_Buffer(s),
+	                                    (UINT32)Stream_GetPosition(s), 0, 0, dst, FORMAT,
+	                                    (UINT32)stride, BENCH_HEIGHT, &region);
+	*duration += winpr_GetTickCount64NS() - start;
+	region16_uninit(&region);
+	return rc;
+}
+
+/* The RLGR decoder with the bit reservoir must match the reference, print the throughput */
+static BOOL test_rlgr_decoders(RLGR_MODE mode)
+{
+	BOOL rc = FALSE;
+	UINT64 encoded = 0;
+	UINT64 reference = 0;
+	UINT64 fast = 0;
+	const size_t stride = FORMAT_SIZE * BENCH_WIDTH;
+	BYTE* data = calloc(BENCH_HEIGHT, stride);
+	BYTE* dstref = calloc(BENCH_HEIGHT, stride);
+	BYTE* dstfast = calloc(BENCH_HEIGHT, stride);
+	wStream* s = Stream_New(NULL, 1024);
+	RFX_CONTEXT* encoder = rfx_context_new(TRUE);
+	RFX_CONTEXT* ctxref = rfx_context_new(FALSE);
+	RFX_CONTEXT* ctxfast = rfx_context_new(FALSE);
+
+	if (!data || !dstref || !dstfast || !s || !encoder || !ctxref || !ctxfast)
+		goto fail;
+
+	test_fill_bench_image(data, stride);
+
+	if (!rfx_context_reset(encoder, BENCH_WIDTH, BENCH_HEIGHT))
+		goto fail;
+
+	rfx_context_set_pixel_format(encoder, FORMAT);
+	if (!rfx_context_set_mode(encoder, mode) || !rfx_context_set_fast_rlgr(ctxref, FALSE) ||
+	    !rfx_context_set_fast_rlgr(ctxfast, TRUE))
+		goto fail;
+
+	for (size_t x = 0; x < BENCH_FRAMES; x++)
+	{
+		if (!test_encode_frame(encoder, s, data, stride, &encoded) ||
+		    !test_decode_frame(ctxref, s, dstref, stride, &reference) ||
+		    !test_decode_frame(ctxfast, s, dstfast, stride, &fast))
+			goto fail;
+
+		if (memcmp(dstref, dstfast, BENCH_HEIGHT * stride) != 0)
+		{
+			printf("RLGR%d: frame %" PRIuz " differs from the reference decoder\n",
+			       (mode == RLGR1) ? 1 : 3, x);
+			goto fail;
+		}
+	}
+
+	const double pixels = 1.0 * BENCH_WIDTH * BENCH_HEIGHT * BENCH_FRAMES;
+	printf("RLGR%d %dx%d frames decoded: %.1f Mpixel/s reference, %.1f Mpixel/s fast\n",
+	       (mode == RLGR1) ? 1 : 3, BENCH_WIDTH, BENCH_HEIGHT, pixels * 1000.0 / (double)reference,
+	       pixels * 1000.0 / (double)fast);
+	rc = TRUE;
+fail:
+	rfx_context_free(encoder);
+	rfx_context_free(ctxref);
+	rfx_context_free(ctxfast);
+	Stream_Free(s, TRUE);
+	free(data);
+	free(dstref);
+	free(dstfast);
+	return rc;
+}
+
 int TestFreeRDPCodecRemoteFX(int argc, char* argv[])
 {
 	int rc = -1;
@@ -885,6 +1057,12 @@ int TestFreeRDPCodecRemoteFX(int argc, char* argv[])
 	if (!fuzzyCompareImage(srefImage, dest, IMG_WIDTH * IMG_HEIGHT))
 		goto fail;
 
+	if (!test_rlgr_encoders(RLGR1) || !test_rlgr_encoders(RLGR3))
+		goto fail;
+
+	if (!test_rlgr_decoders(RLGR1) || !test_rlgr_decoders(RLGR3))
+		goto fail;
+
 	rc = 0;
 fail:
 	region16_uninit(&region);
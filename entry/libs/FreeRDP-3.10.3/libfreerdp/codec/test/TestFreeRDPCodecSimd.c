@@ -0,0 +1,235 @@
+#include <winpr/crt.h>
+#include <winpr/crypto.h>
+#include <winpr/stream.h>
+
+#include <freerdp/codec/color.h>
+#include <freerdp/codec/nsc.h>
+#include <freerdp/codec/rfx.h>
+
+#include "../../core/simd.h"
+#include "../rfx_types.h"
+#include "../rfx_dwt.h"
+#include "../rfx_quantization.h"
+#include "../nsc_types.h"
+#include "../nsc_encode.h"
+
+/* The encoders pick SSE2 or NEON routines at context creation, every one of them must produce
+ * the same coefficients and planes as the generic C code. */
+
+#define TILE_PIXELS 4096
+
+static INT16* alloc_tile(size_t count)
+{
+	return winpr_aligned_calloc(count, sizeof(INT16), 16);
+}
+
+/* Random YCbCr samples in the 11.5 fixed point range the color conversion produces */
+static void fill_tile(INT16* tile)
+{
+	winpr_RAND(tile, TILE_PIXELS * sizeof(INT16));
+
+	for (size_t x = 0; x < TILE_PIXELS; x++)
+		tile[x] = (INT16)((tile[x] & 0x1FFF) - 4096);
+}
+
+static BOOL compare_tile(const char* what, const INT16* expected, const INT16* actual)
+{
+	for (size_t x = 0; x < TILE_PIXELS; x++)
+	{
+		if (expected[x] != actual[x])
+		{
+			(void)fprintf(stderr, "%s mismatch at %" PRIuz ": %" PRId16 " != %" PRId16 "\n", what,
+			              x, expected[x], actual[x]);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static BOOL test_rfx_dwt_2d_encode(RFX_CONTEXT* context)
+{
+	BOOL rc = FALSE;
+	INT16* src = alloc_tile(TILE_PIXELS);
+	INT16* generic = alloc_tile(TILE_PIXELS);
+	INT16* optimized = alloc_tile(TILE_PIXELS);
+	INT16* temp = alloc_tile(2ULL * TILE_PIXELS);
+
+	if (!src || !generic || !optimized || !temp)
+		goto fail;
+
+	for (size_t run = 0; run < 16; run++)
+	{
+		fill_tile(src);
+		memcpy(generic, src, TILE_PIXELS * sizeof(INT16));
+		memcpy(optimized, src, TILE_PIXELS * sizeof(INT16));
+
+		rfx_dwt_2d_encode(generic, temp);
+		context->dwt_2d_encode(optimized, temp);
+
+		if (!compare_tile("rfx_dwt_2d_encode", generic, optimized))
+			goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	winpr_aligned_free(src);
+	winpr_aligned_free(generic);
+	winpr_aligned_free(optimized);
+	winpr_aligned_free(temp);
+	return rc;
+}
+
+static BOOL test_rfx_quantization_encode(RFX_CONTEXT* context)
+{
+	BOOL rc = FALSE;
+	INT16* src = alloc_tile(TILE_PIXELS);
+	INT16* generic = alloc_tile(TILE_PIXELS);
+	INT16* optimized = alloc_tile(TILE_PIXELS);
+
+	if (!src || !generic || !optimized)
+		goto fail;
+
+	for (size_t run = 0; run < 16; run++)
+	{
+		UINT32 quant[10] = { 0 };
+		winpr_RAND(quant, sizeof(quant));
+
+		/* Valid quantization values are 6 to 15 */
+		for (size_t x = 0; x < ARRAYSIZE(quant); x++)
+			quant[x] = 6 + quant[x] % 10;
+
+		fill_tile(src);
+		memcpy(generic, src, TILE_PIXELS * sizeof(INT16));
+		memcpy(optimized, src, TILE_PIXELS * sizeof(INT16));
+
+		rfx_quantization_encode(generic, quant);
+		context->quantization_encode(optimized, quant);
+
+		if (!compare_tile("rfx_quantization_encode", generic, optimized))
+			goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	winpr_aligned_free(src);
+	winpr_aligned_free(generic);
+	winpr_aligned_free(optimized);
+	return rc;
+}
+
+static BOOL test_rfx_encode(void)
+{
+	BOOL rc = FALSE;
+	RFX_CONTEXT* context = rfx_context_new(TRUE);
+
+	if (!context)
+		return FALSE;
+
+	if (!test_rfx_dwt_2d_encode(context))
+		goto fail;
+
+	if (!test_rfx_quantization_encode(context))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	rfx_context_free(context);
+	return rc;
+}
+
+static BOOL nsc_compose(NSC_CONTEXT* context, wStream* s, const BYTE* data, UINT32 width,
+                        UINT32 height, UINT32 stride)
+{
+	Stream_SetPosition(s, 0);
+
+	if (!nsc_compose_message(context, s, data, width, height, stride))
+		return FALSE;
+
+	Stream_SealLength(s);
+	return TRUE;
+}
+
+static BOOL test_nsc_encode_format(UINT32 format, UINT32 width, UINT32 height, BOOL subsampling)
+{
+	BOOL rc = FALSE;
+	const UINT32 stride = width * FreeRDPGetBytesPerPixel(format);
+	BYTE* data = calloc(height, stride);
+	wStream* generic = Stream_New(NULL, 4096);
+	wStream* optimized = Stream_New(NULL, 4096);
+	NSC_CONTEXT* context = nsc_context_new();
+
+	if (!data || !generic || !optimized || !context)
+		goto fail;
+
+	if (!nsc_context_set_parameters(context, NSC_COLOR_FORMAT, format) ||
+	    !nsc_context_set_parameters(context, NSC_COLOR_LOSS_LEVEL, 3) ||
+	    !nsc_context_set_parameters(context, NSC_ALLOW_SUBSAMPLING, subsampling ? 1 : 0))
+		goto fail;
+
+	winpr_RAND(data, 1ULL * height * stride);
+
+	if (!nsc_compose(context, optimized, data, width, height, stride))
+		goto fail;
+
+	context->encode = nsc_encode;
+
+	if (!nsc_compose(context, generic, data, width, height, stride))
+		goto fail;
+
+	if ((Stream_Length(generic) != Stream_Length(optimized)) ||
+	    (memcmp(Stream_Buffer(generic), Stream_Buffer(optimized), Stream_Length(generic)) != 0))
+	{
+		(void)fprintf(stderr,
+		              "nsc_encode mismatch for %s %" PRIu32 "x%" PRIu32 " subsampling %d\n",
+		              FreeRDPGetColorFormatName(format), width, height, subsampling);
+		goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	nsc_context_free(context);
+	Stream_Free(generic, TRUE);
+	Stream_Free(optimized, TRUE);
+	free(data);
+	return rc;
+}
+
+static BOOL test_nsc_encode(void)
+{
+	const UINT32 formats[] = { PIXEL_FORMAT_BGRX32, PIXEL_FORMAT_BGRA32, PIXEL_FORMAT_RGBX32,
+		                       PIXEL_FORMAT_RGBA32 };
+	/* Full 64x64 tiles and sizes that leave a tail for the scalar loops */
+	const UINT32 sizes[][2] = { { 64, 64 }, { 61, 37 }, { 7, 3 } };
+
+	for (size_t x = 0; x < ARRAYSIZE(formats); x++)
+	{
+		for (size_t y = 0; y < ARRAYSIZE(sizes); y++)
+		{
+			if (!test_nsc_encode_format(formats[x], sizes[y][0], sizes[y][1], FALSE))
+				return FALSE;
+
+#if defined(NEON_INTRINSICS_ENABLED)
+			/* The SSE2 subsampling rounds its averages, only NEON matches the generic code */
+			if (!test_nsc_encode_format(formats[x], sizes[y][0], sizes[y][1], TRUE))
+				return FALSE;
+#endif
+		}
+	}
+
+	return TRUE;
+}
+
+int TestFreeRDPCodecSimd(int argc, char* argv[])
+{
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!test_rfx_encode())
+		return -1;
+
+	if (!test_nsc_encode())
+		return -1;
+
+	return 0;
+}
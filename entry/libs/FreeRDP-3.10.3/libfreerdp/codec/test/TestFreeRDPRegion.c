@@ -19,6 +19,7 @@
 
 #include <winpr/crt.h>
 #include <winpr/print.h>
+#include <winpr/crypto.h>
 
 #include <freerdp/codec/region.h>
 
@@ -815,6 +816,172 @@ out:
 	return retCode;
 }
 
+/* checks that region covers exactly the pixels in coverage, with strict also that no
+ * rectangles of a band touch */
+static BOOL checkRegionCoverage(const REGION16* region, const BYTE* coverage, UINT16 width,
+                                UINT16 height, BOOL strict)
+{
+	UINT32 nbRects = 0;
+	const RECTANGLE_16* rects = region16_rects(region, &nbRects);
+	BYTE* pixels = calloc(1ull * width * height, sizeof(BYTE));
+	BOOL rc = FALSE;
+
+	if (!pixels)
+		return FALSE;
+
+	for (UINT32 i = 0; i < nbRects; i++)
+	{
+		const RECTANGLE_16* rect = &rects[i];
+		if (rectangle_is_empty(rect) || (rect->right > width) || (rect->bottom > height))
+			goto out;
+
+		if (i > 0)
+		{
+			const RECTANGLE_16* prev = &rects[i - 1];
+			const BOOL sameBand = (prev->top == rect->top);
+			if (sameBand && ((prev->bottom != rect->bottom) || (prev->right > rect->left) ||
+			                 (strict && (prev->right == rect->left))))
+				goto out;
+			if (!sameBand && (prev->bottom > rect->top))
+				goto out;
+		}
+
+		for (UINT16 y = rect->top; y < rect->bottom; y++)
+			memset(&pixels[1ull * y * width + rect->left], 1, rect->right - rect->left);
+	}
+
+	rc = (memcmp(pixels, coverage, 1ull * width * height) == 0);
+out:
+	if (!rc)
+		(void)fprintf(stderr, "%s: region does not match the expected coverage\n", __func__);
+	free(pixels);
+	return rc;
+}
+
+static int test_union_rects_random(void)
+{
+	const UINT16 width = 640;
+	const UINT16 height = 480;
+	int retCode = -1;
+	REGION16 region;
+	REGION16 reference;
+	RECTANGLE_16 rects[200] = { 0 };
+	BYTE* coverage = calloc(1ull * width * height, sizeof(BYTE));
+
+	region16_init(&region);
+	region16_init(&reference);
+
+	if (!coverage)
+		goto out;
+
+	for (int round = 0; round < 20; round++)
+	{
+		UINT32 r[4] = { 0 };
+
+		for (size_t i = 0; i < ARRAYSIZE(rects); i++)
+		{
+			RECTANGLE_16* rect = &rects[i];
+			winpr_RAND(r, sizeof(r));
+			rect->left = r[0] % width;
+			rect->top = r[1] % height;
+			rect->right = MIN(width, rect->left + 1 + r[2] % 96);
+			rect->bottom = MIN(height, rect->top + 1 + r[3] % 96);
+
+			/* half the rounds on the tile grid to exercise the bitmap path */
+			if (round % 2)
+			{
+				rect->left &= ~63;
+				rect->top &= ~63;
+				rect->right = MIN(width, rect->left + 64 * (1 + r[2] % 3));
+				rect->bottom = MIN(height, rect->top + 64 * (1 + r[3] % 3));
+			}
+
+			for (UINT16 y = rect->top; y < rect->bottom; y++)
+				memset(&coverage[1ull * y * width + rect->left], 1, rect->right - rect->left);
+
+			if (!region16_union_rect(&reference, &reference, rect))
+				goto out;
+		}
+
+		/* add the rectangles in two batches to cover a non empty source */
+		if (!region16_union_rects(&region, &region, rects, ARRAYSIZE(rects) / 2) ||
+		    !region16_union_rects(&region, &region, &rects[ARRAYSIZE(rects) / 2],
+		                          ARRAYSIZE(rects) / 2))
+			goto out;
+
+		/* region16_union_rect() may leave touching rectangles in a band */
+		if (!checkRegionCoverage(&region, coverage, width, height, TRUE) ||
+		    !checkRegionCoverage(&reference, coverage, width, height, FALSE))
+			goto out;
+
+		if (!compareRectangles(region16_extents(&region), region16_extents(&reference), 1))
+			goto out;
+
+		region16_clear(&region);
+		region16_clear(&reference);
+		memset(coverage, 0, 1ull * width * height);
+	}
+
+	retCode = 0;
+out:
+	free(coverage);
+	region16_uninit(&region);
+	region16_uninit(&reference);
+	return retCode;
+}
+
+static int test_union_rects_tiles(void)
+{
+	int retCode = -1;
+	REGION16 region;
+	RECTANGLE_16 tiles[3 * 3] = { 0 };
+	const RECTANGLE_16* rects = NULL;
+	UINT32 nbRects = 0;
+	/* a 3x3 tile block clipped by a 150x130 surface and an unaligned rectangle */
+	const RECTANGLE_16 block = { 0, 0, 150, 130 };
+	const RECTANGLE_16 expected[] = { { 0, 0, 150, 128 },
+		                              { 0, 128, 200, 130 },
+		                              { 100, 130, 200, 140 } };
+	const RECTANGLE_16 unaligned = { 100, 128, 200, 140 };
+
+	region16_init(&region);
+
+	for (UINT16 y = 0; y < 3; y++)
+	{
+		for (UINT16 x = 0; x < 3; x++)
+		{
+			RECTANGLE_16* tile = &tiles[y * 3 + x];
+			tile->left = x * 64;
+			tile->top = y * 64;
+			tile->right = MIN(150, tile->left + 64);
+			tile->bottom = MIN(130, tile->top + 64);
+		}
+	}
+
+	if (!region16_union_rects(&region, &region, tiles, ARRAYSIZE(tiles)))
+		goto out;
+
+	rects = region16_rects(&region, &nbRects);
+	if ((nbRects != 1) || !compareRectangles(rects, &block, 1))
+		goto out;
+
+	if (!region16_union_rects(&region, &region, &unaligned, 1))
+		goto out;
+
+	rects = region16_rects(&region, &nbRects);
+	if ((nbRects != ARRAYSIZE(expected)) || !compareRectangles(rects, expected, nbRects))
+		goto out;
+
+	/* adding nothing keeps the region */
+	if (!region16_union_rects(&region, &region, NULL, 0) || (region16_n_rects(&region) != 3))
+		goto out;
+
+	retCode = 0;
+out:
+	region16_uninit(&region);
+	return retCode;
+}
+
 typedef int (*TestFunction)(void);
 struct UnitaryTest
 {
@@ -836,6 +1003,8 @@ static struct UnitaryTest tests[] = { { "Basic trivial tests", test_basic },
 	                                  { "norbert's case", test_norbert_case },
 	                                  { "norbert's case 2", test_norbert2_case },
 	                                  { "empty rectangle case", test_empty_rectangle },
+	                                  { "batch union", test_union_rects_random },
+	                                  { "batch union of tiles", test_union_rects_tiles },
 
 	                                  { NULL, NULL } };
 
@@ -41,6 +41,7 @@
 #include <freerdp/gdi/gdi.h>
 
 #include "../progressive.h"
+#include "../rfx_rlgr.h"
 #include "../mppc.h"
 #include "../xcrush.h"
 #include "../ncrush.h"
@@ -448,6 +449,37 @@ static int TestFreeRDPCodecPlanar(const uint8_t* Data, size_t Size)
 	return 0;
 }
 
+/* The RLGR decoder with the bit reservoir must match the bit by bit reference decoder */
+static int TestFreeRDPCodecRlgr(const uint8_t* Data, size_t Size)
+{
+	INT16 reference[4096] = { 0 };
+	INT16 fast[4096] = { 0 };
+	const RLGR_MODE modes[] = { RLGR1, RLGR3 };
+
+	if (Size < 2)
+		return 0;
+
+	/* the first byte selects the output size, short outputs cut the stream */
+	const UINT32 DstSize = 1 + (Data[0] * 4096u) / 256u;
+	const BYTE* pSrcData = &Data[1];
+	const UINT32 SrcSize = (UINT32)MIN(Size - 1, UINT32_MAX);
+
+	for (size_t x = 0; x < ARRAYSIZE(modes); x++)
+	{
+		const int rc = rfx_rlgr_decode(modes[x], pSrcData, SrcSize, reference, DstSize);
+		const int rcfast = rfx_rlgr_decode_fast(modes[x], pSrcData, SrcSize, fast, DstSize);
+
+		if ((rc != rcfast) || (memcmp(reference, fast, DstSize * sizeof(INT16)) != 0))
+		{
+			WLog_ERR(FREERDP_TAG("codec.rlgr"), "RLGR%d: decoders differ",
+			         (modes[x] == RLGR1) ? 1 : 3);
+			abort();
+		}
+	}
+
+	return 0;
+}
+
 int LLVMFuzzerTestOneInput(const uint8_t* Data, size_t Size)
 {
 	if (Size < 4)
@@ -458,6 +490,7 @@ int LLVMFuzzerTestOneInput(const uint8_t* Data, size_t Size)
 	TestFreeRDPCodecZGfx(Data, Size);
 	TestFreeRDPCodecNCrush(Data, Size);
 	TestFreeRDPCodecRemoteFX(Data, Size);
+	TestFreeRDPCodecRlgr(Data, Size);
 	TestFreeRDPCodecMppc(Data, Size);
 	TestFreeRDPCodecProgressive(Data, Size);
 	TestFreeRDPCodecInterleaved(Data, Size);
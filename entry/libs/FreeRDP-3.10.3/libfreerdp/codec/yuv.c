@@ -57,8 +57,10 @@ struct S_YUV_CONTEXT
 	UINT32 nthreads;
 	UINT32 heightStep;
 
+	/* created on first use unless the context runs on a shared pool */
 	PTP_POOL threadPool;
 	TP_CALLBACK_ENVIRON ThreadPoolEnv;
+	PTP_CALLBACK_ENVIRON CallbackEnvironment;
 
 	UINT32 work_object_count;
 	PTP_WORK* work_objects;
@@ -238,27 +240,43 @@ YUV_CONTEXT* yuv_context_new(BOOL encoder, UINT32 ThreadingFlags)
 		GetNativeSystemInfo(&sysInfos);
 		ret->useThreads = (sysInfos.dwNumberOfProcessors > 1);
 		if (ret->useThreads)
-		{
 			ret->nthreads = sysInfos.dwNumberOfProcessors;
-			ret->threadPool = CreateThreadpool(NULL);
-			if (!ret->threadPool)
-			{
-				goto error_threadpool;
-			}
-
-			InitializeThreadpoolEnvironment(&ret->ThreadPoolEnv);
-			SetThreadpoolCallbackPool(&ret->ThreadPoolEnv, ret->threadPool);
-		}
 	}
 
 	return ret;
+}
 
-error_threadpool:
-	WINPR_PRAGMA_DIAG_PUSH
-	WINPR_PRAGMA_DIAG_IGNORED_MISMATCHED_DEALLOC
-	yuv_context_free(ret);
-	WINPR_PRAGMA_DIAG_POP
-	return NULL;
+BOOL yuv_context_set_callback_environment(YUV_CONTEXT* WINPR_RESTRICT context,
+                                          PTP_CALLBACK_ENVIRON pcbe)
+{
+	if (!context)
+		return FALSE;
+
+	context->CallbackEnvironment = pcbe;
+	return TRUE;
+}
+
+static PTP_CALLBACK_ENVIRON yuv_get_callback_environment(YUV_CONTEXT* WINPR_RESTRICT context)
+{
+	WINPR_ASSERT(context);
+
+	if (context->CallbackEnvironment)
+		return context->CallbackEnvironment;
+
+	if (!context->threadPool)
+	{
+		context->threadPool = CreateThreadpool(NULL);
+		if (!context->threadPool)
+		{
+			WLog_WARN(TAG, "failed to create a thread pool, using the default one");
+			return NULL;
+		}
+
+		InitializeThreadpoolEnvironment(&context->ThreadPoolEnv);
+		SetThreadpoolCallbackPool(&context->ThreadPoolEnv, context->threadPool);
+	}
+
+	return &context->ThreadPoolEnv;
 }
 
 void yuv_context_free(YUV_CONTEXT* context)
@@ -268,8 +286,10 @@ void yuv_context_free(YUV_CONTEXT* context)
 	if (context->useThreads)
 	{
 		if (context->threadPool)
+		{
 			CloseThreadpool(context->threadPool);
-		DestroyThreadpoolEnvironment(&context->ThreadPoolEnv);
+			DestroyThreadpoolEnvironment(&context->ThreadPoolEnv);
+		}
 		winpr_aligned_free((void*)context->work_objects);
 		winpr_aligned_free(context->work_combined_params);
 		winpr_aligned_free(context->work_enc_params);
@@ -325,7 +345,7 @@ static BOOL submit_object(PTP_WORK* WINPR_RESTRICT work_object, PTP_WORK_CALLBAC
 	if (!param || !context)
 		return FALSE;
 
-	*work_object = CreateThreadpoolWork(cb, cnv.pv, &context->ThreadPoolEnv);
+	*work_object = CreateThreadpoolWork(cb, cnv.pv, yuv_get_callback_environment(context));
 	if (!*work_object)
 		return FALSE;
 
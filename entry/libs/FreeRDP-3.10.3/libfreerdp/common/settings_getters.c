@@ -597,6 +597,9 @@ BOOL freerdp_settings_get_bool(const rdpSettings* settings, FreeRDP_Settings_Key
 		case FreeRDP_TlsSecurity:
 			return settings->TlsSecurity;
 
+		case FreeRDP_TlsSessionResumption:
+			return settings->TlsSessionResumption;
+
 		case FreeRDP_ToggleFullscreen:
 			return settings->ToggleFullscreen;
 
@@ -1383,6 +1386,10 @@ BOOL freerdp_settings_set_bool(rdpSettings* settings, FreeRDP_Settings_Keys_Bool
 			settings->TlsSecurity = cnv.c;
 			break;
 
+		case FreeRDP_TlsSessionResumption:
+			settings->TlsSessionResumption = cnv.c;
+			break;
+
 		case FreeRDP_ToggleFullscreen:
 			settings->ToggleFullscreen = cnv.c;
 			break;
@@ -1632,6 +1639,9 @@ UINT32 freerdp_settings_get_uint32(const rdpSettings* settings, FreeRDP_Settings
 		case FreeRDP_AutoReconnectMaxRetries:
 			return settings->AutoReconnectMaxRetries;
 
+		case FreeRDP_BitmapCachePersistMaxSize:
+			return settings->BitmapCachePersistMaxSize;
+
 		case FreeRDP_BitmapCacheV2NumCells:
 			return settings->BitmapCacheV2NumCells;
 
@@ -2037,6 +2047,10 @@ BOOL freerdp_settings_set_uint32(rdpSettings* settings, FreeRDP_Settings_Keys_UI
 			settings->AutoReconnectMaxRetries = cnv.c;
 			break;
 
+		case FreeRDP_BitmapCachePersistMaxSize:
+			settings->BitmapCachePersistMaxSize = cnv.c;
+			break;
+
 		case FreeRDP_BitmapCacheV2NumCells:
 			settings->BitmapCacheV2NumCells = cnv.c;
 			break;
@@ -2965,6 +2979,9 @@ const char* freerdp_settings_get_string(const rdpSettings* settings,
 		case FreeRDP_TlsSecretsFile:
 			return settings->TlsSecretsFile;
 
+		case FreeRDP_TlsSessionCacheFile:
+			return settings->TlsSessionCacheFile;
+
 		case FreeRDP_TransportDumpFile:
 			return settings->TransportDumpFile;
 
@@ -3280,6 +3297,9 @@ char* freerdp_settings_get_string_writable(rdpSettings* settings, FreeRDP_Settin
 		case FreeRDP_TlsSecretsFile:
 			return settings->TlsSecretsFile;
 
+		case FreeRDP_TlsSessionCacheFile:
+			return settings->TlsSessionCacheFile;
+
 		case FreeRDP_TransportDumpFile:
 			return settings->TransportDumpFile;
 
@@ -3605,6 +3625,9 @@ BOOL freerdp_settings_set_string_(rdpSettings* settings, FreeRDP_Settings_Keys_S
 		case FreeRDP_TlsSecretsFile:
 			return update_string_(&settings->TlsSecretsFile, cnv.c, len);
 
+		case FreeRDP_TlsSessionCacheFile:
+			return update_string_(&settings->TlsSessionCacheFile, cnv.c, len);
+
 		case FreeRDP_TransportDumpFile:
 			return update_string_(&settings->TransportDumpFile, cnv.c, len);
 
@@ -3951,6 +3974,9 @@ BOOL freerdp_settings_set_string_copy_(rdpSettings* settings, FreeRDP_Settings_K
 		case FreeRDP_TlsSecretsFile:
 			return update_string_copy_(&settings->TlsSecretsFile, cnv.cc, len, cleanup);
 
+		case FreeRDP_TlsSessionCacheFile:
+			return update_string_copy_(&settings->TlsSessionCacheFile, cnv.cc, len, cleanup);
+
 		case FreeRDP_TransportDumpFile:
 			return update_string_copy_(&settings->TransportDumpFile, cnv.cc, len, cleanup);
 
@@ -3999,6 +4025,9 @@ void* freerdp_settings_get_pointer_writable(rdpSettings* settings, FreeRDP_Setti
 		case FreeRDP_ClientTimeZone:
 			return (void*)settings->ClientTimeZone;
 
+		case FreeRDP_CodecCallbackEnvironment:
+			return settings->CodecCallbackEnvironment;
+
 		case FreeRDP_DeviceArray:
 			return (void*)settings->DeviceArray;
 
@@ -4120,6 +4149,10 @@ BOOL freerdp_settings_set_pointer(rdpSettings* settings, FreeRDP_Settings_Keys_P
 			settings->ClientTimeZone = (TIME_ZONE_INFORMATION*)cnv.v;
 			break;
 
+		case FreeRDP_CodecCallbackEnvironment:
+			settings->CodecCallbackEnvironment = cnv.v;
+			break;
+
 		case FreeRDP_DeviceArray:
 			settings->DeviceArray = (RDPDR_DEVICE**)cnv.v;
 			break;
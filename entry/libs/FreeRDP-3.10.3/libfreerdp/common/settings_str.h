@@ -253,6 +253,7 @@ static const struct settings_str_entry settings_map[] = {
 	  "FreeRDP_SynchronousStaticChannels" },
 	{ FreeRDP_TcpKeepAlive, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_TcpKeepAlive" },
 	{ FreeRDP_TlsSecurity, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_TlsSecurity" },
+	{ FreeRDP_TlsSessionResumption, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_TlsSessionResumption" },
 	{ FreeRDP_ToggleFullscreen, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_ToggleFullscreen" },
 	{ FreeRDP_TransportDump, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_TransportDump" },
 	{ FreeRDP_TransportDumpReplay, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_TransportDumpReplay" },
@@ -291,6 +292,8 @@ static const struct settings_str_entry settings_map[] = {
 	{ FreeRDP_AuthenticationLevel, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_AuthenticationLevel" },
 	{ FreeRDP_AutoReconnectMaxRetries, FREERDP_SETTINGS_TYPE_UINT32,
 	  "FreeRDP_AutoReconnectMaxRetries" },
+	{ FreeRDP_BitmapCachePersistMaxSize, FREERDP_SETTINGS_TYPE_UINT32,
+	  "FreeRDP_BitmapCachePersistMaxSize" },
 	{ FreeRDP_BitmapCacheV2NumCells, FREERDP_SETTINGS_TYPE_UINT32,
 	  "FreeRDP_BitmapCacheV2NumCells" },
 	{ FreeRDP_BitmapCacheV3CodecId, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_BitmapCacheV3CodecId" },
@@ -577,6 +580,7 @@ static const struct settings_str_entry settings_map[] = {
 	{ FreeRDP_TargetNetAddress, FREERDP_SETTINGS_TYPE_STRING, "FreeRDP_TargetNetAddress" },
 	{ FreeRDP_TerminalDescriptor, FREERDP_SETTINGS_TYPE_STRING, "FreeRDP_TerminalDescriptor" },
 	{ FreeRDP_TlsSecretsFile, FREERDP_SETTINGS_TYPE_STRING, "FreeRDP_TlsSecretsFile" },
+	{ FreeRDP_TlsSessionCacheFile, FREERDP_SETTINGS_TYPE_STRING, "FreeRDP_TlsSessionCacheFile" },
 	{ FreeRDP_TransportDumpFile, FREERDP_SETTINGS_TYPE_STRING, "FreeRDP_TransportDumpFile" },
 	{ FreeRDP_UserSpecifiedServerName, FREERDP_SETTINGS_TYPE_STRING,
 	  "FreeRDP_UserSpecifiedServerName" },
@@ -591,6 +595,8 @@ static const struct settings_str_entry settings_map[] = {
 	  "FreeRDP_ClientAutoReconnectCookie" },
 	{ FreeRDP_ClientRandom, FREERDP_SETTINGS_TYPE_POINTER, "FreeRDP_ClientRandom" },
 	{ FreeRDP_ClientTimeZone, FREERDP_SETTINGS_TYPE_POINTER, "FreeRDP_ClientTimeZone" },
+	{ FreeRDP_CodecCallbackEnvironment, FREERDP_SETTINGS_TYPE_POINTER,
+	  "FreeRDP_CodecCallbackEnvironment" },
 	{ FreeRDP_DeviceArray, FREERDP_SETTINGS_TYPE_POINTER, "FreeRDP_DeviceArray" },
 	{ FreeRDP_DynamicChannelArray, FREERDP_SETTINGS_TYPE_POINTER, "FreeRDP_DynamicChannelArray" },
 	{ FreeRDP_FragCache, FREERDP_SETTINGS_TYPE_POINTER, "FreeRDP_FragCache" },
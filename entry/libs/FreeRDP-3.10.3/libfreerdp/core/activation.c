@@ -25,6 +25,7 @@
 
 #include "activation.h"
 #include "display.h"
+#include "../cache/bitmap.h"
 
 #define TAG FREERDP_TAG("core.activation")
 
@@ -273,106 +274,38 @@ static BOOL rdp_write_client_persistent_key_list_pdu(wStream* s,
 	return TRUE;
 }
 
-static UINT16 rdp_load_persistent_key_list(rdpRdp* rdp, UINT64** pKeyList)
-{
-	UINT16 keyCount = 0;
-	UINT64* keyList = NULL;
-	rdpPersistentCache* persistent = NULL;
-	rdpSettings* settings = rdp->settings;
-
-	*pKeyList = NULL;
-
-	if (!freerdp_settings_get_bool(settings, FreeRDP_BitmapCachePersistEnabled))
-		return 0;
-
-	if (!settings->BitmapCachePersistFile)
-		return 0;
-
-	persistent = persistent_cache_new();
-
-	if (!persistent)
-		return 0;
-
-	const int status =
-	    persistent_cache_open(persistent, settings->BitmapCachePersistFile, FALSE, 0);
-
-	if (status < 1)
-		goto error;
-
-	const int count = persistent_cache_get_count(persistent);
-	if ((count < 0) || (count > UINT16_MAX))
-		goto error;
-
-	keyCount = (UINT16)count;
-	keyList = (UINT64*)calloc(keyCount, sizeof(UINT64));
-
-	if (!keyList)
-		goto error;
-
-	for (int index = 0; index < count; index++)
-	{
-		PERSISTENT_CACHE_ENTRY cacheEntry = { 0 };
-
-		if (persistent_cache_read_entry(persistent, &cacheEntry) < 1)
-			continue;
-
-		keyList[index] = cacheEntry.key64;
-	}
-
-	*pKeyList = keyList;
-
-	persistent_cache_free(persistent);
-	return keyCount;
-error:
-	persistent_cache_free(persistent);
-	free(keyList);
-	return 0;
-}
-
 BOOL rdp_send_client_persistent_key_list_pdu(rdpRdp* rdp)
 {
-	UINT32 keyMaxFrag = 2042;
-	UINT64* keyList = NULL;
+	BITMAP_PERSISTENT_KEYS keys = { 0 };
 	RDP_BITMAP_PERSISTENT_INFO info = { 0 };
 	rdpSettings* settings = rdp->settings;
-	UINT32 keyCount = rdp_load_persistent_key_list(rdp, &keyList);
 
-	WLog_DBG(TAG, "Persistent Key List: TotalKeyCount: %" PRIu32 " MaxKeyFrag: %" PRIu32, keyCount,
-	         keyMaxFrag);
+	/* the file of the previous session may still be written */
+	rdp_wait_bitmap_cache_flush(rdp);
 
-	// MS-RDPBCGR recommends sending no more than 169 entries at once.
-	// In practice, sending more than 2042 entries at once triggers an error.
-	// It should be possible to advertise the entire client bitmap cache
+	// The keys are distributed over the cells the same way the bitmap cache fills its slots
+	// from the file. It should be possible to advertise the entire client bitmap cache
 	// by sending multiple persistent key list PDUs, but the current code
 	// only bothers sending a single, smaller list of entries instead.
+	persistent_cache_free(bitmap_cache_persistent_load(settings, &keys));
 
-	if (keyCount > keyMaxFrag)
-		keyCount = keyMaxFrag;
+	WLog_DBG(TAG, "Persistent Key List: TotalKeyCount: %" PRIu32 " MaxKeyFrag: %" PRIu32,
+	         keys.total, BITMAP_CACHE_PERSISTENT_MAX_KEYS);
 
-	WINPR_ASSERT(settings->BitmapCacheV2CellInfo[0].numEntries <= UINT16_MAX);
-	info.totalEntriesCache0 = (UINT16)settings->BitmapCacheV2CellInfo[0].numEntries;
+	WINPR_ASSERT(keys.count[0] <= UINT16_MAX);
+	info.numEntriesCache0 = (UINT16)keys.count[0];
 
-	WINPR_ASSERT(settings->BitmapCacheV2CellInfo[1].numEntries <= UINT16_MAX);
-	info.totalEntriesCache1 = (UINT16)settings->BitmapCacheV2CellInfo[1].numEntries;
+	WINPR_ASSERT(keys.count[1] <= UINT16_MAX);
+	info.numEntriesCache1 = (UINT16)keys.count[1];
 
-	WINPR_ASSERT(settings->BitmapCacheV2CellInfo[2].numEntries <= UINT16_MAX);
-	info.totalEntriesCache2 = (UINT16)settings->BitmapCacheV2CellInfo[2].numEntries;
+	WINPR_ASSERT(keys.count[2] <= UINT16_MAX);
+	info.numEntriesCache2 = (UINT16)keys.count[2];
 
-	WINPR_ASSERT(settings->BitmapCacheV2CellInfo[3].numEntries <= UINT16_MAX);
-	info.totalEntriesCache3 = (UINT16)settings->BitmapCacheV2CellInfo[3].numEntries;
+	WINPR_ASSERT(keys.count[3] <= UINT16_MAX);
+	info.numEntriesCache3 = (UINT16)keys.count[3];
 
-	WINPR_ASSERT(settings->BitmapCacheV2CellInfo[4].numEntries <= UINT16_MAX);
-	info.totalEntriesCache4 = (UINT16)settings->BitmapCacheV2CellInfo[4].numEntries;
-
-	info.numEntriesCache0 = MIN(keyCount, info.totalEntriesCache0);
-	keyCount -= info.numEntriesCache0;
-	info.numEntriesCache1 = MIN(keyCount, info.totalEntriesCache1);
-	keyCount -= info.numEntriesCache1;
-	info.numEntriesCache2 = MIN(keyCount, info.totalEntriesCache2);
-	keyCount -= info.numEntriesCache2;
-	info.numEntriesCache3 = MIN(keyCount, info.totalEntriesCache3);
-	keyCount -= info.numEntriesCache3;
-	info.numEntriesCache4 = MIN(keyCount, info.totalEntriesCache4);
+	WINPR_ASSERT(keys.count[4] <= UINT16_MAX);
+	info.numEntriesCache4 = (UINT16)keys.count[4];
 
 	info.totalEntriesCache0 = info.numEntriesCache0;
 	info.totalEntriesCache1 = info.numEntriesCache1;
@@ -380,11 +313,8 @@ BOOL rdp_send_client_persistent_key_list_pdu(rdpRdp* rdp)
 	info.totalEntriesCache3 = info.numEntriesCache3;
 	info.totalEntriesCache4 = info.numEntriesCache4;
 
-	keyCount = info.totalEntriesCache0 + info.totalEntriesCache1 + info.totalEntriesCache2 +
-	           info.totalEntriesCache3 + info.totalEntriesCache4;
-
-	info.keyCount = keyCount;
-	info.keyList = keyList;
+	info.keyCount = keys.total;
+	info.keyList = keys.keys;
 
 	WLog_DBG(TAG, "persistentKeyList count: %" PRIu32, info.keyCount);
 
@@ -404,19 +334,19 @@ BOOL rdp_send_client_persistent_key_list_pdu(rdpRdp* rdp)
 
 	if (!s)
 	{
-		free(keyList);
+		bitmap_cache_persistent_keys_free(&keys);
 		return FALSE;
 	}
 
 	if (!rdp_write_client_persistent_key_list_pdu(s, &info))
 	{
 		Stream_Free(s, TRUE);
-		free(keyList);
+		bitmap_cache_persistent_keys_free(&keys);
 		return FALSE;
 	}
 
 	WINPR_ASSERT(rdp->mcs);
-	free(keyList);
+	bitmap_cache_persistent_keys_free(&keys);
 
 	return rdp_send_data_pdu(rdp, s, DATA_PDU_TYPE_BITMAP_CACHE_PERSISTENT_LIST, rdp->mcs->userId);
 }
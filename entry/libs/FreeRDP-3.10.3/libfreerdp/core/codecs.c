@@ -133,6 +133,9 @@ BOOL freerdp_client_codecs_prepare(rdpCodecs* codecs, UINT32 flags, UINT32 width
 			WLog_ERR(TAG, "Failed to create rfx codec context");
 			return FALSE;
 		}
+
+		if (codecs->CallbackEnvironment)
+			rfx_context_set_callback_environment(codecs->rfx, codecs->CallbackEnvironment);
 	}
 
 	if ((flags & FREERDP_CODEC_CLEARCODEC))
@@ -155,6 +158,10 @@ BOOL freerdp_client_codecs_prepare(rdpCodecs* codecs, UINT32 flags, UINT32 width
 			WLog_ERR(TAG, "Failed to create progressive codec context");
 			return FALSE;
 		}
+
+		if (codecs->CallbackEnvironment)
+			progressive_context_set_callback_environment(codecs->progressive,
+			                                             codecs->CallbackEnvironment);
 	}
 
 #ifdef WITH_GFX_H264
@@ -164,6 +171,8 @@ BOOL freerdp_client_codecs_prepare(rdpCodecs* codecs, UINT32 flags, UINT32 width
 		{
 			WLog_WARN(TAG, "Failed to create h264 codec context");
 		}
+		else if (codecs->CallbackEnvironment)
+			h264_context_set_callback_environment(codecs->h264, codecs->CallbackEnvironment);
 	}
 #endif
 
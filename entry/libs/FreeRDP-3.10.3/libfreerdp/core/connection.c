@@ -36,6 +36,7 @@
 #include <winpr/crt.h>
 #include <winpr/crypto.h>
 #include <winpr/ssl.h>
+#include <winpr/sysinfo.h>
 
 #include <freerdp/log.h>
 #include <freerdp/error.h>
@@ -214,6 +215,9 @@ static BOOL rdp_client_reset_codecs(rdpContext* context)
 		if (!context->codecs)
 			return FALSE;
 
+		context->codecs->CallbackEnvironment =
+		    freerdp_settings_get_pointer_writable(settings, FreeRDP_CodecCallbackEnvironment);
+
 		if (!freerdp_client_codecs_prepare(context->codecs,
 		                                   freerdp_settings_get_codecs_flags(settings),
 		                                   settings->DesktopWidth, settings->DesktopHeight))
@@ -315,6 +319,11 @@ BOOL rdp_client_connect(rdpRdp* rdp)
 	if (!rdp_client_reset_codecs(rdp->context))
 		return FALSE;
 
+	rdp->connectStartNs = winpr_GetTickCount64NS();
+	ZeroMemory(rdp->connectStateNs, sizeof(rdp->connectStateNs));
+	ZeroMemory(&rdp->connectTimings, sizeof(rdp->connectTimings));
+	rdp->connectTimingsDone = FALSE;
+
 	if (settings->FIPSMode)
 		flags |= WINPR_SSL_INIT_ENABLE_FIPS;
 
@@ -1378,6 +1387,50 @@ state_run_t rdp_client_connect_finalize(rdpRdp* rdp)
 	return STATE_RUN_SUCCESS;
 }
 
+static UINT64 rdp_connect_state_delta(const rdpRdp* rdp, CONNECTION_STATE from,
+                                      CONNECTION_STATE to)
+{
+	const UINT64 start = rdp->connectStateNs[from];
+	const UINT64 end = rdp->connectStateNs[to];
+
+	if ((start == 0) || (end < start))
+		return 0;
+	return end - start;
+}
+
+static void rdp_client_update_connect_timings(rdpRdp* rdp, CONNECTION_STATE state)
+{
+	WINPR_ASSERT(rdp);
+
+	if (rdp->connectTimingsDone || (rdp->connectStartNs == 0) || (state > CONNECTION_STATE_ACTIVE))
+		return;
+
+	/* Only the first entry counts, deactivation-reactivation repeats some of the states */
+	if (rdp->connectStateNs[state] == 0)
+		rdp->connectStateNs[state] = winpr_GetTickCount64NS();
+
+	if (state != CONNECTION_STATE_ACTIVE)
+		return;
+
+	rdpConnectTimings* timings = &rdp->connectTimings;
+	timings->nlaNs =
+	    rdp_connect_state_delta(rdp, CONNECTION_STATE_NLA, CONNECTION_STATE_MCS_CREATE_REQUEST);
+	timings->licensingNs = rdp_connect_state_delta(
+	    rdp, CONNECTION_STATE_LICENSING, CONNECTION_STATE_CAPABILITIES_EXCHANGE_DEMAND_ACTIVE);
+	timings->capabilitiesNs = rdp_connect_state_delta(
+	    rdp, CONNECTION_STATE_CAPABILITIES_EXCHANGE_DEMAND_ACTIVE, CONNECTION_STATE_ACTIVE);
+	timings->totalNs = rdp->connectStateNs[CONNECTION_STATE_ACTIVE] - rdp->connectStartNs;
+	rdp->connectTimingsDone = TRUE;
+
+	WLog_Print(rdp->log, WLOG_INFO,
+	           "connected in %" PRIu64 "ms [tcp %" PRIu64 "ms, tls %" PRIu64 "ms%s, nla %" PRIu64
+	           "ms, licensing %" PRIu64 "ms, capabilities %" PRIu64 "ms]",
+	           timings->totalNs / 1000000ull, timings->tcpNs / 1000000ull,
+	           timings->tlsNs / 1000000ull, timings->tlsResumed ? " resumed" : "",
+	           timings->nlaNs / 1000000ull, timings->licensingNs / 1000000ull,
+	           timings->capabilitiesNs / 1000000ull);
+}
+
 BOOL rdp_client_transition_to_state(rdpRdp* rdp, CONNECTION_STATE state)
 {
 	const char* name = rdp_state_string(state);
@@ -1388,6 +1441,8 @@ BOOL rdp_client_transition_to_state(rdpRdp* rdp, CONNECTION_STATE state)
 	if (!rdp_set_state(rdp, state))
 		return FALSE;
 
+	rdp_client_update_connect_timings(rdp, state);
+
 	switch (state)
 	{
 		case CONNECTION_STATE_FINALIZATION_SYNC:
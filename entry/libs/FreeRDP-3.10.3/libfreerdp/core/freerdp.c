@@ -1366,6 +1366,41 @@ const char* freerdp_state_string(CONNECTION_STATE state)
 	return rdp_state_string(state);
 }
 
+BOOL freerdp_get_connect_timings(const rdpContext* context, rdpConnectTimings* timings)
+{
+	WINPR_ASSERT(context);
+	WINPR_ASSERT(timings);
+
+	const rdpRdp* rdp = context->rdp;
+	if (!rdp || !rdp->connectTimingsDone)
+		return FALSE;
+
+	*timings = rdp->connectTimings;
+	return TRUE;
+}
+
+BOOL freerdp_get_bitmap_cache_stats(const rdpContext* context, rdpBitmapCacheStats* stats)
+{
+	WINPR_ASSERT(context);
+	WINPR_ASSERT(stats);
+
+	rdpRdp* rdp = context->rdp;
+	if (!rdp)
+		return FALSE;
+
+	/* the flush thread owns the saved counters until it clears flushPending */
+	EnterCriticalSection(&rdp->bitmapCacheStatsLock);
+	*stats = rdp->bitmapCacheStats;
+	LeaveCriticalSection(&rdp->bitmapCacheStatsLock);
+
+	if (stats->flushPending)
+	{
+		stats->savedEntries = 0;
+		stats->savedBytes = 0;
+	}
+	return TRUE;
+}
+
 BOOL freerdp_is_active_state(const rdpContext* context)
 {
 	WINPR_ASSERT(context);
@@ -1609,30 +1609,19 @@ static int rdg_write_websocket_data_packet(rdpRdg* rdg, const BYTE* buf, int isi
 		return -1;
 
 	const size_t payloadSize = (size_t)isize + 10;
-	union
-	{
-		UINT32 u32;
-		UINT8 u8[4];
-	} maskingKey;
-
-	wStream* sWS =
-	    websocket_context_packet_new(payloadSize, WebsocketBinaryOpcode, &maskingKey.u32);
-	if (!sWS)
-		return FALSE;
-
-	Stream_Write_UINT16(sWS, PKT_TYPE_DATA ^ (maskingKey.u8[0] | maskingKey.u8[1] << 8)); /* Type */
-	Stream_Write_UINT16(sWS, 0 ^ (maskingKey.u8[2] | maskingKey.u8[3] << 8)); /* Reserved */
-	Stream_Write_UINT32(sWS, (UINT32)payloadSize ^ maskingKey.u32);           /* Packet length */
-	Stream_Write_UINT16(sWS,
-	                    (UINT16)isize ^ (maskingKey.u8[0] | maskingKey.u8[1] << 8)); /* Data size */
+	BYTE header[10] = { 0 };
+	wStream sbuffer = { 0 };
+	wStream* s = Stream_StaticInit(&sbuffer, header, sizeof(header));
 
-	/* masking key is now off by 2 bytes. fix that */
-	maskingKey.u32 = (maskingKey.u32 & 0xffff) << 16 | (maskingKey.u32 >> 16);
+	Stream_Write_UINT16(s, PKT_TYPE_DATA);       /* Type */
+	Stream_Write_UINT16(s, 0);                   /* Reserved */
+	Stream_Write_UINT32(s, (UINT32)payloadSize); /* Packet length */
+	Stream_Write_UINT16(s, (UINT16)isize);       /* Data size */
 
 	WINPR_ASSERT(rdg->tlsOut);
-	wStream sPacket = { 0 };
-	Stream_StaticConstInit(&sPacket, buf, (size_t)isize);
-	if (!websocket_context_mask_and_send(rdg->tlsOut->bio, sWS, &sPacket, maskingKey.u32))
+	if (!websocket_context_write_parts(rdg->transferEncoding.context.websocket, rdg->tlsOut->bio,
+	                                   header, sizeof(header), buf, (size_t)isize,
+	                                   WebsocketBinaryOpcode))
 		return -1;
 
 	return isize;
@@ -17,12 +17,28 @@
  * limitations under the License.
  */
 
+#include <winpr/sysinfo.h>
+
 #include "websocket.h"
 #include <freerdp/log.h>
 #include "../tcp.h"
+#include "../simd.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <emmintrin.h>
+#elif defined(NEON_INTRINSICS_ENABLED)
+#include <arm_neon.h>
+#endif
 
 #define TAG FREERDP_TAG("core.gateway.websocket")
 
+/* 2 byte "mini header" + 8 byte length + 4 byte masking key */
+#define WEBSOCKET_MAX_HEADER_LENGTH 14
+
+/* Initial size of the send buffer, it is shrunk back once a frame grew it past the limit */
+#define WEBSOCKET_SEND_BUFFER_SIZE 4096
+#define WEBSOCKET_SEND_BUFFER_LIMIT (64 * 1024)
+
 struct s_websocket_context
 {
 	size_t payloadLength;
@@ -34,87 +50,160 @@ struct s_websocket_context
 	BYTE lengthAndMaskPosition;
 	WEBSOCKET_STATE state;
 	wStream* responseStreamBuffer;
+
+	/* Outgoing frames are built here, the lock keeps replies from the read path apart */
+	CRITICAL_SECTION sendLock;
+	BOOL lockInitialized;
+	wStream* sendBuffer;
+	BOOL simd;
 };
 
 static int websocket_write_all(BIO* bio, const BYTE* data, size_t length);
 
-BOOL websocket_context_mask_and_send(BIO* bio, wStream* sPacket, wStream* sDataPacket,
-                                     UINT32 maskingKey)
+/* XOR \b length bytes with the masking key, \b offset is the position in the frame payload */
+static void websocket_mask(BOOL simd, BYTE* WINPR_RESTRICT dst, const BYTE* WINPR_RESTRICT src,
+                           size_t length, UINT32 maskingKey, size_t offset)
 {
-	const size_t len = Stream_Length(sDataPacket);
-	Stream_SetPosition(sDataPacket, 0);
+	const BYTE* key = (const BYTE*)&maskingKey;
+	BYTE rotated[4] = { 0 };
+	UINT32 mask = 0;
+	size_t x = 0;
 
-	if (!Stream_EnsureRemainingCapacity(sPacket, len))
-		return FALSE;
+	for (size_t y = 0; y < 4; y++)
+		rotated[y] = key[(offset + y) % 4];
+	memcpy(&mask, rotated, sizeof(mask));
 
-	/* mask as much as possible with 32bit access */
-	size_t streamPos = 0;
-	for (; streamPos + 4 <= len; streamPos += 4)
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	if (simd)
 	{
-		const uint32_t data = Stream_Get_UINT32(sDataPacket);
-		Stream_Write_UINT32(sPacket, data ^ maskingKey);
+		const __m128i m = _mm_set1_epi32((int)mask);
+		for (; x + 64 <= length; x += 64)
+		{
+			const __m128i a = _mm_loadu_si128((const __m128i*)&src[x]);
+			const __m128i b = _mm_loadu_si128((const __m128i*)&src[x + 16]);
+			const __m128i c = _mm_loadu_si128((const __m128i*)&src[x + 32]);
+			const __m128i d = _mm_loadu_si128((const __m128i*)&src[x + 48]);
+			_mm_storeu_si128((__m128i*)&dst[x], _mm_xor_si128(a, m));
+			_mm_storeu_si128((__m128i*)&dst[x + 16], _mm_xor_si128(b, m));
+			_mm_storeu_si128((__m128i*)&dst[x + 32], _mm_xor_si128(c, m));
+			_mm_storeu_si128((__m128i*)&dst[x + 48], _mm_xor_si128(d, m));
+		}
+		for (; x + 16 <= length; x += 16)
+		{
+			const __m128i a = _mm_loadu_si128((const __m128i*)&src[x]);
+			_mm_storeu_si128((__m128i*)&dst[x], _mm_xor_si128(a, m));
+		}
 	}
-
-	/* mask the rest byte by byte */
-	for (; streamPos < len; streamPos++)
+#elif defined(NEON_INTRINSICS_ENABLED)
+	if (simd)
 	{
-		BYTE data = 0;
-		BYTE* partialMask = ((BYTE*)&maskingKey) + (streamPos % 4);
-		Stream_Read_UINT8(sDataPacket, data);
-		Stream_Write_UINT8(sPacket, data ^ *partialMask);
+		const uint8x16_t m = vreinterpretq_u8_u32(vdupq_n_u32(mask));
+		for (; x + 64 <= length; x += 64)
+		{
+			const uint8x16_t a = vld1q_u8(&src[x]);
+			const uint8x16_t b = vld1q_u8(&src[x + 16]);
+			const uint8x16_t c = vld1q_u8(&src[x + 32]);
+			const uint8x16_t d = vld1q_u8(&src[x + 48]);
+			vst1q_u8(&dst[x], veorq_u8(a, m));
+			vst1q_u8(&dst[x + 16], veorq_u8(b, m));
+			vst1q_u8(&dst[x + 32], veorq_u8(c, m));
+			vst1q_u8(&dst[x + 48], veorq_u8(d, m));
+		}
+		for (; x + 16 <= length; x += 16)
+			vst1q_u8(&dst[x], veorq_u8(vld1q_u8(&src[x]), m));
 	}
+#else
+	WINPR_UNUSED(simd);
+#endif
 
-	Stream_SealLength(sPacket);
-
-	ERR_clear_error();
-	const size_t size = Stream_Length(sPacket);
-	const int status = websocket_write_all(bio, Stream_Buffer(sPacket), size);
-	Stream_Free(sPacket, TRUE);
-
-	if ((status < 0) || ((size_t)status != size))
-		return FALSE;
+	/* The vector steps are multiples of 4, the mask is still aligned with x */
+	const UINT64 mask64 = ((UINT64)mask << 32) | mask;
+	for (; x + 8 <= length; x += 8)
+	{
+		UINT64 data = 0;
+		memcpy(&data, &src[x], sizeof(data));
+		data ^= mask64;
+		memcpy(&dst[x], &data, sizeof(data));
+	}
 
-	return TRUE;
+	for (; x < length; x++)
+		dst[x] = src[x] ^ rotated[x % 4];
 }
 
-wStream* websocket_context_packet_new(size_t len, WEBSOCKET_OPCODE opcode, UINT32* pMaskingKey)
+static BOOL websocket_write_header(wStream* s, size_t len, WEBSOCKET_OPCODE opcode,
+                                   UINT32 maskingKey)
 {
-	WINPR_ASSERT(pMaskingKey);
-	if (len > INT_MAX)
-		return NULL;
+	if (!Stream_EnsureRemainingCapacity(s, WEBSOCKET_MAX_HEADER_LENGTH))
+		return FALSE;
 
-	size_t fullLen = 0;
+	Stream_Write_UINT8(s, (UINT8)(WEBSOCKET_FIN_BIT | opcode));
 	if (len < 126)
-		fullLen = len + 6; /* 2 byte "mini header" + 4 byte masking key */
+		Stream_Write_UINT8(s, (UINT8)len | WEBSOCKET_MASK_BIT);
 	else if (len < 0x10000)
-		fullLen = len + 8; /* 2 byte "mini header" + 2 byte length + 4 byte masking key */
+	{
+		Stream_Write_UINT8(s, 126 | WEBSOCKET_MASK_BIT);
+		Stream_Write_UINT16_BE(s, (UINT16)len);
+	}
 	else
-		fullLen = len + 14; /* 2 byte "mini header" + 8 byte length + 4 byte masking key */
+	{
+		Stream_Write_UINT8(s, 127 | WEBSOCKET_MASK_BIT);
+		Stream_Write_UINT32_BE(s, 0); /* payload is limited to INT_MAX */
+		Stream_Write_UINT32_BE(s, (UINT32)len);
+	}
+	Stream_Write_UINT32(s, maskingKey);
+	return TRUE;
+}
 
-	wStream* sWS = Stream_New(NULL, fullLen);
-	if (!sWS)
-		return NULL;
+BOOL websocket_context_write_parts(websocket_context* context, BIO* bio, const BYTE* header,
+                                   size_t headerLength, const BYTE* data, size_t length,
+                                   WEBSOCKET_OPCODE opcode)
+{
+	WINPR_ASSERT(context);
+	WINPR_ASSERT(bio);
+	WINPR_ASSERT(header || (headerLength == 0));
+	WINPR_ASSERT(data || (length == 0));
+
+	const size_t len = headerLength + length;
+	if ((len < length) || (len > INT_MAX))
+		return FALSE;
 
 	UINT32 maskingKey = 0;
 	winpr_RAND(&maskingKey, sizeof(maskingKey));
 
-	Stream_Write_UINT8(sWS, (UINT8)(WEBSOCKET_FIN_BIT | opcode));
-	if (len < 126)
-		Stream_Write_UINT8(sWS, (UINT8)len | WEBSOCKET_MASK_BIT);
-	else if (len < 0x10000)
-	{
-		Stream_Write_UINT8(sWS, 126 | WEBSOCKET_MASK_BIT);
-		Stream_Write_UINT16_BE(sWS, (UINT16)len);
-	}
-	else
+	BOOL rc = FALSE;
+	EnterCriticalSection(&context->sendLock);
+
+	/* Header, masking key and payload go out with a single write */
+	wStream* s = context->sendBuffer;
+	Stream_SetPosition(s, 0);
+	if (!websocket_write_header(s, len, opcode, maskingKey) ||
+	    !Stream_EnsureRemainingCapacity(s, len))
+		goto fail;
+
+	BYTE* dst = Stream_Pointer(s);
+	websocket_mask(context->simd, dst, header, headerLength, maskingKey, 0);
+	websocket_mask(context->simd, &dst[headerLength], data, length, maskingKey, headerLength);
+	Stream_Seek(s, len);
+
+	ERR_clear_error();
+	const size_t size = Stream_GetPosition(s);
+	const int status = websocket_write_all(bio, Stream_Buffer(s), size);
+	rc = (status >= 0) && ((size_t)status == size);
+
+fail:
+	/* Do not keep the memory of a single large frame for the rest of the session */
+	if (Stream_Capacity(s) > WEBSOCKET_SEND_BUFFER_LIMIT)
 	{
-		Stream_Write_UINT8(sWS, 127 | WEBSOCKET_MASK_BIT);
-		Stream_Write_UINT32_BE(sWS, 0); /* payload is limited to INT_MAX */
-		Stream_Write_UINT32_BE(sWS, (UINT32)len);
+		wStream* small = Stream_New(NULL, WEBSOCKET_SEND_BUFFER_SIZE);
+		if (small)
+		{
+			Stream_Free(s, TRUE);
+			context->sendBuffer = small;
+		}
 	}
-	Stream_Write_UINT32(sWS, maskingKey);
-	*pMaskingKey = maskingKey;
-	return sWS;
+
+	LeaveCriticalSection(&context->sendLock);
+	return rc;
 }
 
 BOOL websocket_context_write_wstream(websocket_context* context, BIO* bio, wStream* sPacket,
@@ -129,15 +218,13 @@ BOOL websocket_context_write_wstream(websocket_context* context, BIO* bio, wStre
 		context->closeSent = TRUE;
 
 	WINPR_ASSERT(bio);
-	WINPR_ASSERT(sPacket);
 
-	const size_t len = Stream_Length(sPacket);
-	uint32_t maskingKey = 0;
-	wStream* sWS = websocket_context_packet_new(len, opcode, &maskingKey);
-	if (!sWS)
-		return FALSE;
+	/* A close frame without a status code has no payload */
+	if (!sPacket)
+		return websocket_context_write_parts(context, bio, NULL, 0, NULL, 0, opcode);
 
-	return websocket_context_mask_and_send(bio, sWS, sPacket, maskingKey);
+	return websocket_context_write_parts(context, bio, NULL, 0, Stream_Buffer(sPacket),
+	                                     Stream_Length(sPacket), opcode);
 }
 
 int websocket_write_all(BIO* bio, const BYTE* data, size_t length)
@@ -264,6 +351,9 @@ static BOOL websocket_reply_close(BIO* bio, websocket_context* context, wStream*
 {
 	WINPR_ASSERT(bio);
 
+	/* Echo what was received, not the whole response buffer */
+	if (s)
+		Stream_SealLength(s);
 	return websocket_context_write_wstream(context, bio, s, WebsocketCloseOpcode);
 }
 
@@ -273,7 +363,10 @@ static BOOL websocket_reply_pong(BIO* bio, websocket_context* context, wStream*
 	WINPR_ASSERT(s);
 
 	if (Stream_GetPosition(s) != 0)
+	{
+		Stream_SealLength(s);
 		return websocket_context_write_wstream(context, bio, s, WebsocketPongOpcode);
+	}
 
 	return websocket_reply_close(bio, context, NULL);
 }
@@ -351,6 +444,26 @@ static int websocket_handle_payload(BIO* bio, BYTE* pBuffer, size_t size,
 	return 0;
 }
 
+static void websocket_parse_length_and_mask(websocket_context* encodingContext, BYTE value)
+{
+	WINPR_ASSERT(encodingContext);
+
+	encodingContext->masking = ((value & WEBSOCKET_MASK_BIT) == WEBSOCKET_MASK_BIT);
+	encodingContext->lengthAndMaskPosition = 0;
+	encodingContext->payloadLength = 0;
+	const BYTE len = value & 0x7f;
+	if (len < 126)
+	{
+		encodingContext->payloadLength = len;
+		encodingContext->state =
+		    (encodingContext->masking ? WebSocketStateMaskingKey : WebSocketStatePayload);
+	}
+	else if (len == 126)
+		encodingContext->state = WebsocketStateShortLength;
+	else
+		encodingContext->state = WebsocketStateLongLength;
+}
+
 int websocket_context_read(websocket_context* encodingContext, BIO* bio, BYTE* pBuffer, size_t size)
 {
 	int status = 0;
@@ -366,7 +479,8 @@ int websocket_context_read(websocket_context* encodingContext, BIO* bio, BYTE* p
 		{
 			case WebsocketStateOpcodeAndFin:
 			{
-				BYTE buffer[1] = { 0 };
+				/* Both header bytes are always present, fetch them with one read */
+				BYTE buffer[2] = { 0 };
 
 				ERR_clear_error();
 				status = BIO_read(bio, (char*)buffer, sizeof(buffer));
@@ -378,6 +492,9 @@ int websocket_context_read(websocket_context* encodingContext, BIO* bio, BYTE* p
 				    (encodingContext->opcode & 0xf) < 0x08)
 					encodingContext->fragmentOriginalOpcode = encodingContext->opcode;
 				encodingContext->state = WebsocketStateLengthAndMasking;
+
+				if (status > 1)
+					websocket_parse_length_and_mask(encodingContext, buffer[1]);
 			}
 			break;
 			case WebsocketStateLengthAndMasking:
@@ -389,38 +506,28 @@ int websocket_context_read(websocket_context* encodingContext, BIO* bio, BYTE* p
 				if (status <= 0)
 					return (effectiveDataLen > 0 ? effectiveDataLen : status);
 
-				encodingContext->masking = ((buffer[0] & WEBSOCKET_MASK_BIT) == WEBSOCKET_MASK_BIT);
-				encodingContext->lengthAndMaskPosition = 0;
-				encodingContext->payloadLength = 0;
-				const BYTE len = buffer[0] & 0x7f;
-				if (len < 126)
-				{
-					encodingContext->payloadLength = len;
-					encodingContext->state = (encodingContext->masking ? WebSocketStateMaskingKey
-					                                                   : WebSocketStatePayload);
-				}
-				else if (len == 126)
-					encodingContext->state = WebsocketStateShortLength;
-				else
-					encodingContext->state = WebsocketStateLongLength;
+				websocket_parse_length_and_mask(encodingContext, buffer[0]);
 			}
 			break;
 			case WebsocketStateShortLength:
 			case WebsocketStateLongLength:
 			{
-				BYTE buffer[1] = { 0 };
+				BYTE buffer[8] = { 0 };
 				const BYTE lenLength =
 				    (encodingContext->state == WebsocketStateShortLength ? 2 : 8);
 				while (encodingContext->lengthAndMaskPosition < lenLength)
 				{
+					const BYTE missing = lenLength - encodingContext->lengthAndMaskPosition;
+
 					ERR_clear_error();
-					status = BIO_read(bio, (char*)buffer, sizeof(buffer));
+					status = BIO_read(bio, (char*)buffer, missing);
 					if (status <= 0)
 						return (effectiveDataLen > 0 ? effectiveDataLen : status);
 
-					encodingContext->payloadLength =
-					    (encodingContext->payloadLength) << 8 | buffer[0];
-					encodingContext->lengthAndMaskPosition += status;
+					for (int x = 0; x < status; x++)
+						encodingContext->payloadLength =
+						    (encodingContext->payloadLength) << 8 | buffer[x];
+					encodingContext->lengthAndMaskPosition += (BYTE)status;
 				}
 				encodingContext->state =
 				    (encodingContext->masking ? WebSocketStateMaskingKey : WebSocketStatePayload);
@@ -463,6 +570,20 @@ websocket_context* websocket_context_new(void)
 	if (!context->responseStreamBuffer)
 		goto fail;
 
+	context->sendBuffer = Stream_New(NULL, WEBSOCKET_SEND_BUFFER_SIZE);
+	if (!context->sendBuffer)
+		goto fail;
+
+	if (!InitializeCriticalSectionAndSpinCount(&context->sendLock, 4000))
+		goto fail;
+	context->lockInitialized = TRUE;
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	context->simd = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+#elif defined(NEON_INTRINSICS_ENABLED)
+	context->simd = TRUE;
+#endif
+
 	if (!websocket_context_reset(context))
 		goto fail;
 
@@ -477,6 +598,9 @@ void websocket_context_free(websocket_context* context)
 	if (!context)
 		return;
 
+	if (context->lockInitialized)
+		DeleteCriticalSection(&context->sendLock);
+	Stream_Free(context->sendBuffer, TRUE);
 	Stream_Free(context->responseStreamBuffer, TRUE);
 	free(context);
 }
@@ -66,11 +66,14 @@ FREERDP_LOCAL int websocket_context_write(websocket_context* context, BIO* bio,
 FREERDP_LOCAL int websocket_context_read(websocket_context* encodingContext, BIO* bio,
                                          BYTE* pBuffer, size_t size);
 
-WINPR_ATTR_MALLOC(Stream_Free, 1)
-FREERDP_LOCAL wStream* websocket_context_packet_new(size_t len, WEBSOCKET_OPCODE opcode,
-                                                    UINT32* pMaskingKey);
-
-FREERDP_LOCAL BOOL websocket_context_mask_and_send(BIO* bio, wStream* sPacket, wStream* sDataPacket,
-                                                   UINT32 maskingKey);
+/** @brief Send \b header followed by \b data as one masked frame
+ *
+ *  The frame is assembled and masked in a buffer owned by \b context, so neither input is
+ *  modified and nothing is allocated per frame.
+ */
+FREERDP_LOCAL BOOL websocket_context_write_parts(websocket_context* context, BIO* bio,
+                                                 const BYTE* header, size_t headerLength,
+                                                 const BYTE* data, size_t length,
+                                                 WEBSOCKET_OPCODE opcode);
 
 #endif /* FREERDP_LIB_CORE_GATEWAY_WEBSOCKET_H */
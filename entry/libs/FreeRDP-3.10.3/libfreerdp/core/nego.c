@@ -25,6 +25,7 @@
 #include <winpr/crt.h>
 #include <winpr/assert.h>
 #include <winpr/stream.h>
+#include <winpr/sysinfo.h>
 
 #include <freerdp/log.h>
 
@@ -34,6 +35,7 @@
 #include "aad.h"
 
 #include "transport.h"
+#include "rdp.h"
 
 #define TAG FREERDP_TAG("core.nego")
 
@@ -358,6 +360,7 @@ static BOOL nego_tcp_connect(rdpNego* nego)
 
 		TcpConnectTimeout =
 		    freerdp_settings_get_uint32(context->settings, FreeRDP_TcpConnectTimeout);
+		const UINT64 start = winpr_GetTickCount64NS();
 
 		if (nego->GatewayEnabled)
 		{
@@ -388,6 +391,9 @@ static BOOL nego_tcp_connect(rdpNego* nego)
 			nego->TcpConnected =
 			    transport_connect(nego->transport, nego->hostname, nego->port, TcpConnectTimeout);
 		}
+
+		if (context->rdp)
+			context->rdp->connectTimings.tcpNs += winpr_GetTickCount64NS() - start;
 	}
 
 	return nego->TcpConnected;
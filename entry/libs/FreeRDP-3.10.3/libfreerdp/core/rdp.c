@@ -2271,6 +2271,7 @@ rdpRdp* rdp_new(rdpContext* context)
 	WLog_SetContext(rdp->log, NULL, rdp->log_context);
 
 	InitializeCriticalSection(&rdp->critical);
+	InitializeCriticalSection(&rdp->bitmapCacheStatsLock);
 	rdp->context = context;
 	WINPR_ASSERT(rdp->context);
 
@@ -2501,10 +2502,23 @@ fail:
  * @param rdp RDP module to be freed
  */
 
+void rdp_wait_bitmap_cache_flush(rdpRdp* rdp)
+{
+	WINPR_ASSERT(rdp);
+
+	if (!rdp->bitmapCacheFlush)
+		return;
+
+	(void)WaitForSingleObject(rdp->bitmapCacheFlush, INFINITE);
+	(void)CloseHandle(rdp->bitmapCacheFlush);
+	rdp->bitmapCacheFlush = NULL;
+}
+
 void rdp_free(rdpRdp* rdp)
 {
 	if (rdp)
 	{
+		rdp_wait_bitmap_cache_flush(rdp);
 		rdp_reset_free(rdp);
 
 		freerdp_settings_free(rdp->settings);
@@ -2525,6 +2539,7 @@ void rdp_free(rdpRdp* rdp)
 			(void)CloseHandle(rdp->abortEvent);
 		aad_free(rdp->aad);
 		WINPR_JSON_Delete(rdp->wellknown);
+		DeleteCriticalSection(&rdp->bitmapCacheStatsLock);
 		DeleteCriticalSection(&rdp->critical);
 		free(rdp);
 	}
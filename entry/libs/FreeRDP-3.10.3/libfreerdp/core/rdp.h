@@ -205,6 +205,16 @@ struct rdp_rdp
 	UINT32 deactivated_width;
 	UINT32 deactivated_height;
 
+	UINT64 connectStartNs;
+	UINT64 connectStateNs[CONNECTION_STATE_ACTIVE + 1];
+	rdpConnectTimings connectTimings;
+	BOOL connectTimingsDone;
+
+	/* the counters are updated by the cache and the flush thread and read by any thread */
+	CRITICAL_SECTION bitmapCacheStatsLock;
+	rdpBitmapCacheStats bitmapCacheStats;
+	HANDLE bitmapCacheFlush;
+
 	wLog* log;
 	char log_context[64];
 	WINPR_JSON* wellknown;
@@ -258,6 +268,9 @@ WINPR_ATTR_MALLOC(rdp_free, 1)
 FREERDP_LOCAL rdpRdp* rdp_new(rdpContext* context);
 FREERDP_LOCAL BOOL rdp_reset(rdpRdp* rdp);
 
+/* Blocks until the persistent bitmap cache file of the previous session is written */
+FREERDP_LOCAL void rdp_wait_bitmap_cache_flush(rdpRdp* rdp);
+
 FREERDP_LOCAL BOOL rdp_io_callback_set_event(rdpRdp* rdp, BOOL reset);
 
 FREERDP_LOCAL const rdpTransportIo* rdp_get_io_callbacks(rdpRdp* rdp);
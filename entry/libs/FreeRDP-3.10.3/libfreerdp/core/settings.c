@@ -1243,6 +1243,8 @@ rdpSettings* freerdp_settings_new(DWORD flags)
 		goto out_fail;
 	if (!freerdp_settings_set_uint32(settings, FreeRDP_TlsSecLevel, 1))
 		goto out_fail;
+	if (!freerdp_settings_set_bool(settings, FreeRDP_TlsSessionResumption, TRUE))
+		goto out_fail;
 	settings->OrderSupport = calloc(1, 32);
 
 	if (!freerdp_settings_set_uint16(settings, FreeRDP_TLSMinVersion, TLS1_VERSION))
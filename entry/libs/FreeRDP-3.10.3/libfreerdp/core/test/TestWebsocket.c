@@ -0,0 +1,296 @@
+#include <stdio.h>
+
+#include <winpr/crt.h>
+#include <winpr/crypto.h>
+#include <winpr/sysinfo.h>
+
+#include <openssl/bio.h>
+
+#include "../gateway/websocket.h"
+
+#define TEST_BIO_SIZE (1024 * 1024)
+#define TEST_BENCH_FRAME 16384
+#define TEST_BENCH_FRAMES 4096
+
+static BOOL test_read_all(BIO* bio, BYTE* buffer, size_t size)
+{
+	size_t offset = 0;
+
+	while (offset < size)
+	{
+		const int rc = BIO_read(bio, &buffer[offset], (int)(size - offset));
+		if (rc <= 0)
+			return FALSE;
+		offset += (size_t)rc;
+	}
+	return TRUE;
+}
+
+static BOOL test_drain(BIO* bio)
+{
+	BYTE buffer[8192] = { 0 };
+
+	while (BIO_ctrl_pending(bio) > 0)
+	{
+		if (BIO_read(bio, buffer, sizeof(buffer)) <= 0)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* Check a client to server frame, these are always masked */
+static BOOL test_client_frame(BIO* server, BYTE opcode, const BYTE* expect, size_t length)
+{
+	BOOL rc = FALSE;
+	BYTE header[8] = { 0 };
+	BYTE key[4] = { 0 };
+	size_t len = 0;
+
+	if (!test_read_all(server, header, 2))
+		return FALSE;
+
+	if ((header[0] != (WEBSOCKET_FIN_BIT | opcode)) || ((header[1] & WEBSOCKET_MASK_BIT) == 0))
+	{
+		printf("invalid frame header %02" PRIx8 " %02" PRIx8 "\n", header[0], header[1]);
+		return FALSE;
+	}
+
+	len = header[1] & 0x7f;
+	if ((len == 126) || (len == 127))
+	{
+		const size_t count = (len == 126) ? 2 : 8;
+		if (!test_read_all(server, header, count))
+			return FALSE;
+
+		len = 0;
+		for (size_t x = 0; x < count; x++)
+			len = (len << 8) | header[x];
+
+		/* The shortest length encoding must be used */
+		if ((len < 126) || ((count == 8) && (len < 0x10000)))
+			return FALSE;
+	}
+
+	if ((len != length) || !test_read_all(server, key, sizeof(key)))
+		return FALSE;
+
+	BYTE* payload = malloc(len + 1);
+	if (!payload || !test_read_all(server, payload, len))
+		goto fail;
+
+	for (size_t x = 0; x < len; x++)
+		payload[x] ^= key[x % 4];
+
+	rc = (len == 0) || (memcmp(payload, expect, len) == 0);
+	if (!rc)
+		printf("payload of %" PRIuz " bytes does not match\n", len);
+fail:
+	free(payload);
+	return rc;
+}
+
+static BOOL test_server_frame(BIO* server, BYTE first, const BYTE* data, size_t length)
+{
+	BYTE header[10] = { 0 };
+	size_t count = 2;
+
+	header[0] = first;
+	if (length < 126)
+		header[1] = (BYTE)length;
+	else if (length < 0x10000)
+	{
+		header[1] = 126;
+		header[2] = (BYTE)(length >> 8);
+		header[3] = (BYTE)length;
+		count = 4;
+	}
+	else
+	{
+		header[1] = 127;
+		for (size_t x = 0; x < 8; x++)
+			header[2 + x] = (BYTE)(((UINT64)length) >> (56 - 8 * x));
+		count = 10;
+	}
+
+	if (BIO_write(server, header, (int)count) != (int)count)
+		return FALSE;
+	return (length == 0) || (BIO_write(server, data, (int)length) == (int)length);
+}
+
+static BOOL test_write(websocket_context* context, BIO* client, BIO* server)
+{
+	const size_t sizes[] = { 0,   1,   3,   4,   5,    15,    16,    17,    63,
+		                     64,  65,  125, 126, 127,  1000,  65535, 65536, 70001 };
+	BOOL rc = FALSE;
+	BYTE* data = malloc(70001 + 10);
+	if (!data)
+		return FALSE;
+
+	winpr_RAND(data, 70001 + 10);
+
+	for (size_t x = 0; x < ARRAYSIZE(sizes); x++)
+	{
+		const int len = (int)sizes[x];
+		if (websocket_context_write(context, client, data, len, WebsocketBinaryOpcode) != len)
+			goto fail;
+		if (!test_client_frame(server, WebsocketBinaryOpcode, data, sizes[x]))
+			goto fail;
+	}
+
+	/* The header is masked as part of the same payload */
+	for (size_t x = 0; x < ARRAYSIZE(sizes); x++)
+	{
+		if (!websocket_context_write_parts(context, client, data, 10, &data[10], sizes[x],
+		                                   WebsocketBinaryOpcode))
+			goto fail;
+		if (!test_client_frame(server, WebsocketBinaryOpcode, data, sizes[x] + 10))
+			goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	free(data);
+	return rc;
+}
+
+static BOOL test_read(websocket_context* context, BIO* client, BIO* server)
+{
+	const BYTE ping[] = { 'p', 'i', 'n', 'g', '!' };
+	const size_t lengths[] = { 300, 100, 70000 };
+	const size_t total = lengths[0] + lengths[1] + lengths[2];
+	BOOL rc = FALSE;
+	size_t offset = 0;
+	BYTE* data = malloc(total);
+	BYTE* dst = calloc(1, total);
+	if (!data || !dst)
+		goto fail;
+
+	winpr_RAND(data, total);
+
+	/* A ping, a plain frame and a message split in two fragments */
+	if (!test_server_frame(server, WEBSOCKET_FIN_BIT | WebsocketPingOpcode, ping, sizeof(ping)) ||
+	    !test_server_frame(server, WEBSOCKET_FIN_BIT | WebsocketBinaryOpcode, data, lengths[0]) ||
+	    !test_server_frame(server, WebsocketBinaryOpcode, &data[lengths[0]], lengths[1]) ||
+	    !test_server_frame(server, WEBSOCKET_FIN_BIT | WebsocketContinuationOpcode,
+	                       &data[lengths[0] + lengths[1]], lengths[2]))
+		goto fail;
+
+	while (offset < total)
+	{
+		const int status = websocket_context_read(context, client, &dst[offset], total - offset);
+		if (status <= 0)
+			goto fail;
+		offset += (size_t)status;
+	}
+
+	if (memcmp(data, dst, total) != 0)
+	{
+		printf("received payload does not match\n");
+		goto fail;
+	}
+
+	/* The pong echoes the ping payload */
+	rc = test_client_frame(server, WebsocketPongOpcode, ping, sizeof(ping));
+fail:
+	free(data);
+	free(dst);
+	return rc;
+}
+
+/* The previous send path: allocate a frame and mask 32 bits at a time while copying */
+static BOOL test_reference_send(BIO* bio, const BYTE* data, size_t len)
+{
+	UINT32 maskingKey = 0;
+	wStream* s = Stream_New(NULL, len + 14);
+	if (!s)
+		return FALSE;
+
+	winpr_RAND(&maskingKey, sizeof(maskingKey));
+	Stream_Write_UINT8(s, WEBSOCKET_FIN_BIT | WebsocketBinaryOpcode);
+	Stream_Write_UINT8(s, 126 | WEBSOCKET_MASK_BIT);
+	Stream_Write_UINT16_BE(s, (UINT16)len);
+	Stream_Write_UINT32(s, maskingKey);
+
+	size_t x = 0;
+	for (; x + 4 <= len; x += 4)
+	{
+		UINT32 value = 0;
+		memcpy(&value, &data[x], sizeof(value));
+		Stream_Write_UINT32(s, value ^ maskingKey);
+	}
+	for (; x < len; x++)
+		Stream_Write_UINT8(s, data[x] ^ ((const BYTE*)&maskingKey)[x % 4]);
+
+	const int size = (int)Stream_GetPosition(s);
+	const int rc = BIO_write(bio, Stream_Buffer(s), size);
+	Stream_Free(s, TRUE);
+	return rc == size;
+}
+
+static BOOL test_benchmark(websocket_context* context, BIO* client, BIO* server)
+{
+	BYTE* data = malloc(TEST_BENCH_FRAME);
+	if (!data)
+		return FALSE;
+
+	winpr_RAND(data, TEST_BENCH_FRAME);
+
+	UINT64 reference = 0;
+	UINT64 framed = 0;
+	for (size_t x = 0; x < TEST_BENCH_FRAMES; x++)
+	{
+		const UINT64 start = winpr_GetTickCount64NS();
+		if (!test_reference_send(client, data, TEST_BENCH_FRAME))
+			goto fail;
+		const UINT64 mid = winpr_GetTickCount64NS();
+		if (websocket_context_write(context, client, data, TEST_BENCH_FRAME,
+		                            WebsocketBinaryOpcode) != TEST_BENCH_FRAME)
+			goto fail;
+		const UINT64 end = winpr_GetTickCount64NS();
+		if (!test_drain(server))
+			goto fail;
+
+		reference += mid - start;
+		framed += end - mid;
+	}
+
+	const double bytes = 1.0 * TEST_BENCH_FRAME * TEST_BENCH_FRAMES;
+	printf("%d byte frames: %.0f MiB/s reference, %.0f MiB/s framed\n", TEST_BENCH_FRAME,
+	       bytes * 1000.0 / (double)reference, bytes * 1000.0 / (double)framed);
+	free(data);
+	return TRUE;
+
+fail:
+	free(data);
+	return FALSE;
+}
+
+int TestWebsocket(int argc, char* argv[])
+{
+	int rc = -1;
+	BIO* client = NULL;
+	BIO* server = NULL;
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	websocket_context* context = websocket_context_new();
+	if (!context || (BIO_new_bio_pair(&client, TEST_BIO_SIZE, &server, TEST_BIO_SIZE) != 1))
+		goto fail;
+
+	if (!test_write(context, client, server))
+		goto fail;
+
+	if (!test_read(context, client, server))
+		goto fail;
+
+	if (!test_benchmark(context, client, server))
+		goto fail;
+
+	rc = 0;
+fail:
+	BIO_free(client);
+	BIO_free(server);
+	websocket_context_free(context);
+	return rc;
+}
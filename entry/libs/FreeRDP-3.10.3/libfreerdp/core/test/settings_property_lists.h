@@ -183,6 +183,7 @@ static const size_t bool_list_indices[] = {
 	FreeRDP_SynchronousStaticChannels,
 	FreeRDP_TcpKeepAlive,
 	FreeRDP_TlsSecurity,
+	FreeRDP_TlsSessionResumption,
 	FreeRDP_ToggleFullscreen,
 	FreeRDP_TransportDump,
 	FreeRDP_TransportDumpReplay,
@@ -221,6 +222,7 @@ static const size_t uint32_list_indices[] = {
 	FreeRDP_AcceptedCertLength,
 	FreeRDP_AuthenticationLevel,
 	FreeRDP_AutoReconnectMaxRetries,
+	FreeRDP_BitmapCachePersistMaxSize,
 	FreeRDP_BitmapCacheV2NumCells,
 	FreeRDP_BitmapCacheV3CodecId,
 	FreeRDP_BitmapCacheVersion,
@@ -453,6 +455,7 @@ static const size_t string_list_indices[] = {
 	FreeRDP_TargetNetAddress,
 	FreeRDP_TerminalDescriptor,
 	FreeRDP_TlsSecretsFile,
+	FreeRDP_TlsSessionCacheFile,
 	FreeRDP_TransportDumpFile,
 	FreeRDP_UserSpecifiedServerName,
 	FreeRDP_Username,
@@ -468,6 +471,7 @@ static const size_t pointer_list_indices[] = {
 	FreeRDP_ClientAutoReconnectCookie,
 	FreeRDP_ClientRandom,
 	FreeRDP_ClientTimeZone,
+	FreeRDP_CodecCallbackEnvironment,
 	FreeRDP_DeviceArray,
 	FreeRDP_DynamicChannelArray,
 	FreeRDP_FragCache,
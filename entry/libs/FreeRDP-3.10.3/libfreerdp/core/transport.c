@@ -29,6 +29,7 @@
 #include <winpr/stream.h>
 #include <winpr/winsock.h>
 #include <winpr/crypto.h>
+#include <winpr/sysinfo.h>
 
 #include <freerdp/log.h>
 #include <freerdp/error.h>
@@ -281,7 +282,11 @@ BOOL transport_connect_tls(rdpTransport* transport)
 		}
 	}
 
-	return IFCALLRESULT(FALSE, transport->io.TLSConnect, transport);
+	const UINT64 start = winpr_GetTickCount64NS();
+	const BOOL rc = IFCALLRESULT(FALSE, transport->io.TLSConnect, transport);
+	if (context->rdp)
+		context->rdp->connectTimings.tlsNs += winpr_GetTickCount64NS() - start;
+	return rc;
 }
 
 static BOOL transport_default_connect_tls(rdpTransport* transport)
@@ -334,6 +339,8 @@ static BOOL transport_default_connect_tls(rdpTransport* transport)
 	}
 
 	transport->frontBio = tls->bio;
+	if (context->rdp)
+		context->rdp->connectTimings.tlsResumed = tls->sessionResumed;
 
 	/* See libfreerdp/crypto/tls.c transport_default_connect_tls
 	 *
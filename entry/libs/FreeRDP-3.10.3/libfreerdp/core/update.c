@@ -37,6 +37,7 @@
 #include <freerdp/log.h>
 #include <freerdp/peer.h>
 #include <freerdp/codec/bitmap.h>
+#include <freerdp/gdi/region.h>
 
 #include "../cache/pointer.h"
 #include "../cache/palette.h"
@@ -3335,6 +3336,7 @@ BOOL update_begin_paint(rdpUpdate* update)
 
 		hwnd->invalid->null = TRUE;
 		hwnd->ninvalid = 0;
+		gdi_invalid_grid_clear(hwnd->grid);
 	}
 
 	return rc;
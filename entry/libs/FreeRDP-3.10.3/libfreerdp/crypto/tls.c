@@ -48,6 +48,7 @@
 #include "opensslcompat.h"
 #include "certificate.h"
 #include "privatekey.h"
+#include "tls_session.h"
 
 #ifdef WINPR_HAVE_POLL_H
 #include <poll.h>
@@ -735,6 +736,81 @@ static void SSLCTX_keylog_cb(const SSL* ssl, const char* line)
 	}
 }
 
+static INIT_ONCE session_idx_once = INIT_ONCE_STATIC_INIT;
+static int session_idx = -1;
+
+static BOOL CALLBACK session_idx_init_cb(PINIT_ONCE once, PVOID param, PVOID* context)
+{
+	session_idx = SSL_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+
+	return (session_idx != -1);
+}
+
+static const char* tls_session_cache_file(rdpTls* tls)
+{
+	WINPR_ASSERT(tls);
+	WINPR_ASSERT(tls->context);
+	return freerdp_settings_get_string(tls->context->settings, FreeRDP_TlsSessionCacheFile);
+}
+
+/* With TLS 1.3 the tickets arrive after the handshake, so the cache is filled from here */
+static int tls_new_session_cb(SSL* ssl, SSL_SESSION* session)
+{
+	if (session_idx == -1)
+		return 0;
+
+	rdpTls* tls = SSL_get_ex_data(ssl, session_idx);
+	if (!tls || !tls->hostname)
+		return 0;
+
+	WINPR_ASSERT(tls->port <= UINT16_MAX);
+	(void)freerdp_tls_session_put(tls->hostname, (UINT16)tls->port, session,
+	                              tls_session_cache_file(tls));
+	return 1;
+}
+
+static void tls_prepare_session(rdpTls* tls)
+{
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L && !defined(LIBRESSL_VERSION_NUMBER)
+	WINPR_ASSERT(tls);
+
+	if (!tls->hostname || SSL_is_dtls(tls->ssl))
+		return;
+
+	InitOnceExecuteOnce(&session_idx_once, session_idx_init_cb, NULL, NULL);
+	if (session_idx == -1)
+		return;
+
+	SSL_set_ex_data(tls->ssl, session_idx, tls);
+	SSL_CTX_set_session_cache_mode(tls->ctx,
+	                               SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+	SSL_CTX_sess_set_new_cb(tls->ctx, tls_new_session_cb);
+
+	WINPR_ASSERT(tls->port <= UINT16_MAX);
+	SSL_SESSION* session =
+	    freerdp_tls_session_get(tls->hostname, (UINT16)tls->port, tls_session_cache_file(tls));
+	if (session)
+	{
+		if (SSL_set_session(tls->ssl, session) == 1)
+			WLog_DBG(TAG, "offering TLS session for %s:%d", tls->hostname, tls->port);
+		SSL_SESSION_free(session);
+	}
+#else
+	WINPR_UNUSED(tls);
+#endif
+}
+
+static void tls_forget_session(rdpTls* tls)
+{
+	WINPR_ASSERT(tls);
+
+	if (!tls->isClientMode || !tls->hostname)
+		return;
+
+	WINPR_ASSERT(tls->port <= UINT16_MAX);
+	freerdp_tls_session_remove(tls->hostname, (UINT16)tls->port, tls_session_cache_file(tls));
+}
+
 static void tls_reset(rdpTls* tls)
 {
 	WINPR_ASSERT(tls);
@@ -772,6 +848,7 @@ static BOOL tls_prepare(rdpTls* tls, BIO* underlying, SSL_METHOD* method, int op
 	WINPR_ASSERT(settings);
 
 	tls_reset(tls);
+	tls->sessionResumed = FALSE;
 	tls->ctx = SSL_CTX_new(method);
 
 	tls->underlying = underlying;
@@ -820,6 +897,9 @@ static BOOL tls_prepare(rdpTls* tls, BIO* underlying, SSL_METHOD* method, int op
 		return FALSE;
 	}
 
+	if (clientMode && freerdp_settings_get_bool(settings, FreeRDP_TlsSessionResumption))
+		tls_prepare_session(tls);
+
 	if (settings->TlsSecretsFile)
 	{
 #if OPENSSL_VERSION_NUMBER >= 0x10101000L
@@ -938,6 +1018,7 @@ TlsHandshakeResult freerdp_tls_handshake(rdpTls* tls)
 			wLog* log = WLog_Get(TAG);
 			WLog_Print(log, WLOG_ERROR, "BIO_do_handshake failed");
 			ERR_print_errors_cb(bio_err_print, log);
+			tls_forget_session(tls);
 			return TLS_HANDSHAKE_ERROR;
 		}
 
@@ -945,6 +1026,10 @@ TlsHandshakeResult freerdp_tls_handshake(rdpTls* tls)
 	}
 
 	int verify_status = 0;
+	tls->sessionResumed = SSL_session_reused(tls->ssl) == 1;
+	if (tls->sessionResumed)
+		WLog_DBG(TAG, "resumed TLS session with %s:%d", tls->hostname, tls->port);
+
 	rdpCertificate* cert = tls_get_certificate(tls, tls->isClientMode);
 
 	if (!cert)
@@ -983,6 +1068,7 @@ TlsHandshakeResult freerdp_tls_handshake(rdpTls* tls)
 			if (verify_status < 1)
 			{
 				WLog_ERR(TAG, "certificate not trusted, aborting.");
+				tls_forget_session(tls);
 				freerdp_tls_send_alert(tls);
 				ret = TLS_HANDSHAKE_VERIFY_ERROR;
 			}
@@ -2094,6 +2180,10 @@ void freerdp_tls_free(rdpTls* tls)
 	if (!tls)
 		return;
 
+	/* Sessions learned on this connection are persisted once it is done, not in the handshake */
+	if (tls->isClientMode && tls->context)
+		freerdp_tls_session_save(tls_session_cache_file(tls));
+
 	tls_reset(tls);
 
 	if (tls->certificate_store)
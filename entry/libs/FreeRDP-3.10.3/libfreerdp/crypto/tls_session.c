@@ -0,0 +1,400 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * TLS Session Resumption Cache
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <time.h>
+
+#include <winpr/assert.h>
+#include <winpr/crt.h>
+#include <winpr/file.h>
+#include <winpr/synch.h>
+#include <winpr/stream.h>
+#include <winpr/collections.h>
+
+#include <freerdp/log.h>
+#include <freerdp/crypto/crypto.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+#include "tls_session.h"
+
+#define TAG FREERDP_TAG("crypto.tls")
+
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L && !defined(LIBRESSL_VERSION_NUMBER)
+
+/* Sessions are kept per process, keyed by host:port */
+static INIT_ONCE sessions_once = INIT_ONCE_STATIC_INIT;
+static wHashTable* sessions = NULL;
+static char* sessions_file = NULL;
+
+/* Changes since the last save, both with the table locked */
+static BOOL sessions_dirty = FALSE;
+static UINT64 sessions_generation = 0;
+
+/* Serializes the file writes, which happen outside of the table lock */
+static CRITICAL_SECTION sessions_save_lock;
+static UINT64 sessions_saved = 0;
+
+static void session_free(void* obj)
+{
+	SSL_SESSION_free(obj);
+}
+
+static BOOL CALLBACK sessions_init(PINIT_ONCE once, PVOID param, PVOID* context)
+{
+	WINPR_UNUSED(once);
+	WINPR_UNUSED(param);
+	WINPR_UNUSED(context);
+
+	sessions = HashTable_New(TRUE);
+	if (!sessions)
+		return FALSE;
+
+	if (!HashTable_SetupForStringData(sessions, FALSE))
+	{
+		HashTable_Free(sessions);
+		sessions = NULL;
+		return FALSE;
+	}
+
+	wObject* obj = HashTable_ValueObject(sessions);
+	obj->fnObjectFree = session_free;
+	InitializeCriticalSection(&sessions_save_lock);
+	return TRUE;
+}
+
+static BOOL session_key(char* key, size_t size, const char* hostname, UINT16 port)
+{
+	if (!hostname)
+		return FALSE;
+
+	const int rc = _snprintf(key, size, "%s:%" PRIu16, hostname, port);
+	return (rc > 0) && ((size_t)rc < size);
+}
+
+static BOOL session_is_valid(const SSL_SESSION* session)
+{
+	if (!SSL_SESSION_is_resumable(session))
+		return FALSE;
+
+	const long expires = SSL_SESSION_get_time(session) + SSL_SESSION_get_timeout(session);
+	return expires > (long)time(NULL);
+}
+
+static FILE* open_private_file(const char* path)
+{
+#if defined(_WIN32)
+	return winpr_fopen(path, "w");
+#else
+	/* The sessions contain key material, keep them private to the user */
+	const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+	if (fd < 0)
+		return NULL;
+
+	FILE* fp = fdopen(fd, "w");
+	if (!fp)
+		close(fd);
+	return fp;
+#endif
+}
+
+static BOOL write_session(const void* key, void* value, void* arg)
+{
+	wStream* s = arg;
+	SSL_SESSION* session = value;
+	BYTE* der = NULL;
+
+	if (!session_is_valid(session))
+		return TRUE;
+
+	const int len = i2d_SSL_SESSION(session, &der);
+	if (len <= 0)
+		return TRUE;
+
+	char* b64 = crypto_base64_encode(der, (size_t)len);
+	OPENSSL_free(der);
+	if (!b64)
+		return FALSE;
+
+	const size_t keyLen = strlen(key);
+	const size_t b64Len = strlen(b64);
+	const BOOL rc = Stream_EnsureRemainingCapacity(s, keyLen + b64Len + 2);
+	if (rc)
+	{
+		Stream_Write(s, key, keyLen);
+		Stream_Write_UINT8(s, ' ');
+		Stream_Write(s, b64, b64Len);
+		Stream_Write_UINT8(s, '\n');
+	}
+	free(b64);
+	return rc;
+}
+
+static BOOL sessions_write(const char* file, const wStream* s)
+{
+	char tmp[MAX_PATH] = { 0 };
+
+	if (_snprintf(tmp, sizeof(tmp), "%s.tmp", file) >= (int)sizeof(tmp))
+		return FALSE;
+
+	FILE* fp = open_private_file(tmp);
+	if (!fp)
+	{
+		WLog_WARN(TAG, "failed to write TLS session cache %s", tmp);
+		return FALSE;
+	}
+
+	const size_t len = Stream_GetPosition(s);
+	const BOOL rc = fwrite(Stream_ConstBuffer(s), 1, len, fp) == len;
+	(void)fclose(fp);
+
+	if (!rc || !MoveFileExA(tmp, file, MOVEFILE_REPLACE_EXISTING))
+	{
+		WLog_WARN(TAG, "failed to update TLS session cache %s", file);
+		(void)DeleteFileA(tmp);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void sessions_load(const char* file)
+{
+	char line[8192] = { 0 };
+
+	FILE* fp = winpr_fopen(file, "r");
+	if (!fp)
+		return;
+
+	while (fgets(line, sizeof(line), fp))
+	{
+		char* sep = strchr(line, ' ');
+		if (!sep)
+			continue;
+		*sep++ = '\0';
+
+		const size_t len = strcspn(sep, "\r\n");
+		sep[len] = '\0';
+
+		BYTE* der = NULL;
+		size_t derLen = 0;
+		crypto_base64_decode(sep, len, &der, &derLen);
+		if (!der)
+			continue;
+
+		const unsigned char* ptr = der;
+		SSL_SESSION* session = d2i_SSL_SESSION(NULL, &ptr, (long)derLen);
+		free(der);
+		if (!session)
+			continue;
+
+		/* A session negotiated by this process is more recent than the stored one */
+		if (!session_is_valid(session) || HashTable_Contains(sessions, line) ||
+		    !HashTable_Insert(sessions, line, session))
+			SSL_SESSION_free(session);
+	}
+
+	(void)fclose(fp);
+	WLog_DBG(TAG, "loaded %" PRIuz " TLS sessions from %s", HashTable_Count(sessions), file);
+}
+
+static BOOL sessions_ready(void)
+{
+	return InitOnceExecuteOnce(&sessions_once, sessions_init, NULL, NULL) && sessions;
+}
+
+/* Must be called with the table locked */
+static BOOL sessions_prepare(const char* file)
+{
+	if (file && (!sessions_file || (strcmp(file, sessions_file) != 0)))
+	{
+		char* copy = _strdup(file);
+		if (!copy)
+			return FALSE;
+
+		free(sessions_file);
+		sessions_file = copy;
+		sessions_load(file);
+	}
+
+	return TRUE;
+}
+
+SSL_SESSION* freerdp_tls_session_get(const char* hostname, UINT16 port, const char* file)
+{
+	char key[512] = { 0 };
+	SSL_SESSION* session = NULL;
+
+	if (!session_key(key, sizeof(key), hostname, port))
+		return NULL;
+
+	if (!sessions_ready())
+		return NULL;
+
+	HashTable_Lock(sessions);
+	if (sessions_prepare(file))
+	{
+		session = HashTable_GetItemValue(sessions, key);
+		if (session && !session_is_valid(session))
+		{
+			HashTable_Remove(sessions, key);
+			session = NULL;
+		}
+
+		if (session)
+			SSL_SESSION_up_ref(session);
+	}
+	HashTable_Unlock(sessions);
+
+	return session;
+}
+
+BOOL freerdp_tls_session_put(const char* hostname, UINT16 port, SSL_SESSION* session,
+                             const char* file)
+{
+	char key[512] = { 0 };
+	BOOL rc = FALSE;
+
+	WINPR_ASSERT(session);
+
+	if (!session_key(key, sizeof(key), hostname, port) || !session_is_valid(session))
+	{
+		SSL_SESSION_free(session);
+		return FALSE;
+	}
+
+	if (!sessions_ready())
+	{
+		SSL_SESSION_free(session);
+		return FALSE;
+	}
+
+	HashTable_Lock(sessions);
+	if (sessions_prepare(file))
+		rc = HashTable_Insert(sessions, key, session);
+
+	if (!rc)
+		SSL_SESSION_free(session);
+	else if (file)
+	{
+		sessions_dirty = TRUE;
+		sessions_generation++;
+	}
+	HashTable_Unlock(sessions);
+
+	return rc;
+}
+
+void freerdp_tls_session_remove(const char* hostname, UINT16 port, const char* file)
+{
+	char key[512] = { 0 };
+
+	if (!session_key(key, sizeof(key), hostname, port))
+		return;
+
+	if (!sessions_ready())
+		return;
+
+	HashTable_Lock(sessions);
+	if (sessions_prepare(file) && HashTable_Remove(sessions, key) && file)
+	{
+		sessions_dirty = TRUE;
+		sessions_generation++;
+	}
+	HashTable_Unlock(sessions);
+}
+
+void freerdp_tls_session_save(const char* file)
+{
+	if (!file || !sessions_ready())
+		return;
+
+	wStream* s = Stream_New(NULL, 4096);
+	if (!s)
+		return;
+
+	/* Only the serialization happens with the table locked */
+	HashTable_Lock(sessions);
+	const BOOL save = sessions_dirty && sessions_prepare(file) &&
+	                  HashTable_Foreach(sessions, write_session, s);
+	const UINT64 generation = sessions_generation;
+	if (save)
+		sessions_dirty = FALSE;
+	HashTable_Unlock(sessions);
+
+	if (save)
+	{
+		EnterCriticalSection(&sessions_save_lock);
+		/* A concurrent save may have written a newer state already */
+		BOOL rc = generation <= sessions_saved;
+		if (!rc)
+		{
+			rc = sessions_write(file, s);
+			if (rc)
+				sessions_saved = generation;
+		}
+		LeaveCriticalSection(&sessions_save_lock);
+
+		if (!rc)
+		{
+			HashTable_Lock(sessions);
+			sessions_dirty = TRUE;
+			HashTable_Unlock(sessions);
+		}
+	}
+
+	Stream_Free(s, TRUE);
+}
+
+#else
+
+SSL_SESSION* freerdp_tls_session_get(const char* hostname, UINT16 port, const char* file)
+{
+	WINPR_UNUSED(hostname);
+	WINPR_UNUSED(port);
+	WINPR_UNUSED(file);
+	return NULL;
+}
+
+BOOL freerdp_tls_session_put(const char* hostname, UINT16 port, SSL_SESSION* session,
+                             const char* file)
+{
+	WINPR_UNUSED(hostname);
+	WINPR_UNUSED(port);
+	WINPR_UNUSED(file);
+	SSL_SESSION_free(session);
+	return FALSE;
+}
+
+void freerdp_tls_session_remove(const char* hostname, UINT16 port, const char* file)
+{
+	WINPR_UNUSED(hostname);
+	WINPR_UNUSED(port);
+	WINPR_UNUSED(file);
+}
+
+void freerdp_tls_session_save(const char* file)
+{
+	WINPR_UNUSED(file);
+}
+
+#endif
@@ -0,0 +1,60 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * TLS Session Resumption Cache
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_CRYPTO_TLS_SESSION_H
+#define FREERDP_LIB_CRYPTO_TLS_SESSION_H
+
+#include <openssl/ssl.h>
+
+#include <winpr/wtypes.h>
+#include <freerdp/api.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	/** @brief Look up a resumable session for a server.
+	 *
+	 *  @param hostname The server the session was negotiated with
+	 *  @param port The server port
+	 *  @param file An optional file the cache is persisted in, loaded on first use
+	 *
+	 *  @return A new reference to the session or \b NULL, release with \b SSL_SESSION_free
+	 */
+	FREERDP_LOCAL SSL_SESSION* freerdp_tls_session_get(const char* hostname, UINT16 port,
+	                                                   const char* file);
+
+	/** @brief Remember a session for a server, takes ownership of \b session
+	 *
+	 *  If \b file is not \b NULL the change is written by \b freerdp_tls_session_save.
+	 */
+	FREERDP_LOCAL BOOL freerdp_tls_session_put(const char* hostname, UINT16 port,
+	                                           SSL_SESSION* session, const char* file);
+
+	/** @brief Forget the session of a server, e.g. after the handshake failed */
+	FREERDP_LOCAL void freerdp_tls_session_remove(const char* hostname, UINT16 port,
+	                                              const char* file);
+
+	/** @brief Write the cache to \b file if it changed, the table is not locked during I/O */
+	FREERDP_LOCAL void freerdp_tls_session_save(const char* file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FREERDP_LIB_CRYPTO_TLS_SESSION_H */
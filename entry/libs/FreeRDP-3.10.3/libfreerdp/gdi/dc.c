@@ -245,6 +245,7 @@ BOOL gdi_DeleteDC(HGDI_DC hdc)
 	{
 		if (hdc->hwnd)
 		{
+			gdi_invalid_grid_free(hdc->hwnd->grid);
 			free(hdc->hwnd->cinvalid);
 			free(hdc->hwnd->invalid);
 			free(hdc->hwnd);
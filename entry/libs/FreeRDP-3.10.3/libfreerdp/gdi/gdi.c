@@ -43,6 +43,7 @@
 #include "brush.h"
 #include "line.h"
 #include "gdi.h"
+#include "glyph_atlas.h"
 #include "../core/graphics.h"
 #include "../core/update.h"
 #include "../cache/cache.h"
@@ -1269,6 +1270,17 @@ static BOOL gdi_init_primary(rdpGdi* gdi, UINT32 stride, UINT32 format, BYTE* bu
 
 	gdi->primary->hdc->hwnd->ninvalid = 0;
 
+	if (gdi->invalidTileSize > 0)
+	{
+		GDI_INVALID_GRID* grid = gdi_invalid_grid_new((UINT32)gdi->width, (UINT32)gdi->height,
+		                                              gdi->invalidTileSize);
+		if (!grid)
+			goto fail_hwnd;
+
+		gdi_invalid_grid_set_full_frame(grid, gdi->invalidFullFramePercent);
+		gdi->primary->hdc->hwnd->grid = grid;
+	}
+
 	if (!gdi->drawing)
 		gdi->drawing = gdi->primary;
 
@@ -1286,6 +1298,43 @@ fail_primary:
 	return FALSE;
 }
 
+BOOL gdi_set_invalid_tiles(rdpGdi* gdi, UINT32 tileSize, UINT32 fullFramePercent)
+{
+	if (!gdi || !gdi->primary || !gdi->primary->hdc || !gdi->primary->hdc->hwnd)
+		return FALSE;
+
+	WINPR_ASSERT(gdi->context);
+	HGDI_WND hwnd = gdi->primary->hdc->hwnd;
+	GDI_INVALID_GRID* grid = NULL;
+
+	if (tileSize > 0)
+	{
+		grid = gdi_invalid_grid_new((UINT32)gdi->width, (UINT32)gdi->height, tileSize);
+		if (!grid)
+			return FALSE;
+
+		gdi_invalid_grid_set_full_frame(grid, fullFramePercent);
+	}
+
+	rdp_update_lock(gdi->context->update);
+	gdi_invalid_grid_free(hwnd->grid);
+	hwnd->grid = grid;
+
+	/* start over, whatever was collected so far is reported as one rectangle */
+	if (grid && !hwnd->invalid->null)
+		gdi_invalid_grid_add(grid, hwnd->invalid->x, hwnd->invalid->y, hwnd->invalid->w,
+		                     hwnd->invalid->h);
+	hwnd->ninvalid = hwnd->invalid->null ? 0 : 1;
+	if (!grid && (hwnd->ninvalid > 0))
+		gdi_SetRgn(&hwnd->cinvalid[0], hwnd->invalid->x, hwnd->invalid->y, hwnd->invalid->w,
+		           hwnd->invalid->h);
+
+	gdi->invalidTileSize = tileSize;
+	gdi->invalidFullFramePercent = fullFramePercent;
+	rdp_update_unlock(gdi->context->update);
+	return TRUE;
+}
+
 BOOL gdi_resize(rdpGdi* gdi, UINT32 width, UINT32 height)
 {
 	return gdi_resize_ex(gdi, width, height, 0, 0, NULL, NULL);
@@ -1386,6 +1435,9 @@ BOOL gdi_init_ex(freerdp* instance, UINT32 format, UINT32 stride, BYTE* buffer,
 
 	gdi->hdc->format = gdi->dstFormat;
 
+	if (!(gdi->glyphs = gdi_glyph_atlas_new()))
+		goto fail;
+
 	if (!gdi_init_primary(gdi, stride, gdi->dstFormat, buffer, pfree, FALSE))
 		goto fail;
 
@@ -1423,6 +1475,7 @@ void gdi_free(freerdp* instance)
 	{
 		gdi_bitmap_free_ex(gdi->primary);
 		gdi_DeleteDC(gdi->hdc);
+		gdi_glyph_atlas_free(gdi->glyphs);
 		free(gdi);
 	}
 
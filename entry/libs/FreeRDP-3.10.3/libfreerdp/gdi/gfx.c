@@ -76,6 +76,295 @@ static DWORD gfx_align_scanline(DWORD widthInBytes, DWORD alignment)
 	return scanline;
 }
 
+/* Compressed bytes a surface keeps for commands out of view before it decodes them anyway */
+#define GDI_GFX_DEFERRED_MAX_BYTES (16ull * 1024ull * 1024ull)
+
+struct gdi_gfx_deferred
+{
+	REGION16 output; /* decoded, copied to the primary surface once in view */
+
+	/* uncompressed and planar commands out of view, never overlapping each other */
+	RDPGFX_SURFACE_COMMAND* pending;
+	size_t count;
+	size_t capacity;
+	size_t bytes;
+};
+
+static gdiGfxDeferred* gdi_deferred_new(void)
+{
+	gdiGfxDeferred* deferred = (gdiGfxDeferred*)calloc(1, sizeof(gdiGfxDeferred));
+	if (!deferred)
+		return NULL;
+
+	region16_init(&deferred->output);
+	return deferred;
+}
+
+static void gdi_deferred_clear(gdiGfxDeferred* deferred)
+{
+	if (!deferred)
+		return;
+
+	for (size_t x = 0; x < deferred->count; x++)
+		free(deferred->pending[x].data);
+	deferred->count = 0;
+	deferred->bytes = 0;
+	region16_clear(&deferred->output);
+}
+
+static void gdi_deferred_free(gdiGfxDeferred* deferred)
+{
+	if (!deferred)
+		return;
+
+	gdi_deferred_clear(deferred);
+	region16_uninit(&deferred->output);
+	free(deferred->pending);
+	free(deferred);
+}
+
+static RECTANGLE_16 gdi_command_rect(const RDPGFX_SURFACE_COMMAND* cmd)
+{
+	const RECTANGLE_16 rect = { (UINT16)MIN(UINT16_MAX, cmd->left),
+		                        (UINT16)MIN(UINT16_MAX, cmd->top),
+		                        (UINT16)MIN(UINT16_MAX, cmd->right),
+		                        (UINT16)MIN(UINT16_MAX, cmd->bottom) };
+	return rect;
+}
+
+static BOOL gdi_rect_contains(const RECTANGLE_16* outer, const RECTANGLE_16* inner)
+{
+	return (outer->left <= inner->left) && (outer->top <= inner->top) &&
+	       (outer->right >= inner->right) && (outer->bottom >= inner->bottom);
+}
+
+static UINT16 gdi_viewport_coord(double value, UINT32 max)
+{
+	if (value <= 0.0)
+		return 0;
+	return (UINT16)MIN(MIN(value, (double)max), (double)UINT16_MAX);
+}
+
+/**
+ * The part of an output mapped surface inside the client viewport, in surface coordinates.
+ * Returns FALSE if the whole surface is treated as visible.
+ */
+static BOOL gdi_surface_viewport(const rdpGdi* gdi, const gdiGfxSurface* surface,
+                                 RECTANGLE_16* rect)
+{
+	WINPR_ASSERT(gdi);
+	WINPR_ASSERT(surface);
+	WINPR_ASSERT(rect);
+
+	const RECTANGLE_16* viewport = &gdi->viewport;
+	if (rectangle_is_empty(viewport))
+		return FALSE;
+
+	/* Window mapped surfaces are presented by the client itself */
+	if (!surface->outputMapped || surface->windowMapped || surface->handleInUpdateSurfaceArea)
+		return FALSE;
+
+	if ((surface->mappedWidth == 0) || (surface->mappedHeight == 0) ||
+	    (surface->outputTargetWidth == 0) || (surface->outputTargetHeight == 0))
+		return FALSE;
+
+	const double sx = surface->outputTargetWidth / (double)surface->mappedWidth;
+	const double sy = surface->outputTargetHeight / (double)surface->mappedHeight;
+	const double originX = surface->outputOriginX;
+	const double originY = surface->outputOriginY;
+
+	rect->left = gdi_viewport_coord(floor((viewport->left - originX) / sx), surface->mappedWidth);
+	rect->top = gdi_viewport_coord(floor((viewport->top - originY) / sy), surface->mappedHeight);
+	rect->right = gdi_viewport_coord(ceil((viewport->right - originX) / sx), surface->mappedWidth);
+	rect->bottom =
+	    gdi_viewport_coord(ceil((viewport->bottom - originY) / sy), surface->mappedHeight);
+	return TRUE;
+}
+
+/* Add the part of rect inside clip to inside and the up to four bands around it to outside */
+static BOOL gdi_split_rect(const RECTANGLE_16* rect, const RECTANGLE_16* clip, REGION16* inside,
+                           REGION16* outside)
+{
+	RECTANGLE_16 common = { 0 };
+
+	if (!rectangles_intersection(rect, clip, &common))
+		return region16_union_rect(outside, outside, rect);
+
+	if (!region16_union_rect(inside, inside, &common))
+		return FALSE;
+
+	const RECTANGLE_16 bands[] = {
+		{ rect->left, rect->top, rect->right, common.top },
+		{ rect->left, common.bottom, rect->right, rect->bottom },
+		{ rect->left, common.top, common.left, common.bottom },
+		{ common.right, common.top, rect->right, common.bottom },
+	};
+
+	for (size_t x = 0; x < ARRAYSIZE(bands); x++)
+	{
+		if (rectangle_is_empty(&bands[x]))
+			continue;
+		if (!region16_union_rect(outside, outside, &bands[x]))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* Cut region at clip, region keeps the part inside and the rest is added to outside */
+static BOOL gdi_split_region(REGION16* region, const RECTANGLE_16* clip, REGION16* outside)
+{
+	BOOL rc = TRUE;
+	UINT32 nbRects = 0;
+	REGION16 inside;
+
+	region16_init(&inside);
+	const RECTANGLE_16* rects = region16_rects(region, &nbRects);
+	for (UINT32 x = 0; rc && (x < nbRects); x++)
+		rc = gdi_split_rect(&rects[x], clip, &inside, outside);
+
+	if (rc)
+		rc = region16_copy(region, &inside);
+	region16_uninit(&inside);
+	return rc;
+}
+
+static UINT gdi_decode_Uncompressed(gdiGfxSurface* surface, const RDPGFX_SURFACE_COMMAND* cmd)
+{
+	if (!freerdp_image_copy_no_overlap(surface->data, surface->format, surface->scanline, cmd->left,
+	                                   cmd->top, cmd->width, cmd->height, cmd->data, cmd->format, 0,
+	                                   0, 0, NULL, FREERDP_FLIP_NONE))
+		return ERROR_INTERNAL_ERROR;
+	return CHANNEL_RC_OK;
+}
+
+static UINT gdi_decode_Planar(gdiGfxSurface* surface, const RDPGFX_SURFACE_COMMAND* cmd)
+{
+	WINPR_ASSERT(surface->codecs);
+	if (!planar_decompress(surface->codecs->planar, cmd->data, cmd->length, cmd->width,
+	                       cmd->height, surface->data, surface->format, surface->scanline,
+	                       cmd->left, cmd->top, cmd->width, cmd->height, FALSE))
+		return ERROR_INTERNAL_ERROR;
+	return CHANNEL_RC_OK;
+}
+
+/**
+ * Decode the pending commands of a surface under rect, all of them for a NULL rect.
+ * With overwrite set the caller draws over rect, pending commands it covers are dropped.
+ */
+static UINT gdi_materialize(gdiGfxSurface* surface, const RECTANGLE_16* rect, BOOL overwrite)
+{
+	UINT status = CHANNEL_RC_OK;
+	size_t kept = 0;
+
+	WINPR_ASSERT(surface);
+	gdiGfxDeferred* deferred = surface->deferred;
+	if (!deferred || (deferred->count == 0))
+		return CHANNEL_RC_OK;
+
+	for (size_t x = 0; x < deferred->count; x++)
+	{
+		RDPGFX_SURFACE_COMMAND* cmd = &deferred->pending[x];
+		const RECTANGLE_16 cmdRect = gdi_command_rect(cmd);
+
+		if ((status != CHANNEL_RC_OK) || (rect && !rectangles_intersects(rect, &cmdRect)))
+		{
+			deferred->pending[kept++] = *cmd;
+			continue;
+		}
+
+		if (!overwrite || !rect || !gdi_rect_contains(rect, &cmdRect))
+		{
+			if (cmd->codecId == RDPGFX_CODECID_PLANAR)
+				status = gdi_decode_Planar(surface, cmd);
+			else
+				status = gdi_decode_Uncompressed(surface, cmd);
+
+			if ((status == CHANNEL_RC_OK) &&
+			    !region16_union_rect(&surface->invalidRegion, &surface->invalidRegion, &cmdRect))
+				status = ERROR_NOT_ENOUGH_MEMORY;
+		}
+
+		deferred->bytes -= cmd->length;
+		free(cmd->data);
+	}
+
+	deferred->count = kept;
+	return status;
+}
+
+/**
+ * Keep a stateless command compressed while its area is out of view.
+ * The caller materialized everything under the command before.
+ */
+static BOOL gdi_defer_command(rdpGdi* gdi, RdpgfxClientContext* context, gdiGfxSurface* surface,
+                              const RDPGFX_SURFACE_COMMAND* cmd)
+{
+	RECTANGLE_16 visible = { 0 };
+	const RECTANGLE_16 rect = gdi_command_rect(cmd);
+
+	gdiGfxDeferred* deferred = surface->deferred;
+	if (!deferred || context->UpdateSurfaceArea)
+		return FALSE;
+
+	if (!gdi_surface_viewport(gdi, surface, &visible) || rectangles_intersects(&rect, &visible))
+		return FALSE;
+
+	if (deferred->bytes + cmd->length > GDI_GFX_DEFERRED_MAX_BYTES)
+		return FALSE;
+
+	if (deferred->count == deferred->capacity)
+	{
+		const size_t capacity = MAX(16, deferred->capacity * 2);
+		RDPGFX_SURFACE_COMMAND* pending = (RDPGFX_SURFACE_COMMAND*)realloc(
+		    deferred->pending, capacity * sizeof(RDPGFX_SURFACE_COMMAND));
+		if (!pending)
+			return FALSE;
+		deferred->pending = pending;
+		deferred->capacity = capacity;
+	}
+
+	BYTE* data = (BYTE*)malloc(MAX(1, cmd->length));
+	if (!data)
+		return FALSE;
+	if (cmd->length > 0)
+		memcpy(data, cmd->data, cmd->length);
+
+	RDPGFX_SURFACE_COMMAND* pending = &deferred->pending[deferred->count++];
+	*pending = *cmd;
+	pending->data = data;
+	pending->extra = NULL;
+	deferred->bytes += cmd->length;
+	return TRUE;
+}
+
+/* Bring what scrolled into the viewport up to date, everything if there is no viewport */
+static UINT gdi_surface_viewport_changed(rdpGdi* gdi, gdiGfxSurface* surface)
+{
+	UINT status = CHANNEL_RC_OK;
+	UINT32 nbRects = 0;
+	RECTANGLE_16 visible = { 0 };
+	REGION16 outside;
+
+	gdiGfxDeferred* deferred = surface->deferred;
+	if (!deferred)
+		return CHANNEL_RC_OK;
+
+	const BOOL limited = gdi_surface_viewport(gdi, surface, &visible);
+	status = gdi_materialize(surface, limited ? &visible : NULL, FALSE);
+
+	region16_init(&outside);
+	if (limited && !gdi_split_region(&deferred->output, &visible, &outside))
+		status = ERROR_NOT_ENOUGH_MEMORY;
+
+	const RECTANGLE_16* rects = region16_rects(&deferred->output, &nbRects);
+	if (!region16_union_rects(&surface->invalidRegion, &surface->invalidRegion, rects, nbRects) ||
+	    !region16_copy(&deferred->output, &outside))
+		status = ERROR_NOT_ENOUGH_MEMORY;
+
+	region16_uninit(&outside);
+	return status;
+}
+
 /**
  * Function description
  *
@@ -133,6 +422,7 @@ static UINT gdi_ResetGraphics(RdpgfxClientContext* context,
 
 		memset(surface->data, 0xFF, (size_t)surface->scanline * surface->height);
 		region16_clear(&surface->invalidRegion);
+		gdi_deferred_clear(surface->deferred);
 	}
 
 	free(pSurfaceIds);
@@ -190,6 +480,14 @@ static UINT gdi_OutputUpdate(rdpGdi* gdi, gdiGfxSurface* surface)
 	const double sx = surface->outputTargetWidth / (double)surface->mappedWidth;
 	const double sy = surface->outputTargetHeight / (double)surface->mappedHeight;
 
+	/* Areas out of view are converted and copied once they scroll into the viewport */
+	RECTANGLE_16 visible = { 0 };
+	if (surface->deferred && gdi_surface_viewport(gdi, surface, &visible))
+	{
+		if (!gdi_split_region(&surface->invalidRegion, &visible, &surface->deferred->output))
+			return ERROR_NOT_ENOUGH_MEMORY;
+	}
+
 	if (!(rects = region16_rects(&surface->invalidRegion, &nbRects)) || !nbRects)
 		return CHANNEL_RC_OK;
 
@@ -373,15 +671,18 @@ static UINT gdi_SurfaceCommand_Uncompressed(rdpGdi* gdi, RdpgfxClientContext* co
 		return ERROR_INVALID_DATA;
 	}
 
-	if (!freerdp_image_copy_no_overlap(surface->data, surface->format, surface->scanline, cmd->left,
-	                                   cmd->top, cmd->width, cmd->height, cmd->data, cmd->format, 0,
-	                                   0, 0, NULL, FREERDP_FLIP_NONE))
-		return ERROR_INTERNAL_ERROR;
+	invalidRect = gdi_command_rect(cmd);
+	status = gdi_materialize(surface, &invalidRect, TRUE);
+	if (status != CHANNEL_RC_OK)
+		return status;
+
+	if (gdi_defer_command(gdi, context, surface, cmd))
+		return CHANNEL_RC_OK;
+
+	status = gdi_decode_Uncompressed(surface, cmd);
+	if (status != CHANNEL_RC_OK)
+		return status;
 
-	invalidRect.left = (UINT16)MIN(UINT16_MAX, cmd->left);
-	invalidRect.top = (UINT16)MIN(UINT16_MAX, cmd->top);
-	invalidRect.right = (UINT16)MIN(UINT16_MAX, cmd->right);
-	invalidRect.bottom = (UINT16)MIN(UINT16_MAX, cmd->bottom);
 	region16_union_rect(&(surface->invalidRegion), &(surface->invalidRegion), &invalidRect);
 	status = IFCALLRESULT(CHANNEL_RC_OK, context->UpdateSurfaceArea, context, surface->surfaceId, 1,
 	                      &invalidRect);
@@ -441,8 +742,11 @@ static UINT gdi_SurfaceCommand_RemoteFX(rdpGdi* gdi, RdpgfxClientContext* contex
 	if (status != CHANNEL_RC_OK)
 		goto fail;
 
-	for (UINT32 x = 0; x < nrRects; x++)
-		region16_union_rect(&surface->invalidRegion, &surface->invalidRegion, &rects[x]);
+	if (!region16_union_rects(&surface->invalidRegion, &surface->invalidRegion, rects, nrRects))
+	{
+		status = ERROR_NOT_ENOUGH_MEMORY;
+		goto fail;
+	}
 
 	status = gdi_interFrameUpdate(gdi, context);
 
@@ -514,7 +818,6 @@ static UINT gdi_SurfaceCommand_Planar(rdpGdi* gdi, RdpgfxClientContext* context,
                                       const RDPGFX_SURFACE_COMMAND* cmd)
 {
 	UINT status = CHANNEL_RC_OK;
-	BYTE* DstData = NULL;
 	gdiGfxSurface* surface = NULL;
 	RECTANGLE_16 invalidRect;
 	WINPR_ASSERT(gdi);
@@ -531,20 +834,21 @@ static UINT gdi_SurfaceCommand_Planar(rdpGdi* gdi, RdpgfxClientContext* context,
 		return ERROR_NOT_FOUND;
 	}
 
-	DstData = surface->data;
-
 	if (!is_within_surface(surface, cmd))
 		return ERROR_INVALID_DATA;
 
-	if (!planar_decompress(surface->codecs->planar, cmd->data, cmd->length, cmd->width, cmd->height,
-	                       DstData, surface->format, surface->scanline, cmd->left, cmd->top,
-	                       cmd->width, cmd->height, FALSE))
-		return ERROR_INTERNAL_ERROR;
+	invalidRect = gdi_command_rect(cmd);
+	status = gdi_materialize(surface, &invalidRect, TRUE);
+	if (status != CHANNEL_RC_OK)
+		return status;
+
+	if (gdi_defer_command(gdi, context, surface, cmd))
+		return CHANNEL_RC_OK;
+
+	status = gdi_decode_Planar(surface, cmd);
+	if (status != CHANNEL_RC_OK)
+		return status;
 
-	invalidRect.left = (UINT16)MIN(UINT16_MAX, cmd->left);
-	invalidRect.top = (UINT16)MIN(UINT16_MAX, cmd->top);
-	invalidRect.right = (UINT16)MIN(UINT16_MAX, cmd->right);
-	invalidRect.bottom = (UINT16)MIN(UINT16_MAX, cmd->bottom);
 	region16_union_rect(&(surface->invalidRegion), &(surface->invalidRegion), &invalidRect);
 	status = IFCALLRESULT(CHANNEL_RC_OK, context->UpdateSurfaceArea, context, surface->surfaceId, 1,
 	                      &invalidRect);
@@ -1008,8 +1312,11 @@ static UINT gdi_SurfaceCommand_Progressive(rdpGdi* gdi, RdpgfxClientContext* con
 	if (status != CHANNEL_RC_OK)
 		goto fail;
 
-	for (UINT32 x = 0; x < nrRects; x++)
-		region16_union_rect(&surface->invalidRegion, &surface->invalidRegion, &rects[x]);
+	if (!region16_union_rects(&surface->invalidRegion, &surface->invalidRegion, rects, nrRects))
+	{
+		region16_uninit(&invalidRegion);
+		return ERROR_NOT_ENOUGH_MEMORY;
+	}
 
 	region16_uninit(&invalidRegion);
 
@@ -1048,6 +1355,25 @@ static UINT gdi_SurfaceCommand(RdpgfxClientContext* context, const RDPGFX_SURFAC
 	dump_cmd(cmd, gdi->frameId);
 #endif
 
+	/* Only uncompressed and planar commands are deferred, the others decode on top of them */
+	if ((cmd->codecId != RDPGFX_CODECID_UNCOMPRESSED) && (cmd->codecId != RDPGFX_CODECID_PLANAR))
+	{
+		WINPR_ASSERT(context->GetSurfaceData);
+		gdiGfxSurface* surface = (gdiGfxSurface*)context->GetSurfaceData(
+		    context, (UINT16)MIN(UINT16_MAX, cmd->surfaceId));
+		const RECTANGLE_16 rect = gdi_command_rect(cmd);
+
+		/* Progressive commands carry no destination rectangle */
+		if (surface)
+			status = gdi_materialize(surface, rectangle_is_empty(&rect) ? NULL : &rect, FALSE);
+
+		if (status != CHANNEL_RC_OK)
+		{
+			LeaveCriticalSection(&context->mux);
+			return status;
+		}
+	}
+
 	switch (cmd->codecId)
 	{
 		case RDPGFX_CODECID_UNCOMPRESSED:
@@ -1183,6 +1509,15 @@ static UINT gdi_CreateSurface(RdpgfxClientContext* context,
 	memset(surface->data, 0xFF, (size_t)surface->scanline * surface->height);
 	region16_init(&surface->invalidRegion);
 
+	surface->deferred = gdi_deferred_new();
+	if (!surface->deferred)
+	{
+		region16_uninit(&surface->invalidRegion);
+		winpr_aligned_free(surface->data);
+		free(surface);
+		goto fail;
+	}
+
 	WINPR_ASSERT(context->SetSurfaceData);
 	rc = context->SetSurfaceData(context, surface->surfaceId, (void*)surface);
 fail:
@@ -1217,6 +1552,7 @@ static UINT gdi_DeleteSurface(RdpgfxClientContext* context,
 		h264_context_free(surface->h264);
 #endif
 		region16_uninit(&surface->invalidRegion);
+		gdi_deferred_free(surface->deferred);
 		codecs = surface->codecs;
 		winpr_aligned_free(surface->data);
 		free(surface);
@@ -1299,6 +1635,9 @@ static UINT gdi_SolidFill(RdpgfxClientContext* context, const RDPGFX_SOLID_FILL_
 		if (!intersect_rect(rect, surface, &invalidRect))
 			goto fail;
 
+		if (gdi_materialize(surface, &invalidRect, TRUE) != CHANNEL_RC_OK)
+			goto fail;
+
 		const UINT32 nWidth = invalidRect.right - invalidRect.left;
 		const UINT32 nHeight = invalidRect.bottom - invalidRect.top;
 
@@ -1363,6 +1702,9 @@ static UINT gdi_SurfaceToSurface(RdpgfxClientContext* context,
 	nWidth = rectSrc->right - rectSrc->left;
 	nHeight = rectSrc->bottom - rectSrc->top;
 
+	if (gdi_materialize(surfaceSrc, rectSrc, FALSE) != CHANNEL_RC_OK)
+		goto fail;
+
 	for (UINT16 index = 0; index < surfaceToSurface->destPtsCount; index++)
 	{
 		const RDPGFX_POINT16* destPt = &surfaceToSurface->destPts[index];
@@ -1372,6 +1714,9 @@ static UINT gdi_SurfaceToSurface(RdpgfxClientContext* context,
 		if (!is_rect_valid(&rect, surfaceDst->width, surfaceDst->height))
 			goto fail;
 
+		if (gdi_materialize(surfaceDst, &rect, TRUE) != CHANNEL_RC_OK)
+			goto fail;
+
 		if (!freerdp_image_copy(surfaceDst->data, surfaceDst->format, surfaceDst->scanline,
 		                        destPt->x, destPt->y, nWidth, nHeight, surfaceSrc->data,
 		                        surfaceSrc->format, surfaceSrc->scanline, rectSrc->left,
@@ -1453,6 +1798,9 @@ static UINT gdi_SurfaceToCache(RdpgfxClientContext* context,
 	if (!is_rect_valid(rect, surface->width, surface->height))
 		goto fail;
 
+	if (gdi_materialize(surface, rect, FALSE) != CHANNEL_RC_OK)
+		goto fail;
+
 	cacheEntry = gdi_GfxCacheEntryNew(surfaceToCache->cacheKey, (UINT32)(rect->right - rect->left),
 	                                  (UINT32)(rect->bottom - rect->top), surface->format);
 
@@ -1519,6 +1867,9 @@ static UINT gdi_CacheToSurface(RdpgfxClientContext* context,
 		if (!is_rect_valid(&rect, surface->width, surface->height))
 			goto fail;
 
+		if (gdi_materialize(surface, &rect, TRUE) != CHANNEL_RC_OK)
+			goto fail;
+
 		if (!freerdp_image_copy_no_overlap(surface->data, surface->format, surface->scanline,
 		                                   destPt->x, destPt->y, cacheEntry->width,
 		                                   cacheEntry->height, cacheEntry->data, cacheEntry->format,
@@ -1839,6 +2190,55 @@ fail:
 	return rc;
 }
 
+BOOL gdi_set_viewport(rdpGdi* gdi, const RECTANGLE_16* viewport)
+{
+	UINT status = CHANNEL_RC_OK;
+	RECTANGLE_16 rect = { 0 };
+
+	if (!gdi)
+		return FALSE;
+
+	if (viewport && !rectangle_is_empty(viewport))
+		rect = *viewport;
+
+	RdpgfxClientContext* context = gdi->gfx;
+	if (!context)
+	{
+		gdi->viewport = rect;
+		return TRUE;
+	}
+
+	EnterCriticalSection(&context->mux);
+	const BOOL changed = !rectangles_equal(&gdi->viewport, &rect);
+	gdi->viewport = rect;
+
+	if (changed && context->GetSurfaceIds)
+	{
+		UINT16 count = 0;
+		UINT16* pSurfaceIds = NULL;
+
+		context->GetSurfaceIds(context, &pSurfaceIds, &count);
+		for (UINT32 index = 0; (index < count) && (status == CHANNEL_RC_OK); index++)
+		{
+			WINPR_ASSERT(context->GetSurfaceData);
+			gdiGfxSurface* surface =
+			    (gdiGfxSurface*)context->GetSurfaceData(context, pSurfaceIds[index]);
+
+			if (surface)
+				status = gdi_surface_viewport_changed(gdi, surface);
+		}
+		free(pSurfaceIds);
+	}
+	LeaveCriticalSection(&context->mux);
+
+	if (changed && (status == CHANNEL_RC_OK))
+		status = gdi_interFrameUpdate(gdi, context);
+
+	if (status != CHANNEL_RC_OK)
+		WLog_Print(gdi->log, WLOG_WARN, "viewport update failed with %" PRIu32, status);
+	return status == CHANNEL_RC_OK;
+}
+
 BOOL gdi_graphics_pipeline_init(rdpGdi* gdi, RdpgfxClientContext* gfx)
 {
 	return gdi_graphics_pipeline_init_ex(gdi, gfx, NULL, NULL, NULL);
@@ -1890,6 +2290,8 @@ BOOL gdi_graphics_pipeline_init_ex(rdpGdi* gdi, RdpgfxClientContext* gfx,
 		gfx->codecs = freerdp_client_codecs_new(flags);
 		if (!gfx->codecs)
 			return FALSE;
+		gfx->codecs->CallbackEnvironment =
+		    freerdp_settings_get_pointer_writable(settings, FreeRDP_CodecCallbackEnvironment);
 		if (!freerdp_client_codecs_prepare(gfx->codecs, FREERDP_CODEC_ALL, w, h))
 			return FALSE;
 	}
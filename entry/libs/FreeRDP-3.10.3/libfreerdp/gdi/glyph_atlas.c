@@ -0,0 +1,499 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * GDI Glyph Atlas
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <winpr/assert.h>
+#include <winpr/crt.h>
+
+#include <freerdp/log.h>
+#include <freerdp/codec/color.h>
+#include <freerdp/gdi/gdi.h>
+#include <freerdp/gdi/region.h>
+
+#include "clipping.h"
+#include "glyph_atlas.h"
+#include "../core/simd.h"
+
+/* Both are part of the base instruction set of the targets that define them, no runtime
+ * detection needed */
+#if defined(SSE_AVX_INTRINSICS_ENABLED) && defined(__SSE2__)
+#include <emmintrin.h>
+#define GDI_GLYPH_SSE2
+#elif defined(NEON_INTRINSICS_ENABLED)
+#include <arm_neon.h>
+#define GDI_GLYPH_NEON
+#endif
+
+#define TAG FREERDP_TAG("gdi.glyph")
+
+/* A page holds a few hundred glyphs of common font sizes, larger glyphs get a page of their own */
+#define GDI_GLYPH_PAGE_SIZE 256
+#define GDI_GLYPH_PAGE_MAX_GLYPH 64
+
+/* Shelf heights are rounded up so glyphs of similar height share a shelf */
+#define GDI_GLYPH_SHELF_ALIGN 4
+
+/* Pages are reference counted by the atlas and every glyph placed on them, a glyph may outlive
+ * the atlas since the glyph cache is released after the gdi. */
+struct S_GDI_GLYPH_PAGE
+{
+	UINT32 refs;
+	UINT32 width;
+	UINT32 height;
+	UINT32 shelfX;
+	UINT32 shelfY;
+	UINT32 shelfHeight;
+	BYTE* data;
+};
+
+typedef struct
+{
+	const BYTE* mask;
+	UINT32 stride;
+	INT32 x;
+	INT32 y;
+	INT32 width;
+	INT32 height;
+} GDI_GLYPH_RUN_ITEM;
+
+struct S_GDI_GLYPH_ATLAS
+{
+	GDI_GLYPH_PAGE* page;
+
+	HGDI_DC hdc;
+	BOOL active;
+	BOOL fillCells;
+	UINT32 textColor;
+	UINT32 bkColor;
+	GDI_GLYPH_RUN_ITEM* items;
+	size_t count;
+	size_t capacity;
+
+	/* bounding box of everything the run touched, right and bottom exclusive */
+	INT32 left;
+	INT32 top;
+	INT32 right;
+	INT32 bottom;
+};
+
+static GDI_GLYPH_PAGE* gdi_glyph_page_new(UINT32 width, UINT32 height)
+{
+	GDI_GLYPH_PAGE* page = calloc(1, sizeof(GDI_GLYPH_PAGE) + 1ull * width * height);
+	if (!page)
+		return NULL;
+
+	page->refs = 1;
+	page->width = width;
+	page->height = height;
+	page->data = (BYTE*)&page[1];
+	return page;
+}
+
+static void gdi_glyph_page_release(GDI_GLYPH_PAGE* page)
+{
+	if (!page)
+		return;
+
+	WINPR_ASSERT(page->refs > 0);
+	page->refs--;
+	if (page->refs == 0)
+		free(page);
+}
+
+static BYTE* gdi_glyph_page_alloc(GDI_GLYPH_PAGE* page, UINT32 width, UINT32 height)
+{
+	WINPR_ASSERT(page);
+
+	const UINT32 shelfHeight =
+	    (height + GDI_GLYPH_SHELF_ALIGN - 1) / GDI_GLYPH_SHELF_ALIGN * GDI_GLYPH_SHELF_ALIGN;
+
+	if ((page->shelfX + width > page->width) ||
+	    ((page->shelfX > 0) && (shelfHeight > page->shelfHeight)))
+	{
+		page->shelfY += page->shelfHeight;
+		page->shelfX = 0;
+		page->shelfHeight = 0;
+	}
+
+	if ((width > page->width) || (page->shelfY + shelfHeight > page->height))
+		return NULL;
+
+	BYTE* data = &page->data[1ull * page->shelfY * page->width + page->shelfX];
+	page->shelfX += width;
+	page->shelfHeight = MAX(page->shelfHeight, shelfHeight);
+	return data;
+}
+
+GDI_GLYPH_ATLAS* gdi_glyph_atlas_new(void)
+{
+	GDI_GLYPH_ATLAS* atlas = calloc(1, sizeof(GDI_GLYPH_ATLAS));
+	if (!atlas)
+		return NULL;
+
+	atlas->capacity = 64;
+	atlas->items = calloc(atlas->capacity, sizeof(GDI_GLYPH_RUN_ITEM));
+	if (!atlas->items)
+	{
+		gdi_glyph_atlas_free(atlas);
+		return NULL;
+	}
+	return atlas;
+}
+
+void gdi_glyph_atlas_free(GDI_GLYPH_ATLAS* atlas)
+{
+	if (!atlas)
+		return;
+
+	gdi_glyph_page_release(atlas->page);
+	free(atlas->items);
+	free(atlas);
+}
+
+BOOL gdi_glyph_atlas_add(GDI_GLYPH_ATLAS* atlas, UINT32 width, UINT32 height, const BYTE* aj,
+                         size_t cb, GDI_GLYPH_MASK* mask)
+{
+	GDI_GLYPH_PAGE* page = NULL;
+	BYTE* data = NULL;
+
+	WINPR_ASSERT(mask);
+	WINPR_ASSERT(aj || (cb == 0));
+
+	const GDI_GLYPH_MASK empty = { 0 };
+	*mask = empty;
+
+	if ((width == 0) || (height == 0))
+		return TRUE;
+
+	if (!atlas || (width > GDI_GLYPH_PAGE_MAX_GLYPH) || (height > GDI_GLYPH_PAGE_MAX_GLYPH))
+	{
+		page = gdi_glyph_page_new(width, height);
+		if (!page)
+			return FALSE;
+		data = page->data;
+	}
+	else
+	{
+		/* every glyph placed on the page is gone, start over */
+		if (atlas->page && (atlas->page->refs == 1))
+		{
+			atlas->page->shelfX = 0;
+			atlas->page->shelfY = 0;
+			atlas->page->shelfHeight = 0;
+		}
+
+		if (atlas->page)
+			data = gdi_glyph_page_alloc(atlas->page, width, height);
+
+		if (!data)
+		{
+			gdi_glyph_page_release(atlas->page);
+			atlas->page = gdi_glyph_page_new(GDI_GLYPH_PAGE_SIZE, GDI_GLYPH_PAGE_SIZE);
+			if (!atlas->page)
+				return FALSE;
+
+			data = gdi_glyph_page_alloc(atlas->page, width, height);
+			WINPR_ASSERT(data);
+		}
+
+		page = atlas->page;
+		page->refs++;
+	}
+
+	const size_t scanline = (width + 7) / 8;
+	for (UINT32 y = 0; y < height; y++)
+	{
+		BYTE* dst = &data[1ull * y * page->width];
+		const size_t row = y * scanline;
+
+		for (UINT32 x = 0; x < width; x++)
+		{
+			const size_t index = row + x / 8;
+			dst[x] = ((index < cb) && ((aj[index] & (0x80 >> (x % 8))) != 0)) ? 0xFF : 0x00;
+		}
+	}
+
+	mask->page = page;
+	mask->data = data;
+	mask->stride = page->width;
+	mask->width = width;
+	mask->height = height;
+	return TRUE;
+}
+
+void gdi_glyph_mask_release(GDI_GLYPH_MASK* mask)
+{
+	if (!mask)
+		return;
+
+	gdi_glyph_page_release(mask->page);
+	mask->page = NULL;
+	mask->data = NULL;
+}
+
+BOOL gdi_glyph_run_begin(GDI_GLYPH_ATLAS* atlas, HGDI_DC hdc, UINT32 textColor, UINT32 bkColor,
+                         BOOL fillCells)
+{
+	BOOL rc = TRUE;
+
+	if (!atlas || !hdc)
+		return FALSE;
+
+	if (atlas->active)
+	{
+		WLog_WARN(TAG, "glyph run started while another one is active");
+		rc = gdi_glyph_run_end(atlas);
+	}
+
+	atlas->hdc = hdc;
+	atlas->active = TRUE;
+	atlas->fillCells = fillCells;
+	atlas->textColor = textColor;
+	atlas->bkColor = bkColor;
+	atlas->count = 0;
+	atlas->left = atlas->top = INT32_MAX;
+	atlas->right = atlas->bottom = INT32_MIN;
+	return rc;
+}
+
+BOOL gdi_glyph_run_active(const GDI_GLYPH_ATLAS* atlas)
+{
+	return atlas && atlas->active;
+}
+
+void gdi_glyph_run_invalidate(GDI_GLYPH_ATLAS* atlas, INT32 x, INT32 y, INT32 width,
+                              INT32 height)
+{
+	if (!atlas || !atlas->active || (width <= 0) || (height <= 0))
+		return;
+
+	if (!gdi_ClipCoords(atlas->hdc, &x, &y, &width, &height, NULL, NULL))
+		return;
+
+	atlas->left = MIN(atlas->left, x);
+	atlas->top = MIN(atlas->top, y);
+	atlas->right = MAX(atlas->right, x + width);
+	atlas->bottom = MAX(atlas->bottom, y + height);
+}
+
+BOOL gdi_glyph_run_add(GDI_GLYPH_ATLAS* atlas, const GDI_GLYPH_MASK* mask, INT32 x, INT32 y,
+                       INT32 width, INT32 height, INT32 sx, INT32 sy)
+{
+	if (!atlas || !atlas->active || !mask)
+		return FALSE;
+
+	if (!mask->data || (sx < 0) || (sy < 0) || ((UINT32)sx >= mask->width) ||
+	    ((UINT32)sy >= mask->height))
+		return TRUE;
+
+	width = MIN(width, (INT32)mask->width - sx);
+	height = MIN(height, (INT32)mask->height - sy);
+
+	/* gdi_ClipCoords clamps negative origins without moving the source */
+	if (x < 0)
+	{
+		sx -= x;
+		width += x;
+		x = 0;
+	}
+
+	if (y < 0)
+	{
+		sy -= y;
+		height += y;
+		y = 0;
+	}
+
+	if ((width <= 0) || (height <= 0))
+		return TRUE;
+
+	if (!gdi_ClipCoords(atlas->hdc, &x, &y, &width, &height, &sx, &sy))
+		return TRUE;
+
+	if (atlas->count == atlas->capacity)
+	{
+		const size_t capacity = atlas->capacity * 2;
+		GDI_GLYPH_RUN_ITEM* items = realloc(atlas->items, capacity * sizeof(GDI_GLYPH_RUN_ITEM));
+		if (!items)
+			return FALSE;
+
+		atlas->items = items;
+		atlas->capacity = capacity;
+	}
+
+	GDI_GLYPH_RUN_ITEM* item = &atlas->items[atlas->count++];
+	item->mask = &mask->data[1ull * (UINT32)sy * mask->stride + (UINT32)sx];
+	item->stride = mask->stride;
+	item->x = x;
+	item->y = y;
+	item->width = width;
+	item->height = height;
+
+	atlas->left = MIN(atlas->left, x);
+	atlas->top = MIN(atlas->top, y);
+	atlas->right = MAX(atlas->right, x + width);
+	atlas->bottom = MAX(atlas->bottom, y + height);
+	return TRUE;
+}
+
+/* Write \b color wherever \b mask is set, 16 pixels at a time skipping empty blocks */
+static void gdi_glyph_blend32(BYTE* WINPR_RESTRICT dst, const BYTE* WINPR_RESTRICT mask,
+                              size_t width, UINT32 color)
+{
+	size_t x = 0;
+
+#if defined(GDI_GLYPH_SSE2)
+	const __m128i c = _mm_set1_epi32((int)color);
+
+	for (; x + 16 <= width; x += 16)
+	{
+		const __m128i m = _mm_loadu_si128((const __m128i*)&mask[x]);
+		if (_mm_movemask_epi8(m) == 0)
+			continue;
+
+		const __m128i lo = _mm_unpacklo_epi8(m, m);
+		const __m128i hi = _mm_unpackhi_epi8(m, m);
+		const __m128i m32[4] = { _mm_unpacklo_epi16(lo, lo), _mm_unpackhi_epi16(lo, lo),
+			                     _mm_unpacklo_epi16(hi, hi), _mm_unpackhi_epi16(hi, hi) };
+
+		for (size_t n = 0; n < 4; n++)
+		{
+			__m128i* p = (__m128i*)&dst[4ull * x + 16ull * n];
+			const __m128i v = _mm_loadu_si128(p);
+			_mm_storeu_si128(p, _mm_or_si128(_mm_and_si128(m32[n], c),
+			                                 _mm_andnot_si128(m32[n], v)));
+		}
+	}
+#elif defined(GDI_GLYPH_NEON)
+	const uint32x4_t c = vdupq_n_u32(color);
+
+	for (; x + 16 <= width; x += 16)
+	{
+		const uint8x16_t m = vld1q_u8(&mask[x]);
+		const uint8x8_t any = vorr_u8(vget_low_u8(m), vget_high_u8(m));
+		if (vget_lane_u64(vreinterpret_u64_u8(any), 0) == 0)
+			continue;
+
+		const uint8x16x2_t m16 = vzipq_u8(m, m);
+		const uint16x8_t l16 = vreinterpretq_u16_u8(m16.val[0]);
+		const uint16x8_t h16 = vreinterpretq_u16_u8(m16.val[1]);
+		const uint16x8x2_t lo = vzipq_u16(l16, l16);
+		const uint16x8x2_t hi = vzipq_u16(h16, h16);
+		const uint32x4_t m32[4] = {
+			vreinterpretq_u32_u16(lo.val[0]), vreinterpretq_u32_u16(lo.val[1]),
+			vreinterpretq_u32_u16(hi.val[0]), vreinterpretq_u32_u16(hi.val[1])
+		};
+
+		for (size_t n = 0; n < 4; n++)
+		{
+			BYTE* p = &dst[4ull * x + 16ull * n];
+			const uint32x4_t v = vreinterpretq_u32_u8(vld1q_u8(p));
+			vst1q_u8(p, vreinterpretq_u8_u32(vbslq_u32(m32[n], c, v)));
+		}
+	}
+#endif
+
+	for (; x < width; x++)
+	{
+		if (mask[x])
+			memcpy(&dst[4ull * x], &color, sizeof(color));
+	}
+}
+
+static void gdi_glyph_blend(BYTE* WINPR_RESTRICT dst, const BYTE* WINPR_RESTRICT mask,
+                            size_t width, const BYTE* WINPR_RESTRICT pixel, size_t bpp)
+{
+	if (bpp == 4)
+	{
+		UINT32 color = 0;
+		memcpy(&color, pixel, sizeof(color));
+		gdi_glyph_blend32(dst, mask, width, color);
+		return;
+	}
+
+	for (size_t x = 0; x < width; x++)
+	{
+		if (mask[x])
+			memcpy(&dst[x * bpp], pixel, bpp);
+	}
+}
+
+static void gdi_glyph_fill(BYTE* WINPR_RESTRICT dst, size_t stride, size_t width, size_t height,
+                           const BYTE* WINPR_RESTRICT pixel, size_t bpp)
+{
+	for (size_t x = 0; x < width; x++)
+		memcpy(&dst[x * bpp], pixel, bpp);
+
+	for (size_t y = 1; y < height; y++)
+		memcpy(&dst[y * stride], dst, width * bpp);
+}
+
+BOOL gdi_glyph_run_end(GDI_GLYPH_ATLAS* atlas)
+{
+	BYTE text[4] = { 0 };
+	BYTE bk[4] = { 0 };
+
+	if (!atlas)
+		return FALSE;
+
+	if (!atlas->active)
+		return TRUE;
+
+	atlas->active = FALSE;
+
+	HGDI_DC hdc = atlas->hdc;
+	WINPR_ASSERT(hdc);
+
+	const HGDI_BITMAP bmp = (HGDI_BITMAP)hdc->selectedObject;
+	const size_t bpp = FreeRDPGetBytesPerPixel(hdc->format);
+	if (!bmp || !bmp->data || (bpp == 0) || (bpp > sizeof(text)))
+		return FALSE;
+
+	if (!FreeRDPWriteColor(text, hdc->format, atlas->textColor) ||
+	    !FreeRDPWriteColor(bk, hdc->format, atlas->bkColor))
+		return FALSE;
+
+	/* all backgrounds go first so overlapping cells do not erase neighbouring glyphs */
+	if (atlas->fillCells)
+	{
+		for (size_t n = 0; n < atlas->count; n++)
+		{
+			const GDI_GLYPH_RUN_ITEM* item = &atlas->items[n];
+			BYTE* dst = &bmp->data[1ull * item->y * bmp->scanline + item->x * bpp];
+			gdi_glyph_fill(dst, bmp->scanline, (size_t)item->width, (size_t)item->height, bk,
+			               bpp);
+		}
+	}
+
+	for (size_t n = 0; n < atlas->count; n++)
+	{
+		const GDI_GLYPH_RUN_ITEM* item = &atlas->items[n];
+		BYTE* dst = &bmp->data[1ull * item->y * bmp->scanline + item->x * bpp];
+
+		for (INT32 y = 0; y < item->height; y++)
+			gdi_glyph_blend(&dst[1ull * y * bmp->scanline], &item->mask[1ull * y * item->stride],
+			                (size_t)item->width, text, bpp);
+	}
+
+	atlas->count = 0;
+	if ((atlas->right <= atlas->left) || (atlas->bottom <= atlas->top))
+		return TRUE;
+
+	return gdi_InvalidateRegion(hdc, atlas->left, atlas->top, atlas->right - atlas->left,
+	                            atlas->bottom - atlas->top);
+}
@@ -0,0 +1,77 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * GDI Glyph Atlas
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_GDI_GLYPH_ATLAS_H
+#define FREERDP_LIB_GDI_GLYPH_ATLAS_H
+
+#include <winpr/wtypes.h>
+
+#include <freerdp/api.h>
+#include <freerdp/gdi/gdi.h>
+
+typedef struct S_GDI_GLYPH_PAGE GDI_GLYPH_PAGE;
+
+/** One byte per pixel coverage mask (0x00 or 0xFF) of a glyph inside an atlas page */
+typedef struct
+{
+	GDI_GLYPH_PAGE* page;
+	const BYTE* data;
+	UINT32 stride;
+	UINT32 width;
+	UINT32 height;
+} GDI_GLYPH_MASK;
+
+FREERDP_LOCAL void gdi_glyph_atlas_free(GDI_GLYPH_ATLAS* atlas);
+
+WINPR_ATTR_MALLOC(gdi_glyph_atlas_free, 1)
+FREERDP_LOCAL GDI_GLYPH_ATLAS* gdi_glyph_atlas_new(void);
+
+/** @brief Expand a 1 bpp glyph bitmap into the atlas
+ *
+ *  The mask keeps a reference on its page, it stays valid after the atlas is gone and must be
+ *  released with gdi_glyph_mask_release. Bits beyond \b cb bytes of \b aj read as unset.
+ */
+FREERDP_LOCAL BOOL gdi_glyph_atlas_add(GDI_GLYPH_ATLAS* atlas, UINT32 width, UINT32 height,
+                                       const BYTE* aj, size_t cb, GDI_GLYPH_MASK* mask);
+
+FREERDP_LOCAL void gdi_glyph_mask_release(GDI_GLYPH_MASK* mask);
+
+/** @brief Start collecting the glyphs of a text run drawn to \b hdc
+ *
+ *  \b textColor and \b bkColor are in the format of \b hdc. With \b fillCells the cell of every
+ *  glyph is filled with \b bkColor before any glyph is drawn.
+ */
+FREERDP_LOCAL BOOL gdi_glyph_run_begin(GDI_GLYPH_ATLAS* atlas, HGDI_DC hdc, UINT32 textColor,
+                                       UINT32 bkColor, BOOL fillCells);
+
+FREERDP_LOCAL BOOL gdi_glyph_run_active(const GDI_GLYPH_ATLAS* atlas);
+
+/** @brief Queue the part of \b mask starting at \b sx / \b sy for \b x / \b y
+ *
+ *  The cell is clipped to the destination when queued.
+ */
+FREERDP_LOCAL BOOL gdi_glyph_run_add(GDI_GLYPH_ATLAS* atlas, const GDI_GLYPH_MASK* mask, INT32 x,
+                                     INT32 y, INT32 width, INT32 height, INT32 sx, INT32 sy);
+
+/** @brief Add \b x / \b y / \b width / \b height to the region invalidated by the run */
+FREERDP_LOCAL void gdi_glyph_run_invalidate(GDI_GLYPH_ATLAS* atlas, INT32 x, INT32 y,
+                                            INT32 width, INT32 height);
+
+/** @brief Draw all queued glyphs and invalidate their bounding box once */
+FREERDP_LOCAL BOOL gdi_glyph_run_end(GDI_GLYPH_ATLAS* atlas);
+
+#endif /* FREERDP_LIB_GDI_GLYPH_ATLAS_H */
@@ -34,6 +34,7 @@
 #include "drawing.h"
 #include "brush.h"
 #include "graphics.h"
+#include "glyph_atlas.h"
 
 #define TAG FREERDP_TAG("gdi")
 /* Bitmap Class */
@@ -262,53 +263,35 @@ static BOOL gdi_Bitmap_SetSurface(rdpContext* context, rdpBitmap* bitmap, BOOL p
 }
 
 /* Glyph Class */
+
+/* The glyph bitmap lives in the glyph atlas, the device context and bitmap of the public
+ * gdiGlyph are not used. */
+typedef struct
+{
+	gdiGlyph glyph;
+	GDI_GLYPH_MASK mask;
+} gdiAtlasGlyph;
+
 static BOOL gdi_Glyph_New(rdpContext* context, rdpGlyph* glyph)
 {
-	BYTE* data = NULL;
-	gdiGlyph* gdi_glyph = NULL;
+	gdiAtlasGlyph* gdi_glyph = NULL;
 
 	if (!context || !glyph)
 		return FALSE;
 
-	gdi_glyph = (gdiGlyph*)glyph;
-	gdi_glyph->hdc = gdi_GetDC();
-
-	if (!gdi_glyph->hdc)
-		return FALSE;
-
-	gdi_glyph->hdc->format = PIXEL_FORMAT_MONO;
-	data = freerdp_glyph_convert(glyph->cx, glyph->cy, glyph->aj);
-
-	if (!data)
-	{
-		gdi_DeleteDC(gdi_glyph->hdc);
-		return FALSE;
-	}
-
-	gdi_glyph->bitmap = gdi_CreateBitmap(glyph->cx, glyph->cy, PIXEL_FORMAT_MONO, data);
-
-	if (!gdi_glyph->bitmap)
-	{
-		gdi_DeleteDC(gdi_glyph->hdc);
-		winpr_aligned_free(data);
-		return FALSE;
-	}
-
-	gdi_SelectObject(gdi_glyph->hdc, (HGDIOBJECT)gdi_glyph->bitmap);
-	gdi_glyph->org_bitmap = NULL;
-	return TRUE;
+	gdi_glyph = (gdiAtlasGlyph*)glyph;
+	return gdi_glyph_atlas_add(context->gdi ? context->gdi->glyphs : NULL, glyph->cx, glyph->cy,
+	                           glyph->aj, glyph->cb, &gdi_glyph->mask);
 }
 
 static void gdi_Glyph_Free(rdpContext* context, rdpGlyph* glyph)
 {
-	gdiGlyph* gdi_glyph = NULL;
-	gdi_glyph = (gdiGlyph*)glyph;
+	gdiAtlasGlyph* gdi_glyph = NULL;
+	gdi_glyph = (gdiAtlasGlyph*)glyph;
 
 	if (gdi_glyph)
 	{
-		gdi_SelectObject(gdi_glyph->hdc, (HGDIOBJECT)gdi_glyph->org_bitmap);
-		gdi_DeleteObject((HGDIOBJECT)gdi_glyph->bitmap);
-		gdi_DeleteDC(gdi_glyph->hdc);
+		gdi_glyph_mask_release(&gdi_glyph->mask);
 		free(glyph->aj);
 		free(glyph);
 	}
@@ -317,55 +300,35 @@ static void gdi_Glyph_Free(rdpContext* context, rdpGlyph* glyph)
 static BOOL gdi_Glyph_Draw(rdpContext* context, const rdpGlyph* glyph, INT32 x, INT32 y, INT32 w,
                            INT32 h, INT32 sx, INT32 sy, BOOL fOpRedundant)
 {
-	const gdiGlyph* gdi_glyph = NULL;
+	const gdiAtlasGlyph* gdi_glyph = NULL;
 	rdpGdi* gdi = NULL;
-	HGDI_BRUSH brush = NULL;
-	BOOL rc = FALSE;
+	HGDI_DC hdc = NULL;
 
-	if (!context || !glyph)
+	if (!context || !context->gdi || !glyph)
 		return FALSE;
 
 	gdi = context->gdi;
-	gdi_glyph = (const gdiGlyph*)glyph;
-
-	if (!fOpRedundant)
-	{
-		GDI_RECT rect = { 0 };
-
-		if (x > 0)
-			rect.left = x;
+	gdi_glyph = (const gdiAtlasGlyph*)glyph;
 
-		if (y > 0)
-			rect.top = y;
-
-		if (x + w > 0)
-			rect.right = x + w - 1;
-
-		if (y + h > 0)
-			rect.bottom = y + h - 1;
+	if (!gdi->drawing || !gdi->drawing->hdc)
+		return FALSE;
 
-		if ((rect.left < rect.right) && (rect.top < rect.bottom))
-		{
-			brush = gdi_CreateSolidBrush(gdi->drawing->hdc->bkColor);
+	if (gdi_glyph_run_active(gdi->glyphs))
+		return gdi_glyph_run_add(gdi->glyphs, &gdi_glyph->mask, x, y, w, h, sx, sy);
 
-			if (!brush)
-				return FALSE;
+	/* Drawn outside of BeginDraw / EndDraw, the glyph is a run of its own */
+	hdc = gdi->drawing->hdc;
 
-			gdi_FillRect(gdi->drawing->hdc, &rect, brush);
-			gdi_DeleteObject((HGDIOBJECT)brush);
-		}
-	}
-
-	brush = gdi_CreateSolidBrush(gdi->drawing->hdc->textColor);
+	if (!gdi_glyph_run_begin(gdi->glyphs, hdc, hdc->textColor, hdc->bkColor, !fOpRedundant))
+		return FALSE;
 
-	if (!brush)
+	if (!gdi_glyph_run_add(gdi->glyphs, &gdi_glyph->mask, x, y, w, h, sx, sy))
+	{
+		(void)gdi_glyph_run_end(gdi->glyphs);
 		return FALSE;
+	}
 
-	gdi_SelectObject(gdi->drawing->hdc, (HGDIOBJECT)brush);
-	rc = gdi_BitBlt(gdi->drawing->hdc, x, y, w, h, gdi_glyph->hdc, sx, sy, GDI_GLYPH_ORDER,
-	                &context->gdi->palette);
-	gdi_DeleteObject((HGDIOBJECT)brush);
-	return rc;
+	return gdi_glyph_run_end(gdi->glyphs);
 }
 
 static BOOL gdi_Glyph_BeginDraw(rdpContext* context, INT32 x, INT32 y, INT32 width, INT32 height,
@@ -381,41 +344,48 @@ static BOOL gdi_Glyph_BeginDraw(rdpContext* context, INT32 x, INT32 y, INT32 wid
 	if (!gdi->drawing || !gdi->drawing->hdc)
 		return FALSE;
 
+	/* The colors are needed for the glyphs even if the background is not drawn */
+	if (!gdi_decode_color(gdi, bgcolor, &bgcolor, NULL))
+		return FALSE;
+
+	if (!gdi_decode_color(gdi, fgcolor, &fgcolor, NULL))
+		return FALSE;
+
+	gdi_SetTextColor(gdi->drawing->hdc, bgcolor);
+	gdi_SetBkColor(gdi->drawing->hdc, fgcolor);
+
+	if (!gdi_glyph_run_begin(gdi->glyphs, gdi->drawing->hdc, bgcolor, fgcolor, !fOpRedundant))
+		return FALSE;
+
 	if (!fOpRedundant)
 	{
-		if (!gdi_decode_color(gdi, bgcolor, &bgcolor, NULL))
-			return FALSE;
+		GDI_RECT rect = { 0 };
+		HGDI_BRUSH brush = gdi_CreateSolidBrush(fgcolor);
 
-		if (!gdi_decode_color(gdi, fgcolor, &fgcolor, NULL))
+		if (!brush)
+		{
+			(void)gdi_glyph_run_end(gdi->glyphs);
 			return FALSE;
+		}
 
 		gdi_SetClipRgn(gdi->drawing->hdc, x, y, width, height);
-		gdi_SetTextColor(gdi->drawing->hdc, bgcolor);
-		gdi_SetBkColor(gdi->drawing->hdc, fgcolor);
-
-		if (1)
-		{
-			GDI_RECT rect = { 0 };
-			HGDI_BRUSH brush = gdi_CreateSolidBrush(fgcolor);
 
-			if (!brush)
-				return FALSE;
-
-			if (x > 0)
-				rect.left = x;
-
-			if (y > 0)
-				rect.top = y;
+		if (x > 0)
+			rect.left = x;
 
-			rect.right = x + width - 1;
-			rect.bottom = y + height - 1;
+		if (y > 0)
+			rect.top = y;
 
-			if ((x + width > rect.left) && (y + height > rect.top))
-				gdi_FillRect(gdi->drawing->hdc, &rect, brush);
+		rect.right = x + width - 1;
+		rect.bottom = y + height - 1;
 
-			gdi_DeleteObject((HGDIOBJECT)brush);
+		if ((x + width > rect.left) && (y + height > rect.top))
+		{
+			gdi_FillRect(gdi->drawing->hdc, &rect, brush);
+			gdi_glyph_run_invalidate(gdi->glyphs, x, y, width, height);
 		}
 
+		gdi_DeleteObject((HGDIOBJECT)brush);
 		return gdi_SetNullClipRgn(gdi->drawing->hdc);
 	}
 
@@ -426,6 +396,7 @@ static BOOL gdi_Glyph_EndDraw(rdpContext* context, INT32 x, INT32 y, INT32 width
                               UINT32 bgcolor, UINT32 fgcolor)
 {
 	rdpGdi* gdi = NULL;
+	BOOL rc = FALSE;
 
 	if (!context || !context->gdi)
 		return FALSE;
@@ -435,8 +406,9 @@ static BOOL gdi_Glyph_EndDraw(rdpContext* context, INT32 x, INT32 y, INT32 width
 	if (!gdi->drawing || !gdi->drawing->hdc)
 		return FALSE;
 
+	rc = gdi_glyph_run_end(gdi->glyphs);
 	gdi_SetNullClipRgn(gdi->drawing->hdc);
-	return TRUE;
+	return rc;
 }
 
 /* Graphics Module */
@@ -451,7 +423,7 @@ BOOL gdi_register_graphics(rdpGraphics* graphics)
 	bitmap.Decompress = gdi_Bitmap_Decompress;
 	bitmap.SetSurface = gdi_Bitmap_SetSurface;
 	graphics_register_bitmap(graphics, &bitmap);
-	glyph.size = sizeof(gdiGlyph);
+	glyph.size = sizeof(gdiAtlasGlyph);
 	glyph.New = gdi_Glyph_New;
 	glyph.Free = gdi_Glyph_Free;
 	glyph.Draw = gdi_Glyph_Draw;
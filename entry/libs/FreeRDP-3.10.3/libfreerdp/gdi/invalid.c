@@ -0,0 +1,265 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * GDI Invalid Tile Grid
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <winpr/assert.h>
+#include <winpr/crt.h>
+
+#include <freerdp/gdi/gdi.h>
+#include <freerdp/gdi/region.h>
+
+#include <freerdp/log.h>
+
+#define TAG FREERDP_TAG("gdi.invalid")
+
+/* The grid keeps one byte per tile and the bounding box of the dirty tiles, so marking a
+ * rectangle costs the number of tiles it touches and clearing only touches dirty rows. */
+struct S_GDI_INVALID_GRID
+{
+	UINT32 width;
+	UINT32 height;
+	UINT32 tileSize;
+	UINT32 columns;
+	UINT32 rows;
+	UINT32 fullFramePercent;
+
+	BYTE* tiles;
+	size_t dirty;
+	UINT32 minColumn;
+	UINT32 maxColumn;
+	UINT32 minRow;
+	UINT32 maxRow;
+
+	GDI_RGN* rects;
+	UINT32 nbRects;
+	BOOL rectsValid;
+	UINT32* open[2];
+};
+
+static void gdi_invalid_grid_reset_bounds(GDI_INVALID_GRID* grid)
+{
+	WINPR_ASSERT(grid);
+	grid->dirty = 0;
+	grid->minColumn = grid->columns;
+	grid->minRow = grid->rows;
+	grid->maxColumn = 0;
+	grid->maxRow = 0;
+	grid->nbRects = 0;
+	grid->rectsValid = TRUE;
+}
+
+GDI_INVALID_GRID* gdi_invalid_grid_new(UINT32 width, UINT32 height, UINT32 tileSize)
+{
+	if ((width == 0) || (height == 0) || (tileSize == 0))
+		return NULL;
+
+	GDI_INVALID_GRID* grid = (GDI_INVALID_GRID*)calloc(1, sizeof(GDI_INVALID_GRID));
+	if (!grid)
+		return NULL;
+
+	grid->width = width;
+	grid->height = height;
+	grid->tileSize = tileSize;
+	grid->columns = (width + tileSize - 1) / tileSize;
+	grid->rows = (height + tileSize - 1) / tileSize;
+
+	const size_t count = 1ull * grid->columns * grid->rows;
+	grid->tiles = (BYTE*)calloc(count, sizeof(BYTE));
+
+	/* at most every other tile of a row starts a rectangle */
+	grid->rects = (GDI_RGN*)calloc((grid->columns / 2 + 1ull) * grid->rows, sizeof(GDI_RGN));
+	grid->open[0] = (UINT32*)calloc(grid->columns / 2 + 1ull, sizeof(UINT32));
+	grid->open[1] = (UINT32*)calloc(grid->columns / 2 + 1ull, sizeof(UINT32));
+	if (!grid->tiles || !grid->rects || !grid->open[0] || !grid->open[1])
+	{
+		gdi_invalid_grid_free(grid);
+		return NULL;
+	}
+
+	gdi_invalid_grid_reset_bounds(grid);
+	return grid;
+}
+
+void gdi_invalid_grid_free(GDI_INVALID_GRID* grid)
+{
+	if (!grid)
+		return;
+
+	free(grid->tiles);
+	free(grid->rects);
+	free(grid->open[0]);
+	free(grid->open[1]);
+	free(grid);
+}
+
+void gdi_invalid_grid_set_full_frame(GDI_INVALID_GRID* grid, UINT32 percent)
+{
+	WINPR_ASSERT(grid);
+	grid->fullFramePercent = MIN(percent, 100);
+	grid->rectsValid = FALSE;
+}
+
+BOOL gdi_invalid_grid_add(GDI_INVALID_GRID* grid, INT32 x, INT32 y, INT32 w, INT32 h)
+{
+	WINPR_ASSERT(grid);
+
+	INT64 left = MAX(x, 0);
+	INT64 top = MAX(y, 0);
+	const INT64 right = MIN(1ll * x + w, grid->width);
+	const INT64 bottom = MIN(1ll * y + h, grid->height);
+
+	if ((left >= right) || (top >= bottom))
+		return TRUE;
+
+	const UINT32 c1 = (UINT32)left / grid->tileSize;
+	const UINT32 c2 = (UINT32)(right - 1) / grid->tileSize;
+	const UINT32 r1 = (UINT32)top / grid->tileSize;
+	const UINT32 r2 = (UINT32)(bottom - 1) / grid->tileSize;
+
+	for (UINT32 row = r1; row <= r2; row++)
+	{
+		BYTE* tile = &grid->tiles[1ull * row * grid->columns + c1];
+		for (UINT32 column = c1; column <= c2; column++, tile++)
+		{
+			if (*tile)
+				continue;
+
+			*tile = 1;
+			grid->dirty++;
+			grid->rectsValid = FALSE;
+		}
+	}
+
+	grid->minColumn = MIN(grid->minColumn, c1);
+	grid->maxColumn = MAX(grid->maxColumn, c2);
+	grid->minRow = MIN(grid->minRow, r1);
+	grid->maxRow = MAX(grid->maxRow, r2);
+	return TRUE;
+}
+
+void gdi_invalid_grid_clear(GDI_INVALID_GRID* grid)
+{
+	if (!grid || (grid->dirty == 0))
+		return;
+
+	for (UINT32 row = grid->minRow; row <= grid->maxRow; row++)
+	{
+		BYTE* tile = &grid->tiles[1ull * row * grid->columns + grid->minColumn];
+		memset(tile, 0, grid->maxColumn - grid->minColumn + 1ull);
+	}
+
+	gdi_invalid_grid_reset_bounds(grid);
+}
+
+BOOL gdi_invalid_grid_is_empty(const GDI_INVALID_GRID* grid)
+{
+	WINPR_ASSERT(grid);
+	return grid->dirty == 0;
+}
+
+static void gdi_invalid_grid_set_rect(const GDI_INVALID_GRID* grid, GDI_RGN* rgn, UINT32 c1,
+                                      UINT32 c2, UINT32 row)
+{
+	const UINT32 x = c1 * grid->tileSize;
+	const UINT32 y = row * grid->tileSize;
+	const UINT32 right = MIN(c2 * grid->tileSize, grid->width);
+	const UINT32 bottom = MIN(y + grid->tileSize, grid->height);
+
+	gdi_SetRgn(rgn, (INT32)x, (INT32)y, (INT32)(right - x), (INT32)(bottom - y));
+}
+
+/** Runs of dirty tiles in a row become rectangles. A run covering the same columns as a
+ *  rectangle ending on the row above extends that rectangle instead. The rectangles open for
+ *  extension are tracked per row sorted by column, so matching is a single merge step. */
+static void gdi_invalid_grid_build(GDI_INVALID_GRID* grid)
+{
+	WINPR_ASSERT(grid);
+
+	UINT32* open = grid->open[0];
+	UINT32* next = grid->open[1];
+	UINT32 nbOpen = 0;
+	grid->nbRects = 0;
+
+	if (grid->dirty == 0)
+		return;
+
+	const size_t total = 1ull * grid->columns * grid->rows;
+	if ((grid->fullFramePercent > 0) && (grid->dirty * 100 >= total * grid->fullFramePercent))
+	{
+		gdi_SetRgn(&grid->rects[0], 0, 0, (INT32)grid->width, (INT32)grid->height);
+		grid->nbRects = 1;
+		return;
+	}
+
+	for (UINT32 row = grid->minRow; row <= grid->maxRow; row++)
+	{
+		const BYTE* tiles = &grid->tiles[1ull * row * grid->columns];
+		UINT32 nbNext = 0;
+		UINT32 candidate = 0;
+
+		for (UINT32 column = grid->minColumn; column <= grid->maxColumn;)
+		{
+			if (!tiles[column])
+			{
+				column++;
+				continue;
+			}
+
+			const UINT32 c1 = column;
+			while ((column <= grid->maxColumn) && tiles[column])
+				column++;
+
+			GDI_RGN rgn = { 0 };
+			gdi_invalid_grid_set_rect(grid, &rgn, c1, column, row);
+
+			while ((candidate < nbOpen) && (grid->rects[open[candidate]].x < rgn.x))
+				candidate++;
+
+			if ((candidate < nbOpen) && (grid->rects[open[candidate]].x == rgn.x) &&
+			    (grid->rects[open[candidate]].w == rgn.w))
+			{
+				grid->rects[open[candidate]].h += rgn.h;
+				next[nbNext++] = open[candidate++];
+				continue;
+			}
+
+			next[nbNext++] = grid->nbRects;
+			grid->rects[grid->nbRects++] = rgn;
+		}
+
+		UINT32* tmp = open;
+		open = next;
+		next = tmp;
+		nbOpen = nbNext;
+	}
+}
+
+const GDI_RGN* gdi_invalid_grid_rects(GDI_INVALID_GRID* grid, UINT32* count)
+{
+	WINPR_ASSERT(grid);
+	WINPR_ASSERT(count);
+
+	if (!grid->rectsValid)
+	{
+		gdi_invalid_grid_build(grid);
+		grid->rectsValid = TRUE;
+	}
+
+	*count = grid->nbRects;
+	return grid->rects;
+}
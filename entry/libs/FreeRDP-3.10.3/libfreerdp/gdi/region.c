@@ -597,6 +597,31 @@ INLINE BOOL gdi_PtInRect(const HGDI_RECT rc, INT32 x, INT32 y)
 	return FALSE;
 }
 
+static BOOL gdi_invalidate_append(HGDI_WND hwnd, INT32 x, INT32 y, INT32 w, INT32 h)
+{
+	HGDI_RGN cinvalid = hwnd->cinvalid;
+
+	if ((hwnd->ninvalid + 1) > (INT64)hwnd->count)
+	{
+		HGDI_RGN new_rgn = NULL;
+		size_t new_cnt = 2ULL * hwnd->count;
+		if (new_cnt > UINT32_MAX)
+			return FALSE;
+
+		new_rgn = (HGDI_RGN)realloc(cinvalid, sizeof(GDI_RGN) * new_cnt);
+
+		if (!new_rgn)
+			return FALSE;
+
+		hwnd->count = (UINT32)new_cnt;
+		cinvalid = new_rgn;
+	}
+
+	gdi_SetRgn(&cinvalid[hwnd->ninvalid++], x, y, w, h);
+	hwnd->cinvalid = cinvalid;
+	return TRUE;
+}
+
 /**
  * Invalidate a given region, such that it is redrawn on the next region update.
  * msdn{dd145003}
@@ -613,7 +638,6 @@ INLINE BOOL gdi_InvalidateRegion(HGDI_DC hdc, INT32 x, INT32 y, INT32 w, INT32 h
 	GDI_RECT inv;
 	GDI_RECT rgn;
 	HGDI_RGN invalid = NULL;
-	HGDI_RGN cinvalid = NULL;
 
 	if (!hdc->hwnd)
 		return TRUE;
@@ -624,26 +648,17 @@ INLINE BOOL gdi_InvalidateRegion(HGDI_DC hdc, INT32 x, INT32 y, INT32 w, INT32 h
 	if (w == 0 || h == 0)
 		return TRUE;
 
-	cinvalid = hdc->hwnd->cinvalid;
-
-	if ((hdc->hwnd->ninvalid + 1) > (INT64)hdc->hwnd->count)
+	if (hdc->hwnd->grid)
 	{
-		HGDI_RGN new_rgn = NULL;
-		size_t new_cnt = 2ULL * hdc->hwnd->count;
-		if (new_cnt > UINT32_MAX)
+		if (!gdi_invalid_grid_add(hdc->hwnd->grid, x, y, w, h))
 			return FALSE;
 
-		new_rgn = (HGDI_RGN)realloc(cinvalid, sizeof(GDI_RGN) * new_cnt);
-
-		if (!new_rgn)
-			return FALSE;
-
-		hdc->hwnd->count = (UINT32)new_cnt;
-		cinvalid = new_rgn;
+		/* EndPaint handlers test ninvalid before looking at the grid */
+		hdc->hwnd->ninvalid = 1;
 	}
+	else if (!gdi_invalidate_append(hdc->hwnd, x, y, w, h))
+		return FALSE;
 
-	gdi_SetRgn(&cinvalid[hdc->hwnd->ninvalid++], x, y, w, h);
-	hdc->hwnd->cinvalid = cinvalid;
 	invalid = hdc->hwnd->invalid;
 
 	if (invalid->null)
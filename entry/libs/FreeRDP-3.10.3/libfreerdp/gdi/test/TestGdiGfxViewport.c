@@ -0,0 +1,250 @@
+#include <freerdp/freerdp.h>
+#include <freerdp/gdi/gdi.h>
+#include <freerdp/gdi/gfx.h>
+#include <freerdp/client/rdpgfx.h>
+#include <freerdp/codec/color.h>
+
+#include <winpr/crt.h>
+
+#define TEST_SIZE 256
+#define TEST_SURFACE 1
+
+typedef struct
+{
+	void* surfaces[4];
+	void* slots[4];
+} test_gfx_data;
+
+static UINT test_set_surface_data(RdpgfxClientContext* context, UINT16 surfaceId, void* pData)
+{
+	test_gfx_data* data = context->handle;
+	if (surfaceId >= ARRAYSIZE(data->surfaces))
+		return ERROR_INVALID_PARAMETER;
+	data->surfaces[surfaceId] = pData;
+	return CHANNEL_RC_OK;
+}
+
+static void* test_get_surface_data(RdpgfxClientContext* context, UINT16 surfaceId)
+{
+	test_gfx_data* data = context->handle;
+	if (surfaceId >= ARRAYSIZE(data->surfaces))
+		return NULL;
+	return data->surfaces[surfaceId];
+}
+
+static UINT test_get_surface_ids(RdpgfxClientContext* context, UINT16** ppSurfaceIds,
+                                 UINT16* count)
+{
+	test_gfx_data* data = context->handle;
+	UINT16* ids = calloc(ARRAYSIZE(data->surfaces), sizeof(UINT16));
+	*count = 0;
+	if (!ids)
+		return CHANNEL_RC_NO_MEMORY;
+
+	for (UINT16 x = 0; x < ARRAYSIZE(data->surfaces); x++)
+	{
+		if (data->surfaces[x])
+			ids[(*count)++] = x;
+	}
+	*ppSurfaceIds = ids;
+	return CHANNEL_RC_OK;
+}
+
+static void test_cache_entry_free(gdiGfxCacheEntry* entry)
+{
+	if (entry)
+		free(entry->data);
+	free(entry);
+}
+
+static UINT test_set_cache_slot_data(RdpgfxClientContext* context, UINT16 cacheSlot, void* pData)
+{
+	test_gfx_data* data = context->handle;
+	if (cacheSlot >= ARRAYSIZE(data->slots))
+		return ERROR_INVALID_PARAMETER;
+	test_cache_entry_free(data->slots[cacheSlot]);
+	data->slots[cacheSlot] = pData;
+	return CHANNEL_RC_OK;
+}
+
+static void* test_get_cache_slot_data(RdpgfxClientContext* context, UINT16 cacheSlot)
+{
+	test_gfx_data* data = context->handle;
+	if (cacheSlot >= ARRAYSIZE(data->slots))
+		return NULL;
+	return data->slots[cacheSlot];
+}
+
+static UINT test_evict_cache_entry(RdpgfxClientContext* context,
+                                   const RDPGFX_EVICT_CACHE_ENTRY_PDU* evict)
+{
+	return test_set_cache_slot_data(context, evict->cacheSlot, NULL);
+}
+
+/* Fill a rectangle of the surface with an uncompressed surface command */
+static BOOL test_fill(RdpgfxClientContext* gfx, UINT32 x, UINT32 y, UINT32 size, UINT32 color)
+{
+	BOOL rc = FALSE;
+	BYTE* pixels = calloc(1ull * size * size, 4);
+	if (!pixels)
+		return FALSE;
+
+	for (size_t i = 0; i < 1ull * size * size; i++)
+		FreeRDPWriteColor(&pixels[i * 4], PIXEL_FORMAT_BGRX32, color);
+
+	RDPGFX_SURFACE_COMMAND cmd = { 0 };
+	cmd.surfaceId = TEST_SURFACE;
+	cmd.codecId = RDPGFX_CODECID_UNCOMPRESSED;
+	cmd.format = PIXEL_FORMAT_BGRX32;
+	cmd.left = x;
+	cmd.top = y;
+	cmd.right = x + size;
+	cmd.bottom = y + size;
+	cmd.width = size;
+	cmd.height = size;
+	cmd.length = size * size * 4;
+	cmd.data = pixels;
+	rc = gfx->SurfaceCommand(gfx, &cmd) == CHANNEL_RC_OK;
+	free(pixels);
+	return rc;
+}
+
+static UINT32 test_primary(rdpGdi* gdi, UINT32 x, UINT32 y)
+{
+	return FreeRDPReadColor(&gdi->primary_buffer[1ull * y * gdi->stride + 4ull * x],
+	                        gdi->dstFormat);
+}
+
+static UINT32 test_surface(RdpgfxClientContext* gfx, UINT32 x, UINT32 y)
+{
+	const gdiGfxSurface* surface = gfx->GetSurfaceData(gfx, TEST_SURFACE);
+	return FreeRDPReadColor(&surface->data[1ull * y * surface->scanline + 4ull * x],
+	                        surface->format);
+}
+
+static BOOL test_viewport(rdpGdi* gdi, RdpgfxClientContext* gfx)
+{
+	const UINT32 red = FreeRDPGetColor(PIXEL_FORMAT_BGRX32, 0xFF, 0, 0, 0xFF);
+	const UINT32 green = FreeRDPGetColor(PIXEL_FORMAT_BGRX32, 0, 0xFF, 0, 0xFF);
+	const UINT32 blue = FreeRDPGetColor(PIXEL_FORMAT_BGRX32, 0, 0, 0xFF, 0xFF);
+	const UINT32 primaryRed = FreeRDPGetColor(gdi->dstFormat, 0xFF, 0, 0, 0xFF);
+	const UINT32 primaryGreen = FreeRDPGetColor(gdi->dstFormat, 0, 0xFF, 0, 0xFF);
+	const UINT32 primaryBlue = FreeRDPGetColor(gdi->dstFormat, 0, 0, 0xFF, 0xFF);
+	const RECTANGLE_16 viewport = { 0, 0, 128, 128 };
+
+	const RDPGFX_CREATE_SURFACE_PDU create = { TEST_SURFACE, TEST_SIZE, TEST_SIZE,
+		                                       GFX_PIXEL_FORMAT_XRGB_8888 };
+	if (gfx->CreateSurface(gfx, &create) != CHANNEL_RC_OK)
+		return FALSE;
+
+	const RDPGFX_MAP_SURFACE_TO_OUTPUT_PDU map = { TEST_SURFACE, 0, 0, 0 };
+	if (gfx->MapSurfaceToOutput(gfx, &map) != CHANNEL_RC_OK)
+		return FALSE;
+
+	if (!gdi_set_viewport(gdi, &viewport))
+		return FALSE;
+
+	/* Out of view, stays compressed */
+	if (!test_fill(gfx, 192, 192, 32, red))
+		return FALSE;
+	if ((test_surface(gfx, 200, 200) == red) || (test_primary(gdi, 200, 200) == primaryRed))
+		return FALSE;
+
+	/* Overlaps the pending command, that one is decoded first */
+	if (!test_fill(gfx, 208, 208, 32, blue))
+		return FALSE;
+	if ((test_surface(gfx, 200, 200) != red) || (test_primary(gdi, 200, 200) == primaryRed))
+		return FALSE;
+
+	/* In view, decoded and presented right away */
+	if (!test_fill(gfx, 16, 16, 32, green))
+		return FALSE;
+	if (test_primary(gdi, 20, 20) != primaryGreen)
+		return FALSE;
+
+	/* Reading a pending area decodes it, the output stays deferred */
+	const RDPGFX_SURFACE_TO_CACHE_PDU toCache = { TEST_SURFACE, 0, 1, { 216, 216, 232, 232 } };
+	if (gfx->SurfaceToCache(gfx, &toCache) != CHANNEL_RC_OK)
+		return FALSE;
+	if (test_surface(gfx, 220, 220) != blue)
+		return FALSE;
+	if (!test_fill(gfx, 32, 32, 16, green))
+		return FALSE;
+	if (test_primary(gdi, 220, 220) == primaryBlue)
+		return FALSE;
+
+	/* Scrolling the deferred area into view presents it */
+	const RECTANGLE_16 scrolled = { 128, 128, 256, 256 };
+	if (!gdi_set_viewport(gdi, &scrolled))
+		return FALSE;
+	if ((test_primary(gdi, 200, 200) != primaryRed) || (test_primary(gdi, 220, 220) != primaryBlue))
+		return FALSE;
+
+	/* A pending command fully drawn over is dropped */
+	if (!test_fill(gfx, 16, 96, 16, red))
+		return FALSE;
+	if (!test_fill(gfx, 8, 88, 32, blue))
+		return FALSE;
+	if (!gdi_set_viewport(gdi, NULL))
+		return FALSE;
+	if ((test_primary(gdi, 20, 100) != primaryBlue) || (test_primary(gdi, 20, 20) != primaryGreen))
+		return FALSE;
+
+	const RDPGFX_DELETE_SURFACE_PDU del = { TEST_SURFACE };
+	return gfx->DeleteSurface(gfx, &del) == CHANNEL_RC_OK;
+}
+
+int TestGdiGfxViewport(int argc, char* argv[])
+{
+	int rc = -1;
+	test_gfx_data data = { 0 };
+	RdpgfxClientContext gfx = { 0 };
+	BOOL pipeline = FALSE;
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	freerdp* instance = freerdp_new();
+	if (!instance || !freerdp_context_new(instance))
+		goto fail;
+
+	rdpSettings* settings = instance->context->settings;
+	if (!freerdp_settings_set_uint32(settings, FreeRDP_DesktopWidth, TEST_SIZE) ||
+	    !freerdp_settings_set_uint32(settings, FreeRDP_DesktopHeight, TEST_SIZE) ||
+	    !freerdp_settings_set_uint32(settings, FreeRDP_ColorDepth, 32))
+		goto fail;
+
+	if (!gdi_init(instance, PIXEL_FORMAT_BGRA32))
+		goto fail;
+
+	gfx.handle = &data;
+	gfx.SetSurfaceData = test_set_surface_data;
+	gfx.GetSurfaceData = test_get_surface_data;
+	gfx.GetSurfaceIds = test_get_surface_ids;
+	gfx.SetCacheSlotData = test_set_cache_slot_data;
+	gfx.GetCacheSlotData = test_get_cache_slot_data;
+	gfx.EvictCacheEntry = test_evict_cache_entry;
+
+	pipeline = gdi_graphics_pipeline_init(instance->context->gdi, &gfx);
+	if (!pipeline)
+		goto fail;
+
+	if (!test_viewport(instance->context->gdi, &gfx))
+		goto fail;
+
+	rc = 0;
+fail:
+	if (pipeline)
+		gdi_graphics_pipeline_uninit(instance->context->gdi, &gfx);
+	for (size_t x = 0; x < ARRAYSIZE(data.slots); x++)
+		test_cache_entry_free(data.slots[x]);
+	if (instance)
+	{
+		gdi_free(instance);
+		freerdp_context_free(instance);
+	}
+	freerdp_free(instance);
+	if (rc != 0)
+		printf("%s failed\n", __func__);
+	return rc;
+}
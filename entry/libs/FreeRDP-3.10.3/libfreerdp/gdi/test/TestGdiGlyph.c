@@ -0,0 +1,240 @@
+#include <freerdp/gdi/gdi.h>
+
+#include <freerdp/gdi/dc.h>
+#include <freerdp/gdi/bitmap.h>
+#include <freerdp/codec/color.h>
+
+#include <winpr/crt.h>
+#include <winpr/crypto.h>
+
+#include "glyph_atlas.h"
+
+typedef struct
+{
+	UINT32 cx;
+	UINT32 cy;
+	BYTE* aj;
+	size_t cb;
+	GDI_GLYPH_MASK mask;
+} test_glyph;
+
+static UINT32 test_rand(UINT32 max)
+{
+	UINT32 r = 0;
+	winpr_RAND(&r, sizeof(r));
+	return r % max;
+}
+
+static BOOL test_glyph_new(GDI_GLYPH_ATLAS* atlas, test_glyph* glyph, UINT32 cx, UINT32 cy)
+{
+	glyph->cx = cx;
+	glyph->cy = cy;
+	glyph->cb = ((cx + 7) / 8) * cy;
+	glyph->aj = calloc(1, glyph->cb);
+	if (!glyph->aj)
+		return FALSE;
+
+	winpr_RAND(glyph->aj, glyph->cb);
+	return gdi_glyph_atlas_add(atlas, cx, cy, glyph->aj, glyph->cb, &glyph->mask);
+}
+
+static void test_glyph_free(test_glyph* glyph)
+{
+	gdi_glyph_mask_release(&glyph->mask);
+	free(glyph->aj);
+}
+
+static BOOL test_glyph_bit(const test_glyph* glyph, UINT32 x, UINT32 y)
+{
+	const size_t scanline = (glyph->cx + 7) / 8;
+	return (glyph->aj[y * scanline + x / 8] & (0x80 >> (x % 8))) != 0;
+}
+
+/* Draw through the atlas and compare against a per pixel reference of the same run */
+static BOOL test_run(GDI_GLYPH_ATLAS* atlas, UINT32 format, BOOL fillCells)
+{
+	const INT32 width = 317;
+	const INT32 height = 93;
+	const UINT32 textColor = FreeRDPGetColor(format, 0x12, 0x34, 0x56, 0xFF);
+	const UINT32 bkColor = FreeRDPGetColor(format, 0xAB, 0xCD, 0xEF, 0xFF);
+	const size_t bpp = FreeRDPGetBytesPerPixel(format);
+	test_glyph glyphs[40] = { 0 };
+	BYTE* expected = NULL;
+	BOOL rc = FALSE;
+	HGDI_BITMAP bmp = NULL;
+	HGDI_DC hdc = gdi_GetDC();
+
+	if (!hdc)
+		goto fail;
+
+	hdc->format = format;
+	bmp = gdi_CreateCompatibleBitmap(hdc, width, height);
+	if (!bmp)
+		goto fail;
+
+	gdi_SelectObject(hdc, (HGDIOBJECT)bmp);
+	winpr_RAND(bmp->data, 1ull * bmp->scanline * height);
+	expected = malloc(1ull * bmp->scanline * height);
+	if (!expected)
+		goto fail;
+	memcpy(expected, bmp->data, 1ull * bmp->scanline * height);
+
+	for (size_t n = 0; n < ARRAYSIZE(glyphs); n++)
+	{
+		/* mostly text sized glyphs, some wide enough for the vector path, one oversized */
+		const UINT32 cx = (n == 7) ? 100 : 1 + test_rand((n % 3) ? 20 : 40);
+		const UINT32 cy = (n == 7) ? 80 : 1 + test_rand(30);
+		if (!test_glyph_new(atlas, &glyphs[n], cx, cy))
+			goto fail;
+	}
+
+	if (!gdi_glyph_run_begin(atlas, hdc, textColor, bkColor, fillCells))
+		goto fail;
+
+	INT32 pos[ARRAYSIZE(glyphs)][4] = { 0 };
+	for (size_t n = 0; n < ARRAYSIZE(glyphs); n++)
+	{
+		const test_glyph* glyph = &glyphs[n];
+		const INT32 sx = (INT32)test_rand(3);
+		const INT32 sy = (INT32)test_rand(3);
+		pos[n][0] = (INT32)test_rand(width + 20) - 20;
+		pos[n][1] = (INT32)test_rand(height + 20) - 20;
+		pos[n][2] = sx;
+		pos[n][3] = sy;
+
+		if (!gdi_glyph_run_add(atlas, &glyph->mask, pos[n][0], pos[n][1], (INT32)glyph->cx - sx,
+		                       (INT32)glyph->cy - sy, sx, sy))
+			goto fail;
+	}
+
+	if (!gdi_glyph_run_end(atlas) || gdi_glyph_run_active(atlas))
+		goto fail;
+
+	for (size_t pass = fillCells ? 0 : 1; pass < 2; pass++)
+	{
+		for (size_t n = 0; n < ARRAYSIZE(glyphs); n++)
+		{
+			const test_glyph* glyph = &glyphs[n];
+
+			for (INT32 y = pos[n][3]; y < (INT32)glyph->cy; y++)
+			{
+				for (INT32 x = pos[n][2]; x < (INT32)glyph->cx; x++)
+				{
+					const INT32 dx = pos[n][0] + x - pos[n][2];
+					const INT32 dy = pos[n][1] + y - pos[n][3];
+					if ((dx < 0) || (dy < 0) || (dx >= width) || (dy >= height))
+						continue;
+
+					BYTE* dst = &expected[1ull * dy * bmp->scanline + 1ull * dx * bpp];
+					if (pass == 0)
+						FreeRDPWriteColor(dst, format, bkColor);
+					else if (test_glyph_bit(glyph, (UINT32)x, (UINT32)y))
+						FreeRDPWriteColor(dst, format, textColor);
+				}
+			}
+		}
+	}
+
+	for (INT32 y = 0; y < height; y++)
+	{
+		if (memcmp(&expected[1ull * y * bmp->scanline], &bmp->data[1ull * y * bmp->scanline],
+		           1ull * width * bpp) != 0)
+		{
+			printf("%s fill=%d: row %" PRId32 " differs\n", FreeRDPGetColorFormatName(format),
+			       fillCells, y);
+			goto fail;
+		}
+	}
+
+	rc = TRUE;
+fail:
+	for (size_t n = 0; n < ARRAYSIZE(glyphs); n++)
+		test_glyph_free(&glyphs[n]);
+	free(expected);
+	gdi_DeleteObject((HGDIOBJECT)bmp);
+	gdi_DeleteDC(hdc);
+	return rc;
+}
+
+/* Pages are recycled once their glyphs are gone and outlive the atlas while glyphs use them */
+static BOOL test_lifetime(void)
+{
+	BOOL rc = FALSE;
+	test_glyph glyphs[600] = { 0 };
+	GDI_GLYPH_ATLAS* atlas = gdi_glyph_atlas_new();
+	if (!atlas)
+		return FALSE;
+
+	for (size_t round = 0; round < 3; round++)
+	{
+		for (size_t n = 0; n < ARRAYSIZE(glyphs); n++)
+		{
+			if (!test_glyph_new(atlas, &glyphs[n], 1 + test_rand(24), 1 + test_rand(24)))
+				goto fail;
+		}
+
+		for (size_t n = 0; n < ARRAYSIZE(glyphs); n++)
+		{
+			const test_glyph* glyph = &glyphs[n];
+
+			for (UINT32 y = 0; y < glyph->cy; y++)
+			{
+				for (UINT32 x = 0; x < glyph->cx; x++)
+				{
+					const BYTE expect = test_glyph_bit(glyph, x, y) ? 0xFF : 0x00;
+					if (glyph->mask.data[1ull * y * glyph->mask.stride + x] != expect)
+					{
+						printf("glyph %" PRIuz " of round %" PRIuz " corrupted\n", n, round);
+						goto fail;
+					}
+				}
+			}
+		}
+
+		if (round == 2)
+			break;
+
+		for (size_t n = 0; n < ARRAYSIZE(glyphs); n++)
+			test_glyph_free(&glyphs[n]);
+		memset(glyphs, 0, sizeof(glyphs));
+	}
+
+	rc = TRUE;
+fail:
+	gdi_glyph_atlas_free(atlas);
+	for (size_t n = 0; n < ARRAYSIZE(glyphs); n++)
+		test_glyph_free(&glyphs[n]);
+	return rc;
+}
+
+int TestGdiGlyph(int argc, char* argv[])
+{
+	const UINT32 formats[] = { PIXEL_FORMAT_BGRX32, PIXEL_FORMAT_RGBA32, PIXEL_FORMAT_RGB24,
+		                       PIXEL_FORMAT_RGB16 };
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	GDI_GLYPH_ATLAS* atlas = gdi_glyph_atlas_new();
+	if (!atlas)
+		return -1;
+
+	for (size_t x = 0; x < ARRAYSIZE(formats); x++)
+	{
+		for (size_t n = 0; n < 10; n++)
+		{
+			if (!test_run(atlas, formats[x], (n % 2) == 0))
+			{
+				gdi_glyph_atlas_free(atlas);
+				return -1;
+			}
+		}
+	}
+
+	gdi_glyph_atlas_free(atlas);
+
+	if (!test_lifetime())
+		return -1;
+
+	return 0;
+}
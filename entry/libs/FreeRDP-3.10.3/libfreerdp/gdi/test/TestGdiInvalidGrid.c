@@ -0,0 +1,229 @@
+#include <freerdp/gdi/gdi.h>
+
+#include <freerdp/gdi/dc.h>
+#include <freerdp/gdi/region.h>
+
+#include <winpr/crt.h>
+#include <winpr/crypto.h>
+
+static BOOL test_rects(GDI_INVALID_GRID* grid, const GDI_RGN* expected, UINT32 nbExpected)
+{
+	UINT32 count = 0;
+	const GDI_RGN* rects = gdi_invalid_grid_rects(grid, &count);
+
+	if (count != nbExpected)
+	{
+		printf("expected %" PRIu32 " rectangles, got %" PRIu32 "\n", nbExpected, count);
+		return FALSE;
+	}
+
+	for (UINT32 x = 0; x < count; x++)
+	{
+		const GDI_RGN* a = &rects[x];
+		const GDI_RGN* b = &expected[x];
+		if ((a->x != b->x) || (a->y != b->y) || (a->w != b->w) || (a->h != b->h))
+		{
+			printf("rectangle %" PRIu32 " is %" PRId32 "x%" PRId32 "+%" PRId32 "+%" PRId32
+			       ", expected %" PRId32 "x%" PRId32 "+%" PRId32 "+%" PRId32 "\n",
+			       x, a->w, a->h, a->x, a->y, b->w, b->h, b->x, b->y);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static BOOL test_corners(void)
+{
+	BOOL rc = FALSE;
+	GDI_INVALID_GRID* grid = gdi_invalid_grid_new(1000, 700, 64);
+	if (!grid || !gdi_invalid_grid_is_empty(grid))
+		goto fail;
+
+	/* two small updates in opposite corners stay two small rectangles */
+	const GDI_RGN corners[] = { { 0, 0, 0, 64, 64, FALSE }, { 0, 960, 640, 40, 60, FALSE } };
+	if (!gdi_invalid_grid_add(grid, 3, 5, 10, 10) || !gdi_invalid_grid_add(grid, 990, 690, 50, 50))
+		goto fail;
+	if (!test_rects(grid, corners, ARRAYSIZE(corners)))
+		goto fail;
+
+	gdi_invalid_grid_clear(grid);
+	if (!gdi_invalid_grid_is_empty(grid) || !test_rects(grid, NULL, 0))
+		goto fail;
+
+	/* an L shape: identical runs are stacked, the wider last row starts a new rectangle */
+	const GDI_RGN shape[] = { { 0, 64, 64, 128, 128, FALSE }, { 0, 64, 192, 256, 64, FALSE } };
+	if (!gdi_invalid_grid_add(grid, 64, 64, 128, 192) ||
+	    !gdi_invalid_grid_add(grid, 200, 200, 100, 50))
+		goto fail;
+	if (!test_rects(grid, shape, ARRAYSIZE(shape)))
+		goto fail;
+
+	/* outside of the surface */
+	gdi_invalid_grid_clear(grid);
+	if (!gdi_invalid_grid_add(grid, -100, 10, 50, 50) || !gdi_invalid_grid_add(grid, 10, 800, 5, 5))
+		goto fail;
+	if (!gdi_invalid_grid_is_empty(grid))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	gdi_invalid_grid_free(grid);
+	return rc;
+}
+
+static BOOL test_full_frame(void)
+{
+	BOOL rc = FALSE;
+	const GDI_RGN full = { 0, 0, 0, 640, 480, FALSE };
+	GDI_INVALID_GRID* grid = gdi_invalid_grid_new(640, 480, 64);
+	if (!grid)
+		goto fail;
+
+	gdi_invalid_grid_set_full_frame(grid, 50);
+
+	/* a checker board below the threshold */
+	for (INT32 y = 0; y < 480; y += 128)
+	{
+		for (INT32 x = 0; x < 640; x += 128)
+		{
+			if (!gdi_invalid_grid_add(grid, x, y, 1, 1))
+				goto fail;
+		}
+	}
+
+	UINT32 count = 0;
+	gdi_invalid_grid_rects(grid, &count);
+	if (count != 20)
+		goto fail;
+
+	if (!gdi_invalid_grid_add(grid, 0, 0, 640, 300) || !test_rects(grid, &full, 1))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	gdi_invalid_grid_free(grid);
+	return rc;
+}
+
+/* the rectangles must cover exactly the dirty tiles without overlapping */
+static BOOL test_random(void)
+{
+	const UINT32 width = 1920;
+	const UINT32 height = 1080;
+	const UINT32 tile = 64;
+	const UINT32 columns = (width + tile - 1) / tile;
+	const UINT32 rows = (height + tile - 1) / tile;
+	BOOL rc = FALSE;
+	BYTE* expected = calloc(1ull * columns * rows, sizeof(BYTE));
+	BYTE* covered = calloc(1ull * columns * rows, sizeof(BYTE));
+	GDI_INVALID_GRID* grid = gdi_invalid_grid_new(width, height, tile);
+	if (!expected || !covered || !grid)
+		goto fail;
+
+	for (size_t x = 0; x < 300; x++)
+	{
+		UINT32 r[4] = { 0 };
+		winpr_RAND(r, sizeof(r));
+
+		const INT32 rx = (INT32)(r[0] % width);
+		const INT32 ry = (INT32)(r[1] % height);
+		const INT32 rw = (INT32)(1 + r[2] % 100);
+		const INT32 rh = (INT32)(1 + r[3] % 100);
+		if (!gdi_invalid_grid_add(grid, rx, ry, rw, rh))
+			goto fail;
+
+		const UINT32 c2 = MIN(rx + rw - 1, (INT32)width - 1) / tile;
+		const UINT32 r2 = MIN(ry + rh - 1, (INT32)height - 1) / tile;
+		for (UINT32 row = ry / tile; row <= r2; row++)
+		{
+			for (UINT32 column = rx / tile; column <= c2; column++)
+				expected[row * columns + column] = 1;
+		}
+	}
+
+	UINT32 count = 0;
+	const GDI_RGN* rects = gdi_invalid_grid_rects(grid, &count);
+	for (UINT32 x = 0; x < count; x++)
+	{
+		const GDI_RGN* rgn = &rects[x];
+		if ((rgn->x + rgn->w > (INT32)width) || (rgn->y + rgn->h > (INT32)height))
+			goto fail;
+
+		for (INT32 row = rgn->y / tile; row * tile < rgn->y + rgn->h; row++)
+		{
+			for (INT32 column = rgn->x / tile; column * tile < rgn->x + rgn->w; column++)
+			{
+				if (covered[row * columns + column]++)
+					goto fail;
+			}
+		}
+	}
+
+	rc = (memcmp(expected, covered, 1ull * columns * rows) == 0);
+fail:
+	if (!rc)
+		printf("%s: rectangles do not match the dirty tiles\n", __func__);
+	free(expected);
+	free(covered);
+	gdi_invalid_grid_free(grid);
+	return rc;
+}
+
+/* gdi_InvalidateRegion marks the grid instead of the cinvalid list */
+static BOOL test_invalidate(void)
+{
+	BOOL rc = FALSE;
+	HGDI_DC hdc = gdi_GetDC();
+	if (!hdc)
+		return FALSE;
+
+	hdc->hwnd = (HGDI_WND)calloc(1, sizeof(GDI_WND));
+	if (!hdc->hwnd)
+		goto fail;
+
+	hdc->hwnd->invalid = gdi_CreateRectRgn(0, 0, 0, 0);
+	hdc->hwnd->grid = gdi_invalid_grid_new(256, 256, 64);
+	if (!hdc->hwnd->invalid || !hdc->hwnd->grid)
+		goto fail;
+	hdc->hwnd->invalid->null = TRUE;
+
+	if (!gdi_InvalidateRegion(hdc, 10, 10, 20, 20) || !gdi_InvalidateRegion(hdc, 200, 200, 5, 5))
+		goto fail;
+
+	const GDI_RGN expected[] = { { 0, 0, 0, 64, 64, FALSE }, { 0, 192, 192, 64, 64, FALSE } };
+	if ((hdc->hwnd->ninvalid != 1) || hdc->hwnd->cinvalid ||
+	    !test_rects(hdc->hwnd->grid, expected, ARRAYSIZE(expected)))
+		goto fail;
+
+	/* the bounding box is still maintained */
+	if ((hdc->hwnd->invalid->x != 10) || (hdc->hwnd->invalid->w != 195))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	gdi_DeleteDC(hdc);
+	return rc;
+}
+
+int TestGdiInvalidGrid(int argc, char* argv[])
+{
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!test_corners())
+		return -1;
+
+	if (!test_full_frame())
+		return -1;
+
+	for (size_t x = 0; x < 10; x++)
+	{
+		if (!test_random())
+			return -1;
+	}
+
+	if (!test_invalidate())
+		return -1;
+
+	return 0;
+}
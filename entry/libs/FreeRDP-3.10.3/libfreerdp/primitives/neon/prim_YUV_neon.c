@@ -730,6 +730,422 @@ static pstatus_t neon_YUV420CombineToYUV444(avc444_frame_type type,
 			return -1;
 	}
 }
+
+/**
+ * | Y |    ( |  54   183     18 | | R | )        |  0  |
+ * | U | =  ( | -29   -99    128 | | G | ) >> 8 + | 128 |
+ * | V |    ( | 128  -116    -12 | | B | )        | 128 |
+ *
+ * Same integer arithmetic as the generic version, so the results are identical.
+ * The U and V sums are in [-32640, 32640], computing them modulo 2^16 is exact.
+ */
+static INLINE uint8x8_t neon_RGB2Y(uint8x8_t R, uint8x8_t G, uint8x8_t B)
+{
+	uint16x8_t Y = vmull_u8(R, vdup_n_u8(54));
+	Y = vmlal_u8(Y, G, vdup_n_u8(183));
+	Y = vmlal_u8(Y, B, vdup_n_u8(18));
+	return vshrn_n_u16(Y, 8);
+}
+
+static INLINE uint8x8_t neon_RGB2U(uint8x8_t R, uint8x8_t G, uint8x8_t B)
+{
+	uint16x8_t U = vmull_u8(B, vdup_n_u8(128));
+	U = vmlsl_u8(U, R, vdup_n_u8(29));
+	U = vmlsl_u8(U, G, vdup_n_u8(99));
+	const int16x8_t S = vaddq_s16(vshrq_n_s16(vreinterpretq_s16_u16(U), 8), vdupq_n_s16(128));
+	return vmovn_u16(vreinterpretq_u16_s16(S));
+}
+
+static INLINE uint8x8_t neon_RGB2V(uint8x8_t R, uint8x8_t G, uint8x8_t B)
+{
+	uint16x8_t V = vmull_u8(R, vdup_n_u8(128));
+	V = vmlsl_u8(V, G, vdup_n_u8(116));
+	V = vmlsl_u8(V, B, vdup_n_u8(12));
+	const int16x8_t S = vaddq_s16(vshrq_n_s16(vreinterpretq_s16_u16(V), 8), vdupq_n_s16(128));
+	return vmovn_u16(vreinterpretq_u16_s16(S));
+}
+
+/* Convert 16 pixels of a 32bpp line to Y, U and V */
+static INLINE void neon_RGBToYUV444_16(const BYTE* WINPR_RESTRICT src, const uint8_t rPos,
+                                       const uint8_t bPos, uint8x16_t* WINPR_RESTRICT Y,
+                                       uint8x16_t* WINPR_RESTRICT U, uint8x16_t* WINPR_RESTRICT V)
+{
+	const uint8x16x4_t bgrx = vld4q_u8(src);
+	const uint8x16_t R = bgrx.val[rPos];
+	const uint8x16_t G = bgrx.val[1];
+	const uint8x16_t B = bgrx.val[bPos];
+
+	*Y = vcombine_u8(neon_RGB2Y(vget_low_u8(R), vget_low_u8(G), vget_low_u8(B)),
+	                 neon_RGB2Y(vget_high_u8(R), vget_high_u8(G), vget_high_u8(B)));
+	*U = vcombine_u8(neon_RGB2U(vget_low_u8(R), vget_low_u8(G), vget_low_u8(B)),
+	                 neon_RGB2U(vget_high_u8(R), vget_high_u8(G), vget_high_u8(B)));
+	*V = vcombine_u8(neon_RGB2V(vget_low_u8(R), vget_low_u8(G), vget_low_u8(B)),
+	                 neon_RGB2V(vget_high_u8(R), vget_high_u8(G), vget_high_u8(B)));
+}
+
+/* Pixels 0, 2, 4, ... and 1, 3, 5, ... of 16 values */
+static INLINE uint8x8_t neon_even(uint8x16_t v)
+{
+	return vmovn_u16(vreinterpretq_u16_u8(v));
+}
+
+static INLINE uint8x8_t neon_odd(uint8x16_t v)
+{
+	return vshrn_n_u16(vreinterpretq_u16_u8(v), 8);
+}
+
+/* Average of 2x2 chroma values. Without an odd line the generic version uses the left pixel of
+ * each pair in place of both missing values, do the same. */
+static INLINE uint8x8_t neon_avg2x2(uint8x16_t even, const uint8x16_t* WINPR_RESTRICT odd)
+{
+	uint16x8_t sum = vpaddlq_u8(even);
+
+	if (odd)
+		sum = vpadalq_u8(sum, *odd);
+	else
+		sum = vaddq_u16(sum, vshlq_n_u16(vmovl_u8(neon_even(even)), 1));
+
+	return vshrn_n_u16(sum, 2);
+}
+
+static INLINE void neon_store4(BYTE* WINPR_RESTRICT dst, uint8x8_t v)
+{
+	const uint32_t val = vget_lane_u32(vreinterpret_u32_u8(v), 0);
+	memcpy(dst, &val, sizeof(val));
+}
+
+static INLINE pstatus_t neon_RGBToYUV420_X(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                           BYTE* WINPR_RESTRICT pDst[3], const UINT32 dstStep[3],
+                                           const prim_size_t* WINPR_RESTRICT roi,
+                                           const uint8_t rPos, const uint8_t bPos)
+{
+	for (size_t y = 0; y < roi->height; y += 2)
+	{
+		const BYTE* line1 = pSrc + y * srcStep;
+		const BYTE* line2 = (y + 1 < roi->height) ? line1 + srcStep : NULL;
+		BYTE* ydst1 = pDst[0] + y * dstStep[0];
+		BYTE* ydst2 = ydst1 + dstStep[0];
+		BYTE* udst = pDst[1] + (y / 2) * dstStep[1];
+		BYTE* vdst = pDst[2] + (y / 2) * dstStep[2];
+
+		for (size_t x = 0; x < roi->width; x += 16)
+		{
+			/* U and V are computed from the 2x2 averaged RGB values */
+			const uint8x16x4_t bgrx1 = vld4q_u8(&line1[x * 4]);
+			const uint8x16_t R1 = bgrx1.val[rPos];
+			const uint8x16_t G1 = bgrx1.val[1];
+			const uint8x16_t B1 = bgrx1.val[bPos];
+			uint16x8_t Rs = vpaddlq_u8(R1);
+			uint16x8_t Gs = vpaddlq_u8(G1);
+			uint16x8_t Bs = vpaddlq_u8(B1);
+
+			vst1q_u8(&ydst1[x],
+			         vcombine_u8(neon_RGB2Y(vget_low_u8(R1), vget_low_u8(G1), vget_low_u8(B1)),
+			                     neon_RGB2Y(vget_high_u8(R1), vget_high_u8(G1), vget_high_u8(B1))));
+
+			if (line2)
+			{
+				const uint8x16x4_t bgrx2 = vld4q_u8(&line2[x * 4]);
+				const uint8x16_t R2 = bgrx2.val[rPos];
+				const uint8x16_t G2 = bgrx2.val[1];
+				const uint8x16_t B2 = bgrx2.val[bPos];
+				Rs = vpadalq_u8(Rs, R2);
+				Gs = vpadalq_u8(Gs, G2);
+				Bs = vpadalq_u8(Bs, B2);
+
+				vst1q_u8(&ydst2[x], vcombine_u8(neon_RGB2Y(vget_low_u8(R2), vget_low_u8(G2),
+				                                           vget_low_u8(B2)),
+				                                neon_RGB2Y(vget_high_u8(R2), vget_high_u8(G2),
+				                                           vget_high_u8(B2))));
+			}
+
+			{
+				const uint8x8_t Ra = vshrn_n_u16(Rs, 2);
+				const uint8x8_t Ga = vshrn_n_u16(Gs, 2);
+				const uint8x8_t Ba = vshrn_n_u16(Bs, 2);
+				vst1_u8(&udst[x / 2], neon_RGB2U(Ra, Ga, Ba));
+				vst1_u8(&vdst[x / 2], neon_RGB2V(Ra, Ga, Ba));
+			}
+		}
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+static pstatus_t neon_RGBToYUV420_8u_P3AC4R(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcFormat,
+                                            UINT32 srcStep, BYTE* WINPR_RESTRICT pDst[3],
+                                            const UINT32 dstStep[3],
+                                            const prim_size_t* WINPR_RESTRICT roi)
+{
+	if (roi->height < 1 || roi->width < 1)
+		return !PRIMITIVES_SUCCESS;
+
+	if (roi->width % 16)
+		return generic->RGBToYUV420_8u_P3AC4R(pSrc, srcFormat, srcStep, pDst, dstStep, roi);
+
+	switch (srcFormat)
+	{
+		case PIXEL_FORMAT_BGRX32:
+		case PIXEL_FORMAT_BGRA32:
+			return neon_RGBToYUV420_X(pSrc, srcStep, pDst, dstStep, roi, 2, 0);
+
+		case PIXEL_FORMAT_RGBX32:
+		case PIXEL_FORMAT_RGBA32:
+			return neon_RGBToYUV420_X(pSrc, srcStep, pDst, dstStep, roi, 0, 2);
+
+		default:
+			return generic->RGBToYUV420_8u_P3AC4R(pSrc, srcFormat, srcStep, pDst, dstStep, roi);
+	}
+}
+
+static INLINE void neon_RGBToAVC444YUV_DOUBLE_ROW(
+    const BYTE* WINPR_RESTRICT srcEven, const BYTE* WINPR_RESTRICT srcOdd,
+    BYTE* WINPR_RESTRICT b1Even, BYTE* WINPR_RESTRICT b1Odd, BYTE* WINPR_RESTRICT b2,
+    BYTE* WINPR_RESTRICT b3, BYTE* WINPR_RESTRICT b4, BYTE* WINPR_RESTRICT b5,
+    BYTE* WINPR_RESTRICT b6, BYTE* WINPR_RESTRICT b7, UINT32 width, const uint8_t rPos,
+    const uint8_t bPos)
+{
+	for (UINT32 x = 0; x < width; x += 16)
+	{
+		uint8x16_t Ye;
+		uint8x16_t Ue;
+		uint8x16_t Ve;
+		neon_RGBToYUV444_16(&srcEven[4ULL * x], rPos, bPos, &Ye, &Ue, &Ve);
+		vst1q_u8(b1Even, Ye);
+		b1Even += 16;
+
+		if (b1Odd)
+		{
+			uint8x16_t Yo;
+			uint8x16_t Uo;
+			uint8x16_t Vo;
+			neon_RGBToYUV444_16(&srcOdd[4ULL * x], rPos, bPos, &Yo, &Uo, &Vo);
+			vst1q_u8(b1Odd, Yo);
+			b1Odd += 16;
+
+			/* 2x 2y -> b2, b3 */
+			vst1_u8(b2, neon_avg2x2(Ue, &Uo));
+			vst1_u8(b3, neon_avg2x2(Ve, &Vo));
+
+			/* x 2y+1 -> b4, b5 */
+			vst1q_u8(b4, Uo);
+			vst1q_u8(b5, Vo);
+			b4 += 16;
+			b5 += 16;
+		}
+		else
+		{
+			vst1_u8(b2, neon_avg2x2(Ue, NULL));
+			vst1_u8(b3, neon_avg2x2(Ve, NULL));
+		}
+
+		b2 += 8;
+		b3 += 8;
+
+		/* 2x+1 2y -> b6, b7 */
+		vst1_u8(b6, neon_odd(Ue));
+		vst1_u8(b7, neon_odd(Ve));
+		b6 += 8;
+		b7 += 8;
+	}
+}
+
+static INLINE pstatus_t neon_RGBToAVC444YUV_X(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                              BYTE* WINPR_RESTRICT pDst1[3],
+                                              const UINT32 dst1Step[3],
+                                              BYTE* WINPR_RESTRICT pDst2[3],
+                                              const UINT32 dst2Step[3],
+                                              const prim_size_t* WINPR_RESTRICT roi,
+                                              const uint8_t rPos, const uint8_t bPos)
+{
+	for (size_t y = 0; y < roi->height; y += 2)
+	{
+		const BOOL last = (y >= (roi->height - 1));
+		const BYTE* srcEven = pSrc + y * srcStep;
+		const BYTE* srcOdd = !last ? srcEven + srcStep : NULL;
+		const size_t i = y >> 1;
+		const size_t n = (i & ~7) + i;
+		BYTE* b1Even = pDst1[0] + y * dst1Step[0];
+		BYTE* b1Odd = !last ? (b1Even + dst1Step[0]) : NULL;
+		BYTE* b2 = pDst1[1] + (y / 2) * dst1Step[1];
+		BYTE* b3 = pDst1[2] + (y / 2) * dst1Step[2];
+		BYTE* b4 = pDst2[0] + 1ULL * dst2Step[0] * n;
+		BYTE* b5 = b4 + 8ULL * dst2Step[0];
+		BYTE* b6 = pDst2[1] + (y / 2) * dst2Step[1];
+		BYTE* b7 = pDst2[2] + (y / 2) * dst2Step[2];
+		neon_RGBToAVC444YUV_DOUBLE_ROW(srcEven, srcOdd, b1Even, b1Odd, b2, b3, b4, b5, b6, b7,
+		                               roi->width, rPos, bPos);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+static pstatus_t neon_RGBToAVC444YUV(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcFormat,
+                                     UINT32 srcStep, BYTE* WINPR_RESTRICT pDst1[3],
+                                     const UINT32 dst1Step[3], BYTE* WINPR_RESTRICT pDst2[3],
+                                     const UINT32 dst2Step[3],
+                                     const prim_size_t* WINPR_RESTRICT roi)
+{
+	if (roi->height < 1 || roi->width < 1)
+		return !PRIMITIVES_SUCCESS;
+
+	if (roi->width % 16)
+		return generic->RGBToAVC444YUV(pSrc, srcFormat, srcStep, pDst1, dst1Step, pDst2, dst2Step,
+		                               roi);
+
+	switch (srcFormat)
+	{
+		case PIXEL_FORMAT_BGRX32:
+		case PIXEL_FORMAT_BGRA32:
+			return neon_RGBToAVC444YUV_X(pSrc, srcStep, pDst1, dst1Step, pDst2, dst2Step, roi, 2,
+			                             0);
+
+		case PIXEL_FORMAT_RGBX32:
+		case PIXEL_FORMAT_RGBA32:
+			return neon_RGBToAVC444YUV_X(pSrc, srcStep, pDst1, dst1Step, pDst2, dst2Step, roi, 0,
+			                             2);
+
+		default:
+			return generic->RGBToAVC444YUV(pSrc, srcFormat, srcStep, pDst1, dst1Step, pDst2,
+			                               dst2Step, roi);
+	}
+}
+
+/* Mapping of arguments, see general_RGBToAVC444YUVv2_BGRX_DOUBLE_ROW */
+static INLINE void neon_RGBToAVC444YUVv2_DOUBLE_ROW(
+    const BYTE* WINPR_RESTRICT srcEven, const BYTE* WINPR_RESTRICT srcOdd,
+    BYTE* WINPR_RESTRICT yLumaDstEven, BYTE* WINPR_RESTRICT yLumaDstOdd,
+    BYTE* WINPR_RESTRICT uLumaDst, BYTE* WINPR_RESTRICT vLumaDst,
+    BYTE* WINPR_RESTRICT yEvenChromaDst1, BYTE* WINPR_RESTRICT yEvenChromaDst2,
+    BYTE* WINPR_RESTRICT yOddChromaDst1, BYTE* WINPR_RESTRICT yOddChromaDst2,
+    BYTE* WINPR_RESTRICT uChromaDst1, BYTE* WINPR_RESTRICT uChromaDst2,
+    BYTE* WINPR_RESTRICT vChromaDst1, BYTE* WINPR_RESTRICT vChromaDst2, UINT32 width,
+    const uint8_t rPos, const uint8_t bPos)
+{
+	for (UINT32 x = 0; x < width; x += 16)
+	{
+		uint8x16_t Ye;
+		uint8x16_t Ue;
+		uint8x16_t Ve;
+		neon_RGBToYUV444_16(&srcEven[4ULL * x], rPos, bPos, &Ye, &Ue, &Ve);
+		vst1q_u8(yLumaDstEven, Ye);
+		yLumaDstEven += 16;
+
+		/* 2x+1, y [b4,b5] even */
+		vst1_u8(yEvenChromaDst1, neon_odd(Ue));
+		vst1_u8(yEvenChromaDst2, neon_odd(Ve));
+		yEvenChromaDst1 += 8;
+		yEvenChromaDst2 += 8;
+
+		if (srcOdd)
+		{
+			uint8x16_t Yo;
+			uint8x16_t Uo;
+			uint8x16_t Vo;
+			neon_RGBToYUV444_16(&srcOdd[4ULL * x], rPos, bPos, &Yo, &Uo, &Vo);
+			vst1q_u8(yLumaDstOdd, Yo);
+			yLumaDstOdd += 16;
+
+			/* 2x 2y [b2,b3] */
+			vst1_u8(uLumaDst, neon_avg2x2(Ue, &Uo));
+			vst1_u8(vLumaDst, neon_avg2x2(Ve, &Vo));
+
+			/* 2x+1, y [b4,b5] odd */
+			vst1_u8(yOddChromaDst1, neon_odd(Uo));
+			vst1_u8(yOddChromaDst2, neon_odd(Vo));
+			yOddChromaDst1 += 8;
+			yOddChromaDst2 += 8;
+
+			/* 4x 2y+1 [b6, b7] and 4x+2 2y+1 [b8, b9] */
+			{
+				const uint8x8_t Uc = neon_even(Uo);
+				const uint8x8_t Vc = neon_even(Vo);
+				const uint8x8x2_t U4 = vuzp_u8(Uc, Uc);
+				const uint8x8x2_t V4 = vuzp_u8(Vc, Vc);
+				neon_store4(uChromaDst1, U4.val[0]);
+				neon_store4(uChromaDst2, V4.val[0]);
+				neon_store4(vChromaDst1, U4.val[1]);
+				neon_store4(vChromaDst2, V4.val[1]);
+				uChromaDst1 += 4;
+				uChromaDst2 += 4;
+				vChromaDst1 += 4;
+				vChromaDst2 += 4;
+			}
+		}
+		else
+		{
+			vst1_u8(uLumaDst, neon_avg2x2(Ue, NULL));
+			vst1_u8(vLumaDst, neon_avg2x2(Ve, NULL));
+		}
+
+		uLumaDst += 8;
+		vLumaDst += 8;
+	}
+}
+
+static INLINE pstatus_t neon_RGBToAVC444YUVv2_X(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                                BYTE* WINPR_RESTRICT pDst1[3],
+                                                const UINT32 dst1Step[3],
+                                                BYTE* WINPR_RESTRICT pDst2[3],
+                                                const UINT32 dst2Step[3],
+                                                const prim_size_t* WINPR_RESTRICT roi,
+                                                const uint8_t rPos, const uint8_t bPos)
+{
+	for (size_t y = 0; y < roi->height; y += 2)
+	{
+		const BYTE* srcEven = (pSrc + y * srcStep);
+		const BYTE* srcOdd = (y < roi->height - 1) ? (srcEven + srcStep) : NULL;
+		BYTE* dstLumaYEven = (pDst1[0] + y * dst1Step[0]);
+		BYTE* dstLumaYOdd = (dstLumaYEven + dst1Step[0]);
+		BYTE* dstLumaU = (pDst1[1] + (y / 2) * dst1Step[1]);
+		BYTE* dstLumaV = (pDst1[2] + (y / 2) * dst1Step[2]);
+		BYTE* dstEvenChromaY1 = (pDst2[0] + y * dst2Step[0]);
+		BYTE* dstEvenChromaY2 = dstEvenChromaY1 + roi->width / 2;
+		BYTE* dstOddChromaY1 = dstEvenChromaY1 + dst2Step[0];
+		BYTE* dstOddChromaY2 = dstEvenChromaY2 + dst2Step[0];
+		BYTE* dstChromaU1 = (pDst2[1] + (y / 2) * dst2Step[1]);
+		BYTE* dstChromaV1 = (pDst2[2] + (y / 2) * dst2Step[2]);
+		BYTE* dstChromaU2 = dstChromaU1 + roi->width / 4;
+		BYTE* dstChromaV2 = dstChromaV1 + roi->width / 4;
+		neon_RGBToAVC444YUVv2_DOUBLE_ROW(srcEven, srcOdd, dstLumaYEven, dstLumaYOdd, dstLumaU,
+		                                 dstLumaV, dstEvenChromaY1, dstEvenChromaY2,
+		                                 dstOddChromaY1, dstOddChromaY2, dstChromaU1, dstChromaU2,
+		                                 dstChromaV1, dstChromaV2, roi->width, rPos, bPos);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+static pstatus_t neon_RGBToAVC444YUVv2(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcFormat,
+                                       UINT32 srcStep, BYTE* WINPR_RESTRICT pDst1[3],
+                                       const UINT32 dst1Step[3], BYTE* WINPR_RESTRICT pDst2[3],
+                                       const UINT32 dst2Step[3],
+                                       const prim_size_t* WINPR_RESTRICT roi)
+{
+	if (roi->height < 1 || roi->width < 1)
+		return !PRIMITIVES_SUCCESS;
+
+	if (roi->width % 16)
+		return generic->RGBToAVC444YUVv2(pSrc, srcFormat, srcStep, pDst1, dst1Step, pDst2,
+		                                 dst2Step, roi);
+
+	switch (srcFormat)
+	{
+		case PIXEL_FORMAT_BGRX32:
+		case PIXEL_FORMAT_BGRA32:
+			return neon_RGBToAVC444YUVv2_X(pSrc, srcStep, pDst1, dst1Step, pDst2, dst2Step, roi,
+			                               2, 0);
+
+		case PIXEL_FORMAT_RGBX32:
+		case PIXEL_FORMAT_RGBA32:
+			return neon_RGBToAVC444YUVv2_X(pSrc, srcStep, pDst1, dst1Step, pDst2, dst2Step, roi,
+			                               0, 2);
+
+		default:
+			return generic->RGBToAVC444YUVv2(pSrc, srcFormat, srcStep, pDst1, dst1Step, pDst2,
+			                                 dst2Step, roi);
+	}
+}
 #endif
 
 void primitives_init_YUV_neon(primitives_t* WINPR_RESTRICT prims)
@@ -744,6 +1160,9 @@ void primitives_init_YUV_neon(primitives_t* WINPR_RESTRICT prims)
 		prims->YUV420ToRGB_8u_P3AC4R = neon_YUV420ToRGB_8u_P3AC4R;
 		prims->YUV444ToRGB_8u_P3AC4R = neon_YUV444ToRGB_8u_P3AC4R;
 		prims->YUV420CombineToYUV444 = neon_YUV420CombineToYUV444;
+		prims->RGBToYUV420_8u_P3AC4R = neon_RGBToYUV420_8u_P3AC4R;
+		prims->RGBToAVC444YUV = neon_RGBToAVC444YUV;
+		prims->RGBToAVC444YUVv2 = neon_RGBToAVC444YUVv2;
 	}
 #else
 	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or neon intrinsics not available");
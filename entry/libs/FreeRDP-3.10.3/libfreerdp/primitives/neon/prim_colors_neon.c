@@ -341,6 +341,72 @@ neon_RGBToRGB_16s8u_P3AC4R(const INT16* WINPR_RESTRICT pSrc[3], /* 16-bit R,G, a
 			return generic->RGBToRGB_16s8u_P3AC4R(pSrc, srcStep, pDst, dstStep, DstFormat, roi);
 	}
 }
+
+/* The encoded YCbCr coefficients are 11.5 fixed-point numbers, see the generic version.
+ * The sums are computed in 32 bit with the same factors, so the results are identical. */
+static INLINE int16x4_t neon_RGBToYCbCr_sum(int16x4_t r, int16x4_t g, int16x4_t b, INT16 fr,
+                                            INT16 fg, INT16 fb)
+{
+	int32x4_t sum = vmull_n_s16(r, fr);
+	sum = vmlal_n_s16(sum, g, fg);
+	sum = vmlal_n_s16(sum, b, fb);
+	return vqmovn_s32(vshrq_n_s32(sum, 10));
+}
+
+static INLINE int16x8_t neon_RGBToYCbCr_8(int16x8_t r, int16x8_t g, int16x8_t b, INT16 fr,
+                                          INT16 fg, INT16 fb)
+{
+	return vcombine_s16(
+	    neon_RGBToYCbCr_sum(vget_low_s16(r), vget_low_s16(g), vget_low_s16(b), fr, fg, fb),
+	    neon_RGBToYCbCr_sum(vget_high_s16(r), vget_high_s16(g), vget_high_s16(b), fr, fg, fb));
+}
+
+static pstatus_t
+neon_RGBToYCbCr_16s16s_P3P3(const INT16* WINPR_RESTRICT pSrc[3], INT32 srcStep,
+                            INT16* WINPR_RESTRICT pDst[3], INT32 dstStep,
+                            const prim_size_t* WINPR_RESTRICT roi) /* region of interest */
+{
+	const int16x8_t min = vdupq_n_s16(-4096);
+	const int16x8_t max = vdupq_n_s16(4095);
+	const int16x8_t c4096 = vdupq_n_s16(4096);
+	const UINT32 wmax = roi->width & ~7u;
+
+	for (UINT32 yp = 0; yp < roi->height; yp++)
+	{
+		const INT16* rptr = (const INT16*)((const BYTE*)pSrc[0] + 1ULL * yp * srcStep);
+		const INT16* gptr = (const INT16*)((const BYTE*)pSrc[1] + 1ULL * yp * srcStep);
+		const INT16* bptr = (const INT16*)((const BYTE*)pSrc[2] + 1ULL * yp * srcStep);
+		INT16* yptr = (INT16*)((BYTE*)pDst[0] + 1ULL * yp * dstStep);
+		INT16* cbptr = (INT16*)((BYTE*)pDst[1] + 1ULL * yp * dstStep);
+		INT16* crptr = (INT16*)((BYTE*)pDst[2] + 1ULL * yp * dstStep);
+
+		for (UINT32 x = 0; x < wmax; x += 8)
+		{
+			const int16x8_t r = vld1q_s16(&rptr[x]);
+			const int16x8_t g = vld1q_s16(&gptr[x]);
+			const int16x8_t b = vld1q_s16(&bptr[x]);
+			/* Y:  0.299000 << 15 = 9798,  0.587000 << 15 = 19235, 0.114000 << 15 = 3735 */
+			const int16x8_t y = vqsubq_s16(neon_RGBToYCbCr_8(r, g, b, 9798, 19235, 3735), c4096);
+			/* Cb: 0.168935 << 15 = 5535,  0.331665 << 15 = 10868, 0.500590 << 15 = 16403 */
+			const int16x8_t cb = neon_RGBToYCbCr_8(r, g, b, -5535, -10868, 16403);
+			/* Cr: 0.499813 << 15 = 16377, 0.418531 << 15 = 13714, 0.081282 << 15 = 2663 */
+			const int16x8_t cr = neon_RGBToYCbCr_8(r, g, b, 16377, -13714, -2663);
+			vst1q_s16(&yptr[x], vminq_s16(vmaxq_s16(y, min), max));
+			vst1q_s16(&cbptr[x], vminq_s16(vmaxq_s16(cb, min), max));
+			vst1q_s16(&crptr[x], vminq_s16(vmaxq_s16(cr, min), max));
+		}
+	}
+
+	if (wmax < roi->width)
+	{
+		const INT16* pSrcRest[3] = { pSrc[0] + wmax, pSrc[1] + wmax, pSrc[2] + wmax };
+		INT16* pDstRest[3] = { pDst[0] + wmax, pDst[1] + wmax, pDst[2] + wmax };
+		const prim_size_t rest = { roi->width - wmax, roi->height };
+		return generic->RGBToYCbCr_16s16s_P3P3(pSrcRest, srcStep, pDstRest, dstStep, &rest);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
 #endif /* NEON_INTRINSICS_ENABLED */
 
 /* ------------------------------------------------------------------------- */
@@ -356,6 +422,7 @@ void primitives_init_colors_neon(primitives_t* prims)
 		prims->RGBToRGB_16s8u_P3AC4R = neon_RGBToRGB_16s8u_P3AC4R;
 		prims->yCbCrToRGB_16s8u_P3AC4R = neon_yCbCrToRGB_16s8u_P3AC4R;
 		prims->yCbCrToRGB_16s16s_P3P3 = neon_yCbCrToRGB_16s16s_P3P3;
+		prims->RGBToYCbCr_16s16s_P3P3 = neon_RGBToYCbCr_16s16s_P3P3;
 	}
 #else
 	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or neon intrinsics not available");
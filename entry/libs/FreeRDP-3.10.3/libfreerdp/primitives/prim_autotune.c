@@ -0,0 +1,863 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Per primitive backend selection
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+
+#include <winpr/crt.h>
+#include <winpr/file.h>
+#include <winpr/path.h>
+#include <winpr/string.h>
+#include <winpr/crypto.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/freerdp.h>
+#include <freerdp/log.h>
+
+#include "prim_autotune.h"
+
+#define TAG FREERDP_TAG("primitives.autotune")
+
+/* Full frame primitives run on a 256x64 strip, the 16 bit ones on a RemoteFX tile */
+#define PRIM_BENCH_WIDTH 256
+#define PRIM_BENCH_HEIGHT 64
+#define PRIM_BENCH_TILE 64
+
+#define PRIM_BENCH_ROUNDS 3
+#define PRIM_BENCH_ROUND_NS (500ULL * 1000ULL)
+#define PRIM_BENCH_MAX_ITERATIONS (1ULL << 20)
+
+/* Another backend has to be this much faster (in percent) to replace the default one */
+#define PRIM_BENCH_MARGIN 5
+
+#define PRIM_PROFILE_HEADER "# FreeRDP primitives profile"
+
+typedef struct
+{
+	BYTE* rgb;
+	BYTE* rgb2;
+	BYTE* dst;
+	BYTE* yuv[3];
+	BYTE* aux[3];
+	BYTE* yuv444[3];
+	INT16* s16[3];
+	INT16* d16[3];
+	UINT32 yuvStep[3];
+	prim_size_t roi;
+	prim_size_t tile;
+} prim_bench;
+
+typedef pstatus_t (*prim_bench_fn)(prim_bench* WINPR_RESTRICT bench,
+                                   const primitives_t* WINPR_RESTRICT prims);
+typedef void (*prim_fn)(void);
+
+typedef struct
+{
+	const char* name;
+	size_t offset;
+	prim_bench_fn bench;
+} prim_slot;
+
+#define RGB_STEP (PRIM_BENCH_WIDTH * 4)
+#define TILE_PIXELS (PRIM_BENCH_TILE * PRIM_BENCH_TILE)
+#define TILE_STEP (PRIM_BENCH_TILE * sizeof(INT16))
+
+static pstatus_t bench_copy(prim_bench* WINPR_RESTRICT bench,
+                            const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->copy(bench->rgb, bench->dst, RGB_STEP * PRIM_BENCH_HEIGHT);
+}
+
+static pstatus_t bench_copy_8u(prim_bench* WINPR_RESTRICT bench,
+                               const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->copy_8u(bench->rgb, bench->dst, RGB_STEP * PRIM_BENCH_HEIGHT);
+}
+
+static pstatus_t bench_copy_8u_AC4r(prim_bench* WINPR_RESTRICT bench,
+                                    const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->copy_8u_AC4r(bench->rgb, RGB_STEP, bench->dst, RGB_STEP, PRIM_BENCH_WIDTH,
+	                           PRIM_BENCH_HEIGHT);
+}
+
+static pstatus_t bench_set_8u(prim_bench* WINPR_RESTRICT bench,
+                              const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->set_8u(0xA5, bench->dst, RGB_STEP * PRIM_BENCH_HEIGHT);
+}
+
+static pstatus_t bench_set_32s(prim_bench* WINPR_RESTRICT bench,
+                               const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->set_32s(-42, (INT32*)bench->dst, PRIM_BENCH_WIDTH * PRIM_BENCH_HEIGHT);
+}
+
+static pstatus_t bench_set_32u(prim_bench* WINPR_RESTRICT bench,
+                               const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->set_32u(0xFF00FF00, (UINT32*)bench->dst, PRIM_BENCH_WIDTH * PRIM_BENCH_HEIGHT);
+}
+
+static pstatus_t bench_zero(prim_bench* WINPR_RESTRICT bench,
+                            const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->zero(bench->dst, RGB_STEP * PRIM_BENCH_HEIGHT);
+}
+
+static pstatus_t bench_add_16s(prim_bench* WINPR_RESTRICT bench,
+                               const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->add_16s(bench->s16[0], bench->s16[1], bench->d16[0], TILE_PIXELS);
+}
+
+static pstatus_t bench_andC_32u(prim_bench* WINPR_RESTRICT bench,
+                                const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->andC_32u((const UINT32*)bench->rgb, 0x00FFFFFF, (UINT32*)bench->dst,
+	                       PRIM_BENCH_WIDTH * PRIM_BENCH_HEIGHT);
+}
+
+static pstatus_t bench_orC_32u(prim_bench* WINPR_RESTRICT bench,
+                               const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->orC_32u((const UINT32*)bench->rgb, 0xFF000000, (UINT32*)bench->dst,
+	                      PRIM_BENCH_WIDTH * PRIM_BENCH_HEIGHT);
+}
+
+static pstatus_t bench_lShiftC_16s(prim_bench* WINPR_RESTRICT bench,
+                                   const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->lShiftC_16s(bench->s16[0], 2, bench->d16[0], TILE_PIXELS);
+}
+
+static pstatus_t bench_lShiftC_16u(prim_bench* WINPR_RESTRICT bench,
+                                   const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->lShiftC_16u((const UINT16*)bench->s16[0], 2, (UINT16*)bench->d16[0],
+	                          TILE_PIXELS);
+}
+
+static pstatus_t bench_rShiftC_16s(prim_bench* WINPR_RESTRICT bench,
+                                   const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->rShiftC_16s(bench->s16[0], 2, bench->d16[0], TILE_PIXELS);
+}
+
+static pstatus_t bench_rShiftC_16u(prim_bench* WINPR_RESTRICT bench,
+                                   const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->rShiftC_16u((const UINT16*)bench->s16[0], 2, (UINT16*)bench->d16[0],
+	                          TILE_PIXELS);
+}
+
+static pstatus_t bench_shiftC_16s(prim_bench* WINPR_RESTRICT bench,
+                                  const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->shiftC_16s(bench->s16[0], -2, bench->d16[0], TILE_PIXELS);
+}
+
+static pstatus_t bench_shiftC_16u(prim_bench* WINPR_RESTRICT bench,
+                                  const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->shiftC_16u((const UINT16*)bench->s16[0], -2, (UINT16*)bench->d16[0],
+	                         TILE_PIXELS);
+}
+
+static pstatus_t bench_alphaComp_argb(prim_bench* WINPR_RESTRICT bench,
+                                      const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->alphaComp_argb(bench->rgb, RGB_STEP, bench->rgb2, RGB_STEP, bench->dst,
+	                             RGB_STEP, PRIM_BENCH_WIDTH, PRIM_BENCH_HEIGHT);
+}
+
+static pstatus_t bench_sign_16s(prim_bench* WINPR_RESTRICT bench,
+                                const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->sign_16s(bench->s16[0], bench->d16[0], TILE_PIXELS);
+}
+
+static pstatus_t bench_yCbCrToRGB_16s8u_P3AC4R(prim_bench* WINPR_RESTRICT bench,
+                                               const primitives_t* WINPR_RESTRICT prims)
+{
+	const INT16* src[3] = { bench->s16[0], bench->s16[1], bench->s16[2] };
+	return prims->yCbCrToRGB_16s8u_P3AC4R(src, TILE_STEP, bench->dst, PRIM_BENCH_TILE * 4,
+	                                      PIXEL_FORMAT_BGRX32, &bench->tile);
+}
+
+static pstatus_t bench_yCbCrToRGB_16s16s_P3P3(prim_bench* WINPR_RESTRICT bench,
+                                              const primitives_t* WINPR_RESTRICT prims)
+{
+	const INT16* src[3] = { bench->s16[0], bench->s16[1], bench->s16[2] };
+	return prims->yCbCrToRGB_16s16s_P3P3(src, TILE_STEP, bench->d16, TILE_STEP, &bench->tile);
+}
+
+static pstatus_t bench_RGBToYCbCr_16s16s_P3P3(prim_bench* WINPR_RESTRICT bench,
+                                              const primitives_t* WINPR_RESTRICT prims)
+{
+	const INT16* src[3] = { bench->s16[0], bench->s16[1], bench->s16[2] };
+	return prims->RGBToYCbCr_16s16s_P3P3(src, TILE_STEP, bench->d16, TILE_STEP, &bench->tile);
+}
+
+static pstatus_t bench_RGBToRGB_16s8u_P3AC4R(prim_bench* WINPR_RESTRICT bench,
+                                             const primitives_t* WINPR_RESTRICT prims)
+{
+	const INT16* src[3] = { bench->s16[0], bench->s16[1], bench->s16[2] };
+	return prims->RGBToRGB_16s8u_P3AC4R(src, TILE_STEP, bench->dst, PRIM_BENCH_TILE * 4,
+	                                    PIXEL_FORMAT_BGRX32, &bench->tile);
+}
+
+static pstatus_t bench_YCoCgToRGB_8u_AC4R(prim_bench* WINPR_RESTRICT bench,
+                                          const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->YCoCgToRGB_8u_AC4R(bench->rgb, RGB_STEP, bench->dst, PIXEL_FORMAT_BGRX32,
+	                                 RGB_STEP, PRIM_BENCH_WIDTH, PRIM_BENCH_HEIGHT, 1, TRUE);
+}
+
+static pstatus_t bench_YUV420ToRGB_8u_P3AC4R(prim_bench* WINPR_RESTRICT bench,
+                                             const primitives_t* WINPR_RESTRICT prims)
+{
+	const BYTE* src[3] = { bench->yuv[0], bench->yuv[1], bench->yuv[2] };
+	return prims->YUV420ToRGB_8u_P3AC4R(src, bench->yuvStep, bench->dst, RGB_STEP,
+	                                    PIXEL_FORMAT_BGRX32, &bench->roi);
+}
+
+static pstatus_t bench_RGBToYUV420_8u_P3AC4R(prim_bench* WINPR_RESTRICT bench,
+                                             const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->RGBToYUV420_8u_P3AC4R(bench->rgb, PIXEL_FORMAT_BGRX32, RGB_STEP, bench->yuv,
+	                                    bench->yuvStep, &bench->roi);
+}
+
+static pstatus_t bench_RGBToYUV444_8u_P3AC4R(prim_bench* WINPR_RESTRICT bench,
+                                             const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->RGBToYUV444_8u_P3AC4R(bench->rgb, PIXEL_FORMAT_BGRX32, RGB_STEP, bench->yuv444,
+	                                    bench->yuvStep, &bench->roi);
+}
+
+static pstatus_t bench_YUV420CombineToYUV444(prim_bench* WINPR_RESTRICT bench,
+                                             const primitives_t* WINPR_RESTRICT prims)
+{
+	const BYTE* src[3] = { bench->aux[0], bench->aux[1], bench->aux[2] };
+	const RECTANGLE_16 rect = { 0, 0, PRIM_BENCH_WIDTH, PRIM_BENCH_HEIGHT };
+	return prims->YUV420CombineToYUV444(AVC444_CHROMAv1, src, bench->yuvStep, PRIM_BENCH_WIDTH,
+	                                    PRIM_BENCH_HEIGHT, bench->yuv444, bench->yuvStep, &rect);
+}
+
+static pstatus_t bench_YUV444SplitToYUV420(prim_bench* WINPR_RESTRICT bench,
+                                           const primitives_t* WINPR_RESTRICT prims)
+{
+	const BYTE* src[3] = { bench->yuv444[0], bench->yuv444[1], bench->yuv444[2] };
+	return prims->YUV444SplitToYUV420(src, bench->yuvStep, bench->yuv, bench->yuvStep, bench->aux,
+	                                  bench->yuvStep, &bench->roi);
+}
+
+static pstatus_t bench_YUV444ToRGB_8u_P3AC4R(prim_bench* WINPR_RESTRICT bench,
+                                             const primitives_t* WINPR_RESTRICT prims)
+{
+	const BYTE* src[3] = { bench->yuv444[0], bench->yuv444[1], bench->yuv444[2] };
+	return prims->YUV444ToRGB_8u_P3AC4R(src, bench->yuvStep, bench->dst, RGB_STEP,
+	                                    PIXEL_FORMAT_BGRX32, &bench->roi);
+}
+
+static pstatus_t bench_RGBToAVC444YUV(prim_bench* WINPR_RESTRICT bench,
+                                      const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->RGBToAVC444YUV(bench->rgb, PIXEL_FORMAT_BGRX32, RGB_STEP, bench->yuv,
+	                             bench->yuvStep, bench->aux, bench->yuvStep, &bench->roi);
+}
+
+static pstatus_t bench_RGBToAVC444YUVv2(prim_bench* WINPR_RESTRICT bench,
+                                        const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->RGBToAVC444YUVv2(bench->rgb, PIXEL_FORMAT_BGRX32, RGB_STEP, bench->yuv,
+	                               bench->yuvStep, bench->aux, bench->yuvStep, &bench->roi);
+}
+
+static pstatus_t bench_add_16s_inplace(prim_bench* WINPR_RESTRICT bench,
+                                       const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->add_16s_inplace(bench->d16[0], bench->d16[1], TILE_PIXELS);
+}
+
+static pstatus_t bench_lShiftC_16s_inplace(prim_bench* WINPR_RESTRICT bench,
+                                           const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->lShiftC_16s_inplace(bench->d16[2], 1, TILE_PIXELS);
+}
+
+static pstatus_t bench_copy_no_overlap(prim_bench* WINPR_RESTRICT bench,
+                                       const primitives_t* WINPR_RESTRICT prims)
+{
+	return prims->copy_no_overlap(bench->dst, PIXEL_FORMAT_BGRX32, RGB_STEP, 0, 0,
+	                              PRIM_BENCH_WIDTH, PRIM_BENCH_HEIGHT, bench->rgb,
+	                              PIXEL_FORMAT_BGRA32, RGB_STEP, 0, 0, NULL, FREERDP_FLIP_NONE);
+}
+
+#define PRIM_SLOT(fkt) { #fkt, offsetof(primitives_t, fkt), bench_##fkt }
+
+static const prim_slot slots[] = { PRIM_SLOT(copy),
+	                               PRIM_SLOT(copy_8u),
+	                               PRIM_SLOT(copy_8u_AC4r),
+	                               PRIM_SLOT(set_8u),
+	                               PRIM_SLOT(set_32s),
+	                               PRIM_SLOT(set_32u),
+	                               PRIM_SLOT(zero),
+	                               PRIM_SLOT(add_16s),
+	                               PRIM_SLOT(andC_32u),
+	                               PRIM_SLOT(orC_32u),
+	                               PRIM_SLOT(lShiftC_16s),
+	                               PRIM_SLOT(lShiftC_16u),
+	                               PRIM_SLOT(rShiftC_16s),
+	                               PRIM_SLOT(rShiftC_16u),
+	                               PRIM_SLOT(shiftC_16s),
+	                               PRIM_SLOT(shiftC_16u),
+	                               PRIM_SLOT(alphaComp_argb),
+	                               PRIM_SLOT(sign_16s),
+	                               PRIM_SLOT(yCbCrToRGB_16s8u_P3AC4R),
+	                               PRIM_SLOT(yCbCrToRGB_16s16s_P3P3),
+	                               PRIM_SLOT(RGBToYCbCr_16s16s_P3P3),
+	                               PRIM_SLOT(RGBToRGB_16s8u_P3AC4R),
+	                               PRIM_SLOT(YCoCgToRGB_8u_AC4R),
+	                               PRIM_SLOT(YUV420ToRGB_8u_P3AC4R),
+	                               PRIM_SLOT(RGBToYUV420_8u_P3AC4R),
+	                               PRIM_SLOT(RGBToYUV444_8u_P3AC4R),
+	                               PRIM_SLOT(YUV420CombineToYUV444),
+	                               PRIM_SLOT(YUV444SplitToYUV420),
+	                               PRIM_SLOT(YUV444ToRGB_8u_P3AC4R),
+	                               PRIM_SLOT(RGBToAVC444YUV),
+	                               PRIM_SLOT(RGBToAVC444YUVv2),
+	                               PRIM_SLOT(add_16s_inplace),
+	                               PRIM_SLOT(lShiftC_16s_inplace),
+	                               PRIM_SLOT(copy_no_overlap) };
+
+typedef struct
+{
+	size_t choice[ARRAYSIZE(slots)];
+	UINT64 ns[ARRAYSIZE(slots)][PRIM_AUTOTUNE_MAX_BACKENDS];
+	char cpu[512];
+	char build[128];
+	BOOL cached;
+} prim_autotune_result;
+
+static prim_fn slot_get(const primitives_t* WINPR_RESTRICT prims, const prim_slot* slot)
+{
+	prim_fn fn = NULL;
+	memcpy((void*)&fn, (const BYTE*)prims + slot->offset, sizeof(fn));
+	return fn;
+}
+
+static void slot_set(primitives_t* WINPR_RESTRICT prims, const prim_slot* slot, prim_fn fn)
+{
+	memcpy((BYTE*)prims + slot->offset, (const void*)&fn, sizeof(fn));
+}
+
+static void bench_free(prim_bench* bench)
+{
+	winpr_aligned_free(bench->rgb);
+	winpr_aligned_free(bench->rgb2);
+	winpr_aligned_free(bench->dst);
+
+	for (size_t x = 0; x < 3; x++)
+	{
+		winpr_aligned_free(bench->yuv[x]);
+		winpr_aligned_free(bench->aux[x]);
+		winpr_aligned_free(bench->yuv444[x]);
+		winpr_aligned_free(bench->s16[x]);
+		winpr_aligned_free(bench->d16[x]);
+	}
+}
+
+static BOOL bench_init(prim_bench* bench)
+{
+	const size_t rgbSize = 1ULL * RGB_STEP * PRIM_BENCH_HEIGHT;
+	const size_t planeSize = 1ULL * PRIM_BENCH_WIDTH * PRIM_BENCH_HEIGHT;
+
+	bench->roi.width = PRIM_BENCH_WIDTH;
+	bench->roi.height = PRIM_BENCH_HEIGHT;
+	bench->tile.width = PRIM_BENCH_TILE;
+	bench->tile.height = PRIM_BENCH_TILE;
+
+	bench->rgb = winpr_aligned_calloc(rgbSize, 1, 32);
+	bench->rgb2 = winpr_aligned_calloc(rgbSize, 1, 32);
+	bench->dst = winpr_aligned_calloc(rgbSize, 1, 32);
+	if (!bench->rgb || !bench->rgb2 || !bench->dst)
+		return FALSE;
+
+	winpr_RAND(bench->rgb, rgbSize);
+	winpr_RAND(bench->rgb2, rgbSize);
+
+	for (size_t x = 0; x < 3; x++)
+	{
+		bench->yuvStep[x] = PRIM_BENCH_WIDTH;
+		bench->yuv[x] = winpr_aligned_calloc(planeSize, 1, 32);
+		bench->aux[x] = winpr_aligned_calloc(planeSize, 1, 32);
+		bench->yuv444[x] = winpr_aligned_calloc(planeSize, 1, 32);
+		bench->s16[x] = winpr_aligned_calloc(TILE_PIXELS, sizeof(INT16), 32);
+		bench->d16[x] = winpr_aligned_calloc(TILE_PIXELS, sizeof(INT16), 32);
+		if (!bench->yuv[x] || !bench->aux[x] || !bench->yuv444[x] || !bench->s16[x] ||
+		    !bench->d16[x])
+			return FALSE;
+
+		winpr_RAND(bench->yuv[x], planeSize);
+		winpr_RAND(bench->aux[x], planeSize);
+		winpr_RAND(bench->yuv444[x], planeSize);
+
+		/* 11.5 fixed point RemoteFX coefficients */
+		winpr_RAND(bench->s16[x], TILE_PIXELS * sizeof(INT16));
+		for (size_t y = 0; y < TILE_PIXELS; y++)
+			bench->s16[x][y] = (INT16)(bench->s16[x][y] % 4096);
+	}
+
+	return TRUE;
+}
+
+/** @return The best time of a call in nanoseconds or \b UINT64_MAX if the primitive failed */
+static UINT64 bench_slot(prim_bench* bench, const prim_slot* slot, const primitives_t* prims)
+{
+	UINT64 best = UINT64_MAX;
+	UINT64 iterations = 1;
+
+	/* A first run to warm up caches and lazily initialized tables */
+	if (slot->bench(bench, prims) != PRIMITIVES_SUCCESS)
+		return UINT64_MAX;
+
+	for (size_t round = 0; round < PRIM_BENCH_ROUNDS;)
+	{
+		const UINT64 start = winpr_GetTickCount64NS();
+		for (UINT64 x = 0; x < iterations; x++)
+			(void)slot->bench(bench, prims);
+		const UINT64 elapsed = winpr_GetTickCount64NS() - start;
+
+		if ((elapsed < PRIM_BENCH_ROUND_NS) && (iterations < PRIM_BENCH_MAX_ITERATIONS))
+		{
+			iterations *= 2;
+			continue;
+		}
+
+		const UINT64 ns = elapsed / iterations;
+		if (ns < best)
+			best = ns;
+		round++;
+	}
+
+	return best;
+}
+
+static BOOL autotune_measure(const prim_autotune_backend* backends, size_t count,
+                             prim_autotune_result* result)
+{
+	prim_bench bench = { 0 };
+	const size_t fallback = count - 1;
+
+	if (!bench_init(&bench))
+	{
+		bench_free(&bench);
+		return FALSE;
+	}
+
+	for (size_t s = 0; s < ARRAYSIZE(slots); s++)
+	{
+		const prim_slot* slot = &slots[s];
+		BOOL distinct = FALSE;
+
+		for (size_t b = 1; b < count; b++)
+			distinct |= slot_get(backends[b].prims, slot) != slot_get(backends[0].prims, slot);
+
+		/* All backends share the same implementation, nothing to choose from */
+		if (!distinct)
+			continue;
+
+		for (size_t b = 0; b < count; b++)
+		{
+			size_t same = b;
+			for (size_t o = 0; o < b; o++)
+			{
+				if (slot_get(backends[o].prims, slot) == slot_get(backends[b].prims, slot))
+				{
+					same = o;
+					break;
+				}
+			}
+
+			if (same != b)
+				result->ns[s][b] = result->ns[s][same];
+			else
+				result->ns[s][b] = bench_slot(&bench, slot, backends[b].prims);
+		}
+
+		size_t best = fallback;
+		for (size_t b = 0; b < count; b++)
+		{
+			const UINT64 ns = result->ns[s][b];
+			if ((ns == UINT64_MAX) || (ns == 0))
+				continue;
+
+			if ((result->ns[s][best] == UINT64_MAX) ||
+			    (ns * 100 < result->ns[s][best] * (100 - PRIM_BENCH_MARGIN)))
+				best = b;
+		}
+		result->choice[s] = best;
+
+		WLog_DBG(TAG, "%s: using %s", slot->name, backends[best].name);
+	}
+
+	bench_free(&bench);
+	return TRUE;
+}
+
+static UINT64 autotune_cpu_features(void)
+{
+	UINT64 features = 0;
+
+	/* Only ask for what the primitives are built for, other checks log a warning */
+#if defined(_M_IX86_AMD64) || defined(_M_ARM) || defined(_M_ARM64) || defined(ANDROID)
+	static const DWORD known[] = {
+#if defined(_M_IX86_AMD64)
+		PF_MMX_INSTRUCTIONS_AVAILABLE,    PF_XMMI_INSTRUCTIONS_AVAILABLE,
+		PF_XMMI64_INSTRUCTIONS_AVAILABLE, PF_SSE3_INSTRUCTIONS_AVAILABLE,
+		PF_SSSE3_INSTRUCTIONS_AVAILABLE,  PF_SSE4_1_INSTRUCTIONS_AVAILABLE,
+		PF_SSE4_2_INSTRUCTIONS_AVAILABLE, PF_AVX_INSTRUCTIONS_AVAILABLE,
+		PF_AVX2_INSTRUCTIONS_AVAILABLE,   PF_AVX512F_INSTRUCTIONS_AVAILABLE,
+#else
+		PF_ARM_NEON_INSTRUCTIONS_AVAILABLE,
+#endif
+	};
+
+	for (size_t x = 0; x < ARRAYSIZE(known); x++)
+	{
+		if (IsProcessorFeaturePresent(known[x]))
+			features |= (1ULL << known[x]);
+	}
+#endif
+
+	return features;
+}
+
+static void autotune_cpu_id(char* id, size_t size)
+{
+	SYSTEM_INFO info = { 0 };
+	const UINT64 features = autotune_cpu_features();
+
+	GetSystemInfo(&info);
+	const int rc = _snprintf(id, size, "n=%" PRIu32 " f=%016" PRIx64, info.dwNumberOfProcessors,
+	                         features);
+	if ((rc < 0) || ((size_t)rc >= size))
+		return;
+
+#if defined(__linux__)
+	/* Hybrid systems list a different model (or part) per core type, all of them go into the id */
+	static const char* keys[] = { "model name", "Hardware", "CPU implementer", "CPU part" };
+	char line[256] = { 0 };
+	size_t len = (size_t)rc;
+
+	FILE* fp = winpr_fopen("/proc/cpuinfo", "r");
+	if (!fp)
+		return;
+
+	while (fgets(line, sizeof(line), fp))
+	{
+		char* sep = strchr(line, ':');
+		if (!sep)
+			continue;
+
+		BOOL match = FALSE;
+		for (size_t x = 0; x < ARRAYSIZE(keys); x++)
+			match |= strncmp(line, keys[x], strlen(keys[x])) == 0;
+		if (!match)
+			continue;
+
+		char* value = sep + 1;
+		while (*value == ' ' || *value == '\t')
+			value++;
+		value[strcspn(value, "\r\n")] = '\0';
+
+		if ((*value == '\0') || strstr(id, value))
+			continue;
+
+		const int n = _snprintf(&id[len], size - len, " %s", value);
+		if ((n < 0) || ((size_t)n >= size - len))
+			break;
+		len += (size_t)n;
+	}
+
+	(void)fclose(fp);
+#endif
+}
+
+static void autotune_build_id(char* id, size_t size)
+{
+	/* FNV-1a of the build configuration, it covers the compiler flags and enabled features */
+	UINT32 hash = 2166136261u;
+	for (const char* cur = freerdp_get_build_config(); *cur; cur++)
+	{
+		hash ^= (BYTE)*cur;
+		hash *= 16777619u;
+	}
+
+	(void)_snprintf(id, size, "%s-%s-%08" PRIx32, freerdp_get_version_string(),
+	                freerdp_get_build_revision(), hash);
+}
+
+static BOOL profile_load(const char* profile, const prim_autotune_backend* backends, size_t count,
+                         prim_autotune_result* result)
+{
+	char line[640] = { 0 };
+	BOOL cpu = FALSE;
+	BOOL build = FALSE;
+	size_t choice[ARRAYSIZE(slots)] = { 0 };
+
+	FILE* fp = winpr_fopen(profile, "r");
+	if (!fp)
+		return FALSE;
+
+	for (size_t s = 0; s < ARRAYSIZE(slots); s++)
+		choice[s] = result->choice[s];
+
+	while (fgets(line, sizeof(line), fp))
+	{
+		line[strcspn(line, "\r\n")] = '\0';
+		if (line[0] == '#')
+			continue;
+
+		char* value = strchr(line, '=');
+		if (!value)
+			continue;
+		*value++ = '\0';
+
+		if (strcmp(line, "cpu") == 0)
+			cpu = strcmp(value, result->cpu) == 0;
+		else if (strcmp(line, "build") == 0)
+			build = strcmp(value, result->build) == 0;
+		else
+		{
+			for (size_t s = 0; s < ARRAYSIZE(slots); s++)
+			{
+				if (strcmp(line, slots[s].name) != 0)
+					continue;
+
+				for (size_t b = 0; b < count; b++)
+				{
+					if (strcmp(value, backends[b].name) == 0)
+						choice[s] = b;
+				}
+			}
+		}
+	}
+
+	(void)fclose(fp);
+
+	if (!cpu || !build)
+	{
+		WLog_DBG(TAG, "profile %s is for another CPU or build", profile);
+		return FALSE;
+	}
+
+	for (size_t s = 0; s < ARRAYSIZE(slots); s++)
+		result->choice[s] = choice[s];
+	return TRUE;
+}
+
+static BOOL profile_make_directory(const char* profile)
+{
+	char* dir = _strdup(profile);
+	if (!dir)
+		return FALSE;
+
+	char* sep = strrchr(dir, '/');
+#if defined(_WIN32)
+	char* bsep = strrchr(dir, '\\');
+	if (bsep > sep)
+		sep = bsep;
+#endif
+
+	BOOL rc = TRUE;
+	if (sep && (sep != dir))
+	{
+		*sep = '\0';
+		if (!winpr_PathFileExists(dir))
+			rc = winpr_PathMakePath(dir, NULL);
+	}
+
+	free(dir);
+	return rc;
+}
+
+static void profile_save(const char* profile, const prim_autotune_backend* backends,
+                         const prim_autotune_result* result)
+{
+	char tmp[MAX_PATH] = { 0 };
+
+	if (_snprintf(tmp, sizeof(tmp), "%s.tmp", profile) >= (int)sizeof(tmp))
+		return;
+
+	if (!profile_make_directory(profile))
+	{
+		WLog_WARN(TAG, "failed to create the directory for %s", profile);
+		return;
+	}
+
+	FILE* fp = winpr_fopen(tmp, "w");
+	if (!fp)
+	{
+		WLog_WARN(TAG, "failed to write primitives profile %s", tmp);
+		return;
+	}
+
+	BOOL rc = fprintf(fp, "%s\ncpu=%s\nbuild=%s\n", PRIM_PROFILE_HEADER, result->cpu,
+	                  result->build) > 0;
+	for (size_t s = 0; rc && (s < ARRAYSIZE(slots)); s++)
+		rc = fprintf(fp, "%s=%s\n", slots[s].name, backends[result->choice[s]].name) > 0;
+	rc &= fclose(fp) == 0;
+
+	if (!rc || !MoveFileExA(tmp, profile, MOVEFILE_REPLACE_EXISTING))
+	{
+		WLog_WARN(TAG, "failed to update primitives profile %s", profile);
+		(void)DeleteFileA(tmp);
+	}
+}
+
+WINPR_ATTR_FORMAT_ARG(3, 4)
+static BOOL report_append(char** report, size_t* len, WINPR_FORMAT_ARG const char* fmt, ...)
+{
+	char* line = NULL;
+	size_t linelen = 0;
+	va_list ap;
+
+	va_start(ap, fmt);
+	const int rc = winpr_vasprintf(&line, &linelen, fmt, ap);
+	va_end(ap);
+	if (rc < 0)
+		return FALSE;
+
+	char* tmp = realloc(*report, *len + linelen + 1);
+	if (!tmp)
+	{
+		free(line);
+		return FALSE;
+	}
+
+	memcpy(&tmp[*len], line, linelen + 1);
+	*report = tmp;
+	*len += linelen;
+	free(line);
+	return TRUE;
+}
+
+static char* autotune_report(const prim_autotune_backend* backends, size_t count,
+                             const prim_autotune_result* result, const char* profile)
+{
+	char* report = NULL;
+	size_t len = 0;
+
+	BOOL rc = report_append(&report, &len, "cpu:    %s\nbuild:  %s\nsource: %s%s\n\n",
+	                        result->cpu, result->build,
+	                        result->cached ? "profile " : "benchmark",
+	                        result->cached ? profile : "");
+	rc &= report_append(&report, &len, "%-28s %-10s", "primitive", "backend");
+	for (size_t b = 0; b < count; b++)
+		rc &= report_append(&report, &len, " %10s", backends[b].name);
+	rc &= report_append(&report, &len, "%s", "  [ns/call]\n");
+
+	for (size_t s = 0; rc && (s < ARRAYSIZE(slots)); s++)
+	{
+		rc &= report_append(&report, &len, "%-28s %-10s", slots[s].name,
+		                    backends[result->choice[s]].name);
+
+		for (size_t b = 0; b < count; b++)
+		{
+			const UINT64 ns = result->ns[s][b];
+			if (ns == 0)
+				rc &= report_append(&report, &len, " %10s", "-");
+			else if (ns == UINT64_MAX)
+				rc &= report_append(&report, &len, " %10s", "failed");
+			else
+				rc &= report_append(&report, &len, " %10" PRIu64, ns);
+		}
+		rc &= report_append(&report, &len, "%s", "\n");
+	}
+
+	if (!rc)
+	{
+		free(report);
+		return NULL;
+	}
+	return report;
+}
+
+BOOL primitives_autotune_run(primitives_t* WINPR_RESTRICT prims,
+                             const prim_autotune_backend* backends, size_t count,
+                             const char* profile, BOOL force, char** report)
+{
+	WINPR_ASSERT(prims);
+	WINPR_ASSERT(backends);
+
+	if ((count == 0) || (count > PRIM_AUTOTUNE_MAX_BACKENDS))
+		return FALSE;
+
+	prim_autotune_result* result = calloc(1, sizeof(prim_autotune_result));
+	if (!result)
+		return FALSE;
+
+	for (size_t s = 0; s < ARRAYSIZE(slots); s++)
+		result->choice[s] = count - 1;
+	autotune_cpu_id(result->cpu, sizeof(result->cpu));
+	autotune_build_id(result->build, sizeof(result->build));
+
+	if (profile && !force)
+		result->cached = profile_load(profile, backends, count, result);
+
+	if (!result->cached)
+	{
+		const UINT64 start = winpr_GetTickCount64NS();
+		if (!autotune_measure(backends, count, result))
+		{
+			free(result);
+			return FALSE;
+		}
+		WLog_DBG(TAG, "benchmark took %" PRIu64 "ms", (winpr_GetTickCount64NS() - start) / 1000000);
+
+		if (profile)
+			profile_save(profile, backends, result);
+	}
+
+	const primitives_t* generic = backends[0].prims;
+	DWORD flags = generic->flags;
+
+	*prims = *backends[count - 1].prims;
+	for (size_t s = 0; s < ARRAYSIZE(slots); s++)
+	{
+		const primitives_t* chosen = backends[result->choice[s]].prims;
+		const prim_fn fn = slot_get(chosen, &slots[s]);
+
+		slot_set(prims, &slots[s], fn);
+		if (fn != slot_get(generic, &slots[s]))
+			flags |= chosen->flags;
+	}
+	prims->flags = flags;
+
+	if (report)
+		*report = autotune_report(backends, count, result, profile);
+
+	free(result);
+	return TRUE;
+}
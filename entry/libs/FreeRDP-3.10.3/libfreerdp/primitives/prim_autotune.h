@@ -0,0 +1,52 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Per primitive backend selection
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_PRIM_AUTOTUNE_H
+#define FREERDP_LIB_PRIM_AUTOTUNE_H
+
+#include <winpr/wtypes.h>
+#include <freerdp/config.h>
+#include <freerdp/api.h>
+#include <freerdp/primitives.h>
+
+#define PRIM_AUTOTUNE_MAX_BACKENDS 3
+
+typedef struct
+{
+	const char* name;
+	const primitives_t* prims;
+} prim_autotune_backend;
+
+/** @brief Combine the fastest implementation of every primitive into \b prims
+ *
+ *  The first backend is the reference (generic) one, the last one provides the
+ *  implementations of primitives that can not be told apart.
+ *
+ *  @param prims The table to fill
+ *  @param backends The available backends, at most \b PRIM_AUTOTUNE_MAX_BACKENDS
+ *  @param count The number of backends
+ *  @param profile An optional file the result is cached in
+ *  @param force Benchmark even if \b profile holds a result for this CPU and build
+ *  @param report Optional, receives a text table of the selection, free with \b free
+ *
+ *  @return \b TRUE for success, \b FALSE otherwise
+ */
+FREERDP_LOCAL BOOL primitives_autotune_run(primitives_t* WINPR_RESTRICT prims,
+                                           const prim_autotune_backend* backends, size_t count,
+                                           const char* profile, BOOL force, char** report);
+
+#endif /* FREERDP_LIB_PRIM_AUTOTUNE_H */
@@ -58,7 +58,8 @@ static pstatus_t general_set_32s(INT32 val, INT32* pDst, UINT32 len)
 	span = 1;
 	*dptr = val;
 	remaining = len - 1;
-	prims = primitives_get();
+	/* Only the generic copy exists and the tuned table might still be under construction */
+	prims = primitives_get_generic();
 
 	while (remaining)
 	{
@@ -97,7 +98,7 @@ static pstatus_t general_set_32u(UINT32 val, UINT32* pDst, UINT32 len)
 	span = 1;
 	*dptr = val;
 	remaining = len - 1;
-	prims = primitives_get();
+	prims = primitives_get_generic();
 
 	while (remaining)
 	{
@@ -23,10 +23,11 @@
 
 #include <winpr/synch.h>
 #include <winpr/sysinfo.h>
-#include <winpr/crypto.h>
+#include <winpr/environment.h>
 #include <freerdp/primitives.h>
 
 #include "prim_internal.h"
+#include "prim_autotune.h"
 
 #include <freerdp/log.h>
 #define TAG FREERDP_TAG("primitives")
@@ -64,6 +65,10 @@ static INIT_ONCE auto_primitives_InitOnce = INIT_ONCE_STATIC_INIT;
 
 static primitives_t pPrimitives = { 0 };
 
+/* file the per primitive selection is cached in, once set it overrides the environment */
+static char* primitivesProfile = NULL;
+static BOOL primitivesProfileSet = FALSE;
+
 /* ------------------------------------------------------------------------- */
 static BOOL primitives_init_generic(primitives_t* prims)
 {
@@ -109,176 +114,111 @@ static BOOL primitives_init_optimized(primitives_t* prims)
 	return TRUE;
 }
 
-typedef struct
-{
-	BYTE* channels[3];
-	UINT32 steps[3];
-	prim_size_t roi;
-	BYTE* outputBuffer;
-	UINT32 outputStride;
-	UINT32 testedFormat;
-} primitives_YUV_benchmark;
-
-static void primitives_YUV_benchmark_free(primitives_YUV_benchmark* bench)
+/* Only a file the application or the user asked for is written, there is no default location */
+static char* primitives_default_profile_path(void)
 {
-	if (!bench)
-		return;
-
-	free(bench->outputBuffer);
+	char* path = NULL;
+	const DWORD size = GetEnvironmentVariableA("FREERDP_PRIMITIVES_PROFILE", NULL, 0);
 
-	for (int i = 0; i < 3; i++)
-		free(bench->channels[i]);
-	memset(bench, 0, sizeof(primitives_YUV_benchmark));
-}
-
-static primitives_YUV_benchmark* primitives_YUV_benchmark_init(primitives_YUV_benchmark* ret)
-{
-	prim_size_t* roi = NULL;
-	if (!ret)
+	if (size == 0)
 		return NULL;
 
-	memset(ret, 0, sizeof(primitives_YUV_benchmark));
-	roi = &ret->roi;
-	roi->width = 1024;
-	roi->height = 768;
-	ret->outputStride = roi->width * 4;
-	ret->testedFormat = PIXEL_FORMAT_BGRA32;
-
-	ret->outputBuffer = calloc(ret->outputStride, roi->height);
-	if (!ret->outputBuffer)
-		goto fail;
-
-	for (int i = 0; i < 3; i++)
+	path = calloc(size, sizeof(char));
+	if (path && (GetEnvironmentVariableA("FREERDP_PRIMITIVES_PROFILE", path, size) != size - 1))
 	{
-		BYTE* buf = ret->channels[i] = calloc(roi->width, roi->height);
-		if (!buf)
-			goto fail;
-
-		winpr_RAND(buf, 1ull * roi->width * roi->height);
-		ret->steps[i] = roi->width;
+		free(path);
+		path = NULL;
 	}
-
-	return ret;
-
-fail:
-	primitives_YUV_benchmark_free(ret);
-	return ret;
+	return path;
 }
 
-static BOOL primitives_YUV_benchmark_run(primitives_YUV_benchmark* bench, primitives_t* prims,
-                                         UINT64 runTime, UINT32* computations)
+BOOL primitives_set_profile_path(const char* path)
 {
-	ULONGLONG dueDate = 0;
-	const BYTE* channels[3] = { 0 };
-	pstatus_t status = 0;
+	char* copy = NULL;
 
-	*computations = 0;
-
-	for (size_t i = 0; i < 3; i++)
-		channels[i] = bench->channels[i];
-
-	/* do a first dry run to initialize cache and such */
-	status = prims->YUV420ToRGB_8u_P3AC4R(channels, bench->steps, bench->outputBuffer,
-	                                      bench->outputStride, bench->testedFormat, &bench->roi);
-	if (status != PRIMITIVES_SUCCESS)
-		return FALSE;
-
-	/* let's run the benchmark */
-	dueDate = GetTickCount64() + runTime;
-	while (GetTickCount64() < dueDate)
+	if (path)
 	{
-		pstatus_t cstatus =
-		    prims->YUV420ToRGB_8u_P3AC4R(channels, bench->steps, bench->outputBuffer,
-		                                 bench->outputStride, bench->testedFormat, &bench->roi);
-		if (cstatus != PRIMITIVES_SUCCESS)
+		copy = _strdup(path);
+		if (!copy)
 			return FALSE;
-		*computations = *computations + 1;
 	}
+
+	free(primitivesProfile);
+	primitivesProfile = copy;
+	primitivesProfileSet = TRUE;
 	return TRUE;
 }
 
-static BOOL primitives_autodetect_best(primitives_t* prims)
+static size_t primitives_get_backends(prim_autotune_backend* backends, size_t count)
 {
-	BOOL ret = FALSE;
-	struct prim_benchmark
+	size_t used = 0;
+	const struct
 	{
 		const char* name;
-		primitives_t* prims;
-		UINT32 flags;
-		UINT32 count;
-	};
-
-	struct prim_benchmark testcases[] =
-	{
-		{ "generic", NULL, PRIMITIVES_PURE_SOFT, 0 },
+		DWORD type;
+	} types[] = {
+		{ "generic", PRIMITIVES_PURE_SOFT },
 #if defined(HAVE_CPU_OPTIMIZED_PRIMITIVES)
-		{ "optimized", NULL, PRIMITIVES_ONLY_CPU, 0 },
+		{ "optimized", PRIMITIVES_ONLY_CPU },
 #endif
 #if defined(WITH_OPENCL)
-		{ "opencl", NULL, PRIMITIVES_ONLY_GPU, 0 },
+		{ "opencl", PRIMITIVES_ONLY_GPU },
 #endif
 	};
-	const struct prim_benchmark* best = NULL;
 
-#if !defined(HAVE_CPU_OPTIMIZED_PRIMITIVES) && !defined(WITH_OPENCL)
-	{
-		struct prim_benchmark* cur = &testcases[0];
-		cur->prims = primitives_get_by_type(cur->flags);
-		if (!cur->prims)
-		{
-			WLog_WARN(TAG, "Failed to initialize %s primitives", cur->name);
-			return FALSE;
-		}
-		WLog_DBG(TAG, "primitives benchmark: only one backend, skipping...");
-		best = cur;
-	}
-#else
+	for (size_t x = 0; (x < ARRAYSIZE(types)) && (used < count); x++)
 	{
-		UINT64 benchDuration = 150; /* 150 ms */
-		primitives_YUV_benchmark bench = { 0 };
-		primitives_YUV_benchmark* yuvBench = primitives_YUV_benchmark_init(&bench);
-		if (!yuvBench)
-			return FALSE;
+		primitives_t* prims = primitives_get_by_type(types[x].type);
 
-		WLog_DBG(TAG, "primitives benchmark result:");
-		for (size_t x = 0; x < ARRAYSIZE(testcases); x++)
+		/* primitives_get_by_type falls back to a more generic backend on failure */
+		if (!prims || ((used > 0) && (prims == backends[used - 1].prims)))
 		{
-			struct prim_benchmark* cur = &testcases[x];
-			cur->prims = primitives_get_by_type(cur->flags);
-			if (!cur->prims)
-			{
-				WLog_WARN(TAG, "Failed to initialize %s primitives", cur->name);
-				continue;
-			}
-			if (!primitives_YUV_benchmark_run(yuvBench, cur->prims, benchDuration, &cur->count))
-			{
-				WLog_WARN(TAG, "error running %s YUV bench", cur->name);
-				continue;
-			}
-
-			WLog_DBG(TAG, " * %s= %" PRIu32, cur->name, cur->count);
-			if (!best || (best->count < cur->count))
-				best = cur;
+			WLog_WARN(TAG, "Failed to initialize %s primitives", types[x].name);
+			continue;
 		}
-		primitives_YUV_benchmark_free(yuvBench);
+
+		backends[used].name = types[x].name;
+		backends[used].prims = prims;
+		used++;
 	}
-#endif
 
-	if (!best)
+	return used;
+}
+
+BOOL primitives_autotune(primitives_t* p, BOOL force, char** report)
+{
+	prim_autotune_backend backends[PRIM_AUTOTUNE_MAX_BACKENDS] = { 0 };
+	char* profile = NULL;
+
+	if (!p)
+		return FALSE;
+
+	const size_t count = primitives_get_backends(backends, ARRAYSIZE(backends));
+	if (count == 0)
 	{
 		WLog_ERR(TAG, "No primitives to test, aborting.");
-		goto out;
+		return FALSE;
 	}
-	/* finally compute the results */
-	*prims = *best->prims;
 
-	WLog_DBG(TAG, "primitives autodetect, using %s", best->name);
-	ret = TRUE;
-out:
-	if (!ret)
+	if (!primitivesProfileSet)
+		profile = primitives_default_profile_path();
+	else if (primitivesProfile)
+		profile = _strdup(primitivesProfile);
+
+	const BOOL rc = primitives_autotune_run(p, backends, count, profile, force, report);
+	free(profile);
+	return rc;
+}
+
+static BOOL primitives_autodetect_best(primitives_t* prims)
+{
+	if (!primitives_autotune(prims, FALSE, NULL))
+	{
 		*prims = pPrimitivesGeneric;
+		return FALSE;
+	}
 
-	return ret;
+	return TRUE;
 }
 
 #if defined(WITH_OPENCL)
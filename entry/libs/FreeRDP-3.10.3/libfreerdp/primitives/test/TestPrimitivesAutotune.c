@@ -0,0 +1,114 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Primitives autotuning test
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <winpr/file.h>
+#include <winpr/path.h>
+#include <winpr/sysinfo.h>
+
+#include "prim_test.h"
+
+/* Every tuned primitive must come from one of the backends */
+static BOOL test_autotune_table(const primitives_t* tuned)
+{
+	primitives_t cpu = { 0 };
+
+	if (!primitives_init(&cpu, PRIMITIVES_ONLY_CPU))
+		return FALSE;
+
+#define CHECK_SLOT(fkt)                                                   \
+	if ((tuned->fkt != generic->fkt) && (tuned->fkt != cpu.fkt))          \
+	{                                                                     \
+		printf("%s: implementation from unknown backend\n", #fkt);       \
+		return FALSE;                                                     \
+	}
+
+	CHECK_SLOT(copy_8u_AC4r)
+	CHECK_SLOT(set_32u)
+	CHECK_SLOT(add_16s)
+	CHECK_SLOT(lShiftC_16s)
+	CHECK_SLOT(alphaComp_argb)
+	CHECK_SLOT(sign_16s)
+	CHECK_SLOT(yCbCrToRGB_16s8u_P3AC4R)
+	CHECK_SLOT(RGBToYCbCr_16s16s_P3P3)
+	CHECK_SLOT(YUV420ToRGB_8u_P3AC4R)
+	CHECK_SLOT(RGBToAVC444YUV)
+	CHECK_SLOT(copy_no_overlap)
+#undef CHECK_SLOT
+
+	return TRUE;
+}
+
+static BOOL test_autotune_profile(const char* profile)
+{
+	BOOL rc = FALSE;
+	char* report = NULL;
+	primitives_t measured = { 0 };
+	primitives_t cached = { 0 };
+
+	if (!primitives_set_profile_path(profile))
+		return FALSE;
+
+	if (!primitives_autotune(&measured, TRUE, &report) || !report)
+		goto fail;
+	printf("%s\n", report);
+
+	if (!strstr(report, "source: benchmark") || !winpr_PathFileExists(profile))
+		goto fail;
+	free(report);
+	report = NULL;
+
+	if (!test_autotune_table(&measured))
+		goto fail;
+
+	/* The second run must use the profile and end up with the same selection */
+	if (!primitives_autotune(&cached, FALSE, &report) || !report)
+		goto fail;
+
+	if (!strstr(report, "source: profile"))
+		goto fail;
+
+	if (memcmp(&measured, &cached, sizeof(primitives_t)) != 0)
+		goto fail;
+
+	rc = TRUE;
+fail:
+	free(report);
+	(void)DeleteFileA(profile);
+	return rc;
+}
+
+int TestPrimitivesAutotune(int argc, char* argv[])
+{
+	char name[64] = { 0 };
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	prim_test_setup(FALSE);
+
+	(void)_snprintf(name, sizeof(name), "TestPrimitivesAutotune-%" PRIu64 ".profile",
+	                winpr_GetTickCount64NS());
+	char* profile = GetKnownSubPath(KNOWN_PATH_TEMP, name);
+	if (!profile)
+		return -1;
+
+	const BOOL rc = test_autotune_profile(profile);
+	free(profile);
+	return rc ? 0 : -1;
+}
@@ -18,6 +18,15 @@
 #include <freerdp/utils/profiler.h>
 
 #include "prim_test.h"
+#include "../../core/simd.h"
+
+#if defined(NEON_INTRINSICS_ENABLED)
+/* NEON computes the same fixed point sums as the generic code */
+#define RGB_TO_YCBCR_TOLERANCE 0
+#else
+/* SSE2 keeps only the high half of the products, off by a few 1/32 of a sample */
+#define RGB_TO_YCBCR_TOLERANCE 2
+#endif
 
 /* ------------------------------------------------------------------------- */
 static BOOL test_RGBToRGB_16s8u_P3AC4R_func(prim_size_t roi, DWORD DstFormat)
@@ -259,16 +268,92 @@ static int test_yCbCrToRGB_16s16s_P3P3_speed(void)
 	return TRUE;
 }
 
+/* ========================================================================= */
+static BOOL test_RGBToYCbCr_16s16s_P3P3_func(prim_size_t roi)
+{
+	pstatus_t status = 0;
+	INT16 ALIGN(r[4096]) = { 0 };
+	INT16 ALIGN(g[4096]) = { 0 };
+	INT16 ALIGN(b[4096]) = { 0 };
+	INT16 ALIGN(y1[4096]) = { 0 };
+	INT16 ALIGN(cb1[4096]) = { 0 };
+	INT16 ALIGN(cr1[4096]) = { 0 };
+	INT16 ALIGN(y2[4096]) = { 0 };
+	INT16 ALIGN(cb2[4096]) = { 0 };
+	INT16 ALIGN(cr2[4096]) = { 0 };
+	const INT16* in[3];
+	INT16* out1[3];
+	INT16* out2[3];
+	winpr_RAND(r, sizeof(r));
+	winpr_RAND(g, sizeof(g));
+	winpr_RAND(b, sizeof(b));
+
+	/* 8 bit samples, as the RemoteFX encoder feeds them */
+	for (int i = 0; i < 4096; ++i)
+	{
+		r[i] &= 0xFF;
+		g[i] &= 0xFF;
+		b[i] &= 0xFF;
+	}
+
+	in[0] = r;
+	in[1] = g;
+	in[2] = b;
+	out1[0] = y1;
+	out1[1] = cb1;
+	out1[2] = cr1;
+	out2[0] = y2;
+	out2[1] = cb2;
+	out2[2] = cr2;
+	status = generic->RGBToYCbCr_16s16s_P3P3(in, 64 * 2, out1, 64 * 2, &roi);
+
+	if (status != PRIMITIVES_SUCCESS)
+		return FALSE;
+
+	status = optimized->RGBToYCbCr_16s16s_P3P3(in, 64 * 2, out2, 64 * 2, &roi);
+
+	if (status != PRIMITIVES_SUCCESS)
+		return FALSE;
+
+	for (UINT32 y = 0; y < roi.height; ++y)
+	{
+		for (UINT32 x = 0; x < roi.width; ++x)
+		{
+			const size_t i = 64ULL * y + x;
+
+			if ((ABS(y1[i] - y2[i]) > RGB_TO_YCBCR_TOLERANCE) ||
+			    (ABS(cb1[i] - cb2[i]) > RGB_TO_YCBCR_TOLERANCE) ||
+			    (ABS(cr1[i] - cr2[i]) > RGB_TO_YCBCR_TOLERANCE))
+			{
+				printf("RGBToYCbCr-%" PRIu32 "x%" PRIu32 " FAIL[%" PRIuz "]: %" PRId16
+				       ",%" PRId16 ",%" PRId16 " vs %" PRId16 ",%" PRId16 ",%" PRId16 "\n",
+				       roi.width, roi.height, i, y1[i], cb1[i], cr1[i], y2[i], cb2[i], cr2[i]);
+				return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
 int TestPrimitivesColors(int argc, char* argv[])
 {
 	const DWORD formats[] = { PIXEL_FORMAT_ARGB32, PIXEL_FORMAT_XRGB32, PIXEL_FORMAT_ABGR32,
 		                      PIXEL_FORMAT_XBGR32, PIXEL_FORMAT_RGBA32, PIXEL_FORMAT_RGBX32,
 		                      PIXEL_FORMAT_BGRA32, PIXEL_FORMAT_BGRX32 };
 	prim_size_t roi = { 1920 / 4, 1080 / 4 };
+	/* Full RemoteFX tiles and a width that leaves a tail for the scalar loop */
+	const prim_size_t ycbcr[] = { { 64, 64 }, { 61, 17 } };
 	WINPR_UNUSED(argc);
 	WINPR_UNUSED(argv);
 	prim_test_setup(FALSE);
 
+	for (size_t x = 0; x < ARRAYSIZE(ycbcr); x++)
+	{
+		if (!test_RGBToYCbCr_16s16s_P3P3_func(ycbcr[x]))
+			return 1;
+	}
+
 	for (UINT32 x = 0; x < sizeof(formats) / sizeof(formats[0]); x++)
 	{
 		if (!test_RGBToRGB_16s8u_P3AC4R_func(roi, formats[x]))
@@ -885,6 +885,100 @@ fail:
 	return res;
 }
 
+static BOOL TestPrimitiveRgbToYUV420(primitives_t* prims, prim_size_t roi)
+{
+	BOOL res = FALSE;
+	UINT32 awidth = 0;
+	UINT32 aheight = 0;
+	BYTE* yuv[3] = { 0 };
+	BYTE* yuvGeneric[3] = { 0 };
+	UINT32 yuv_step[3];
+	BYTE* rgb = NULL;
+	size_t size = 0;
+	const size_t padding = 0x1000;
+	UINT32 stride = 0;
+	const UINT32 formats[] = { PIXEL_FORMAT_XRGB32, PIXEL_FORMAT_XBGR32, PIXEL_FORMAT_ARGB32,
+		                       PIXEL_FORMAT_ABGR32, PIXEL_FORMAT_RGBA32, PIXEL_FORMAT_RGBX32,
+		                       PIXEL_FORMAT_BGRA32, PIXEL_FORMAT_BGRX32 };
+
+	if (!prims || !prims->RGBToYUV420_8u_P3AC4R || !generic || !generic->RGBToYUV420_8u_P3AC4R)
+		return FALSE;
+
+	/* Buffers need to be 16x16 aligned. */
+	awidth = roi.width;
+
+	if (awidth % 16 != 0)
+		awidth += 16 - roi.width % 16;
+
+	aheight = roi.height;
+
+	if (aheight % 16 != 0)
+		aheight += 16 - roi.height % 16;
+
+	stride = 1ULL * awidth * sizeof(UINT32);
+	size = 1ULL * awidth * aheight;
+
+	(void)fprintf(stderr, "Running RGBToYUV420 on frame size %" PRIu32 "x%" PRIu32 "\n",
+	              roi.width, roi.height);
+
+	if (!(rgb = set_padding(size * sizeof(UINT32), padding)))
+		goto fail;
+
+	if (!allocate_yuv420(yuv, awidth, aheight, padding))
+		goto fail;
+
+	if (!allocate_yuv420(yuvGeneric, awidth, aheight, padding))
+		goto fail;
+
+	for (size_t y = 0; y < roi.height; y++)
+	{
+		BYTE* line = &rgb[y * stride];
+
+		for (UINT32 x = 0; x < roi.width; x++)
+		{
+			line[x * 4 + 0] = prand(UINT8_MAX);
+			line[x * 4 + 1] = prand(UINT8_MAX);
+			line[x * 4 + 2] = prand(UINT8_MAX);
+			line[x * 4 + 3] = prand(UINT8_MAX);
+		}
+	}
+
+	yuv_step[0] = awidth;
+	yuv_step[1] = (awidth + 1) / 2;
+	yuv_step[2] = (awidth + 1) / 2;
+
+	for (UINT32 x = 0; x < ARRAYSIZE(formats); x++)
+	{
+		const UINT32 SrcFormat = formats[x];
+		printf("Testing source color format %s\n", FreeRDPGetColorFormatName(SrcFormat));
+
+		if (prims->RGBToYUV420_8u_P3AC4R(rgb, SrcFormat, stride, yuv, yuv_step, &roi) !=
+		    PRIMITIVES_SUCCESS)
+			goto fail;
+
+		if (generic->RGBToYUV420_8u_P3AC4R(rgb, SrcFormat, stride, yuvGeneric, yuv_step, &roi) !=
+		    PRIMITIVES_SUCCESS)
+			goto fail;
+
+		if (!check_padding(rgb, size * sizeof(UINT32), padding, "rgb"))
+			goto fail;
+
+		if (!check_yuv420(yuv, awidth, aheight, padding) ||
+		    !check_yuv420(yuvGeneric, awidth, aheight, padding))
+			goto fail;
+
+		if (!compare_yuv420(yuv, yuvGeneric, awidth, aheight, padding))
+			goto fail;
+	}
+
+	res = TRUE;
+fail:
+	free_padding(rgb, padding);
+	free_yuv420(yuv, padding);
+	free_yuv420(yuvGeneric, padding);
+	return res;
+}
+
 int TestPrimitivesYUV(int argc, char* argv[])
 {
 	BOOL large = (argc > 1);
@@ -892,7 +986,7 @@ int TestPrimitivesYUV(int argc, char* argv[])
 	WINPR_UNUSED(argc);
 	WINPR_UNUSED(argv);
 	prim_test_setup(FALSE);
-	primitives_t* prims = primitives_get();
+	primitives_t* prims = optimized;
 
 	for (UINT32 x = 0; x < 5; x++)
 	{
@@ -968,6 +1062,15 @@ int TestPrimitivesYUV(int argc, char* argv[])
 		printf("---------------------- END --------------------------\n");
 		printf("------------------- OPTIMIZED -----------------------\n");
 
+		if (!TestPrimitiveRgbToYUV420(prims, roi))
+		{
+			printf("TestPrimitiveRgbToYUV420 failed.\n");
+			goto end;
+		}
+
+		printf("---------------------- END --------------------------\n");
+		printf("------------------- OPTIMIZED -----------------------\n");
+
 		if (!TestPrimitiveRgbToLumaChroma(prims, roi, 1))
 		{
 			printf("TestPrimitiveRgbToLumaChroma failed.\n");
@@ -29,6 +29,7 @@
 
 primitives_t* generic = NULL;
 primitives_t* optimized = NULL;
+static primitives_t cpu = { 0 };
 BOOL g_TestPrimitivesPerformance = FALSE;
 UINT32 g_Iterations = 1000;
 
@@ -77,6 +78,11 @@ void prim_test_setup(BOOL performance)
 {
 	generic = primitives_get_generic();
 	optimized = primitives_get();
+
+	/* The autodetected table may pick generic routines, compare against the SIMD ones */
+	if (primitives_init(&cpu, PRIMITIVES_ONLY_CPU))
+		optimized = &cpu;
+
 	g_TestPrimitivesPerformance = performance;
 }
 
@@ -0,0 +1,77 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Primitives autotuning tool
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <freerdp/primitives.h>
+
+static int usage_and_exit(void)
+{
+	printf("freerdp-primitives-tune: show the implementation chosen for every primitive\n");
+	printf("Usage: freerdp-primitives-tune [-f] [-p <profile>] [-n]\n");
+	printf("  -f            benchmark again and update the profile\n");
+	printf("  -p <profile>  use <profile> instead of the default profile file\n");
+	printf("  -n            do not read or write a profile\n");
+	return 1;
+}
+
+int main(int argc, char* argv[])
+{
+	BOOL force = FALSE;
+	char* report = NULL;
+	primitives_t prims = { 0 };
+
+	for (int index = 1; index < argc; index++)
+	{
+		if (strcmp("-f", argv[index]) == 0)
+			force = TRUE;
+		else if (strcmp("-n", argv[index]) == 0)
+		{
+			if (!primitives_set_profile_path(NULL))
+				return 1;
+		}
+		else if (strcmp("-p", argv[index]) == 0)
+		{
+			index++;
+
+			if (index == argc)
+			{
+				printf("missing profile\n\n");
+				return usage_and_exit();
+			}
+
+			if (!primitives_set_profile_path(argv[index]))
+				return 1;
+		}
+		else
+			return usage_and_exit();
+	}
+
+	if (!primitives_autotune(&prims, force, &report) || !report)
+	{
+		(void)fprintf(stderr, "failed to tune primitives\n");
+		free(report);
+		return 1;
+	}
+
+	printf("%s", report);
+	free(report);
+	primitives_uninit();
+	return 0;
+}
@@ -87,6 +87,9 @@ int main(int argc, char** argv)
 		  "Allow GFX pipeline" },
 		{ "gfx-progressive", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueTrue, NULL, -1, NULL,
 		  "Allow GFX progressive codec" },
+		{ "gfx-progressive-bandwidth", COMMAND_LINE_VALUE_REQUIRED, "<bytes>", NULL, NULL, -1, NULL,
+		  "Bytes per GFX progressive frame, leftover is spent on upgrading static tiles. 0 sends "
+		  "tiles at full quality" },
 		{ "gfx-rfx", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueTrue, NULL, -1, NULL,
 		  "Allow GFX RFX codec" },
 		{ "gfx-planar", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueTrue, NULL, -1, NULL,
@@ -336,10 +336,7 @@ static INLINE void shadow_client_mark_invalid(rdpShadowClient* client, UINT32 nu
 	/* Mark client invalid region. No rectangle means full screen */
 	if (numRects > 0)
 	{
-		for (UINT32 index = 0; index < numRects; index++)
-		{
-			region16_union_rect(&(client->invalidRegion), &(client->invalidRegion), &rects[index]);
-		}
+		region16_union_rects(&(client->invalidRegion), &(client->invalidRegion), rects, numRects);
 	}
 	else
 	{
@@ -1127,7 +1124,8 @@ static INLINE UINT32 rdpgfx_estimate_h264_avc420(RDPGFX_AVC420_BITMAP_STREAM* ha
  */
 static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE* pSrcData,
                                            UINT32 nSrcStep, UINT32 SrcFormat, UINT16 nXSrc,
-                                           UINT16 nYSrc, UINT16 nWidth, UINT16 nHeight)
+                                           UINT16 nYSrc, UINT16 nWidth, UINT16 nHeight,
+                                           const REGION16* invalidRegion)
 {
 	UINT32 id = 0;
 	UINT error = CHANNEL_RC_OK;
@@ -1327,8 +1325,6 @@ static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE*
 	else if (freerdp_settings_get_bool(settings, FreeRDP_GfxProgressive))
 	{
 		INT32 rc = 0;
-		REGION16 region;
-		RECTANGLE_16 regionRect;
 
 		if (shadow_encoder_prepare(encoder, FREERDP_CODEC_PROGRESSIVE) < 0)
 		{
@@ -1336,19 +1332,10 @@ static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE*
 			return FALSE;
 		}
 
-		WINPR_ASSERT(cmd.left <= UINT16_MAX);
-		WINPR_ASSERT(cmd.top <= UINT16_MAX);
-		WINPR_ASSERT(cmd.right <= UINT16_MAX);
-		WINPR_ASSERT(cmd.bottom <= UINT16_MAX);
-		regionRect.left = (UINT16)cmd.left;
-		regionRect.top = (UINT16)cmd.top;
-		regionRect.right = (UINT16)cmd.right;
-		regionRect.bottom = (UINT16)cmd.bottom;
-		region16_init(&region);
-		region16_union_rect(&region, &region, &regionRect);
+		/* Only the damaged tiles restart from a coarse pass, the others keep upgrading */
+		WINPR_ASSERT(invalidRegion);
 		rc = progressive_compress(encoder->progressive, pSrcData, nSrcStep * nHeight, cmd.format,
-		                          nWidth, nHeight, nSrcStep, &region, &cmd.data, &cmd.length);
-		region16_uninit(&region);
+		                          nWidth, nHeight, nSrcStep, invalidRegion, &cmd.data, &cmd.length);
 		if (rc < 0)
 		{
 			WLog_ERR(TAG, "progressive_compress failed");
@@ -1839,6 +1826,33 @@ out:
  *
  * @return TRUE on success (or nothing need to be updated)
  */
+/* Move the rectangles of a region by -dx, -dy, none of them may start before that */
+static BOOL shadow_client_region_offset(REGION16* region, UINT16 dx, UINT16 dy)
+{
+	BOOL rc = TRUE;
+	UINT32 numRects = 0;
+	REGION16 moved;
+	const RECTANGLE_16* rects = region16_rects(region, &numRects);
+
+	region16_init(&moved);
+
+	for (UINT32 x = 0; rc && (x < numRects); x++)
+	{
+		const RECTANGLE_16* r = &rects[x];
+		WINPR_ASSERT((r->left >= dx) && (r->top >= dy));
+
+		const RECTANGLE_16 rect = { (UINT16)(r->left - dx), (UINT16)(r->top - dy),
+			                        (UINT16)(r->right - dx), (UINT16)(r->bottom - dy) };
+		rc = region16_union_rect(&moved, &moved, &rect);
+	}
+
+	if (rc)
+		rc = region16_copy(region, &moved);
+
+	region16_uninit(&moved);
+	return rc;
+}
+
 static BOOL shadow_client_send_surface_update(rdpShadowClient* client, SHADOW_GFX_STATUS* pStatus)
 {
 	BOOL ret = TRUE;
@@ -1882,8 +1896,7 @@ static BOOL shadow_client_send_surface_update(rdpShadowClient* client, SHADOW_GF
 	EnterCriticalSection(&surface->lock);
 	rects = region16_rects(&(surface->invalidRegion), &numRects);
 
-	for (UINT32 index = 0; index < numRects; index++)
-		region16_union_rect(&invalidRegion, &invalidRegion, &rects[index]);
+	region16_union_rects(&invalidRegion, &invalidRegion, rects, numRects);
 
 	surfaceRect.left = 0;
 	surfaceRect.top = 0;
@@ -1927,6 +1940,13 @@ static BOOL shadow_client_send_surface_update(rdpShadowClient* client, SHADOW_GF
 		WINPR_ASSERT(nYSrc >= 0);
 		WINPR_ASSERT(nYSrc <= UINT16_MAX);
 		pSrcData = &pSrcData[((UINT16)subY * nSrcStep) + ((UINT16)subX * 4U)];
+
+		/* The GFX surface starts at the sub rect */
+		if (!shadow_client_region_offset(&invalidRegion, (UINT16)subX, (UINT16)subY))
+		{
+			ret = FALSE;
+			goto out;
+		}
 	}
 
 	// WLog_INFO(TAG, "shadow_client_send_surface_update: x: %" PRId64 " y: %" PRId64 " width: %"
@@ -1959,7 +1979,7 @@ static BOOL shadow_client_send_surface_update(rdpShadowClient* client, SHADOW_GF
 			WINPR_ASSERT(nHeight >= 0);
 			WINPR_ASSERT(nHeight <= UINT16_MAX);
 			ret = shadow_client_send_surface_gfx(client, pSrcData, nSrcStep, SrcFormat, 0, 0,
-			                                     (UINT16)nWidth, (UINT16)nHeight);
+			                                     (UINT16)nWidth, (UINT16)nHeight, &invalidRegion);
 		}
 		else
 		{
@@ -1999,6 +2019,55 @@ out:
 	return ret;
 }
 
+/* Progressive tiles still below full quality while the screen does not change */
+static BOOL shadow_client_has_upgrades(rdpShadowClient* client, const SHADOW_GFX_STATUS* pStatus)
+{
+	WINPR_ASSERT(client);
+	WINPR_ASSERT(pStatus);
+
+	if (!client->activated || client->suppressOutput || !client->areGfxCapsReady ||
+	    !pStatus->gfxOpened || !pStatus->gfxSurfaceCreated || !client->encoder)
+		return FALSE;
+
+	return progressive_compress_has_upgrades(client->encoder->progressive);
+}
+
+/* A frame without damage, the progressive encoder fills its budget with upgrade passes */
+static BOOL shadow_client_send_upgrades(rdpShadowClient* client, SHADOW_GFX_STATUS* pStatus)
+{
+	BOOL ret = FALSE;
+	REGION16 invalidRegion;
+	rdpContext* context = (rdpContext*)client;
+	rdpShadowServer* server = client->server;
+
+	WINPR_ASSERT(server);
+	WINPR_ASSERT(pStatus);
+
+	rdpShadowSurface* surface = client->inLobby ? server->lobby : server->surface;
+	if (!surface || !shadow_client_has_upgrades(client, pStatus))
+		return TRUE;
+
+	const UINT32 nWidth = freerdp_settings_get_uint32(context->settings, FreeRDP_DesktopWidth);
+	const UINT32 nHeight = freerdp_settings_get_uint32(context->settings, FreeRDP_DesktopHeight);
+	WINPR_ASSERT(nWidth <= UINT16_MAX);
+	WINPR_ASSERT(nHeight <= UINT16_MAX);
+
+	region16_init(&invalidRegion);
+	EnterCriticalSection(&surface->lock);
+
+	BYTE* pSrcData = surface->data;
+	if (server->shareSubRect)
+		pSrcData = &pSrcData[(1ULL * server->subRect.top * surface->scanline) +
+		                     (server->subRect.left * 4ULL)];
+
+	ret = shadow_client_send_surface_gfx(client, pSrcData, surface->scanline, surface->format, 0,
+	                                     0, (UINT16)nWidth, (UINT16)nHeight, &invalidRegion);
+
+	LeaveCriticalSection(&surface->lock);
+	region16_uninit(&invalidRegion);
+	return ret;
+}
+
 /**
  * Function description
  * Notify client for resize. The new desktop width/height
@@ -2276,6 +2345,7 @@ static DWORD WINAPI shadow_client_thread(LPVOID arg)
 	WINPR_ASSERT(rc);
 	rc = freerdp_settings_set_bool(settings, FreeRDP_SupportMonitorLayoutPdu, TRUE);
 	WINPR_ASSERT(rc);
+	UINT64 upgradeTime = 0;
 	while (1)
 	{
 		HANDLE events[MAXIMUM_WAIT_OBJECTS] = { 0 };
@@ -2302,11 +2372,31 @@ static DWORD WINAPI shadow_client_thread(LPVOID arg)
 			events[nCount++] = gfxevent;
 #endif
 
-		status = WaitForMultipleObjects(nCount, events, FALSE, INFINITE);
+		/* Without screen updates pending upgrade passes go out at the frame rate */
+		DWORD timeout = INFINITE;
+		if (shadow_client_has_upgrades(client, &gfxstatus))
+		{
+			const UINT64 now = GetTickCount64();
+			timeout = (upgradeTime > now) ? (DWORD)(upgradeTime - now) : 0;
+		}
+
+		status = WaitForMultipleObjects(nCount, events, FALSE, timeout);
 
 		if (status == WAIT_FAILED)
 			goto fail;
 
+		if ((timeout != INFINITE) && (GetTickCount64() >= upgradeTime))
+		{
+			if (!shadow_client_send_upgrades(client, &gfxstatus))
+			{
+				WLog_ERR(TAG, "Failed to send progressive upgrades");
+				break;
+			}
+
+			upgradeTime =
+			    GetTickCount64() + 1000 / MAX(1, shadow_encoder_preferred_fps(client->encoder));
+		}
+
 		if (WaitForSingleObject(UpdateEvent, 0) == WAIT_OBJECT_0)
 		{
 			/* The UpdateEvent means to start sending current frame. It is
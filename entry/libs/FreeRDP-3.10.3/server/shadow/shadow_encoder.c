@@ -276,10 +276,15 @@ static int shadow_encoder_init_progressive(rdpShadowEncoder* encoder)
 	if (!progressive_context_reset(encoder->progressive))
 		goto fail;
 
+	if (!progressive_compress_set_bandwidth(encoder->progressive,
+	                                        encoder->server->progressiveBandwidth))
+		goto fail;
+
 	encoder->codecs |= FREERDP_CODEC_PROGRESSIVE;
 	return 1;
 fail:
 	progressive_context_free(encoder->progressive);
+	encoder->progressive = NULL;
 	return -1;
 }
 
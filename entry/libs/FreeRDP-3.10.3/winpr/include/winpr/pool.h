@@ -25,6 +25,7 @@
 
 #include <winpr/synch.h>
 #include <winpr/thread.h>
+#include <winpr/interlocked.h>
 
 #ifndef _WIN32
 
@@ -46,6 +47,15 @@ typedef struct S_TP_CLEANUP_GROUP TP_CLEANUP_GROUP, *PTP_CLEANUP_GROUP;
 
 typedef VOID (*PTP_CLEANUP_GROUP_CANCEL_CALLBACK)(PVOID ObjectContext, PVOID CleanupContext);
 
+typedef enum
+{
+	TP_CALLBACK_PRIORITY_HIGH,
+	TP_CALLBACK_PRIORITY_NORMAL,
+	TP_CALLBACK_PRIORITY_LOW,
+	TP_CALLBACK_PRIORITY_INVALID,
+	TP_CALLBACK_PRIORITY_COUNT = TP_CALLBACK_PRIORITY_INVALID
+} TP_CALLBACK_PRIORITY;
+
 typedef struct
 {
 	TP_VERSION Version;
@@ -65,9 +75,15 @@ typedef struct
 			DWORD Private : 30;
 		} s;
 	} u;
-} TP_CALLBACK_ENVIRON_V1;
 
-typedef TP_CALLBACK_ENVIRON_V1 TP_CALLBACK_ENVIRON, *PTP_CALLBACK_ENVIRON;
+	TP_CALLBACK_PRIORITY CallbackPriority;
+	DWORD Size;
+} TP_CALLBACK_ENVIRON_V3;
+
+/* Version 1 callers keep compiling, the version field tells both layouts apart */
+typedef TP_CALLBACK_ENVIRON_V3 TP_CALLBACK_ENVIRON_V1;
+
+typedef TP_CALLBACK_ENVIRON_V3 TP_CALLBACK_ENVIRON, *PTP_CALLBACK_ENVIRON;
 
 typedef struct S_TP_WORK TP_WORK, *PTP_WORK;
 typedef struct S_TP_TIMER TP_TIMER, *PTP_TIMER;
@@ -234,6 +250,41 @@ extern "C"
 
 #endif /* WINPR_THREAD_POOL */
 
+	/* WinPR extensions */
+
+	typedef enum
+	{
+		WINPR_THREADPOOL_CPUS_ANY = 0,
+		WINPR_THREADPOOL_CPUS_PERFORMANCE,
+		WINPR_THREADPOOL_CPUS_EFFICIENCY
+	} WINPR_THREADPOOL_CPUS;
+
+	/** @brief Submit a number of work objects at once.
+	 *
+	 *  Equivalent to calling \b SubmitThreadpoolWork for each element, but the WinPR pool
+	 *  queues the whole batch with a single lock.
+	 *
+	 *  @param pwks An array of work objects
+	 *  @param count The number of elements in \b pwks
+	 *  @since version 3.10.3
+	 */
+	WINPR_API VOID winpr_SubmitThreadpoolWorkBatch(PTP_WORK* pwks, size_t count);
+
+	/** @brief Restrict the workers of a pool to one class of cores on asymmetric systems.
+	 *
+	 *  The default for new pools is read from the \b WINPR_THREADPOOL_CPUS environment
+	 *  variable, \b performance or \b efficiency.
+	 *  The workers of a pool are started with the first submitted work, the hint has to be
+	 *  set before that and is rejected afterwards.
+	 *
+	 *  @param ptpp The pool to configure
+	 *  @param hint The class of cores to run on
+	 *  @return \b TRUE if the hint is honoured, \b FALSE if there are no such cores, the
+	 *  workers are already running or the pool is a native one.
+	 *  @since version 3.10.3
+	 */
+	WINPR_API BOOL winpr_SetThreadpoolCpuHint(PTP_POOL ptpp, WINPR_THREADPOOL_CPUS hint);
+
 #if !defined(_WIN32)
 #define WINPR_CALLBACK_ENVIRON 1
 #elif defined(_WIN32) && (_WIN32_WINNT < 0x0600)
@@ -251,7 +302,13 @@ extern "C"
 	{
 		const TP_CALLBACK_ENVIRON empty = { 0 };
 		*pcbe = empty;
+#if !defined(_WIN32)
+		pcbe->Version = 3;
+		pcbe->CallbackPriority = TP_CALLBACK_PRIORITY_NORMAL;
+		pcbe->Size = sizeof(TP_CALLBACK_ENVIRON);
+#else
 		pcbe->Version = 1;
+#endif
 	}
 
 	static INLINE VOID DestroyThreadpoolEnvironment(PTP_CALLBACK_ENVIRON pcbe)
@@ -273,6 +330,17 @@ extern "C"
 	{
 		pcbe->RaceDll = mod;
 	}
+
+#if !defined(_WIN32)
+	/* The WinPR pool runs pending high priority callbacks first and limits the number of
+	 * low priority callbacks running at the same time. The priority may change while other
+	 * threads submit work with the environment. */
+	static INLINE VOID SetThreadpoolCallbackPriority(PTP_CALLBACK_ENVIRON pcbe,
+	                                                 TP_CALLBACK_PRIORITY Priority)
+	{
+		(void)InterlockedExchange((LONG volatile*)&pcbe->CallbackPriority, (LONG)Priority);
+	}
+#endif
 #endif
 
 #ifdef __cplusplus
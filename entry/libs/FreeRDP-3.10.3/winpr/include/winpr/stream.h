@@ -1407,6 +1407,18 @@ extern "C"
 	WINPR_ATTR_MALLOC(StreamPool_Free, 1)
 	WINPR_API wStreamPool* StreamPool_New(BOOL synchronized, size_t defaultSize);
 
+	/** Print the state of the pool to \b buffer
+	 *
+	 *  Lists the streams in use and cached, the bytes cached, the number of takes served from
+	 *  the cache (hit rate), new allocations, buffers dropped by high-water trimming and how
+	 *  often a thread had to wait for a pool lock.
+	 *
+	 *  @param pool The pool to query, must not be \b NULL
+	 *  @param buffer The buffer to write to
+	 *  @param size The size of \b buffer in bytes
+	 *
+	 *  @return \b buffer or \b NULL in case of invalid arguments
+	 */
 	WINPR_API char* StreamPool_GetStatistics(wStreamPool* pool, char* buffer, size_t size);
 
 #ifdef __cplusplus
@@ -115,6 +115,27 @@ extern "C"
 	WINPR_API DWORD WLog_GetLogLevel(wLog* log);
 	WINPR_API BOOL WLog_IsLevelActive(wLog* _log, DWORD _log_level);
 
+	/** @brief The lowest level any logger or filter currently lets through.
+	 *  The logging macros discard messages below it without looking up the logger level.
+	 *
+	 *  @return The level floor
+	 *  @since version 3.10.3
+	 */
+	WINPR_API LONG WLog_GetLevelFloor(void);
+
+#define WLog_IsLevelAboveFloor(_log_level) ((LONG)(_log_level) >= WLog_GetLevelFloor())
+
+	/** @brief Wait until all messages queued by asynchronous appenders have been written.
+	 *
+	 *  Appenders write text messages from a background thread after
+	 *  \b WLog_ConfigureAppender(appender, "async", value) with a non \b NULL value, or
+	 *  if the \b WLOG_ASYNC environment variable is set.
+	 *
+	 *  @return \b TRUE for success, \b FALSE otherwise.
+	 *  @since version 3.10.3
+	 */
+	WINPR_API BOOL WLog_Flush(void);
+
 	/** @brief Set a custom context for a dynamic logger.
 	 *  This can be used to print a customized prefix, e.g. some session id for a specific context
 	 *
@@ -137,19 +158,23 @@ extern "C"
 #define WLog_Print(_log, _log_level, ...)                        \
 	do                                                           \
 	{                                                            \
-		if (WLog_IsLevelActive(_log, _log_level))                \
+		if (WLog_IsLevelAboveFloor(_log_level) &&                \
+		    WLog_IsLevelActive(_log, _log_level))                \
 		{                                                        \
 			WLog_Print_unchecked(_log, _log_level, __VA_ARGS__); \
 		}                                                        \
 	} while (0)
 
-#define WLog_Print_tag(_tag, _log_level, ...)                 \
-	do                                                        \
-	{                                                         \
-		static wLog* _log_cached_ptr = NULL;                  \
-		if (!_log_cached_ptr)                                 \
-			_log_cached_ptr = WLog_Get(_tag);                 \
-		WLog_Print(_log_cached_ptr, _log_level, __VA_ARGS__); \
+#define WLog_Print_tag(_tag, _log_level, ...)                     \
+	do                                                            \
+	{                                                             \
+		static wLog* _log_cached_ptr = NULL;                      \
+		if (WLog_IsLevelAboveFloor(_log_level))                   \
+		{                                                         \
+			if (!_log_cached_ptr)                                 \
+				_log_cached_ptr = WLog_Get(_tag);                 \
+			WLog_Print(_log_cached_ptr, _log_level, __VA_ARGS__); \
+		}                                                         \
 	} while (0)
 
 #define WLog_PrintVA_unchecked(_log, _log_level, _args)                                        \
@@ -162,7 +187,8 @@ extern "C"
 #define WLog_PrintVA(_log, _log_level, _args)                \
 	do                                                       \
 	{                                                        \
-		if (WLog_IsLevelActive(_log, _log_level))            \
+		if (WLog_IsLevelAboveFloor(_log_level) &&            \
+		    WLog_IsLevelActive(_log, _log_level))            \
 		{                                                    \
 			WLog_PrintVA_unchecked(_log, _log_level, _args); \
 		}                                                    \
@@ -171,7 +197,7 @@ extern "C"
 #define WLog_Data(_log, _log_level, ...)                                                         \
 	do                                                                                           \
 	{                                                                                            \
-		if (WLog_IsLevelActive(_log, _log_level))                                                \
+		if (WLog_IsLevelAboveFloor(_log_level) && WLog_IsLevelActive(_log, _log_level))          \
 		{                                                                                        \
 			WLog_PrintMessage(_log, WLOG_MESSAGE_DATA, _log_level, __LINE__, __FILE__, __func__, \
 			                  __VA_ARGS__);                                                      \
@@ -181,7 +207,7 @@ extern "C"
 #define WLog_Image(_log, _log_level, ...)                                                        \
 	do                                                                                           \
 	{                                                                                            \
-		if (WLog_IsLevelActive(_log, _log_level))                                                \
+		if (WLog_IsLevelAboveFloor(_log_level) && WLog_IsLevelActive(_log, _log_level))          \
 		{                                                                                        \
 			WLog_PrintMessage(_log, WLOG_MESSAGE_DATA, _log_level, __LINE__, __FILE__, __func__, \
 			                  __VA_ARGS__);                                                      \
@@ -191,7 +217,7 @@ extern "C"
 #define WLog_Packet(_log, _log_level, ...)                                                         \
 	do                                                                                             \
 	{                                                                                              \
-		if (WLog_IsLevelActive(_log, _log_level))                                                  \
+		if (WLog_IsLevelAboveFloor(_log_level) && WLog_IsLevelActive(_log, _log_level))            \
 		{                                                                                          \
 			WLog_PrintMessage(_log, WLOG_MESSAGE_PACKET, _log_level, __LINE__, __FILE__, __func__, \
 			                  __VA_ARGS__);                                                        \
@@ -17,17 +17,30 @@
  * limitations under the License.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // NOLINT(bugprone-reserved-identifier,cert-dcl37-c,cert-dcl51-cpp)
+#endif
+
 #include <winpr/config.h>
 
 #include <winpr/crt.h>
 #include <winpr/sysinfo.h>
 #include <winpr/pool.h>
 #include <winpr/library.h>
+#include <winpr/environment.h>
+#include <winpr/file.h>
+#include <winpr/interlocked.h>
 
 #include "pool.h"
+#include "../log.h"
+#define TAG WINPR_TAG("pool")
 
 #ifdef WINPR_THREAD_POOL
 
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
 #ifdef _WIN32
 static INIT_ONCE init_once_module = INIT_ONCE_STATIC_INIT;
 static PTP_POOL(WINAPI* pCreateThreadpool)(PVOID reserved);
@@ -51,49 +64,432 @@ static BOOL CALLBACK init_module(PINIT_ONCE once, PVOID param, PVOID* context)
 }
 #endif
 
-static TP_POOL DEFAULT_POOL = {
-	0,    /* DWORD Minimum */
-	500,  /* DWORD Maximum */
-	NULL, /* wArrayList* Threads */
-	NULL, /* wQueue* PendingQueue */
-	NULL, /* HANDLE TerminateEvent */
-	NULL, /* wCountdownEvent* WorkComplete */
-};
+static TP_POOL DEFAULT_POOL = { .Minimum = 0, .Maximum = 500 };
+
+#define WINPR_POOL_DEQUE_MASK (WINPR_POOL_DEQUE_SIZE - 1)
+#define WINPR_POOL_INJECT_BATCH 32
+
+static INIT_ONCE init_once_worker = INIT_ONCE_STATIC_INIT;
+static DWORD worker_tls_index = TLS_OUT_OF_INDEXES;
+
+static BOOL CALLBACK init_worker(PINIT_ONCE once, PVOID param, PVOID* context)
+{
+	WINPR_UNUSED(once);
+	WINPR_UNUSED(param);
+	WINPR_UNUSED(context);
+	worker_tls_index = TlsAlloc();
+	return worker_tls_index != TLS_OUT_OF_INDEXES;
+}
+
+static BOOL start_workers(PTP_POOL pool);
+
+static TP_WORKER* current_worker(PTP_POOL pool)
+{
+	if (worker_tls_index == TLS_OUT_OF_INDEXES)
+		return NULL;
+
+	TP_WORKER* worker = TlsGetValue(worker_tls_index);
+	if (!worker || (worker->Pool != pool))
+		return NULL;
+	return worker;
+}
+
+static LONGLONG deque_load(LONGLONG volatile* value)
+{
+	return InterlockedCompareExchange64(value, 0, 0);
+}
+
+static void deque_store(LONGLONG volatile* value, LONGLONG next)
+{
+	LONGLONG current = 0;
+	do
+	{
+		current = *value;
+	} while (InterlockedCompareExchange64(value, next, current) != current);
+}
+
+static BOOL deque_push(TP_DEQUE* deque, PTP_CALLBACK_INSTANCE task)
+{
+	const LONGLONG bottom = deque->Bottom;
+	const LONGLONG top = deque_load(&deque->Top);
+
+	if (bottom - top >= WINPR_POOL_DEQUE_SIZE)
+		return FALSE;
+
+	deque->Tasks[bottom & WINPR_POOL_DEQUE_MASK] = task;
+	deque_store(&deque->Bottom, bottom + 1);
+	return TRUE;
+}
+
+static PTP_CALLBACK_INSTANCE deque_pop(TP_DEQUE* deque)
+{
+	const LONGLONG bottom = deque->Bottom - 1;
+	deque_store(&deque->Bottom, bottom);
+
+	const LONGLONG top = deque_load(&deque->Top);
+	if (top > bottom)
+	{
+		deque_store(&deque->Bottom, bottom + 1);
+		return NULL;
+	}
+
+	PTP_CALLBACK_INSTANCE task = deque->Tasks[bottom & WINPR_POOL_DEQUE_MASK];
+	if (top == bottom)
+	{
+		/* Last element, race against the thieves */
+		if (InterlockedCompareExchange64(&deque->Top, top + 1, top) != top)
+			task = NULL;
+		deque_store(&deque->Bottom, bottom + 1);
+	}
+
+	return task;
+}
+
+static PTP_CALLBACK_INSTANCE deque_steal(TP_DEQUE* deque)
+{
+	const LONGLONG top = deque_load(&deque->Top);
+	const LONGLONG bottom = deque_load(&deque->Bottom);
+
+	if (top >= bottom)
+		return NULL;
+
+	PTP_CALLBACK_INSTANCE task = deque->Tasks[top & WINPR_POOL_DEQUE_MASK];
+	if (InterlockedCompareExchange64(&deque->Top, top + 1, top) != top)
+		return NULL;
+	return task;
+}
+
+/* Grab a share of a pending queue with a single lock, keep the rest in the own deque */
+static PTP_CALLBACK_INSTANCE take_batch(PTP_POOL pool, TP_WORKER* worker, wQueue* queue)
+{
+	PTP_CALLBACK_INSTANCE task = NULL;
+
+	if (Queue_Count(queue) == 0)
+		return NULL;
+
+	Queue_Lock(queue);
+	size_t count = Queue_Count(queue);
+	if (count > 0)
+	{
+		size_t batch = 1;
+		if (worker && worker->Deque)
+		{
+			const size_t threads = (pool->Minimum > 0) ? pool->Minimum : 1;
+			batch = count / threads + 1;
+			if (batch > WINPR_POOL_INJECT_BATCH)
+				batch = WINPR_POOL_INJECT_BATCH;
+			if (batch > count)
+				batch = count;
+
+			/* Thieves only ever free up space, so the pushes below can not fail */
+			const LONGLONG used = worker->Deque->Bottom - deque_load(&worker->Deque->Top);
+			const size_t space = (size_t)(WINPR_POOL_DEQUE_SIZE - used);
+			if (batch > space + 1)
+				batch = space + 1;
+		}
+
+		task = Queue_Dequeue(queue);
+		for (size_t x = 1; x < batch; x++)
+			(void)deque_push(worker->Deque, Queue_Dequeue(queue));
+	}
+	Queue_Unlock(queue);
+
+	return task;
+}
+
+static BOOL low_slots_free(PTP_POOL pool)
+{
+	return InterlockedCompareExchange(&pool->LowRunning, 0, 0) < pool->LowLimit;
+}
+
+static void signal_low(PTP_POOL pool)
+{
+	(void)InterlockedExchange(&pool->LowSignalled, 1);
+	(void)SetEvent(pool->LowEvent);
+}
+
+/* The low event is manual reset, clear it once nothing can be taken and set it again if that
+ * changed in between */
+static void clear_low(PTP_POOL pool)
+{
+	if (InterlockedExchange(&pool->LowSignalled, 0) == 0)
+		return;
+
+	(void)ResetEvent(pool->LowEvent);
+	if ((Queue_Count(pool->PendingQueues[WINPR_POOL_PRIORITY_LOW]) > 0) && low_slots_free(pool))
+		signal_low(pool);
+}
+
+/* Low priority tasks are taken one at a time and only while fewer than LowLimit run */
+static PTP_CALLBACK_INSTANCE take_low(PTP_POOL pool)
+{
+	wQueue* queue = pool->PendingQueues[WINPR_POOL_PRIORITY_LOW];
+
+	if (Queue_Count(queue) == 0)
+	{
+		clear_low(pool);
+		return NULL;
+	}
+
+	if (InterlockedIncrement(&pool->LowRunning) > pool->LowLimit)
+	{
+		(void)InterlockedDecrement(&pool->LowRunning);
+		clear_low(pool);
+		return NULL;
+	}
+
+	PTP_CALLBACK_INSTANCE task = Queue_Dequeue(queue);
+	if (!task)
+	{
+		(void)InterlockedDecrement(&pool->LowRunning);
+		clear_low(pool);
+	}
+	return task;
+}
+
+static PTP_CALLBACK_INSTANCE take_pending(PTP_POOL pool, TP_WORKER* worker)
+{
+	PTP_CALLBACK_INSTANCE task =
+	    take_batch(pool, worker, pool->PendingQueues[WINPR_POOL_PRIORITY_HIGH]);
+	if (!task)
+		task = take_batch(pool, worker, pool->PendingQueues[WINPR_POOL_PRIORITY_NORMAL]);
+	if (!task)
+		task = take_low(pool);
+	return task;
+}
+
+static PTP_CALLBACK_INSTANCE steal_task(PTP_POOL pool, TP_WORKER* worker)
+{
+	const LONG count = InterlockedCompareExchange(&pool->WorkerCount, 0, 0);
+	const DWORD start = worker ? worker->Index + 1 : 0;
+
+	for (LONG x = 0; x < count; x++)
+	{
+		TP_WORKER* victim = &pool->Workers[(start + (DWORD)x) % (DWORD)count];
+		if ((victim == worker) || !victim->Deque)
+			continue;
+
+		PTP_CALLBACK_INSTANCE task = deque_steal(victim->Deque);
+		if (task)
+			return task;
+	}
+
+	return NULL;
+}
+
+PTP_CALLBACK_INSTANCE ThreadpoolFindTask(PTP_POOL pool)
+{
+	PTP_CALLBACK_INSTANCE task = NULL;
+	TP_WORKER* worker = current_worker(pool);
+
+	WINPR_ASSERT(pool);
+
+	if (worker && worker->Deque)
+		task = deque_pop(worker->Deque);
+	if (!task)
+		task = take_pending(pool, worker);
+	if (!task)
+		task = steal_task(pool, worker);
+	return task;
+}
+
+void ThreadpoolSubmitTasks(PTP_POOL pool, PTP_CALLBACK_INSTANCE* tasks, size_t count)
+{
+	size_t x = 0;
+	BOOL low = FALSE;
+	TP_WORKER* worker = current_worker(pool);
+
+	WINPR_ASSERT(pool);
+	WINPR_ASSERT(tasks || (count == 0));
+
+	/* Workers are started with the first work, so a CPU hint can be set before */
+	if (!InterlockedCompareExchange(&pool->Started, 0, 0) && !start_workers(pool))
+		WLog_ERR(TAG, "failed to start the pool workers");
+
+	/* Nested submits stay local while every worker is busy, otherwise wake the idle ones.
+	 * Low priority tasks always go through the pool so the limit applies to them. */
+	if (worker && worker->Deque && (InterlockedCompareExchange(&pool->Idle, 0, 0) == 0))
+	{
+		for (; x < count; x++)
+		{
+			if (tasks[x]->Priority == WINPR_POOL_PRIORITY_LOW)
+				break;
+			if (!deque_push(worker->Deque, tasks[x]))
+				break;
+		}
+	}
+
+	/* A batch usually shares one priority, so this is a single lock as well */
+	for (DWORD priority = 0; priority < WINPR_POOL_PRIORITIES; priority++)
+	{
+		wQueue* queue = pool->PendingQueues[priority];
+		BOOL locked = FALSE;
+
+		for (size_t y = x; y < count; y++)
+		{
+			PTP_CALLBACK_INSTANCE task = tasks[y];
+			if (task->Priority != priority)
+				continue;
+
+			if (!locked)
+			{
+				Queue_Lock(queue);
+				locked = TRUE;
+			}
+
+			if (!Queue_Enqueue(queue, task))
+			{
+				WLog_ERR(TAG, "failed to queue work, running it inline");
+				Queue_Unlock(queue);
+				if (priority == WINPR_POOL_PRIORITY_LOW)
+					(void)InterlockedIncrement(&pool->LowRunning);
+				ThreadpoolRunTask(pool, task);
+				Queue_Lock(queue);
+			}
+			else if (priority == WINPR_POOL_PRIORITY_LOW)
+				low = TRUE;
+		}
+
+		if (locked)
+			Queue_Unlock(queue);
+	}
+
+	if (low && low_slots_free(pool))
+		signal_low(pool);
+}
+
+void ThreadpoolReleaseTask(PTP_CALLBACK_INSTANCE task)
+{
+	WINPR_ASSERT(task);
+
+	if (InterlockedDecrement(&task->Refs) == 0)
+	{
+		PTP_WORK work = task->Work;
+		free(task);
+		ThreadpoolReleaseWork(work);
+	}
+}
+
+void ThreadpoolUnlinkTask(PTP_CALLBACK_INSTANCE task)
+{
+	WINPR_ASSERT(task);
+
+	PTP_WORK work = task->Work;
+	if (task->Prev)
+		task->Prev->Next = task->Next;
+	else
+		work->Queued = task->Next;
+	if (task->Next)
+		task->Next->Prev = task->Prev;
+	task->Prev = NULL;
+	task->Next = NULL;
+	ThreadpoolReleaseTask(task);
+}
+
+void ThreadpoolRunTask(PTP_POOL pool, PTP_CALLBACK_INSTANCE task)
+{
+	WINPR_ASSERT(pool);
+	WINPR_ASSERT(task);
+
+	/* A thread waiting on the work may have run it already */
+	PTP_WORK work = task->Work;
+	const BOOL low = task->Priority == WINPR_POOL_PRIORITY_LOW;
+	if (InterlockedCompareExchange(&task->Claimed, 1, 0) == 0)
+	{
+		EnterCriticalSection(&work->Lock);
+		ThreadpoolUnlinkTask(task);
+		LeaveCriticalSection(&work->Lock);
+
+		work->WorkCallback(task, work->CallbackParameter, work);
+		ThreadpoolCompleteWork(work);
+	}
+	/* The reference of the task keeps the work alive up to here */
+	ThreadpoolReleaseTask(task);
+
+	if (low)
+	{
+		(void)InterlockedDecrement(&pool->LowRunning);
+		if (Queue_Count(pool->PendingQueues[WINPR_POOL_PRIORITY_LOW]) > 0)
+			signal_low(pool);
+	}
+}
+
+static void pin_worker(PTP_POOL pool, TP_WORKER* worker)
+{
+#if defined(__linux__)
+	if ((pool->CpuHint == WINPR_THREADPOOL_CPUS_ANY) || (pool->CpuCount == 0))
+		return;
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(pool->Cpus[worker->Index % pool->CpuCount], &set);
+	if (sched_setaffinity(0, sizeof(set), &set) != 0)
+		WLog_WARN(TAG, "failed to pin pool worker %" PRIu32, worker->Index);
+#else
+	WINPR_UNUSED(pool);
+	WINPR_UNUSED(worker);
+#endif
+}
 
 static DWORD WINAPI thread_pool_work_func(LPVOID arg)
 {
 	DWORD status = 0;
 	PTP_POOL pool = NULL;
-	PTP_WORK work = NULL;
-	HANDLE events[2];
+	TP_WORKER* worker = NULL;
+	HANDLE events[4];
 	PTP_CALLBACK_INSTANCE callbackInstance = NULL;
 
-	pool = (PTP_POOL)arg;
+	worker = (TP_WORKER*)arg;
+	pool = worker->Pool;
 
+	/* The low queue is not waited on directly, it stays signalled while the limit is reached */
 	events[0] = pool->TerminateEvent;
-	events[1] = Queue_Event(pool->PendingQueue);
+	events[1] = Queue_Event(pool->PendingQueues[WINPR_POOL_PRIORITY_HIGH]);
+	events[2] = Queue_Event(pool->PendingQueues[WINPR_POOL_PRIORITY_NORMAL]);
+	events[3] = pool->LowEvent;
+
+	(void)TlsSetValue(worker_tls_index, worker);
+	pin_worker(pool, worker);
 
 	while (1)
 	{
-		status = WaitForMultipleObjects(2, events, FALSE, INFINITE);
-
-		if (status == WAIT_OBJECT_0)
-			break;
+		callbackInstance = ThreadpoolFindTask(pool);
 
-		if (status != (WAIT_OBJECT_0 + 1))
-			break;
+		if (!callbackInstance)
+		{
+			/* Announce going idle before the last look so submitters do not keep work local */
+			(void)InterlockedIncrement(&pool->Idle);
+			callbackInstance = steal_task(pool, worker);
+			if (!callbackInstance)
+				status = WaitForMultipleObjects(ARRAYSIZE(events), events, FALSE, INFINITE);
+			(void)InterlockedDecrement(&pool->Idle);
+
+			if (!callbackInstance)
+			{
+				if (status == WAIT_OBJECT_0)
+					break;
+
+				if (status >= (WAIT_OBJECT_0 + ARRAYSIZE(events)))
+					break;
+
+				continue;
+			}
+		}
 
-		callbackInstance = (PTP_CALLBACK_INSTANCE)Queue_Dequeue(pool->PendingQueue);
+		ThreadpoolRunTask(pool, callbackInstance);
+	}
 
-		if (callbackInstance)
+	/* Hand the remaining local work back to the pool */
+	if (worker->Deque)
+	{
+		while ((callbackInstance = deque_pop(worker->Deque)))
 		{
-			work = callbackInstance->Work;
-			work->WorkCallback(callbackInstance, work->CallbackParameter, work);
-			CountdownEvent_Signal(pool->WorkComplete, 1);
-			free(callbackInstance);
+			if (!Queue_Enqueue(pool->PendingQueues[callbackInstance->Priority], callbackInstance))
+				ThreadpoolRunTask(pool, callbackInstance);
 		}
 	}
 
+	(void)TlsSetValue(worker_tls_index, NULL);
 	ExitThread(0);
 	return 0;
 }
@@ -104,6 +500,135 @@ static void threads_close(void* thread)
 	(void)CloseHandle(thread);
 }
 
+static BOOL update_cpus(PTP_POOL pool)
+{
+	pool->CpuCount = 0;
+
+	if (pool->CpuHint == WINPR_THREADPOOL_CPUS_ANY)
+		return TRUE;
+
+#if defined(__linux__)
+	SYSTEM_INFO info = { 0 };
+	DWORD capacity[WINPR_POOL_MAX_WORKERS] = { 0 };
+	DWORD min = UINT32_MAX;
+	DWORD max = 0;
+
+	GetSystemInfo(&info);
+	DWORD count = info.dwNumberOfProcessors;
+	if (count > WINPR_POOL_MAX_WORKERS)
+		count = WINPR_POOL_MAX_WORKERS;
+
+	for (DWORD x = 0; x < count; x++)
+	{
+		char path[64] = { 0 };
+		unsigned value = 0;
+
+		(void)_snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%" PRIu32 "/cpu_capacity",
+		                x);
+		FILE* fp = winpr_fopen(path, "r");
+		if (!fp)
+			return FALSE;
+		const int rc = fscanf(fp, "%u", &value);
+		(void)fclose(fp);
+		if (rc != 1)
+			return FALSE;
+
+		capacity[x] = value;
+		if (value < min)
+			min = value;
+		if (value > max)
+			max = value;
+	}
+
+	/* Symmetric system, nothing to choose from */
+	if ((count == 0) || (min == max))
+		return FALSE;
+
+	const DWORD split = min + (max - min) / 2;
+	for (DWORD x = 0; x < count; x++)
+	{
+		const BOOL fast = capacity[x] > split;
+		if (fast == (pool->CpuHint == WINPR_THREADPOOL_CPUS_PERFORMANCE))
+			pool->Cpus[pool->CpuCount++] = x;
+	}
+
+	return pool->CpuCount > 0;
+#else
+	return FALSE;
+#endif
+}
+
+static DWORD cpu_hint_from_environment(void)
+{
+	char value[32] = { 0 };
+	const DWORD rc = GetEnvironmentVariableA("WINPR_THREADPOOL_CPUS", value, sizeof(value));
+
+	if ((rc == 0) || (rc >= sizeof(value)))
+		return WINPR_THREADPOOL_CPUS_ANY;
+
+	if (_stricmp(value, "performance") == 0)
+		return WINPR_THREADPOOL_CPUS_PERFORMANCE;
+	if (_stricmp(value, "efficiency") == 0)
+		return WINPR_THREADPOOL_CPUS_EFFICIENCY;
+	return WINPR_THREADPOOL_CPUS_ANY;
+}
+
+static TP_WORKER* get_worker(PTP_POOL pool, size_t index)
+{
+	if (index >= WINPR_POOL_MAX_WORKERS)
+		return &pool->Overflow;
+
+	TP_WORKER* worker = &pool->Workers[index];
+	if (!worker->Deque)
+	{
+		worker->Deque = (TP_DEQUE*)calloc(1, sizeof(TP_DEQUE));
+		if (!worker->Deque)
+			return NULL;
+		worker->Pool = pool;
+		worker->Index = (DWORD)index;
+	}
+
+	if ((LONG)index >= pool->WorkerCount)
+		(void)InterlockedExchange(&pool->WorkerCount, (LONG)index + 1);
+	return worker;
+}
+
+static void set_minimum(PTP_POOL pool, DWORD minimum)
+{
+	pool->Minimum = minimum;
+	pool->LowLimit = (minimum > 4) ? (LONG)(minimum / 4) : 1;
+}
+
+/* Create workers up to the minimum, the pool counts as started from here */
+static BOOL start_workers(PTP_POOL pool)
+{
+	BOOL rc = FALSE;
+
+	ArrayList_Lock(pool->Threads);
+	(void)InterlockedExchange(&pool->Started, 1);
+	while (ArrayList_Count(pool->Threads) < pool->Minimum)
+	{
+		TP_WORKER* worker = get_worker(pool, ArrayList_Count(pool->Threads));
+		if (!worker)
+			goto fail;
+
+		HANDLE thread = CreateThread(NULL, 0, thread_pool_work_func, (void*)worker, 0, NULL);
+		if (!thread)
+			goto fail;
+
+		if (!ArrayList_Append(pool->Threads, thread))
+		{
+			(void)CloseHandle(thread);
+			goto fail;
+		}
+	}
+
+	rc = TRUE;
+fail:
+	ArrayList_Unlock(pool->Threads);
+	return rc;
+}
+
 static BOOL InitializeThreadpool(PTP_POOL pool)
 {
 	BOOL rc = FALSE;
@@ -112,10 +637,16 @@ static BOOL InitializeThreadpool(PTP_POOL pool)
 	if (pool->Threads)
 		return TRUE;
 
-	if (!(pool->PendingQueue = Queue_New(TRUE, -1, -1)))
-		goto fail;
+	for (size_t x = 0; x < WINPR_POOL_PRIORITIES; x++)
+	{
+		if (!(pool->PendingQueues[x] = Queue_New(TRUE, -1, -1)))
+			goto fail;
+
+		obj = Queue_Object(pool->PendingQueues[x]);
+		obj->fnObjectFree = free;
+	}
 
-	if (!(pool->WorkComplete = CountdownEvent_New(0)))
+	if (!(pool->LowEvent = CreateEvent(NULL, TRUE, FALSE, NULL)))
 		goto fail;
 
 	if (!(pool->TerminateEvent = CreateEvent(NULL, TRUE, FALSE, NULL)))
@@ -127,13 +658,20 @@ static BOOL InitializeThreadpool(PTP_POOL pool)
 	obj = ArrayList_Object(pool->Threads);
 	obj->fnObjectFree = threads_close;
 
+	if (!InitOnceExecuteOnce(&init_once_worker, init_worker, NULL, NULL))
+		goto fail;
+
+	pool->Overflow.Pool = pool;
+	pool->Overflow.Index = WINPR_POOL_MAX_WORKERS;
+	pool->CpuHint = cpu_hint_from_environment();
+	(void)update_cpus(pool);
+
 	SYSTEM_INFO info = { 0 };
 	GetSystemInfo(&info);
 	if (info.dwNumberOfProcessors < 1)
 		info.dwNumberOfProcessors = 1;
-	if (!SetThreadpoolThreadMinimum(pool, info.dwNumberOfProcessors))
-		goto fail;
-	SetThreadpoolThreadMaximum(pool, info.dwNumberOfProcessors);
+	set_minimum(pool, info.dwNumberOfProcessors);
+	pool->Maximum = info.dwNumberOfProcessors;
 
 	rc = TRUE;
 
@@ -188,10 +726,22 @@ VOID winpr_CloseThreadpool(PTP_POOL ptpp)
 	(void)SetEvent(ptpp->TerminateEvent);
 
 	ArrayList_Free(ptpp->Threads);
-	Queue_Free(ptpp->PendingQueue);
-	CountdownEvent_Free(ptpp->WorkComplete);
+	for (size_t x = 0; x < WINPR_POOL_PRIORITIES; x++)
+		Queue_Free(ptpp->PendingQueues[x]);
+	(void)CloseHandle(ptpp->LowEvent);
 	(void)CloseHandle(ptpp->TerminateEvent);
 
+	for (size_t x = 0; x < WINPR_POOL_MAX_WORKERS; x++)
+	{
+		TP_DEQUE* deque = ptpp->Workers[x].Deque;
+		if (!deque)
+			continue;
+
+		for (LONGLONG y = deque->Top; y < deque->Bottom; y++)
+			free(deque->Tasks[y & WINPR_POOL_DEQUE_MASK]);
+		free(deque);
+	}
+
 	{
 		TP_POOL empty = { 0 };
 		*ptpp = empty;
@@ -209,26 +759,13 @@ BOOL winpr_SetThreadpoolThreadMinimum(PTP_POOL ptpp, DWORD cthrdMic)
 	if (pSetThreadpoolThreadMinimum)
 		return pSetThreadpoolThreadMinimum(ptpp, cthrdMic);
 #endif
-	ptpp->Minimum = cthrdMic;
+	set_minimum(ptpp, cthrdMic);
 
-	ArrayList_Lock(ptpp->Threads);
-	while (ArrayList_Count(ptpp->Threads) < ptpp->Minimum)
-	{
-		HANDLE thread = CreateThread(NULL, 0, thread_pool_work_func, (void*)ptpp, 0, NULL);
-		if (!thread)
-			goto fail;
-
-		if (!ArrayList_Append(ptpp->Threads, thread))
-		{
-			(void)CloseHandle(thread);
-			goto fail;
-		}
-	}
-
-	rc = TRUE;
-fail:
-	ArrayList_Unlock(ptpp->Threads);
+	/* Before the first work only the limits are recorded */
+	if (!InterlockedCompareExchange(&ptpp->Started, 0, 0))
+		return TRUE;
 
+	rc = start_workers(ptpp);
 	return rc;
 }
 
@@ -256,3 +793,31 @@ VOID winpr_SetThreadpoolThreadMaximum(PTP_POOL ptpp, DWORD cthrdMost)
 }
 
 #endif /* WINPR_THREAD_POOL defined */
+
+BOOL winpr_SetThreadpoolCpuHint(PTP_POOL ptpp, WINPR_THREADPOOL_CPUS hint)
+{
+#ifdef WINPR_THREAD_POOL
+#ifdef _WIN32
+	InitOnceExecuteOnce(&init_once_module, init_module, NULL, NULL);
+	if (pCreateThreadpool)
+		return FALSE;
+#endif
+	WINPR_ASSERT(ptpp);
+
+	/* Running workers are never torn down for this, they may be in the middle of a callback */
+	BOOL rc = FALSE;
+	ArrayList_Lock(ptpp->Threads);
+	if (InterlockedCompareExchange(&ptpp->Started, 0, 0))
+		WLog_WARN(TAG, "the pool is running, the CPU hint only applies before the first work");
+	else
+	{
+		ptpp->CpuHint = hint;
+		rc = update_cpus(ptpp);
+	}
+	ArrayList_Unlock(ptpp->Threads);
+	return rc;
+#else
+	WINPR_UNUSED(ptpp);
+	return hint == WINPR_THREADPOOL_CPUS_ANY;
+#endif
+}
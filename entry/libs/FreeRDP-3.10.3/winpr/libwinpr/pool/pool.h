@@ -26,11 +26,46 @@
 #include <winpr/thread.h>
 #include <winpr/collections.h>
 
+/* Capacity of a worker deque, must be a power of two */
+#define WINPR_POOL_DEQUE_SIZE 1024
+#define WINPR_POOL_MAX_WORKERS 64
+
+/* Pending queues by callback priority, high first */
+#define WINPR_POOL_PRIORITY_HIGH 0
+#define WINPR_POOL_PRIORITY_NORMAL 1
+#define WINPR_POOL_PRIORITY_LOW 2
+#define WINPR_POOL_PRIORITIES 3
+
+/**
+ * Chase-Lev work stealing deque.
+ * The owning worker pushes and pops at the bottom, other threads steal from the top.
+ */
+typedef struct
+{
+	LONGLONG volatile Top;
+	LONGLONG volatile Bottom;
+	PTP_CALLBACK_INSTANCE volatile Tasks[WINPR_POOL_DEQUE_SIZE];
+} TP_DEQUE;
+
+typedef struct
+{
+	PTP_POOL Pool;
+	TP_DEQUE* Deque;
+	DWORD Index;
+} TP_WORKER;
+
 #if defined(_WIN32)
 #if (_WIN32_WINNT < _WIN32_WINNT_WIN6) || defined(__MINGW32__)
 struct S_TP_CALLBACK_INSTANCE
 {
 	PTP_WORK Work;
+	DWORD Priority;
+	/* Set by whoever runs the callback, a pool worker or a thread waiting on the work */
+	LONG volatile Claimed;
+	/* One reference for the pool queues, one while listed in the work */
+	LONG volatile Refs;
+	PTP_CALLBACK_INSTANCE Prev;
+	PTP_CALLBACK_INSTANCE Next;
 };
 
 struct S_TP_POOL
@@ -38,9 +73,20 @@ struct S_TP_POOL
 	DWORD Minimum;
 	DWORD Maximum;
 	wArrayList* Threads;
-	wQueue* PendingQueue;
+	wQueue* PendingQueues[WINPR_POOL_PRIORITIES];
 	HANDLE TerminateEvent;
-	wCountdownEvent* WorkComplete;
+	HANDLE LowEvent;
+	LONG volatile LowSignalled;
+	LONG volatile LowRunning;
+	LONG LowLimit;
+	LONG volatile Idle;
+	LONG volatile WorkerCount;
+	LONG volatile Started;
+	TP_WORKER Workers[WINPR_POOL_MAX_WORKERS];
+	TP_WORKER Overflow;
+	DWORD CpuHint;
+	DWORD CpuCount;
+	DWORD Cpus[WINPR_POOL_MAX_WORKERS];
 };
 
 struct S_TP_WORK
@@ -48,6 +94,15 @@ struct S_TP_WORK
 	PVOID CallbackParameter;
 	PTP_WORK_CALLBACK WorkCallback;
 	PTP_CALLBACK_ENVIRON CallbackEnvironment;
+	/* One reference for the owner, one for every callback instance */
+	LONG volatile Refs;
+	/* Callbacks submitted and not yet finished, changed with Lock held */
+	LONG volatile Pending;
+	/* Signalled while nothing is pending */
+	HANDLE CompleteEvent;
+	/* Queued instances not claimed yet, a waiter only ever helps with these */
+	CRITICAL_SECTION Lock;
+	PTP_CALLBACK_INSTANCE Queued;
 };
 
 struct S_TP_TIMER
@@ -75,6 +130,13 @@ struct S_TP_CLEANUP_GROUP
 struct S_TP_CALLBACK_INSTANCE
 {
 	PTP_WORK Work;
+	DWORD Priority;
+	/* Set by whoever runs the callback, a pool worker or a thread waiting on the work */
+	LONG volatile Claimed;
+	/* One reference for the pool queues, one while listed in the work */
+	LONG volatile Refs;
+	PTP_CALLBACK_INSTANCE Prev;
+	PTP_CALLBACK_INSTANCE Next;
 };
 
 struct S_TP_POOL
@@ -82,9 +144,20 @@ struct S_TP_POOL
 	DWORD Minimum;
 	DWORD Maximum;
 	wArrayList* Threads;
-	wQueue* PendingQueue;
+	wQueue* PendingQueues[WINPR_POOL_PRIORITIES];
 	HANDLE TerminateEvent;
-	wCountdownEvent* WorkComplete;
+	HANDLE LowEvent;
+	LONG volatile LowSignalled;
+	LONG volatile LowRunning;
+	LONG LowLimit;
+	LONG volatile Idle;
+	LONG volatile WorkerCount;
+	LONG volatile Started;
+	TP_WORKER Workers[WINPR_POOL_MAX_WORKERS];
+	TP_WORKER Overflow;
+	DWORD CpuHint;
+	DWORD CpuCount;
+	DWORD Cpus[WINPR_POOL_MAX_WORKERS];
 };
 
 struct S_TP_WORK
@@ -92,6 +165,15 @@ struct S_TP_WORK
 	PVOID CallbackParameter;
 	PTP_WORK_CALLBACK WorkCallback;
 	PTP_CALLBACK_ENVIRON CallbackEnvironment;
+	/* One reference for the owner, one for every callback instance */
+	LONG volatile Refs;
+	/* Callbacks submitted and not yet finished, changed with Lock held */
+	LONG volatile Pending;
+	/* Signalled while nothing is pending */
+	HANDLE CompleteEvent;
+	/* Queued instances not claimed yet, a waiter only ever helps with these */
+	CRITICAL_SECTION Lock;
+	PTP_CALLBACK_INSTANCE Queued;
 };
 
 struct S_TP_TIMER
@@ -119,4 +201,19 @@ struct S_TP_CLEANUP_GROUP
 
 PTP_POOL GetDefaultThreadpool(void);
 
+/* Queue callback instances, on a worker of the pool they go to its own deque */
+void ThreadpoolSubmitTasks(PTP_POOL pool, PTP_CALLBACK_INSTANCE* tasks, size_t count);
+/* Take a task from the calling worker's deque, the pending queues or another worker */
+PTP_CALLBACK_INSTANCE ThreadpoolFindTask(PTP_POOL pool);
+/* Run a task taken from the pool, unless a waiter already ran it */
+void ThreadpoolRunTask(PTP_POOL pool, PTP_CALLBACK_INSTANCE task);
+/* Drop a reference to a task, frees it with the last one */
+void ThreadpoolReleaseTask(PTP_CALLBACK_INSTANCE task);
+/* Unlink a claimed task from its work, called with the work lock held */
+void ThreadpoolUnlinkTask(PTP_CALLBACK_INSTANCE task);
+/* Account a finished callback of the work, wakes its waiters with the last one */
+void ThreadpoolCompleteWork(PTP_WORK work);
+/* Drop a reference to a work, frees it with the last one */
+void ThreadpoolReleaseWork(PTP_WORK work);
+
 #endif /* WINPR_POOL_PRIVATE_H */
@@ -0,0 +1,134 @@
+
+#include <winpr/wtypes.h>
+#include <winpr/crt.h>
+#include <winpr/pool.h>
+#include <winpr/sysinfo.h>
+#include <winpr/synch.h>
+#include <winpr/interlocked.h>
+
+#define TEST_THREADS 8
+#define TEST_LOW_LIMIT (TEST_THREADS / 4)
+#define TEST_TASKS 32
+
+static LONG volatile lowRunning = 0;
+static LONG volatile lowMax = 0;
+static LONG volatile lowDone = 0;
+static LONG volatile highDone = 0;
+static LONG volatile lowLeftAfterHigh = -1;
+
+static void CALLBACK test_LowCallback(PTP_CALLBACK_INSTANCE instance, void* context,
+                                      PTP_WORK work)
+{
+	WINPR_UNUSED(instance);
+	WINPR_UNUSED(context);
+	WINPR_UNUSED(work);
+
+	const LONG running = InterlockedIncrement(&lowRunning);
+	LONG current = lowMax;
+	while ((running > current) &&
+	       (InterlockedCompareExchange(&lowMax, running, current) != current))
+		current = lowMax;
+
+	Sleep(5);
+	(void)InterlockedDecrement(&lowRunning);
+	(void)InterlockedIncrement(&lowDone);
+}
+
+static void CALLBACK test_HighCallback(PTP_CALLBACK_INSTANCE instance, void* context,
+                                       PTP_WORK work)
+{
+	WINPR_UNUSED(instance);
+	WINPR_UNUSED(context);
+	WINPR_UNUSED(work);
+
+	Sleep(1);
+	if (InterlockedIncrement(&highDone) == TEST_TASKS)
+		(void)InterlockedExchange(&lowLeftAfterHigh, TEST_TASKS - lowDone);
+}
+
+static BOOL submit(PTP_WORK* works, PTP_WORK_CALLBACK cb, TP_CALLBACK_ENVIRON* env)
+{
+	for (size_t x = 0; x < TEST_TASKS; x++)
+	{
+		works[x] = CreateThreadpoolWork(cb, NULL, env);
+		if (!works[x])
+			return FALSE;
+	}
+
+	winpr_SubmitThreadpoolWorkBatch(works, TEST_TASKS);
+	return TRUE;
+}
+
+static void wait_and_close(PTP_WORK* works)
+{
+	for (size_t x = 0; x < TEST_TASKS; x++)
+	{
+		if (!works[x])
+			continue;
+		WaitForThreadpoolWorkCallbacks(works[x], FALSE);
+		CloseThreadpoolWork(works[x]);
+	}
+}
+
+int TestPoolPriority(int argc, char* argv[])
+{
+	int rc = -1;
+	PTP_WORK low[TEST_TASKS] = { 0 };
+	PTP_WORK high[TEST_TASKS] = { 0 };
+	TP_CALLBACK_ENVIRON lowEnv;
+	TP_CALLBACK_ENVIRON highEnv;
+	PTP_POOL pool = NULL;
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+#ifdef _WIN32
+	/* Native pools do not limit low priority callbacks */
+	return 0;
+#endif
+
+	pool = CreateThreadpool(NULL);
+	if (!pool)
+		return -1;
+
+	if (!SetThreadpoolThreadMinimum(pool, TEST_THREADS))
+		goto fail;
+	SetThreadpoolThreadMaximum(pool, TEST_THREADS);
+
+	InitializeThreadpoolEnvironment(&lowEnv);
+	SetThreadpoolCallbackPool(&lowEnv, pool);
+	InitializeThreadpoolEnvironment(&highEnv);
+	SetThreadpoolCallbackPool(&highEnv, pool);
+#ifndef _WIN32
+	SetThreadpoolCallbackPriority(&lowEnv, TP_CALLBACK_PRIORITY_LOW);
+	SetThreadpoolCallbackPriority(&highEnv, TP_CALLBACK_PRIORITY_HIGH);
+#endif
+
+	/* The low tasks queue up behind the limit, the high ones take the remaining workers */
+	const BOOL submitted = submit(low, test_LowCallback, &lowEnv) &&
+	                       submit(high, test_HighCallback, &highEnv);
+	wait_and_close(high);
+	wait_and_close(low);
+	if (!submitted)
+		goto fail;
+
+	printf("low: %" PRId32 " done, at most %" PRId32 " running, %" PRId32
+	       " left after the high tasks\n",
+	       lowDone, lowMax, lowLeftAfterHigh);
+
+	if ((lowDone != TEST_TASKS) || (highDone != TEST_TASKS))
+		goto fail;
+
+	if (lowMax > TEST_LOW_LIMIT)
+		goto fail;
+
+	if (lowLeftAfterHigh <= 0)
+		goto fail;
+
+	rc = 0;
+fail:
+	DestroyThreadpoolEnvironment(&lowEnv);
+	DestroyThreadpoolEnvironment(&highEnv);
+	CloseThreadpool(pool);
+	return rc;
+}
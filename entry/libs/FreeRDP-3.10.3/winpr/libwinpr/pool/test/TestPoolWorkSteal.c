@@ -0,0 +1,369 @@
+
+#include <winpr/wtypes.h>
+#include <winpr/crt.h>
+#include <winpr/pool.h>
+#include <winpr/thread.h>
+#include <winpr/sysinfo.h>
+#include <winpr/interlocked.h>
+
+#define TEST_TILES 256
+#define TEST_CHILDREN 64
+
+static LONG volatile done = 0;
+static LONG volatile children = 0;
+static LONG volatile foreign = 0;
+static LONG volatile woken = 0;
+
+#define TEST_WAITERS 4
+
+typedef struct
+{
+	TP_CALLBACK_ENVIRON* env;
+	BOOL ok;
+} test_parent;
+
+static void CALLBACK test_TileCallback(PTP_CALLBACK_INSTANCE instance, void* context,
+                                       PTP_WORK work)
+{
+	BYTE a[4096] = { 0 };
+
+	WINPR_UNUSED(instance);
+	WINPR_UNUSED(work);
+
+	FillMemory(a, ARRAYSIZE(a), 0xAA);
+	(void)InterlockedIncrement((LONG volatile*)context);
+}
+
+/* Submits from inside a callback and waits for the children on the worker itself */
+static void CALLBACK test_ParentCallback(PTP_CALLBACK_INSTANCE instance, void* context,
+                                         PTP_WORK work)
+{
+	test_parent* parent = context;
+	PTP_WORK works[TEST_CHILDREN] = { 0 };
+
+	WINPR_UNUSED(instance);
+	WINPR_UNUSED(work);
+
+	for (size_t x = 0; x < ARRAYSIZE(works); x++)
+	{
+		works[x] = CreateThreadpoolWork(test_TileCallback, (void*)&children, parent->env);
+		if (!works[x])
+			goto fail;
+	}
+
+	winpr_SubmitThreadpoolWorkBatch(works, ARRAYSIZE(works));
+
+	for (size_t x = 0; x < ARRAYSIZE(works); x++)
+		WaitForThreadpoolWorkCallbacks(works[x], FALSE);
+
+	parent->ok = TRUE;
+fail:
+	for (size_t x = 0; x < ARRAYSIZE(works); x++)
+	{
+		if (works[x])
+			CloseThreadpoolWork(works[x]);
+	}
+}
+
+static void CALLBACK test_BlockCallback(PTP_CALLBACK_INSTANCE instance, void* context,
+                                        PTP_WORK work)
+{
+	WINPR_UNUSED(instance);
+	WINPR_UNUSED(work);
+
+	(void)WaitForSingleObject((HANDLE)context, INFINITE);
+}
+
+static void CALLBACK test_ForeignCallback(PTP_CALLBACK_INSTANCE instance, void* context,
+                                          PTP_WORK work)
+{
+	WINPR_UNUSED(instance);
+	WINPR_UNUSED(context);
+	WINPR_UNUSED(work);
+
+	(void)InterlockedIncrement(&foreign);
+}
+
+/* A waiter may only help with its own work, never run unrelated queued callbacks */
+static BOOL test_foreign(TP_CALLBACK_ENVIRON* env)
+{
+	BOOL rc = FALSE;
+	PTP_WORK block = NULL;
+	PTP_WORK other = NULL;
+	PTP_WORK own = NULL;
+	HANDLE event = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+	if (!event)
+		return FALSE;
+
+	foreign = 0;
+	block = CreateThreadpoolWork(test_BlockCallback, event, env);
+	other = CreateThreadpoolWork(test_ForeignCallback, NULL, env);
+	own = CreateThreadpoolWork(test_TileCallback, (void*)&done, env);
+	if (!block || !other || !own)
+		goto fail;
+
+	/* The only worker is blocked, the waiter has to run its own work but not the other one */
+	done = 0;
+	SubmitThreadpoolWork(block);
+	SubmitThreadpoolWork(other);
+	SubmitThreadpoolWork(own);
+	WaitForThreadpoolWorkCallbacks(own, FALSE);
+
+	if ((done != 1) || (foreign != 0))
+	{
+		printf("foreign: %" PRId32 " own, %" PRId32 " unrelated callbacks\n", done, foreign);
+		goto fail;
+	}
+
+	(void)SetEvent(event);
+	WaitForThreadpoolWorkCallbacks(block, FALSE);
+	WaitForThreadpoolWorkCallbacks(other, FALSE);
+	if (foreign != 1)
+		goto fail;
+
+	rc = TRUE;
+fail:
+	(void)SetEvent(event);
+	if (own)
+		CloseThreadpoolWork(own);
+	if (other)
+	{
+		WaitForThreadpoolWorkCallbacks(other, FALSE);
+		CloseThreadpoolWork(other);
+	}
+	if (block)
+	{
+		WaitForThreadpoolWorkCallbacks(block, FALSE);
+		CloseThreadpoolWork(block);
+	}
+	(void)CloseHandle(event);
+	return rc;
+}
+
+static DWORD WINAPI test_waiter(LPVOID arg)
+{
+	WaitForThreadpoolWorkCallbacks((PTP_WORK)arg, FALSE);
+	(void)InterlockedIncrement(&woken);
+	return 0;
+}
+
+/* Every thread waiting on a work wakes up once its callbacks finished */
+static BOOL test_waiters(TP_CALLBACK_ENVIRON* env)
+{
+	BOOL rc = FALSE;
+	HANDLE threads[TEST_WAITERS] = { 0 };
+	HANDLE event = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+	if (!event)
+		return FALSE;
+
+	woken = 0;
+	PTP_WORK block = CreateThreadpoolWork(test_BlockCallback, event, env);
+	if (!block)
+		goto fail;
+
+	SubmitThreadpoolWork(block);
+	for (size_t x = 0; x < ARRAYSIZE(threads); x++)
+	{
+		threads[x] = CreateThread(NULL, 0, test_waiter, block, 0, NULL);
+		if (!threads[x])
+			goto fail;
+	}
+
+	/* Let the waiters get past spinning and block */
+	Sleep(50);
+	if (woken != 0)
+	{
+		printf("waiters: %" PRId32 " returned early\n", woken);
+		goto fail;
+	}
+
+	(void)SetEvent(event);
+	for (size_t x = 0; x < ARRAYSIZE(threads); x++)
+	{
+		if (WaitForSingleObject(threads[x], 5000) != WAIT_OBJECT_0)
+		{
+			printf("waiters: %" PRId32 " of %d woken\n", woken, TEST_WAITERS);
+			goto fail;
+		}
+	}
+
+	rc = TRUE;
+fail:
+	(void)SetEvent(event);
+	for (size_t x = 0; x < ARRAYSIZE(threads); x++)
+	{
+		if (!threads[x])
+			continue;
+		(void)WaitForSingleObject(threads[x], INFINITE);
+		(void)CloseHandle(threads[x]);
+	}
+	if (block)
+	{
+		WaitForThreadpoolWorkCallbacks(block, FALSE);
+		CloseThreadpoolWork(block);
+	}
+	(void)CloseHandle(event);
+	return rc;
+}
+
+static BOOL test_batch(TP_CALLBACK_ENVIRON* env)
+{
+	BOOL rc = FALSE;
+	PTP_WORK works[TEST_TILES] = { 0 };
+
+	done = 0;
+	for (size_t x = 0; x < ARRAYSIZE(works); x++)
+	{
+		works[x] = CreateThreadpoolWork(test_TileCallback, (void*)&done, env);
+		if (!works[x])
+			goto fail;
+	}
+
+	const UINT64 start = winpr_GetTickCount64NS();
+	winpr_SubmitThreadpoolWorkBatch(works, ARRAYSIZE(works));
+
+	for (size_t x = 0; x < ARRAYSIZE(works); x++)
+		WaitForThreadpoolWorkCallbacks(works[x], FALSE);
+	const UINT64 batch = winpr_GetTickCount64NS() - start;
+
+	if (done != TEST_TILES)
+	{
+		printf("batch: %" PRId32 " of %d callbacks\n", done, TEST_TILES);
+		goto fail;
+	}
+
+	/* The same work may be submitted several times, the wait covers all of them */
+	done = 0;
+	const UINT64 single_start = winpr_GetTickCount64NS();
+	for (size_t x = 0; x < ARRAYSIZE(works); x++)
+		SubmitThreadpoolWork(works[0]);
+	WaitForThreadpoolWorkCallbacks(works[0], FALSE);
+	const UINT64 single = winpr_GetTickCount64NS() - single_start;
+
+	if (done != TEST_TILES)
+	{
+		printf("single: %" PRId32 " of %d callbacks\n", done, TEST_TILES);
+		goto fail;
+	}
+
+	printf("%d tiles: %" PRIu64 "us batched, %" PRIu64 "us single\n", TEST_TILES, batch / 1000,
+	       single / 1000);
+	rc = TRUE;
+fail:
+	for (size_t x = 0; x < ARRAYSIZE(works); x++)
+	{
+		if (works[x])
+			CloseThreadpoolWork(works[x]);
+	}
+	return rc;
+}
+
+static BOOL test_nested(TP_CALLBACK_ENVIRON* env, size_t parents)
+{
+	BOOL rc = TRUE;
+	PTP_WORK works[4] = { 0 };
+	test_parent params[4] = { 0 };
+
+	if (parents > ARRAYSIZE(works))
+		return FALSE;
+
+	children = 0;
+	for (size_t x = 0; x < parents; x++)
+	{
+		params[x].env = env;
+		works[x] = CreateThreadpoolWork(test_ParentCallback, &params[x], env);
+		if (!works[x])
+			rc = FALSE;
+	}
+
+	if (rc)
+		winpr_SubmitThreadpoolWorkBatch(works, parents);
+
+	for (size_t x = 0; x < parents; x++)
+	{
+		if (!works[x])
+			continue;
+		WaitForThreadpoolWorkCallbacks(works[x], FALSE);
+		CloseThreadpoolWork(works[x]);
+		if (!params[x].ok)
+			rc = FALSE;
+	}
+
+	if (rc && (children != (LONG)(parents * TEST_CHILDREN)))
+	{
+		printf("nested: %" PRId32 " of %" PRIuz " callbacks\n", children, parents * TEST_CHILDREN);
+		rc = FALSE;
+	}
+
+	return rc;
+}
+
+static BOOL test_pool(DWORD threads)
+{
+	BOOL rc = FALSE;
+	TP_CALLBACK_ENVIRON environment;
+	PTP_POOL pool = CreateThreadpool(NULL);
+
+	if (!pool)
+		return FALSE;
+
+	if (!SetThreadpoolThreadMinimum(pool, threads))
+		goto fail;
+	SetThreadpoolThreadMaximum(pool, threads);
+
+	InitializeThreadpoolEnvironment(&environment);
+	SetThreadpoolCallbackPool(&environment, pool);
+
+	/* The hint only applies before the workers are started by the first submit */
+	if (!winpr_SetThreadpoolCpuHint(pool, WINPR_THREADPOOL_CPUS_ANY))
+		goto fail;
+	(void)winpr_SetThreadpoolCpuHint(pool, WINPR_THREADPOOL_CPUS_PERFORMANCE);
+
+	printf("pool with %" PRIu32 " threads\n", threads);
+	if (!test_batch(&environment))
+		goto fail;
+
+	if (winpr_SetThreadpoolCpuHint(pool, WINPR_THREADPOOL_CPUS_ANY))
+	{
+		printf("cpu hint accepted on a running pool\n");
+		goto fail;
+	}
+
+	/* With a single worker the parent has to run its children while waiting */
+	if (!test_nested(&environment, (threads > 1) ? 4 : 1))
+		goto fail;
+
+	if (threads == 1)
+	{
+		if (!test_foreign(&environment))
+			goto fail;
+	}
+
+	if (!test_waiters(&environment))
+		goto fail;
+
+	if (!test_batch(&environment))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	DestroyThreadpoolEnvironment(&environment);
+	CloseThreadpool(pool);
+	return rc;
+}
+
+int TestPoolWorkSteal(int argc, char* argv[])
+{
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!test_pool(1))
+		return -1;
+
+	if (!test_pool(4))
+		return -1;
+
+	return 0;
+}
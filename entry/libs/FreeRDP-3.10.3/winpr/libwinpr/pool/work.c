@@ -23,11 +23,15 @@
 #include <winpr/crt.h>
 #include <winpr/pool.h>
 #include <winpr/library.h>
+#include <winpr/interlocked.h>
 
 #include "pool.h"
 #include "../log.h"
 #define TAG WINPR_TAG("pool")
 
+#define WINPR_POOL_WAIT_SPINS 64
+#define WINPR_POOL_SUBMIT_BATCH 64
+
 #ifdef WINPR_THREAD_POOL
 
 #ifdef _WIN32
@@ -60,13 +64,21 @@ static BOOL CALLBACK init_module(PINIT_ONCE once, PVOID param, PVOID* context)
 #endif
 
 static TP_CALLBACK_ENVIRON DEFAULT_CALLBACK_ENVIRONMENT = {
-	1,    /* Version */
-	NULL, /* Pool */
-	NULL, /* CleanupGroup */
-	NULL, /* CleanupGroupCancelCallback */
-	NULL, /* RaceDll */
-	NULL, /* FinalizationCallback */
-	{ 0 } /* Flags */
+#ifndef _WIN32
+	3,                           /* Version */
+#else
+	1, /* Version */
+#endif
+	NULL,                        /* Pool */
+	NULL,                        /* CleanupGroup */
+	NULL,                        /* CleanupGroupCancelCallback */
+	NULL,                        /* RaceDll */
+	NULL,                        /* FinalizationCallback */
+	{ 0 },                       /* Flags */
+#ifndef _WIN32
+	TP_CALLBACK_PRIORITY_NORMAL, /* CallbackPriority */
+	sizeof(TP_CALLBACK_ENVIRON)  /* Size */
+#endif
 };
 
 PTP_WORK winpr_CreateThreadpoolWork(PTP_WORK_CALLBACK pfnwk, PVOID pv, PTP_CALLBACK_ENVIRON pcbe)
@@ -92,6 +104,14 @@ PTP_WORK winpr_CreateThreadpoolWork(PTP_WORK_CALLBACK pfnwk, PVOID pv, PTP_CALLB
 		work->CallbackEnvironment = pcbe;
 		work->WorkCallback = pfnwk;
 		work->CallbackParameter = pv;
+		work->Refs = 1;
+		work->CompleteEvent = CreateEvent(NULL, TRUE, TRUE, NULL);
+		if (!work->CompleteEvent)
+		{
+			free(work);
+			return NULL;
+		}
+		InitializeCriticalSectionAndSpinCount(&work->Lock, 4000);
 #ifndef _WIN32
 
 		if (pcbe->CleanupGroup)
@@ -122,7 +142,82 @@ VOID winpr_CloseThreadpoolWork(PTP_WORK pwk)
 		ArrayList_Remove(pwk->CallbackEnvironment->CleanupGroup->groups, pwk);
 
 #endif
-	free(pwk);
+	/* Callbacks still finishing hold their own reference */
+	ThreadpoolReleaseWork(pwk);
+}
+
+void ThreadpoolReleaseWork(PTP_WORK work)
+{
+	WINPR_ASSERT(work);
+
+	if (InterlockedDecrement(&work->Refs) == 0)
+	{
+		(void)CloseHandle(work->CompleteEvent);
+		DeleteCriticalSection(&work->Lock);
+		free(work);
+	}
+}
+
+void ThreadpoolCompleteWork(PTP_WORK work)
+{
+	WINPR_ASSERT(work);
+
+	EnterCriticalSection(&work->Lock);
+	if (InterlockedDecrement(&work->Pending) == 0)
+		(void)SetEvent(work->CompleteEvent);
+	LeaveCriticalSection(&work->Lock);
+}
+
+static DWORD callback_priority(PTP_CALLBACK_ENVIRON pcbe)
+{
+#ifndef _WIN32
+	/* Version 1 environments end before the priority */
+	if (pcbe->Version >= 3)
+	{
+		/* SetThreadpoolCallbackPriority may run concurrently */
+		WINPR_STATIC_ASSERT(sizeof(pcbe->CallbackPriority) == sizeof(LONG));
+		switch (InterlockedCompareExchange((LONG volatile*)&pcbe->CallbackPriority, 0, 0))
+		{
+			case TP_CALLBACK_PRIORITY_HIGH:
+				return WINPR_POOL_PRIORITY_HIGH;
+			case TP_CALLBACK_PRIORITY_LOW:
+				return WINPR_POOL_PRIORITY_LOW;
+			default:
+				break;
+		}
+	}
+#else
+	WINPR_UNUSED(pcbe);
+#endif
+	return WINPR_POOL_PRIORITY_NORMAL;
+}
+
+static PTP_CALLBACK_INSTANCE create_instance(PTP_WORK pwk)
+{
+	WINPR_ASSERT(pwk);
+	WINPR_ASSERT(pwk->CallbackEnvironment);
+
+	PTP_CALLBACK_INSTANCE callbackInstance =
+	    (PTP_CALLBACK_INSTANCE)calloc(1, sizeof(TP_CALLBACK_INSTANCE));
+
+	if (callbackInstance)
+	{
+		callbackInstance->Work = pwk;
+		callbackInstance->Priority = callback_priority(pwk->CallbackEnvironment);
+		callbackInstance->Refs = 2;
+		(void)InterlockedIncrement(&pwk->Refs);
+
+		EnterCriticalSection(&pwk->Lock);
+		if (InterlockedIncrement(&pwk->Pending) == 1)
+			(void)ResetEvent(pwk->CompleteEvent);
+		callbackInstance->Next = pwk->Queued;
+		if (pwk->Queued)
+			pwk->Queued->Prev = callbackInstance;
+		pwk->Queued = callbackInstance;
+		LeaveCriticalSection(&pwk->Lock);
+	}
+
+	return callbackInstance;
 }
 
 VOID winpr_SubmitThreadpoolWork(PTP_WORK pwk)
@@ -140,19 +235,12 @@ VOID winpr_SubmitThreadpoolWork(PTP_WORK pwk)
 
 #endif
 
-	WINPR_ASSERT(pwk);
-	WINPR_ASSERT(pwk->CallbackEnvironment);
-	pool = pwk->CallbackEnvironment->Pool;
-	callbackInstance = (PTP_CALLBACK_INSTANCE)calloc(1, sizeof(TP_CALLBACK_INSTANCE));
+	callbackInstance = create_instance(pwk);
+	if (!callbackInstance)
+		return;
 
-	if (callbackInstance)
-	{
-		callbackInstance->Work = pwk;
-		CountdownEvent_AddCount(pool->WorkComplete, 1);
-		if (!Queue_Enqueue(pool->PendingQueue, callbackInstance))
-			free(callbackInstance);
-	}
-	// NOLINTNEXTLINE(clang-analyzer-unix.Malloc): Queue_Enqueue takes ownership of callbackInstance
+	pool = pwk->CallbackEnvironment->Pool;
+	ThreadpoolSubmitTasks(pool, &callbackInstance, 1);
 }
 
 BOOL winpr_TrySubmitThreadpoolCallback(PTP_SIMPLE_CALLBACK pfns, PVOID pv,
@@ -169,10 +257,30 @@ BOOL winpr_TrySubmitThreadpoolCallback(PTP_SIMPLE_CALLBACK pfns, PVOID pv,
 	return FALSE;
 }
 
+/* Claim a queued instance of the work, the pool skips it once it is dequeued there */
+static PTP_CALLBACK_INSTANCE claim_instance(PTP_WORK pwk)
+{
+	PTP_CALLBACK_INSTANCE task = NULL;
+
+	EnterCriticalSection(&pwk->Lock);
+	for (task = pwk->Queued; task; task = task->Next)
+	{
+		if (InterlockedCompareExchange(&task->Claimed, 1, 0) == 0)
+			break;
+	}
+	if (task)
+	{
+		/* The list reference goes, the one of the pool queue stays until it is dequeued */
+		(void)InterlockedIncrement(&task->Refs);
+		ThreadpoolUnlinkTask(task);
+	}
+	LeaveCriticalSection(&pwk->Lock);
+	return task;
+}
+
 VOID winpr_WaitForThreadpoolWorkCallbacks(PTP_WORK pwk, BOOL fCancelPendingCallbacks)
 {
-	HANDLE event = NULL;
-	PTP_POOL pool = NULL;
+	size_t spins = 0;
 
 #ifdef _WIN32
 	InitOnceExecuteOnce(&init_once_module, init_module, NULL, NULL);
@@ -187,13 +295,82 @@ VOID winpr_WaitForThreadpoolWorkCallbacks(PTP_WORK pwk, BOOL fCancelPendingCallb
 	WINPR_ASSERT(pwk);
 	WINPR_ASSERT(pwk->CallbackEnvironment);
 
-	pool = pwk->CallbackEnvironment->Pool;
-	WINPR_ASSERT(pool);
+	/* Do not block the waiter behind a long running callback */
+	const BOOL help = !pwk->CallbackEnvironment->u.s.LongFunction;
 
-	event = CountdownEvent_WaitHandle(pool->WorkComplete);
+	while (InterlockedCompareExchange(&pwk->Pending, 0, 0) > 0)
+	{
+		/* Run queued callbacks of this work on this thread instead of sleeping. Never run
+		 * others, they may belong to another user of the pool and take arbitrarily long. */
+		PTP_CALLBACK_INSTANCE task = help ? claim_instance(pwk) : NULL;
+		if (task)
+		{
+			pwk->WorkCallback(task, pwk->CallbackParameter, pwk);
+			ThreadpoolCompleteWork(pwk);
+			ThreadpoolReleaseTask(task);
+			spins = 0;
+			continue;
+		}
+
+		/* The tail of the work is running on the workers, it is usually short */
+		if (spins++ < WINPR_POOL_WAIT_SPINS)
+		{
+			(void)SwitchToThread();
+			continue;
+		}
 
-	if (WaitForSingleObject(event, INFINITE) != WAIT_OBJECT_0)
-		WLog_ERR(TAG, "error waiting on work completion");
+		/* Set and reset together with Pending, so no completion can be missed */
+		if (WaitForSingleObject(pwk->CompleteEvent, INFINITE) != WAIT_OBJECT_0)
+		{
+			WLog_ERR(TAG, "error waiting on work completion");
+			break;
+		}
+	}
 }
 
 #endif /* WINPR_THREAD_POOL defined */
+
+VOID winpr_SubmitThreadpoolWorkBatch(PTP_WORK* pwks, size_t count)
+{
+#ifdef WINPR_THREAD_POOL
+	PTP_CALLBACK_INSTANCE tasks[WINPR_POOL_SUBMIT_BATCH] = { 0 };
+	PTP_POOL pool = NULL;
+	size_t used = 0;
+
+#ifdef _WIN32
+	InitOnceExecuteOnce(&init_once_module, init_module, NULL, NULL);
+
+	if (pSubmitThreadpoolWork)
+	{
+		for (size_t x = 0; x < count; x++)
+			pSubmitThreadpoolWork(pwks[x]);
+		return;
+	}
+
+#endif
+	WINPR_ASSERT(pwks || (count == 0));
+
+	for (size_t x = 0; x < count; x++)
+	{
+		PTP_CALLBACK_INSTANCE task = create_instance(pwks[x]);
+		if (!task)
+			continue;
+
+		PTP_POOL next = pwks[x]->CallbackEnvironment->Pool;
+		if ((used == ARRAYSIZE(tasks)) || (used > 0 && (next != pool)))
+		{
+			ThreadpoolSubmitTasks(pool, tasks, used);
+			used = 0;
+		}
+
+		pool = next;
+		tasks[used++] = task;
+	}
+
+	if (used > 0)
+		ThreadpoolSubmitTasks(pool, tasks, used);
+#else
+	for (size_t x = 0; x < count; x++)
+		SubmitThreadpoolWork(pwks[x]);
+#endif
+}
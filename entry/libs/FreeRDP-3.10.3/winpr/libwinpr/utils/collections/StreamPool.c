@@ -21,6 +21,9 @@
 
 #include <winpr/crt.h>
 #include <winpr/wlog.h>
+#include <winpr/synch.h>
+#include <winpr/thread.h>
+#include <winpr/interlocked.h>
 
 #include <winpr/collections.h>
 
@@ -28,59 +31,106 @@
 #include "../log.h"
 #define TAG WINPR_TAG("utils.streampool")
 
-struct s_StreamPoolEntry
+/* Buffers are binned in power of two size classes from 64 bytes to 32 MiB, larger requests are
+ * allocated exactly and released when returned. */
+#define STREAMPOOL_MIN_SHIFT 6
+#define STREAMPOOL_CLASSES 20
+
+/* Classes up to 64 KiB are also cached in small magazines selected by the calling thread */
+#define STREAMPOOL_MAGAZINE_CLASSES 11
+#define STREAMPOOL_MAGAZINE_SIZE 8
+#define STREAMPOOL_MAGAZINE_BITS 3
+#define STREAMPOOL_MAGAZINES (1 << STREAMPOOL_MAGAZINE_BITS)
+
+/* Returns to the shared depot between two decays of the high-water marks */
+#define STREAMPOOL_TRIM_INTERVAL 256
+
+typedef struct s_StreamPoolItem wStreamPoolItem;
+
+struct s_StreamPoolItem
 {
+	wStream s; /* must be first, Stream_Free releases the item through it */
+
+	/* all streams owned by the pool, cached or in use */
+	wStreamPoolItem* prev;
+	wStreamPoolItem* next;
+
+	/* the depot free list */
+	wStreamPoolItem* free;
+
+	size_t cls;
+	LONG volatile inUse;
 #if defined(WITH_STREAMPOOL_DEBUG)
 	char** msg;
 	size_t lines;
 #endif
-	wStream* s;
 };
 
-struct s_wStreamPool
+typedef struct
 {
-	size_t aSize;
-	size_t aCapacity;
-	struct s_StreamPoolEntry* aArray;
-
-	size_t uSize;
-	size_t uCapacity;
-	struct s_StreamPoolEntry* uArray;
+	CRITICAL_SECTION lock;
+	size_t count[STREAMPOOL_MAGAZINE_CLASSES];
+	wStreamPoolItem* items[STREAMPOOL_MAGAZINE_CLASSES][STREAMPOOL_MAGAZINE_SIZE];
+	size_t bytes;
+	UINT64 takes;
+	UINT64 hits;
+	UINT64 contention;
+} wStreamPoolMagazine;
+
+typedef struct
+{
+	wStreamPoolItem* head;
+	size_t count;
+	LONG volatile used;
+	LONG volatile highWater;
+} wStreamPoolClass;
 
+struct s_wStreamPool
+{
 	CRITICAL_SECTION lock;
 	BOOL synchronized;
 	size_t defaultSize;
+
+	wStreamPoolItem* streams;
+	wStreamPoolClass classes[STREAMPOOL_CLASSES];
+	size_t bytes;
+	size_t returns;
+	UINT64 takes;
+	UINT64 hits;
+	UINT64 allocs;
+	UINT64 trimmed;
+	UINT64 contention;
+
+	LONG volatile used;
+	wStreamPoolMagazine magazines[STREAMPOOL_MAGAZINES];
 };
 
-static void discard_entry(struct s_StreamPoolEntry* entry, BOOL discardStream)
+static INLINE size_t StreamPool_ClassSize(size_t cls)
 {
-	if (!entry)
-		return;
-
-#if defined(WITH_STREAMPOOL_DEBUG)
-	free((void*)entry->msg);
-#endif
-
-	if (discardStream && entry->s)
-		Stream_Free(entry->s, entry->s->isAllocatedStream);
-
-	const struct s_StreamPoolEntry empty = { 0 };
-	*entry = empty;
+	return (size_t)1 << (cls + STREAMPOOL_MIN_SHIFT);
 }
 
-static struct s_StreamPoolEntry add_entry(wStream* s)
+/* The smallest class that holds \b size bytes, STREAMPOOL_CLASSES if there is none */
+static INLINE size_t StreamPool_SizeClass(size_t size)
 {
-	struct s_StreamPoolEntry entry = { 0 };
-
-#if defined(WITH_STREAMPOOL_DEBUG)
-	void* stack = winpr_backtrace(20);
-	if (stack)
-		entry.msg = winpr_backtrace_symbols(stack, &entry.lines);
-	winpr_backtrace_free(stack);
-#endif
+	size_t cls = 0;
+	while ((cls < STREAMPOOL_CLASSES) && (size > StreamPool_ClassSize(cls)))
+		cls++;
+	return cls;
+}
 
-	entry.s = s;
-	return entry;
+/* The largest class a buffer of \b capacity bytes can serve, STREAMPOOL_CLASSES if it should not
+ * be cached */
+static INLINE size_t StreamPool_CapacityClass(size_t capacity)
+{
+	if ((capacity < StreamPool_ClassSize(0)) ||
+	    (capacity > StreamPool_ClassSize(STREAMPOOL_CLASSES - 1)))
+		return STREAMPOOL_CLASSES;
+
+	size_t cls = 0;
+	while (capacity >= StreamPool_ClassSize(cls + 1))
+		cls++;
+	return cls;
 }
 
 /**
@@ -90,8 +140,11 @@ static struct s_StreamPoolEntry add_entry(wStream* s)
 static INLINE void StreamPool_Lock(wStreamPool* pool)
 {
 	WINPR_ASSERT(pool);
-	if (pool->synchronized)
+	if (pool->synchronized && !TryEnterCriticalSection(&pool->lock))
+	{
 		EnterCriticalSection(&pool->lock);
+		pool->contention++;
+	}
 }
 
 /**
@@ -105,109 +158,158 @@ static INLINE void StreamPool_Unlock(wStreamPool* pool)
 		LeaveCriticalSection(&pool->lock);
 }
 
-static BOOL StreamPool_EnsureCapacity(wStreamPool* pool, size_t count, BOOL usedOrAvailable)
+static INLINE wStreamPoolMagazine* StreamPool_Magazine(wStreamPool* pool)
 {
-	WINPR_ASSERT(pool);
-
-	size_t* cap = (usedOrAvailable) ? &pool->uCapacity : &pool->aCapacity;
-	size_t* size = (usedOrAvailable) ? &pool->uSize : &pool->aSize;
-	struct s_StreamPoolEntry** array = (usedOrAvailable) ? &pool->uArray : &pool->aArray;
-
-	size_t new_cap = 0;
-	if (*cap == 0)
-		new_cap = *size + count;
-	else if (*size + count > *cap)
-		new_cap = (*size + count + 2) / 2 * 3;
-	else if ((*size + count) < *cap / 3)
-		new_cap = *cap / 2;
+	/* Thread ids are often aligned pointers, spread them with a multiplicative hash */
+	const UINT32 hash = GetCurrentThreadId() * 2654435761u;
+	return &pool->magazines[hash >> (32 - STREAMPOOL_MAGAZINE_BITS)];
+}
 
-	if (new_cap > 0)
+static INLINE void StreamPool_LockMagazine(wStreamPool* pool, wStreamPoolMagazine* mag)
+{
+	WINPR_ASSERT(pool);
+	WINPR_ASSERT(mag);
+	if (pool->synchronized && !TryEnterCriticalSection(&mag->lock))
 	{
-		struct s_StreamPoolEntry* new_arr = NULL;
-
-		if (*cap < *size + count)
-			*cap += count;
-
-		new_arr =
-		    (struct s_StreamPoolEntry*)realloc(*array, sizeof(struct s_StreamPoolEntry) * new_cap);
-		if (!new_arr)
-			return FALSE;
-		*cap = new_cap;
-		*array = new_arr;
+		EnterCriticalSection(&mag->lock);
+		mag->contention++;
 	}
-	return TRUE;
 }
 
-/**
- * Methods
- */
+static INLINE void StreamPool_UnlockMagazine(wStreamPool* pool, wStreamPoolMagazine* mag)
+{
+	WINPR_ASSERT(pool);
+	WINPR_ASSERT(mag);
+	if (pool->synchronized)
+		LeaveCriticalSection(&mag->lock);
+}
 
-static void StreamPool_ShiftUsed(wStreamPool* pool, size_t index)
+/* Must be called with the pool locked */
+static wStreamPoolItem* StreamPool_Alloc(wStreamPool* pool, size_t capacity)
 {
 	WINPR_ASSERT(pool);
+	WINPR_ASSERT(capacity > 0);
 
-	const size_t pcount = 1;
-	const size_t off = index + pcount;
-	if (pool->uSize >= off)
+	wStreamPoolItem* item = (wStreamPoolItem*)calloc(1, sizeof(wStreamPoolItem));
+	if (!item)
+		return NULL;
+
+	BYTE* buffer = (BYTE*)malloc(capacity);
+	if (!buffer)
 	{
-		for (size_t x = 0; x < pcount; x++)
-		{
-			struct s_StreamPoolEntry* cur = &pool->uArray[index + x];
-			discard_entry(cur, FALSE);
-		}
-		MoveMemory(&pool->uArray[index], &pool->uArray[index + pcount],
-		           (pool->uSize - index - pcount) * sizeof(struct s_StreamPoolEntry));
-		pool->uSize -= pcount;
+		free(item);
+		return NULL;
 	}
-}
 
-/**
- * Adds a used stream to the pool.
- */
+	Stream_StaticInit(&item->s, buffer, capacity);
+	item->s.isAllocatedStream = TRUE;
+	item->s.isOwner = TRUE;
 
-static void StreamPool_AddUsed(wStreamPool* pool, wStream* s)
-{
-	StreamPool_EnsureCapacity(pool, 1, TRUE);
-	pool->uArray[pool->uSize] = add_entry(s);
-	pool->uSize++;
+	item->next = pool->streams;
+	if (pool->streams)
+		pool->streams->prev = item;
+	pool->streams = item;
+	pool->allocs++;
+	return item;
 }
 
-/**
- * Removes a used stream from the pool.
- */
-
-static void StreamPool_RemoveUsed(wStreamPool* pool, wStream* s)
+/* Must be called with the pool locked */
+static void StreamPool_Discard(wStreamPool* pool, wStreamPoolItem* item)
 {
 	WINPR_ASSERT(pool);
-	for (size_t index = 0; index < pool->uSize; index++)
+	WINPR_ASSERT(item);
+
+	if (item->prev)
+		item->prev->next = item->next;
+	else
+		pool->streams = item->next;
+	if (item->next)
+		item->next->prev = item->prev;
+
+#if defined(WITH_STREAMPOOL_DEBUG)
+	free((void*)item->msg);
+#endif
+	Stream_Free(&item->s, TRUE);
+}
+
+static void StreamPool_UpdateHighWater(wStreamPoolClass* c)
+{
+	WINPR_ASSERT(c);
+
+	const LONG used = InterlockedIncrement(&c->used);
+	LONG cur = c->highWater;
+	while (cur < used)
 	{
-		struct s_StreamPoolEntry* cur = &pool->uArray[index];
-		if (cur->s == s)
-		{
-			StreamPool_ShiftUsed(pool, index);
+		const LONG prev = InterlockedCompareExchange(&c->highWater, used, cur);
+		if (prev == cur)
 			break;
-		}
+		cur = prev;
 	}
 }
 
-static void StreamPool_ShiftAvailable(wStreamPool* pool, size_t index)
+/* Must be called with the pool locked */
+static void StreamPool_Trim(wStreamPool* pool)
 {
 	WINPR_ASSERT(pool);
 
-	const size_t pcount = 1;
-	const size_t off = index + pcount;
-	if (pool->aSize >= off)
+	/* Let the high-water marks decay towards the current use and drop what exceeds them */
+	for (size_t cls = 0; cls < STREAMPOOL_CLASSES; cls++)
 	{
-		for (size_t x = 0; x < pcount; x++)
+		wStreamPoolClass* c = &pool->classes[cls];
+		const LONG used = c->used;
+		LONG highWater = c->highWater;
+
+		highWater -= highWater / 4;
+		if (highWater < used)
+			highWater = used;
+		(void)InterlockedExchange(&c->highWater, highWater);
+
+		while (c->head && ((LONG)c->count + used > highWater))
 		{
-			struct s_StreamPoolEntry* cur = &pool->aArray[index + x];
-			discard_entry(cur, FALSE);
+			wStreamPoolItem* item = c->head;
+			c->head = item->free;
+			c->count--;
+			pool->bytes -= Stream_Capacity(&item->s);
+			pool->trimmed++;
+			StreamPool_Discard(pool, item);
 		}
+	}
+}
+
+static wStreamPoolItem* StreamPool_TakeMagazine(wStreamPool* pool, size_t cls)
+{
+	wStreamPoolItem* item = NULL;
+	wStreamPoolMagazine* mag = StreamPool_Magazine(pool);
 
-		MoveMemory(&pool->aArray[index], &pool->aArray[index + pcount],
-		           (pool->aSize - index - pcount) * sizeof(struct s_StreamPoolEntry));
-		pool->aSize -= pcount;
+	StreamPool_LockMagazine(pool, mag);
+	mag->takes++;
+	if (mag->count[cls] > 0)
+	{
+		item = mag->items[cls][--mag->count[cls]];
+		mag->bytes -= Stream_Capacity(&item->s);
+		mag->hits++;
 	}
+	StreamPool_UnlockMagazine(pool, mag);
+
+	return item;
+}
+
+/* Must be called with the pool locked */
+static wStreamPoolItem* StreamPool_TakeDepot(wStreamPool* pool, size_t cls, size_t size)
+{
+	if (cls >= STREAMPOOL_CLASSES)
+		return StreamPool_Alloc(pool, size);
+
+	wStreamPoolClass* c = &pool->classes[cls];
+	wStreamPoolItem* item = c->head;
+	if (!item)
+		return StreamPool_Alloc(pool, StreamPool_ClassSize(cls));
+
+	c->head = item->free;
+	c->count--;
+	pool->bytes -= Stream_Capacity(&item->s);
+	pool->hits++;
+	return item;
 }
 
 /**
@@ -216,51 +318,47 @@ static void StreamPool_ShiftAvailable(wStreamPool* pool, size_t index)
 
 wStream* StreamPool_Take(wStreamPool* pool, size_t size)
 {
-	BOOL found = FALSE;
-	size_t foundIndex = 0;
-	wStream* s = NULL;
+	wStreamPoolItem* item = NULL;
 
-	StreamPool_Lock(pool);
+	WINPR_ASSERT(pool);
 
 	if (size == 0)
 		size = pool->defaultSize;
 
-	for (size_t index = 0; index < pool->aSize; index++)
-	{
-		struct s_StreamPoolEntry* cur = &pool->aArray[index];
-		s = cur->s;
+	const size_t cls = StreamPool_SizeClass(size);
+	if (cls < STREAMPOOL_MAGAZINE_CLASSES)
+		item = StreamPool_TakeMagazine(pool, cls);
 
-		if (Stream_Capacity(s) >= size)
-		{
-			found = TRUE;
-			foundIndex = index;
-			break;
-		}
-	}
-
-	if (!found)
-	{
-		s = Stream_New(NULL, size);
-		if (!s)
-			goto out_fail;
-	}
-	else if (s)
+	if (!item)
 	{
-		Stream_SetPosition(s, 0);
-		Stream_SetLength(s, Stream_Capacity(s));
-		StreamPool_ShiftAvailable(pool, foundIndex);
+		StreamPool_Lock(pool);
+		if (cls >= STREAMPOOL_MAGAZINE_CLASSES)
+			pool->takes++;
+		item = StreamPool_TakeDepot(pool, cls, size);
+		StreamPool_Unlock(pool);
+
+		if (!item)
+			return NULL;
 	}
 
-	if (s)
-	{
-		s->pool = pool;
-		s->count = 1;
-		StreamPool_AddUsed(pool, s);
-	}
+	wStream* s = &item->s;
+	Stream_SetPosition(s, 0);
+	Stream_SetLength(s, Stream_Capacity(s));
+	s->pool = pool;
+	s->count = 1;
 
-out_fail:
-	StreamPool_Unlock(pool);
+#if defined(WITH_STREAMPOOL_DEBUG)
+	void* stack = winpr_backtrace(20);
+	if (stack)
+		item->msg = winpr_backtrace_symbols(stack, &item->lines);
+	winpr_backtrace_free(stack);
+#endif
 
+	item->cls = cls;
+	if (cls < STREAMPOOL_CLASSES)
+		StreamPool_UpdateHighWater(&pool->classes[cls]);
+	(void)InterlockedIncrement(&pool->used);
+	(void)InterlockedExchange(&item->inUse, 1);
 	return s;
 }
 
@@ -268,28 +366,49 @@ out_fail:
  * Returns an object to the pool.
  */
 
-static void StreamPool_Remove(wStreamPool* pool, wStream* s)
+static BOOL StreamPool_ReturnMagazine(wStreamPool* pool, wStreamPoolItem* item, size_t cls)
 {
-	StreamPool_EnsureCapacity(pool, 1, FALSE);
-	Stream_EnsureValidity(s);
-	for (size_t x = 0; x < pool->aSize; x++)
+	BOOL rc = FALSE;
+	wStreamPoolMagazine* mag = StreamPool_Magazine(pool);
+
+	StreamPool_LockMagazine(pool, mag);
+	if (mag->count[cls] < STREAMPOOL_MAGAZINE_SIZE)
 	{
-		wStream* cs = pool->aArray[x].s;
-		if (cs == s)
-			return;
+		mag->items[cls][mag->count[cls]++] = item;
+		mag->bytes += Stream_Capacity(&item->s);
+		rc = TRUE;
 	}
-	pool->aArray[(pool->aSize)++] = add_entry(s);
-	StreamPool_RemoveUsed(pool, s);
+	StreamPool_UnlockMagazine(pool, mag);
+
+	return rc;
 }
 
-static void StreamPool_ReleaseOrReturn(wStreamPool* pool, wStream* s)
+/* Must be called with the pool locked */
+static void StreamPool_ReturnDepot(wStreamPool* pool, wStreamPoolItem* item, size_t cls)
 {
-	StreamPool_Lock(pool);
-	if (s->count > 0)
-		s->count--;
-	if (s->count == 0)
-		StreamPool_Remove(pool, s);
-	StreamPool_Unlock(pool);
+	if ((++pool->returns % STREAMPOOL_TRIM_INTERVAL) == 0)
+		StreamPool_Trim(pool);
+
+	if (cls >= STREAMPOOL_CLASSES)
+	{
+		pool->trimmed++;
+		StreamPool_Discard(pool, item);
+		return;
+	}
+
+	/* Keep no more than the class needed at its peak */
+	wStreamPoolClass* c = &pool->classes[cls];
+	if ((LONG)c->count + c->used >= c->highWater)
+	{
+		pool->trimmed++;
+		StreamPool_Discard(pool, item);
+		return;
+	}
+
+	item->free = c->head;
+	c->head = item;
+	c->count++;
+	pool->bytes += Stream_Capacity(&item->s);
 }
 
 void StreamPool_Return(wStreamPool* pool, wStream* s)
@@ -298,9 +417,39 @@ void StreamPool_Return(wStreamPool* pool, wStream* s)
 	if (!s)
 		return;
 
-	StreamPool_Lock(pool);
-	StreamPool_Remove(pool, s);
-	StreamPool_Unlock(pool);
+	/* The pool takes ownership of foreign streams, there is no slot to cache them in */
+	if (s->pool != pool)
+	{
+		Stream_Free(s, TRUE);
+		return;
+	}
+
+	wStreamPoolItem* item = (wStreamPoolItem*)s;
+	if (InterlockedCompareExchange(&item->inUse, 0, 1) != 1)
+		return;
+
+	Stream_EnsureValidity(s);
+
+#if defined(WITH_STREAMPOOL_DEBUG)
+	free((void*)item->msg);
+	item->msg = NULL;
+	item->lines = 0;
+#endif
+
+	if (item->cls < STREAMPOOL_CLASSES)
+		(void)InterlockedDecrement(&pool->classes[item->cls].used);
+
+	/* The buffer might have grown while in use, file it by what it can serve now */
+	const size_t cls = StreamPool_CapacityClass(Stream_Capacity(s));
+	if ((cls >= STREAMPOOL_MAGAZINE_CLASSES) || !StreamPool_ReturnMagazine(pool, item, cls))
+	{
+		StreamPool_Lock(pool);
+		StreamPool_ReturnDepot(pool, item, cls);
+		StreamPool_Unlock(pool);
+	}
+
+	/* Only now the stream is no longer in use, StreamPool_WaitForReturn relies on that */
+	(void)InterlockedDecrement(&pool->used);
 }
 
 /**
@@ -311,11 +460,7 @@ void Stream_AddRef(wStream* s)
 {
 	WINPR_ASSERT(s);
 	if (s->pool)
-	{
-		StreamPool_Lock(s->pool);
-		s->count++;
-		StreamPool_Unlock(s->pool);
-	}
+		(void)InterlockedIncrement((LONG volatile*)&s->count);
 }
 
 /**
@@ -325,8 +470,21 @@ void Stream_AddRef(wStream* s)
 void Stream_Release(wStream* s)
 {
 	WINPR_ASSERT(s);
-	if (s->pool)
-		StreamPool_ReleaseOrReturn(s->pool, s);
+	if (!s->pool)
+		return;
+
+	LONG volatile* count = (LONG volatile*)&s->count;
+	LONG cur = *count;
+	while (cur > 0)
+	{
+		const LONG prev = InterlockedCompareExchange(count, cur - 1, cur);
+		if (prev == cur)
+			break;
+		cur = prev;
+	}
+
+	if (cur <= 1)
+		StreamPool_Return(s->pool, s);
 }
 
 /**
@@ -339,14 +497,15 @@ wStream* StreamPool_Find(wStreamPool* pool, const BYTE* ptr)
 
 	StreamPool_Lock(pool);
 
-	for (size_t index = 0; index < pool->uSize; index++)
+	for (wStreamPoolItem* cur = pool->streams; cur; cur = cur->next)
 	{
-		struct s_StreamPoolEntry* cur = &pool->uArray[index];
+		if (!cur->inUse)
+			continue;
 
-		if ((ptr >= Stream_Buffer(cur->s)) &&
-		    (ptr < (Stream_Buffer(cur->s) + Stream_Capacity(cur->s))))
+		if ((ptr >= Stream_Buffer(&cur->s)) &&
+		    (ptr < (Stream_Buffer(&cur->s) + Stream_Capacity(&cur->s))))
 		{
-			s = cur->s;
+			s = &cur->s;
 			break;
 		}
 	}
@@ -364,32 +523,54 @@ void StreamPool_Clear(wStreamPool* pool)
 {
 	StreamPool_Lock(pool);
 
-	for (size_t x = 0; x < pool->aSize; x++)
+	for (size_t x = 0; x < STREAMPOOL_MAGAZINES; x++)
 	{
-		struct s_StreamPoolEntry* cur = &pool->aArray[x];
-		discard_entry(cur, TRUE);
+		wStreamPoolMagazine* mag = &pool->magazines[x];
+
+		StreamPool_LockMagazine(pool, mag);
+		for (size_t cls = 0; cls < STREAMPOOL_MAGAZINE_CLASSES; cls++)
+		{
+			for (size_t y = 0; y < mag->count[cls]; y++)
+				StreamPool_Discard(pool, mag->items[cls][y]);
+			mag->count[cls] = 0;
+		}
+		mag->bytes = 0;
+		StreamPool_UnlockMagazine(pool, mag);
 	}
 
-	if (pool->uSize > 0)
+	for (size_t cls = 0; cls < STREAMPOOL_CLASSES; cls++)
 	{
-		WLog_WARN(TAG, "Clearing StreamPool, but there are %" PRIuz " streams currently in use",
-		          pool->uSize);
-		for (size_t x = 0; x < pool->uSize; x++)
+		wStreamPoolClass* c = &pool->classes[cls];
+		while (c->head)
 		{
-			struct s_StreamPoolEntry* cur = &pool->uArray[x];
-			discard_entry(cur, TRUE);
+			wStreamPoolItem* item = c->head;
+			c->head = item->free;
+			StreamPool_Discard(pool, item);
 		}
+		c->count = 0;
+		(void)InterlockedExchange(&c->used, 0);
+		(void)InterlockedExchange(&c->highWater, 0);
+	}
+	pool->bytes = 0;
+
+	/* Whatever is left is still in use */
+	if (pool->streams)
+	{
+		WLog_WARN(TAG, "Clearing StreamPool, but there are %" PRIuz " streams currently in use",
+		          StreamPool_UsedCount(pool));
+		while (pool->streams)
+			StreamPool_Discard(pool, pool->streams);
 	}
+	(void)InterlockedExchange(&pool->used, 0);
 
 	StreamPool_Unlock(pool);
 }
 
 size_t StreamPool_UsedCount(wStreamPool* pool)
 {
-	StreamPool_Lock(pool);
-	size_t usize = pool->uSize;
-	StreamPool_Unlock(pool);
-	return usize;
+	WINPR_ASSERT(pool);
+	const LONG used = InterlockedCompareExchange(&pool->used, 0, 0);
+	return (used > 0) ? (size_t)used : 0;
 }
 
 /**
@@ -407,21 +588,12 @@ wStreamPool* StreamPool_New(BOOL synchronized, size_t defaultSize)
 		pool->synchronized = synchronized;
 		pool->defaultSize = defaultSize;
 
-		if (!StreamPool_EnsureCapacity(pool, 32, FALSE))
-			goto fail;
-		if (!StreamPool_EnsureCapacity(pool, 32, TRUE))
-			goto fail;
-
 		InitializeCriticalSectionAndSpinCount(&pool->lock, 4000);
+		for (size_t x = 0; x < STREAMPOOL_MAGAZINES; x++)
+			InitializeCriticalSectionAndSpinCount(&pool->magazines[x].lock, 4000);
 	}
 
 	return pool;
-fail:
-	WINPR_PRAGMA_DIAG_PUSH
-	WINPR_PRAGMA_DIAG_IGNORED_MISMATCHED_DEALLOC
-	StreamPool_Free(pool);
-	WINPR_PRAGMA_DIAG_POP
-	return NULL;
 }
 
 void StreamPool_Free(wStreamPool* pool)
@@ -430,11 +602,10 @@ void StreamPool_Free(wStreamPool* pool)
 	{
 		StreamPool_Clear(pool);
 
+		for (size_t x = 0; x < STREAMPOOL_MAGAZINES; x++)
+			DeleteCriticalSection(&pool->magazines[x].lock);
 		DeleteCriticalSection(&pool->lock);
 
-		free(pool->aArray);
-		free(pool->uArray);
-
 		free(pool);
 	}
 }
@@ -446,23 +617,54 @@ char* StreamPool_GetStatistics(wStreamPool* pool, char* buffer, size_t size)
 	if (!buffer || (size < 1))
 		return NULL;
 
+	StreamPool_Lock(pool);
+
+	size_t cached = 0;
+	size_t bytes = pool->bytes;
+	UINT64 takes = pool->takes;
+	UINT64 hits = pool->hits;
+	UINT64 contention = pool->contention;
+
+	for (size_t cls = 0; cls < STREAMPOOL_CLASSES; cls++)
+		cached += pool->classes[cls].count;
+
+	for (size_t x = 0; x < STREAMPOOL_MAGAZINES; x++)
+	{
+		wStreamPoolMagazine* mag = &pool->magazines[x];
+
+		StreamPool_LockMagazine(pool, mag);
+		for (size_t cls = 0; cls < STREAMPOOL_MAGAZINE_CLASSES; cls++)
+			cached += mag->count[cls];
+		bytes += mag->bytes;
+		takes += mag->takes;
+		hits += mag->hits;
+		contention += mag->contention;
+		StreamPool_UnlockMagazine(pool, mag);
+	}
+
+	const unsigned rate = (takes > 0) ? (unsigned)(hits * 100ull / takes) : 0;
+
 	size_t used = 0;
 	int offset = _snprintf(buffer, size - 1,
-	                       "aSize    =%" PRIuz ", uSize    =%" PRIuz ", aCapacity=%" PRIuz
-	                       ", uCapacity=%" PRIuz,
-	                       pool->aSize, pool->uSize, pool->aCapacity, pool->uCapacity);
+	                       "used=%" PRIuz ", cached=%" PRIuz " (%" PRIuz " bytes), takes=%" PRIu64
+	                       ", hits=%" PRIu64 " (%u%%), allocations=%" PRIu64 ", trimmed=%" PRIu64
+	                       ", contention=%" PRIu64,
+	                       StreamPool_UsedCount(pool), cached, bytes, takes, hits, rate,
+	                       pool->allocs, pool->trimmed, contention);
 	if ((offset > 0) && ((size_t)offset < size))
 		used += (size_t)offset;
 
 #if defined(WITH_STREAMPOOL_DEBUG)
-	StreamPool_Lock(pool);
-
 	offset = _snprintf(&buffer[used], size - 1 - used, "\n-- dump used array take locations --\n");
 	if ((offset > 0) && ((size_t)offset < size - used))
 		used += (size_t)offset;
-	for (size_t x = 0; x < pool->uSize; x++)
+
+	size_t x = 0;
+	for (const wStreamPoolItem* cur = pool->streams; cur; cur = cur->next)
 	{
-		const struct s_StreamPoolEntry* cur = &pool->uArray[x];
+		if (!cur->inUse)
+			continue;
+
 		WINPR_ASSERT(cur->msg || (cur->lines == 0));
 
 		for (size_t y = 0; y < cur->lines; y++)
@@ -472,28 +674,30 @@ char* StreamPool_GetStatistics(wStreamPool* pool, char* buffer, size_t size)
 			if ((offset > 0) && ((size_t)offset < size - used))
 				used += (size_t)offset;
 		}
+		x++;
 	}
 
 	offset = _snprintf(&buffer[used], size - 1 - used, "\n-- statistics called from --\n");
 	if ((offset > 0) && ((size_t)offset < size - used))
 		used += (size_t)offset;
 
-	struct s_StreamPoolEntry entry = { 0 };
+	char** msg = NULL;
+	size_t lines = 0;
 	void* stack = winpr_backtrace(20);
 	if (stack)
-		entry.msg = winpr_backtrace_symbols(stack, &entry.lines);
+		msg = winpr_backtrace_symbols(stack, &lines);
 	winpr_backtrace_free(stack);
 
-	for (size_t x = 0; x < entry.lines; x++)
+	for (size_t y = 0; y < lines; y++)
 	{
-		const char* msg = entry.msg[x];
-		offset = _snprintf(&buffer[used], size - 1 - used, "[%" PRIuz "]: %s\n", x, msg);
+		offset = _snprintf(&buffer[used], size - 1 - used, "[%" PRIuz "]: %s\n", y, msg[y]);
 		if ((offset > 0) && ((size_t)offset < size - used))
 			used += (size_t)offset;
 	}
-	free((void*)entry.msg);
-	StreamPool_Unlock(pool);
+	free((void*)msg);
 #endif
+	StreamPool_Unlock(pool);
+
 	buffer[used] = '\0';
 	return buffer;
 }
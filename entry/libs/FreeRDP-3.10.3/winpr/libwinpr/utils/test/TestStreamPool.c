@@ -1,9 +1,142 @@
 
 #include <winpr/crt.h>
 #include <winpr/stream.h>
+#include <winpr/thread.h>
 #include <winpr/collections.h>
 
 #define BUFFER_SIZE 16384
+#define TEST_THREADS 4
+#define TEST_ROUNDS 20000
+
+static BOOL test_size_classes(void)
+{
+	BOOL rc = FALSE;
+	wStreamPool* pool = StreamPool_New(TRUE, BUFFER_SIZE);
+	if (!pool)
+		return FALSE;
+
+	/* A returned buffer serves any request of its size class */
+	wStream* s = StreamPool_Take(pool, 100);
+	if (!s || (Stream_Capacity(s) < 100))
+		goto fail;
+
+	BYTE* ptr = Stream_Pointer(s) + 50;
+	if (StreamPool_Find(pool, ptr) != s)
+		goto fail;
+
+	Stream_Release(s);
+	if ((StreamPool_Find(pool, ptr) != NULL) || (StreamPool_UsedCount(pool) != 0))
+		goto fail;
+
+	wStream* s2 = StreamPool_Take(pool, 120);
+	if (s2 != s)
+		goto fail;
+
+	/* Grown buffers are filed by their new size */
+	if (!Stream_EnsureCapacity(s2, 100000))
+		goto fail;
+	StreamPool_Return(pool, s2);
+
+	/* Returning twice must not cache the stream twice */
+	StreamPool_Return(pool, s2);
+
+	wStream* big = StreamPool_Take(pool, 70000);
+	wStream* other = StreamPool_Take(pool, 70000);
+	if (!big || !other || (big == other) || (Stream_Capacity(big) < 70000) ||
+	    (Stream_Capacity(other) < 70000))
+		goto fail;
+
+	Stream_Release(big);
+	Stream_Release(other);
+	if (StreamPool_UsedCount(pool) != 0)
+		goto fail;
+
+	/* Buffers above the largest class are released instead of cached, even while the largest
+	 * class has room below its high-water mark */
+	char stats[256] = { 0 };
+	StreamPool_Clear(pool);
+	wStream* huge = StreamPool_Take(pool, 20ull << 20);
+	if (!huge)
+		goto fail;
+	if (!Stream_EnsureCapacity(huge, 40ull << 20))
+	{
+		Stream_Release(huge);
+		goto fail;
+	}
+	Stream_Release(huge);
+
+	huge = StreamPool_Take(pool, (32ull << 20) + 1);
+	if (!huge)
+		goto fail;
+	Stream_Release(huge);
+	if (!strstr(StreamPool_GetStatistics(pool, stats, sizeof(stats)), "cached=0 "))
+	{
+		printf("%s\n", stats);
+		goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	StreamPool_Free(pool);
+	return rc;
+}
+
+static DWORD WINAPI test_thread(LPVOID arg)
+{
+	wStreamPool* pool = arg;
+	UINT32 seed = GetCurrentThreadId();
+
+	for (size_t x = 0; x < TEST_ROUNDS; x++)
+	{
+		seed = seed * 1103515245u + 12345u;
+		const size_t size = 1 + ((seed >> 8) % 65536);
+
+		wStream* s = StreamPool_Take(pool, size);
+		if (!s || (Stream_Capacity(s) < size))
+			return 1;
+
+		Stream_Write_UINT32(s, (UINT32)x);
+		Stream_AddRef(s);
+		Stream_Release(s);
+		Stream_Release(s);
+	}
+	return 0;
+}
+
+static BOOL test_threads(void)
+{
+	BOOL rc = TRUE;
+	HANDLE threads[TEST_THREADS] = { 0 };
+	char buffer[8192] = { 0 };
+	wStreamPool* pool = StreamPool_New(TRUE, BUFFER_SIZE);
+	if (!pool)
+		return FALSE;
+
+	for (size_t x = 0; x < ARRAYSIZE(threads); x++)
+	{
+		threads[x] = CreateThread(NULL, 0, test_thread, pool, 0, NULL);
+		if (!threads[x])
+			rc = FALSE;
+	}
+
+	for (size_t x = 0; x < ARRAYSIZE(threads); x++)
+	{
+		DWORD status = 1;
+		if (!threads[x])
+			continue;
+		(void)WaitForSingleObject(threads[x], INFINITE);
+		if (!GetExitCodeThread(threads[x], &status) || (status != 0))
+			rc = FALSE;
+		(void)CloseHandle(threads[x]);
+	}
+
+	printf("%s\n", StreamPool_GetStatistics(pool, buffer, sizeof(buffer)));
+	if (StreamPool_UsedCount(pool) != 0)
+		rc = FALSE;
+
+	StreamPool_Free(pool);
+	return rc;
+}
 
 int TestStreamPool(int argc, char* argv[])
 {
@@ -78,5 +211,11 @@ int TestStreamPool(int argc, char* argv[])
 
 	StreamPool_Free(pool);
 
+	if (!test_size_classes())
+		return -1;
+
+	if (!test_threads())
+		return -1;
+
 	return 0;
 }
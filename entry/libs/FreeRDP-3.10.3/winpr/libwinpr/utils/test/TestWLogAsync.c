@@ -0,0 +1,216 @@
+
+#include <stdio.h>
+
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/thread.h>
+#include <winpr/sysinfo.h>
+#include <winpr/interlocked.h>
+#include <winpr/wlog.h>
+
+#define TEST_THREADS 4
+#define TEST_MESSAGES 2000
+
+static const char* channel = "com.test.async";
+
+static LONG volatile received = 0;
+static LONG volatile dropped = 0;
+static LONG volatile failures = 0;
+static LONG next[TEST_THREADS] = { 0 };
+
+static BOOL CallbackAppenderMessage(const wLogMessage* msg)
+{
+	unsigned thread = 0;
+	unsigned count = 0;
+
+	/* A full queue drops messages and reports how many before the next one */
+	if (msg && msg->TextString && (sscanf(msg->TextString, "%u messages dropped", &count) == 1))
+	{
+		(void)InterlockedExchangeAdd(&dropped, (LONG)count);
+		return TRUE;
+	}
+
+	if (!msg || !msg->TextString ||
+	    (sscanf(msg->TextString, "thread %u message %u", &thread, &count) != 2) ||
+	    (thread >= TEST_THREADS))
+	{
+		(void)InterlockedIncrement(&failures);
+		return TRUE;
+	}
+
+	/* Messages of a single thread must arrive in the order they were logged */
+	if (next[thread] > (LONG)count)
+		(void)InterlockedIncrement(&failures);
+	next[thread] = (LONG)count + 1;
+
+	(void)InterlockedIncrement(&received);
+	return TRUE;
+}
+
+static BOOL CallbackAppenderOther(const wLogMessage* msg)
+{
+	WINPR_UNUSED(msg);
+	return TRUE;
+}
+
+static DWORD WINAPI test_thread(LPVOID arg)
+{
+	const unsigned thread = (unsigned)(size_t)arg;
+	wLog* log = WLog_Get(channel);
+
+	for (unsigned x = 0; x < TEST_MESSAGES; x++)
+		WLog_Print(log, WLOG_INFO, "thread %u message %u", thread, x);
+
+	/* After a flush there is room again, the last message carries any pending drop count */
+	(void)WLog_Flush();
+	WLog_Print(log, WLOG_INFO, "thread %u message %u", thread, TEST_MESSAGES);
+	return 0;
+}
+
+static UINT64 test_print_ns(wLog* log, DWORD level, size_t count)
+{
+	const UINT64 start = winpr_GetTickCount64NS();
+
+	for (size_t x = 0; x < count; x++)
+		WLog_Print(log, level, "benchmark %" PRIuz, x);
+
+	return winpr_GetTickCount64NS() - start;
+}
+
+static BOOL test_level_floor(wLog* root, wLog* log)
+{
+	if (!WLog_SetLogLevel(root, WLOG_WARN) || !WLog_SetLogLevel(log, WLOG_LEVEL_INHERIT))
+		return FALSE;
+
+	if (WLog_GetLevelFloor() != WLOG_WARN)
+	{
+		(void)fprintf(stderr, "level floor %" PRId32 ", expected %d\n", WLog_GetLevelFloor(),
+		              WLOG_WARN);
+		return FALSE;
+	}
+
+	if (WLog_IsLevelAboveFloor(WLOG_DEBUG) || !WLog_IsLevelAboveFloor(WLOG_ERROR))
+		return FALSE;
+
+	/* Any logger lowering its level lowers the floor */
+	if (!WLog_SetLogLevel(log, WLOG_DEBUG) || (WLog_GetLevelFloor() != WLOG_DEBUG))
+		return FALSE;
+
+	if (!WLog_SetLogLevel(log, WLOG_LEVEL_INHERIT) || (WLog_GetLevelFloor() != WLOG_WARN))
+		return FALSE;
+
+	const size_t count = 1000000;
+	const UINT64 disabled = test_print_ns(log, WLOG_TRACE, count);
+	const UINT64 start = winpr_GetTickCount64NS();
+	size_t active = 0;
+	for (size_t x = 0; x < count; x++)
+	{
+		if (WLog_IsLevelActive(log, WLOG_TRACE))
+			active++;
+	}
+	const UINT64 checked = winpr_GetTickCount64NS() - start;
+
+	(void)fprintf(stdout, "disabled level: %" PRIu64 "ns with floor, %" PRIu64 "ns with lookup\n",
+	              disabled / count, checked / count);
+	return active == 0;
+}
+
+static BOOL test_async(wLog* root, wLog* log, wLogAppender* appender)
+{
+	HANDLE threads[TEST_THREADS] = { 0 };
+	BOOL rc = FALSE;
+
+	if (!WLog_SetLogLevel(log, WLOG_INFO))
+		return FALSE;
+
+	if (!WLog_ConfigureAppender(appender, "async", (void*)TRUE))
+		return FALSE;
+
+	for (size_t x = 0; x < TEST_THREADS; x++)
+	{
+		threads[x] = CreateThread(NULL, 0, test_thread, (void*)x, 0, NULL);
+		if (!threads[x])
+			goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	for (size_t x = 0; x < TEST_THREADS; x++)
+	{
+		if (!threads[x])
+			continue;
+		(void)WaitForSingleObject(threads[x], INFINITE);
+		(void)CloseHandle(threads[x]);
+	}
+
+	if (!WLog_Flush())
+		rc = FALSE;
+
+	if ((received + dropped != TEST_THREADS * (TEST_MESSAGES + 1)) || (failures != 0))
+	{
+		(void)fprintf(stderr,
+		              "received %" PRId32 " and dropped %" PRId32 " of %d messages, %" PRId32
+		              " failures\n",
+		              received, dropped, TEST_THREADS * (TEST_MESSAGES + 1), failures);
+		rc = FALSE;
+	}
+
+	for (size_t x = 0; x < TEST_THREADS; x++)
+	{
+		if (next[x] != TEST_MESSAGES + 1)
+		{
+			(void)fprintf(stderr, "thread %" PRIuz " last message missing\n", x);
+			rc = FALSE;
+		}
+	}
+
+	(void)fprintf(stdout, "%" PRId32 " messages dropped\n", dropped);
+
+	const size_t count = 10000;
+	const UINT64 async = test_print_ns(log, WLOG_ERROR, count);
+	if (!WLog_Flush() || !WLog_ConfigureAppender(appender, "async", NULL))
+		rc = FALSE;
+	const UINT64 sync = test_print_ns(log, WLOG_ERROR, count);
+
+	(void)fprintf(stdout, "per message: %" PRIu64 "ns async, %" PRIu64 "ns sync\n",
+	              async / count, sync / count);
+	return rc;
+}
+
+int TestWLogAsync(int argc, char* argv[])
+{
+	wLogCallbacks callbacks = { 0 };
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	wLog* root = WLog_GetRoot();
+	if (!WLog_SetLogAppenderType(root, WLOG_APPENDER_CALLBACK))
+		return -1;
+
+	wLogAppender* appender = WLog_GetLogAppender(root);
+
+	callbacks.data = CallbackAppenderOther;
+	callbacks.image = CallbackAppenderOther;
+	callbacks.message = CallbackAppenderMessage;
+	callbacks.package = CallbackAppenderOther;
+
+	if (!WLog_ConfigureAppender(appender, "callbacks", (void*)&callbacks))
+		return -1;
+
+	if (!WLog_OpenAppender(root))
+		return -1;
+
+	wLog* log = WLog_Get(channel);
+	if (!log)
+		return -1;
+
+	if (!test_level_floor(root, log))
+		return -1;
+
+	if (!test_async(root, log, appender))
+		return -1;
+
+	WLog_CloseAppender(root);
+	return 0;
+}
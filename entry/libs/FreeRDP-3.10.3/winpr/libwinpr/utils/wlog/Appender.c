@@ -20,12 +20,17 @@
 #include <winpr/config.h>
 
 #include "Appender.h"
+#include "AsyncWriter.h"
 
 void WLog_Appender_Free(wLog* log, wLogAppender* appender)
 {
 	if (!appender)
 		return;
 
+	/* Queued messages still reference the appender */
+	if (appender->async)
+		(void)WLog_AsyncWriter_Flush();
+
 	if (appender->Layout)
 	{
 		WLog_Layout_Free(log, appender->Layout);
@@ -145,6 +150,7 @@ static wLogAppender* WLog_Appender_New(wLog* log, DWORD logAppenderType)
 	}
 
 	InitializeCriticalSectionAndSpinCount(&appender->lock, 4000);
+	appender->async = WLog_AsyncWriter_DefaultEnabled();
 
 	return appender;
 }
@@ -170,6 +176,17 @@ BOOL WLog_ConfigureAppender(wLogAppender* appender, const char* setting, void* v
 	if (!appender || !setting || (strnlen(setting, 2) == 0))
 		return FALSE;
 
+	/* Common to all appenders: write text messages from a background thread */
+	if (strcmp(setting, "async") == 0)
+	{
+		const BOOL async = value ? TRUE : FALSE;
+
+		if (appender->async && !async)
+			(void)WLog_AsyncWriter_Flush();
+		appender->async = async;
+		return TRUE;
+	}
+
 	if (appender->Set)
 		return appender->Set(appender, setting, value);
 	else
@@ -0,0 +1,520 @@
+/**
+ * WinPR: Windows Portable Runtime
+ * WinPR Logger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/config.h>
+
+#include <string.h>
+#include <time.h>
+
+#include <winpr/crt.h>
+#include <winpr/assert.h>
+#include <winpr/synch.h>
+#include <winpr/thread.h>
+#include <winpr/sysinfo.h>
+#include <winpr/interlocked.h>
+#include <winpr/environment.h>
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+
+#include "wlog.h"
+#include "AsyncWriter.h"
+
+/**
+ * Asynchronous text message writer
+ *
+ * Every logging thread owns a single producer / single consumer ring of
+ * pre-formatted records. Producers never take a lock: they copy the
+ * formatted text into their ring and publish it with an interlocked store.
+ * A single writer thread drains all rings and hands the records to the
+ * appender, so the I/O and the appender lock stay off the calling thread.
+ *
+ * If a ring is full the message is dropped and counted, a logging thread
+ * never blocks on the writer. The writer reports the count right before the
+ * next message of that thread. Only if the writer is not running the message
+ * is written synchronously.
+ */
+
+#define WLOG_ASYNC_RING_SIZE (64 * 1024) /* must be a power of two */
+#define WLOG_ASYNC_RING_MASK (WLOG_ASYNC_RING_SIZE - 1)
+#define WLOG_ASYNC_ALIGN(x) (((x) + 7u) & ~7u)
+#define WLOG_ASYNC_IDLE_TIMEOUT 100
+#define WLOG_ASYNC_DROPPED_FORMAT "%" PRIu32 " messages dropped, the log queue was full"
+
+typedef struct
+{
+	UINT32 Size; /* of the whole record, aligned */
+	UINT32 TextLength;
+	wLog* Log; /* NULL for padding records */
+	wLogAppender* Appender;
+	DWORD Level;
+	size_t LineNumber;
+	LPCSTR FileName;
+	LPCSTR FunctionName;
+	LPCSTR FormatString;
+	UINT64 TimeNS;
+	UINT32 Dropped; /* messages of the thread dropped before this one */
+} wLogAsyncRecord;
+
+typedef struct s_wLogAsyncRing
+{
+	/* Free running byte counters, only the producer writes Head */
+	LONG volatile Head;
+	LONG volatile Tail;
+	LONG volatile Orphaned;
+	UINT32 CachedTail;
+	UINT32 Dropped; /* since the last queued record, producer only */
+	size_t ThreadId;
+	struct s_wLogAsyncRing* Next;
+	BYTE Data[WLOG_ASYNC_RING_SIZE];
+} wLogAsyncRing;
+
+static INIT_ONCE g_AsyncInitialized = INIT_ONCE_STATIC_INIT;
+static CRITICAL_SECTION g_AsyncLock;
+static wLogAsyncRing* g_AsyncRings = NULL;
+static HANDLE g_AsyncEvent = NULL;
+static HANDLE g_AsyncThread = NULL;
+static DWORD g_AsyncThreadId = 0;
+static LONG volatile g_AsyncRunning = 0;
+static LONG volatile g_AsyncSleeping = 0;
+
+static WINPR_TLS wLogAsyncRing* g_ThreadRing = NULL;
+static WINPR_TLS const wLogMessageOrigin* g_ThreadOrigin = NULL;
+static WINPR_TLS BOOL g_ThreadInitializing = FALSE;
+
+#if defined(_WIN32)
+static DWORD g_RingKey = FLS_OUT_OF_INDEXES;
+#else
+static pthread_key_t g_RingKey;
+#endif
+
+static UINT32 ring_load(LONG volatile* value)
+{
+	return (UINT32)InterlockedCompareExchange(value, 0, 0);
+}
+
+static void ring_store(LONG volatile* value, UINT32 v)
+{
+	(void)InterlockedExchange(value, (LONG)v);
+}
+
+/* Runs on thread exit, the writer frees the ring once it is drained */
+static VOID WINAPI WLog_AsyncRing_Orphan(PVOID arg)
+{
+	wLogAsyncRing* ring = arg;
+
+	/* Messages logged later in the thread teardown get a fresh ring */
+	g_ThreadRing = NULL;
+
+	if (ring)
+		(void)InterlockedExchange(&ring->Orphaned, 1);
+}
+
+static void WLog_AsyncLocalTime(UINT64 ns, SYSTEMTIME* st)
+{
+	WINPR_ASSERT(st);
+	ZeroMemory(st, sizeof(SYSTEMTIME));
+
+#if defined(_WIN32)
+	ULARGE_INTEGER uli = { 0 };
+	FILETIME ft = { 0 };
+	FILETIME lft = { 0 };
+
+	uli.QuadPart = ns / 100ull + 116444736000000000ull;
+	ft.dwLowDateTime = uli.LowPart;
+	ft.dwHighDateTime = uli.HighPart;
+	if (FileTimeToLocalFileTime(&ft, &lft))
+		(void)FileTimeToSystemTime(&lft, st);
+#else
+	struct tm tres = { 0 };
+	const time_t ct = (time_t)(ns / 1000000000ull);
+
+	if (localtime_r(&ct, &tres))
+	{
+		st->wYear = (WORD)(tres.tm_year + 1900);
+		st->wMonth = (WORD)(tres.tm_mon + 1);
+		st->wDayOfWeek = (WORD)tres.tm_wday;
+		st->wDay = (WORD)tres.tm_mday;
+		st->wHour = (WORD)tres.tm_hour;
+		st->wMinute = (WORD)tres.tm_min;
+		st->wSecond = (WORD)tres.tm_sec;
+		st->wMilliseconds = (WORD)((ns / 1000000ull) % 1000ull);
+	}
+#endif
+}
+
+/**
+ * Write all records queued in @ring.
+ *
+ * @return TRUE if anything was written
+ */
+static BOOL WLog_AsyncRing_Drain(wLogAsyncRing* ring)
+{
+	BOOL written = FALSE;
+	const UINT32 head = ring_load(&ring->Head);
+	UINT32 tail = ring_load(&ring->Tail);
+
+	while (tail != head)
+	{
+		const UINT32 pos = tail & WLOG_ASYNC_RING_MASK;
+
+		/* Not even a header fits before the end, the producer skipped it */
+		if (WLOG_ASYNC_RING_SIZE - pos < sizeof(wLogAsyncRecord))
+		{
+			tail += WLOG_ASYNC_RING_SIZE - pos;
+			continue;
+		}
+
+		const wLogAsyncRecord* record = (const wLogAsyncRecord*)&ring->Data[pos];
+
+		if (record->Log)
+		{
+			wLogMessageOrigin origin = { 0 };
+			wLogMessage message = { 0 };
+
+			origin.ThreadId = ring->ThreadId;
+			WLog_AsyncLocalTime(record->TimeNS, &origin.LocalTime);
+
+			message.Type = WLOG_MESSAGE_TEXT;
+			message.Level = record->Level;
+			message.LineNumber = record->LineNumber;
+			message.FileName = record->FileName;
+			message.FunctionName = record->FunctionName;
+			message.FormatString = record->FormatString;
+			g_ThreadOrigin = &origin;
+			if (record->Dropped > 0)
+			{
+				char text[64] = { 0 };
+				wLogMessage notice = message;
+
+				notice.Level = WLOG_WARN;
+				notice.LineNumber = __LINE__;
+				notice.FileName = __FILE__;
+				notice.FunctionName = __func__;
+				notice.FormatString = WLOG_ASYNC_DROPPED_FORMAT;
+				(void)_snprintf(text, sizeof(text), WLOG_ASYNC_DROPPED_FORMAT, record->Dropped);
+				notice.TextString = text;
+				(void)WLog_WriteMessageLocked(record->Log, record->Appender, &notice);
+			}
+
+			message.TextString = (LPCSTR)&record[1];
+			(void)WLog_WriteMessageLocked(record->Log, record->Appender, &message);
+			g_ThreadOrigin = NULL;
+			written = TRUE;
+		}
+
+		tail += record->Size;
+
+		/* Release the space as we go so producers do not fall back to sync writes */
+		ring_store(&ring->Tail, tail);
+	}
+
+	ring_store(&ring->Tail, tail);
+	return written;
+}
+
+static BOOL WLog_AsyncWriter_DrainAll(void)
+{
+	BOOL written = FALSE;
+	wLogAsyncRing* prev = NULL;
+
+	EnterCriticalSection(&g_AsyncLock);
+	wLogAsyncRing* ring = g_AsyncRings;
+
+	while (ring)
+	{
+		wLogAsyncRing* next = ring->Next;
+		const BOOL orphaned = ring_load(&ring->Orphaned) != 0;
+
+		if (WLog_AsyncRing_Drain(ring))
+			written = TRUE;
+
+		/* The owner is gone, no more records can show up */
+		if (orphaned)
+		{
+			if (prev)
+				prev->Next = next;
+			else
+				g_AsyncRings = next;
+			winpr_aligned_free(ring);
+		}
+		else
+			prev = ring;
+
+		ring = next;
+	}
+
+	LeaveCriticalSection(&g_AsyncLock);
+	return written;
+}
+
+static DWORD WINAPI WLog_AsyncWriter_Thread(LPVOID arg)
+{
+	WINPR_UNUSED(arg);
+
+	while (ring_load(&g_AsyncRunning))
+	{
+		if (WLog_AsyncWriter_DrainAll())
+			continue;
+
+		/* Producers only signal the event while we announce that we sleep */
+		(void)ResetEvent(g_AsyncEvent);
+		ring_store(&g_AsyncSleeping, 1);
+		if (!WLog_AsyncWriter_DrainAll())
+			(void)WaitForSingleObject(g_AsyncEvent, WLOG_ASYNC_IDLE_TIMEOUT);
+		ring_store(&g_AsyncSleeping, 0);
+	}
+
+	(void)WLog_AsyncWriter_DrainAll();
+	return 0;
+}
+
+static BOOL WLog_AsyncWriter_Init_int(void)
+{
+	if (!InitializeCriticalSectionAndSpinCount(&g_AsyncLock, 4000))
+		return FALSE;
+
+#if defined(_WIN32)
+	g_RingKey = FlsAlloc(WLog_AsyncRing_Orphan);
+	if (g_RingKey == FLS_OUT_OF_INDEXES)
+		return FALSE;
+#else
+	if (pthread_key_create(&g_RingKey, WLog_AsyncRing_Orphan) != 0)
+		return FALSE;
+#endif
+
+	g_AsyncEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+	if (!g_AsyncEvent)
+		return FALSE;
+
+	ring_store(&g_AsyncRunning, 1);
+	g_AsyncThread = CreateThread(NULL, 0, WLog_AsyncWriter_Thread, NULL, 0, &g_AsyncThreadId);
+	if (!g_AsyncThread)
+	{
+		ring_store(&g_AsyncRunning, 0);
+		(void)CloseHandle(g_AsyncEvent);
+		g_AsyncEvent = NULL;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static BOOL CALLBACK WLog_AsyncWriter_Init(PINIT_ONCE InitOnce, PVOID Parameter, PVOID* Context)
+{
+	WINPR_UNUSED(InitOnce);
+	WINPR_UNUSED(Parameter);
+	WINPR_UNUSED(Context);
+
+	/* Anything logged while we set up is written synchronously, see WLog_AsyncWriter_Enqueue */
+	g_ThreadInitializing = TRUE;
+	const BOOL rc = WLog_AsyncWriter_Init_int();
+	g_ThreadInitializing = FALSE;
+	return rc;
+}
+
+static wLogAsyncRing* WLog_AsyncRing_Get(void)
+{
+	wLogAsyncRing* ring = g_ThreadRing;
+
+	if (ring)
+		return ring;
+
+	ring = winpr_aligned_calloc(1, sizeof(wLogAsyncRing), 64);
+	if (!ring)
+		return NULL;
+
+	ring->ThreadId = WLog_Layout_GetThreadId();
+
+#if defined(_WIN32)
+	if (!FlsSetValue(g_RingKey, ring))
+#else
+	if (pthread_setspecific(g_RingKey, ring) != 0)
+#endif
+	{
+		winpr_aligned_free(ring);
+		return NULL;
+	}
+
+	EnterCriticalSection(&g_AsyncLock);
+	ring->Next = g_AsyncRings;
+	g_AsyncRings = ring;
+	LeaveCriticalSection(&g_AsyncLock);
+
+	g_ThreadRing = ring;
+	return ring;
+}
+
+/** @return TRUE if WLOG_ASYNC asks for new appenders to write asynchronously */
+BOOL WLog_AsyncWriter_DefaultEnabled(void)
+{
+	LPCSTR name = "WLOG_ASYNC";
+	char env[16] = { 0 };
+	const DWORD nSize = GetEnvironmentVariableA(name, env, ARRAYSIZE(env));
+
+	if ((nSize == 0) || (nSize >= ARRAYSIZE(env)))
+		return FALSE;
+
+	return (strcmp(env, "0") != 0) && (_stricmp(env, "FALSE") != 0) && (_stricmp(env, "OFF") != 0);
+}
+
+BOOL WLog_AsyncWriter_Enqueue(wLog* log, wLogAppender* appender, const wLogMessage* message)
+{
+	WINPR_ASSERT(log);
+	WINPR_ASSERT(appender);
+	WINPR_ASSERT(message);
+
+	if (g_ThreadInitializing)
+		return FALSE;
+
+	if (!InitOnceExecuteOnce(&g_AsyncInitialized, WLog_AsyncWriter_Init, NULL, NULL))
+		return FALSE;
+
+	/* Messages logged by the appender itself must not wait for themselves */
+	if (!ring_load(&g_AsyncRunning) || (GetCurrentThreadId() == g_AsyncThreadId))
+		return FALSE;
+
+	wLogAsyncRing* ring = WLog_AsyncRing_Get();
+	if (!ring)
+		return FALSE;
+
+	const size_t length = message->TextString ? strnlen(message->TextString, WLOG_MAX_STRING_SIZE)
+	                                          : 0;
+	const UINT32 size = WLOG_ASYNC_ALIGN((UINT32)(sizeof(wLogAsyncRecord) + length + 1));
+	UINT32 head = (UINT32)ring->Head;
+	UINT32 pos = head & WLOG_ASYNC_RING_MASK;
+	UINT32 skip = 0;
+
+	if (WLOG_ASYNC_RING_SIZE - pos < size)
+		skip = WLOG_ASYNC_RING_SIZE - pos;
+
+	if (WLOG_ASYNC_RING_SIZE - (head - ring->CachedTail) < size + skip)
+		ring->CachedTail = ring_load(&ring->Tail);
+
+	if (WLOG_ASYNC_RING_SIZE - (head - ring->CachedTail) < size + skip)
+	{
+		/* The writer went away, write what is queued and then this message ourselves */
+		if (!ring_load(&g_AsyncRunning))
+		{
+			EnterCriticalSection(&g_AsyncLock);
+			(void)WLog_AsyncRing_Drain(ring);
+			LeaveCriticalSection(&g_AsyncLock);
+			return FALSE;
+		}
+
+		ring->Dropped++;
+		(void)SetEvent(g_AsyncEvent);
+		return TRUE;
+	}
+
+	if (skip > 0)
+	{
+		/* Wrap around, mark the rest of the buffer as padding if a header fits */
+		if (skip >= sizeof(wLogAsyncRecord))
+		{
+			wLogAsyncRecord* pad = (wLogAsyncRecord*)&ring->Data[pos];
+			pad->Size = skip;
+			pad->Log = NULL;
+		}
+		head += skip;
+		pos = 0;
+	}
+
+	wLogAsyncRecord* record = (wLogAsyncRecord*)&ring->Data[pos];
+	record->Size = size;
+	record->TextLength = (UINT32)length;
+	record->Log = log;
+	record->Appender = appender;
+	record->Level = message->Level;
+	record->LineNumber = message->LineNumber;
+	record->FileName = message->FileName;
+	record->FunctionName = message->FunctionName;
+	record->FormatString = message->FormatString;
+	record->TimeNS = winpr_GetUnixTimeNS();
+	record->Dropped = ring->Dropped;
+	ring->Dropped = 0;
+
+	char* text = (char*)&record[1];
+	if (length > 0)
+		memcpy(text, message->TextString, length);
+	text[length] = '\0';
+
+	ring_store(&ring->Head, head + size);
+
+	if (InterlockedCompareExchange(&g_AsyncSleeping, 0, 1) == 1)
+		(void)SetEvent(g_AsyncEvent);
+
+	return TRUE;
+}
+
+BOOL WLog_AsyncWriter_Flush(void)
+{
+	if (!ring_load(&g_AsyncRunning) || (GetCurrentThreadId() == g_AsyncThreadId))
+		return TRUE;
+
+	for (;;)
+	{
+		BOOL pending = FALSE;
+
+		EnterCriticalSection(&g_AsyncLock);
+		for (wLogAsyncRing* ring = g_AsyncRings; ring; ring = ring->Next)
+		{
+			if (ring_load(&ring->Head) != ring_load(&ring->Tail))
+			{
+				pending = TRUE;
+				break;
+			}
+		}
+		LeaveCriticalSection(&g_AsyncLock);
+
+		if (!pending)
+			return TRUE;
+
+		(void)SetEvent(g_AsyncEvent);
+		Sleep(1);
+	}
+}
+
+void WLog_AsyncWriter_Stop(void)
+{
+	if (!ring_load(&g_AsyncRunning))
+		return;
+
+	ring_store(&g_AsyncRunning, 0);
+	(void)SetEvent(g_AsyncEvent);
+
+	if (g_AsyncThread)
+	{
+		(void)WaitForSingleObject(g_AsyncThread, INFINITE);
+		(void)CloseHandle(g_AsyncThread);
+		g_AsyncThread = NULL;
+	}
+
+	/* Pick up what was queued while the writer was shutting down */
+	(void)WLog_AsyncWriter_DrainAll();
+
+	/*
+	 * Rings of live threads stay registered and the event stays valid for
+	 * producers racing with the shutdown, they fall back to sync writes.
+	 */
+}
+
+const wLogMessageOrigin* WLog_AsyncWriter_GetOrigin(void)
+{
+	return g_ThreadOrigin;
+}
@@ -0,0 +1,40 @@
+/**
+ * WinPR: Windows Portable Runtime
+ * WinPR Logger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef WINPR_WLOG_ASYNC_WRITER_PRIVATE_H
+#define WINPR_WLOG_ASYNC_WRITER_PRIVATE_H
+
+#include "wlog.h"
+
+/**
+ * Where and when a deferred message was logged. Set for the duration of
+ * the appender call when the writer thread replays a queued message, so
+ * the layout prints the time and thread of the original caller.
+ */
+typedef struct
+{
+	SYSTEMTIME LocalTime;
+	size_t ThreadId;
+} wLogMessageOrigin;
+
+BOOL WLog_AsyncWriter_DefaultEnabled(void);
+BOOL WLog_AsyncWriter_Enqueue(wLog* log, wLogAppender* appender, const wLogMessage* message);
+BOOL WLog_AsyncWriter_Flush(void);
+void WLog_AsyncWriter_Stop(void);
+const wLogMessageOrigin* WLog_AsyncWriter_GetOrigin(void);
+
+#endif /* WINPR_WLOG_ASYNC_WRITER_PRIVATE_H */
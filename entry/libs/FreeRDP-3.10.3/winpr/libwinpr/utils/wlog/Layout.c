@@ -32,6 +32,7 @@
 #include "wlog.h"
 
 #include "Layout.h"
+#include "AsyncWriter.h"
 
 #if defined __linux__ && !defined ANDROID
 #include <unistd.h>
@@ -93,18 +94,23 @@ static void WLog_PrintMessagePrefix(wLog* log, wLogMessage* message,
 	va_end(args);
 }
 
-static const char* get_tid(void* arg)
+size_t WLog_Layout_GetThreadId(void)
 {
-	struct format_tid_arg* targ = arg;
-	WINPR_ASSERT(targ);
-
-	size_t tid = 0;
 #if defined __linux__ && !defined ANDROID
 	/* On Linux we prefer to see the LWP id */
-	tid = (size_t)syscall(SYS_gettid);
+	return (size_t)syscall(SYS_gettid);
 #else
-	tid = (size_t)GetCurrentThreadId();
+	return (size_t)GetCurrentThreadId();
 #endif
+}
+
+static const char* get_tid(void* arg)
+{
+	struct format_tid_arg* targ = arg;
+	WINPR_ASSERT(targ);
+
+	const wLogMessageOrigin* origin = WLog_AsyncWriter_GetOrigin();
+	const size_t tid = origin ? origin->ThreadId : WLog_Layout_GetThreadId();
 	(void)_snprintf(targ->tid, sizeof(targ->tid), "%08" PRIxz, tid);
 	return targ->tid;
 }
@@ -240,7 +246,13 @@ BOOL WLog_Layout_GetMessagePrefix(wLog* log, wLogLayout* layout, wLogMessage* me
 	struct format_tid_arg targ = { 0 };
 
 	SYSTEMTIME localTime = { 0 };
-	GetLocalTime(&localTime);
+	const wLogMessageOrigin* origin = WLog_AsyncWriter_GetOrigin();
+
+	/* Deferred messages carry the time they were logged at */
+	if (origin)
+		localTime = origin->LocalTime;
+	else
+		GetLocalTime(&localTime);
 
 	struct format_option_recurse recurse = {
 		.options = NULL, .nroptions = 0, .log = log, .layout = layout, .message = message
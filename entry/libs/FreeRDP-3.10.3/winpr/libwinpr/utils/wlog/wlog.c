@@ -29,6 +29,7 @@
 #include <winpr/print.h>
 #include <winpr/debug.h>
 #include <winpr/environment.h>
+#include <winpr/interlocked.h>
 #include <winpr/wlog.h>
 
 #if defined(ANDROID)
@@ -37,6 +38,7 @@
 #endif
 
 #include "wlog.h"
+#include "AsyncWriter.h"
 
 typedef struct
 {
@@ -64,6 +66,10 @@ static DWORD g_FilterCount = 0;
 static wLogFilter* g_Filters = NULL;
 static wLog* g_RootLog = NULL;
 
+/* Lowest level any logger or filter lets through, checked first by the WLog_Print macros.
+ * Starts permissive so the first call initializes the root logger. */
+static LONG volatile g_LevelFloor = WLOG_TRACE;
+
 static wLog* WLog_New(LPCSTR name, wLog* rootLogger);
 static void WLog_Free(wLog* log);
 static LONG WLog_GetFilterLogLevel(wLog* log);
@@ -84,6 +90,8 @@ static void WLog_Uninit_(void)
 	if (!root)
 		return;
 
+	WLog_AsyncWriter_Stop();
+
 	for (DWORD index = 0; index < root->ChildrenCount; index++)
 	{
 		child = root->Children[index];
@@ -106,6 +114,52 @@ static void WLog_Unlock(wLog* log)
 	LeaveCriticalSection(&log->lock);
 }
 
+static DWORD WLog_GetLowestLevel(wLog* log, DWORD lowest)
+{
+	if (!log)
+		return lowest;
+
+	if ((log->Level != WLOG_LEVEL_INHERIT) && (log->Level < lowest))
+		lowest = log->Level;
+
+	if ((log->FilterLevel > WLOG_FILTER_NOT_FILTERED) && ((DWORD)log->FilterLevel < lowest))
+		lowest = (DWORD)log->FilterLevel;
+
+	WLog_Lock(log);
+	for (DWORD x = 0; x < log->ChildrenCount; x++)
+		lowest = WLog_GetLowestLevel(log->Children[x], lowest);
+	WLog_Unlock(log);
+
+	return lowest;
+}
+
+/**
+ * Recalculate the level floor after a level or filter changed.
+ *
+ * @param changed a logger that might not be part of the tree yet
+ */
+static void WLog_UpdateLevelFloor(wLog* changed)
+{
+	DWORD lowest = WLOG_OFF;
+
+	for (DWORD x = 0; x < g_FilterCount; x++)
+	{
+		if (g_Filters[x].Level < lowest)
+			lowest = g_Filters[x].Level;
+	}
+
+	if (changed && (changed->Level != WLOG_LEVEL_INHERIT) && (changed->Level < lowest))
+		lowest = changed->Level;
+
+	lowest = WLog_GetLowestLevel(g_RootLog, lowest);
+	(void)InterlockedExchange(&g_LevelFloor, (LONG)lowest);
+}
+
+LONG WLog_GetLevelFloor(void)
+{
+	return InterlockedCompareExchange(&g_LevelFloor, 0, 0);
+}
+
 static BOOL CALLBACK WLog_InitializeRoot(PINIT_ONCE InitOnce, PVOID Parameter, PVOID* Context)
 {
 	char* env = NULL;
@@ -167,6 +221,8 @@ static BOOL CALLBACK WLog_InitializeRoot(PINIT_ONCE InitOnce, PVOID Parameter, P
 	if (!WLog_ParseFilters(g_RootLog))
 		goto fail;
 
+	WLog_UpdateLevelFloor(NULL);
+
 	(void)atexit(WLog_Uninit_);
 
 	return TRUE;
@@ -225,18 +281,12 @@ out:
 	return status;
 }
 
-static BOOL WLog_Write(wLog* log, wLogMessage* message)
+BOOL WLog_WriteMessageLocked(wLog* log, wLogAppender* appender, wLogMessage* message)
 {
 	BOOL status = FALSE;
-	wLogAppender* appender = NULL;
-	appender = WLog_GetLogAppender(log);
-
-	if (!appender)
-		return FALSE;
 
-	if (!appender->active)
-		if (!WLog_OpenAppender(log))
-			return FALSE;
+	WINPR_ASSERT(appender);
+	WINPR_ASSERT(message);
 
 	EnterCriticalSection(&appender->lock);
 
@@ -256,6 +306,24 @@ static BOOL WLog_Write(wLog* log, wLogMessage* message)
 	return status;
 }
 
+static BOOL WLog_Write(wLog* log, wLogMessage* message)
+{
+	wLogAppender* appender = NULL;
+	appender = WLog_GetLogAppender(log);
+
+	if (!appender)
+		return FALSE;
+
+	if (!appender->active)
+		if (!WLog_OpenAppender(log))
+			return FALSE;
+
+	if (appender->async && WLog_AsyncWriter_Enqueue(log, appender, message))
+		return TRUE;
+
+	return WLog_WriteMessageLocked(log, appender, message);
+}
+
 static BOOL WLog_WriteData(wLog* log, wLogMessage* message)
 {
 	BOOL status = 0;
@@ -550,7 +618,11 @@ static BOOL WLog_AddStringLogFilters_int(wLog* root, LPCSTR filter)
 
 	g_FilterCount = size;
 	free(cp);
-	return WLog_reset_log_filters(root);
+	if (!WLog_reset_log_filters(root))
+		return FALSE;
+
+	WLog_UpdateLevelFloor(NULL);
+	return TRUE;
 }
 
 BOOL WLog_AddStringLogFilters(LPCSTR filter)
@@ -600,7 +672,11 @@ BOOL WLog_SetLogLevel(wLog* log, DWORD logLevel)
 			return FALSE;
 	}
 
-	return WLog_reset_log_filters(log);
+	if (!WLog_reset_log_filters(log))
+		return FALSE;
+
+	WLog_UpdateLevelFloor(log);
+	return TRUE;
 }
 
 int WLog_ParseLogLevel(LPCSTR level)
@@ -1065,6 +1141,11 @@ BOOL WLog_Uninit(void)
 }
 #endif
 
+BOOL WLog_Flush(void)
+{
+	return WLog_AsyncWriter_Flush();
+}
+
 BOOL WLog_SetContext(wLog* log, const char* (*fkt)(void*), void* context)
 {
 	WINPR_ASSERT(log);
@@ -44,6 +44,7 @@ typedef void (*WLOG_APPENDER_FREE)(wLogAppender* appender);
 	wLogLayout* Layout;                                       \
 	CRITICAL_SECTION lock;                                    \
 	BOOL recursive;                                           \
+	BOOL async;                                               \
 	void* TextMessageContext;                                 \
 	void* DataMessageContext;                                 \
 	void* ImageMessageContext;                                \
@@ -85,6 +86,8 @@ struct s_wLog
 
 extern const char* WLOG_LEVELS[7];
 BOOL WLog_Layout_GetMessagePrefix(wLog* log, wLogLayout* layout, wLogMessage* message);
+size_t WLog_Layout_GetThreadId(void);
+BOOL WLog_WriteMessageLocked(wLog* log, wLogAppender* appender, wLogMessage* message);
 
 #include "Layout.h"
 #include "Appender.h"
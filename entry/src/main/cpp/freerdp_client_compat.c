@@ -237,8 +237,20 @@ BOOL freerdp_client_auto_reconnect(rdpContext* context)
     BOOL success = freerdp_reconnect(context->instance);
     
     if (success) {
+        rdpConnectTimings timings = { 0 };
+
         COMPAT_LOGI("Reconnection successful!");
         rctx->reconnectCount = 0;
+
+        if (freerdp_get_connect_timings(context, &timings)) {
+            COMPAT_LOGI("Reconnect took %llums: tcp=%llums tls=%llums%s nla=%llums caps=%llums",
+                        (unsigned long long)(timings.totalNs / 1000000ull),
+                        (unsigned long long)(timings.tcpNs / 1000000ull),
+                        (unsigned long long)(timings.tlsNs / 1000000ull),
+                        timings.tlsResumed ? " (resumed)" : "",
+                        (unsigned long long)(timings.nlaNs / 1000000ull),
+                        (unsigned long long)(timings.capabilitiesNs / 1000000ull));
+        }
     }
     
     rctx->isReconnecting = FALSE;
@@ -30,15 +30,13 @@
 
 #include <freerdp/client/cliprdr.h>
 
-typedef struct {
+struct harmonyos_clipboard {
     CliprdrClientContext* cliprdr;
     harmonyosContext* afc;
     UINT32 requestedFormatId;
     char* lastReceivedData;
     size_t lastReceivedDataLength;
-} harmonyosClipboardContext;
-
-static harmonyosClipboardContext* g_clipboardCtx = NULL;
+};
 
 /* Format data request callback */
 static UINT harmonyos_cliprdr_send_client_format_data_request(CliprdrClientContext* cliprdr, UINT32 formatId) {
@@ -107,6 +105,8 @@ static UINT harmonyos_cliprdr_server_format_list(CliprdrClientContext* cliprdr,
     if (!cliprdr)
         return ERROR_INVALID_PARAMETER;
     
+    harmonyosClipboard* clipboard = (harmonyosClipboard*)cliprdr->custom;
+    
     /* Send format list response */
     ZeroMemory(&formatListResponse, sizeof(CLIPRDR_FORMAT_LIST_RESPONSE));
     formatListResponse.common.msgFlags = CB_RESPONSE_OK;
@@ -117,8 +117,8 @@ static UINT harmonyos_cliprdr_server_format_list(CliprdrClientContext* cliprdr,
     for (UINT32 i = 0; i < formatList->numFormats; i++) {
         if (formatList->formats[i].formatId == CF_UNICODETEXT ||
             formatList->formats[i].formatId == CF_TEXT) {
-            if (g_clipboardCtx) {
-                g_clipboardCtx->requestedFormatId = formatList->formats[i].formatId;
+            if (clipboard) {
+                clipboard->requestedFormatId = formatList->formats[i].formatId;
             }
             return harmonyos_cliprdr_send_client_format_data_request(cliprdr, formatList->formats[i].formatId);
         }
@@ -157,33 +157,35 @@ static UINT harmonyos_cliprdr_server_format_data_response(CliprdrClientContext*
     LOGD("Server format data response: flags=0x%04X, dataLen=%u", 
          formatDataResponse->common.msgFlags, formatDataResponse->common.dataLen);
     
-    if (!cliprdr || !g_clipboardCtx)
+    if (!cliprdr || !cliprdr->custom)
         return ERROR_INVALID_PARAMETER;
     
+    harmonyosClipboard* clipboard = (harmonyosClipboard*)cliprdr->custom;
+    
     if (formatDataResponse->common.msgFlags != CB_RESPONSE_OK)
         return CHANNEL_RC_OK;
     
     /* Free previous data */
-    if (g_clipboardCtx->lastReceivedData) {
-        free(g_clipboardCtx->lastReceivedData);
-        g_clipboardCtx->lastReceivedData = NULL;
-        g_clipboardCtx->lastReceivedDataLength = 0;
+    if (clipboard->lastReceivedData) {
+        free(clipboard->lastReceivedData);
+        clipboard->lastReceivedData = NULL;
+        clipboard->lastReceivedDataLength = 0;
     }
     
     if (formatDataResponse->common.dataLen > 0 && formatDataResponse->requestedFormatData) {
         /* Convert and store data */
-        if (g_clipboardCtx->requestedFormatId == CF_UNICODETEXT) {
+        if (clipboard->requestedFormatId == CF_UNICODETEXT) {
             /* Convert UTF-16 to UTF-8 */
             /* For simplicity, just copy as-is for now */
             /* TODO: Proper UTF-16 to UTF-8 conversion */
-            g_clipboardCtx->lastReceivedData = (char*)malloc(formatDataResponse->common.dataLen + 1);
-            if (g_clipboardCtx->lastReceivedData) {
-                memcpy(g_clipboardCtx->lastReceivedData, formatDataResponse->requestedFormatData, formatDataResponse->common.dataLen);
-                g_clipboardCtx->lastReceivedData[formatDataResponse->common.dataLen] = '\0';
-                g_clipboardCtx->lastReceivedDataLength = formatDataResponse->common.dataLen;
+            clipboard->lastReceivedData = (char*)malloc(formatDataResponse->common.dataLen + 1);
+            if (clipboard->lastReceivedData) {
+                memcpy(clipboard->lastReceivedData, formatDataResponse->requestedFormatData, formatDataResponse->common.dataLen);
+                clipboard->lastReceivedData[formatDataResponse->common.dataLen] = '\0';
+                clipboard->lastReceivedDataLength = formatDataResponse->common.dataLen;
                 
                 /* TODO: Notify ArkTS layer about clipboard change */
-                LOGI("Clipboard data received: %zu bytes", g_clipboardCtx->lastReceivedDataLength);
+                LOGI("Clipboard data received: %zu bytes", clipboard->lastReceivedDataLength);
             }
         }
     }
@@ -198,14 +200,15 @@ void harmonyos_cliprdr_init(harmonyosContext* afc, CliprdrClientContext* cliprdr
     
     LOGI("Initializing clipboard");
     
-    g_clipboardCtx = (harmonyosClipboardContext*)calloc(1, sizeof(harmonyosClipboardContext));
-    if (!g_clipboardCtx)
+    harmonyosClipboard* clipboard = (harmonyosClipboard*)calloc(1, sizeof(harmonyosClipboard));
+    if (!clipboard)
         return;
     
-    g_clipboardCtx->afc = afc;
-    g_clipboardCtx->cliprdr = cliprdr;
+    clipboard->afc = afc;
+    clipboard->cliprdr = cliprdr;
     
-    cliprdr->custom = g_clipboardCtx;
+    afc->clipboard = clipboard;
+    cliprdr->custom = clipboard;
     cliprdr->ServerCapabilities = harmonyos_cliprdr_server_capabilities;
     cliprdr->MonitorReady = harmonyos_cliprdr_monitor_ready;
     cliprdr->ServerFormatList = harmonyos_cliprdr_server_format_list;
@@ -216,29 +219,32 @@ void harmonyos_cliprdr_init(harmonyosContext* afc, CliprdrClientContext* cliprdr
 
 /* Uninitialize clipboard */
 void harmonyos_cliprdr_uninit(harmonyosContext* afc, CliprdrClientContext* cliprdr) {
-    (void)afc;
     if (!cliprdr)
         return;
     
     LOGI("Uninitializing clipboard");
     
-    if (g_clipboardCtx) {
-        if (g_clipboardCtx->lastReceivedData) {
-            free(g_clipboardCtx->lastReceivedData);
+    harmonyosClipboard* clipboard = (harmonyosClipboard*)cliprdr->custom;
+    if (clipboard) {
+        if (clipboard->lastReceivedData) {
+            free(clipboard->lastReceivedData);
         }
-        free(g_clipboardCtx);
-        g_clipboardCtx = NULL;
+        free(clipboard);
     }
     
+    if (afc && afc->clipboard == clipboard)
+        afc->clipboard = NULL;
     cliprdr->custom = NULL;
 }
 
 /* Send clipboard data to server */
-bool harmonyos_cliprdr_send_data(const char* data, size_t length) {
+bool harmonyos_cliprdr_send_data(harmonyosContext* afc, const char* data, size_t length) {
     (void)length;
-    if (!g_clipboardCtx || !g_clipboardCtx->cliprdr || !data)
+    if (!afc || !afc->clipboard || !afc->clipboard->cliprdr || !data)
         return false;
     
+    harmonyosClipboard* clipboard = afc->clipboard;
+    
     CLIPRDR_FORMAT_LIST formatList;
     CLIPRDR_FORMAT formats[1];
     
@@ -252,7 +258,7 @@ bool harmonyos_cliprdr_send_data(const char* data, size_t length) {
     formatList.formats = formats;
     
     /* Notify server that we have new clipboard data */
-    UINT rc = g_clipboardCtx->cliprdr->ClientFormatList(g_clipboardCtx->cliprdr, &formatList);
+    UINT rc = clipboard->cliprdr->ClientFormatList(clipboard->cliprdr, &formatList);
     
     return (rc == CHANNEL_RC_OK);
 }
@@ -0,0 +1,224 @@
+/*
+ * HarmonyOS FreeRDP Cursor Atlas
+ *
+ * Copyright 2026 FreeRDP HarmonyOS Port
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+ */
+
+#include "harmonyos_freerdp.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef OHOS_PLATFORM
+#include <hilog/log.h>
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "FreeRDP.Cursor"
+#define LOGI(...) OH_LOG_INFO(LOG_APP, __VA_ARGS__)
+#define LOGW(...) OH_LOG_WARN(LOG_APP, __VA_ARGS__)
+#define LOGE(...) OH_LOG_ERROR(LOG_APP, __VA_ARGS__)
+#define LOGD(...) OH_LOG_DEBUG(LOG_APP, __VA_ARGS__)
+#else
+#include <stdio.h>
+#define LOGI(...) printf(__VA_ARGS__)
+#define LOGW(...) printf(__VA_ARGS__)
+#define LOGE(...) printf(__VA_ARGS__)
+#define LOGD(...) printf(__VA_ARGS__)
+#endif
+
+#include <freerdp/codec/color.h>
+
+/* Enough for the largest pointer cache a server negotiates plus recently dropped shapes */
+#define CURSOR_ATLAS_CAPACITY 64
+
+/* ArkTS PixelMap RGBA_8888 byte order */
+#define CURSOR_ATLAS_FORMAT PIXEL_FORMAT_RGBA32
+
+typedef struct {
+    uint32_t id;        /* 0 for a free slot */
+    uint64_t hash;      /* hash of the pointer update the pixels were decoded from */
+    uint32_t width;
+    uint32_t height;
+    uint32_t refs;      /* rdpPointer objects using the entry */
+    uint64_t lastUse;   /* atlas clock of the last lookup */
+    uint8_t* pixels;    /* width * height RGBA pixels */
+} CursorAtlasEntry;
+
+struct harmonyos_cursor_atlas {
+    CursorAtlasEntry entries[CURSOR_ATLAS_CAPACITY];
+    uint32_t nextId;
+    uint64_t clock;
+};
+
+/* FNV-1a over 8 byte words with an extra shift to mix the high bits down */
+static uint64_t cursor_hash(uint64_t hash, const void* data, size_t length) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    size_t x = 0;
+
+    if (!bytes)
+        return hash;
+
+    for (; x + 8 <= length; x += 8) {
+        uint64_t word;
+        memcpy(&word, &bytes[x], sizeof(word));
+        hash = (hash ^ word) * 0x100000001B3ULL;
+        hash ^= hash >> 29;
+    }
+
+    for (; x < length; x++)
+        hash = (hash ^ bytes[x]) * 0x100000001B3ULL;
+
+    return hash;
+}
+
+static uint64_t cursor_hash_pointer(const rdpPointer* pointer, const gdiPalette* palette) {
+    const uint32_t header[] = { pointer->width, pointer->height, pointer->xorBpp,
+                                pointer->lengthXorMask, pointer->lengthAndMask };
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    hash = cursor_hash(hash, header, sizeof(header));
+    hash = cursor_hash(hash, pointer->xorMaskData, pointer->lengthXorMask);
+    hash = cursor_hash(hash, pointer->andMaskData, pointer->lengthAndMask);
+
+    /* 8 bpp pointers index the session palette */
+    if ((pointer->xorBpp == 8) && palette)
+        hash = cursor_hash(hash, palette->palette, sizeof(palette->palette));
+
+    return hash;
+}
+
+static CursorAtlasEntry* cursor_atlas_find(harmonyosCursorAtlas* atlas, uint32_t id) {
+    if (!atlas || !id)
+        return NULL;
+
+    for (size_t x = 0; x < CURSOR_ATLAS_CAPACITY; x++) {
+        if (atlas->entries[x].id == id)
+            return &atlas->entries[x];
+    }
+    return NULL;
+}
+
+/* A free slot, or the least recently used entry no pointer refers to */
+static CursorAtlasEntry* cursor_atlas_slot(harmonyosCursorAtlas* atlas, uint32_t* evicted) {
+    CursorAtlasEntry* victim = NULL;
+
+    for (size_t x = 0; x < CURSOR_ATLAS_CAPACITY; x++) {
+        CursorAtlasEntry* entry = &atlas->entries[x];
+
+        if (!entry->id)
+            return entry;
+
+        if (!entry->refs && (!victim || (entry->lastUse < victim->lastUse)))
+            victim = entry;
+    }
+
+    if (victim) {
+        *evicted = victim->id;
+        free(victim->pixels);
+        memset(victim, 0, sizeof(*victim));
+    }
+    return victim;
+}
+
+harmonyosCursorAtlas* harmonyos_cursor_atlas_new(void) {
+    harmonyosCursorAtlas* atlas = (harmonyosCursorAtlas*)calloc(1, sizeof(harmonyosCursorAtlas));
+    if (!atlas)
+        return NULL;
+
+    atlas->nextId = 1;
+    return atlas;
+}
+
+void harmonyos_cursor_atlas_free(harmonyosCursorAtlas* atlas) {
+    if (!atlas)
+        return;
+
+    for (size_t x = 0; x < CURSOR_ATLAS_CAPACITY; x++)
+        free(atlas->entries[x].pixels);
+    free(atlas);
+}
+
+uint32_t harmonyos_cursor_atlas_add(harmonyosCursorAtlas* atlas, rdpContext* context,
+                                    const rdpPointer* pointer, bool* added, uint32_t* evicted) {
+    if (!atlas || !context || !pointer || !added || !evicted)
+        return 0;
+
+    *added = false;
+    *evicted = 0;
+
+    if (!pointer->width || !pointer->height)
+        return 0;
+
+    const gdiPalette* palette = context->gdi ? &context->gdi->palette : NULL;
+    const uint64_t hash = cursor_hash_pointer(pointer, palette);
+
+    atlas->clock++;
+    for (size_t x = 0; x < CURSOR_ATLAS_CAPACITY; x++) {
+        CursorAtlasEntry* entry = &atlas->entries[x];
+
+        if (entry->id && (entry->hash == hash) && (entry->width == pointer->width) &&
+            (entry->height == pointer->height)) {
+            entry->refs++;
+            entry->lastUse = atlas->clock;
+            return entry->id;
+        }
+    }
+
+    const size_t stride = 4ULL * pointer->width;
+    uint8_t* pixels = (uint8_t*)calloc(pointer->height, stride);
+    if (!pixels)
+        return 0;
+
+    if (!freerdp_image_copy_from_pointer_data(pixels, CURSOR_ATLAS_FORMAT, (UINT32)stride, 0, 0,
+                                              pointer->width, pointer->height,
+                                              pointer->xorMaskData, pointer->lengthXorMask,
+                                              pointer->andMaskData, pointer->lengthAndMask,
+                                              pointer->xorBpp, palette)) {
+        LOGW("cursor atlas: invalid %ux%u pointer with %u bpp", pointer->width, pointer->height,
+             pointer->xorBpp);
+        free(pixels);
+        return 0;
+    }
+
+    CursorAtlasEntry* entry = cursor_atlas_slot(atlas, evicted);
+    if (!entry) {
+        LOGW("cursor atlas: all %d entries in use", CURSOR_ATLAS_CAPACITY);
+        free(pixels);
+        return 0;
+    }
+
+    entry->id = atlas->nextId++;
+    if (!atlas->nextId)
+        atlas->nextId = 1;
+    entry->hash = hash;
+    entry->width = pointer->width;
+    entry->height = pointer->height;
+    entry->refs = 1;
+    entry->lastUse = atlas->clock;
+    entry->pixels = pixels;
+
+    *added = true;
+    return entry->id;
+}
+
+void harmonyos_cursor_atlas_release(harmonyosCursorAtlas* atlas, uint32_t id) {
+    CursorAtlasEntry* entry = cursor_atlas_find(atlas, id);
+
+    /* The pixels stay cached, the server often sends the same shape again */
+    if (entry && entry->refs)
+        entry->refs--;
+}
+
+const uint8_t* harmonyos_cursor_atlas_get(harmonyosCursorAtlas* atlas, uint32_t id,
+                                          uint32_t* width, uint32_t* height) {
+    const CursorAtlasEntry* entry = cursor_atlas_find(atlas, id);
+
+    if (!entry || !width || !height)
+        return NULL;
+
+    *width = entry->width;
+    *height = entry->height;
+    return entry->pixels;
+}
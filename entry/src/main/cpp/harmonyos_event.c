@@ -32,18 +32,19 @@
 #include <winpr/collections.h>
 #include <winpr/synch.h>
 
-typedef struct {
+struct harmonyos_event_queue {
     wQueue* queue;
     HANDLE event;
-} EventQueue;
+};
+
+typedef harmonyosEventQueue EventQueue;
 
 static EventQueue* get_event_queue(freerdp* instance) {
     if (!instance || !instance->context)
         return NULL;
     
     harmonyosContext* ctx = (harmonyosContext*)instance->context;
-    // Store queue in context (use napi_env field temporarily)
-    return (EventQueue*)ctx->napi_env;
+    return ctx->events;
 }
 
 static void set_event_queue(freerdp* instance, EventQueue* queue) {
@@ -51,7 +52,7 @@ static void set_event_queue(freerdp* instance, EventQueue* queue) {
         return;
     
     harmonyosContext* ctx = (harmonyosContext*)instance->context;
-    ctx->napi_env = queue;
+    ctx->events = queue;
 }
 
 bool harmonyos_event_queue_init(freerdp* instance) {
@@ -182,6 +183,38 @@ bool harmonyos_check_handle(freerdp* instance) {
                 break;
             }
             
+            case HARMONYOS_EVENT_TYPE_SUSPEND: {
+                harmonyosContext* afc = (harmonyosContext*)instance->context;
+                rdpGdi* gdi = instance->context->gdi;
+                harmonyos_resume_snapshot(afc->resume, gdi);
+                // A reconnect after suspend offers the gfx cache of this session to the server
+                if (gdi && gdi->gfx && gdi->gfx->SavePersistentCache) {
+                    if (gdi->gfx->SavePersistentCache(gdi->gfx) != CHANNEL_RC_OK)
+                        LOGW("Failed to save gfx persistent cache");
+                }
+                break;
+            }
+            
+            case HARMONYOS_EVENT_TYPE_RESUME: {
+                harmonyosContext* afc = (harmonyosContext*)instance->context;
+                RECTANGLE_16 viewport;
+                INT32 focusX = 0;
+                INT32 focusY = 0;
+                harmonyos_get_view(afc, &viewport, &focusX, &focusY);
+                if (!harmonyos_resume_begin(afc->resume, instance->context->gdi, &viewport,
+                                            focusX, focusY))
+                    LOGW("Resume refresh not started");
+                break;
+            }
+            
+            case HARMONYOS_EVENT_TYPE_VIEWPORT: {
+                HARMONYOS_EVENT_VIEWPORT* viewportEvent = (HARMONYOS_EVENT_VIEWPORT*)event;
+                // Out of view surface updates are decoded once they scroll into the viewport
+                if (instance->context->gdi && !gdi_set_viewport(instance->context->gdi, &viewportEvent->rect))
+                    LOGW("Failed to set gdi viewport");
+                break;
+            }
+            
             default:
                 LOGW("Unknown event type: %d", event->type);
                 break;
@@ -253,6 +286,35 @@ HARMONYOS_EVENT_DISCONNECT* harmonyos_event_disconnect_new(void) {
     return event;
 }
 
+HARMONYOS_EVENT_SUSPEND* harmonyos_event_suspend_new(void) {
+    HARMONYOS_EVENT_SUSPEND* event = (HARMONYOS_EVENT_SUSPEND*)calloc(1, sizeof(HARMONYOS_EVENT_SUSPEND));
+    if (!event)
+        return NULL;
+    
+    event->type = HARMONYOS_EVENT_TYPE_SUSPEND;
+    return event;
+}
+
+HARMONYOS_EVENT_RESUME* harmonyos_event_resume_new(void) {
+    HARMONYOS_EVENT_RESUME* event = (HARMONYOS_EVENT_RESUME*)calloc(1, sizeof(HARMONYOS_EVENT_RESUME));
+    if (!event)
+        return NULL;
+    
+    event->type = HARMONYOS_EVENT_TYPE_RESUME;
+    return event;
+}
+
+HARMONYOS_EVENT_VIEWPORT* harmonyos_event_viewport_new(const RECTANGLE_16* rect) {
+    HARMONYOS_EVENT_VIEWPORT* event = (HARMONYOS_EVENT_VIEWPORT*)calloc(1, sizeof(HARMONYOS_EVENT_VIEWPORT));
+    if (!event)
+        return NULL;
+    
+    event->type = HARMONYOS_EVENT_TYPE_VIEWPORT;
+    if (rect)
+        event->rect = *rect;
+    return event;
+}
+
 HARMONYOS_EVENT_CLIPBOARD* harmonyos_event_clipboard_new(const char* data, size_t length) {
     HARMONYOS_EVENT_CLIPBOARD* event = (HARMONYOS_EVENT_CLIPBOARD*)calloc(1, sizeof(HARMONYOS_EVENT_CLIPBOARD));
     if (!event)
@@ -11,17 +11,24 @@
 
 #include "harmonyos_freerdp.h"
 #include "freerdp_client_compat.h"
+#include <freerdp/gdi/region.h>
+#include <freerdp/autodetect.h>
+#include <freerdp/channels/rdpsnd.h>
+#include <freerdp/codec/audio.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <locale.h>
 #include <mutex>
+#include <string>
+#include <vector>
 
 #ifdef OHOS_PLATFORM
 #include <hilog/log.h>
 #include <time.h>
 #include <winpr/sysinfo.h>
+#include <freerdp/primitives.h>
 #ifdef LOG_TAG
 #undef LOG_TAG
 #endif
@@ -31,11 +38,6 @@
 #define LOGE(...) OH_LOG_ERROR(LOG_APP, __VA_ARGS__)
 #define LOGD(...) OH_LOG_DEBUG(LOG_APP, __VA_ARGS__)
 
-/* 全局缓冲区和互斥锁 */
-static uint8_t* g_external_buffer = nullptr;
-static size_t g_external_buffer_size = 0;
-static std::mutex g_external_buffer_mutex;
-
 /* OHOS/musl 兼容: GetTickCount64 替代实现 */
 #if !defined(_WIN32)
 static inline UINT64 GetTickCount64_compat(void) {
@@ -59,67 +61,150 @@ static inline UINT64 GetTickCount64_compat(void) {
 
 #define TAG "FreeRDP.HarmonyOS"
 
-/* Global callback pointers */
-static OnConnectionSuccessCallback g_onConnectionSuccess = nullptr;
-static OnConnectionFailureCallback g_onConnectionFailure = nullptr;
-static OnPreConnectCallback g_onPreConnect = nullptr;
-static OnDisconnectingCallback g_onDisconnecting = nullptr;
-static OnDisconnectedCallback g_onDisconnected = nullptr;
-static OnSettingsChangedCallback g_onSettingsChanged = nullptr;
-static OnGraphicsUpdateCallback g_onGraphicsUpdate = nullptr;
-static OnGraphicsResizeCallback g_onGraphicsResize = nullptr;
-static OnRemoteClipboardChangedCallback g_onRemoteClipboardChanged = nullptr;
-static OnCursorTypeChangedCallback g_onCursorTypeChanged = nullptr;
-static OnAuthenticateCallback g_onAuthenticate = nullptr;
-static OnVerifyCertificateCallback g_onVerifyCertificate = nullptr;
-
-/* Callback registration implementations */
+/* Registered callbacks, every new session starts with a copy */
+static harmonyosCallbacks g_callbacks = {};
+
+/* Live sessions, registration updates them and the decode priorities follow the active one */
+static std::mutex g_sessionsMutex;
+static std::vector<harmonyosContext*> g_sessions;
+static harmonyosContext* g_activeSession = nullptr;
+
+/* 所有会话共享的解码线程池，避免每个会话各自创建工作线程 */
+static std::once_flag g_decodePoolOnce;
+static PTP_POOL g_decodePool = nullptr;
+
+static PTP_POOL get_decode_pool(void) {
+    std::call_once(g_decodePoolOnce, [] {
+        SYSTEM_INFO sysinfo = {};
+        GetNativeSystemInfo(&sysinfo);
+        const DWORD threads = MAX(sysinfo.dwNumberOfProcessors, 1);
+
+        PTP_POOL pool = CreateThreadpool(nullptr);
+        if (!pool) {
+            LOGW("Shared decode pool unavailable, codecs use their own workers");
+            return;
+        }
+
+        SetThreadpoolThreadMaximum(pool, threads);
+        if (!SetThreadpoolThreadMinimum(pool, threads)) {
+            LOGW("Shared decode pool unavailable, codecs use their own workers");
+            CloseThreadpool(pool);
+            return;
+        }
+
+        LOGI("Shared decode pool started with %u threads", (unsigned int)threads);
+        g_decodePool = pool;
+    });
+    return g_decodePool;
+}
+
+/*
+ * The active session decodes first, the others run throttled at low priority.
+ * Without an active session all of them share the workers evenly, background
+ * sessions are always throttled. Caller holds g_sessionsMutex.
+ */
+static void update_decode_priorities(void) {
+    for (harmonyosContext* afc : g_sessions) {
+        TP_CALLBACK_PRIORITY priority = TP_CALLBACK_PRIORITY_NORMAL;
+
+        if (afc->isInBackgroundMode)
+            priority = TP_CALLBACK_PRIORITY_LOW;
+        else if (g_activeSession)
+            priority = (afc == g_activeSession) ? TP_CALLBACK_PRIORITY_HIGH : TP_CALLBACK_PRIORITY_LOW;
+
+        SetThreadpoolCallbackPriority(&afc->decodeEnv, priority);
+    }
+}
+
+static void register_session(harmonyosContext* afc) {
+    std::lock_guard<std::mutex> lock(g_sessionsMutex);
+    afc->callbacks = g_callbacks;
+    g_sessions.push_back(afc);
+    update_decode_priorities();
+}
+
+static void unregister_session(harmonyosContext* afc) {
+    std::lock_guard<std::mutex> lock(g_sessionsMutex);
+    for (auto it = g_sessions.begin(); it != g_sessions.end(); ++it) {
+        if (*it == afc) {
+            g_sessions.erase(it);
+            break;
+        }
+    }
+    if (g_activeSession == afc)
+        g_activeSession = nullptr;
+    update_decode_priorities();
+}
+
+/* Registration may replace callbacks while the session runs, read a consistent copy */
+static harmonyosCallbacks session_callbacks(rdpContext* context) {
+    std::lock_guard<std::mutex> lock(g_sessionsMutex);
+    return ((harmonyosContext*)context)->callbacks;
+}
+
+/* Callback registration implementations, sessions that already exist pick them up too */
+#define HARMONYOS_SET_CALLBACK(field, callback)            \
+    do {                                                   \
+        std::lock_guard<std::mutex> lock(g_sessionsMutex); \
+        g_callbacks.field = (callback);                    \
+        for (harmonyosContext* afc : g_sessions)           \
+            afc->callbacks.field = (callback);             \
+    } while (0)
+
 void harmonyos_set_connection_success_callback(OnConnectionSuccessCallback callback) {
-    g_onConnectionSuccess = callback;
+    HARMONYOS_SET_CALLBACK(onConnectionSuccess, callback);
 }
 
 void harmonyos_set_connection_failure_callback(OnConnectionFailureCallback callback) {
-    g_onConnectionFailure = callback;
+    HARMONYOS_SET_CALLBACK(onConnectionFailure, callback);
 }
 
 void harmonyos_set_pre_connect_callback(OnPreConnectCallback callback) {
-    g_onPreConnect = callback;
+    HARMONYOS_SET_CALLBACK(onPreConnect, callback);
 }
 
 void harmonyos_set_disconnecting_callback(OnDisconnectingCallback callback) {
-    g_onDisconnecting = callback;
+    HARMONYOS_SET_CALLBACK(onDisconnecting, callback);
 }
 
 void harmonyos_set_disconnected_callback(OnDisconnectedCallback callback) {
-    g_onDisconnected = callback;
+    HARMONYOS_SET_CALLBACK(onDisconnected, callback);
 }
 
 void harmonyos_set_settings_changed_callback(OnSettingsChangedCallback callback) {
-    g_onSettingsChanged = callback;
+    HARMONYOS_SET_CALLBACK(onSettingsChanged, callback);
 }
 
 void harmonyos_set_graphics_update_callback(OnGraphicsUpdateCallback callback) {
-    g_onGraphicsUpdate = callback;
+    HARMONYOS_SET_CALLBACK(onGraphicsUpdate, callback);
 }
 
 void harmonyos_set_graphics_resize_callback(OnGraphicsResizeCallback callback) {
-    g_onGraphicsResize = callback;
+    HARMONYOS_SET_CALLBACK(onGraphicsResize, callback);
 }
 
 void harmonyos_set_remote_clipboard_changed_callback(OnRemoteClipboardChangedCallback callback) {
-    g_onRemoteClipboardChanged = callback;
+    HARMONYOS_SET_CALLBACK(onRemoteClipboardChanged, callback);
 }
 
 void harmonyos_set_cursor_type_changed_callback(OnCursorTypeChangedCallback callback) {
-    g_onCursorTypeChanged = callback;
+    HARMONYOS_SET_CALLBACK(onCursorTypeChanged, callback);
+}
+
+void harmonyos_set_cursor_bitmap_callback(OnCursorBitmapCallback callback) {
+    HARMONYOS_SET_CALLBACK(onCursorBitmap, callback);
+}
+
+void harmonyos_set_cursor_set_callback(OnCursorSetCallback callback) {
+    HARMONYOS_SET_CALLBACK(onCursorSet, callback);
 }
 
 void harmonyos_set_authenticate_callback(OnAuthenticateCallback callback) {
-    g_onAuthenticate = callback;
+    HARMONYOS_SET_CALLBACK(onAuthenticate, callback);
 }
 
 void harmonyos_set_verify_certificate_callback(OnVerifyCertificateCallback callback) {
-    g_onVerifyCertificate = callback;
+    HARMONYOS_SET_CALLBACK(onVerifyCertificate, callback);
 }
 
 /* Identify cursor type based on pointer properties */
@@ -162,6 +247,44 @@ static int identify_cursor_type(rdpPointer* pointer) {
     return CURSOR_TYPE_UNKNOWN;
 }
 
+/* Quality controller inputs */
+static UINT32 harmonyos_frame_queue_depth(RdpgfxClientContext* gfx, UINT32 frameId, UINT32 frameTime) {
+    (void)frameId;
+    const rdpGdi* gdi = (const rdpGdi*)gfx->custom;
+    if (!gdi || !gdi->context)
+        return QUEUE_DEPTH_UNAVAILABLE;
+
+    const harmonyosContext* afc = (const harmonyosContext*)gdi->context;
+    return harmonyos_quality_frame(afc->quality, frameTime, GetTickCount64());
+}
+
+static BOOL harmonyos_network_characteristics(rdpAutoDetect* autodetect, RDP_TRANSPORT_TYPE transport,
+                                              UINT16 sequenceNumber,
+                                              const rdpNetworkCharacteristicsResult* result) {
+    (void)transport;
+    (void)sequenceNumber;
+    const harmonyosContext* afc = (const harmonyosContext*)autodetect->context;
+
+    /* The base RTT only variant carries no bandwidth */
+    const UINT32 bandwidth =
+        (result->type == RDP_NETCHAR_RESULT_TYPE_BASE_RTT_AVG_RTT) ? 0 : result->bandwidth;
+    LOGD("Network characteristics: rtt %u ms (base %u), %u kbit/s", result->averageRTT,
+         result->baseRTT, bandwidth);
+    harmonyos_quality_network(afc->quality, result->averageRTT, bandwidth, GetTickCount64());
+    return TRUE;
+}
+
+static BOOL harmonyos_bandwidth_measured(rdpAutoDetect* autodetect, RDP_TRANSPORT_TYPE transport,
+                                         UINT16 responseType, UINT16 sequenceNumber,
+                                         UINT32 timeDelta, UINT32 byteCount) {
+    (void)transport;
+    (void)responseType;
+    (void)sequenceNumber;
+    const harmonyosContext* afc = (const harmonyosContext*)autodetect->context;
+    harmonyos_quality_bandwidth(afc->quality, timeDelta, byteCount, GetTickCount64());
+    return TRUE;
+}
+
 /* Channel event handlers */
 static void harmonyos_OnChannelConnectedEventHandler(void* context, const ChannelConnectedEventArgs* e) {
     harmonyosContext* afc;
@@ -179,6 +302,12 @@ static void harmonyos_OnChannelConnectedEventHandler(void* context, const Channe
         LOGI("Clipboard channel connected");
     } else {
         freerdp_client_OnChannelConnectedEventHandler(context, e);
+
+        /* Frame acknowledges report the queue depth the quality controller estimates */
+        if (strcmp(e->name, RDPGFX_DVC_CHANNEL_NAME) == 0) {
+            RdpgfxClientContext* gfx = (RdpgfxClientContext*)e->pInterface;
+            gfx->FrameQueueDepth = harmonyos_frame_queue_depth;
+        }
     }
 }
 
@@ -208,18 +337,24 @@ static BOOL harmonyos_begin_paint(rdpContext* context) {
 }
 
 bool freerdp_harmonyos_update_graphics_buffer(int64_t instance, uint8_t* buffer, size_t buffer_size) {
-    std::lock_guard<std::mutex> lock(g_external_buffer_mutex);
-    g_external_buffer = buffer;
-    g_external_buffer_size = buffer_size;
+    freerdp* inst = (freerdp*)(uintptr_t)instance;
+    if (!inst || !inst->context)
+        return false;
+
+    harmonyosContext* afc = (harmonyosContext*)inst->context;
+    EnterCriticalSection(&afc->bufferLock);
+    afc->externalBuffer = buffer;
+    afc->externalBufferSize = buffer_size;
+    LeaveCriticalSection(&afc->bufferLock);
     LOGI("freerdp_harmonyos_update_graphics_buffer: buffer=%p, size=%zu", buffer, buffer_size);
     return true;
 }
 
 static BOOL harmonyos_end_paint(rdpContext* context) {
     HGDI_WND hwnd;
-    int ninvalid;
     rdpGdi* gdi;
-    HGDI_RGN cinvalid;
+    const GDI_RGN* rects;
+    UINT32 nrects = 0;
     int x1, y1, x2, y2;
     harmonyosContext* ctx = (harmonyosContext*)context;
     rdpSettings* settings;
@@ -239,24 +374,30 @@ static BOOL harmonyos_end_paint(rdpContext* context) {
     if (!hwnd)
         return FALSE;
 
-    ninvalid = hwnd->ninvalid;
-    if (ninvalid < 1)
+    if (hwnd->ninvalid < 1)
         return TRUE;
 
-    cinvalid = hwnd->cinvalid;
-    if (!cinvalid)
+    /* With the tile grid the dirty area comes as merged tile runs, otherwise as the cinvalid list */
+    if (hwnd->grid) {
+        rects = gdi_invalid_grid_rects(hwnd->grid, &nrects);
+    } else {
+        rects = hwnd->cinvalid;
+        nrects = (UINT32)hwnd->ninvalid;
+    }
+
+    if (!rects || nrects < 1)
         return FALSE;
 
-    x1 = cinvalid[0].x;
-    y1 = cinvalid[0].y;
-    x2 = cinvalid[0].x + cinvalid[0].w;
-    y2 = cinvalid[0].y + cinvalid[0].h;
+    x1 = rects[0].x;
+    y1 = rects[0].y;
+    x2 = rects[0].x + rects[0].w;
+    y2 = rects[0].y + rects[0].h;
 
-    for (int i = 0; i < ninvalid; i++) {
-        x1 = MIN(x1, cinvalid[i].x);
-        y1 = MIN(y1, cinvalid[i].y);
-        x2 = MAX(x2, cinvalid[i].x + cinvalid[i].w);
-        y2 = MAX(y2, cinvalid[i].y + cinvalid[i].h);
+    for (UINT32 i = 1; i < nrects; i++) {
+        x1 = MIN(x1, rects[i].x);
+        y1 = MIN(y1, rects[i].y);
+        x2 = MAX(x2, rects[i].x + rects[i].w);
+        y2 = MAX(y2, rects[i].y + rects[i].h);
     }
 
     /* 
@@ -272,25 +413,28 @@ static BOOL harmonyos_end_paint(rdpContext* context) {
      */
     
     // Debug log (only first 5 frames)
-    static int frameCount = 0;
-    if (frameCount < 5) {
-        LOGI("harmonyos_end_paint: frame=%d, region=[%d,%d,%d,%d], gdi=%dx%d", 
-             frameCount, x1, y1, x2-x1, y2-y1, gdi->width, gdi->height);
-        frameCount++;
+    if (ctx->frameCount < 5) {
+        LOGI("harmonyos_end_paint: frame=%d, rects=%u, bounds=[%d,%d,%d,%d], gdi=%dx%d",
+             ctx->frameCount, nrects, x1, y1, x2-x1, y2-y1, gdi->width, gdi->height);
+        ctx->frameCount++;
     }
     
     /* 
-     * TODO: Re-enable g_onGraphicsUpdate once we implement Android-style
+     * TODO: Re-enable callbacks.onGraphicsUpdate once we implement Android-style
      * graphics copy in ArkTS layer (using a dedicated N-API getter function)
      */
-    // if (g_onGraphicsUpdate) {
-    //     g_onGraphicsUpdate((int64_t)(uintptr_t)context->instance, x1, y1, x2 - x1, y2 - y1);
+    // if (ctx->callbacks.onGraphicsUpdate) {
+    //     ctx->callbacks.onGraphicsUpdate((int64_t)(uintptr_t)context->instance, x1, y1, x2 - x1, y2 - y1);
     // }
     
     LOGD("harmonyos_end_paint: Graphics update region calculated, memcpy skipped (Android-style)");
 
+    /* Tiles repainted while resuming are not requested again */
+    harmonyos_resume_painted(ctx->resume, gdi, rects, nrects);
+
     hwnd->invalid->null = TRUE;
     hwnd->ninvalid = 0;
+    gdi_invalid_grid_clear(hwnd->grid);
     return TRUE;
 }
 
@@ -301,8 +445,9 @@ static BOOL harmonyos_desktop_resize(rdpContext* context) {
         return FALSE;
     }
 
-    if (g_onGraphicsResize) {
-        g_onGraphicsResize((int64_t)(uintptr_t)context->instance,
+    const harmonyosCallbacks callbacks = session_callbacks(context);
+    if (callbacks.onGraphicsResize) {
+        callbacks.onGraphicsResize((int64_t)(uintptr_t)context->instance,
             freerdp_settings_get_uint32(context->settings, FreeRDP_DesktopWidth),
             freerdp_settings_get_uint32(context->settings, FreeRDP_DesktopHeight),
             freerdp_settings_get_uint32(context->settings, FreeRDP_ColorDepth));
@@ -361,25 +506,74 @@ static BOOL harmonyos_pre_connect(freerdp* instance) {
         LOGI("harmonyos_pre_connect: ChannelDisconnected subscribed");
     }
 
-    if (g_onPreConnect) {
-        g_onPreConnect((int64_t)(uintptr_t)instance);
+    /* The channels are loaded right after this with the requested audio mode */
+    harmonyos_quality_connect_audio(((harmonyosContext*)context)->quality);
+
+    /* RTT and bandwidth results of the server feed the quality controller */
+    rdpAutoDetect* autodetect = autodetect_get(context);
+    if (autodetect) {
+        autodetect->NetworkCharacteristicsResult = harmonyos_network_characteristics;
+        autodetect->ClientBandwidthMeasureResult = harmonyos_bandwidth_measured;
+    }
+
+    const harmonyosCallbacks callbacks = session_callbacks(context);
+    if (callbacks.onPreConnect) {
+        callbacks.onPreConnect((int64_t)(uintptr_t)instance);
     }
     
     LOGI("harmonyos_pre_connect: returning TRUE");
     return TRUE;
 }
 
+/* Pointer with the cursor atlas entry of its bitmap */
+typedef struct {
+    rdpPointer pointer;
+    uint32_t cursorId;
+} harmonyosPointer;
+
 /* Pointer handlers */
 static BOOL harmonyos_Pointer_New(rdpContext* context, rdpPointer* pointer) {
     /* 安全检查 */
     if (!context || !pointer || !context->gdi)
         return FALSE;
+
+    harmonyosContext* afc = (harmonyosContext*)context;
+    harmonyosPointer* ptr = (harmonyosPointer*)pointer;
+
+    /* Without ArkTS cursor callbacks Pointer_Set falls back to a cursor type guess */
+    const harmonyosCallbacks callbacks = session_callbacks(context);
+    if (!afc->cursors || !callbacks.onCursorBitmap || !callbacks.onCursorSet)
+        return TRUE;
+
+    bool added = false;
+    uint32_t evicted = 0;
+    ptr->cursorId = harmonyos_cursor_atlas_add(afc->cursors, context, pointer, &added, &evicted);
+
+    const int64_t instance = (int64_t)(uintptr_t)context->instance;
+    if (evicted)
+        callbacks.onCursorBitmap(instance, evicted, 0, 0, nullptr);
+
+    /* Pixels go to ArkTS once per unique bitmap, animation frames seen before are free */
+    if (added) {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        const uint8_t* pixels = harmonyos_cursor_atlas_get(afc->cursors, ptr->cursorId, &width,
+                                                           &height);
+        if (pixels)
+            callbacks.onCursorBitmap(instance, ptr->cursorId, (int)width, (int)height, pixels);
+    }
     return TRUE;
 }
 
 static void harmonyos_Pointer_Free(rdpContext* context, rdpPointer* pointer) {
-    WINPR_UNUSED(context);
-    WINPR_UNUSED(pointer);
+    if (!context || !pointer)
+        return;
+
+    harmonyosContext* afc = (harmonyosContext*)context;
+    harmonyosPointer* ptr = (harmonyosPointer*)pointer;
+
+    harmonyos_cursor_atlas_release(afc->cursors, ptr->cursorId);
+    ptr->cursorId = 0;
 }
 
 static BOOL harmonyos_Pointer_Set(rdpContext* context, rdpPointer* pointer) {
@@ -387,11 +581,20 @@ static BOOL harmonyos_Pointer_Set(rdpContext* context, rdpPointer* pointer) {
     if (!context || !pointer)
         return FALSE;
 
+    freerdp* instance = context->instance;
+    const harmonyosCallbacks callbacks = session_callbacks(context);
+    const harmonyosPointer* ptr = (const harmonyosPointer*)pointer;
+
+    if (instance && ptr->cursorId && callbacks.onCursorSet) {
+        callbacks.onCursorSet((int64_t)(uintptr_t)instance, ptr->cursorId, (int)pointer->xPos,
+                              (int)pointer->yPos);
+        return TRUE;
+    }
+
     int cursorType = identify_cursor_type(pointer);
     
-    freerdp* instance = context->instance;
-    if (instance && g_onCursorTypeChanged) {
-        g_onCursorTypeChanged((int64_t)(uintptr_t)instance, cursorType);
+    if (instance && callbacks.onCursorTypeChanged) {
+        callbacks.onCursorTypeChanged((int64_t)(uintptr_t)instance, cursorType);
     }
 
     return TRUE;
@@ -410,8 +613,12 @@ static BOOL harmonyos_Pointer_SetNull(rdpContext* context) {
     LOGD("Pointer_SetNull");
     
     freerdp* instance = context->instance;
-    if (instance && g_onCursorTypeChanged) {
-        g_onCursorTypeChanged((int64_t)(uintptr_t)instance, CURSOR_TYPE_UNKNOWN);
+    const harmonyosCallbacks callbacks = session_callbacks(context);
+    if (instance && callbacks.onCursorSet) {
+        callbacks.onCursorSet((int64_t)(uintptr_t)instance, 0, 0, 0);
+    }
+    if (instance && callbacks.onCursorTypeChanged) {
+        callbacks.onCursorTypeChanged((int64_t)(uintptr_t)instance, CURSOR_TYPE_UNKNOWN);
     }
     return TRUE;
 }
@@ -422,8 +629,12 @@ static BOOL harmonyos_Pointer_SetDefault(rdpContext* context) {
     LOGD("Pointer_SetDefault");
     
     freerdp* instance = context->instance;
-    if (instance && g_onCursorTypeChanged) {
-        g_onCursorTypeChanged((int64_t)(uintptr_t)instance, CURSOR_TYPE_DEFAULT);
+    const harmonyosCallbacks callbacks = session_callbacks(context);
+    if (instance && callbacks.onCursorSet) {
+        callbacks.onCursorSet((int64_t)(uintptr_t)instance, 0, 0, 0);
+    }
+    if (instance && callbacks.onCursorTypeChanged) {
+        callbacks.onCursorTypeChanged((int64_t)(uintptr_t)instance, CURSOR_TYPE_DEFAULT);
     }
     return TRUE;
 }
@@ -435,7 +646,7 @@ static BOOL harmonyos_register_pointer(rdpGraphics* graphics) {
     if (!graphics)
         return FALSE;
 
-    pointer.size = sizeof(pointer);
+    pointer.size = sizeof(harmonyosPointer);
     pointer.New = harmonyos_Pointer_New;
     pointer.Free = harmonyos_Pointer_Free;
     pointer.Set = harmonyos_Pointer_Set;
@@ -482,6 +693,11 @@ static BOOL harmonyos_post_connect(freerdp* instance) {
     }
     LOGI("harmonyos_post_connect: gdi_init succeeded");
 
+    /* Track dirty areas on 64x64 tiles, repaint everything once 60% of the tiles changed */
+    if (!gdi_set_invalid_tiles(instance->context->gdi, 64, 60)) {
+        LOGW("harmonyos_post_connect: invalid tile grid unavailable, using the rect list");
+    }
+
     if (!harmonyos_register_pointer(instance->context->graphics)) {
         LOGE("harmonyos_post_connect: register_pointer failed");
         return FALSE;
@@ -497,7 +713,7 @@ static BOOL harmonyos_post_connect(freerdp* instance) {
     /* 
      * CRITICAL: Temporarily bypass ArkTS callbacks to isolate the crash.
      * The crash occurs immediately after "Update callbacks set" when calling
-     * either g_onSettingsChanged or g_onConnectionSuccess.
+     * either onSettingsChanged or onConnectionSuccess.
      * 
      * TODO: Debug TSFN implementation or callback parameters.
      */
@@ -519,8 +735,10 @@ static void harmonyos_post_disconnect(freerdp* instance) {
              (unsigned int)errorCode, errorString ? errorString : "NULL");
     }
     
-    if (g_onDisconnecting) {
-        g_onDisconnecting((int64_t)(uintptr_t)instance);
+    if (instance && instance->context) {
+        const harmonyosCallbacks callbacks = session_callbacks(instance->context);
+        if (callbacks.onDisconnecting)
+            callbacks.onDisconnecting((int64_t)(uintptr_t)instance);
     }
     gdi_free(instance);
     
@@ -529,8 +747,12 @@ static void harmonyos_post_disconnect(freerdp* instance) {
 
 /* Authentication callback */
 static BOOL harmonyos_authenticate(freerdp* instance, char** username, char** password, char** domain) {
-    if (g_onAuthenticate) {
-        return g_onAuthenticate((int64_t)(uintptr_t)instance, username, domain, password);
+    if (!instance || !instance->context)
+        return FALSE;
+
+    const harmonyosCallbacks callbacks = session_callbacks(instance->context);
+    if (callbacks.onAuthenticate) {
+        return callbacks.onAuthenticate((int64_t)(uintptr_t)instance, username, domain, password);
     }
     return FALSE;
 }
@@ -548,9 +770,11 @@ static DWORD harmonyos_verify_certificate_ex(freerdp* instance, const char* host
     LOGD("\tIssuer: %s", issuer);
     LOGD("\tThumbprint: %s", fingerprint);
 
-    if (g_onVerifyCertificate) {
-        return g_onVerifyCertificate((int64_t)(uintptr_t)instance, host, port,
-                                     common_name, subject, issuer, fingerprint, flags);
+    const harmonyosCallbacks callbacks =
+        (instance && instance->context) ? session_callbacks(instance->context) : harmonyosCallbacks{};
+    if (callbacks.onVerifyCertificate) {
+        return callbacks.onVerifyCertificate((int64_t)(uintptr_t)instance, host, port,
+                                             common_name, subject, issuer, fingerprint, flags);
     }
     
     // Default: accept certificate
@@ -569,26 +793,181 @@ static DWORD harmonyos_verify_changed_certificate_ex(freerdp* instance, const ch
                                            issuer, new_fingerprint, flags);
 }
 
-/* Background mode state tracking */
-static volatile BOOL g_isInBackgroundMode = FALSE;
-static volatile UINT64 g_lastNetworkActivityTime = 0;
+/* Background mode state tracking, the state itself is per session in harmonyosContext */
 static const DWORD BACKGROUND_KEEPALIVE_INTERVAL_MS = 30000; /* 30 seconds */
 static const DWORD NETWORK_TIMEOUT_MS = 60000; /* 60 seconds without activity = timeout */
 
 /* Update network activity timestamp */
-static void update_network_activity(void) {
-    g_lastNetworkActivityTime = GetTickCount64();
+static void update_network_activity(harmonyosContext* afc) {
+    afc->lastNetworkActivityTime = GetTickCount64();
 }
 
 /* Check if network is still alive based on activity */
-static BOOL is_network_alive(void) {
-    if (g_lastNetworkActivityTime == 0)
+static BOOL is_network_alive(const harmonyosContext* afc) {
+    if (afc->lastNetworkActivityTime == 0)
         return TRUE; /* Not initialized yet */
     
-    UINT64 elapsed = GetTickCount64() - g_lastNetworkActivityTime;
+    UINT64 elapsed = GetTickCount64() - afc->lastNetworkActivityTime;
     return elapsed < NETWORK_TIMEOUT_MS;
 }
 
+/* Send the refresh requests the resume scheduler has due, returns how long it may wait */
+static DWORD harmonyos_resume_dispatch(rdpContext* context, harmonyosContext* afc) {
+    RECTANGLE_16 areas[255];
+    DWORD timeout = INFINITE;
+    UINT32 nareas;
+
+    while ((nareas = harmonyos_resume_next(afc->resume, areas, ARRAYSIZE(areas), &timeout)) > 0) {
+        if (!context->update || !context->update->RefreshRect ||
+            !context->update->RefreshRect(context, (BYTE)nareas, areas)) {
+            LOGW("Resume RefreshRect failed (%u areas)", nareas);
+            break;
+        }
+        LOGD("Resume RefreshRect sent (%u areas)", nareas);
+    }
+    return timeout;
+}
+
+/* Audio quality mode of the rdpsnd channel, read when the channels are loaded on connect */
+static bool harmonyos_set_audio_quality(rdpSettings* settings, UINT16 mode) {
+    char value[8] = { 0 };
+    (void)_snprintf(value, sizeof(value), "%u", (unsigned)mode);
+
+    const char* const params[] = { RDPSND_CHANNEL_NAME };
+    if (!freerdp_client_add_static_channel(settings, ARRAYSIZE(params), params))
+        return false;
+
+    ADDIN_ARGV* args = freerdp_static_channel_collection_find(settings, RDPSND_CHANNEL_NAME);
+    if (!args || (freerdp_addin_set_argument_value(args, "quality", value) < 0))
+        return false;
+
+    args = freerdp_dynamic_channel_collection_find(settings, RDPSND_CHANNEL_NAME);
+    return !args || (freerdp_addin_set_argument_value(args, "quality", value) >= 0);
+}
+
+void harmonyos_get_view(harmonyosContext* afc, RECTANGLE_16* viewport, INT32* focusX, INT32* focusY) {
+    EnterCriticalSection(&afc->viewLock);
+    if (viewport)
+        *viewport = afc->viewport;
+    if (focusX)
+        *focusX = afc->focusX;
+    if (focusY)
+        *focusY = afc->focusY;
+    LeaveCriticalSection(&afc->viewLock);
+}
+
+/* The resume refresh starts around the last touch */
+static void harmonyos_set_focus(harmonyosContext* afc, INT32 x, INT32 y) {
+    EnterCriticalSection(&afc->viewLock);
+    afc->focusX = x;
+    afc->focusY = y;
+    LeaveCriticalSection(&afc->viewLock);
+}
+
+/* Limit the server to the viewport while the link is poor, the whole desktop otherwise */
+static void harmonyos_update_output_area(rdpContext* context, harmonyosContext* afc,
+                                         HARMONYOS_QUALITY_LEVEL level) {
+    rdpGdi* gdi = context->gdi;
+    rdpUpdate* update = context->update;
+    if (!gdi || !gdi->primary || !update || !update->SuppressOutput)
+        return;
+
+    const RECTANGLE_16 desktop = { 0, 0, (UINT16)gdi->width, (UINT16)gdi->height };
+    RECTANGLE_16 viewport;
+    INT32 focusX = 0;
+    INT32 focusY = 0;
+    harmonyos_get_view(afc, &viewport, &focusX, &focusY);
+    const bool partial = (viewport.right > viewport.left) && (viewport.bottom > viewport.top) &&
+                         ((viewport.left > 0) || (viewport.top > 0) ||
+                          (viewport.right < desktop.right) || (viewport.bottom < desktop.bottom));
+    const bool limited = (level == HARMONYOS_QUALITY_POOR) && partial;
+    const RECTANGLE_16 area = limited ? viewport : desktop;
+
+    if ((limited == (afc->outputRestricted != FALSE)) &&
+        (!limited || (memcmp(&area, &afc->outputArea, sizeof(area)) == 0)))
+        return;
+
+    if (!update->SuppressOutput(context, TRUE, &area)) {
+        LOGW("Quality SuppressOutput failed");
+        return;
+    }
+
+    const bool wasRestricted = afc->outputRestricted;
+    afc->outputRestricted = limited;
+    afc->outputArea = area;
+    LOGI("Server output limited to %d,%d-%d,%d", area.left, area.top, area.right, area.bottom);
+
+    if (!wasRestricted)
+        return;
+
+    /* What was hidden is stale, refresh it viewport first */
+    if (!limited) {
+        if (!harmonyos_resume_begin(afc->resume, gdi, &viewport, focusX, focusY))
+            LOGW("Quality refresh not started");
+    } else if (update->RefreshRect) {
+        const RECTANGLE_16 refresh = { area.left, area.top, (UINT16)(area.right - 1),
+                                       (UINT16)(area.bottom - 1) };
+        if (!update->RefreshRect(context, 1, &refresh))
+            LOGW("Quality RefreshRect failed");
+    }
+}
+
+/* Apply a level change of the quality controller on the session thread */
+static void harmonyos_quality_dispatch(rdpContext* context, harmonyosContext* afc) {
+    HARMONYOS_QUALITY_LEVEL level = HARMONYOS_QUALITY_GOOD;
+
+    if (harmonyos_quality_poll(afc->quality, &level) &&
+        freerdp_settings_get_bool(context->settings, FreeRDP_AudioPlayback)) {
+        /* The loaded channel keeps its mode, getNetworkQuality reports it as requested */
+        static const UINT16 modes[] = { HIGH_QUALITY, DYNAMIC_QUALITY, MEDIUM_QUALITY };
+        if (harmonyos_set_audio_quality(context->settings, modes[level])) {
+            harmonyos_quality_request_audio(afc->quality, modes[level]);
+            LOGI("Audio quality mode %u requested for the next connect", modes[level]);
+        } else {
+            LOGW("Failed to set audio quality mode %u", modes[level]);
+        }
+    }
+
+    harmonyos_update_output_area(context, afc, level);
+}
+
+/* Retry interval for gesture events the session failed to send */
+#define GESTURE_RETRY_MS 50
+
+/* Send the mouse events of the gesture engine, returns how long the run loop may wait */
+static DWORD harmonyos_gesture_dispatch(rdpContext* context, harmonyosContext* afc) {
+    harmonyosMouseEvent* events = afc->gestureEvents;
+    DWORD timeout = 0;
+
+    /* Events left over from a failed send go first, nothing new is taken before them */
+    UINT32 count = afc->gestureUnsent;
+    if (count == 0)
+        count = harmonyos_gesture_next(afc->gesture, GetTickCount64(), events,
+                                       ARRAYSIZE(afc->gestureEvents), &timeout);
+
+    UINT32 sent = 0;
+    while (sent < count) {
+        if (!freerdp_input_send_mouse_event(context->input, events[sent].flags, events[sent].x,
+                                            events[sent].y)) {
+            LOGW("Gesture mouse event %04X not sent, %u kept", events[sent].flags,
+                 (unsigned int)(count - sent));
+            break;
+        }
+        sent++;
+    }
+
+    if (sent > 0)
+        harmonyos_set_focus(afc, events[sent - 1].x, events[sent - 1].y);
+
+    /* Keep the unsent tail in order, a lost button release would leave the button pressed */
+    afc->gestureUnsent = count - sent;
+    if (afc->gestureUnsent > 0) {
+        memmove(events, &events[sent], afc->gestureUnsent * sizeof(*events));
+        return GESTURE_RETRY_MS;
+    }
+    return timeout;
+}
+
 /* Main run loop with background mode support */
 static int harmonyos_freerdp_run(freerdp* instance) {
     DWORD count;
@@ -596,18 +975,32 @@ static int harmonyos_freerdp_run(freerdp* instance) {
     HANDLE handles[MAXIMUM_WAIT_OBJECTS];
     HANDLE inputEvent = NULL;
     rdpContext* context = instance->context;
+    harmonyosContext* afc = (harmonyosContext*)context;
+    HANDLE resumeEvent = harmonyos_resume_get_event(afc->resume);
+    HANDLE qualityEvent = harmonyos_quality_get_event(afc->quality);
+    HANDLE gestureEvent = harmonyos_gesture_get_event(afc->gesture);
+    DWORD resumeTimeout = INFINITE;
+    DWORD gestureTimeout = INFINITE;
     DWORD waitTimeout;
     DWORD consecutiveTimeouts = 0;
     const DWORD MAX_CONSECUTIVE_TIMEOUTS = 10;
 
     inputEvent = harmonyos_get_handle(instance);
-    update_network_activity(); /* Initialize activity timestamp */
+    update_network_activity(afc); /* Initialize activity timestamp */
 
     while (!freerdp_shall_disconnect_context(instance->context)) {
         DWORD tmp;
         count = 0;
 
         handles[count++] = inputEvent;
+        /* Refreshes are only scheduled while the server sends graphics */
+        if (resumeEvent && !afc->isInBackgroundMode)
+            handles[count++] = resumeEvent;
+        if (qualityEvent && !afc->isInBackgroundMode)
+            handles[count++] = qualityEvent;
+        /* Unsent gesture events are retried on the timeout, new ones wait behind them */
+        if (gestureEvent && (afc->gestureUnsent == 0))
+            handles[count++] = gestureEvent;
 
         tmp = freerdp_get_event_handles(context, &handles[count], 64 - count);
         if (tmp == 0) {
@@ -618,10 +1011,10 @@ static int harmonyos_freerdp_run(freerdp* instance) {
         count += tmp;
         
         /* In background mode, use timeout to periodically check connection health */
-        if (g_isInBackgroundMode) {
+        if (afc->isInBackgroundMode) {
             waitTimeout = BACKGROUND_KEEPALIVE_INTERVAL_MS;
         } else {
-            waitTimeout = INFINITE;
+            waitTimeout = MIN(resumeTimeout, gestureTimeout);
         }
         
         status = WaitForMultipleObjects(count, handles, FALSE, waitTimeout);
@@ -633,12 +1026,12 @@ static int harmonyos_freerdp_run(freerdp* instance) {
         
         if (status == WAIT_TIMEOUT) {
             /* Timeout in background mode - check connection health */
-            if (g_isInBackgroundMode) {
+            if (afc->isInBackgroundMode) {
                 consecutiveTimeouts++;
                 LOGD("Background keepalive check (%d/%d)", consecutiveTimeouts, MAX_CONSECUTIVE_TIMEOUTS);
                 
                 /* Check if network is still alive */
-                if (!is_network_alive()) {
+                if (!is_network_alive(afc)) {
                     LOGW("Network timeout detected in background mode");
                     break;
                 }
@@ -655,7 +1048,7 @@ static int harmonyos_freerdp_run(freerdp* instance) {
         } else {
             /* Reset timeout counter on activity */
             consecutiveTimeouts = 0;
-            update_network_activity();
+            update_network_activity(afc);
         }
 
         if (!freerdp_check_event_handles(context)) {
@@ -672,6 +1065,11 @@ static int harmonyos_freerdp_run(freerdp* instance) {
             status = GetLastError();
             break;
         }
+
+        gestureTimeout = harmonyos_gesture_dispatch(context, afc);
+        if (!afc->isInBackgroundMode)
+            harmonyos_quality_dispatch(context, afc);
+        resumeTimeout = afc->isInBackgroundMode ? INFINITE : harmonyos_resume_dispatch(context, afc);
     }
 
     LOGI("Prepare shutdown...");
@@ -838,13 +1236,16 @@ static DWORD WINAPI harmonyos_thread_func(LPVOID param) {
 fail:
     LOGD("Session ended with %08X", status);
 
-    if (status == CHANNEL_RC_OK || reconnectAttempts == 0) {
-        if (g_onDisconnected) {
-            g_onDisconnected((int64_t)(uintptr_t)instance);
-        }
-    } else {
-        if (g_onConnectionFailure) {
-            g_onConnectionFailure((int64_t)(uintptr_t)instance);
+    if (context) {
+        const harmonyosCallbacks callbacks = session_callbacks(context);
+        if (status == CHANNEL_RC_OK || reconnectAttempts == 0) {
+            if (callbacks.onDisconnected) {
+                callbacks.onDisconnected((int64_t)(uintptr_t)instance);
+            }
+        } else {
+            if (callbacks.onConnectionFailure) {
+                callbacks.onConnectionFailure((int64_t)(uintptr_t)instance);
+            }
         }
     }
 
@@ -870,6 +1271,62 @@ static BOOL harmonyos_client_new(freerdp* instance, rdpContext* context) {
         return FALSE;
     }
 
+    harmonyosContext* afc = (harmonyosContext*)context;
+    afc->cursors = harmonyos_cursor_atlas_new();
+    if (!afc->cursors) {
+        LOGE("harmonyos_client_new: cursor atlas allocation failed");
+        harmonyos_event_queue_uninit(instance);
+        return FALSE;
+    }
+
+    afc->resume = harmonyos_resume_new();
+    if (!afc->resume) {
+        LOGE("harmonyos_client_new: resume scheduler allocation failed");
+        harmonyos_cursor_atlas_free(afc->cursors);
+        afc->cursors = nullptr;
+        harmonyos_event_queue_uninit(instance);
+        return FALSE;
+    }
+
+    afc->quality = harmonyos_quality_new();
+    if (!afc->quality) {
+        LOGE("harmonyos_client_new: quality controller allocation failed");
+        harmonyos_resume_free(afc->resume);
+        afc->resume = nullptr;
+        harmonyos_cursor_atlas_free(afc->cursors);
+        afc->cursors = nullptr;
+        harmonyos_event_queue_uninit(instance);
+        return FALSE;
+    }
+
+    afc->gesture = harmonyos_gesture_new();
+    if (!afc->gesture) {
+        LOGE("harmonyos_client_new: gesture engine allocation failed");
+        harmonyos_quality_free(afc->quality);
+        afc->quality = nullptr;
+        harmonyos_resume_free(afc->resume);
+        afc->resume = nullptr;
+        harmonyos_cursor_atlas_free(afc->cursors);
+        afc->cursors = nullptr;
+        harmonyos_event_queue_uninit(instance);
+        return FALSE;
+    }
+
+    InitializeCriticalSection(&afc->bufferLock);
+    InitializeCriticalSection(&afc->viewLock);
+
+    /* Codecs of this session submit to the shared decode pool */
+    InitializeThreadpoolEnvironment(&afc->decodeEnv);
+    PTP_POOL pool = get_decode_pool();
+    if (pool) {
+        SetThreadpoolCallbackPool(&afc->decodeEnv, pool);
+        if (!freerdp_settings_set_pointer(context->settings, FreeRDP_CodecCallbackEnvironment,
+                                          &afc->decodeEnv)) {
+            LOGW("harmonyos_client_new: codecs keep their own workers");
+        }
+    }
+    register_session(afc);
+
     instance->PreConnect = harmonyos_pre_connect;
     instance->PostConnect = harmonyos_post_connect;
     instance->PostDisconnect = harmonyos_post_disconnect;
@@ -886,6 +1343,23 @@ static void harmonyos_client_free(freerdp* instance, rdpContext* context) {
         return;
 
     harmonyos_event_queue_uninit(instance);
+
+    harmonyosContext* afc = (harmonyosContext*)context;
+    unregister_session(afc);
+    harmonyos_cursor_atlas_free(afc->cursors);
+    afc->cursors = nullptr;
+    harmonyos_resume_free(afc->resume);
+    afc->resume = nullptr;
+    harmonyos_quality_free(afc->quality);
+    afc->quality = nullptr;
+    harmonyos_gesture_free(afc->gesture);
+    afc->gesture = nullptr;
+
+    /* Decoding stopped with the session thread, the codecs freed later no longer submit */
+    freerdp_settings_set_pointer(context->settings, FreeRDP_CodecCallbackEnvironment, nullptr);
+    DestroyThreadpoolEnvironment(&afc->decodeEnv);
+    DeleteCriticalSection(&afc->bufferLock);
+    DeleteCriticalSection(&afc->viewLock);
 }
 
 static int RdpClientEntry(RDP_CLIENT_ENTRY_POINTS* pEntryPoints) {
@@ -914,6 +1388,31 @@ static int RdpClientEntry(RDP_CLIENT_ENTRY_POINTS* pEntryPoints) {
 /* 全局 SSL 初始化标志 */
 static BOOL g_sslInitialized = FALSE;
 
+/* Files directory of the app sandbox (context.filesDir), the persistent caches live there */
+static std::mutex g_filesDirMutex;
+static std::string g_filesDir;
+
+bool freerdp_harmonyos_set_files_dir(const char* dir) {
+    if (!dir || !*dir) {
+        LOGE("set_files_dir: Invalid directory");
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(g_filesDirMutex);
+    g_filesDir = dir;
+    return true;
+}
+
+/* Path of a file in the files directory, false until ArkTS set the directory */
+static bool harmonyos_files_path(const char* name, char* path, size_t size) {
+    std::lock_guard<std::mutex> lock(g_filesDirMutex);
+    if (g_filesDir.empty())
+        return false;
+
+    const int rc = snprintf(path, size, "%s/%s", g_filesDir.c_str(), name);
+    return (rc > 0) && ((size_t)rc < size);
+}
+
 int64_t freerdp_harmonyos_new(void) {
     RDP_CLIENT_ENTRY_POINTS clientEntryPoints;
     rdpContext* ctx;
@@ -933,6 +1432,13 @@ int64_t freerdp_harmonyos_new(void) {
         unsetenv("OPENSSL_MODULES");
         unsetenv("OPENSSL_CONF");
         unsetenv("OPENSSL_ENGINES");
+
+        /* 原语选择结果缓存在沙箱中，之后启动不再重复基准测试 */
+        char profile[MAX_PATH] = { 0 };
+        if (harmonyos_files_path("primitives.profile", profile, sizeof(profile)))
+            primitives_set_profile_path(profile);
+        else
+            LOGW("freerdp_harmonyos_new: files directory not set, primitives profile not cached");
         
         /* 使用 winpr 的 SSL 初始化函数 */
         if (winpr_InitializeSSL(WINPR_SSL_INIT_DEFAULT)) {
@@ -960,13 +1466,6 @@ void freerdp_harmonyos_free(int64_t instance) {
         return;
     }
 
-    /* 置空全局缓冲区关联 */
-    {
-        std::lock_guard<std::mutex> lock(g_external_buffer_mutex);
-        g_external_buffer = nullptr;
-        g_external_buffer_size = 0;
-    }
-
     if (inst->context) {
         LOGI("freerdp_harmonyos_free: freeing client context and instance");
         /* 
@@ -1036,6 +1535,8 @@ bool freerdp_harmonyos_parse_arguments(int64_t instance, const char** args, int
     freerdp_settings_set_bool(inst->context->settings, FreeRDP_AudioPlayback, TRUE);
     freerdp_settings_set_bool(inst->context->settings, FreeRDP_CompressionEnabled, TRUE);
     freerdp_settings_set_bool(inst->context->settings, FreeRDP_FastPathOutput, TRUE);
+    /* 网络特性自动检测，服务器测得的 RTT 与带宽驱动自适应质量 */
+    freerdp_settings_set_bool(inst->context->settings, FreeRDP_NetworkAutoDetect, TRUE);
     
     /* 
      * 针对连接 0x0002000D 错误的修复：
@@ -1057,7 +1558,26 @@ bool freerdp_harmonyos_parse_arguments(int64_t instance, const char** args, int
     freerdp_settings_set_bool(inst->context->settings, FreeRDP_SupportGraphicsPipeline, TRUE);
     freerdp_settings_set_bool(inst->context->settings, FreeRDP_SupportDynamicChannels, TRUE);
     freerdp_settings_set_string(inst->context->settings, FreeRDP_ConfigPath, ".");
-    
+
+    /* TLS 会话缓存保存在应用沙箱中，断线重连时可恢复会话，省去完整握手 */
+    char path[MAX_PATH] = { 0 };
+    freerdp_settings_set_bool(inst->context->settings, FreeRDP_TlsSessionResumption, TRUE);
+    if (harmonyos_files_path("tls_sessions", path, sizeof(path)))
+        freerdp_settings_set_string(inst->context->settings, FreeRDP_TlsSessionCacheFile, path);
+    else
+        LOGW("parse_arguments: files directory not set, TLS sessions are kept in memory only");
+
+    /* 位图缓存持久化到沙箱，重连时把上次的缓存键发给服务器，断开时按使用频率写回（上限 16 MiB） */
+    freerdp_settings_set_uint32(inst->context->settings, FreeRDP_BitmapCacheVersion, 2);
+    if (harmonyos_files_path("bitmap_cache.bmc", path, sizeof(path))) {
+        freerdp_settings_set_bool(inst->context->settings, FreeRDP_BitmapCachePersistEnabled, TRUE);
+        freerdp_settings_set_string(inst->context->settings, FreeRDP_BitmapCachePersistFile, path);
+    } else {
+        LOGW("parse_arguments: files directory not set, bitmap cache is not persisted");
+    }
+    freerdp_settings_set_uint32(inst->context->settings, FreeRDP_BitmapCachePersistMaxSize,
+                                16 * 1024 * 1024);
+
     LOGI("parse_arguments: Security protocols set - RDP|TLS|NLA, IgnoreCertificate=TRUE");
     
     LOGI("parse_arguments: Calling freerdp_client_settings_parse_command_line...");
@@ -1141,6 +1661,8 @@ bool freerdp_harmonyos_send_cursor_event(int64_t instance, int x, int y, int fla
         return false;
     }
 
+    harmonyos_set_focus((harmonyosContext*)inst->context, x, y);
+
     event = (HARMONYOS_EVENT*)harmonyos_event_cursor_new(flags, x, y);
     if (!event)
         return false;
@@ -1153,6 +1675,23 @@ bool freerdp_harmonyos_send_cursor_event(int64_t instance, int x, int y, int fla
     return true;
 }
 
+/* Touches of one input frame go to the gesture engine, the session thread sends the result */
+int freerdp_harmonyos_send_touch_batch(int64_t instance, const harmonyosViewTransform* view,
+                                       const double* samples, size_t count) {
+    freerdp* inst = (freerdp*)(uintptr_t)instance;
+
+    if (!inst || !inst->context || !view) {
+        LOGE("Invalid instance");
+        return HARMONYOS_GESTURE_NONE;
+    }
+
+    harmonyosContext* afc = (harmonyosContext*)inst->context;
+    harmonyosViewTransform transform = *view;
+    transform.width = freerdp_settings_get_uint32(inst->context->settings, FreeRDP_DesktopWidth);
+    transform.height = freerdp_settings_get_uint32(inst->context->settings, FreeRDP_DesktopHeight);
+    return harmonyos_gesture_feed(afc->gesture, samples, count, &transform, GetTickCount64());
+}
+
 bool freerdp_harmonyos_send_key_event(int64_t instance, int keycode, bool down) {
     freerdp* inst = (freerdp*)(uintptr_t)instance;
     HARMONYOS_EVENT* event;
@@ -1358,8 +1897,45 @@ bool freerdp_harmonyos_is_connected(int64_t instance) {
     return !freerdp_shall_disconnect_context(inst->context);
 }
 
+bool freerdp_harmonyos_set_active_session(int64_t instance) {
+    freerdp* inst = (freerdp*)(uintptr_t)instance;
+    harmonyosContext* afc = nullptr;
+
+    /* The handle may be stale, only registered sessions are dereferenced */
+    std::lock_guard<std::mutex> lock(g_sessionsMutex);
+    if (inst) {
+        for (harmonyosContext* session : g_sessions) {
+            if (session->common.context.instance == inst) {
+                afc = session;
+                break;
+            }
+        }
+        if (!afc) {
+            LOGE("set_active_session: Invalid instance");
+            return false;
+        }
+    }
+
+    g_activeSession = afc;
+    update_decode_priorities();
+    LOGI("Active session: %p of %zu", (void*)inst, g_sessions.size());
+    return true;
+}
+
 /* ==================== Background Mode & Audio Priority ==================== */
 
+static bool push_resume_event(freerdp* inst) {
+    HARMONYOS_EVENT* event = (HARMONYOS_EVENT*)harmonyos_event_resume_new();
+    if (!event)
+        return false;
+
+    if (!harmonyos_push_event(inst, event)) {
+        harmonyos_event_free(event);
+        return false;
+    }
+    return true;
+}
+
 bool freerdp_harmonyos_enter_background_mode(int64_t instance) {
     freerdp* inst = (freerdp*)(uintptr_t)instance;
     
@@ -1379,12 +1955,24 @@ bool freerdp_harmonyos_enter_background_mode(int64_t instance) {
     
     LOGI("Entering background mode - audio only");
     
-    /* Set background mode flag for run loop */
-    g_isInBackgroundMode = TRUE;
+    /* Set background mode flag for run loop, its decoding drops to low priority */
+    harmonyosContext* afc = (harmonyosContext*)context;
+    {
+        std::lock_guard<std::mutex> lock(g_sessionsMutex);
+        afc->isInBackgroundMode = TRUE;
+        update_decode_priorities();
+    }
     
     /* Disable graphics decoding to save CPU/bandwidth */
     freerdp_settings_set_bool(settings, FreeRDP_DeactivateClientDecoding, TRUE);
     
+    /* Remember the kept frame and save the gfx cache on the session thread */
+    HARMONYOS_EVENT* event = (HARMONYOS_EVENT*)harmonyos_event_suspend_new();
+    if (event && !harmonyos_push_event(inst, event)) {
+        harmonyos_event_free(event);
+        LOGW("Suspend event not queued");
+    }
+    
     /* Send SuppressOutput PDU to tell server to stop sending graphics */
     RECTANGLE_16 rect = { 0, 0, 0, 0 };
     rect.left = 0;
@@ -1420,10 +2008,15 @@ bool freerdp_harmonyos_exit_background_mode(int64_t instance) {
         return false;
     }
     
-    LOGI("Exiting background mode - resuming graphics with full refresh");
+    LOGI("Exiting background mode - resuming graphics");
     
     /* Clear background mode flag FIRST */
-    g_isInBackgroundMode = FALSE;
+    harmonyosContext* afc = (harmonyosContext*)context;
+    {
+        std::lock_guard<std::mutex> lock(g_sessionsMutex);
+        afc->isInBackgroundMode = FALSE;
+        update_decode_priorities();
+    }
     
     /* Re-enable graphics decoding */
     freerdp_settings_set_bool(settings, FreeRDP_DeactivateClientDecoding, FALSE);
@@ -1444,58 +2037,31 @@ bool freerdp_harmonyos_exit_background_mode(int64_t instance) {
         if (!update->SuppressOutput(context, TRUE, &rect)) {
             LOGW("SuppressOutput resume PDU failed");
         }
+        /* The quality controller limits the output again from here if the link is still poor */
+        afc->outputRestricted = FALSE;
     }
     
-    /* Step 2: Request full screen refresh using RefreshRect PDU */
-    if (update->RefreshRect) {
-        /* RefreshRect tells the server to re-send the specified area */
-        if (!update->RefreshRect(context, 1, &rect)) {
-            LOGW("RefreshRect PDU failed");
-        } else {
-            LOGI("RefreshRect sent for full screen (%ux%u)", width, height);
-        }
-    } else {
-        LOGW("RefreshRect callback not available");
-    }
-    
-    /* Step 3: Mark entire GDI surface as invalid to force redraw */
-    rdpGdi* gdi = context->gdi;
-    if (gdi && gdi->primary && gdi->primary->hdc && gdi->primary->hdc->hwnd) {
-        HGDI_WND hwnd = gdi->primary->hdc->hwnd;
-        
-        /* Create a full-screen invalid region */
-        GDI_RGN invalidRegion;
-        invalidRegion.x = 0;
-        invalidRegion.y = 0;
-        invalidRegion.w = (INT32)width;
-        invalidRegion.h = (INT32)height;
-        
-        /* Add to invalid regions - this will trigger redraw on next update cycle */
-        if (hwnd->invalid) {
-            hwnd->invalid->null = FALSE;
-            hwnd->invalid->x = 0;
-            hwnd->invalid->y = 0;
-            hwnd->invalid->w = (INT32)width;
-            hwnd->invalid->h = (INT32)height;
-        }
-        
-        /* Also expand cinvalid array if needed */
-        if (hwnd->cinvalid && hwnd->count > 0) {
-            hwnd->cinvalid[0] = invalidRegion;
-            hwnd->ninvalid = 1;
-        }
-        
-        LOGI("GDI surface marked as invalid for full redraw");
-    }
-    
-    /* Step 4: Notify application that graphics update is coming */
-    if (g_onGraphicsUpdate) {
-        /* Trigger an immediate update callback for the full screen */
-        g_onGraphicsUpdate((int64_t)(uintptr_t)inst, 0, 0, (int)width, (int)height);
+    /*
+     * Step 2: Refresh the kept frame viewport first instead of one full screen RefreshRect.
+     * The session thread requests the tiles around the touch focus, then the rest of the
+     * viewport, and only trickles in the remainder if the viewport actually changed.
+     */
+    if (!push_resume_event(inst))
+        LOGW("Resume event not queued");
+
+    /* Step 3: Show the kept frame of the visible area right away */
+    const harmonyosCallbacks callbacks = session_callbacks(&afc->common.context);
+    if (callbacks.onGraphicsUpdate) {
+        RECTANGLE_16 visible;
+        harmonyos_get_view(afc, &visible, nullptr, nullptr);
+        if ((visible.right <= visible.left) || (visible.bottom <= visible.top))
+            visible = rect;
+        callbacks.onGraphicsUpdate((int64_t)(uintptr_t)inst, visible.left, visible.top,
+                                   visible.right - visible.left, visible.bottom - visible.top);
         LOGI("Graphics update callback triggered");
     }
     
-    LOGI("Background mode exited - full screen refresh requested");
+    LOGI("Background mode exited - viewport refresh scheduled");
     return true;
 }
 
@@ -1544,6 +2110,15 @@ bool freerdp_harmonyos_configure_audio(int64_t instance, bool playback, bool cap
             break;
     }
     
+    /* The modes match the rdpsnd quality values, the quality controller changes it later */
+    if (playback && (quality >= DYNAMIC_QUALITY) && (quality <= HIGH_QUALITY)) {
+        if (harmonyos_set_audio_quality(settings, (UINT16)quality))
+            harmonyos_quality_request_audio(((harmonyosContext*)inst->context)->quality,
+                                            (UINT16)quality);
+        else
+            LOGW("Audio quality mode not applied to the rdpsnd channel");
+    }
+    
     return true;
 }
 
@@ -1594,6 +2169,26 @@ int freerdp_harmonyos_get_connection_health(int64_t instance) {
     return 2; /* Healthy */
 }
 
+/* Bitmap cache statistics, the saved counters are filled in once the disconnect flush finished */
+bool freerdp_harmonyos_get_bitmap_cache_stats(int64_t instance, rdpBitmapCacheStats* stats) {
+    freerdp* inst = (freerdp*)(uintptr_t)instance;
+
+    if (!inst || !inst->context || !stats)
+        return false;
+
+    return freerdp_get_bitmap_cache_stats(inst->context, stats);
+}
+
+/* Measurements and level of the adaptive quality controller */
+bool freerdp_harmonyos_get_network_quality(int64_t instance, harmonyosQualityStats* stats) {
+    freerdp* inst = (freerdp*)(uintptr_t)instance;
+
+    if (!inst || !inst->context || !stats)
+        return false;
+
+    return harmonyos_quality_get_stats(((harmonyosContext*)inst->context)->quality, stats);
+}
+
 /* Force immediate full screen refresh - use after unlock/foreground */
 bool freerdp_harmonyos_request_refresh(int64_t instance) {
     freerdp* inst = (freerdp*)(uintptr_t)instance;
@@ -1616,7 +2211,7 @@ bool freerdp_harmonyos_request_refresh(int64_t instance) {
     UINT32 width = freerdp_settings_get_uint32(settings, FreeRDP_DesktopWidth);
     UINT32 height = freerdp_settings_get_uint32(settings, FreeRDP_DesktopHeight);
     
-    LOGI("Requesting full screen refresh (%ux%u)", width, height);
+    LOGI("Requesting screen refresh (%ux%u)", width, height);
     
     RECTANGLE_16 rect = { 0, 0, 0, 0 };
     rect.left = 0;
@@ -1624,36 +2219,15 @@ bool freerdp_harmonyos_request_refresh(int64_t instance) {
     rect.right = (UINT16)width;
     rect.bottom = (UINT16)height;
     
-    bool success = true;
+    /* Method 1: Viewport first tile refresh, scheduled on the session thread */
+    bool success = push_resume_event(inst);
+    if (!success)
+        LOGW("Resume event not queued");
     
-    /* Method 1: RefreshRect PDU - asks server to re-send the area */
-    if (update->RefreshRect) {
-        if (!update->RefreshRect(context, 1, &rect)) {
-            LOGW("RefreshRect PDU failed");
-            success = false;
-        } else {
-            LOGI("RefreshRect PDU sent");
-        }
-    }
-    
-    /* Method 2: Mark GDI as invalid */
-    rdpGdi* gdi = context->gdi;
-    if (gdi && gdi->primary && gdi->primary->hdc && gdi->primary->hdc->hwnd) {
-        HGDI_WND hwnd = gdi->primary->hdc->hwnd;
-        
-        if (hwnd->invalid) {
-            hwnd->invalid->null = FALSE;
-            hwnd->invalid->x = 0;
-            hwnd->invalid->y = 0;
-            hwnd->invalid->w = (INT32)width;
-            hwnd->invalid->h = (INT32)height;
-            LOGI("GDI invalid region set");
-        }
-    }
-    
-    /* Method 3: Trigger immediate callback with current buffer */
-    if (g_onGraphicsUpdate) {
-        g_onGraphicsUpdate((int64_t)(uintptr_t)inst, 0, 0, (int)width, (int)height);
+    /* Method 2: Trigger immediate callback with current buffer */
+    const harmonyosCallbacks callbacks = session_callbacks(context);
+    if (callbacks.onGraphicsUpdate) {
+        callbacks.onGraphicsUpdate((int64_t)(uintptr_t)inst, 0, 0, (int)width, (int)height);
         LOGI("Graphics update callback triggered");
     }
     
@@ -1694,6 +2268,43 @@ bool freerdp_harmonyos_request_refresh_rect(int64_t instance, int x, int y, int
     return true;
 }
 
+/* Track the visible part of the desktop for the resume refresh */
+bool freerdp_harmonyos_set_viewport(int64_t instance, int x, int y, int width, int height) {
+    freerdp* inst = (freerdp*)(uintptr_t)instance;
+    
+    if (!inst || !inst->context) {
+        LOGE("set_viewport: Invalid instance");
+        return false;
+    }
+    
+    harmonyosContext* afc = (harmonyosContext*)inst->context;
+    RECTANGLE_16 rect = { 0, 0, 0, 0 };
+    if ((width > 0) && (height > 0)) {
+        rect.left = (UINT16)MAX(x, 0);
+        rect.top = (UINT16)MAX(y, 0);
+        rect.right = (UINT16)MIN(MAX(x + width, 0), UINT16_MAX);
+        rect.bottom = (UINT16)MIN(MAX(y + height, 0), UINT16_MAX);
+    }
+    
+    EnterCriticalSection(&afc->viewLock);
+    afc->viewport = rect;
+    LeaveCriticalSection(&afc->viewLock);
+    harmonyos_resume_set_viewport(afc->resume, &rect);
+    
+    /* The gdi viewport belongs to the session thread, it decodes what scrolled into view */
+    HARMONYOS_EVENT* event = (HARMONYOS_EVENT*)harmonyos_event_viewport_new(&rect);
+    if (!event)
+        return false;
+    
+    if (!harmonyos_push_event(inst, event)) {
+        harmonyos_event_free(event);
+        return false;
+    }
+    
+    LOGD("set_viewport: (%d,%d,%d,%d)", x, y, width, height);
+    return true;
+}
+
 /* Get the current frame buffer for immediate display */
 bool freerdp_harmonyos_get_frame_buffer(int64_t instance, uint8_t** buffer, 
                                          int* width, int* height, int* stride) {
@@ -1723,8 +2334,11 @@ bool freerdp_harmonyos_get_frame_buffer(int64_t instance, uint8_t** buffer,
 
 /* Check if currently in background mode */
 bool freerdp_harmonyos_is_in_background_mode(int64_t instance) {
-    WINPR_UNUSED(instance);
-    return g_isInBackgroundMode ? true : false;
+    freerdp* inst = (freerdp*)(uintptr_t)instance;
+    if (!inst || !inst->context)
+        return false;
+
+    return ((harmonyosContext*)inst->context)->isInBackgroundMode ? true : false;
 }
 
 /* Send a keepalive/heartbeat to maintain connection in background */
@@ -1750,19 +2364,22 @@ bool freerdp_harmonyos_send_keepalive(int64_t instance) {
         return false;
     }
     
-    update_network_activity();
+    update_network_activity((harmonyosContext*)context);
     LOGD("Keepalive sent");
     return true;
 }
 
 /* Get time since last network activity in milliseconds */
 uint64_t freerdp_harmonyos_get_idle_time(int64_t instance) {
-    WINPR_UNUSED(instance);
+    freerdp* inst = (freerdp*)(uintptr_t)instance;
+    if (!inst || !inst->context)
+        return 0;
     
-    if (g_lastNetworkActivityTime == 0)
+    const harmonyosContext* afc = (const harmonyosContext*)inst->context;
+    if (afc->lastNetworkActivityTime == 0)
         return 0;
     
-    return GetTickCount64() - g_lastNetworkActivityTime;
+    return GetTickCount64() - afc->lastNetworkActivityTime;
 }
 
 /* Force check connection health and return detailed status */
@@ -1773,13 +2390,14 @@ int freerdp_harmonyos_check_connection_status(int64_t instance) {
         return -1; /* Invalid instance */
     
     rdpContext* context = inst->context;
+    const harmonyosContext* afc = (const harmonyosContext*)context;
     
     /* Check if disconnect was requested */
     if (freerdp_shall_disconnect_context(context))
         return 0; /* Disconnecting */
     
     /* Check network activity */
-    if (!is_network_alive())
+    if (!is_network_alive(afc))
         return 1; /* Network timeout */
     
     /* Check if we can get event handles */
@@ -1790,7 +2408,7 @@ int freerdp_harmonyos_check_connection_status(int64_t instance) {
         return 2; /* Event handles failed */
     
     /* Check if in background mode */
-    if (g_isInBackgroundMode)
+    if (afc->isInBackgroundMode)
         return 10; /* Connected, background mode */
     
     return 100; /* Connected, foreground mode */
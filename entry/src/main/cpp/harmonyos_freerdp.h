@@ -38,15 +38,83 @@ extern "C" {
 #include <freerdp/utils/signal.h>
 
 #include <winpr/assert.h>
+#include <winpr/pool.h>
+#include <winpr/synch.h>
 #include <winpr/ssl.h>  /* For winpr_InitializeSSL */
 
-/* HarmonyOS context extension */
+/* Native cursor atlas, pointer updates with identical bitmaps share one entry */
+typedef struct harmonyos_cursor_atlas harmonyosCursorAtlas;
+
+/* Input event queue of a session, see harmonyos_event.c */
+typedef struct harmonyos_event_queue harmonyosEventQueue;
+
+/* Clipboard state of a session, see harmonyos_cliprdr.c */
+typedef struct harmonyos_clipboard harmonyosClipboard;
+
+/* Refresh scheduler after a suspend, see harmonyos_resume.c */
+typedef struct harmonyos_resume harmonyosResume;
+
+/* Adaptive quality controller, see harmonyos_quality.c */
+typedef struct harmonyos_quality harmonyosQuality;
+
+/* Network quality levels, ordered from best to worst */
+typedef enum {
+    HARMONYOS_QUALITY_GOOD = 0,
+    HARMONYOS_QUALITY_FAIR = 1,
+    HARMONYOS_QUALITY_POOR = 2
+} HARMONYOS_QUALITY_LEVEL;
+
+/* Smoothed measurements of the controller, 0 until measured */
 typedef struct {
-    rdpClientContext common;
-    HANDLE thread;
-    void* napi_env;
-    void* napi_callback_ref;
-} harmonyosContext;
+    HARMONYOS_QUALITY_LEVEL level;
+    UINT32 rtt;            /* ms, from the server's network characteristics */
+    UINT32 bandwidth;      /* kbit/s */
+    UINT32 frameTime;      /* ms from gfx StartFrame to decoded */
+    UINT32 frameInterval;  /* ms between decoded frames */
+    UINT32 queueDepth;     /* last frame acknowledge, 0 leaves the pacing to the server */
+    UINT16 audioQuality;   /* rdpsnd quality mode the channel was loaded with */
+    UINT16 audioRequested; /* mode for the current level, used from the next connect */
+} harmonyosQualityStats;
+
+/* Touch gesture engine, see harmonyos_gesture.c */
+typedef struct harmonyos_gesture harmonyosGesture;
+
+/* Touch actions of a sample, the values of ArkUI TouchType */
+#define HARMONYOS_TOUCH_DOWN   0
+#define HARMONYOS_TOUCH_UP     1
+#define HARMONYOS_TOUCH_MOVE   2
+#define HARMONYOS_TOUCH_CANCEL 3
+
+/* A touch sample is action, pointer id, x and y in view units */
+#define HARMONYOS_TOUCH_SAMPLE_SIZE 4
+
+/* What the touches on the view currently are */
+typedef enum {
+    HARMONYOS_GESTURE_NONE = 0,
+    HARMONYOS_GESTURE_PENDING = 1,    /* one finger down, tap or long press */
+    HARMONYOS_GESTURE_DRAG = 2,       /* left button held */
+    HARMONYOS_GESTURE_PRESSED = 3,    /* long press sent, waiting for release */
+    HARMONYOS_GESTURE_TWO_FINGER = 4, /* two fingers down, tap, scroll or pinch */
+    HARMONYOS_GESTURE_SCROLL = 5,
+    HARMONYOS_GESTURE_PINCH = 6,      /* left to the view, no input is sent */
+    HARMONYOS_GESTURE_DONE = 7        /* ended, waiting for the last finger */
+} HARMONYOS_GESTURE_STATE;
+
+/* Maps view units to the desktop, desktop = (view - offset) / scale */
+typedef struct {
+    double scale;
+    double offsetX;
+    double offsetY;
+    UINT32 width;
+    UINT32 height;
+} harmonyosViewTransform;
+
+/* A mouse or wheel event of the gesture engine, flags as in freerdp_input_send_mouse_event */
+typedef struct {
+    UINT16 flags;
+    UINT16 x;
+    UINT16 y;
+} harmonyosMouseEvent;
 
 /* Cursor type definitions */
 #define CURSOR_TYPE_UNKNOWN     0
@@ -66,7 +134,10 @@ typedef enum {
     HARMONYOS_EVENT_TYPE_UNICODEKEY,
     HARMONYOS_EVENT_TYPE_CURSOR,
     HARMONYOS_EVENT_TYPE_DISCONNECT,
-    HARMONYOS_EVENT_TYPE_CLIPBOARD
+    HARMONYOS_EVENT_TYPE_CLIPBOARD,
+    HARMONYOS_EVENT_TYPE_SUSPEND,
+    HARMONYOS_EVENT_TYPE_RESUME,
+    HARMONYOS_EVENT_TYPE_VIEWPORT
 } HARMONYOS_EVENT_TYPE;
 
 /* Base event structure */
@@ -108,6 +179,22 @@ typedef struct {
     size_t length;
 } HARMONYOS_EVENT_CLIPBOARD;
 
+/* Suspend event, the kept frame is snapshotted on the session thread */
+typedef struct {
+    HARMONYOS_EVENT_TYPE type;
+} HARMONYOS_EVENT_SUSPEND;
+
+/* Resume event, starts the viewport first refresh */
+typedef struct {
+    HARMONYOS_EVENT_TYPE type;
+} HARMONYOS_EVENT_RESUME;
+
+/* Viewport event, limits gfx output to the visible desktop area */
+typedef struct {
+    HARMONYOS_EVENT_TYPE type;
+    RECTANGLE_16 rect;
+} HARMONYOS_EVENT_VIEWPORT;
+
 /* Event queue functions */
 bool harmonyos_event_queue_init(freerdp* instance);
 void harmonyos_event_queue_uninit(freerdp* instance);
@@ -122,6 +209,76 @@ HARMONYOS_EVENT_UNICODEKEY* harmonyos_event_unicodekey_new(int flags, uint16_t c
 HARMONYOS_EVENT_CURSOR* harmonyos_event_cursor_new(int flags, int x, int y);
 HARMONYOS_EVENT_DISCONNECT* harmonyos_event_disconnect_new(void);
 HARMONYOS_EVENT_CLIPBOARD* harmonyos_event_clipboard_new(const char* data, size_t length);
+HARMONYOS_EVENT_SUSPEND* harmonyos_event_suspend_new(void);
+HARMONYOS_EVENT_RESUME* harmonyos_event_resume_new(void);
+HARMONYOS_EVENT_VIEWPORT* harmonyos_event_viewport_new(const RECTANGLE_16* rect);
+
+/* Cursor atlas functions */
+harmonyosCursorAtlas* harmonyos_cursor_atlas_new(void);
+void harmonyos_cursor_atlas_free(harmonyosCursorAtlas* atlas);
+/* Returns the atlas ID of the pointer bitmap and takes a reference, 0 on failure.
+ * *added is set if the bitmap was decoded, *evicted to the ID of an entry dropped for it. */
+uint32_t harmonyos_cursor_atlas_add(harmonyosCursorAtlas* atlas, rdpContext* context,
+                                    const rdpPointer* pointer, bool* added, uint32_t* evicted);
+void harmonyos_cursor_atlas_release(harmonyosCursorAtlas* atlas, uint32_t id);
+/* RGBA pixels of an atlas entry, NULL for an unknown ID */
+const uint8_t* harmonyos_cursor_atlas_get(harmonyosCursorAtlas* atlas, uint32_t id,
+                                          uint32_t* width, uint32_t* height);
+
+/* Resume scheduler functions */
+harmonyosResume* harmonyos_resume_new(void);
+void harmonyos_resume_free(harmonyosResume* resume);
+/* Signalled when harmonyos_resume_next has refresh areas to hand out */
+HANDLE harmonyos_resume_get_event(harmonyosResume* resume);
+/* Remember the kept frame when the session is suspended */
+bool harmonyos_resume_snapshot(harmonyosResume* resume, rdpGdi* gdi);
+/* Queue the frame for refresh, viewport tiles nearest the focus first.
+ * The viewport right/bottom are exclusive, an empty viewport is the whole desktop. */
+bool harmonyos_resume_begin(harmonyosResume* resume, rdpGdi* gdi, const RECTANGLE_16* viewport,
+                            INT32 focusX, INT32 focusY);
+/* Request deferred tiles that scrolled into the viewport */
+void harmonyos_resume_set_viewport(harmonyosResume* resume, const RECTANGLE_16* viewport);
+/* Inclusive RefreshRect areas of the next request, 0 if nothing is due.
+ * *timeout is how long the run loop may wait before calling again. */
+UINT32 harmonyos_resume_next(harmonyosResume* resume, RECTANGLE_16* areas, UINT32 maxAreas,
+                             DWORD* timeout);
+/* Account repainted regions, called from EndPaint */
+void harmonyos_resume_painted(harmonyosResume* resume, rdpGdi* gdi, const GDI_RGN* rects,
+                              UINT32 count);
+
+/* Quality controller functions, the samples may come from any thread */
+harmonyosQuality* harmonyos_quality_new(void);
+void harmonyos_quality_free(harmonyosQuality* quality);
+/* Signalled when the level changed, harmonyos_quality_poll resets it */
+HANDLE harmonyos_quality_get_event(harmonyosQuality* quality);
+/* Network characteristics the server measured, 0 for a value it did not report */
+void harmonyos_quality_network(harmonyosQuality* quality, UINT32 rtt, UINT32 bandwidth,
+                               UINT64 now);
+/* A bandwidth measurement of the client, byteCount received in timeDelta ms */
+void harmonyos_quality_bandwidth(harmonyosQuality* quality, UINT32 timeDelta, UINT32 byteCount,
+                                 UINT64 now);
+/* Account a decoded gfx frame, returns the queueDepth of its acknowledge */
+UINT32 harmonyos_quality_frame(harmonyosQuality* quality, UINT32 frameTime, UINT64 now);
+/* Current level, true if it changed since the last poll */
+bool harmonyos_quality_poll(harmonyosQuality* quality, HARMONYOS_QUALITY_LEVEL* level);
+/* The requested rdpsnd mode becomes the live one when the channels are loaded on connect */
+void harmonyos_quality_request_audio(harmonyosQuality* quality, UINT16 mode);
+void harmonyos_quality_connect_audio(harmonyosQuality* quality);
+bool harmonyos_quality_get_stats(harmonyosQuality* quality, harmonyosQualityStats* stats);
+
+/* Gesture engine functions, fed from the UI thread and drained by the session thread */
+harmonyosGesture* harmonyos_gesture_new(void);
+void harmonyos_gesture_free(harmonyosGesture* gesture);
+/* Signalled while events are pending, harmonyos_gesture_next resets it */
+HANDLE harmonyos_gesture_get_event(harmonyosGesture* gesture);
+/* Feed count doubles of touch samples, returns the gesture they leave */
+HARMONYOS_GESTURE_STATE harmonyos_gesture_feed(harmonyosGesture* gesture, const double* samples,
+                                               size_t count, const harmonyosViewTransform* view,
+                                               UINT64 now);
+/* Pending mouse events in order, moves coalesced and scroll split into wheel steps.
+ * *timeout is how long the run loop may wait before calling again. */
+UINT32 harmonyos_gesture_next(harmonyosGesture* gesture, UINT64 now, harmonyosMouseEvent* events,
+                              UINT32 maxEvents, DWORD* timeout);
 
 /* Callback definitions for N-API */
 typedef void (*OnConnectionSuccessCallback)(int64_t instance);
@@ -134,11 +291,82 @@ typedef void (*OnGraphicsUpdateCallback)(int64_t instance, int x, int y, int wid
 typedef void (*OnGraphicsResizeCallback)(int64_t instance, int width, int height, int bpp);
 typedef void (*OnRemoteClipboardChangedCallback)(int64_t instance, const char* data);
 typedef void (*OnCursorTypeChangedCallback)(int64_t instance, int cursorType);
+/* pixels is NULL when the atlas dropped cursorId */
+typedef void (*OnCursorBitmapCallback)(int64_t instance, uint32_t cursorId, int width, int height,
+                                       const uint8_t* pixels);
+/* cursorId 0 means no atlas cursor, the last cursor type applies */
+typedef void (*OnCursorSetCallback)(int64_t instance, uint32_t cursorId, int hotX, int hotY);
 typedef bool (*OnAuthenticateCallback)(int64_t instance, char** username, char** domain, char** password);
 typedef int (*OnVerifyCertificateCallback)(int64_t instance, const char* host, int port,
                                            const char* commonName, const char* subject,
                                            const char* issuer, const char* fingerprint, int64_t flags);
 
+/* Callbacks a session reports to, kept in sync with the registered ones */
+typedef struct {
+    OnConnectionSuccessCallback onConnectionSuccess;
+    OnConnectionFailureCallback onConnectionFailure;
+    OnPreConnectCallback onPreConnect;
+    OnDisconnectingCallback onDisconnecting;
+    OnDisconnectedCallback onDisconnected;
+    OnSettingsChangedCallback onSettingsChanged;
+    OnGraphicsUpdateCallback onGraphicsUpdate;
+    OnGraphicsResizeCallback onGraphicsResize;
+    OnRemoteClipboardChangedCallback onRemoteClipboardChanged;
+    OnCursorTypeChangedCallback onCursorTypeChanged;
+    OnCursorBitmapCallback onCursorBitmap;
+    OnCursorSetCallback onCursorSet;
+    OnAuthenticateCallback onAuthenticate;
+    OnVerifyCertificateCallback onVerifyCertificate;
+} harmonyosCallbacks;
+
+/* HarmonyOS context extension, everything a session owns lives here */
+typedef struct {
+    rdpClientContext common;
+    HANDLE thread;
+    harmonyosEventQueue* events;
+    harmonyosCursorAtlas* cursors;
+    harmonyosClipboard* clipboard;
+    harmonyosResume* resume;
+    harmonyosQuality* quality;
+    harmonyosGesture* gesture;
+    harmonyosCallbacks callbacks;
+
+    /* 已从手势引擎取出的鼠标事件，发送失败的部分保留到下次先发送 */
+    harmonyosMouseEvent gestureEvents[32];
+    UINT32 gestureUnsent;
+
+    /* 后台模式与网络活动状态 */
+    volatile BOOL isInBackgroundMode;
+    volatile UINT64 lastNetworkActivityTime;
+    int frameCount;
+
+    /* 可见区域与触摸焦点，恢复时优先刷新；ArkTS 写入，会话线程读取，由 viewLock 保护 */
+    CRITICAL_SECTION viewLock;
+    RECTANGLE_16 viewport;
+    INT32 focusX;
+    INT32 focusY;
+
+    /* 网络较差时只让服务器发送可见区域 */
+    volatile BOOL outputRestricted;
+    RECTANGLE_16 outputArea;
+
+    /* 外部图形缓冲区 */
+    CRITICAL_SECTION bufferLock;
+    uint8_t* externalBuffer;
+    size_t externalBufferSize;
+
+    /* Codec work of this session on the decode pool shared by all sessions */
+    TP_CALLBACK_ENVIRON decodeEnv;
+} harmonyosContext;
+
+/* Viewport and touch focus under viewLock, any of the outputs may be NULL */
+void harmonyos_get_view(harmonyosContext* afc, RECTANGLE_16* viewport, INT32* focusX, INT32* focusY);
+
+/* Clipboard functions, the state hangs off harmonyosContext::clipboard */
+void harmonyos_cliprdr_init(harmonyosContext* afc, CliprdrClientContext* cliprdr);
+void harmonyos_cliprdr_uninit(harmonyosContext* afc, CliprdrClientContext* cliprdr);
+bool harmonyos_cliprdr_send_data(harmonyosContext* afc, const char* data, size_t length);
+
 /* Callback registration */
 void harmonyos_set_connection_success_callback(OnConnectionSuccessCallback callback);
 void harmonyos_set_connection_failure_callback(OnConnectionFailureCallback callback);
@@ -150,6 +378,8 @@ void harmonyos_set_graphics_update_callback(OnGraphicsUpdateCallback callback);
 void harmonyos_set_graphics_resize_callback(OnGraphicsResizeCallback callback);
 void harmonyos_set_remote_clipboard_changed_callback(OnRemoteClipboardChangedCallback callback);
 void harmonyos_set_cursor_type_changed_callback(OnCursorTypeChangedCallback callback);
+void harmonyos_set_cursor_bitmap_callback(OnCursorBitmapCallback callback);
+void harmonyos_set_cursor_set_callback(OnCursorSetCallback callback);
 void harmonyos_set_authenticate_callback(OnAuthenticateCallback callback);
 void harmonyos_set_verify_certificate_callback(OnVerifyCertificateCallback callback);
 
@@ -161,6 +391,9 @@ bool freerdp_harmonyos_connect(int64_t instance);
 bool freerdp_harmonyos_disconnect(int64_t instance);
 bool freerdp_harmonyos_update_graphics(int64_t instance, uint8_t* buffer, int x, int y, int width, int height);
 bool freerdp_harmonyos_send_cursor_event(int64_t instance, int x, int y, int flags);
+/* Touch samples of one input frame, returns the HARMONYOS_GESTURE_STATE they leave */
+int freerdp_harmonyos_send_touch_batch(int64_t instance, const harmonyosViewTransform* view,
+                                       const double* samples, size_t count);
 bool freerdp_harmonyos_send_key_event(int64_t instance, int keycode, bool down);
 bool freerdp_harmonyos_send_unicodekey_event(int64_t instance, int keycode, bool down);
 bool freerdp_harmonyos_set_tcp_keepalive(int64_t instance, bool enabled, int delay, int interval, int retries);
@@ -172,16 +405,30 @@ const char* freerdp_harmonyos_get_version(void);
 bool freerdp_harmonyos_has_h264(void);
 bool freerdp_harmonyos_is_connected(int64_t instance);
 
+/* Files directory of the app sandbox (context.filesDir), set before the first connection */
+bool freerdp_harmonyos_set_files_dir(const char* dir);
+
+/*
+ * Multiple sessions: decoding of the active session runs first on the shared decode
+ * workers, the other sessions are throttled. 0 means no session is active.
+ */
+bool freerdp_harmonyos_set_active_session(int64_t instance);
+
 /* Background Mode & Audio Priority */
 bool freerdp_harmonyos_enter_background_mode(int64_t instance);
 bool freerdp_harmonyos_exit_background_mode(int64_t instance);
 bool freerdp_harmonyos_configure_audio(int64_t instance, bool playback, bool capture, int quality);
 bool freerdp_harmonyos_set_auto_reconnect(int64_t instance, bool enabled, int maxRetries, int delayMs);
 int freerdp_harmonyos_get_connection_health(int64_t instance);
+bool freerdp_harmonyos_get_bitmap_cache_stats(int64_t instance, rdpBitmapCacheStats* stats);
+bool freerdp_harmonyos_get_network_quality(int64_t instance, harmonyosQualityStats* stats);
 
 /* Screen Refresh - use after unlock/foreground to prevent static screen */
 bool freerdp_harmonyos_request_refresh(int64_t instance);
 bool freerdp_harmonyos_request_refresh_rect(int64_t instance, int x, int y, int width, int height);
+/* Visible part of the desktop: refreshed first on resume, gfx output outside it is deferred.
+ * A zero size means everything. */
+bool freerdp_harmonyos_set_viewport(int64_t instance, int x, int y, int width, int height);
 bool freerdp_harmonyos_get_frame_buffer(int64_t instance, uint8_t** buffer, 
                                          int* width, int* height, int* stride);
 
@@ -0,0 +1,493 @@
+/*
+ * HarmonyOS FreeRDP Touch Gesture Engine
+ *
+ * Copyright 2026 FreeRDP HarmonyOS Port
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+ */
+
+#include "harmonyos_freerdp.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef OHOS_PLATFORM
+#include <hilog/log.h>
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "FreeRDP.Gesture"
+#define LOGI(...) OH_LOG_INFO(LOG_APP, __VA_ARGS__)
+#define LOGW(...) OH_LOG_WARN(LOG_APP, __VA_ARGS__)
+#define LOGE(...) OH_LOG_ERROR(LOG_APP, __VA_ARGS__)
+#define LOGD(...) OH_LOG_DEBUG(LOG_APP, __VA_ARGS__)
+#else
+#include <stdio.h>
+#define LOGI(...) printf(__VA_ARGS__)
+#define LOGW(...) printf(__VA_ARGS__)
+#define LOGE(...) printf(__VA_ARGS__)
+#define LOGD(...) printf(__VA_ARGS__)
+#endif
+
+#include <freerdp/input.h>
+
+/* Movement in view units below which a touch is still a tap or long press */
+#define GESTURE_TOUCH_SLOP 10.0
+
+/* Change of the finger distance that makes two fingers a pinch rather than a scroll */
+#define GESTURE_PINCH_SLOP 24.0
+
+#define GESTURE_LONG_PRESS_MS 500
+
+/* Wheel units per view unit of two finger movement, a notch (120) per 40 units */
+#define GESTURE_WHEEL_PER_UNIT 3.0
+
+/* Largest wheel rotation of a single event, the field is 9 bit two's complement */
+#define GESTURE_WHEEL_STEP 120
+
+#define GESTURE_MAX_POINTERS 2
+#define GESTURE_QUEUE_SIZE 128
+
+typedef struct {
+    bool active;
+    INT32 id;
+    double x;
+    double y;
+} gesturePointer;
+
+struct harmonyos_gesture {
+    CRITICAL_SECTION lock;
+    HANDLE event;
+
+    HARMONYOS_GESTURE_STATE state;
+    gesturePointer pointers[GESTURE_MAX_POINTERS];
+    UINT32 count;
+
+    /* Where the gesture started, in view units */
+    double startX;
+    double startY;
+    double startSpread;
+    UINT64 deadline;
+
+    /* Last view to desktop mapping of the session view */
+    double scale;
+    double offsetX;
+    double offsetY;
+    UINT32 width;
+    UINT32 height;
+    UINT16 lastX;
+    UINT16 lastY;
+
+    /* Pending output, consecutive moves share one entry */
+    harmonyosMouseEvent queue[GESTURE_QUEUE_SIZE];
+    UINT32 head;
+    UINT32 length;
+
+    /* Buttons pressed in the queue without a queued release, each keeps a slot for it */
+    UINT16 pressed;
+
+    /* Scroll not sent yet, keeps the fraction of a wheel unit */
+    double wheelX;
+    double wheelY;
+};
+
+static void gesture_desktop(harmonyosGesture* gesture, double x, double y, UINT16* dx, UINT16* dy) {
+    const double scale = (gesture->scale > 0.0) ? gesture->scale : 1.0;
+    const double px = floor((x - gesture->offsetX) / scale + 0.5);
+    const double py = floor((y - gesture->offsetY) / scale + 0.5);
+    const double maxX = gesture->width ? (double)(gesture->width - 1) : 0.0;
+    const double maxY = gesture->height ? (double)(gesture->height - 1) : 0.0;
+
+    *dx = (UINT16)MAX(0.0, MIN(px, maxX));
+    *dy = (UINT16)MAX(0.0, MIN(py, maxY));
+}
+
+static UINT32 gesture_buttons(UINT16 buttons) {
+    UINT32 count = 0;
+    for (; buttons; buttons &= (UINT16)(buttons - 1))
+        count++;
+    return count;
+}
+
+/* Make room by dropping the oldest queued move, a later move or button event has the position */
+static bool gesture_drop_move(harmonyosGesture* gesture) {
+    for (UINT32 x = 0; x < gesture->length; x++) {
+        const UINT32 index = (gesture->head + x) % GESTURE_QUEUE_SIZE;
+        if (gesture->queue[index].flags != PTR_FLAGS_MOVE)
+            continue;
+
+        for (UINT32 y = x + 1; y < gesture->length; y++) {
+            gesture->queue[(gesture->head + y - 1) % GESTURE_QUEUE_SIZE] =
+                gesture->queue[(gesture->head + y) % GESTURE_QUEUE_SIZE];
+        }
+        gesture->length--;
+        return true;
+    }
+    return false;
+}
+
+static void gesture_push(harmonyosGesture* gesture, UINT16 flags, double x, double y) {
+    UINT16 px = 0;
+    UINT16 py = 0;
+    gesture_desktop(gesture, x, y, &px, &py);
+
+    /* A move replaces the move before it, button changes keep their order */
+    if (gesture->length > 0) {
+        harmonyosMouseEvent* last =
+            &gesture->queue[(gesture->head + gesture->length - 1) % GESTURE_QUEUE_SIZE];
+        if ((flags == PTR_FLAGS_MOVE) && (last->flags == PTR_FLAGS_MOVE)) {
+            last->x = px;
+            last->y = py;
+            gesture->lastX = px;
+            gesture->lastY = py;
+            return;
+        }
+        if ((flags == PTR_FLAGS_MOVE) && (last->x == px) && (last->y == py))
+            return;
+    } else if ((flags == PTR_FLAGS_MOVE) && (gesture->lastX == px) && (gesture->lastY == py)) {
+        return;
+    }
+
+    /*
+     * A press is only queued with a slot left for its release, so releases always fit.
+     * A release whose press was dropped is dropped as well, the server never saw the press.
+     */
+    const UINT16 button = flags & (PTR_FLAGS_BUTTON1 | PTR_FLAGS_BUTTON2 | PTR_FLAGS_BUTTON3);
+    const bool press = button && (flags & PTR_FLAGS_DOWN);
+    const bool release = button && !(flags & PTR_FLAGS_DOWN);
+    if (release && !(gesture->pressed & button))
+        return;
+
+    UINT32 reserved = gesture_buttons(gesture->pressed);
+    if (release)
+        reserved--;
+    const UINT32 needed = press ? 2 : 1;
+    while (gesture->length + reserved + needed > GESTURE_QUEUE_SIZE) {
+        if (!gesture_drop_move(gesture)) {
+            LOGW("Gesture queue full, dropping %04X", flags);
+            return;
+        }
+    }
+
+    harmonyosMouseEvent* event =
+        &gesture->queue[(gesture->head + gesture->length) % GESTURE_QUEUE_SIZE];
+    event->flags = flags;
+    event->x = px;
+    event->y = py;
+    gesture->length++;
+    gesture->lastX = px;
+    gesture->lastY = py;
+
+    if (press)
+        gesture->pressed |= button;
+    else if (release)
+        gesture->pressed &= (UINT16)~button;
+}
+
+static void gesture_click(harmonyosGesture* gesture, UINT16 button, double x, double y) {
+    gesture_push(gesture, PTR_FLAGS_MOVE, x, y);
+    gesture_push(gesture, PTR_FLAGS_DOWN | button, x, y);
+    gesture_push(gesture, button, x, y);
+}
+
+static gesturePointer* gesture_find(harmonyosGesture* gesture, INT32 id) {
+    for (UINT32 x = 0; x < GESTURE_MAX_POINTERS; x++) {
+        if (gesture->pointers[x].active && (gesture->pointers[x].id == id))
+            return &gesture->pointers[x];
+    }
+    return NULL;
+}
+
+static void gesture_center(const harmonyosGesture* gesture, double* x, double* y, double* spread) {
+    const gesturePointer* a = &gesture->pointers[0];
+    const gesturePointer* b = &gesture->pointers[1];
+
+    *x = (a->x + b->x) / 2.0;
+    *y = (a->y + b->y) / 2.0;
+    *spread = hypot(b->x - a->x, b->y - a->y);
+}
+
+static void gesture_reset(harmonyosGesture* gesture) {
+    memset(gesture->pointers, 0, sizeof(gesture->pointers));
+    gesture->count = 0;
+    gesture->deadline = 0;
+    gesture->wheelX = 0.0;
+    gesture->wheelY = 0.0;
+    gesture->state = HARMONYOS_GESTURE_NONE;
+}
+
+static void gesture_down(harmonyosGesture* gesture, INT32 id, double x, double y, UINT64 now) {
+    if (gesture_find(gesture, id) || (gesture->count >= GESTURE_MAX_POINTERS))
+        return;
+
+    gesturePointer* pointer = !gesture->pointers[0].active ? &gesture->pointers[0]
+                                                           : &gesture->pointers[1];
+    pointer->active = true;
+    pointer->id = id;
+    pointer->x = x;
+    pointer->y = y;
+    gesture->count++;
+
+    if (gesture->count == 1) {
+        /* Point at the touch right away, the click follows on release */
+        gesture->state = HARMONYOS_GESTURE_PENDING;
+        gesture->startX = x;
+        gesture->startY = y;
+        gesture->deadline = now + GESTURE_LONG_PRESS_MS;
+        gesture_push(gesture, PTR_FLAGS_MOVE, x, y);
+    } else if (gesture->state == HARMONYOS_GESTURE_PENDING) {
+        /* Second finger before the first one moved, scroll or pinch */
+        gesture->state = HARMONYOS_GESTURE_TWO_FINGER;
+        gesture->deadline = 0;
+        gesture_center(gesture, &gesture->startX, &gesture->startY, &gesture->startSpread);
+    }
+}
+
+static void gesture_move(harmonyosGesture* gesture, INT32 id, double x, double y) {
+    gesturePointer* pointer = gesture_find(gesture, id);
+    if (!pointer)
+        return;
+
+    const double lastX = pointer->x;
+    const double lastY = pointer->y;
+    pointer->x = x;
+    pointer->y = y;
+
+    switch (gesture->state) {
+        case HARMONYOS_GESTURE_PENDING:
+            if (hypot(x - gesture->startX, y - gesture->startY) <= GESTURE_TOUCH_SLOP)
+                break;
+            /* The drag presses where the finger went down */
+            gesture->state = HARMONYOS_GESTURE_DRAG;
+            gesture->deadline = 0;
+            gesture_push(gesture, PTR_FLAGS_DOWN | PTR_FLAGS_BUTTON1, gesture->startX,
+                         gesture->startY);
+            gesture_push(gesture, PTR_FLAGS_MOVE, x, y);
+            break;
+
+        case HARMONYOS_GESTURE_DRAG:
+            if (pointer == &gesture->pointers[0])
+                gesture_push(gesture, PTR_FLAGS_MOVE, x, y);
+            break;
+
+        case HARMONYOS_GESTURE_TWO_FINGER: {
+            if (gesture->count < 2)
+                break;
+            double cx = 0.0;
+            double cy = 0.0;
+            double spread = 0.0;
+            gesture_center(gesture, &cx, &cy, &spread);
+            if (fabs(spread - gesture->startSpread) > GESTURE_PINCH_SLOP) {
+                gesture->state = HARMONYOS_GESTURE_PINCH;
+            } else if (hypot(cx - gesture->startX, cy - gesture->startY) > GESTURE_TOUCH_SLOP) {
+                gesture->state = HARMONYOS_GESTURE_SCROLL;
+                gesture_push(gesture, PTR_FLAGS_MOVE, cx, cy);
+            }
+            break;
+        }
+
+        case HARMONYOS_GESTURE_SCROLL:
+            /* Content follows the fingers: down scrolls up, left scrolls right */
+            gesture->wheelY += ((y - lastY) / 2.0) * GESTURE_WHEEL_PER_UNIT;
+            gesture->wheelX -= ((x - lastX) / 2.0) * GESTURE_WHEEL_PER_UNIT;
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void gesture_up(harmonyosGesture* gesture, INT32 id, bool cancel) {
+    gesturePointer* pointer = gesture_find(gesture, id);
+    if (!pointer)
+        return;
+
+    const double x = pointer->x;
+    const double y = pointer->y;
+    pointer->active = false;
+    gesture->count--;
+
+    switch (gesture->state) {
+        case HARMONYOS_GESTURE_PENDING:
+            if (!cancel)
+                gesture_click(gesture, PTR_FLAGS_BUTTON1, gesture->startX, gesture->startY);
+            break;
+
+        case HARMONYOS_GESTURE_DRAG:
+            /* The drag ends with its own finger, a cancel still releases the button */
+            if (pointer == &gesture->pointers[0])
+                gesture_push(gesture, PTR_FLAGS_BUTTON1, x, y);
+            else
+                return;
+            break;
+
+        case HARMONYOS_GESTURE_TWO_FINGER:
+            /* Two finger tap, the right click goes where the fingers touched */
+            if (!cancel)
+                gesture_click(gesture, PTR_FLAGS_BUTTON2, gesture->startX, gesture->startY);
+            gesture->state = HARMONYOS_GESTURE_DONE;
+            break;
+
+        case HARMONYOS_GESTURE_SCROLL:
+        case HARMONYOS_GESTURE_PINCH:
+            /* Lifting one finger ends the gesture, the other is ignored until released */
+            gesture->state = HARMONYOS_GESTURE_DONE;
+            break;
+
+        default:
+            break;
+    }
+
+    gesture->deadline = 0;
+    if (gesture->count == 0) {
+        const double wheelX = gesture->wheelX;
+        const double wheelY = gesture->wheelY;
+        gesture_reset(gesture);
+        /* Whole wheel units of the last movement are still sent */
+        gesture->wheelX = wheelX;
+        gesture->wheelY = wheelY;
+    } else {
+        gesture->state = HARMONYOS_GESTURE_DONE;
+    }
+}
+
+/* Whole wheel units of the accumulated scroll, the fraction stays for the next movement */
+static bool gesture_take_wheel(double* wheel, UINT16 horizontal, harmonyosMouseEvent* event,
+                               UINT16 x, UINT16 y) {
+    const double whole = trunc(*wheel);
+    if (whole == 0.0)
+        return false;
+
+    const INT32 value = (INT32)MAX(-GESTURE_WHEEL_STEP, MIN(whole, GESTURE_WHEEL_STEP));
+    *wheel -= value;
+
+    event->flags = horizontal ? PTR_FLAGS_HWHEEL : PTR_FLAGS_WHEEL;
+    if (value < 0)
+        event->flags |= PTR_FLAGS_WHEEL_NEGATIVE | ((0x100 + value) & WheelRotationMask);
+    else
+        event->flags |= (UINT16)(value & WheelRotationMask);
+    event->x = x;
+    event->y = y;
+    return true;
+}
+
+harmonyosGesture* harmonyos_gesture_new(void) {
+    harmonyosGesture* gesture = (harmonyosGesture*)calloc(1, sizeof(harmonyosGesture));
+    if (!gesture)
+        return NULL;
+
+    gesture->event = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!gesture->event) {
+        free(gesture);
+        return NULL;
+    }
+
+    InitializeCriticalSection(&gesture->lock);
+    gesture->scale = 1.0;
+    return gesture;
+}
+
+void harmonyos_gesture_free(harmonyosGesture* gesture) {
+    if (!gesture)
+        return;
+
+    CloseHandle(gesture->event);
+    DeleteCriticalSection(&gesture->lock);
+    free(gesture);
+}
+
+HANDLE harmonyos_gesture_get_event(harmonyosGesture* gesture) {
+    return gesture ? gesture->event : NULL;
+}
+
+HARMONYOS_GESTURE_STATE harmonyos_gesture_feed(harmonyosGesture* gesture, const double* samples,
+                                               size_t count, const harmonyosViewTransform* view,
+                                               UINT64 now) {
+    if (!gesture || !view)
+        return HARMONYOS_GESTURE_NONE;
+
+    EnterCriticalSection(&gesture->lock);
+    gesture->scale = view->scale;
+    gesture->offsetX = view->offsetX;
+    gesture->offsetY = view->offsetY;
+    gesture->width = view->width;
+    gesture->height = view->height;
+
+    for (size_t x = 0; samples && (x + HARMONYOS_TOUCH_SAMPLE_SIZE <= count);
+         x += HARMONYOS_TOUCH_SAMPLE_SIZE) {
+        const INT32 action = (INT32)samples[x];
+        const INT32 id = (INT32)samples[x + 1];
+        const double px = samples[x + 2];
+        const double py = samples[x + 3];
+
+        switch (action) {
+            case HARMONYOS_TOUCH_DOWN:
+                gesture_down(gesture, id, px, py, now);
+                break;
+            case HARMONYOS_TOUCH_MOVE:
+                gesture_move(gesture, id, px, py);
+                break;
+            case HARMONYOS_TOUCH_UP:
+                gesture_up(gesture, id, false);
+                break;
+            case HARMONYOS_TOUCH_CANCEL:
+                gesture_up(gesture, id, true);
+                break;
+            default:
+                LOGW("Unknown touch action %d", action);
+                break;
+        }
+    }
+
+    const HARMONYOS_GESTURE_STATE state = gesture->state;
+    SetEvent(gesture->event);
+    LeaveCriticalSection(&gesture->lock);
+    return state;
+}
+
+UINT32 harmonyos_gesture_next(harmonyosGesture* gesture, UINT64 now, harmonyosMouseEvent* events,
+                              UINT32 maxEvents, DWORD* timeout) {
+    UINT32 count = 0;
+
+    if (timeout)
+        *timeout = INFINITE;
+    if (!gesture || !events)
+        return 0;
+
+    EnterCriticalSection(&gesture->lock);
+
+    /* Held without moving, right click where the finger is */
+    if ((gesture->state == HARMONYOS_GESTURE_PENDING) && gesture->deadline &&
+        (now >= gesture->deadline)) {
+        gesture->state = HARMONYOS_GESTURE_PRESSED;
+        gesture->deadline = 0;
+        gesture_click(gesture, PTR_FLAGS_BUTTON2, gesture->startX, gesture->startY);
+    }
+
+    while ((count < maxEvents) && (gesture->length > 0)) {
+        events[count++] = gesture->queue[gesture->head];
+        gesture->head = (gesture->head + 1) % GESTURE_QUEUE_SIZE;
+        gesture->length--;
+    }
+
+    while ((count < maxEvents) &&
+           gesture_take_wheel(&gesture->wheelY, 0, &events[count], gesture->lastX, gesture->lastY))
+        count++;
+    while ((count < maxEvents) &&
+           gesture_take_wheel(&gesture->wheelX, 1, &events[count], gesture->lastX, gesture->lastY))
+        count++;
+
+    const bool more = (gesture->length > 0) || (fabs(gesture->wheelX) >= 1.0) ||
+                      (fabs(gesture->wheelY) >= 1.0);
+    if (more) {
+        if (timeout)
+            *timeout = 0;
+    } else {
+        ResetEvent(gesture->event);
+        if (timeout && gesture->deadline)
+            *timeout = (DWORD)((gesture->deadline > now) ? (gesture->deadline - now) : 0);
+    }
+
+    LeaveCriticalSection(&gesture->lock);
+    return count;
+}
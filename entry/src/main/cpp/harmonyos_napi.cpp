@@ -46,6 +46,8 @@ static napi_threadsafe_function g_tsfnSettingsChanged = nullptr;
 static napi_threadsafe_function g_tsfnGraphicsUpdate = nullptr;
 static napi_threadsafe_function g_tsfnGraphicsResize = nullptr;
 static napi_threadsafe_function g_tsfnCursorTypeChanged = nullptr;
+static napi_threadsafe_function g_tsfnCursorBitmap = nullptr;
+static napi_threadsafe_function g_tsfnCursorSet = nullptr;
 
 // Mutex for protecting TSFN pointers
 static std::mutex g_tsfnMutex;
@@ -91,6 +93,13 @@ static bool GetBool(napi_env env, napi_value value) {
     return result;
 }
 
+// Helper: Get double from napi_value
+static double GetDouble(napi_env env, napi_value value) {
+    double result = 0.0;
+    napi_get_value_double(env, value, &result);
+    return result;
+}
+
 // ==================== Callback Data Structures ====================
 
 struct CallbackData {
@@ -101,6 +110,8 @@ struct CallbackData {
     int32_t height = 0;
     int32_t bpp = 0;
     int32_t cursorType = 0;
+    uint32_t cursorId = 0;
+    std::vector<uint8_t> pixels;
 };
 
 // ==================== Thread-Safe Callbacks ====================
@@ -174,6 +185,53 @@ static void CallJS_CursorType(napi_env env, napi_value js_callback, void* contex
     delete cbData;
 }
 
+static void CallJS_CursorBitmap(napi_env env, napi_value js_callback, void* context, void* data) {
+    if (!env || !js_callback || !data) return;
+    CallbackData* cbData = static_cast<CallbackData*>(data);
+    napi_value global, result;
+    if (napi_get_global(env, &global) != napi_ok) {
+        delete cbData;
+        return;
+    }
+    
+    napi_value args[5];
+    napi_create_int64(env, cbData->instance, &args[0]);
+    napi_create_uint32(env, cbData->cursorId, &args[1]);
+    napi_create_int32(env, cbData->width, &args[2]);
+    napi_create_int32(env, cbData->height, &args[3]);
+    
+    // undefined tells ArkTS to drop the cursor
+    void* buffer = nullptr;
+    if (cbData->pixels.empty() ||
+        napi_create_arraybuffer(env, cbData->pixels.size(), &buffer, &args[4]) != napi_ok) {
+        napi_get_undefined(env, &args[4]);
+    } else {
+        memcpy(buffer, cbData->pixels.data(), cbData->pixels.size());
+    }
+    
+    napi_call_function(env, global, js_callback, 5, args, &result);
+    delete cbData;
+}
+
+static void CallJS_CursorSet(napi_env env, napi_value js_callback, void* context, void* data) {
+    if (!env || !js_callback || !data) return;
+    CallbackData* cbData = static_cast<CallbackData*>(data);
+    napi_value global, result;
+    if (napi_get_global(env, &global) != napi_ok) {
+        delete cbData;
+        return;
+    }
+    
+    napi_value args[4];
+    napi_create_int64(env, cbData->instance, &args[0]);
+    napi_create_uint32(env, cbData->cursorId, &args[1]);
+    napi_create_int32(env, cbData->x, &args[2]);
+    napi_create_int32(env, cbData->y, &args[3]);
+    
+    napi_call_function(env, global, js_callback, 4, args, &result);
+    delete cbData;
+}
+
 // ==================== Native Callback Implementations (Bridge to TSFN) ====================
 
 static void OnConnectionSuccessImpl(int64_t instance) {
@@ -259,6 +317,31 @@ static void OnCursorTypeChangedImpl(int64_t instance, int cursorType) {
     napi_call_threadsafe_function(g_tsfnCursorTypeChanged, data, napi_tsfn_blocking);
 }
 
+static void OnCursorBitmapImpl(int64_t instance, uint32_t cursorId, int width, int height,
+                               const uint8_t* pixels) {
+    std::lock_guard<std::mutex> lock(g_tsfnMutex);
+    if (!g_tsfnCursorBitmap) return;
+    CallbackData* data = new CallbackData{instance};
+    data->cursorId = cursorId;
+    data->width = width;
+    data->height = height;
+    // The atlas owns the pixels, the JS call runs later on the main thread
+    if (pixels && width > 0 && height > 0) {
+        data->pixels.assign(pixels, pixels + (size_t)width * (size_t)height * 4);
+    }
+    napi_call_threadsafe_function(g_tsfnCursorBitmap, data, napi_tsfn_blocking);
+}
+
+static void OnCursorSetImpl(int64_t instance, uint32_t cursorId, int hotX, int hotY) {
+    std::lock_guard<std::mutex> lock(g_tsfnMutex);
+    if (!g_tsfnCursorSet) return;
+    CallbackData* data = new CallbackData{instance};
+    data->cursorId = cursorId;
+    data->x = hotX;
+    data->y = hotY;
+    napi_call_threadsafe_function(g_tsfnCursorSet, data, napi_tsfn_blocking);
+}
+
 // ==================== N-API Exported Functions ====================
 
 // freerdpNew(): number
@@ -364,6 +447,37 @@ static napi_value FreerdpSendCursorEvent(napi_env env, napi_callback_info info)
     return result;
 }
 
+// freerdpSendTouchBatch(instance: number, scale: number, offsetX: number, offsetY: number,
+//                       samples: Float64Array): number
+// samples holds [action, id, x, y] per touch point, returns the gesture state
+static napi_value FreerdpSendTouchBatch(napi_env env, napi_callback_info info) {
+    size_t argc = 5;
+    napi_value args[5];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    int64_t instance = GetInt64(env, args[0]);
+    harmonyosViewTransform view = {};
+    view.scale = GetDouble(env, args[1]);
+    view.offsetX = GetDouble(env, args[2]);
+    view.offsetY = GetDouble(env, args[3]);
+
+    napi_typedarray_type type = napi_int8_array;
+    size_t length = 0;
+    void* data = nullptr;
+    int state = 0;
+    if ((argc < 5) ||
+        (napi_get_typedarray_info(env, args[4], &type, &length, &data, nullptr, nullptr) != napi_ok) ||
+        (type != napi_float64_array)) {
+        LOGE("freerdpSendTouchBatch: samples must be a Float64Array");
+    } else {
+        state = freerdp_harmonyos_send_touch_batch(instance, &view, (const double*)data, length);
+    }
+
+    napi_value result;
+    napi_create_int32(env, state, &result);
+    return result;
+}
+
 // freerdpSendKeyEvent(instance: number, keycode: number, down: boolean): boolean
 static napi_value FreerdpSendKeyEvent(napi_env env, napi_callback_info info) {
     size_t argc = 3;
@@ -492,6 +606,20 @@ static napi_value FreerdpHasH264(napi_env env, napi_callback_info info) {
     return result;
 }
 
+// freerdpSetFilesDir(dir: string): boolean
+static napi_value FreerdpSetFilesDir(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    std::string dir = GetString(env, args[0]);
+    bool success = freerdp_harmonyos_set_files_dir(dir.c_str());
+
+    napi_value result;
+    napi_get_boolean(env, success, &result);
+    return result;
+}
+
 // ==================== Background Mode & Audio Priority ====================
 
 // freerdpEnterBackgroundMode(instance: number): boolean
@@ -572,6 +700,74 @@ static napi_value FreerdpGetConnectionHealth(napi_env env, napi_callback_info in
     return result;
 }
 
+// freerdpGetBitmapCacheStats(instance: number): BitmapCacheStats | undefined
+static napi_value FreerdpGetBitmapCacheStats(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    int64_t instance = GetInt64(env, args[0]);
+    rdpBitmapCacheStats stats = {};
+
+    napi_value result;
+    if (!freerdp_harmonyos_get_bitmap_cache_stats(instance, &stats)) {
+        napi_get_undefined(env, &result);
+        return result;
+    }
+
+    napi_value value;
+    napi_create_object(env, &result);
+    napi_create_uint32(env, stats.loadedEntries, &value);
+    napi_set_named_property(env, result, "loadedEntries", value);
+    napi_create_uint32(env, stats.persistentHits, &value);
+    napi_set_named_property(env, result, "persistentHits", value);
+    napi_create_uint32(env, stats.cacheOrders, &value);
+    napi_set_named_property(env, result, "cacheOrders", value);
+    napi_create_uint32(env, stats.savedEntries, &value);
+    napi_set_named_property(env, result, "savedEntries", value);
+    napi_create_int64(env, (int64_t)stats.savedBytes, &value);
+    napi_set_named_property(env, result, "savedBytes", value);
+    napi_get_boolean(env, stats.flushPending, &value);
+    napi_set_named_property(env, result, "flushPending", value);
+    return result;
+}
+
+// freerdpGetNetworkQuality(instance: number): NetworkQuality | undefined
+static napi_value FreerdpGetNetworkQuality(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    int64_t instance = GetInt64(env, args[0]);
+    harmonyosQualityStats stats = {};
+
+    napi_value result;
+    if (!freerdp_harmonyos_get_network_quality(instance, &stats)) {
+        napi_get_undefined(env, &result);
+        return result;
+    }
+
+    napi_value value;
+    napi_create_object(env, &result);
+    napi_create_int32(env, (int32_t)stats.level, &value);
+    napi_set_named_property(env, result, "level", value);
+    napi_create_uint32(env, stats.rtt, &value);
+    napi_set_named_property(env, result, "rtt", value);
+    napi_create_uint32(env, stats.bandwidth, &value);
+    napi_set_named_property(env, result, "bandwidth", value);
+    napi_create_uint32(env, stats.frameTime, &value);
+    napi_set_named_property(env, result, "frameTime", value);
+    napi_create_uint32(env, stats.frameInterval, &value);
+    napi_set_named_property(env, result, "frameInterval", value);
+    napi_create_uint32(env, stats.queueDepth, &value);
+    napi_set_named_property(env, result, "queueDepth", value);
+    napi_create_uint32(env, stats.audioQuality, &value);
+    napi_set_named_property(env, result, "audioQuality", value);
+    napi_create_uint32(env, stats.audioRequested, &value);
+    napi_set_named_property(env, result, "audioRequested", value);
+    return result;
+}
+
 // ==================== Screen Refresh ====================
 
 // freerdpRequestRefresh(instance: number): boolean
@@ -607,6 +803,25 @@ static napi_value FreerdpRequestRefreshRect(napi_env env, napi_callback_info inf
     return result;
 }
 
+// freerdpSetViewport(instance: number, x: number, y: number, width: number, height: number): boolean
+static napi_value FreerdpSetViewport(napi_env env, napi_callback_info info) {
+    size_t argc = 5;
+    napi_value args[5];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    int64_t instance = GetInt64(env, args[0]);
+    int32_t x = GetInt32(env, args[1]);
+    int32_t y = GetInt32(env, args[2]);
+    int32_t width = GetInt32(env, args[3]);
+    int32_t height = GetInt32(env, args[4]);
+    
+    bool success = freerdp_harmonyos_set_viewport(instance, x, y, width, height);
+    
+    napi_value result;
+    napi_get_boolean(env, success, &result);
+    return result;
+}
+
 // ==================== Connection Stability ====================
 
 // freerdpIsInBackgroundMode(instance: number): boolean
@@ -679,6 +894,20 @@ static napi_value FreerdpIsConnected(napi_env env, napi_callback_info info) {
     return result;
 }
 
+// freerdpSetActiveSession(instance: number): boolean, 0 clears the active session
+static napi_value FreerdpSetActiveSession(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    int64_t instance = GetInt64(env, args[0]);
+    bool success = freerdp_harmonyos_set_active_session(instance);
+    
+    napi_value result;
+    napi_get_boolean(env, success, &result);
+    return result;
+}
+
 // Callback setters
 static napi_value CreateTSFN(napi_env env, napi_value callback, const char* name, 
                             napi_threadsafe_function_call_js call_js, 
@@ -794,6 +1023,24 @@ static napi_value SetOnCursorTypeChanged(napi_env env, napi_callback_info info)
     return CreateTSFN(env, args[0], "OnCursorTypeChanged", CallJS_CursorType, &g_tsfnCursorTypeChanged);
 }
 
+static napi_value SetOnCursorBitmap(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    harmonyos_set_cursor_bitmap_callback(OnCursorBitmapImpl);
+    return CreateTSFN(env, args[0], "OnCursorBitmap", CallJS_CursorBitmap, &g_tsfnCursorBitmap);
+}
+
+static napi_value SetOnCursorSet(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    harmonyos_set_cursor_set_callback(OnCursorSetImpl);
+    return CreateTSFN(env, args[0], "OnCursorSet", CallJS_CursorSet, &g_tsfnCursorSet);
+}
+
 // ==================== Module Registration ====================
 
 static napi_value Init(napi_env env, napi_value exports) {
@@ -807,6 +1054,7 @@ static napi_value Init(napi_env env, napi_value exports) {
         
         // Input functions
         { "freerdpSendCursorEvent", nullptr, FreerdpSendCursorEvent, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "freerdpSendTouchBatch", nullptr, FreerdpSendTouchBatch, nullptr, nullptr, nullptr, napi_default, nullptr },
         { "freerdpSendKeyEvent", nullptr, FreerdpSendKeyEvent, nullptr, nullptr, nullptr, napi_default, nullptr },
         { "freerdpSendUnicodeKeyEvent", nullptr, FreerdpSendUnicodeKeyEvent, nullptr, nullptr, nullptr, napi_default, nullptr },
         { "freerdpSendClipboardData", nullptr, FreerdpSendClipboardData, nullptr, nullptr, nullptr, napi_default, nullptr },
@@ -823,6 +1071,8 @@ static napi_value Init(napi_env env, napi_value exports) {
         { "freerdpGetVersion", nullptr, FreerdpGetVersion, nullptr, nullptr, nullptr, napi_default, nullptr },
         { "freerdpHasH264", nullptr, FreerdpHasH264, nullptr, nullptr, nullptr, napi_default, nullptr },
         { "freerdpIsConnected", nullptr, FreerdpIsConnected, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "freerdpSetActiveSession", nullptr, FreerdpSetActiveSession, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "freerdpSetFilesDir", nullptr, FreerdpSetFilesDir, nullptr, nullptr, nullptr, napi_default, nullptr },
         
         // Background mode & audio priority
         { "freerdpEnterBackgroundMode", nullptr, FreerdpEnterBackgroundMode, nullptr, nullptr, nullptr, napi_default, nullptr },
@@ -830,10 +1080,13 @@ static napi_value Init(napi_env env, napi_value exports) {
         { "freerdpConfigureAudio", nullptr, FreerdpConfigureAudio, nullptr, nullptr, nullptr, napi_default, nullptr },
         { "freerdpSetAutoReconnect", nullptr, FreerdpSetAutoReconnect, nullptr, nullptr, nullptr, napi_default, nullptr },
         { "freerdpGetConnectionHealth", nullptr, FreerdpGetConnectionHealth, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "freerdpGetBitmapCacheStats", nullptr, FreerdpGetBitmapCacheStats, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "freerdpGetNetworkQuality", nullptr, FreerdpGetNetworkQuality, nullptr, nullptr, nullptr, napi_default, nullptr },
         
         // Screen refresh
         { "freerdpRequestRefresh", nullptr, FreerdpRequestRefresh, nullptr, nullptr, nullptr, napi_default, nullptr },
         { "freerdpRequestRefreshRect", nullptr, FreerdpRequestRefreshRect, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "freerdpSetViewport", nullptr, FreerdpSetViewport, nullptr, nullptr, nullptr, napi_default, nullptr },
         
         // Connection stability
         { "freerdpIsInBackgroundMode", nullptr, FreerdpIsInBackgroundMode, nullptr, nullptr, nullptr, napi_default, nullptr },
@@ -851,6 +1104,8 @@ static napi_value Init(napi_env env, napi_value exports) {
         { "setOnGraphicsUpdate", nullptr, SetOnGraphicsUpdate, nullptr, nullptr, nullptr, napi_default, nullptr },
         { "setOnGraphicsResize", nullptr, SetOnGraphicsResize, nullptr, nullptr, nullptr, napi_default, nullptr },
         { "setOnCursorTypeChanged", nullptr, SetOnCursorTypeChanged, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "setOnCursorBitmap", nullptr, SetOnCursorBitmap, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "setOnCursorSet", nullptr, SetOnCursorSet, nullptr, nullptr, nullptr, napi_default, nullptr },
     };
     
     napi_define_properties(env, exports, sizeof(desc) / sizeof(desc[0]), desc);
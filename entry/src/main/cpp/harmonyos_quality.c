@@ -0,0 +1,266 @@
+/*
+ * HarmonyOS FreeRDP Adaptive Quality Controller
+ *
+ * Copyright 2026 FreeRDP HarmonyOS Port
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+ */
+
+#include "harmonyos_freerdp.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef OHOS_PLATFORM
+#include <hilog/log.h>
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "FreeRDP.Quality"
+#define LOGI(...) OH_LOG_INFO(LOG_APP, __VA_ARGS__)
+#define LOGW(...) OH_LOG_WARN(LOG_APP, __VA_ARGS__)
+#define LOGE(...) OH_LOG_ERROR(LOG_APP, __VA_ARGS__)
+#define LOGD(...) OH_LOG_DEBUG(LOG_APP, __VA_ARGS__)
+#else
+#include <stdio.h>
+#define LOGI(...) printf(__VA_ARGS__)
+#define LOGW(...) printf(__VA_ARGS__)
+#define LOGE(...) printf(__VA_ARGS__)
+#define LOGD(...) printf(__VA_ARGS__)
+#endif
+
+#include <freerdp/channels/rdpgfx.h>
+#include <freerdp/codec/audio.h>
+
+/* Above any of these the link is poor */
+#define QUALITY_POOR_RTT_MS 250
+#define QUALITY_POOR_KBPS 1500
+#define QUALITY_POOR_FRAME_MS 150
+
+/* Below all of these the link is good, an unknown bandwidth does not count against it */
+#define QUALITY_GOOD_RTT_MS 60
+#define QUALITY_GOOD_KBPS 10000
+#define QUALITY_GOOD_FRAME_MS 40
+
+/* A new level has to hold this long, degrading is quicker than recovering */
+#define QUALITY_DEGRADE_MS 1000
+#define QUALITY_RECOVER_MS 5000
+
+/* Frame intervals above this are idle time, not pacing */
+#define QUALITY_MAX_INTERVAL_MS 1000
+
+/* Extra frames reported while poor so the server slows down before the link queues up */
+#define QUALITY_POOR_EXTRA_DEPTH 2
+#define QUALITY_MAX_DEPTH 16
+
+struct harmonyos_quality {
+    CRITICAL_SECTION lock;
+    HANDLE event;
+
+    HARMONYOS_QUALITY_LEVEL level;
+    HARMONYOS_QUALITY_LEVEL pending;
+    UINT64 pendingSince;
+    bool changed;
+
+    /* Smoothed measurements, 0 until the first sample */
+    UINT32 rtt;
+    UINT32 bandwidth;
+    UINT32 frameTime;
+    UINT32 frameInterval;
+    UINT64 lastFrame;
+    UINT32 queueDepth;
+
+    /* rdpsnd only reads its quality mode when the channels are loaded */
+    UINT16 audioQuality;
+    UINT16 audioRequested;
+};
+
+static UINT32 quality_smooth(UINT32 value, UINT32 sample, UINT32 weight) {
+    if (value == 0)
+        return sample;
+    return (UINT32)((1ULL * value * (weight - 1) + sample) / weight);
+}
+
+static HARMONYOS_QUALITY_LEVEL quality_classify(const harmonyosQuality* quality) {
+    if ((quality->rtt >= QUALITY_POOR_RTT_MS) ||
+        ((quality->bandwidth > 0) && (quality->bandwidth < QUALITY_POOR_KBPS)) ||
+        (quality->frameTime >= QUALITY_POOR_FRAME_MS))
+        return HARMONYOS_QUALITY_POOR;
+
+    if ((quality->rtt < QUALITY_GOOD_RTT_MS) &&
+        ((quality->bandwidth == 0) || (quality->bandwidth >= QUALITY_GOOD_KBPS)) &&
+        (quality->frameTime < QUALITY_GOOD_FRAME_MS))
+        return HARMONYOS_QUALITY_GOOD;
+
+    return HARMONYOS_QUALITY_FAIR;
+}
+
+static const char* quality_level_string(HARMONYOS_QUALITY_LEVEL level) {
+    switch (level) {
+        case HARMONYOS_QUALITY_GOOD:
+            return "good";
+        case HARMONYOS_QUALITY_FAIR:
+            return "fair";
+        case HARMONYOS_QUALITY_POOR:
+            return "poor";
+        default:
+            return "unknown";
+    }
+}
+
+/* Re-evaluate after a sample, the level only moves once the new one held long enough */
+static void quality_update(harmonyosQuality* quality, UINT64 now) {
+    const HARMONYOS_QUALITY_LEVEL level = quality_classify(quality);
+
+    if (level == quality->level) {
+        quality->pending = level;
+        return;
+    }
+
+    if (level != quality->pending) {
+        quality->pending = level;
+        quality->pendingSince = now;
+        return;
+    }
+
+    const UINT64 hold = (level > quality->level) ? QUALITY_DEGRADE_MS : QUALITY_RECOVER_MS;
+    if (now - quality->pendingSince < hold)
+        return;
+
+    LOGI("Network quality %s -> %s (rtt %u ms, %u kbit/s, frame %u ms every %u ms)",
+         quality_level_string(quality->level), quality_level_string(level), quality->rtt,
+         quality->bandwidth, quality->frameTime, quality->frameInterval);
+    quality->level = level;
+    quality->changed = true;
+    SetEvent(quality->event);
+}
+
+harmonyosQuality* harmonyos_quality_new(void) {
+    harmonyosQuality* quality = (harmonyosQuality*)calloc(1, sizeof(harmonyosQuality));
+    if (!quality)
+        return NULL;
+
+    quality->event = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!quality->event) {
+        free(quality);
+        return NULL;
+    }
+
+    InitializeCriticalSection(&quality->lock);
+    quality->level = HARMONYOS_QUALITY_GOOD;
+    quality->pending = HARMONYOS_QUALITY_GOOD;
+    quality->audioQuality = HIGH_QUALITY;
+    quality->audioRequested = HIGH_QUALITY;
+    return quality;
+}
+
+void harmonyos_quality_free(harmonyosQuality* quality) {
+    if (!quality)
+        return;
+
+    CloseHandle(quality->event);
+    DeleteCriticalSection(&quality->lock);
+    free(quality);
+}
+
+HANDLE harmonyos_quality_get_event(harmonyosQuality* quality) {
+    return quality ? quality->event : NULL;
+}
+
+void harmonyos_quality_network(harmonyosQuality* quality, UINT32 rtt, UINT32 bandwidth,
+                               UINT64 now) {
+    if (!quality)
+        return;
+
+    EnterCriticalSection(&quality->lock);
+    if (rtt > 0)
+        quality->rtt = quality_smooth(quality->rtt, rtt, 4);
+    if (bandwidth > 0)
+        quality->bandwidth = quality_smooth(quality->bandwidth, bandwidth, 4);
+    quality_update(quality, now);
+    LeaveCriticalSection(&quality->lock);
+}
+
+void harmonyos_quality_bandwidth(harmonyosQuality* quality, UINT32 timeDelta, UINT32 byteCount,
+                                 UINT64 now) {
+    /* Bursts shorter than a tick say nothing about the link */
+    if (timeDelta == 0)
+        return;
+
+    const UINT64 kbps = (8ULL * byteCount) / timeDelta;
+    harmonyos_quality_network(quality, 0, (UINT32)MIN(MAX(kbps, 1), UINT32_MAX), now);
+}
+
+UINT32 harmonyos_quality_frame(harmonyosQuality* quality, UINT32 frameTime, UINT64 now) {
+    if (!quality)
+        return QUEUE_DEPTH_UNAVAILABLE;
+
+    EnterCriticalSection(&quality->lock);
+    if (quality->lastFrame && (now - quality->lastFrame < QUALITY_MAX_INTERVAL_MS)) {
+        quality->frameInterval =
+            quality_smooth(quality->frameInterval, (UINT32)MAX(now - quality->lastFrame, 1), 8);
+    }
+    quality->lastFrame = now;
+    quality->frameTime = quality_smooth(quality->frameTime, MAX(frameTime, 1), 8);
+    quality_update(quality, now);
+
+    /* Frames that arrived while this one was still decoding are what the server sees queued */
+    UINT32 depth = QUEUE_DEPTH_UNAVAILABLE;
+    if ((quality->level != HARMONYOS_QUALITY_GOOD) && (quality->frameInterval > 0)) {
+        depth = 1 + quality->frameTime / quality->frameInterval;
+        if (quality->level == HARMONYOS_QUALITY_POOR)
+            depth += QUALITY_POOR_EXTRA_DEPTH;
+        depth = MIN(depth, QUALITY_MAX_DEPTH);
+    }
+    quality->queueDepth = depth;
+    LeaveCriticalSection(&quality->lock);
+    return depth;
+}
+
+bool harmonyos_quality_poll(harmonyosQuality* quality, HARMONYOS_QUALITY_LEVEL* level) {
+    if (!quality)
+        return false;
+
+    EnterCriticalSection(&quality->lock);
+    const bool changed = quality->changed;
+    quality->changed = false;
+    if (level)
+        *level = quality->level;
+    ResetEvent(quality->event);
+    LeaveCriticalSection(&quality->lock);
+    return changed;
+}
+
+void harmonyos_quality_request_audio(harmonyosQuality* quality, UINT16 mode) {
+    if (!quality)
+        return;
+
+    EnterCriticalSection(&quality->lock);
+    quality->audioRequested = mode;
+    LeaveCriticalSection(&quality->lock);
+}
+
+void harmonyos_quality_connect_audio(harmonyosQuality* quality) {
+    if (!quality)
+        return;
+
+    EnterCriticalSection(&quality->lock);
+    quality->audioQuality = quality->audioRequested;
+    LeaveCriticalSection(&quality->lock);
+}
+
+bool harmonyos_quality_get_stats(harmonyosQuality* quality, harmonyosQualityStats* stats) {
+    if (!quality || !stats)
+        return false;
+
+    EnterCriticalSection(&quality->lock);
+    stats->level = quality->level;
+    stats->rtt = quality->rtt;
+    stats->bandwidth = quality->bandwidth;
+    stats->frameTime = quality->frameTime;
+    stats->frameInterval = quality->frameInterval;
+    stats->queueDepth = quality->queueDepth;
+    stats->audioQuality = quality->audioQuality;
+    stats->audioRequested = quality->audioRequested;
+    LeaveCriticalSection(&quality->lock);
+    return true;
+}
@@ -0,0 +1,558 @@
+/*
+ * HarmonyOS FreeRDP Resume Scheduler
+ *
+ * Copyright 2026 FreeRDP HarmonyOS Port
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+ */
+
+#include "harmonyos_freerdp.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef OHOS_PLATFORM
+#include <hilog/log.h>
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "FreeRDP.Resume"
+#define LOGI(...) OH_LOG_INFO(LOG_APP, __VA_ARGS__)
+#define LOGW(...) OH_LOG_WARN(LOG_APP, __VA_ARGS__)
+#define LOGE(...) OH_LOG_ERROR(LOG_APP, __VA_ARGS__)
+#define LOGD(...) OH_LOG_DEBUG(LOG_APP, __VA_ARGS__)
+#else
+#include <stdio.h>
+#define LOGI(...) printf(__VA_ARGS__)
+#define LOGW(...) printf(__VA_ARGS__)
+#define LOGE(...) printf(__VA_ARGS__)
+#define LOGD(...) printf(__VA_ARGS__)
+#endif
+
+#include <winpr/sysinfo.h>
+#include <freerdp/codec/color.h>
+
+/* Same grid as the invalid tiles of the session */
+#define RESUME_TILE_SIZE 64
+
+/* Tiles around the touch focus requested in the first refresh */
+#define RESUME_FOCUS_TILES 16
+
+/* Tiles outside the viewport requested per trickle batch */
+#define RESUME_TRICKLE_TILES 16
+
+/* Trickle pacing bounds, the interval follows the measured frame interval */
+#define RESUME_MIN_INTERVAL_MS 50
+#define RESUME_MAX_INTERVAL_MS 1000
+
+/* Give up on a refresh the server did not answer after this long */
+#define RESUME_REQUEST_TIMEOUT_MS 2000
+
+/* Viewport tiles that came back unchanged above this share leave the rest of the frame as is */
+#define RESUME_UNCHANGED_PERCENT 90
+
+/* RefreshRect numberOfAreas is a single byte */
+#define RESUME_MAX_AREAS 255
+
+enum {
+    TILE_CURRENT = 0,   /* the kept frame is up to date */
+    TILE_QUEUED = 1,    /* waiting in the request order */
+    TILE_REQUESTED = 2, /* refresh sent, waiting for the repaint */
+    TILE_STALE = 3,     /* deferred, requested once it scrolls into the viewport */
+    TILE_STATE_MASK = 0x0F,
+    TILE_VIEWPORT = 0x10 /* was visible when the resume started */
+};
+
+struct harmonyos_resume {
+    CRITICAL_SECTION lock;
+    HANDLE event;
+
+    UINT32 width;
+    UINT32 height;
+    UINT32 cols;
+    UINT32 rows;
+    uint64_t* hashes; /* per tile hash of the kept frame, 0 if unknown */
+    uint8_t* state;
+
+    UINT32* order; /* tiles in request order */
+    UINT32 count;
+    UINT32 next;
+    UINT32 priority; /* leading entries of order inside the viewport */
+    UINT32 outstanding;
+    UINT32 stale;
+    UINT32 changed;
+    UINT32 unchanged;
+    bool trickle;
+
+    UINT64 lastRequest;
+    UINT64 lastPaint;
+    UINT64 frameInterval;
+};
+
+/* FNV-1a over 8 byte words, 0 is reserved for unknown tiles */
+static uint64_t resume_hash(uint64_t hash, const BYTE* data, size_t length) {
+    size_t x = 0;
+
+    for (; x + 8 <= length; x += 8) {
+        uint64_t word;
+        memcpy(&word, &data[x], sizeof(word));
+        hash = (hash ^ word) * 0x100000001B3ULL;
+        hash ^= hash >> 29;
+    }
+
+    for (; x < length; x++)
+        hash = (hash ^ data[x]) * 0x100000001B3ULL;
+
+    return hash;
+}
+
+static uint64_t resume_tile_hash(const harmonyosResume* resume, const rdpGdi* gdi, UINT32 tile) {
+    const UINT32 bpp = FreeRDPGetBytesPerPixel(gdi->dstFormat);
+    const UINT32 x = (tile % resume->cols) * RESUME_TILE_SIZE;
+    const UINT32 y = (tile / resume->cols) * RESUME_TILE_SIZE;
+    const UINT32 w = MIN(RESUME_TILE_SIZE, resume->width - x);
+    const UINT32 h = MIN(RESUME_TILE_SIZE, resume->height - y);
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    for (UINT32 line = 0; line < h; line++) {
+        const BYTE* src = &gdi->primary_buffer[1ull * (y + line) * gdi->stride + 1ull * x * bpp];
+        hash = resume_hash(hash, src, 1ull * w * bpp);
+    }
+
+    return hash ? hash : 1;
+}
+
+static bool resume_usable(const rdpGdi* gdi) {
+    return gdi && gdi->primary_buffer && (gdi->width > 0) && (gdi->height > 0);
+}
+
+/* Size the grid for the desktop, existing hashes survive only if the size did not change */
+static bool resume_resize(harmonyosResume* resume, UINT32 width, UINT32 height) {
+    if ((resume->width == width) && (resume->height == height) && resume->hashes)
+        return true;
+
+    const UINT32 cols = (width + RESUME_TILE_SIZE - 1) / RESUME_TILE_SIZE;
+    const UINT32 rows = (height + RESUME_TILE_SIZE - 1) / RESUME_TILE_SIZE;
+    const size_t tiles = 1ull * cols * rows;
+
+    uint64_t* hashes = (uint64_t*)calloc(tiles, sizeof(uint64_t));
+    uint8_t* state = (uint8_t*)calloc(tiles, sizeof(uint8_t));
+    UINT32* order = (UINT32*)calloc(tiles, sizeof(UINT32));
+    if (!hashes || !state || !order) {
+        free(hashes);
+        free(state);
+        free(order);
+        return false;
+    }
+
+    free(resume->hashes);
+    free(resume->state);
+    free(resume->order);
+    resume->hashes = hashes;
+    resume->state = state;
+    resume->order = order;
+    resume->width = width;
+    resume->height = height;
+    resume->cols = cols;
+    resume->rows = rows;
+    resume->count = 0;
+    resume->next = 0;
+    resume->priority = 0;
+    resume->outstanding = 0;
+    resume->stale = 0;
+    resume->trickle = false;
+    return true;
+}
+
+static bool resume_in_rect(const harmonyosResume* resume, UINT32 tile, const RECTANGLE_16* rect) {
+    const UINT32 x = (tile % resume->cols) * RESUME_TILE_SIZE;
+    const UINT32 y = (tile / resume->cols) * RESUME_TILE_SIZE;
+
+    return (x < rect->right) && (x + RESUME_TILE_SIZE > rect->left) && (y < rect->bottom) &&
+           (y + RESUME_TILE_SIZE > rect->top);
+}
+
+/* The whole desktop for an empty viewport */
+static RECTANGLE_16 resume_viewport(const harmonyosResume* resume, const RECTANGLE_16* viewport) {
+    RECTANGLE_16 rect = { 0, 0, (UINT16)MIN(resume->width, UINT16_MAX),
+                          (UINT16)MIN(resume->height, UINT16_MAX) };
+
+    if (viewport && (viewport->right > viewport->left) && (viewport->bottom > viewport->top)) {
+        rect.left = MIN(viewport->left, rect.right);
+        rect.top = MIN(viewport->top, rect.bottom);
+        rect.right = MIN(viewport->right, rect.right);
+        rect.bottom = MIN(viewport->bottom, rect.bottom);
+    }
+    return rect;
+}
+
+static UINT64 resume_distance(const harmonyosResume* resume, UINT32 tile, INT32 x, INT32 y) {
+    const INT64 dx = (INT64)((tile % resume->cols) * RESUME_TILE_SIZE + RESUME_TILE_SIZE / 2) - x;
+    const INT64 dy = (INT64)((tile / resume->cols) * RESUME_TILE_SIZE + RESUME_TILE_SIZE / 2) - y;
+    return (UINT64)(dx * dx + dy * dy);
+}
+
+typedef struct {
+    UINT64 key;
+    UINT32 tile;
+} ResumeOrderEntry;
+
+static int resume_order_compare(const void* a, const void* b) {
+    const ResumeOrderEntry* ea = (const ResumeOrderEntry*)a;
+    const ResumeOrderEntry* eb = (const ResumeOrderEntry*)b;
+
+    if (ea->key != eb->key)
+        return (ea->key < eb->key) ? -1 : 1;
+    return (ea->tile < eb->tile) ? -1 : (ea->tile > eb->tile);
+}
+
+/*
+ * Queue the tiles in the given states: viewport tiles by distance to the focus first,
+ * with all remaining tiles after them when rest is set.
+ */
+static bool resume_build_order(harmonyosResume* resume, const RECTANGLE_16* viewport, INT32 focusX,
+                               INT32 focusY, uint8_t from, bool rest) {
+    const UINT32 tiles = resume->cols * resume->rows;
+    ResumeOrderEntry* entries = (ResumeOrderEntry*)calloc(tiles, sizeof(ResumeOrderEntry));
+    UINT32 count = 0;
+    UINT32 priority = 0;
+
+    if (!entries)
+        return false;
+
+    for (UINT32 tile = 0; tile < tiles; tile++) {
+        const uint8_t state = resume->state[tile] & TILE_STATE_MASK;
+        const bool visible = resume_in_rect(resume, tile, viewport);
+
+        if ((state != from) || (!visible && !rest))
+            continue;
+
+        if (state == TILE_STALE)
+            resume->stale--;
+
+        /* Outside the viewport sorts after every visible tile */
+        entries[count].key =
+            resume_distance(resume, tile, focusX, focusY) + (visible ? 0 : (1ULL << 62));
+        entries[count].tile = tile;
+        resume->state[tile] = visible ? (TILE_QUEUED | TILE_VIEWPORT) : TILE_QUEUED;
+        count++;
+        if (visible)
+            priority++;
+    }
+
+    qsort(entries, count, sizeof(ResumeOrderEntry), resume_order_compare);
+    for (UINT32 x = 0; x < count; x++)
+        resume->order[x] = entries[x].tile;
+    free(entries);
+
+    resume->count = count;
+    resume->next = 0;
+    resume->priority = priority;
+    resume->outstanding = 0;
+    resume->changed = 0;
+    resume->unchanged = 0;
+    resume->trickle = false;
+    return true;
+}
+
+static int resume_tile_compare(const void* a, const void* b) {
+    const UINT32 ta = *(const UINT32*)a;
+    const UINT32 tb = *(const UINT32*)b;
+    return (ta < tb) ? -1 : (ta > tb);
+}
+
+/* Take up to max queued tiles from the order and merge runs within a tile row */
+static UINT32 resume_take(harmonyosResume* resume, UINT32 limit, UINT32 max, RECTANGLE_16* areas) {
+    UINT32 batch[RESUME_MAX_AREAS];
+    UINT32 count = 0;
+
+    max = MIN(max, RESUME_MAX_AREAS);
+    while ((resume->next < limit) && (count < max)) {
+        const UINT32 tile = resume->order[resume->next++];
+
+        /* Repainted by the server on its own since it was queued */
+        if ((resume->state[tile] & TILE_STATE_MASK) != TILE_QUEUED)
+            continue;
+
+        resume->state[tile] = (resume->state[tile] & TILE_VIEWPORT) | TILE_REQUESTED;
+        batch[count++] = tile;
+    }
+
+    if (count == 0)
+        return 0;
+
+    qsort(batch, count, sizeof(UINT32), resume_tile_compare);
+
+    UINT32 nareas = 0;
+    for (UINT32 x = 0; x < count; x++) {
+        const UINT32 tile = batch[x];
+        const UINT16 left = (UINT16)((tile % resume->cols) * RESUME_TILE_SIZE);
+        const UINT16 top = (UINT16)((tile / resume->cols) * RESUME_TILE_SIZE);
+        const UINT16 right = (UINT16)(MIN(left + RESUME_TILE_SIZE, resume->width) - 1);
+        const UINT16 bottom = (UINT16)(MIN(top + RESUME_TILE_SIZE, resume->height) - 1);
+
+        /* RefreshRect areas are inclusive */
+        if ((nareas > 0) && (batch[x - 1] + 1 == tile) && (tile % resume->cols != 0)) {
+            areas[nareas - 1].right = right;
+            continue;
+        }
+
+        areas[nareas].left = left;
+        areas[nareas].top = top;
+        areas[nareas].right = right;
+        areas[nareas].bottom = bottom;
+        nareas++;
+    }
+
+    resume->outstanding += count;
+    resume->lastRequest = GetTickCount64();
+    return nareas;
+}
+
+static UINT64 resume_interval(const harmonyosResume* resume) {
+    const UINT64 interval = 2 * resume->frameInterval;
+    return MAX(RESUME_MIN_INTERVAL_MS, MIN(interval, RESUME_MAX_INTERVAL_MS));
+}
+
+/* Once the viewport is back decide whether the rest of the frame is worth requesting */
+static void resume_check_viewport(harmonyosResume* resume) {
+    if (resume->trickle || (resume->next < resume->priority) || (resume->outstanding > 0))
+        return;
+
+    const UINT32 seen = resume->changed + resume->unchanged;
+    if ((seen > 0) && (resume->unchanged * 100ULL >= seen * 1ULL * RESUME_UNCHANGED_PERCENT)) {
+        /* The desktop did not change while suspended, keep the last frame outside the viewport */
+        for (UINT32 x = resume->next; x < resume->count; x++) {
+            const UINT32 tile = resume->order[x];
+            if ((resume->state[tile] & TILE_STATE_MASK) == TILE_QUEUED) {
+                resume->state[tile] = TILE_STALE;
+                resume->stale++;
+            }
+        }
+        LOGI("Viewport unchanged (%u/%u tiles), %u tiles deferred", resume->unchanged, seen,
+             resume->count - resume->next);
+        resume->count = resume->next;
+        return;
+    }
+
+    resume->trickle = true;
+}
+
+harmonyosResume* harmonyos_resume_new(void) {
+    harmonyosResume* resume = (harmonyosResume*)calloc(1, sizeof(harmonyosResume));
+    if (!resume)
+        return NULL;
+
+    resume->event = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!resume->event) {
+        free(resume);
+        return NULL;
+    }
+
+    InitializeCriticalSection(&resume->lock);
+    return resume;
+}
+
+void harmonyos_resume_free(harmonyosResume* resume) {
+    if (!resume)
+        return;
+
+    CloseHandle(resume->event);
+    DeleteCriticalSection(&resume->lock);
+    free(resume->hashes);
+    free(resume->state);
+    free(resume->order);
+    free(resume);
+}
+
+HANDLE harmonyos_resume_get_event(harmonyosResume* resume) {
+    return resume ? resume->event : NULL;
+}
+
+bool harmonyos_resume_snapshot(harmonyosResume* resume, rdpGdi* gdi) {
+    if (!resume || !resume_usable(gdi))
+        return false;
+
+    EnterCriticalSection(&resume->lock);
+    const bool rc = resume_resize(resume, (UINT32)gdi->width, (UINT32)gdi->height);
+    if (rc) {
+        const UINT32 tiles = resume->cols * resume->rows;
+        for (UINT32 tile = 0; tile < tiles; tile++) {
+            resume->hashes[tile] = resume_tile_hash(resume, gdi, tile);
+            resume->state[tile] = TILE_CURRENT;
+        }
+        resume->count = 0;
+        resume->next = 0;
+        resume->outstanding = 0;
+        resume->stale = 0;
+        LOGD("Resume snapshot: %ux%u tiles", resume->cols, resume->rows);
+    }
+    LeaveCriticalSection(&resume->lock);
+    return rc;
+}
+
+bool harmonyos_resume_begin(harmonyosResume* resume, rdpGdi* gdi, const RECTANGLE_16* viewport,
+                            INT32 focusX, INT32 focusY) {
+    if (!resume || !resume_usable(gdi))
+        return false;
+
+    EnterCriticalSection(&resume->lock);
+    bool rc = resume_resize(resume, (UINT32)gdi->width, (UINT32)gdi->height);
+    if (rc) {
+        const UINT32 tiles = resume->cols * resume->rows;
+        for (UINT32 tile = 0; tile < tiles; tile++)
+            resume->state[tile] = TILE_CURRENT;
+        resume->stale = 0;
+
+        const RECTANGLE_16 rect = resume_viewport(resume, viewport);
+        rc = resume_build_order(resume, &rect, focusX, focusY, TILE_CURRENT, true);
+    }
+    if (rc) {
+        LOGI("Resume: %u viewport tiles of %u, focus %d,%d", resume->priority, resume->count,
+             focusX, focusY);
+        SetEvent(resume->event);
+    }
+    LeaveCriticalSection(&resume->lock);
+    return rc;
+}
+
+void harmonyos_resume_set_viewport(harmonyosResume* resume, const RECTANGLE_16* viewport) {
+    if (!resume)
+        return;
+
+    EnterCriticalSection(&resume->lock);
+    if (resume->hashes && (resume->next >= resume->count) && (resume->outstanding == 0)) {
+        /* Deferred tiles that scrolled into view are requested now */
+        const RECTANGLE_16 rect = resume_viewport(resume, viewport);
+        const INT32 cx = (rect.left + rect.right) / 2;
+        const INT32 cy = (rect.top + rect.bottom) / 2;
+
+        if (resume_build_order(resume, &rect, cx, cy, TILE_STALE, false) && (resume->count > 0)) {
+            /* Nothing to compare against, these tiles are requested without a decision */
+            resume->trickle = true;
+            SetEvent(resume->event);
+        }
+    }
+    LeaveCriticalSection(&resume->lock);
+}
+
+UINT32 harmonyos_resume_next(harmonyosResume* resume, RECTANGLE_16* areas, UINT32 maxAreas,
+                             DWORD* timeout) {
+    UINT32 nareas = 0;
+
+    if (timeout)
+        *timeout = INFINITE;
+    if (!resume || !areas || (maxAreas == 0))
+        return 0;
+
+    EnterCriticalSection(&resume->lock);
+    const UINT64 now = GetTickCount64();
+
+    if (resume->outstanding && (now - resume->lastRequest >= RESUME_REQUEST_TIMEOUT_MS)) {
+        /* The server dropped part of the refresh, the kept frame stays for those tiles */
+        for (UINT32 x = 0; x < resume->next; x++) {
+            const UINT32 tile = resume->order[x];
+            if ((resume->state[tile] & TILE_STATE_MASK) == TILE_REQUESTED)
+                resume->state[tile] = TILE_CURRENT;
+        }
+        resume->outstanding = 0;
+    }
+
+    resume_check_viewport(resume);
+
+    const UINT64 elapsed = now - resume->lastRequest;
+
+    /* The focus tiles go out on their own so the server paints them first */
+    while ((nareas == 0) && (resume->next < resume->priority)) {
+        const UINT32 focus = MIN(resume->priority, RESUME_FOCUS_TILES);
+        const UINT32 limit = (resume->next < focus) ? focus : resume->priority;
+        nareas = resume_take(resume, limit, maxAreas, areas);
+    }
+
+    /* Paced to the frame rate, never ahead of the repaints the client still waits for */
+    if ((nareas == 0) && resume->trickle && (resume->next < resume->count) &&
+        (resume->outstanding == 0)) {
+        const UINT64 interval = resume_interval(resume);
+
+        if (elapsed >= interval)
+            nareas = resume_take(resume, resume->count, MIN(maxAreas, RESUME_TRICKLE_TILES), areas);
+        else if (timeout)
+            *timeout = (DWORD)(interval - elapsed);
+    }
+
+    /* A repaint signals the event, the timeout only catches refreshes the server dropped */
+    if ((nareas == 0) && timeout && resume->outstanding)
+        *timeout = (DWORD)(RESUME_REQUEST_TIMEOUT_MS - MIN(elapsed, RESUME_REQUEST_TIMEOUT_MS));
+
+    if (resume->next < resume->priority)
+        SetEvent(resume->event);
+    else
+        ResetEvent(resume->event);
+    LeaveCriticalSection(&resume->lock);
+    return nareas;
+}
+
+void harmonyos_resume_painted(harmonyosResume* resume, rdpGdi* gdi, const GDI_RGN* rects,
+                              UINT32 count) {
+    if (!resume || !resume_usable(gdi) || !rects)
+        return;
+
+    EnterCriticalSection(&resume->lock);
+    const UINT64 now = GetTickCount64();
+    if (resume->lastPaint) {
+        const UINT64 delta = MIN(now - resume->lastPaint, RESUME_MAX_INTERVAL_MS);
+        resume->frameInterval =
+            resume->frameInterval ? (resume->frameInterval * 7 + delta) / 8 : delta;
+    }
+    resume->lastPaint = now;
+
+    const bool active = (resume->next < resume->count) || resume->outstanding || resume->stale;
+    if (!active || ((UINT32)gdi->width != resume->width) ||
+        ((UINT32)gdi->height != resume->height)) {
+        LeaveCriticalSection(&resume->lock);
+        return;
+    }
+
+    for (UINT32 x = 0; x < count; x++) {
+        const GDI_RGN* rect = &rects[x];
+        if ((rect->w <= 0) || (rect->h <= 0))
+            continue;
+
+        const UINT32 c0 = (UINT32)MAX(rect->x, 0) / RESUME_TILE_SIZE;
+        const UINT32 r0 = (UINT32)MAX(rect->y, 0) / RESUME_TILE_SIZE;
+        const UINT32 c1 =
+            MIN((UINT32)MAX(rect->x + rect->w - 1, 0) / RESUME_TILE_SIZE, resume->cols - 1);
+        const UINT32 r1 =
+            MIN((UINT32)MAX(rect->y + rect->h - 1, 0) / RESUME_TILE_SIZE, resume->rows - 1);
+
+        for (UINT32 row = r0; row <= r1; row++) {
+            for (UINT32 col = c0; col <= c1; col++) {
+                const UINT32 tile = row * resume->cols + col;
+                const uint8_t state = resume->state[tile] & TILE_STATE_MASK;
+
+                if (state == TILE_CURRENT)
+                    continue;
+
+                const uint64_t hash = resume_tile_hash(resume, gdi, tile);
+                if (state == TILE_REQUESTED) {
+                    resume->outstanding--;
+                    if (resume->state[tile] & TILE_VIEWPORT) {
+                        if (hash == resume->hashes[tile])
+                            resume->unchanged++;
+                        else
+                            resume->changed++;
+                    }
+                } else if (state == TILE_STALE) {
+                    resume->stale--;
+                }
+
+                resume->hashes[tile] = hash;
+                resume->state[tile] = TILE_CURRENT;
+            }
+        }
+    }
+
+    /* Wake the session thread for the next batch or the viewport decision */
+    if ((resume->outstanding == 0) && (resume->next < resume->count))
+        SetEvent(resume->event);
+    LeaveCriticalSection(&resume->lock);
+}
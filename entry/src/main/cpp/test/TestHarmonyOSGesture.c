@@ -0,0 +1,299 @@
+/*
+ * HarmonyOS FreeRDP Touch Gesture Engine Test
+ *
+ * Copyright 2026 FreeRDP HarmonyOS Port
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+ */
+
+#include "harmonyos_freerdp.h"
+#include <math.h>
+#include <stdio.h>
+
+#include <freerdp/input.h>
+
+/* The limits of harmonyos_gesture.c */
+#define TEST_LONG_PRESS_MS 500
+#define TEST_QUEUE_SIZE 128
+#define TEST_WHEEL_STEP 120
+
+#define TEST_BUTTONS (PTR_FLAGS_BUTTON1 | PTR_FLAGS_BUTTON2 | PTR_FLAGS_BUTTON3)
+
+static const harmonyosViewTransform TEST_VIEW = { 1.0, 0.0, 0.0, 1920, 1080 };
+
+static HARMONYOS_GESTURE_STATE test_touch(harmonyosGesture* gesture, INT32 action, INT32 id,
+                                          double x, double y, UINT64 now) {
+    const double sample[HARMONYOS_TOUCH_SAMPLE_SIZE] = { (double)action, (double)id, x, y };
+    return harmonyos_gesture_feed(gesture, sample, ARRAYSIZE(sample), &TEST_VIEW, now);
+}
+
+static bool test_event(const harmonyosMouseEvent* event, UINT16 flags, UINT16 x, UINT16 y,
+                       const char* what) {
+    if ((event->flags != flags) || (event->x != x) || (event->y != y)) {
+        printf("%s: %04X at %u,%u, expected %04X at %u,%u\n", what, event->flags, event->x,
+               event->y, flags, x, y);
+        return false;
+    }
+    return true;
+}
+
+/* Rotation of a wheel event, the field is 9 bit two's complement */
+static INT32 test_wheel_value(UINT16 flags) {
+    const INT32 rotation = flags & WheelRotationMask;
+    return (flags & PTR_FLAGS_WHEEL_NEGATIVE) ? rotation - 0x200 : rotation;
+}
+
+static bool test_tap(void) {
+    bool rc = false;
+    harmonyosMouseEvent events[8] = { 0 };
+    DWORD timeout = 0;
+    harmonyosGesture* gesture = harmonyos_gesture_new();
+    if (!gesture)
+        return false;
+
+    if (test_touch(gesture, HARMONYOS_TOUCH_DOWN, 1, 100.0, 200.0, 0) !=
+        HARMONYOS_GESTURE_PENDING)
+        goto fail;
+
+    /* The pointer moves to the finger at once, the click waits for the release */
+    if ((harmonyos_gesture_next(gesture, 10, events, ARRAYSIZE(events), &timeout) != 1) ||
+        !test_event(&events[0], PTR_FLAGS_MOVE, 100, 200, "tap down"))
+        goto fail;
+    if (timeout != TEST_LONG_PRESS_MS - 10) {
+        printf("tap down: timeout %u\n", (unsigned int)timeout);
+        goto fail;
+    }
+
+    if (test_touch(gesture, HARMONYOS_TOUCH_UP, 1, 103.0, 202.0, 20) != HARMONYOS_GESTURE_NONE)
+        goto fail;
+
+    if ((harmonyos_gesture_next(gesture, 30, events, ARRAYSIZE(events), &timeout) != 2) ||
+        !test_event(&events[0], PTR_FLAGS_DOWN | PTR_FLAGS_BUTTON1, 100, 200, "tap press") ||
+        !test_event(&events[1], PTR_FLAGS_BUTTON1, 100, 200, "tap release"))
+        goto fail;
+    if ((timeout != INFINITE) ||
+        (WaitForSingleObject(harmonyos_gesture_get_event(gesture), 0) != WAIT_TIMEOUT)) {
+        printf("tap: still pending\n");
+        goto fail;
+    }
+
+    rc = true;
+fail:
+    harmonyos_gesture_free(gesture);
+    return rc;
+}
+
+static bool test_long_press(void) {
+    bool rc = false;
+    harmonyosMouseEvent events[8] = { 0 };
+    DWORD timeout = 0;
+    harmonyosGesture* gesture = harmonyos_gesture_new();
+    if (!gesture)
+        return false;
+
+    test_touch(gesture, HARMONYOS_TOUCH_DOWN, 1, 300.0, 400.0, 0);
+    /* Jitter within the slop keeps it a press */
+    test_touch(gesture, HARMONYOS_TOUCH_MOVE, 1, 304.0, 397.0, 100);
+
+    if ((harmonyos_gesture_next(gesture, 100, events, ARRAYSIZE(events), &timeout) != 1) ||
+        !test_event(&events[0], PTR_FLAGS_MOVE, 300, 400, "long press down"))
+        goto fail;
+
+    if ((harmonyos_gesture_next(gesture, TEST_LONG_PRESS_MS - 1, events, ARRAYSIZE(events),
+                                &timeout) != 0) ||
+        (timeout != 1)) {
+        printf("long press: fired early, timeout %u\n", (unsigned int)timeout);
+        goto fail;
+    }
+
+    /* Held long enough, a right click where the finger went down */
+    if ((harmonyos_gesture_next(gesture, TEST_LONG_PRESS_MS, events, ARRAYSIZE(events),
+                                &timeout) != 2) ||
+        !test_event(&events[0], PTR_FLAGS_DOWN | PTR_FLAGS_BUTTON2, 300, 400, "long press") ||
+        !test_event(&events[1], PTR_FLAGS_BUTTON2, 300, 400, "long press release"))
+        goto fail;
+
+    /* Lifting the finger afterwards sends nothing */
+    if (test_touch(gesture, HARMONYOS_TOUCH_UP, 1, 304.0, 397.0, 900) != HARMONYOS_GESTURE_NONE)
+        goto fail;
+    if (harmonyos_gesture_next(gesture, 900, events, ARRAYSIZE(events), &timeout) != 0) {
+        printf("long press: events after the release\n");
+        goto fail;
+    }
+
+    rc = true;
+fail:
+    harmonyos_gesture_free(gesture);
+    return rc;
+}
+
+/* Two fingers panned in steps, the wheel events must add up to the scroll */
+static bool test_scroll(double step) {
+    bool rc = false;
+    harmonyosMouseEvent events[16] = { 0 };
+    DWORD timeout = 0;
+    INT32 total = 0;
+    UINT32 wheels = 0;
+    harmonyosGesture* gesture = harmonyos_gesture_new();
+    if (!gesture)
+        return false;
+
+    test_touch(gesture, HARMONYOS_TOUCH_DOWN, 1, 500.0, 500.0, 0);
+    if (test_touch(gesture, HARMONYOS_TOUCH_DOWN, 2, 600.0, 500.0, 10) !=
+        HARMONYOS_GESTURE_TWO_FINGER)
+        goto fail;
+
+    /* The center leaves the slop with the first finger, the pointer goes there */
+    double y = 500.0 + 2.0 * step;
+    test_touch(gesture, HARMONYOS_TOUCH_MOVE, 1, 500.0, y, 20);
+    if (test_touch(gesture, HARMONYOS_TOUCH_MOVE, 2, 600.0, y, 20) != HARMONYOS_GESTURE_SCROLL)
+        goto fail;
+
+    for (size_t x = 0; x < 14; x++) {
+        y += step;
+        test_touch(gesture, HARMONYOS_TOUCH_MOVE, 1, 500.0, y, 30);
+        test_touch(gesture, HARMONYOS_TOUCH_MOVE, 2, 600.0, y, 30);
+    }
+    test_touch(gesture, HARMONYOS_TOUCH_UP, 1, 500.0, y, 40);
+    test_touch(gesture, HARMONYOS_TOUCH_UP, 2, 600.0, y, 40);
+
+    const UINT32 count = harmonyos_gesture_next(gesture, 50, events, ARRAYSIZE(events), &timeout);
+    if ((count < 2) ||
+        !test_event(&events[0], PTR_FLAGS_MOVE, 550, (UINT16)(500.0 + step), "scroll center"))
+        goto fail;
+
+    for (UINT32 x = 1; x < count; x++) {
+        const UINT16 flags = events[x].flags;
+        const INT32 value = test_wheel_value(flags);
+
+        if ((flags & ~(PTR_FLAGS_WHEEL_NEGATIVE | WheelRotationMask)) != PTR_FLAGS_WHEEL) {
+            printf("scroll: unexpected event %04X\n", flags);
+            goto fail;
+        }
+        if ((value == 0) || (value > TEST_WHEEL_STEP) || (value < -TEST_WHEEL_STEP) ||
+            ((value > 0) != (step > 0.0))) {
+            printf("scroll: wheel %04X is %d\n", flags, value);
+            goto fail;
+        }
+        total += value;
+        wheels++;
+    }
+
+    /*
+     * Content follows the fingers, a unit of finger movement is 3 wheel units. The second
+     * finger's first step already scrolls, the first one's only left the slop.
+     */
+    const INT32 expected = (INT32)(3.0 * 15.0 * step);
+    if ((total != expected) || (wheels < 2) || (timeout != INFINITE)) {
+        printf("scroll %.0f: %d in %u events, expected %d\n", step, total, wheels, expected);
+        goto fail;
+    }
+
+    rc = true;
+fail:
+    harmonyos_gesture_free(gesture);
+    return rc;
+}
+
+/*
+ * Queue taps without draining, then a drag. Every press that made it into the queue must
+ * be followed by its release, and no release may come without its press.
+ */
+static bool test_queue_full(UINT32 taps) {
+    bool rc = false;
+    harmonyosMouseEvent events[2 * TEST_QUEUE_SIZE] = { 0 };
+    DWORD timeout = 0;
+    UINT16 pressed = 0;
+    bool dragPressed = false;
+    bool dragReleased = false;
+    harmonyosGesture* gesture = harmonyos_gesture_new();
+    if (!gesture)
+        return false;
+
+    for (UINT32 x = 0; x < taps; x++) {
+        const double px = 10.0 + 3.0 * (x % 500);
+        const double py = 10.0 + 3.0 * (x / 500);
+        test_touch(gesture, HARMONYOS_TOUCH_DOWN, 1, px, py, x);
+        test_touch(gesture, HARMONYOS_TOUCH_UP, 1, px, py, x);
+    }
+
+    test_touch(gesture, HARMONYOS_TOUCH_DOWN, 1, 1000.0, 900.0, taps);
+    if (test_touch(gesture, HARMONYOS_TOUCH_MOVE, 1, 1100.0, 950.0, taps) !=
+        HARMONYOS_GESTURE_DRAG)
+        goto fail;
+    test_touch(gesture, HARMONYOS_TOUCH_MOVE, 1, 1200.0, 1000.0, taps);
+    test_touch(gesture, HARMONYOS_TOUCH_UP, 1, 1200.0, 1000.0, taps);
+
+    const UINT32 count = harmonyos_gesture_next(gesture, taps, events, ARRAYSIZE(events), &timeout);
+    if ((count == 0) || (count > TEST_QUEUE_SIZE)) {
+        printf("queue %u taps: %u events\n", taps, count);
+        goto fail;
+    }
+
+    for (UINT32 x = 0; x < count; x++) {
+        const UINT16 flags = events[x].flags;
+        const UINT16 button = flags & TEST_BUTTONS;
+        if (!button)
+            continue;
+
+        if (flags & PTR_FLAGS_DOWN) {
+            if (pressed & button) {
+                printf("queue %u taps: %04X pressed twice at %u\n", taps, flags, x);
+                goto fail;
+            }
+            pressed |= button;
+            if ((events[x].x == 1000) && (events[x].y == 900))
+                dragPressed = true;
+        } else {
+            if (!(pressed & button)) {
+                printf("queue %u taps: release %04X without press at %u\n", taps, flags, x);
+                goto fail;
+            }
+            pressed &= (UINT16)~button;
+            if ((events[x].x == 1200) && (events[x].y == 1000))
+                dragReleased = true;
+        }
+    }
+
+    if (pressed || (dragPressed != dragReleased)) {
+        printf("queue %u taps: buttons %04X held, drag %d released %d\n", taps, pressed,
+               dragPressed, dragReleased);
+        goto fail;
+    }
+
+    /* Without pressure the drag itself is never lost */
+    if ((taps * 3 + 4 <= TEST_QUEUE_SIZE) && !dragPressed) {
+        printf("queue %u taps: drag dropped\n", taps);
+        goto fail;
+    }
+
+    rc = true;
+fail:
+    harmonyos_gesture_free(gesture);
+    return rc;
+}
+
+int TestHarmonyOSGesture(int argc, char* argv[]) {
+    WINPR_UNUSED(argc);
+    WINPR_UNUSED(argv);
+
+    if (!test_tap())
+        return -1;
+
+    if (!test_long_press())
+        return -1;
+
+    if (!test_scroll(15.0) || !test_scroll(-15.0))
+        return -1;
+
+    /* Around the point where the queue fills up, the reserved release slots are tight there */
+    for (UINT32 taps = 38; taps <= 46; taps++) {
+        if (!test_queue_full(taps))
+            return -1;
+    }
+
+    if (!test_queue_full(200))
+        return -1;
+
+    return 0;
+}
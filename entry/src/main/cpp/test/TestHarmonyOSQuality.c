@@ -0,0 +1,271 @@
+/*
+ * HarmonyOS FreeRDP Adaptive Quality Controller Test
+ *
+ * Copyright 2026 FreeRDP HarmonyOS Port
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+ */
+
+#include "harmonyos_freerdp.h"
+#include <stdio.h>
+
+#include <freerdp/channels/rdpgfx.h>
+#include <freerdp/codec/audio.h>
+
+/* The hold times of harmonyos_quality.c */
+#define TEST_DEGRADE_MS 1000
+#define TEST_RECOVER_MS 5000
+
+static bool test_level(harmonyosQuality* quality, HARMONYOS_QUALITY_LEVEL expected,
+                       bool changed, const char* what) {
+    HARMONYOS_QUALITY_LEVEL level = HARMONYOS_QUALITY_GOOD;
+    const bool signalled = WaitForSingleObject(harmonyos_quality_get_event(quality), 0) ==
+                           WAIT_OBJECT_0;
+
+    if ((harmonyos_quality_poll(quality, &level) != changed) || (signalled != changed) ||
+        (level != expected)) {
+        printf("%s: level %d changed %d, expected %d changed %d\n", what, level, signalled,
+               expected, changed);
+        return false;
+    }
+    return true;
+}
+
+/* Feed an RTT until the smoothed value crosses the threshold, then hold it */
+static bool test_network(harmonyosQuality* quality, UINT32 rtt, bool above, UINT32 threshold,
+                         UINT64 now) {
+    harmonyosQualityStats stats = { 0 };
+
+    for (size_t x = 0; x < 16; x++) {
+        harmonyos_quality_network(quality, rtt, 0, now);
+        if (!harmonyos_quality_get_stats(quality, &stats))
+            return false;
+        if (above ? (stats.rtt >= threshold) : (stats.rtt < threshold))
+            return true;
+    }
+    printf("rtt %u did not reach %u\n", stats.rtt, threshold);
+    return false;
+}
+
+static bool test_classify(void) {
+    bool rc = false;
+    harmonyosQuality* quality = harmonyos_quality_new();
+    if (!quality)
+        return false;
+
+    /* Low RTT with an unknown or high bandwidth stays good */
+    harmonyos_quality_network(quality, 30, 0, 0);
+    harmonyos_quality_network(quality, 30, 20000, TEST_DEGRADE_MS);
+    harmonyos_quality_frame(quality, 10, TEST_DEGRADE_MS);
+    if (!test_level(quality, HARMONYOS_QUALITY_GOOD, false, "good"))
+        goto fail;
+    harmonyos_quality_free(quality);
+
+    /* A medium RTT is fair */
+    quality = harmonyos_quality_new();
+    if (!quality)
+        return false;
+    harmonyos_quality_network(quality, 100, 0, 0);
+    harmonyos_quality_network(quality, 100, 0, TEST_DEGRADE_MS);
+    if (!test_level(quality, HARMONYOS_QUALITY_FAIR, true, "rtt fair"))
+        goto fail;
+    harmonyos_quality_free(quality);
+
+    /* A high RTT is poor */
+    quality = harmonyos_quality_new();
+    if (!quality)
+        return false;
+    harmonyos_quality_network(quality, 300, 0, 0);
+    harmonyos_quality_network(quality, 300, 0, TEST_DEGRADE_MS);
+    if (!test_level(quality, HARMONYOS_QUALITY_POOR, true, "rtt poor"))
+        goto fail;
+    harmonyos_quality_free(quality);
+
+    /* 125000 bytes in a second are 1000 kbit/s, too little even with a low RTT */
+    quality = harmonyos_quality_new();
+    if (!quality)
+        return false;
+    harmonyos_quality_network(quality, 30, 0, 0);
+    harmonyos_quality_bandwidth(quality, 1000, 125000, 0);
+    harmonyos_quality_bandwidth(quality, 1000, 125000, TEST_DEGRADE_MS);
+    if (!test_level(quality, HARMONYOS_QUALITY_POOR, true, "bandwidth poor"))
+        goto fail;
+    harmonyos_quality_free(quality);
+
+    /* A medium bandwidth is fair */
+    quality = harmonyos_quality_new();
+    if (!quality)
+        return false;
+    harmonyos_quality_network(quality, 30, 5000, 0);
+    harmonyos_quality_network(quality, 30, 5000, TEST_DEGRADE_MS);
+    if (!test_level(quality, HARMONYOS_QUALITY_FAIR, true, "bandwidth fair"))
+        goto fail;
+    harmonyos_quality_free(quality);
+
+    /* Slow decoding is poor on a good link */
+    quality = harmonyos_quality_new();
+    if (!quality)
+        return false;
+    harmonyos_quality_frame(quality, 200, 0);
+    harmonyos_quality_frame(quality, 200, TEST_DEGRADE_MS);
+    if (!test_level(quality, HARMONYOS_QUALITY_POOR, true, "frame poor"))
+        goto fail;
+
+    rc = true;
+fail:
+    harmonyos_quality_free(quality);
+    return rc;
+}
+
+static bool test_hold(void) {
+    bool rc = false;
+    harmonyosQuality* quality = harmonyos_quality_new();
+    if (!quality)
+        return false;
+
+    /* Degrading needs the new level for a second */
+    harmonyos_quality_network(quality, 100, 0, 1000);
+    if (!test_level(quality, HARMONYOS_QUALITY_GOOD, false, "degrade start"))
+        goto fail;
+    harmonyos_quality_network(quality, 100, 0, 1000 + TEST_DEGRADE_MS - 1);
+    if (!test_level(quality, HARMONYOS_QUALITY_GOOD, false, "degrade held"))
+        goto fail;
+    harmonyos_quality_network(quality, 100, 0, 1000 + TEST_DEGRADE_MS);
+    if (!test_level(quality, HARMONYOS_QUALITY_FAIR, true, "degraded"))
+        goto fail;
+
+    /* The change is only reported once */
+    harmonyos_quality_network(quality, 100, 0, 3000);
+    if (!test_level(quality, HARMONYOS_QUALITY_FAIR, false, "degraded again"))
+        goto fail;
+
+    /* Recovering needs five */
+    if (!test_network(quality, 30, false, 60, 4000))
+        goto fail;
+    harmonyos_quality_network(quality, 30, 0, 4000 + TEST_DEGRADE_MS);
+    if (!test_level(quality, HARMONYOS_QUALITY_FAIR, false, "recover after degrade hold"))
+        goto fail;
+    harmonyos_quality_network(quality, 30, 0, 4000 + TEST_RECOVER_MS - 1);
+    if (!test_level(quality, HARMONYOS_QUALITY_FAIR, false, "recover held"))
+        goto fail;
+    harmonyos_quality_network(quality, 30, 0, 4000 + TEST_RECOVER_MS);
+    if (!test_level(quality, HARMONYOS_QUALITY_GOOD, true, "recovered"))
+        goto fail;
+
+    rc = true;
+fail:
+    harmonyos_quality_free(quality);
+    return rc;
+}
+
+static bool test_depth(UINT32 got, UINT32 expected, harmonyosQuality* quality, const char* what) {
+    harmonyosQualityStats stats = { 0 };
+
+    if (!harmonyos_quality_get_stats(quality, &stats) || (got != expected) ||
+        (stats.queueDepth != expected)) {
+        printf("%s: queueDepth %u (stats %u), expected %u\n", what, got, stats.queueDepth,
+               expected);
+        return false;
+    }
+    return true;
+}
+
+static bool test_queue_depth(void) {
+    bool rc = false;
+    harmonyosQuality* quality = harmonyos_quality_new();
+    if (!quality)
+        return false;
+
+    /* A good link leaves the pacing to the server */
+    UINT32 depth = harmonyos_quality_frame(quality, 10, 0);
+    if (!test_depth(depth, QUEUE_DEPTH_UNAVAILABLE, quality, "good first"))
+        goto fail;
+    depth = harmonyos_quality_frame(quality, 10, 16);
+    if (!test_depth(depth, QUEUE_DEPTH_UNAVAILABLE, quality, "good"))
+        goto fail;
+
+    harmonyos_quality_network(quality, 100, 0, 100);
+    harmonyos_quality_network(quality, 100, 0, 100 + TEST_DEGRADE_MS);
+    if (!test_level(quality, HARMONYOS_QUALITY_FAIR, true, "depth fair"))
+        goto fail;
+
+    /* A new frame every 20 ms taking 40 ms to decode has two more behind it */
+    depth = harmonyos_quality_frame(quality, 40, 1200);
+    depth = harmonyos_quality_frame(quality, 40, 1220);
+    if (!test_depth(depth, 1, quality, "fair ramp"))
+        goto fail;
+    for (UINT64 now = 1240; now < 1600; now += 20)
+        depth = harmonyos_quality_frame(quality, 40, now);
+    if (!test_depth(depth, 2, quality, "fair"))
+        goto fail;
+
+    /* Poor adds the extra frames */
+    if (!test_network(quality, 300, true, 250, 1600))
+        goto fail;
+    harmonyos_quality_network(quality, 300, 0, 1600 + TEST_DEGRADE_MS);
+    if (!test_level(quality, HARMONYOS_QUALITY_POOR, true, "depth poor"))
+        goto fail;
+    depth = harmonyos_quality_frame(quality, 40, 2620);
+    if (!test_depth(depth, 4, quality, "poor"))
+        goto fail;
+
+    /* Slow decoding is capped */
+    for (UINT64 now = 2640; now < 3000; now += 20)
+        depth = harmonyos_quality_frame(quality, 2000, now);
+    if (!test_depth(depth, 16, quality, "poor capped"))
+        goto fail;
+
+    rc = true;
+fail:
+    harmonyos_quality_free(quality);
+    return rc;
+}
+
+static bool test_audio(void) {
+    bool rc = false;
+    harmonyosQualityStats stats = { 0 };
+    harmonyosQuality* quality = harmonyos_quality_new();
+    if (!quality)
+        return false;
+
+    /* The loaded channel keeps its mode until the next connect */
+    harmonyos_quality_request_audio(quality, MEDIUM_QUALITY);
+    if (!harmonyos_quality_get_stats(quality, &stats) || (stats.audioQuality != HIGH_QUALITY) ||
+        (stats.audioRequested != MEDIUM_QUALITY)) {
+        printf("audio requested: %u live, %u requested\n", stats.audioQuality,
+               stats.audioRequested);
+        goto fail;
+    }
+
+    harmonyos_quality_connect_audio(quality);
+    if (!harmonyos_quality_get_stats(quality, &stats) || (stats.audioQuality != MEDIUM_QUALITY) ||
+        (stats.audioRequested != MEDIUM_QUALITY)) {
+        printf("audio connected: %u live, %u requested\n", stats.audioQuality,
+               stats.audioRequested);
+        goto fail;
+    }
+
+    rc = true;
+fail:
+    harmonyos_quality_free(quality);
+    return rc;
+}
+
+int TestHarmonyOSQuality(int argc, char* argv[]) {
+    WINPR_UNUSED(argc);
+    WINPR_UNUSED(argv);
+
+    if (!test_classify())
+        return -1;
+
+    if (!test_hold())
+        return -1;
+
+    if (!test_queue_depth())
+        return -1;
+
+    if (!test_audio())
+        return -1;
+
+    return 0;
+}